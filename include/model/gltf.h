@@ -17,9 +17,17 @@
 
 struct fpx3d_model_gltf_mesh_primitive;
 
+// JSON text and per-entity byte spans kept around by lazily read assets
+struct fpx3d_model_gltf_lazy_state;
+
+// a piece of a GLB file's BIN chunk, read by fpx3d_model_glb_load()
+struct fpx3d_model_glb_block;
+
 struct _fpx3d_model_gltf_scene {
   char *name;
+
   Fpx3d_Model_GltfNode **nodes;
+  size_t nodeCount;
 };
 
 struct _fpx3d_model_gltf_camera_perspective {
@@ -142,6 +150,44 @@ struct _fpx3d_model_gltf_buffer_view {
     FPX3D_GLTF_BUFFER_VIEW_TARGET_ARRAY_BUFFER = 34962,
     FPX3D_GLTF_BUFFER_VIEW_TARGET_ELEMENT_ARRAY_BUFFER = 34963,
   } target;
+
+  // EXT_meshopt_compression
+  // if `isCompressed` is set, `buffer` is only a (possibly data-less)
+  // fallback, and the actual contents are decoded from `meshopt.buffer`
+  struct {
+    Fpx3d_Model_GltfBuffer *buffer;
+
+    size_t byteOffset;
+    size_t byteLength;
+
+    size_t byteStride;
+    size_t count;
+
+    enum {
+      FPX3D_GLTF_MESHOPT_MODE_INVALID = 0,
+      FPX3D_GLTF_MESHOPT_MODE_ATTRIBUTES = 1,
+      FPX3D_GLTF_MESHOPT_MODE_TRIANGLES = 2,
+      FPX3D_GLTF_MESHOPT_MODE_INDICES = 3,
+    } mode;
+
+    enum {
+      FPX3D_GLTF_MESHOPT_FILTER_NONE = 0,
+      FPX3D_GLTF_MESHOPT_FILTER_OCTAHEDRAL = 1,
+      FPX3D_GLTF_MESHOPT_FILTER_QUATERNION = 2,
+      FPX3D_GLTF_MESHOPT_FILTER_EXPONENTIAL = 3,
+    } filter;
+
+    bool isCompressed;
+  } meshopt;
+
+  // holds `byteLength` bytes of decompressed view contents.
+  // NULL if the view is not compressed, or its source buffer
+  // was not available at load time
+  void *decodedData;
+
+  // the view's bytes (or its compressed source bytes) while they are
+  // loaded through fpx3d_model_glb_load(). Not owned by the view
+  const void *residentData;
 };
 
 struct _fpx3d_model_gltf_accessor {
@@ -176,6 +222,9 @@ struct _fpx3d_model_gltf_accessor {
     mat4 matrix4;
   } maxValues, minValues;
 
+  // both `max` and `min` were given; the values above are zeroes otherwise
+  bool hasBounds;
+
   struct {
     size_t count;
     struct {
@@ -348,6 +397,14 @@ struct _fpx3d_model_gltf_asset_description {
 
   // ptr to one of the cameras in the `cameras` array
   Fpx3d_Model_GltfCamera *mainCamera;
+
+  // ptr to the scene in the `scenes` array to show when the asset is
+  // loaded, or NULL if the file doesn't name one
+  Fpx3d_Model_GltfScene *scene;
+
+  // only set for assets read using fpx3d_model_read_gltf_lazy().
+  // Entities that were not required yet are left zeroed
+  struct fpx3d_model_gltf_lazy_state *lazy;
 };
 
 struct fpx3d_model_glb_chunk {
@@ -378,6 +435,92 @@ struct _fpx3d_model_gltf_asset {
 Fpx3d_E_Result fpx3d_model_read_gltf(const uint8_t *data, size_t datalength,
                                      Fpx3d_Model_GltfAsset *output);
 
+// only scans the JSON for where every top-level entity starts and ends.
+// The entity arrays are allocated (zeroed) so references stay valid, but
+// nothing is parsed until fpx3d_model_gltf_require() asks for it
+Fpx3d_E_Result fpx3d_model_read_gltf_lazy(const uint8_t *data,
+                                          size_t datalength,
+                                          Fpx3d_Model_GltfAsset *output);
+
+// parses one entity of a lazily read asset, along with everything it
+// refers to (a node pulls in its children, mesh, skin and camera, a mesh
+// its accessors, views, buffers and materials, etc.). Compressed views are
+// decoded once their source buffer is available.
+// Entities that are already parsed, and eagerly read assets, are a no-op
+Fpx3d_E_Result fpx3d_model_gltf_require(Fpx3d_Model_GltfAsset *,
+                                        Fpx3d_Model_E_GltfEntityType type,
+                                        size_t index);
+
+bool fpx3d_model_gltf_is_parsed(const Fpx3d_Model_GltfAsset *,
+                                Fpx3d_Model_E_GltfEntityType type,
+                                size_t index);
+
+// a GLB file that stays open, so buffer data can be read in pieces
+struct _fpx3d_model_glb_file {
+  // lazily read description of the JSON chunk. Views of the BIN chunk
+  // only have data while something that uses them is loaded
+  Fpx3d_Model_GltfAsset asset;
+
+  void *file;
+
+  // position of the BIN chunk contents inside the file
+  size_t binOffset;
+  size_t binLength;
+
+  // per buffer view: how many loads currently use it, and the
+  // block of file contents holding its bytes
+  size_t *viewRefs;
+  struct fpx3d_model_glb_block **viewBlocks;
+
+  size_t residentBytes;
+};
+
+// reads the header and JSON chunk of a GLB file. No buffer data is read
+Fpx3d_E_Result fpx3d_model_open_glb(const char *path, Fpx3d_Model_GlbFile *);
+
+// releases every loaded block and closes the file
+void fpx3d_model_close_glb(Fpx3d_Model_GlbFile *);
+
+// requires the entity (see fpx3d_model_gltf_require()) and reads the byte
+// ranges of every BIN-chunk buffer view it depends on. Ranges that are
+// close together are fetched with a single scattered read. Views shared
+// between loads are reference counted and only read once
+Fpx3d_E_Result fpx3d_model_glb_load(Fpx3d_Model_GlbFile *,
+                                    Fpx3d_Model_E_GltfEntityType type,
+                                    size_t index);
+
+// undoes one fpx3d_model_glb_load() of the same entity. Blocks are freed
+// as soon as none of their views are used anymore
+Fpx3d_E_Result fpx3d_model_glb_release(Fpx3d_Model_GlbFile *,
+                                       Fpx3d_Model_E_GltfEntityType type,
+                                       size_t index);
+
+// frees everything owned by the asset, including GLB chunk data
+void fpx3d_model_destroy_gltf(Fpx3d_Model_GltfAsset *);
+
+// the asset description of either container type.
+// NULL if the asset holds no (valid) JSON
+Fpx3d_Model_GltfAssetDescription *
+fpx3d_model_gltf_description(const Fpx3d_Model_GltfAsset *);
+
+// receives the serialized output in blocks of at most a few dozen KiB.
+// Return false to abort writing
+typedef bool (*Fpx3d_Model_GlbWriteCallback)(void *user_data,
+                                             const void *data, size_t length);
+
+// serializes the asset into a GLB container and streams it to `write`.
+// Only buffer views that something refers to are written; byte-identical
+// views and identical accessors are merged, and every view starts 4-byte
+// aligned inside the single BIN chunk. Meshopt-compressed views are
+// written decompressed. Image URIs are kept as they are
+Fpx3d_E_Result fpx3d_model_write_glb(const Fpx3d_Model_GltfAsset *,
+                                     Fpx3d_Model_GlbWriteCallback write,
+                                     void *user_data);
+
+// fpx3d_model_write_glb() into a file
+Fpx3d_E_Result fpx3d_model_save_glb(const Fpx3d_Model_GltfAsset *,
+                                    const char *path);
+
 Fpx3d_E_Result
 fpx3d_model_parse_gltf_json(const uint8_t *data, size_t dataLength,
                             struct fpx3d_model_glb_chunk *output);
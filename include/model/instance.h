@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX3D_MODEL_INSTANCE_H
+#define FPX3D_MODEL_INSTANCE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../fpx3d.h"
+#include "./gltf.h"
+#include "./typedefs.h"
+
+#include "../../modules/cglm/include/cglm/types.h"
+
+// value of `animations[i]` for instances that are not playing anything
+#define FPX3D_MODEL_NO_ANIMATION SIZE_MAX
+
+struct fpx3d_model_instance_node;
+struct fpx3d_model_instance_track;
+
+// any amount of copies of one parsed glTF asset. The asset is only read
+// from (and has to outlive the set); every instance just owns its node
+// transforms, morph weights and animation clock.
+// Everything is laid out node-major, so one node (or one weight) of all
+// instances sits together: the value of node `n` for instance `i` is at
+// index `n * capacity + i`
+struct _fpx3d_model_gltf_instances {
+  const Fpx3d_Model_GltfAsset *asset;
+
+  size_t count;
+  size_t capacity;
+
+  size_t nodeCount;
+
+  // local transforms, written by fpx3d_model_gltf_instances_animate()
+  vec3 *translations;
+  vec4 *rotations;
+  vec3 *scales;
+
+  // written by fpx3d_model_gltf_instances_update()
+  mat4 *worldMatrices;
+
+  // weight `w` of node `n` for instance `i` is at
+  // `(weightOffsets[n] + w) * capacity + i`. Nodes without a mesh with
+  // morph targets get no weights
+  float *weights;
+  size_t *weightOffsets;
+  size_t *weightCounts;
+  size_t weightCount;
+
+  // per instance: index of the animation it plays, and where it is at
+  // (in seconds)
+  size_t *animations;
+  float *times;
+
+  // length of every animation of the asset, in seconds
+  float *durations;
+
+  // hierarchy and rest pose of every node, and every animation channel
+  // with its keyframes converted to floats
+  struct fpx3d_model_instance_node *nodes;
+  size_t *nodeOrder;
+
+  struct fpx3d_model_instance_track *tracks;
+  size_t *trackOffsets;
+};
+
+// every node and animation of the asset has to be parsed. Room is made for
+// `capacity` instances up front; adding more grows the arrays
+Fpx3d_E_Result
+fpx3d_model_create_gltf_instances(const Fpx3d_Model_GltfAsset *,
+                                  size_t capacity,
+                                  Fpx3d_Model_GltfInstances *output);
+
+void fpx3d_model_destroy_gltf_instances(Fpx3d_Model_GltfInstances *);
+
+// the new instance starts in the rest pose of the asset, without animation
+Fpx3d_E_Result fpx3d_model_gltf_instance_add(Fpx3d_Model_GltfInstances *,
+                                             size_t *index_output);
+
+// the last instance is moved into the freed up index
+Fpx3d_E_Result fpx3d_model_gltf_instance_remove(Fpx3d_Model_GltfInstances *,
+                                                size_t index);
+
+// FPX3D_MODEL_NO_ANIMATION stops the instance where it is
+Fpx3d_E_Result fpx3d_model_gltf_instance_play(Fpx3d_Model_GltfInstances *,
+                                              size_t index, size_t animation,
+                                              float start_time);
+
+// moves the clock of every playing instance ahead, looping at the end of
+// its animation
+Fpx3d_E_Result fpx3d_model_gltf_instances_advance(Fpx3d_Model_GltfInstances *,
+                                                  float seconds);
+
+// samples the animation of every playing instance into its local
+// transforms and weights. Channel by channel, for all instances at once
+Fpx3d_E_Result fpx3d_model_gltf_instances_animate(Fpx3d_Model_GltfInstances *);
+
+// recomputes the world matrix of every node of every instance, parents
+// before children
+Fpx3d_E_Result fpx3d_model_gltf_instances_update(Fpx3d_Model_GltfInstances *);
+
+// NULL if either index is out of range
+const mat4 *
+fpx3d_model_gltf_instance_world(const Fpx3d_Model_GltfInstances *,
+                                size_t index, size_t node);
+
+#endif // FPX3D_MODEL_INSTANCE_H
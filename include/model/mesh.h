@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX3D_MODEL_MESH_H
+#define FPX3D_MODEL_MESH_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "../fpx3d.h"
+#include "./typedefs.h"
+
+#include "../../modules/cglm/include/cglm/types.h"
+
+// describes one attribute stream when creating a mesh
+struct fpx3d_model_mesh_stream_info {
+  // optional, copied into the mesh
+  const char *name;
+
+  Fpx3d_Model_E_AttributeSemantic semantic;
+  uint8_t semanticIndex; // n in TEXCOORD_n, COLOR_n, etc.
+
+  Fpx3d_Model_E_ComponentFormat format;
+  uint8_t componentCount; // 1 through 4
+  bool normalized;        // only meaningful for integer formats
+};
+
+struct fpx3d_model_mesh_stream {
+  char *name;
+
+  Fpx3d_Model_E_AttributeSemantic semantic;
+  uint8_t semanticIndex;
+
+  Fpx3d_Model_E_ComponentFormat format;
+  uint8_t componentCount;
+  bool normalized;
+
+  // size of a single element of this stream in bytes
+  size_t elementSize;
+
+  // SOA:         offset of the start of the stream in `vertexData`
+  // INTERLEAVED: offset of the attribute inside a single vertex
+  size_t offset;
+
+  // bytes between two consecutive elements of this stream
+  size_t stride;
+};
+
+// a contiguous range of indices drawn with one material
+struct fpx3d_model_submesh {
+  size_t firstIndex;
+  size_t indexCount;
+
+  // range of vertices referenced by this submesh.
+  // Indices are always relative to vertex 0 of the mesh
+  size_t firstVertex;
+  size_t vertexCount;
+
+  // index into whatever material list the mesh came with, -1 if none
+  int32_t material;
+
+  struct {
+    vec3 min;
+    vec3 max;
+  } bounds;
+};
+
+struct _fpx3d_model_mesh {
+  Fpx3d_Model_E_MeshLayout layout;
+
+  size_t vertexCount;
+
+  void *vertexData;
+  size_t vertexDataSize;
+
+  struct fpx3d_model_mesh_stream *streams;
+  size_t streamCount;
+
+  // 0 (non-indexed), 2 or 4
+  size_t indexSize;
+
+  void *indices;
+  size_t indexCount;
+
+  struct fpx3d_model_submesh *submeshes;
+  size_t submeshCount;
+
+  struct {
+    vec3 min;
+    vec3 max;
+  } bounds;
+};
+
+size_t fpx3d_model_component_size(Fpx3d_Model_E_ComponentFormat format);
+
+// allocates (zeroed) vertex storage for `vertex_count` vertices
+// laid out according to `layout` and `streams`
+Fpx3d_E_Result
+fpx3d_model_create_mesh(Fpx3d_Model_Mesh *output, Fpx3d_Model_E_MeshLayout layout,
+                        size_t vertex_count,
+                        const struct fpx3d_model_mesh_stream_info *streams,
+                        size_t stream_count);
+
+void fpx3d_model_destroy_mesh(Fpx3d_Model_Mesh *);
+
+// returns NULL if the mesh has no such stream
+struct fpx3d_model_mesh_stream *
+fpx3d_model_mesh_get_stream(Fpx3d_Model_Mesh *,
+                            Fpx3d_Model_E_AttributeSemantic semantic,
+                            uint8_t semantic_index);
+
+// pointer to the element of `stream` that belongs to vertex `vertex_index`
+void *fpx3d_model_mesh_stream_element(Fpx3d_Model_Mesh *,
+                                      const struct fpx3d_model_mesh_stream *,
+                                      size_t vertex_index);
+
+// copies `count` tightly packed elements into the stream, starting at
+// vertex `first_vertex`
+Fpx3d_E_Result
+fpx3d_model_mesh_write_stream(Fpx3d_Model_Mesh *,
+                              struct fpx3d_model_mesh_stream *,
+                              size_t first_vertex, const void *elements,
+                              size_t count);
+
+// picks 16-bit storage if every index fits, 32-bit otherwise
+Fpx3d_E_Result fpx3d_model_mesh_set_indices(Fpx3d_Model_Mesh *,
+                                            const uint32_t *indices,
+                                            size_t count);
+
+uint32_t fpx3d_model_mesh_get_index(const Fpx3d_Model_Mesh *, size_t i);
+
+// bounds are computed from the POSITION stream (if it is 3x FLOAT32)
+Fpx3d_E_Result fpx3d_model_mesh_add_submesh(Fpx3d_Model_Mesh *,
+                                            size_t first_index,
+                                            size_t index_count,
+                                            int32_t material);
+
+Fpx3d_E_Result fpx3d_model_mesh_compute_bounds(Fpx3d_Model_Mesh *);
+
+Fpx3d_E_Result fpx3d_model_mesh_convert_layout(Fpx3d_Model_Mesh *,
+                                               Fpx3d_Model_E_MeshLayout layout);
+
+// every primitive becomes a submesh. All primitives have to share the same
+// set of attributes (which is what exporters produce in practice)
+Fpx3d_E_Result fpx3d_model_mesh_from_gltf(const Fpx3d_Model_GltfAsset *asset,
+                                          const Fpx3d_Model_GltfMesh *gltf_mesh,
+                                          Fpx3d_Model_E_MeshLayout layout,
+                                          Fpx3d_Model_Mesh *output);
+
+// builds a standalone glTF asset (one buffer, one mesh, one primitive per
+// submesh). Destroy it using fpx3d_model_destroy_gltf()
+Fpx3d_E_Result fpx3d_model_mesh_to_gltf(const Fpx3d_Model_Mesh *mesh,
+                                        Fpx3d_Model_GltfAsset *output);
+
+#endif // FPX3D_MODEL_MESH_H
@@ -13,14 +13,6 @@
 
 #include "../../modules/cglm/include/cglm/types.h"
 
-struct _fpx3d_model_model {
-  size_t vertexCount;
-  Fpx3d_Model_Vertex *vertices;
-
-  size_t indexCount;
-  size_t *indices;
-};
-
 struct _fpx3d_model_vertex {
   vec3 position;
   vec3 color;
@@ -0,0 +1,38 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX3D_MODEL_OBJ_H
+#define FPX3D_MODEL_OBJ_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "../fpx3d.h"
+#include "./typedefs.h"
+
+struct fpx3d_model_obj_options {
+  Fpx3d_Model_E_MeshLayout layout;
+
+  // 0 means one thread per CPU
+  size_t threadCount;
+};
+
+// Wavefront OBJ to mesh. Polygons are triangulated as fans and every unique
+// v/vt/vn combination becomes one vertex. A new submesh starts at every
+// `usemtl`; its material is the index of that material name in order of
+// first use (-1 before the first `usemtl`).
+// Texture coordinates are flipped to match glTF (origin at the top left).
+// Files without faces come back as a point cloud: no indices, no submeshes.
+// `options` may be NULL
+Fpx3d_E_Result fpx3d_model_read_obj(const char *data, size_t length,
+                                    const struct fpx3d_model_obj_options *,
+                                    Fpx3d_Model_Mesh *output);
+
+// same as above, with the file at `path` mapped into memory
+Fpx3d_E_Result fpx3d_model_load_obj(const char *path,
+                                    const struct fpx3d_model_obj_options *,
+                                    Fpx3d_Model_Mesh *output);
+
+#endif // FPX3D_MODEL_OBJ_H
@@ -0,0 +1,35 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX3D_MODEL_PLY_H
+#define FPX3D_MODEL_PLY_H
+
+#include <stdint.h>
+#include <sys/types.h>
+
+#include "../fpx3d.h"
+#include "./typedefs.h"
+
+// binary (little or big endian) PLY to mesh. Vertex properties that are
+// picked up:
+//   x y z                 -> POSITION (required)
+//   nx ny nz              -> NORMAL
+//   u v / s t / texture_* -> TEXCOORD_0
+//   red green blue alpha  -> COLOR_0 (4x normalized UINT8)
+// Texture coordinates are flipped to match glTF (origin at the top left),
+// like the OBJ loader does.
+// Faces are triangulated as fans into a single submesh. Files without faces
+// come back as a point cloud: no indices, no submeshes.
+// Other elements are skipped
+Fpx3d_E_Result fpx3d_model_read_ply(const uint8_t *data, size_t length,
+                                    Fpx3d_Model_E_MeshLayout layout,
+                                    Fpx3d_Model_Mesh *output);
+
+// same as above, with the file at `path` mapped into memory
+Fpx3d_E_Result fpx3d_model_load_ply(const char *path,
+                                    Fpx3d_Model_E_MeshLayout layout,
+                                    Fpx3d_Model_Mesh *output);
+
+#endif // FPX3D_MODEL_PLY_H
@@ -6,13 +6,40 @@
 #ifndef FPX3D_MODEL_TYPEDEFS_H
 #define FPX3D_MODEL_TYPEDEFS_H
 
-typedef struct _fpx3d_model_model Fpx3d_Model_Model;
-
 // this is a default Vertex type.
 // The functions in other components (e.g. Vulkan) will allow you to specify
 // custom Vertex types for use in rendering and shading
 typedef struct _fpx3d_model_vertex Fpx3d_Model_Vertex;
 
+// -------------------- MESH --------------------
+typedef enum {
+  FPX3D_MODEL_LAYOUT_SOA = 0,
+  FPX3D_MODEL_LAYOUT_INTERLEAVED = 1,
+} Fpx3d_Model_E_MeshLayout;
+typedef enum {
+  FPX3D_MODEL_SEMANTIC_CUSTOM = 0,
+  FPX3D_MODEL_SEMANTIC_POSITION = 1,
+  FPX3D_MODEL_SEMANTIC_NORMAL = 2,
+  FPX3D_MODEL_SEMANTIC_TANGENT = 3,
+  FPX3D_MODEL_SEMANTIC_TEXCOORD = 4,
+  FPX3D_MODEL_SEMANTIC_COLOR = 5,
+  FPX3D_MODEL_SEMANTIC_JOINTS = 6,
+  FPX3D_MODEL_SEMANTIC_WEIGHTS = 7,
+} Fpx3d_Model_E_AttributeSemantic;
+typedef enum {
+  FPX3D_MODEL_FORMAT_INVALID = 0,
+  FPX3D_MODEL_FORMAT_FLOAT32 = 1,
+  FPX3D_MODEL_FORMAT_FLOAT16 = 2,
+  FPX3D_MODEL_FORMAT_SINT8 = 3,
+  FPX3D_MODEL_FORMAT_UINT8 = 4,
+  FPX3D_MODEL_FORMAT_SINT16 = 5,
+  FPX3D_MODEL_FORMAT_UINT16 = 6,
+  FPX3D_MODEL_FORMAT_UINT32 = 7,
+} Fpx3d_Model_E_ComponentFormat;
+
+typedef struct _fpx3d_model_mesh Fpx3d_Model_Mesh;
+// ----------------- END OF MESH ----------------
+
 // -------------------- GLTF --------------------
 typedef enum {
   FPX3D_GLTF_CONTAINER_INVALID = 0,
@@ -33,6 +60,23 @@ typedef enum {
   FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_INT = 5125,
   FPX3D_GLTF_COMPONENT_TYPE_FLOAT = 5126,
 } Fpx3d_Model_E_GltfComponentType;
+// the top-level arrays of a glTF description, in the order they are parsed
+typedef enum {
+  FPX3D_GLTF_ENTITY_SCENE = 0,
+  FPX3D_GLTF_ENTITY_CAMERA = 1,
+  FPX3D_GLTF_ENTITY_NODE = 2,
+  FPX3D_GLTF_ENTITY_MESH = 3,
+  FPX3D_GLTF_ENTITY_BUFFER = 4,
+  FPX3D_GLTF_ENTITY_BUFFER_VIEW = 5,
+  FPX3D_GLTF_ENTITY_ACCESSOR = 6,
+  FPX3D_GLTF_ENTITY_IMAGE = 7,
+  FPX3D_GLTF_ENTITY_SAMPLER = 8,
+  FPX3D_GLTF_ENTITY_TEXTURE = 9,
+  FPX3D_GLTF_ENTITY_MATERIAL = 10,
+  FPX3D_GLTF_ENTITY_SKIN = 11,
+  FPX3D_GLTF_ENTITY_ANIMATION = 12,
+  FPX3D_GLTF_ENTITY_TYPE_COUNT,
+} Fpx3d_Model_E_GltfEntityType;
 
 typedef struct _fpx3d_model_gltf_scene Fpx3d_Model_GltfScene;
 typedef struct _fpx3d_model_gltf_camera Fpx3d_Model_GltfCamera;
@@ -52,6 +96,9 @@ typedef struct _fpx3d_model_gltf_asset_description
     Fpx3d_Model_GltfAssetDescription;
 
 typedef struct _fpx3d_model_gltf_asset Fpx3d_Model_GltfAsset;
+typedef struct _fpx3d_model_glb_file Fpx3d_Model_GlbFile;
+
+typedef struct _fpx3d_model_gltf_instances Fpx3d_Model_GltfInstances;
 // ----------------- END OF GLTF ----------------
 
 #endif // FPX3D_MODEL_TYPEDEFS_H
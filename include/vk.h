@@ -21,18 +21,28 @@
 
 #include "vk/typedefs.h"
 
+#include "vk/allocator.h"
 #include "vk/buffer.h"
+#include "vk/capabilities.h"
 #include "vk/command.h"
 #include "vk/context.h"
 #include "vk/descriptors.h"
+#include "vk/gltf_textures.h"
+#include "vk/hot_reload.h"
 #include "vk/image.h"
 #include "vk/logical_gpu.h"
+#include "vk/mesh_arena.h"
 #include "vk/pipeline.h"
 #include "vk/queues.h"
 #include "vk/renderpass.h"
+#include "vk/residency.h"
+#include "vk/resource_cache.h"
 #include "vk/shaders.h"
 #include "vk/shape.h"
+#include "vk/streaming.h"
 #include "vk/swapchain.h"
+#include "vk/texture_compression.h"
+#include "vk/upload.h"
 #include "vk/vertex.h"
 
 #include "vk/utility.h"
@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_ALLOCATOR_H
+#define FPX_VK_ALLOCATOR_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../fpx3d.h"
+
+#include "./typedefs.h"
+
+struct fpx3d_vk_memory_block;
+struct fpx3d_vk_memory_node;
+
+// where a buffer or image lives: a range of a large VkDeviceMemory block
+// that it shares with other resources, or (for large resources) memory of
+// its own
+struct _fpx3d_vk_allocation {
+  VkDeviceMemory memory;
+  VkDeviceSize offset;
+  VkDeviceSize size;
+
+  // start of the range if the memory is host-visible, NULL otherwise.
+  // Stays mapped for as long as the allocation lives
+  void *mapped;
+
+  // of the memory type. Without HOST_COHERENT, host writes through
+  // `mapped` have to be flushed before the device gets to see them
+  VkMemoryPropertyFlags propertyFlags;
+
+  // internal, don't touch. Both NULL for dedicated allocations
+  struct fpx3d_vk_memory_block *block;
+  struct fpx3d_vk_memory_node *node;
+};
+
+struct _fpx3d_vk_allocator_stats {
+  // VkDeviceMemory objects that the allocator carves up, and their size
+  size_t blockCount;
+  VkDeviceSize blockBytes;
+
+  // resources that got a VkDeviceMemory of their own
+  size_t dedicatedCount;
+  VkDeviceSize dedicatedBytes;
+
+  // live allocations, dedicated ones included, and the bytes they take up
+  size_t allocationCount;
+  VkDeviceSize allocatedBytes;
+};
+
+// every buffer and image of the logical GPU goes through its allocator,
+// so this says how many vkAllocateMemory() calls are live right now
+// (blockCount + dedicatedCount)
+Fpx3d_E_Result fpx3d_vk_get_allocator_stats(Fpx3d_Vk_LogicalGpu *,
+                                            Fpx3d_Vk_AllocatorStats *output);
+
+#endif // FPX_VK_ALLOCATOR_H
@@ -8,6 +8,7 @@
 
 #include <stdbool.h>
 
+#include "./allocator.h"
 #include "./typedefs.h"
 
 struct _fpx3d_vk_buffer {
@@ -15,8 +16,13 @@ struct _fpx3d_vk_buffer {
   size_t stride;
 
   VkBuffer buffer;
+
+  // the range of device memory behind `buffer`; `memory` is the same as
+  // allocation.memory, and the buffer starts at allocation.offset in it
+  Fpx3d_Vk_Allocation allocation;
   VkDeviceMemory memory;
 
+  // set for host-visible buffers, which stay mapped until destroyed
   void *mapped_memory;
 
   VkSharingMode sharingMode;
@@ -24,4 +30,12 @@ struct _fpx3d_vk_buffer {
   bool isValid;
 };
 
+// part of the staging ring of a logical GPU (see `vk/staging.c`). Write
+// the data to `mapped`, and copy it from `offset` in `buffer`
+struct fpx3d_vk_staging_region {
+  VkBuffer buffer;
+  VkDeviceSize offset;
+  void *mapped;
+};
+
 #endif // FPX_VK_BUFFER_H
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_CAPABILITIES_H
+#define FPX_VK_CAPABILITIES_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../fpx3d.h"
+
+#include "./typedefs.h"
+
+// every format of core Vulkan 1.0. Their properties are part of the
+// snapshot; formats from extensions are queried when asked about
+#define FPX3D_VK_CORE_FORMAT_COUNT (VK_FORMAT_ASTC_12x12_SRGB_BLOCK + 1)
+
+// what a physical device can do, queried once when the GPU is picked. If
+// the context has a capabilityCacheDirectory, the snapshot is stored
+// there, and the next run on the same device and driver reads it back
+// instead of asking the driver again
+struct _fpx3d_vk_capabilities {
+  VkPhysicalDevice device;
+
+  // always from the driver; its IDs decide whether a cached snapshot is
+  // still any good. The limits are in here
+  VkPhysicalDeviceProperties properties;
+
+  VkPhysicalDeviceFeatures features;
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+
+  VkQueueFamilyProperties *queueFamilies;
+  uint32_t queueFamilyCount;
+
+  VkExtensionProperties *extensions;
+  uint32_t extensionCount;
+
+  // hash set over `extensions`: index + 1 of the extension, 0 if empty
+  uint32_t *extensionSet;
+  size_t extensionSetCapacity;
+
+  VkFormatProperties formats[FPX3D_VK_CORE_FORMAT_COUNT];
+
+  // true if everything but `properties` came from the cache
+  bool fromCache;
+
+  bool isValid;
+};
+
+// the snapshot of the context's physical GPU. Taken by
+// fpx3d_vk_select_gpu(), or here if the GPU was set some other way.
+// NULL without a physical GPU
+const Fpx3d_Vk_Capabilities *fpx3d_vk_get_capabilities(Fpx3d_Vk_Context *);
+
+bool fpx3d_vk_capabilities_have_extensions(const Fpx3d_Vk_Capabilities *,
+                                           const char **extensions,
+                                           size_t extension_count);
+
+VkFormatProperties fpx3d_vk_capabilities_format(const Fpx3d_Vk_Capabilities *,
+                                                VkFormat);
+
+#endif // FPX_VK_CAPABILITIES_H
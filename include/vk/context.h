@@ -9,6 +9,7 @@
 #include "../fpx3d.h"
 #include "../window/window.h"
 
+#include "./capabilities.h"
 #include "./typedefs.h"
 
 struct _fpx3d_vk_context {
@@ -19,6 +20,11 @@ struct _fpx3d_vk_context {
 
   VkPhysicalDevice physicalGpu;
 
+  // snapshot of what physicalGpu supports; see `vk/capabilities.h`.
+  // Set capabilityCacheDirectory before picking a GPU to keep it on disk
+  Fpx3d_Vk_Capabilities capabilities;
+  const char *capabilityCacheDirectory;
+
   Fpx3d_Vk_LogicalGpu *logicalGpus;
   size_t logicalGpuCapacity;
 
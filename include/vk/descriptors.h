@@ -47,6 +47,10 @@ struct _fpx3d_vk_descriptor_set {
 
   Fpx3d_Vk_Buffer buffer;
 
+  // the part of the binding data that changed since it was last written
+  // to `buffer`; empty if dirtyStart == dirtyEnd
+  size_t dirtyStart, dirtyEnd;
+
   bool isValid;
 };
 
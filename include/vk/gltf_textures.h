@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_GLTF_TEXTURES_H
+#define FPX_VK_GLTF_TEXTURES_H
+
+#include <stddef.h>
+
+#include "../fpx3d.h"
+#include "../model/gltf.h"
+#include "../model/typedefs.h"
+
+#include "./image.h"
+#include "./texture_compression.h"
+#include "./typedefs.h"
+
+struct _fpx3d_vk_gltf_textures {
+  // one per image of the asset. Images that no texture uses, or that
+  // could not be decoded, are left zeroed (isValid == false)
+  Fpx3d_Vk_Image *images;
+  size_t imageCount;
+
+  // one per distinct sampler configuration, not one per glTF sampler
+  Fpx3d_Vk_ImageSampler *samplers;
+  size_t samplerCount;
+
+  // one per texture of the asset, pointing into the arrays above
+  Fpx3d_Vk_Texture *textures;
+  size_t textureCount;
+};
+
+// decodes every image used by a texture of `asset` on a pool of worker
+// threads (0 means one per CPU), then uploads them as sampled RGBA8
+// textures. Image URIs are resolved relative to `base_directory`, which
+// may be NULL. Textures of lazily parsed assets are required first; for
+// a Fpx3d_Model_GlbFile, load the textures through fpx3d_model_glb_load()
+Fpx3d_E_Result fpx3d_vk_import_gltf_textures(Fpx3d_Model_GltfAsset *asset,
+                                             const char *base_directory,
+                                             size_t thread_count,
+                                             Fpx3d_Vk_Context *,
+                                             Fpx3d_Vk_LogicalGpu *,
+                                             Fpx3d_Vk_GltfTextures *output);
+
+// the same, but every image is block compressed on the worker threads
+// before it is uploaded. Images that a material uses as its normal map
+// are compressed to BC5 whatever `config` says. Images that fail to
+// compress are uploaded as RGBA8
+Fpx3d_E_Result fpx3d_vk_import_gltf_textures_compressed(
+    Fpx3d_Model_GltfAsset *asset, const char *base_directory,
+    size_t thread_count, const Fpx3d_Vk_CompressionConfig *config,
+    Fpx3d_Vk_Context *, Fpx3d_Vk_LogicalGpu *, Fpx3d_Vk_GltfTextures *output);
+
+Fpx3d_E_Result fpx3d_vk_destroy_gltf_textures(Fpx3d_Vk_GltfTextures *,
+                                              Fpx3d_Vk_LogicalGpu *);
+
+#endif // FPX_VK_GLTF_TEXTURES_H
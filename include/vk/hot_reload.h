@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_HOT_RELOAD_H
+#define FPX_VK_HOT_RELOAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../fpx3d.h"
+
+#include "./image.h"
+#include "./resource_cache.h"
+#include "./shaders.h"
+#include "./streaming.h"
+#include "./typedefs.h"
+
+struct fpx3d_vk_hot_reload_shared;
+struct fpx3d_vk_hot_retired;
+
+// called from fpx3d_vk_hot_reload_update() once the asset first loaded,
+// and every time changed content was swapped in after that. Rebuild
+// whatever refers to the old content here (shapes, descriptor sets,
+// shader modules and pipelines)
+typedef void (*Fpx3d_Vk_HotReloadCallback)(Fpx3d_Vk_HotAsset *,
+                                           void *user_data);
+
+struct _fpx3d_vk_hot_asset {
+  Fpx3d_Vk_E_HotAssetType type;
+
+  // the live content, zeroed until the file first loaded
+  union {
+    Fpx3d_Vk_StreamHandle *gltf;
+    Fpx3d_Vk_Image image;
+    Fpx3d_Vk_SpirvFile spirv;
+  };
+
+  // bumped every time new content is swapped in
+  size_t generation;
+
+  // internal, don't touch
+
+  char *path;
+  const char *fileName;
+  int watch;
+
+  Fpx3d_Vk_E_ShaderStage stage;
+
+  Fpx3d_Vk_HotReloadCallback callback;
+  void *userData;
+
+  // only touched by the watcher thread (after the asset was added)
+  uint64_t contentHash;
+  int64_t modifiedTime;
+  int64_t fileSize;
+
+  // guarded by the reloader's lock
+  bool dirty;
+  bool busy;
+  bool orphaned;
+
+  bool changed;
+  uint8_t *pixels;
+  uint32_t width, height;
+  Fpx3d_Vk_SpirvFile pendingSpirv;
+
+  // only touched by the thread calling fpx3d_vk_hot_reload_update()
+  Fpx3d_Vk_StreamHandle *pendingGltf;
+
+  Fpx3d_Vk_HotAsset *next;
+};
+
+// watches the files of the assets it loaded (inotify on Linux, polling
+// their modification time elsewhere). Changed files are read and decoded
+// in the background; glTF/GLB files go through a streamer with a
+// resource cache, so only meshes and images whose content hash changed
+// are uploaded again. New content is swapped in by
+// fpx3d_vk_hot_reload_update(), and the old content is destroyed once
+// the frames that were in flight at that point are done
+struct _fpx3d_vk_hot_reloader {
+  Fpx3d_Vk_Context *context;
+  Fpx3d_Vk_LogicalGpu *logicalGpu;
+
+  Fpx3d_Vk_Streamer streamer;
+
+  // created if the streamer config didn't come with a cache
+  Fpx3d_Vk_ResourceCache *ownCache;
+
+  // content waiting for the frames in flight, oldest first
+  struct fpx3d_vk_hot_retired *retired;
+
+  // times content was replaced (first loads not included)
+  size_t reloadCount;
+
+  struct fpx3d_vk_hot_reload_shared *shared;
+};
+
+// `config` configures the glTF streamer and may be NULL. `ctx` and `lgpu`
+// have to outlive the reloader
+Fpx3d_E_Result
+fpx3d_vk_create_hot_reloader(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
+                             const Fpx3d_Vk_StreamerConfig *config,
+                             Fpx3d_Vk_HotReloader *output);
+
+// wait for the device to be idle first
+Fpx3d_E_Result fpx3d_vk_destroy_hot_reloader(Fpx3d_Vk_HotReloader *);
+
+// the files are loaded in the background, like every change after that.
+// The assets belong to the reloader; call these from the same thread as
+// fpx3d_vk_hot_reload_update()
+Fpx3d_E_Result fpx3d_vk_hot_reload_gltf(Fpx3d_Vk_HotReloader *,
+                                        const char *path,
+                                        Fpx3d_Vk_HotReloadCallback callback,
+                                        void *user_data,
+                                        Fpx3d_Vk_HotAsset **output);
+Fpx3d_E_Result fpx3d_vk_hot_reload_image(Fpx3d_Vk_HotReloader *,
+                                         const char *path,
+                                         Fpx3d_Vk_HotReloadCallback callback,
+                                         void *user_data,
+                                         Fpx3d_Vk_HotAsset **output);
+Fpx3d_E_Result fpx3d_vk_hot_reload_spirv(Fpx3d_Vk_HotReloader *,
+                                         const char *path,
+                                         Fpx3d_Vk_E_ShaderStage stage,
+                                         Fpx3d_Vk_HotReloadCallback callback,
+                                         void *user_data,
+                                         Fpx3d_Vk_HotAsset **output);
+
+// stops watching the file; its content is destroyed once it is no longer
+// in flight. Don't use the asset afterwards
+Fpx3d_E_Result fpx3d_vk_hot_reload_remove(Fpx3d_Vk_HotReloader *,
+                                          Fpx3d_Vk_HotAsset *);
+
+// call once per frame, before recording. Uploads (within the streamer's
+// budget) and swaps in whatever finished loading, calls the callbacks
+// and destroys retired content that is no longer in flight
+Fpx3d_E_Result fpx3d_vk_hot_reload_update(Fpx3d_Vk_HotReloader *);
+
+#endif // FPX_VK_HOT_RELOAD_H
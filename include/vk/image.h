@@ -8,6 +8,7 @@
 
 #include "../fpx3d.h"
 
+#include "./allocator.h"
 #include "./typedefs.h"
 
 struct _fpx3d_vk_image_dimensions {
@@ -28,17 +29,25 @@ struct _fpx3d_vk_image {
   size_t (*sizeInBytes)(Fpx3d_Vk_Image *);
 
   VkImage image;
+  Fpx3d_Vk_Allocation allocation;
   VkDeviceMemory memory;
 
   VkImageView imageView;
 
   VkFormat imageFormat;
 
+  // FPX3D_VK_BLOCK_NONE, unless the image holds compressed blocks
+  Fpx3d_Vk_E_BlockFormat blockFormat;
+
   VkImageSubresourceRange subresourceRange;
 
   VkImageLayout imageLayout;
   bool isReadOnly;
 
+  // made with VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT, so the first fill can
+  // skip staging (see fpx3d_vk_fill_image())
+  bool hostTransfer;
+
   bool isValid;
 };
 
@@ -57,6 +66,18 @@ Fpx3d_Vk_Image
 fpx3d_vk_create_texture_image(Fpx3d_Vk_Context *, Fpx3d_Vk_LogicalGpu *,
                               Fpx3d_Vk_ImageDimensions dimensions);
 
+// the device has to have been created with the textureCompressionBC
+// feature enabled. BC5 has no sRGB variant, so `srgb` is ignored for it
+Fpx3d_Vk_Image fpx3d_vk_create_compressed_texture_image(
+    Fpx3d_Vk_Context *, Fpx3d_Vk_LogicalGpu *, uint32_t width, uint32_t height,
+    Fpx3d_Vk_E_BlockFormat format, bool srgb);
+
+// `data` holds fpx3d_vk_get_image_size_bytes() bytes: pixels, or blocks
+// (like Fpx3d_Vk_CompressedImage::blocks) for compressed images
+//
+// the first fill of an image with `hostTransfer` set is copied on the host
+// right away, without staging memory or a submission, and leaves it
+// read-only already
 Fpx3d_E_Result fpx3d_vk_fill_image(Fpx3d_Vk_Image *, Fpx3d_Vk_Context *,
                                    Fpx3d_Vk_LogicalGpu *, void *data);
 
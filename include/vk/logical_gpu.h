@@ -14,6 +14,9 @@
 #include "./swapchain.h"
 #include "./typedefs.h"
 
+struct fpx3d_vk_allocator;
+struct fpx3d_vk_staging_ring;
+
 struct _fpx3d_vk_lgpu {
   VkDevice handle;
   VkPhysicalDeviceFeatures features;
@@ -48,7 +51,28 @@ struct _fpx3d_vk_lgpu {
   Fpx3d_Vk_CommandPool inFlightCommandPool;
   VkFence *inFlightFences;
 
+  // for every fence, frameIndex + 1 of the frame last submitted with it,
+  // or 0 while it has nothing to signal: before the first frame, and
+  // between being reset and the submission of the next
+  uint64_t *inFlightFrames;
+
   uint16_t frameCounter;
+
+  // how many frames have been submitted so far; unlike frameCounter it
+  // never wraps, so it can date when something was last drawn
+  uint64_t frameIndex;
+
+  // hands out device memory to every buffer and image made on this logical
+  // GPU (see `vk/allocator.c`)
+  struct fpx3d_vk_allocator *allocator;
+
+  // host-visible memory that uploads are copied through, made on the
+  // first upload (see `vk/staging.c`)
+  struct fpx3d_vk_staging_ring *stagingRing;
+
+  // VK_EXT_host_image_copy is enabled; textures that support it are
+  // filled straight from host memory (see `vk/image.c`)
+  bool hostImageCopy;
 };
 
 Fpx3d_E_Result fpx3d_vk_allocate_logicalgpus(Fpx3d_Vk_Context *, size_t amount);
@@ -0,0 +1,78 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_MESH_ARENA_H
+#define FPX_VK_MESH_ARENA_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "../fpx3d.h"
+
+#include "./shape.h"
+#include "./typedefs.h"
+#include "./upload.h"
+#include "./vertex.h"
+
+struct fpx3d_vk_mesh_arena_chunk;
+
+// a few large device-local vertex and index buffers that shape buffers
+// take ranges of, instead of having buffers of their own. Shapes of the
+// same arena are drawn without binding anything in between. The arena
+// gets another pair of buffers when the ones it has are full, and never
+// gives them back before it is destroyed.
+// Not thread-safe; use it from the thread that does the uploads
+struct _fpx3d_vk_mesh_arena {
+  Fpx3d_Vk_LogicalGpu *logicalGpu;
+  VkPhysicalDevice physicalGpu;
+
+  // size of every buffer, unless a mesh needs a bigger one
+  VkDeviceSize chunkSize;
+
+  // ranges of destroyed shape buffers are handed out again once this many
+  // more frames have been drawn
+  size_t framesInFlight;
+
+  struct fpx3d_vk_mesh_arena_chunk **vertexChunks;
+  size_t vertexChunkCount;
+
+  struct fpx3d_vk_mesh_arena_chunk **indexChunks;
+  size_t indexChunkCount;
+
+  // shape buffers that hold a range of the arena
+  size_t shapeBufferCount;
+
+  bool isValid;
+};
+
+// a `chunk_size` of 0 picks the default (16 MB). No buffers are made
+// before the first shape buffer. The arena must stay where it is for as
+// long as shape buffers use it
+Fpx3d_E_Result fpx3d_vk_create_mesh_arena(Fpx3d_Vk_Context *,
+                                          Fpx3d_Vk_LogicalGpu *,
+                                          VkDeviceSize chunk_size,
+                                          Fpx3d_Vk_MeshArena *output);
+
+// destroy its shape buffers first, and wait for the device to be idle
+Fpx3d_E_Result fpx3d_vk_destroy_mesh_arena(Fpx3d_Vk_MeshArena *);
+
+// like fpx3d_vk_create_shapebuffer(), but the vertices and indices go into
+// ranges of the arena. Waits until the upload is done. Destroy it with
+// fpx3d_vk_destroy_shapebuffer(); its ranges are reused once the frames in
+// flight that may still draw it are done
+Fpx3d_E_Result fpx3d_vk_create_arena_shapebuffer(Fpx3d_Vk_MeshArena *,
+                                                 Fpx3d_Vk_VertexBundle *,
+                                                 Fpx3d_Vk_ShapeBuffer *output);
+
+// records the uploads into the batch instead (see
+// fpx3d_vk_batch_create_shapebuffer()). The batch has to be of the
+// arena's logical GPU
+Fpx3d_E_Result
+fpx3d_vk_batch_create_arena_shapebuffer(Fpx3d_Vk_UploadBatch *,
+                                        Fpx3d_Vk_MeshArena *,
+                                        Fpx3d_Vk_VertexBundle *,
+                                        Fpx3d_Vk_ShapeBuffer *output);
+
+#endif // FPX_VK_MESH_ARENA_H
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_RESIDENCY_H
+#define FPX_VK_RESIDENCY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../fpx3d.h"
+
+#include "./image.h"
+#include "./shape.h"
+#include "./typedefs.h"
+#include "./vertex.h"
+
+// keeps a CPU copy of every mesh and image it is given, and only as many
+// of them on the GPU as fit in a device memory budget. Whatever has not
+// been used for the longest gets evicted once the GPU is done with it,
+// and is uploaded again the next time it is needed.
+// Not thread-safe; use it from the thread that records and submits
+struct _fpx3d_vk_residency {
+  Fpx3d_Vk_Context *context;
+  Fpx3d_Vk_LogicalGpu *logicalGpu;
+
+  size_t budgetBytes;
+  size_t residentBytes;
+
+  Fpx3d_Vk_Resident **entries;
+  size_t entryCount;
+  size_t entryCapacity;
+
+  size_t evictions;
+  size_t uploads;
+};
+
+// a budget of 0 picks 3/4 of the largest device-local memory heap
+Fpx3d_E_Result fpx3d_vk_create_residency(Fpx3d_Vk_Context *,
+                                         Fpx3d_Vk_LogicalGpu *,
+                                         size_t budget_bytes,
+                                         Fpx3d_Vk_Residency *output);
+
+// wait for the device to be idle first
+Fpx3d_E_Result fpx3d_vk_destroy_residency(Fpx3d_Vk_Residency *);
+
+// the data is copied, so the bundle can be freed afterwards. It is
+// uploaded right away if it fits in the budget, on first use otherwise
+Fpx3d_E_Result fpx3d_vk_residency_add_vertices(Fpx3d_Vk_Residency *,
+                                               const Fpx3d_Vk_VertexBundle *,
+                                               Fpx3d_Vk_Resident **output);
+
+// `pixels` holds width * height * channels * channelWidth bytes
+Fpx3d_E_Result fpx3d_vk_residency_add_image(Fpx3d_Vk_Residency *,
+                                            Fpx3d_Vk_ImageDimensions,
+                                            const void *pixels,
+                                            Fpx3d_Vk_Resident **output);
+
+// destroys the resource right away, so make sure no frame in flight
+// still uses it
+Fpx3d_E_Result fpx3d_vk_residency_remove(Fpx3d_Vk_Residency *,
+                                         Fpx3d_Vk_Resident *);
+
+// stable for the lifetime of the resident; build shapes from it. Drawing
+// such a shape marks it as used, and skips it while it is evicted
+const Fpx3d_Vk_ShapeBuffer *
+fpx3d_vk_resident_shapebuffer(const Fpx3d_Vk_Resident *);
+
+// marks an image as used this frame, uploading it first if it was
+// evicted. `reuploaded` is set if the image (and its view) changed, in
+// which case descriptor sets sampling it have to be written again
+Fpx3d_E_Result fpx3d_vk_residency_use_image(Fpx3d_Vk_Residency *,
+                                            Fpx3d_Vk_Resident *,
+                                            Fpx3d_Vk_Image **output,
+                                            bool *reuploaded);
+
+// call once per frame, before recording. Uploads the meshes that were
+// drawn while evicted, evicting least recently used resources that are
+// no longer in flight to make room in the budget
+Fpx3d_E_Result fpx3d_vk_residency_update(Fpx3d_Vk_Residency *);
+
+#endif // FPX_VK_RESIDENCY_H
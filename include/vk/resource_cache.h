@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_RESOURCE_CACHE_H
+#define FPX_VK_RESOURCE_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../fpx3d.h"
+
+#include "./image.h"
+#include "./shape.h"
+#include "./typedefs.h"
+#include "./vertex.h"
+
+struct fpx3d_vk_cache_entry;
+
+// identifies content: a 64-bit XXH64 digest of the bytes and their
+// format, plus the amount of bytes
+struct _fpx3d_vk_cache_key {
+  uint64_t hash;
+  size_t size;
+};
+
+// hands out shared, reference counted GPU resources, so identical
+// content only gets uploaded once. Not thread-safe; use it from the
+// thread that does the uploads
+struct _fpx3d_vk_resource_cache {
+  Fpx3d_Vk_Context *context;
+  Fpx3d_Vk_LogicalGpu *logicalGpu;
+
+  // open addressing with linear probing, keyed by content hash
+  struct fpx3d_vk_cache_entry *entries;
+  size_t capacity;
+  size_t count;
+
+  // requests that were served without an upload, and those that weren't
+  size_t hits;
+  size_t misses;
+};
+
+Fpx3d_E_Result fpx3d_vk_create_resource_cache(Fpx3d_Vk_Context *,
+                                              Fpx3d_Vk_LogicalGpu *,
+                                              Fpx3d_Vk_ResourceCache *output);
+
+// destroys every resource, whether it is still referenced or not
+Fpx3d_E_Result fpx3d_vk_destroy_resource_cache(Fpx3d_Vk_ResourceCache *);
+
+// keys are cheap to compute next to the data (e.g. on a loader thread)
+// and can be handed to the functions below later on
+Fpx3d_Vk_CacheKey fpx3d_vk_cache_key_vertices(const Fpx3d_Vk_VertexBundle *);
+Fpx3d_Vk_CacheKey fpx3d_vk_cache_key_image(Fpx3d_Vk_ImageDimensions,
+                                           const void *pixels);
+
+// `output` receives a copy of the shared shape buffer; return it using
+// fpx3d_vk_cache_release_shapebuffer() instead of destroying it
+Fpx3d_E_Result fpx3d_vk_cache_shapebuffer(Fpx3d_Vk_ResourceCache *,
+                                          Fpx3d_Vk_CacheKey key,
+                                          Fpx3d_Vk_VertexBundle *,
+                                          Fpx3d_Vk_ShapeBuffer *output);
+
+// uploads `pixels` as a shader-readonly texture image if its content isn't
+// cached yet. Return it using fpx3d_vk_cache_release_image()
+Fpx3d_E_Result fpx3d_vk_cache_texture_image(Fpx3d_Vk_ResourceCache *,
+                                            Fpx3d_Vk_CacheKey key,
+                                            Fpx3d_Vk_ImageDimensions,
+                                            const void *pixels,
+                                            Fpx3d_Vk_Image *output);
+
+// like the two above, but the upload of content that isn't cached yet is
+// recorded into the batch instead of waited for. Hits on it can't be drawn
+// before the batch is submitted either. If the batch gets discarded,
+// release every copy handed out since it was begun
+Fpx3d_E_Result fpx3d_vk_cache_batch_shapebuffer(Fpx3d_Vk_ResourceCache *,
+                                                Fpx3d_Vk_UploadBatch *,
+                                                Fpx3d_Vk_CacheKey key,
+                                                Fpx3d_Vk_VertexBundle *,
+                                                Fpx3d_Vk_ShapeBuffer *output);
+Fpx3d_E_Result fpx3d_vk_cache_batch_texture_image(Fpx3d_Vk_ResourceCache *,
+                                                  Fpx3d_Vk_UploadBatch *,
+                                                  Fpx3d_Vk_CacheKey key,
+                                                  Fpx3d_Vk_ImageDimensions,
+                                                  const void *pixels,
+                                                  Fpx3d_Vk_Image *output);
+
+// drops one reference (and zeroes the copy). The last one destroys the
+// resource
+Fpx3d_E_Result fpx3d_vk_cache_release_shapebuffer(Fpx3d_Vk_ResourceCache *,
+                                                  Fpx3d_Vk_ShapeBuffer *);
+Fpx3d_E_Result fpx3d_vk_cache_release_image(Fpx3d_Vk_ResourceCache *,
+                                            Fpx3d_Vk_Image *);
+
+#endif // FPX_VK_RESOURCE_CACHE_H
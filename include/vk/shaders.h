@@ -53,6 +53,14 @@ Fpx3d_Vk_SpirvFile fpx3d_vk_read_spirv_data(const uint8_t *spirv_bytes,
                                             Fpx3d_Vk_E_ShaderStage stage);
 Fpx3d_Vk_SpirvFile fpx3d_vk_read_spirv_file(const char *filename,
                                             Fpx3d_Vk_E_ShaderStage stage);
+
+// reads all files with one batch of reads, which beats reading them one
+// by one when there are many. Files that couldn't be read (or aren't
+// SPIR-V) are zeroed in `output`; the first error is returned
+Fpx3d_E_Result fpx3d_vk_read_spirv_files(const char *const *filenames,
+                                         const Fpx3d_Vk_E_ShaderStage *stages,
+                                         size_t count,
+                                         Fpx3d_Vk_SpirvFile *output);
 Fpx3d_E_Result fpx3d_vk_destroy_spirv_file(Fpx3d_Vk_SpirvFile *);
 
 Fpx3d_E_Result fpx3d_vk_load_shadermodules(Fpx3d_Vk_SpirvFile *spirv_files,
@@ -7,6 +7,7 @@
 #define FPX_VK_SHAPE_H
 
 #include <stdbool.h>
+#include <stdint.h>
 
 #include "../fpx3d.h"
 
@@ -20,9 +21,51 @@ struct _fpx3d_vk_shapebuffer {
   // want to use the vertices as-is, instead of ordering them using an index
   // buffer
   Fpx3d_Vk_Buffer indexBuffer;
+
+  // set if a Fpx3d_Vk_Residency owns this shape buffer; drawing it then
+  // counts as using it
+  struct fpx3d_vk_residency_entry *residency;
+
+  // Fpx3d_Vk_LogicalGpu::frameIndex + 1 of the last frame that drew the
+  // shape buffer, or 0 if none did. Writes into it only wait for that frame
+  // and the ones before it, not for frames submitted since
+  uint64_t lastDrawnFrame;
+
+  // set if the shape buffer was made in a Fpx3d_Vk_MeshArena. The two
+  // buffers above are then the arena's, of which it only owns a range
+  Fpx3d_Vk_MeshArena *arena;
+  struct fpx3d_vk_mesh_arena_chunk *vertexChunk;
+  struct fpx3d_vk_mesh_arena_chunk *indexChunk;
+
+  // where the shape starts in the buffers, in vertices and indices. Both
+  // are 0 for shape buffers with buffers of their own
+  int32_t vertexOffset;
+  uint32_t firstIndex;
+
+  // set if the shape buffer was made with
+  // fpx3d_vk_create_dynamic_shapebuffer(); the buffers above then hold a
+  // slice for every frame in flight
+  struct fpx3d_vk_dynamic_geometry *dynamic;
 }; // added to the Pipeline struct after that Pipeline has
    // already been created
 
+// where the vertices (and the indices, if any) of a shape sit in a file,
+// exactly as the GPU should get them
+struct _fpx3d_vk_shape_file_layout {
+  const char *path;
+
+  size_t vertexOffset;
+  size_t vertexCount;
+  size_t vertexDataSize;
+
+  // uint32_t indices; an indexCount of 0 means there are none
+  size_t indexOffset;
+  size_t indexCount;
+
+  // staging memory to stream through, 0 for the default (a few MB)
+  size_t windowSize;
+};
+
 struct _fpx3d_vk_shape {
   const Fpx3d_Vk_ShapeBuffer *shapeBuffer;
 
@@ -38,6 +81,56 @@ Fpx3d_E_Result fpx3d_vk_create_shapebuffer(Fpx3d_Vk_Context *,
                                            Fpx3d_Vk_LogicalGpu *,
                                            Fpx3d_Vk_VertexBundle *,
                                            Fpx3d_Vk_ShapeBuffer *output);
+
+// records the uploads of the vertices and indices into the batch; the shape
+// buffer can't be drawn before the batch is submitted, and isn't filled in
+// before it's done. Destroy the shape buffer if the batch gets discarded
+Fpx3d_E_Result fpx3d_vk_batch_create_shapebuffer(Fpx3d_Vk_UploadBatch *,
+                                                 Fpx3d_Vk_VertexBundle *,
+                                                 Fpx3d_Vk_ShapeBuffer *output);
+
+// streams the data from the file into device-local buffers through a small
+// double-buffered staging window, so it never has to fit in host memory
+// as a whole. Waits until the copies are done
+Fpx3d_E_Result
+fpx3d_vk_create_shapebuffer_from_file(Fpx3d_Vk_Context *,
+                                      Fpx3d_Vk_LogicalGpu *,
+                                      const Fpx3d_Vk_ShapeFileLayout *,
+                                      Fpx3d_Vk_ShapeBuffer *output);
+
+// for geometry that changes often, like every frame. The buffers stay in
+// host-visible memory, with room for `max_vertices` vertices and
+// `max_indices` indices for every frame in flight, so no frame has to wait
+// for another to be done with its geometry. The shape buffer reads from
+// `source` whenever it needs to, so that has to stay where it is until the
+// shape buffer is destroyed; its counts can change, its vertex size can't
+Fpx3d_E_Result fpx3d_vk_create_dynamic_shapebuffer(
+    Fpx3d_Vk_Context *, Fpx3d_Vk_LogicalGpu *,
+    const Fpx3d_Vk_VertexBundle *source, size_t max_vertices,
+    size_t max_indices, Fpx3d_Vk_ShapeBuffer *output);
+
+// call after changing vertices or indices of the source (or how many there
+// are); a count of SIZE_MAX means up to the end. The changes are written
+// into the slice of the next frame to be drawn right away, and into the
+// other slices when their frames come around. Returns
+// FPX3D_INDEX_OUT_OF_RANGE_ERROR if the source doesn't fit anymore
+Fpx3d_E_Result fpx3d_vk_update_shapebuffer(Fpx3d_Vk_LogicalGpu *,
+                                           Fpx3d_Vk_ShapeBuffer *,
+                                           size_t first_vertex,
+                                           size_t vertex_count,
+                                           size_t first_index,
+                                           size_t index_count);
+
+// records writes of `vertex_count` vertices into the shape buffer, from
+// vertex `first_vertex` on, and likewise for the indices; either count can
+// be 0. The rest stays as it is, and frames submitted after the batch draw
+// the new contents. Dynamic shape buffers are updated with
+// fpx3d_vk_update_shapebuffer() instead
+Fpx3d_E_Result fpx3d_vk_batch_update_shapebuffer(
+    Fpx3d_Vk_UploadBatch *, Fpx3d_Vk_ShapeBuffer *, size_t first_vertex,
+    const void *vertices, size_t vertex_count, size_t first_index,
+    const uint32_t *indices, size_t index_count);
+
 Fpx3d_E_Result fpx3d_vk_destroy_shapebuffer(Fpx3d_Vk_LogicalGpu *,
                                             Fpx3d_Vk_ShapeBuffer *);
 
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_STREAMING_H
+#define FPX_VK_STREAMING_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../fpx3d.h"
+#include "../model/gltf.h"
+
+#include "./gltf_textures.h"
+#include "./resource_cache.h"
+#include "./shape.h"
+#include "./typedefs.h"
+#include "./vertex.h"
+
+struct fpx3d_vk_stream_shared;
+struct fpx3d_vk_stream_upload;
+
+// called from fpx3d_vk_streamer_update() once a handle is READY or FAILED
+typedef void (*Fpx3d_Vk_StreamCallback)(Fpx3d_Vk_StreamHandle *,
+                                        void *user_data);
+
+struct _fpx3d_vk_streamer_config {
+  // threads that read, parse and decode assets (0 means one per CPU).
+  // Every asset is handled by a single worker, so several assets stream
+  // in parallel
+  size_t workerCount;
+
+  // per call to fpx3d_vk_streamer_update(), recording uploads stops once
+  // either limit is reached (0 means no limit). At least one mesh or image
+  // is recorded per call, so anything bigger than the budget still gets in
+  size_t uploadBytesPerFrame;
+  uint64_t uploadMicrosecondsPerFrame;
+
+  // if not NULL, meshes and images are shared through this cache (which
+  // has to outlive the streamer), so content that shows up in several
+  // assets is only uploaded once
+  Fpx3d_Vk_ResourceCache *cache;
+};
+
+struct _fpx3d_vk_streamer {
+  Fpx3d_Vk_StreamerConfig config;
+
+  Fpx3d_Vk_Context *context;
+  Fpx3d_Vk_LogicalGpu *logicalGpu;
+
+  // the worker threads and the queues between the stages
+  struct fpx3d_vk_stream_shared *shared;
+};
+
+struct _fpx3d_vk_stream_handle {
+  // everything below is only valid once the state is READY
+
+  // the parsed asset, for its nodes, materials and such
+  Fpx3d_Model_GltfAsset asset;
+
+  // one per mesh of the asset, with all of its primitives in one buffer.
+  // Meshes that could not be converted are left zeroed
+  // (vertexBuffer.isValid == false)
+  Fpx3d_Vk_ShapeBuffer *shapeBuffers;
+  size_t shapeBufferCount;
+
+  // layout of every shape buffer's vertices. The attribute array stays
+  // NULL for meshes with streams a Fpx3d_Vk_VertexAttribute can't describe
+  Fpx3d_Vk_VertexBinding *vertexBindings;
+
+  Fpx3d_Vk_GltfTextures textures;
+
+  // set once the state is FAILED
+  Fpx3d_E_Result result;
+
+  // internal, don't touch
+
+  char *path;
+
+  Fpx3d_Vk_StreamCallback callback;
+  void *userData;
+
+  _Atomic int state;
+
+  // progress within the current state
+  atomic_size_t stepsDone;
+  atomic_size_t stepsTotal;
+
+  // decoded data waiting for the upload stage
+  struct fpx3d_vk_stream_upload *uploads;
+  size_t uploadCount;
+  size_t uploadsDone;
+
+  // the upload batch with the last of the uploads recorded so far; the
+  // handle only gets READY once it's done. `inBatch` is set while the
+  // batch is still being recorded, before it has a ticket
+  Fpx3d_Vk_UploadTicket ticket;
+  bool inBatch;
+
+  int owner;
+  atomic_bool abandoned;
+
+  Fpx3d_Vk_StreamHandle *next;
+};
+
+// starts the worker threads. `ctx` and `lgpu` have to outlive the streamer
+Fpx3d_E_Result fpx3d_vk_create_streamer(Fpx3d_Vk_Context *ctx,
+                                        Fpx3d_Vk_LogicalGpu *lgpu,
+                                        const Fpx3d_Vk_StreamerConfig *config,
+                                        Fpx3d_Vk_Streamer *output);
+
+// stops the workers and drops every handle that is not finished yet,
+// without calling its callback. Release finished handles beforehand
+Fpx3d_E_Result fpx3d_vk_destroy_streamer(Fpx3d_Vk_Streamer *);
+
+// queues a glTF or GLB file. Image URIs are resolved relative to the
+// directory of `path`. The handle belongs to the streamer until you give
+// it back using fpx3d_vk_stream_release()
+Fpx3d_E_Result fpx3d_vk_stream_gltf(Fpx3d_Vk_Streamer *, const char *path,
+                                    Fpx3d_Vk_StreamCallback callback,
+                                    void *user_data,
+                                    Fpx3d_Vk_StreamHandle **output);
+
+// the GPU upload stage: call this once per frame, from the thread that
+// records and submits. Records decoded data into one upload batch within
+// the frame budget and submits it without waiting for it. Handles whose
+// uploads are all done on the GPU finish, and get their callbacks called
+Fpx3d_E_Result fpx3d_vk_streamer_update(Fpx3d_Vk_Streamer *);
+
+Fpx3d_Vk_E_StreamState fpx3d_vk_stream_state(const Fpx3d_Vk_StreamHandle *);
+
+// rough estimate in [0, 1], safe to call from any thread
+float fpx3d_vk_stream_progress(const Fpx3d_Vk_StreamHandle *);
+
+// destroys the GPU resources and the asset of a handle. Handles that are
+// still streaming are cancelled. Call from the same thread as
+// fpx3d_vk_streamer_update(), and don't use the handle afterwards
+Fpx3d_E_Result fpx3d_vk_stream_release(Fpx3d_Vk_Streamer *,
+                                       Fpx3d_Vk_StreamHandle *);
+
+#endif // FPX_VK_STREAMING_H
@@ -0,0 +1,62 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_TEXTURE_COMPRESSION_H
+#define FPX_VK_TEXTURE_COMPRESSION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../fpx3d.h"
+
+#include "./typedefs.h"
+
+// highest Fpx3d_Vk_CompressionConfig::quality that still makes a difference
+#define FPX3D_VK_BC7_MAX_QUALITY 4
+
+struct _fpx3d_vk_compression_config {
+  Fpx3d_Vk_E_BlockFormat format;
+
+  // BC7 only: how many times the endpoints get refit to the pixels, from 0
+  // (fastest) to FPX3D_VK_BC7_MAX_QUALITY
+  uint32_t quality;
+
+  // split the block rows over this many threads (0 means one per CPU)
+  size_t threadCount;
+
+  // if not NULL, encoded images are stored in (and loaded from) this
+  // directory, named after the hash of their pixels. The directory has to
+  // exist already
+  const char *cacheDirectory;
+};
+
+// 4x4 pixel blocks, row by row. Images whose size is not a multiple of 4
+// get their edge pixels repeated into the last blocks
+struct _fpx3d_vk_compressed_image {
+  Fpx3d_Vk_E_BlockFormat format;
+
+  uint32_t width;
+  uint32_t height;
+
+  uint8_t *blocks;
+  size_t size;
+};
+
+// bytes taken up by a `width` by `height` image in `format`. 0 for
+// FPX3D_VK_BLOCK_NONE or a bad format
+size_t fpx3d_vk_compressed_size(Fpx3d_Vk_E_BlockFormat format, uint32_t width,
+                                uint32_t height);
+
+// encodes RGBA8 pixels on the CPU. BC1 drops the alpha channel and BC5
+// keeps only red and green (meant for normal maps)
+Fpx3d_E_Result fpx3d_vk_compress_image(const uint8_t *rgba, uint32_t width,
+                                       uint32_t height,
+                                       const Fpx3d_Vk_CompressionConfig *,
+                                       Fpx3d_Vk_CompressedImage *output);
+
+void fpx3d_vk_destroy_compressed_image(Fpx3d_Vk_CompressedImage *);
+
+#endif // FPX_VK_TEXTURE_COMPRESSION_H
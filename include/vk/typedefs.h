@@ -15,6 +15,7 @@
 
 typedef struct _fpx3d_vk_context Fpx3d_Vk_Context;
 typedef struct _fpx3d_vk_physical_device Fpx3d_Vk_PhysicalDevice;
+typedef struct _fpx3d_vk_capabilities Fpx3d_Vk_Capabilities;
 
 typedef struct _fpx3d_vk_lgpu Fpx3d_Vk_LogicalGpu;
 
@@ -24,6 +25,17 @@ typedef struct _fpx3d_vk_image_dimensions Fpx3d_Vk_ImageDimensions;
 typedef struct _fpx3d_vk_image Fpx3d_Vk_Image;
 typedef struct _fpx3d_vk_image_sampler Fpx3d_Vk_ImageSampler;
 typedef struct _fpx3d_vk_texture Fpx3d_Vk_Texture;
+typedef struct _fpx3d_vk_gltf_textures Fpx3d_Vk_GltfTextures;
+
+typedef enum {
+  FPX3D_VK_BLOCK_NONE = 0,
+  FPX3D_VK_BLOCK_BC1 = 1, // RGB, 8 bytes per block
+  FPX3D_VK_BLOCK_BC3 = 2, // RGBA, 16 bytes per block
+  FPX3D_VK_BLOCK_BC5 = 3, // RG, 16 bytes per block
+  FPX3D_VK_BLOCK_BC7 = 4, // RGBA, 16 bytes per block
+} Fpx3d_Vk_E_BlockFormat;
+typedef struct _fpx3d_vk_compression_config Fpx3d_Vk_CompressionConfig;
+typedef struct _fpx3d_vk_compressed_image Fpx3d_Vk_CompressedImage;
 
 typedef struct _fpx3d_vk_sc Fpx3d_Vk_Swapchain;
 typedef struct _fpx3d_vk_sc_frame Fpx3d_Vk_SwapchainFrame;
@@ -51,8 +63,15 @@ typedef enum {
 typedef struct _fpx3d_vk_spirv Fpx3d_Vk_SpirvFile;
 typedef struct _fpx3d_vk_shader_modules Fpx3d_Vk_ShaderModuleSet;
 
+typedef struct _fpx3d_vk_allocation Fpx3d_Vk_Allocation;
+typedef struct _fpx3d_vk_allocator_stats Fpx3d_Vk_AllocatorStats;
+
 typedef struct _fpx3d_vk_buffer Fpx3d_Vk_Buffer;
 
+typedef uint64_t Fpx3d_Vk_UploadTicket;
+typedef struct _fpx3d_vk_upload_batch Fpx3d_Vk_UploadBatch;
+typedef struct _fpx3d_vk_image_region Fpx3d_Vk_ImageRegion;
+
 typedef enum {
   DESC_INVALID = VK_DESCRIPTOR_TYPE_MAX_ENUM,
   DESC_UNIFORM = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
@@ -72,7 +91,9 @@ typedef struct _fpx3d_vk_vertex_binding Fpx3d_Vk_VertexBinding;
 typedef struct _fpx3d_vk_vertex_attr Fpx3d_Vk_VertexAttribute;
 
 typedef struct _fpx3d_vk_shapebuffer Fpx3d_Vk_ShapeBuffer;
+typedef struct _fpx3d_vk_shape_file_layout Fpx3d_Vk_ShapeFileLayout;
 typedef struct _fpx3d_vk_shape Fpx3d_Vk_Shape;
+typedef struct _fpx3d_vk_mesh_arena Fpx3d_Vk_MeshArena;
 
 typedef enum {
   GRAPHICS_PIPELINE = 0,
@@ -87,4 +108,31 @@ typedef enum {
 } Fpx3d_Vk_E_CommandPoolType;
 typedef struct _fpx3d_vk_command_pool Fpx3d_Vk_CommandPool;
 
+typedef enum {
+  FPX3D_VK_STREAM_QUEUED = 0,
+  FPX3D_VK_STREAM_READING = 1,
+  FPX3D_VK_STREAM_PARSING = 2,
+  FPX3D_VK_STREAM_DECODING = 3,
+  FPX3D_VK_STREAM_UPLOADING = 4,
+  FPX3D_VK_STREAM_READY = 5,
+  FPX3D_VK_STREAM_FAILED = 6,
+} Fpx3d_Vk_E_StreamState;
+typedef struct _fpx3d_vk_streamer_config Fpx3d_Vk_StreamerConfig;
+typedef struct _fpx3d_vk_streamer Fpx3d_Vk_Streamer;
+typedef struct _fpx3d_vk_stream_handle Fpx3d_Vk_StreamHandle;
+
+typedef struct _fpx3d_vk_cache_key Fpx3d_Vk_CacheKey;
+typedef struct _fpx3d_vk_resource_cache Fpx3d_Vk_ResourceCache;
+
+typedef struct _fpx3d_vk_residency Fpx3d_Vk_Residency;
+typedef struct fpx3d_vk_residency_entry Fpx3d_Vk_Resident;
+
+typedef enum {
+  FPX3D_VK_HOT_GLTF = 0,
+  FPX3D_VK_HOT_IMAGE = 1,
+  FPX3D_VK_HOT_SPIRV = 2,
+} Fpx3d_Vk_E_HotAssetType;
+typedef struct _fpx3d_vk_hot_reloader Fpx3d_Vk_HotReloader;
+typedef struct _fpx3d_vk_hot_asset Fpx3d_Vk_HotAsset;
+
 #endif // FPX_VK_TYPEDEFS_H
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#ifndef FPX_VK_UPLOAD_H
+#define FPX_VK_UPLOAD_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../fpx3d.h"
+
+#include "./buffer.h"
+#include "./typedefs.h"
+
+// copies and layout transitions recorded into one command buffer, which
+// is submitted as a whole. The data is copied into staging memory right
+// away, so it can be freed as soon as the call that took it returns
+struct _fpx3d_vk_upload_batch {
+  Fpx3d_Vk_LogicalGpu *logicalGpu;
+  VkPhysicalDevice physicalGpu;
+
+  VkCommandBuffer commandBuffer;
+  VkCommandPool commandPool;
+  VkQueue queue;
+
+  // set if the logical GPU has a TRANSFER_POOL and a transfer queue in a
+  // family other than the graphics one. Buffers and images that haven't
+  // been filled before are then filled on the transfer queue, and handed
+  // over to the graphics queue family at the start of `commandBuffer`.
+  // The command buffer itself is only made for the first of those
+  VkCommandBuffer transferCommandBuffer;
+  VkCommandPool transferCommandPool;
+  VkQueue transferQueue;
+  size_t transferCommandCount;
+
+  // only one batch at a time gets the staging ring of the logical GPU;
+  // the others make staging buffers of their own
+  bool ownsStagingRing;
+
+  Fpx3d_Vk_Buffer *stagingBuffers;
+  size_t stagingBufferCount;
+  size_t stagingBufferCapacity;
+
+  // commands in `commandBuffer`, other than the ownership handovers. Once
+  // there are any, the transfer queue isn't used anymore, so that nothing
+  // filled there can overtake them
+  size_t commandCount;
+
+  // set once `commandBuffer` waits for earlier submissions to its queue to
+  // stop using what it overwrites; only needed before the first buffer write
+  bool waitsForReaders;
+
+  // frameIndex + 1 of the last frame that may still be reading something
+  // the batch overwrites, or 0 if there's none. Frames can be on any
+  // graphics queue, so submitting the batch waits on the host for the
+  // fences of that frame and the ones submitted before it
+  uint64_t waitForFrame;
+
+  bool isValid;
+};
+
+// part of an image, in texels. Images are made with a single mip level,
+// so that's the one it's in. `rowLength` is how many texels a row of the
+// data holds, or 0 if that's `width`, so a tile can be taken straight out
+// of a bigger picture. For compressed images, `x` and `y` have to be
+// multiples of the block size (4), as do `width` and `height` unless they
+// reach the edge of the image
+struct _fpx3d_vk_image_region {
+  uint32_t x;
+  uint32_t y;
+  uint32_t width;
+  uint32_t height;
+
+  uint32_t rowLength;
+};
+
+// needs a GRAPHICS_POOL command pool and a graphics queue on the logical GPU
+Fpx3d_E_Result fpx3d_vk_begin_upload_batch(Fpx3d_Vk_Context *,
+                                           Fpx3d_Vk_LogicalGpu *,
+                                           Fpx3d_Vk_UploadBatch *output);
+
+// `dst` has to have been made with VK_BUFFER_USAGE_TRANSFER_DST_BIT. This
+// always runs on the graphics queue, as the rest of the buffer is kept.
+// Small writes at offsets and sizes that are multiples of 4 go into the
+// command buffer itself, without staging memory. Frames submitted before
+// the batch still see the old contents, as submitting it waits for them
+Fpx3d_E_Result fpx3d_vk_batch_upload_buffer(Fpx3d_Vk_UploadBatch *,
+                                            Fpx3d_Vk_Buffer *dst,
+                                            VkDeviceSize dst_offset,
+                                            const void *data,
+                                            VkDeviceSize size);
+
+// fills the whole image, moving it to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+// first. With `readonly`, it's moved on to
+// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL afterwards. An image that was
+// never filled or transitioned before may be filled on the transfer queue,
+// or, with `readonly` and `hostTransfer` set, on the host right away
+Fpx3d_E_Result fpx3d_vk_batch_upload_image(Fpx3d_Vk_UploadBatch *,
+                                           Fpx3d_Vk_Image *, const void *data,
+                                           size_t size, bool readonly);
+
+// fills just `region` of the image, leaving the rest of it as it is.
+// `data` starts at the first texel of the region. The image is moved to
+// VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL for the copy, and with `readonly`
+// back to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL afterwards. Like a
+// buffer upload, submitting the batch waits for the frames in flight
+Fpx3d_E_Result fpx3d_vk_batch_update_image(Fpx3d_Vk_UploadBatch *,
+                                           Fpx3d_Vk_Image *,
+                                           const Fpx3d_Vk_ImageRegion *,
+                                           const void *data, bool readonly);
+
+Fpx3d_E_Result fpx3d_vk_batch_transition_image(Fpx3d_Vk_UploadBatch *,
+                                               Fpx3d_Vk_Image *,
+                                               VkImageLayout);
+
+// submits everything recorded into the batch. The ticket stays valid
+// until the logical GPU is destroyed; a batch with nothing in it gets
+// ticket 0, which is always done. The batch can't be used again either way
+Fpx3d_E_Result fpx3d_vk_submit_upload_batch(Fpx3d_Vk_UploadBatch *,
+                                            Fpx3d_Vk_UploadTicket *output);
+
+// throws away everything recorded into the batch without submitting it
+void fpx3d_vk_discard_upload_batch(Fpx3d_Vk_UploadBatch *);
+
+// uploads finish in the order they were submitted in. Resources of a
+// batch can be used by anything submitted to the same queue after it
+// right away; for any other queue, wait for the ticket first
+bool fpx3d_vk_upload_done(Fpx3d_Vk_LogicalGpu *, Fpx3d_Vk_UploadTicket);
+Fpx3d_E_Result fpx3d_vk_wait_upload(Fpx3d_Vk_LogicalGpu *,
+                                    Fpx3d_Vk_UploadTicket);
+
+#endif // FPX_VK_UPLOAD_H
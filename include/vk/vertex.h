@@ -10,6 +10,7 @@
 #include <sys/types.h>
 
 #include "../fpx3d.h"
+#include "../model/mesh.h"
 #include "../model/model.h"
 
 #include "./typedefs.h"
@@ -72,4 +73,22 @@ Fpx3d_E_Result fpx3d_vk_set_indices(Fpx3d_Vk_VertexBundle *, uint32_t *indices,
 // also frees indices, if these were allocated
 Fpx3d_E_Result fpx3d_vk_free_vertices(Fpx3d_Vk_VertexBundle *);
 
+// interleaves every stream of `mesh` into a freshly allocated bundle
+// (streams in mesh order, no padding besides the mesh's own element size).
+// If `binding` is not NULL, it gets an attribute array matching the layout
+// of the bundle. Free that array yourself when you are done with it.
+// Only the formats a Fpx3d_Vk_VertexAttribute can describe are accepted
+// if a binding is requested
+Fpx3d_E_Result fpx3d_vk_vertices_from_mesh(Fpx3d_Vk_VertexBundle *output,
+                                           const Fpx3d_Model_Mesh *mesh,
+                                           Fpx3d_Vk_VertexBinding *binding);
+
+// the reverse: `semantics` holds one entry per attribute in `binding`
+Fpx3d_E_Result
+fpx3d_vk_vertices_to_mesh(const Fpx3d_Vk_VertexBundle *bundle,
+                          const Fpx3d_Vk_VertexBinding *binding,
+                          const Fpx3d_Model_E_AttributeSemantic *semantics,
+                          Fpx3d_Model_E_MeshLayout layout,
+                          Fpx3d_Model_Mesh *output);
+
 #endif // FPX_VK_VERTEX_H
@@ -22,7 +22,7 @@ Fpx3d_E_Result __fpx3d_realloc_array(void **arr, size_t obj_size, size_t amount,
   }
 
   if (amount > *old_capacity) {
-    memset((uint8_t *)data + *old_capacity, 0,
+    memset((uint8_t *)data + (*old_capacity * obj_size), 0,
            (amount - *old_capacity) * obj_size);
   }
 
@@ -0,0 +1,276 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+// maps a whole file read-only. On platforms without mmap() the file is read
+// into a heap buffer instead. Either way, release it with
+// __fpx3d_unmap_file()
+Fpx3d_E_Result __fpx3d_map_file(const char *path, const uint8_t **output,
+                                size_t *output_size) {
+  NULL_CHECK(path, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output_size, FPX3D_ARGS_ERROR);
+
+#if defined(_WIN32) || defined(_WIN64)
+  FILE *fp = fopen(path, "rb");
+  if (NULL == fp) {
+    perror("fopen()");
+    return FPX3D_ARGS_ERROR;
+  }
+
+  fseek(fp, 0, SEEK_END);
+  long length = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  if (1 > length) {
+    fclose(fp);
+    return FPX3D_ARGS_ERROR;
+  }
+
+  uint8_t *data = (uint8_t *)malloc((size_t)length);
+  if (NULL == data) {
+    perror("malloc()");
+    fclose(fp);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  if ((size_t)length != fread(data, 1, (size_t)length, fp)) {
+    perror("fread()");
+    FREE_SAFE(data);
+    fclose(fp);
+    return FPX3D_GENERIC_ERROR;
+  }
+
+  fclose(fp);
+
+  *output = data;
+  *output_size = (size_t)length;
+#else
+  int fd = open(path, O_RDONLY);
+  if (0 > fd) {
+    perror("open()");
+    return FPX3D_ARGS_ERROR;
+  }
+
+  struct stat st;
+  if (0 != fstat(fd, &st)) {
+    perror("fstat()");
+    close(fd);
+    return FPX3D_GENERIC_ERROR;
+  }
+
+  if (1 > st.st_size) {
+    close(fd);
+    return FPX3D_ARGS_ERROR;
+  }
+
+  void *data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // the mapping keeps its own reference to the file
+  close(fd);
+
+  if (MAP_FAILED == data) {
+    perror("mmap()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  // loaders walk these front to back
+  madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+  *output = (const uint8_t *)data;
+  *output_size = (size_t)st.st_size;
+#endif
+
+  return FPX3D_SUCCESS;
+}
+
+void __fpx3d_unmap_file(const uint8_t *data, size_t size) {
+  if (NULL == data)
+    return;
+
+#if defined(_WIN32) || defined(_WIN64)
+  (void)size;
+  free((void *)data);
+#else
+  munmap((void *)data, size);
+#endif
+}
+
+struct _open_file {
+#if defined(_WIN32) || defined(_WIN64)
+  FILE *fp;
+#else
+  int fd;
+#endif
+};
+
+// opens a file for positional reads through __fpx3d_read_file_scatter().
+// Close it with __fpx3d_close_file()
+Fpx3d_E_Result __fpx3d_open_file(const char *path, void **output,
+                                 size_t *output_size) {
+  NULL_CHECK(path, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output_size, FPX3D_ARGS_ERROR);
+
+  struct _open_file *file = malloc(sizeof(*file));
+  NULL_CHECK(file, FPX3D_MEMORY_ERROR);
+
+#if defined(_WIN32) || defined(_WIN64)
+  file->fp = fopen(path, "rb");
+  if (NULL == file->fp) {
+    perror("fopen()");
+    FREE_SAFE(file);
+    return FPX3D_ARGS_ERROR;
+  }
+
+  _fseeki64(file->fp, 0, SEEK_END);
+  long long length = _ftelli64(file->fp);
+
+  if (0 > length) {
+    fclose(file->fp);
+    FREE_SAFE(file);
+    return FPX3D_GENERIC_ERROR;
+  }
+
+  *output_size = (size_t)length;
+#else
+  file->fd = open(path, O_RDONLY);
+  if (0 > file->fd) {
+    perror("open()");
+    FREE_SAFE(file);
+    return FPX3D_ARGS_ERROR;
+  }
+
+  struct stat st;
+  if (0 != fstat(file->fd, &st)) {
+    perror("fstat()");
+    close(file->fd);
+    FREE_SAFE(file);
+    return FPX3D_GENERIC_ERROR;
+  }
+
+  // reads are scattered all over the file
+  posix_fadvise(file->fd, 0, 0, POSIX_FADV_RANDOM);
+
+  *output_size = (size_t)st.st_size;
+#endif
+
+  *output = file;
+
+  return FPX3D_SUCCESS;
+}
+
+void __fpx3d_close_file(void *file) {
+  NULL_CHECK(file, );
+
+#if defined(_WIN32) || defined(_WIN64)
+  fclose(((struct _open_file *)file)->fp);
+#else
+  close(((struct _open_file *)file)->fd);
+#endif
+
+  free(file);
+}
+
+// reads one contiguous region of the file, starting at `offset`, into
+// `count` buffers one after the other. The same buffer may be passed more
+// than once to throw parts of the region away
+Fpx3d_E_Result __fpx3d_read_file_scatter(void *file, size_t offset,
+                                         void *const *buffers,
+                                         const size_t *lengths, size_t count) {
+  NULL_CHECK(file, FPX3D_ARGS_ERROR);
+  NULL_CHECK(buffers, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lengths, FPX3D_ARGS_ERROR);
+
+#if defined(_WIN32) || defined(_WIN64)
+  FILE *fp = ((struct _open_file *)file)->fp;
+
+  if (0 != _fseeki64(fp, (long long)offset, SEEK_SET))
+    return FPX3D_GENERIC_ERROR;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (lengths[i] != fread(buffers[i], 1, lengths[i], fp)) {
+      perror("fread()");
+      return FPX3D_GENERIC_ERROR;
+    }
+  }
+#else
+  int fd = ((struct _open_file *)file)->fd;
+
+  // well below IOV_MAX everywhere
+  struct iovec iov[64];
+  size_t next = 0;
+
+  // the buffer at `next` may have been read partially by a short read
+  size_t partial = 0;
+
+  while (true) {
+    // zero-length buffers don't need a read of their own
+    while (next < count && 0 == lengths[next] - partial) {
+      partial = 0;
+      ++next;
+    }
+
+    if (next >= count)
+      break;
+
+    int iov_count = 0;
+
+    for (size_t i = next; i < count && iov_count < (int)ARRAY_SIZE(iov); ++i) {
+      size_t skip = (i == next) ? partial : 0;
+
+      iov[iov_count].iov_base = (uint8_t *)buffers[i] + skip;
+      iov[iov_count].iov_len = lengths[i] - skip;
+      ++iov_count;
+    }
+
+    ssize_t amount = preadv(fd, iov, iov_count, (off_t)offset);
+
+    if (0 > amount) {
+      perror("preadv()");
+      return FPX3D_GENERIC_ERROR;
+    }
+
+    if (0 == amount) {
+      FPX3D_WARN("Unexpected end of file at offset %" LONG_FORMAT "u",
+                 offset);
+      return FPX3D_GENERIC_ERROR;
+    }
+
+    offset += (size_t)amount;
+
+    size_t consumed = (size_t)amount;
+    while (0 < consumed && next < count) {
+      size_t remaining = lengths[next] - partial;
+
+      if (consumed < remaining) {
+        partial += consumed;
+        break;
+      }
+
+      consumed -= remaining;
+      partial = 0;
+      ++next;
+    }
+  }
+#endif
+
+  return FPX3D_SUCCESS;
+}
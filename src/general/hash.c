@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "fpx3d.h"
+
+// XXH64 (same constants and rounds), so digests match the reference
+// implementation for the same seed
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+// static declarations ----
+
+static uint64_t _rotl(uint64_t value, int bits);
+static uint64_t _round(uint64_t acc, uint64_t input);
+static uint64_t _merge_round(uint64_t acc, uint64_t value);
+
+static uint64_t _read64(const uint8_t *);
+static uint32_t _read32(const uint8_t *);
+
+// end of static declarations ----
+
+// fast non-cryptographic 64-bit hash. Feed the digest of one piece of data
+// in as the seed of the next to hash several pieces as one
+uint64_t __fpx3d_hash64(const void *data, size_t length, uint64_t seed) {
+  const uint8_t *p = (const uint8_t *)data;
+  const uint8_t *end = p + length;
+
+  uint64_t h = 0;
+
+  if (32 <= length) {
+    const uint8_t *limit = end - 32;
+
+    uint64_t v1 = seed + PRIME64_1 + PRIME64_2;
+    uint64_t v2 = seed + PRIME64_2;
+    uint64_t v3 = seed;
+    uint64_t v4 = seed - PRIME64_1;
+
+    do {
+      v1 = _round(v1, _read64(p));
+      v2 = _round(v2, _read64(p + 8));
+      v3 = _round(v3, _read64(p + 16));
+      v4 = _round(v4, _read64(p + 24));
+      p += 32;
+    } while (p <= limit);
+
+    h = _rotl(v1, 1) + _rotl(v2, 7) + _rotl(v3, 12) + _rotl(v4, 18);
+    h = _merge_round(h, v1);
+    h = _merge_round(h, v2);
+    h = _merge_round(h, v3);
+    h = _merge_round(h, v4);
+  } else {
+    h = seed + PRIME64_5;
+  }
+
+  h += (uint64_t)length;
+
+  for (; p + 8 <= end; p += 8) {
+    h ^= _round(0, _read64(p));
+    h = _rotl(h, 27) * PRIME64_1 + PRIME64_4;
+  }
+
+  if (p + 4 <= end) {
+    h ^= (uint64_t)_read32(p) * PRIME64_1;
+    h = _rotl(h, 23) * PRIME64_2 + PRIME64_3;
+    p += 4;
+  }
+
+  for (; p < end; ++p) {
+    h ^= (uint64_t)*p * PRIME64_5;
+    h = _rotl(h, 11) * PRIME64_1;
+  }
+
+  h ^= h >> 33;
+  h *= PRIME64_2;
+  h ^= h >> 29;
+  h *= PRIME64_3;
+  h ^= h >> 32;
+
+  return h;
+}
+
+// STATIC FUNCTIONS ----
+
+static uint64_t _rotl(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t _round(uint64_t acc, uint64_t input) {
+  acc += input * PRIME64_2;
+  acc = _rotl(acc, 31);
+  return acc * PRIME64_1;
+}
+
+static uint64_t _merge_round(uint64_t acc, uint64_t value) {
+  acc ^= _round(0, value);
+  return acc * PRIME64_1 + PRIME64_4;
+}
+
+// little-endian reads; memcpy keeps unaligned input legal
+static uint64_t _read64(const uint8_t *p) {
+  uint64_t value = 0;
+  memcpy(&value, p, sizeof(value));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  value = __builtin_bswap64(value);
+#endif
+
+  return value;
+}
+
+static uint32_t _read32(const uint8_t *p) {
+  uint32_t value = 0;
+  memcpy(&value, p, sizeof(value));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  value = __builtin_bswap32(value);
+#endif
+
+  return value;
+}
+
+// END OF STATIC FUNCTIONS ----
@@ -0,0 +1,666 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+// O_DIRECT and AT_EMPTY_PATH
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+
+// raw system calls, so there's no liburing to link against
+#if defined(__NR_io_uring_setup)
+#define USE_IO_URING
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#endif
+#endif
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+// buffers are sized in multiples of this, with at least one zero byte
+// after the data
+#define BUFFER_PADDING 16
+
+// offset, length and address alignment that O_DIRECT is happy with on
+// every file system that supports it
+#define DIRECT_ALIGNMENT 4096
+
+// the most files a batch has open at once
+#define MAX_IN_FLIGHT 256
+
+// a single read never asks for more than this (io_uring lengths are 32-bit)
+#define MAX_READ_LENGTH ((size_t)1 << 30)
+
+extern size_t __fpx3d_cpu_count(void);
+extern Fpx3d_E_Result __fpx3d_parallel_for(size_t count, size_t thread_count,
+                                           void (*function)(void *, size_t),
+                                           void *context);
+
+enum _read_stage {
+  STAGE_OPEN = 0,
+  STAGE_STAT,
+  STAGE_READ,
+  STAGE_CLOSE,
+  STAGE_DONE,
+};
+
+// one whole file, from opening it to closing it again
+struct _file_read {
+  const char *path;
+  bool direct;
+
+  enum _read_stage stage;
+  int fd;
+
+  uint8_t *data;
+  size_t size;
+  size_t capacity;
+  size_t done;
+
+  Fpx3d_E_Result result;
+
+#if defined(USE_IO_URING)
+  struct statx stx;
+#endif
+};
+
+#if defined(USE_IO_URING)
+struct _ring {
+  int fd;
+  unsigned entries;
+
+  void *sqMap, *cqMap;
+  size_t sqMapSize, cqMapSize;
+
+  struct io_uring_sqe *sqes;
+  size_t sqesSize;
+
+  unsigned *sqHead, *sqTail, *sqMask, *sqArray;
+  unsigned *cqHead, *cqTail, *cqMask;
+  struct io_uring_cqe *cqes;
+
+  // queued, but not handed to the kernel yet
+  unsigned unsubmitted;
+};
+
+// 0 until the first batch found out, then 1 if io_uring works and -1 if
+// the kernel (or a seccomp filter) doesn't let us use it
+static atomic_int uring_state = 0;
+#endif
+
+// static declarations ----
+
+static Fpx3d_E_Result _allocate(struct _file_read *);
+static void _finish(struct _file_read *);
+
+static void _read_blocking(void *reads_ptr, size_t index);
+
+#if defined(USE_IO_URING)
+static bool _ring_init(struct _ring *, unsigned entries);
+static void _ring_destroy(struct _ring *);
+static bool _ring_supports_reads(struct _ring *);
+
+static void _queue(struct _ring *, struct _file_read *);
+static bool _advance(struct _ring *, struct _file_read *, int32_t res);
+static Fpx3d_E_Result _read_uring(struct _file_read *reads, size_t count);
+#endif
+
+// end of static declarations ----
+
+// reads `count` whole files at once: through io_uring on Linux when the
+// kernel allows it, otherwise with a few threads doing blocking reads.
+// Every file that could be read gets a heap buffer in `outputs` (release
+// it with free()), padded with zeroes to a multiple of 16 bytes, with at
+// least one zero after the data. With `direct`, the files are read past
+// the page cache (O_DIRECT) where the file system allows it, into page
+// aligned buffers.
+// `results` (may be NULL) gets the outcome for every file; the return
+// value is the first error, if any
+Fpx3d_E_Result __fpx3d_read_files(const char *const *paths, size_t count,
+                                  bool direct, uint8_t **outputs,
+                                  size_t *output_sizes,
+                                  Fpx3d_E_Result *results) {
+  NULL_CHECK(paths, FPX3D_ARGS_ERROR);
+  NULL_CHECK(outputs, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output_sizes, FPX3D_ARGS_ERROR);
+
+  if (1 > count)
+    return FPX3D_SUCCESS;
+
+#if defined(_WIN32) || defined(_WIN64) || !defined(O_DIRECT)
+  direct = false;
+#endif
+
+  struct _file_read *reads = calloc(count, sizeof(*reads));
+  if (NULL == reads) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    reads[i].path = paths[i];
+    reads[i].direct = direct;
+    reads[i].fd = -1;
+    reads[i].result = (NULL == paths[i]) ? FPX3D_ARGS_ERROR : FPX3D_SUCCESS;
+    reads[i].stage = (NULL == paths[i]) ? STAGE_DONE : STAGE_OPEN;
+  }
+
+  Fpx3d_E_Result retval = FPX3D_GENERIC_ERROR;
+
+#if defined(USE_IO_URING)
+  if (0 <= atomic_load(&uring_state))
+    retval = _read_uring(reads, count);
+#endif
+
+  // also picks up whatever io_uring left unfinished
+  if (FPX3D_SUCCESS != retval) {
+    size_t threads = MIN(count, __fpx3d_cpu_count() * 4);
+    __fpx3d_parallel_for(count, threads, _read_blocking, reads);
+  }
+
+  retval = FPX3D_SUCCESS;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (FPX3D_SUCCESS != reads[i].result) {
+      FREE_SAFE(reads[i].data);
+      reads[i].size = 0;
+
+      if (FPX3D_SUCCESS == retval)
+        retval = reads[i].result;
+    }
+
+    outputs[i] = reads[i].data;
+    output_sizes[i] = reads[i].size;
+
+    if (NULL != results)
+      results[i] = reads[i].result;
+  }
+
+  FREE_SAFE(reads);
+
+  return retval;
+}
+
+// STATIC FUNCTIONS ----
+
+// makes room for `read->size` bytes plus the padding
+static Fpx3d_E_Result _allocate(struct _file_read *read) {
+  size_t alignment = read->direct ? DIRECT_ALIGNMENT : BUFFER_PADDING;
+
+  read->capacity = (read->size + alignment) / alignment * alignment;
+
+#if defined(_WIN32) || defined(_WIN64)
+  read->data = malloc(read->capacity);
+#else
+  void *data = NULL;
+  if (0 == posix_memalign(&data, alignment, read->capacity))
+    read->data = data;
+#endif
+
+  if (NULL == read->data) {
+    perror("posix_memalign()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+// zeroes the padding. A file that grew while being read is cut off at the
+// size it had when it was opened
+static void _finish(struct _file_read *read) {
+  if (NULL != read->data)
+    memset(&read->data[read->size], 0, read->capacity - read->size);
+}
+
+// parallel_for job, also for the files io_uring didn't get to
+static void _read_blocking(void *reads_ptr, size_t index) {
+  struct _file_read *read = &((struct _file_read *)reads_ptr)[index];
+
+  if (STAGE_DONE == read->stage)
+    return;
+
+#if defined(_WIN32) || defined(_WIN64)
+  FILE *fp = fopen(read->path, "rb");
+  if (NULL == fp) {
+    read->result = FPX3D_ARGS_ERROR;
+    read->stage = STAGE_DONE;
+    return;
+  }
+
+  _fseeki64(fp, 0, SEEK_END);
+  long long length = _ftelli64(fp);
+  _fseeki64(fp, 0, SEEK_SET);
+
+  read->size = (0 > length) ? 0 : (size_t)length;
+  read->result = (0 > length) ? FPX3D_GENERIC_ERROR : _allocate(read);
+
+  if (FPX3D_SUCCESS == read->result &&
+      read->size != fread(read->data, 1, read->size, fp))
+    read->result = FPX3D_GENERIC_ERROR;
+
+  fclose(fp);
+#else
+  if (STAGE_OPEN == read->stage) {
+    int flags = O_RDONLY | O_CLOEXEC;
+
+#if defined(O_DIRECT)
+    if (read->direct)
+      flags |= O_DIRECT;
+#endif
+
+    read->fd = open(read->path, flags);
+
+    // not every file system does O_DIRECT
+    if (0 > read->fd && EINVAL == errno && read->direct)
+      read->fd = open(read->path, O_RDONLY | O_CLOEXEC);
+
+    if (0 > read->fd) {
+      read->result = FPX3D_ARGS_ERROR;
+      read->stage = STAGE_DONE;
+      return;
+    }
+
+    read->stage = STAGE_STAT;
+  }
+
+  if (STAGE_STAT == read->stage) {
+    off_t end = lseek(read->fd, 0, SEEK_END);
+
+    if (0 > end) {
+      read->result = FPX3D_GENERIC_ERROR;
+    } else {
+      read->size = (size_t)end;
+      read->result = _allocate(read);
+    }
+
+    read->stage = STAGE_READ;
+  }
+
+  while (FPX3D_SUCCESS == read->result && STAGE_READ == read->stage &&
+         read->done < read->size) {
+    size_t wanted = (read->direct ? read->capacity : read->size) - read->done;
+
+    ssize_t amount = pread(read->fd, &read->data[read->done],
+                           MIN(wanted, MAX_READ_LENGTH), (off_t)read->done);
+
+    if (0 > amount && EINTR == errno)
+      continue;
+
+#if defined(O_DIRECT)
+    // the file system refused the alignment after all
+    if (0 > amount && EINVAL == errno && read->direct) {
+      read->direct = false;
+      fcntl(read->fd, F_SETFL, fcntl(read->fd, F_GETFL) & ~O_DIRECT);
+      continue;
+    }
+#endif
+
+    if (0 > amount) {
+      perror("pread()");
+      read->result = FPX3D_GENERIC_ERROR;
+      break;
+    }
+
+    // the file shrank
+    if (0 == amount)
+      read->size = read->done;
+
+    read->done += (size_t)amount;
+  }
+
+  close(read->fd);
+  read->fd = -1;
+#endif
+
+  read->stage = STAGE_DONE;
+  _finish(read);
+}
+
+#if defined(USE_IO_URING)
+static bool _ring_init(struct _ring *ring, unsigned entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  memset(ring, 0, sizeof(*ring));
+
+  ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (0 > ring->fd)
+    return false;
+
+  ring->entries = params.sq_entries;
+
+  ring->sqMapSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  ring->cqMapSize =
+      params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  // both rings live in one mapping on 5.4 and newer
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    ring->sqMapSize = ring->cqMapSize = MAX(ring->sqMapSize, ring->cqMapSize);
+
+  ring->sqMap = mmap(NULL, ring->sqMapSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     ring->fd, IORING_OFF_SQ_RING);
+  if (MAP_FAILED == ring->sqMap) {
+    ring->sqMap = NULL;
+    _ring_destroy(ring);
+    return false;
+  }
+
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    ring->cqMap = ring->sqMap;
+  } else {
+    ring->cqMap = mmap(NULL, ring->cqMapSize, PROT_READ | PROT_WRITE,
+                       MAP_SHARED, ring->fd, IORING_OFF_CQ_RING);
+    if (MAP_FAILED == ring->cqMap) {
+      ring->cqMap = NULL;
+      _ring_destroy(ring);
+      return false;
+    }
+  }
+
+  ring->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  ring->sqes = mmap(NULL, ring->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+                    ring->fd, IORING_OFF_SQES);
+  if (MAP_FAILED == ring->sqes) {
+    ring->sqes = NULL;
+    _ring_destroy(ring);
+    return false;
+  }
+
+  uint8_t *sq = (uint8_t *)ring->sqMap;
+  uint8_t *cq = (uint8_t *)ring->cqMap;
+
+  ring->sqHead = (unsigned *)(sq + params.sq_off.head);
+  ring->sqTail = (unsigned *)(sq + params.sq_off.tail);
+  ring->sqMask = (unsigned *)(sq + params.sq_off.ring_mask);
+  ring->sqArray = (unsigned *)(sq + params.sq_off.array);
+
+  ring->cqHead = (unsigned *)(cq + params.cq_off.head);
+  ring->cqTail = (unsigned *)(cq + params.cq_off.tail);
+  ring->cqMask = (unsigned *)(cq + params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + params.cq_off.cqes);
+
+  return true;
+}
+
+static void _ring_destroy(struct _ring *ring) {
+  if (NULL != ring->sqes)
+    munmap(ring->sqes, ring->sqesSize);
+
+  if (NULL != ring->cqMap && ring->cqMap != ring->sqMap)
+    munmap(ring->cqMap, ring->cqMapSize);
+
+  if (NULL != ring->sqMap)
+    munmap(ring->sqMap, ring->sqMapSize);
+
+  if (0 <= ring->fd)
+    close(ring->fd);
+
+  memset(ring, 0, sizeof(*ring));
+  ring->fd = -1;
+}
+
+// opening, statting, reading and closing all have to go through the
+// ring; they were added in 5.6, together with the probe
+static bool _ring_supports_reads(struct _ring *ring) {
+  const uint8_t needed[] = {IORING_OP_OPENAT, IORING_OP_STATX, IORING_OP_READ,
+                            IORING_OP_CLOSE};
+
+  size_t probe_size = sizeof(struct io_uring_probe) +
+                      IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+
+  struct io_uring_probe *probe = calloc(1, probe_size);
+  if (NULL == probe)
+    return false;
+
+  bool supported =
+      (0 <= syscall(__NR_io_uring_register, ring->fd, IORING_REGISTER_PROBE,
+                    probe, IORING_OP_LAST));
+
+  for (size_t i = 0; supported && i < ARRAY_SIZE(needed); ++i) {
+    supported = (needed[i] < probe->ops_len &&
+                 (probe->ops[needed[i]].flags & IO_URING_OP_SUPPORTED));
+  }
+
+  FREE_SAFE(probe);
+
+  return supported;
+}
+
+// queues the operation for the stage the read is at. Every read has at
+// most one operation in flight, so there is always room
+static void _queue(struct _ring *ring, struct _file_read *read) {
+  unsigned tail = *ring->sqTail;
+  unsigned index = tail & *ring->sqMask;
+
+  struct io_uring_sqe *sqe = &ring->sqes[index];
+  memset(sqe, 0, sizeof(*sqe));
+
+  sqe->user_data = (uint64_t)(uintptr_t)read;
+
+  switch (read->stage) {
+  case STAGE_OPEN:
+    sqe->opcode = IORING_OP_OPENAT;
+    sqe->fd = AT_FDCWD;
+    sqe->addr = (uint64_t)(uintptr_t)read->path;
+    sqe->open_flags = O_RDONLY | O_CLOEXEC | (read->direct ? O_DIRECT : 0);
+    break;
+
+  case STAGE_STAT:
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = read->fd;
+    sqe->addr = (uint64_t)(uintptr_t) "";
+    sqe->len = STATX_SIZE;
+    sqe->statx_flags = AT_EMPTY_PATH;
+    sqe->off = (uint64_t)(uintptr_t)&read->stx;
+    break;
+
+  case STAGE_READ: {
+    size_t wanted = (read->direct ? read->capacity : read->size) - read->done;
+
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = read->fd;
+    sqe->addr = (uint64_t)(uintptr_t)&read->data[read->done];
+    sqe->len = (uint32_t)MIN(wanted, MAX_READ_LENGTH);
+    sqe->off = (uint64_t)read->done;
+  } break;
+
+  case STAGE_CLOSE:
+    sqe->opcode = IORING_OP_CLOSE;
+    sqe->fd = read->fd;
+    break;
+
+  case STAGE_DONE:
+    return;
+  }
+
+  ring->sqArray[index] = index;
+  __atomic_store_n(ring->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+  ++ring->unsubmitted;
+}
+
+// handles a completion. Returns whether the read queued another operation
+static bool _advance(struct _ring *ring, struct _file_read *read,
+                     int32_t res) {
+  switch (read->stage) {
+  case STAGE_OPEN:
+    // not every file system does O_DIRECT
+    if (-EINVAL == res && read->direct) {
+      read->direct = false;
+      break;
+    }
+
+    if (0 > res) {
+      read->result = FPX3D_ARGS_ERROR;
+      read->stage = STAGE_DONE;
+      return false;
+    }
+
+    read->fd = res;
+    read->stage = STAGE_STAT;
+    break;
+
+  case STAGE_STAT:
+    read->stage = STAGE_CLOSE;
+
+    if (0 > res) {
+      read->result = FPX3D_GENERIC_ERROR;
+      break;
+    }
+
+    read->size = (size_t)read->stx.stx_size;
+    read->result = _allocate(read);
+
+    if (FPX3D_SUCCESS == read->result && 0 < read->size)
+      read->stage = STAGE_READ;
+    break;
+
+  case STAGE_READ:
+    if (-EAGAIN == res || -EINTR == res)
+      break;
+
+    // the file system refused the alignment after all
+    if (-EINVAL == res && read->direct) {
+      read->direct = false;
+      fcntl(read->fd, F_SETFL, fcntl(read->fd, F_GETFL) & ~O_DIRECT);
+      break;
+    }
+
+    if (0 > res) {
+      read->result = FPX3D_GENERIC_ERROR;
+      read->stage = STAGE_CLOSE;
+      break;
+    }
+
+    // the file shrank
+    if (0 == res)
+      read->size = read->done;
+
+    read->done += (size_t)res;
+
+    if (read->done >= read->size)
+      read->stage = STAGE_CLOSE;
+    break;
+
+  case STAGE_CLOSE:
+    read->fd = -1;
+    read->stage = STAGE_DONE;
+    _finish(read);
+    return false;
+
+  case STAGE_DONE:
+    return false;
+  }
+
+  _queue(ring, read);
+
+  return true;
+}
+
+// keeps up to MAX_IN_FLIGHT files going at once, handing every batch of
+// operations to the kernel with a single system call. Files it didn't
+// get to are left for _read_blocking()
+static Fpx3d_E_Result _read_uring(struct _file_read *reads, size_t count) {
+  struct _ring ring;
+
+  if (!_ring_init(&ring, (unsigned)MIN(count, (size_t)MAX_IN_FLIGHT))) {
+    atomic_store(&uring_state, -1);
+    FPX3D_DEBUG("io_uring is unavailable, reading files with pread()");
+    return FPX3D_GENERIC_ERROR;
+  }
+
+  if (0 == atomic_load(&uring_state)) {
+    bool supported = _ring_supports_reads(&ring);
+    atomic_store(&uring_state, supported ? 1 : -1);
+
+    if (!supported) {
+      FPX3D_DEBUG("io_uring can't open files here, reading them with pread()");
+      _ring_destroy(&ring);
+      return FPX3D_GENERIC_ERROR;
+    }
+  }
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  size_t next = 0;
+  size_t in_flight = 0;
+
+  while (next < count || 0 < in_flight) {
+    while (next < count && in_flight < ring.entries) {
+      struct _file_read *read = &reads[next++];
+
+      if (STAGE_DONE == read->stage)
+        continue;
+
+      _queue(&ring, read);
+      ++in_flight;
+    }
+
+    if (1 > in_flight)
+      break;
+
+    int entered = (int)syscall(__NR_io_uring_enter, ring.fd, ring.unsubmitted,
+                               1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+    if (0 > entered && EINTR == errno)
+      continue;
+
+    if (0 > entered) {
+      perror("io_uring_enter()");
+      retval = FPX3D_GENERIC_ERROR;
+      break;
+    }
+
+    ring.unsubmitted -= MIN((unsigned)entered, ring.unsubmitted);
+
+    unsigned head = *ring.cqHead;
+    unsigned tail = __atomic_load_n(ring.cqTail, __ATOMIC_ACQUIRE);
+
+    for (; head != tail; ++head) {
+      struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cqMask];
+      struct _file_read *read = (struct _file_read *)(uintptr_t)cqe->user_data;
+
+      if (!_advance(&ring, read, cqe->res))
+        --in_flight;
+    }
+
+    __atomic_store_n(ring.cqHead, head, __ATOMIC_RELEASE);
+  }
+
+  // closing the ring cancels whatever is still in flight
+  _ring_destroy(&ring);
+
+  // files that were never queued are left for the blocking path. The
+  // kernel may still be writing into the buffers of the ones that were,
+  // so those are given up on (and their buffers leaked)
+  for (size_t i = 0; FPX3D_SUCCESS != retval && i < next; ++i) {
+    if (STAGE_DONE == reads[i].stage)
+      continue;
+
+    reads[i].data = NULL;
+    reads[i].result = FPX3D_GENERIC_ERROR;
+    reads[i].stage = STAGE_DONE;
+  }
+
+  return retval;
+}
+#endif
+
+// END OF STATIC FUNCTIONS ----
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+// upper bound, mostly so a silly core count can't exhaust the stack budget
+#define MAX_WORKER_THREADS 64
+
+struct _parallel_job {
+  void (*function)(void *context, size_t index);
+  void *context;
+
+  size_t count;
+  atomic_size_t next;
+};
+
+// static declarations ----
+
+static void *_worker_loop(void *job_ptr);
+
+// end of static declarations ----
+
+size_t __fpx3d_cpu_count(void) {
+  long count = 1;
+
+#if defined(_WIN32) || defined(_WIN64)
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  count = (long)info.dwNumberOfProcessors;
+#else
+  count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+  return (size_t)CLAMP(count, 1L, (long)MAX_WORKER_THREADS);
+}
+
+// runs `function(context, i)` for every i in [0, count), spread over at most
+// `thread_count` threads (0 means one per CPU). The calling thread takes part
+// in the work, so this also completes if no threads could be spawned
+Fpx3d_E_Result __fpx3d_parallel_for(size_t count, size_t thread_count,
+                                    void (*function)(void *, size_t),
+                                    void *context) {
+  NULL_CHECK(function, FPX3D_ARGS_ERROR);
+
+  if (1 > count)
+    return FPX3D_SUCCESS;
+
+  if (1 > thread_count)
+    thread_count = __fpx3d_cpu_count();
+
+  thread_count = MIN(thread_count, count);
+  thread_count = MIN(thread_count, (size_t)MAX_WORKER_THREADS);
+
+  struct _parallel_job job = {
+      .function = function,
+      .context = context,
+      .count = count,
+  };
+  atomic_init(&job.next, 0);
+
+  pthread_t threads[MAX_WORKER_THREADS];
+  size_t spawned = 0;
+
+  for (size_t i = 1; i < thread_count; ++i) {
+    if (0 != pthread_create(&threads[spawned], NULL, _worker_loop, &job)) {
+      FPX3D_WARN("Could only spawn %" LONG_FORMAT "u worker thread(s)",
+                 spawned);
+      break;
+    }
+
+    ++spawned;
+  }
+
+  _worker_loop(&job);
+
+  for (size_t i = 0; i < spawned; ++i)
+    pthread_join(threads[i], NULL);
+
+  return FPX3D_SUCCESS;
+}
+
+// STATIC FUNCTIONS ----
+
+static void *_worker_loop(void *job_ptr) {
+  struct _parallel_job *job = (struct _parallel_job *)job_ptr;
+
+  for (;;) {
+    size_t index = atomic_fetch_add(&job->next, 1);
+    if (index >= job->count)
+      break;
+
+    job->function(job->context, index);
+  }
+
+  return NULL;
+}
+
+// END OF STATIC FUNCTIONS ----
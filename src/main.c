@@ -25,7 +25,6 @@
 
 #endif
 
-#define STB_IMAGE_IMPLEMENTATION
 #include "stb/stb_image.h"
 
 #define GLM_FORCE_RADIANS
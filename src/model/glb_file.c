@@ -0,0 +1,683 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+#include "model/gltf.h"
+#include "model/typedefs.h"
+
+#define GLB_HEADER_SIZE 12
+#define GLB_CHUNK_HEADER_SIZE 8
+
+// ranges less than this far apart are read together. The bytes in
+// between are read into a scratch buffer and thrown away, which is
+// cheaper than a second request for anything but huge gaps
+#define COALESCE_GAP (64 * 1024)
+
+// extents start 4-byte aligned in the file (like glTF views do), and are
+// kept at that alignment inside a block
+#define EXTENT_ALIGNMENT 4
+#define ALIGN_EXTENT_DOWN(value)                                               \
+  ((value) & ~(size_t)(EXTENT_ALIGNMENT - 1))
+#define ALIGN_EXTENT_UP(value)                                                 \
+  ALIGN_EXTENT_DOWN((value) + EXTENT_ALIGNMENT - 1)
+
+extern Fpx3d_E_Result __fpx3d_open_file(const char *path, void **output,
+                                        size_t *output_size);
+extern void __fpx3d_close_file(void *file);
+extern Fpx3d_E_Result __fpx3d_read_file_scatter(void *file, size_t offset,
+                                                void *const *buffers,
+                                                const size_t *lengths,
+                                                size_t count);
+
+extern Fpx3d_E_Result
+__fpx3d_model_gltf_decode_view_data(Fpx3d_Model_GltfBufferView *view,
+                                    const uint8_t *input);
+
+struct fpx3d_model_glb_block {
+  // number of views pointing into this block
+  size_t refs;
+
+  size_t size;
+  uint8_t data[];
+};
+
+// a view (or its compressed source) waiting to be read
+struct _pending_range {
+  size_t view;
+
+  // relative to the start of the BIN chunk
+  size_t offset;
+  size_t length;
+};
+
+// static declarations ----
+
+static Fpx3d_E_Result _read_u32s(void *file, size_t offset, uint32_t *output,
+                                 size_t count);
+
+static bool _in_bin_chunk(const Fpx3d_Model_GltfBufferView *view,
+                          size_t *offset, size_t *length);
+
+static void _collect_views(const Fpx3d_Model_GltfAssetDescription *desc,
+                           Fpx3d_Model_E_GltfEntityType type, size_t index,
+                           bool *views, bool *nodes_seen);
+
+static int _compare_ranges(const void *a, const void *b);
+
+static Fpx3d_E_Result _read_block(Fpx3d_Model_GlbFile *glb,
+                                  const struct _pending_range *ranges,
+                                  size_t count, void *scratch);
+
+static void _drop_view(Fpx3d_Model_GlbFile *glb, size_t view);
+
+static Fpx3d_E_Result _views_of(Fpx3d_Model_GlbFile *glb,
+                                Fpx3d_Model_E_GltfEntityType type,
+                                size_t index, bool **output);
+
+// end of static declarations ----
+
+Fpx3d_E_Result fpx3d_model_open_glb(const char *path,
+                                    Fpx3d_Model_GlbFile *output) {
+  NULL_CHECK(path, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  Fpx3d_Model_GlbFile glb = {0};
+  size_t file_size = 0;
+  uint8_t *json = NULL;
+
+  retval = __fpx3d_open_file(path, &glb.file, &file_size);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+#define OPEN_FAIL(code)                                                        \
+  {                                                                            \
+    retval = code;                                                             \
+    goto open_glb_fail;                                                        \
+  }
+
+  // magic, version, length, then the JSON chunk's length and type
+  uint32_t header[5] = {0};
+
+  if (GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE > file_size)
+    OPEN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+  retval = _read_u32s(glb.file, 0, header, ARRAY_SIZE(header));
+  if (FPX3D_SUCCESS != retval)
+    OPEN_FAIL(retval);
+
+  if (0x46546C67 != header[0] || 2 != header[1] || file_size < header[2] ||
+      0x4E4F534A != header[4])
+    OPEN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+  size_t glb_length = header[2];
+  size_t json_length = header[3];
+  size_t json_offset = GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE;
+
+  if (json_offset + json_length > glb_length)
+    OPEN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+  json = malloc(MAX(json_length, (size_t)1));
+  if (NULL == json)
+    OPEN_FAIL(FPX3D_MEMORY_ERROR);
+
+  {
+    void *buffers[] = {json};
+    size_t lengths[] = {json_length};
+
+    retval = __fpx3d_read_file_scatter(glb.file, json_offset, buffers, lengths,
+                                       1);
+    if (FPX3D_SUCCESS != retval)
+      OPEN_FAIL(retval);
+  }
+
+  size_t bin_header_offset = json_offset + json_length;
+
+  if (bin_header_offset + GLB_CHUNK_HEADER_SIZE <= glb_length) {
+    uint32_t bin_header[2] = {0};
+
+    retval = _read_u32s(glb.file, bin_header_offset, bin_header,
+                        ARRAY_SIZE(bin_header));
+    if (FPX3D_SUCCESS != retval)
+      OPEN_FAIL(retval);
+
+    glb.binOffset = bin_header_offset + GLB_CHUNK_HEADER_SIZE;
+    glb.binLength = bin_header[0];
+
+    if (0x004E4942 != bin_header[1] ||
+        glb.binOffset + glb.binLength > glb_length)
+      OPEN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+  }
+
+  // on its own, the JSON chunk is just a glTF document
+  retval = fpx3d_model_read_gltf_lazy(json, json_length, &glb.asset);
+  if (FPX3D_SUCCESS != retval)
+    OPEN_FAIL(retval);
+
+  FREE_SAFE(json);
+
+  size_t view_count = glb.asset.gltf.bufferViewCount;
+
+  glb.viewRefs = calloc(view_count + 1, sizeof(size_t));
+  glb.viewBlocks = calloc(view_count + 1, sizeof(glb.viewBlocks[0]));
+
+  if (NULL == glb.viewRefs || NULL == glb.viewBlocks)
+    OPEN_FAIL(FPX3D_MEMORY_ERROR);
+
+#undef OPEN_FAIL
+
+  FPX3D_DEBUG("Opened GLB \"%s\": %" LONG_FORMAT
+              "u bytes of JSON, %" LONG_FORMAT "u bytes of binary data",
+              path, json_length, glb.binLength);
+
+  *output = glb;
+
+  return FPX3D_SUCCESS;
+
+open_glb_fail:
+  FREE_SAFE(json);
+  FREE_SAFE(glb.viewRefs);
+  FREE_SAFE(glb.viewBlocks);
+  fpx3d_model_destroy_gltf(&glb.asset);
+  __fpx3d_close_file(glb.file);
+
+  return retval;
+}
+
+void fpx3d_model_close_glb(Fpx3d_Model_GlbFile *glb) {
+  NULL_CHECK(glb, );
+
+  size_t view_count = glb->asset.gltf.bufferViewCount;
+
+  for (size_t i = 0; NULL != glb->viewRefs && i < view_count; ++i) {
+    if (0 < glb->viewRefs[i])
+      _drop_view(glb, i);
+  }
+
+  FREE_SAFE(glb->viewRefs);
+  FREE_SAFE(glb->viewBlocks);
+
+  fpx3d_model_destroy_gltf(&glb->asset);
+
+  if (NULL != glb->file)
+    __fpx3d_close_file(glb->file);
+
+  memset(glb, 0, sizeof(*glb));
+
+  return;
+}
+
+Fpx3d_E_Result fpx3d_model_glb_load(Fpx3d_Model_GlbFile *glb,
+                                    Fpx3d_Model_E_GltfEntityType type,
+                                    size_t index) {
+  NULL_CHECK(glb, FPX3D_ARGS_ERROR);
+  NULL_CHECK(glb->file, FPX3D_ARGS_ERROR);
+
+  Fpx3d_E_Result retval = fpx3d_model_gltf_require(&glb->asset, type, index);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  Fpx3d_Model_GltfAssetDescription *desc = &glb->asset.gltf;
+
+  bool *views = NULL;
+  struct _pending_range *pending = NULL;
+  void *scratch = NULL;
+  size_t pending_count = 0;
+
+  retval = _views_of(glb, type, index, &views);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  pending = calloc(desc->bufferViewCount + 1, sizeof(*pending));
+  if (NULL == pending) {
+    FREE_SAFE(views);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  for (size_t i = 0; i < desc->bufferViewCount; ++i) {
+    size_t offset = 0, length = 0;
+
+    if (!views[i] || 0 < glb->viewRefs[i] ||
+        !_in_bin_chunk(&desc->bufferViews[i], &offset, &length))
+      continue;
+
+    if (offset + length > glb->binLength) {
+      FPX3D_WARN("Buffer view %" LONG_FORMAT "u lies outside the BIN chunk",
+                 i);
+      FREE_SAFE(pending);
+      FREE_SAFE(views);
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+    }
+
+    pending[pending_count].view = i;
+    pending[pending_count].offset = offset;
+    pending[pending_count].length = length;
+    ++pending_count;
+  }
+
+  // take the references before reading, so a failure below can
+  // be undone with the same bookkeeping as a release
+  for (size_t i = 0; i < desc->bufferViewCount; ++i) {
+    if (views[i])
+      ++glb->viewRefs[i];
+  }
+
+  if (0 == pending_count)
+    goto load_cleanup;
+
+  qsort(pending, pending_count, sizeof(*pending), _compare_ranges);
+
+  scratch = malloc(COALESCE_GAP);
+  if (NULL == scratch) {
+    retval = FPX3D_MEMORY_ERROR;
+    goto load_cleanup;
+  }
+
+  for (size_t first = 0; first < pending_count;) {
+    size_t end = pending[first].offset + pending[first].length;
+    size_t last = first + 1;
+
+    for (; last < pending_count && pending[last].offset <= end + COALESCE_GAP;
+         ++last)
+      end = MAX(end, pending[last].offset + pending[last].length);
+
+    retval = _read_block(glb, &pending[first], last - first, scratch);
+    if (FPX3D_SUCCESS != retval)
+      goto load_cleanup;
+
+    first = last;
+  }
+
+load_cleanup:
+  if (FPX3D_SUCCESS != retval) {
+    for (size_t i = 0; i < desc->bufferViewCount; ++i) {
+      if (views[i] && 0 < glb->viewRefs[i] && 0 == --glb->viewRefs[i])
+        _drop_view(glb, i);
+    }
+  }
+
+  FREE_SAFE(scratch);
+  FREE_SAFE(pending);
+  FREE_SAFE(views);
+
+  return retval;
+}
+
+Fpx3d_E_Result fpx3d_model_glb_release(Fpx3d_Model_GlbFile *glb,
+                                       Fpx3d_Model_E_GltfEntityType type,
+                                       size_t index) {
+  NULL_CHECK(glb, FPX3D_ARGS_ERROR);
+
+  bool *views = NULL;
+
+  Fpx3d_E_Result retval = _views_of(glb, type, index, &views);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  for (size_t i = 0; i < glb->asset.gltf.bufferViewCount; ++i) {
+    if (views[i] && 0 < glb->viewRefs[i] && 0 == --glb->viewRefs[i])
+      _drop_view(glb, i);
+  }
+
+  FREE_SAFE(views);
+
+  return FPX3D_SUCCESS;
+}
+
+// STATIC FUNCTIONS ----
+
+static Fpx3d_E_Result _read_u32s(void *file, size_t offset, uint32_t *output,
+                                 size_t count) {
+  uint8_t bytes[32];
+  if (count * 4 > sizeof(bytes))
+    return FPX3D_ARGS_ERROR;
+
+  void *buffers[] = {bytes};
+  size_t lengths[] = {count * 4};
+
+  Fpx3d_E_Result retval =
+      __fpx3d_read_file_scatter(file, offset, buffers, lengths, 1);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  // GLB is little-endian regardless of the host
+  for (size_t i = 0; i < count; ++i)
+    output[i] = (uint32_t)bytes[i * 4] | (uint32_t)bytes[i * 4 + 1] << 8 |
+                (uint32_t)bytes[i * 4 + 2] << 16 |
+                (uint32_t)bytes[i * 4 + 3] << 24;
+
+  return FPX3D_SUCCESS;
+}
+
+// the range of the BIN chunk that has to be read for this view.
+// Views of external (uri) buffers are not this file's business
+static bool _in_bin_chunk(const Fpx3d_Model_GltfBufferView *view,
+                          size_t *offset, size_t *length) {
+  if (view->meshopt.isCompressed) {
+    if (NULL == view->meshopt.buffer || NULL != view->meshopt.buffer->uri ||
+        NULL != view->decodedData)
+      return false;
+
+    *offset = view->meshopt.byteOffset;
+    *length = view->meshopt.byteLength;
+    return true;
+  }
+
+  if (NULL == view->buffer || NULL != view->buffer->uri)
+    return false;
+
+  *offset = view->byteOffset;
+  *length = view->byteLength;
+  return true;
+}
+
+static void _collect_views(const Fpx3d_Model_GltfAssetDescription *desc,
+                           Fpx3d_Model_E_GltfEntityType type, size_t index,
+                           bool *views, bool *nodes_seen) {
+#define COLLECT(entity_type, pointer, array)                                   \
+  {                                                                            \
+    if (NULL != (pointer))                                                     \
+      _collect_views(desc, entity_type, (pointer) - desc->array, views,        \
+                     nodes_seen);                                              \
+  }
+
+  switch (type) {
+  case FPX3D_GLTF_ENTITY_SCENE:
+    for (size_t i = 0; i < desc->scenes[index].nodeCount; ++i)
+      COLLECT(FPX3D_GLTF_ENTITY_NODE, desc->scenes[index].nodes[i], nodes);
+    break;
+
+  case FPX3D_GLTF_ENTITY_NODE: {
+    if (nodes_seen[index])
+      break;
+    nodes_seen[index] = true;
+
+    const Fpx3d_Model_GltfNode *node = &desc->nodes[index];
+
+    COLLECT(FPX3D_GLTF_ENTITY_MESH, node->mesh, meshes);
+    COLLECT(FPX3D_GLTF_ENTITY_SKIN, node->skin, skins);
+
+    for (size_t i = 0; i < node->childCount; ++i)
+      COLLECT(FPX3D_GLTF_ENTITY_NODE, node->children[i], nodes);
+  } break;
+
+  case FPX3D_GLTF_ENTITY_MESH: {
+    const Fpx3d_Model_GltfMesh *mesh = &desc->meshes[index];
+
+    for (size_t p = 0; p < mesh->primitiveCount; ++p) {
+      const struct fpx3d_model_gltf_mesh_primitive *prim =
+          &mesh->primitives[p];
+
+      for (size_t a = 0; a < prim->attributeCount; ++a)
+        COLLECT(FPX3D_GLTF_ENTITY_ACCESSOR, prim->attributes[a].accessor,
+                accessors);
+
+      for (size_t t = 0; t < prim->morphTargetCount; ++t) {
+        for (size_t a = 0; a < prim->morphTargets[t].attributeCount; ++a)
+          COLLECT(FPX3D_GLTF_ENTITY_ACCESSOR,
+                  prim->morphTargets[t].attributes[a].accessor, accessors);
+      }
+
+      COLLECT(FPX3D_GLTF_ENTITY_ACCESSOR, prim->indices, accessors);
+      COLLECT(FPX3D_GLTF_ENTITY_MATERIAL, prim->material, materials);
+    }
+  } break;
+
+  case FPX3D_GLTF_ENTITY_ACCESSOR: {
+    const Fpx3d_Model_GltfAccessor *acc = &desc->accessors[index];
+
+    COLLECT(FPX3D_GLTF_ENTITY_BUFFER_VIEW, acc->view, bufferViews);
+    COLLECT(FPX3D_GLTF_ENTITY_BUFFER_VIEW, acc->sparse.indices.view,
+            bufferViews);
+    COLLECT(FPX3D_GLTF_ENTITY_BUFFER_VIEW, acc->sparse.values.view,
+            bufferViews);
+  } break;
+
+  case FPX3D_GLTF_ENTITY_BUFFER_VIEW:
+    views[index] = true;
+    break;
+
+  case FPX3D_GLTF_ENTITY_IMAGE:
+    COLLECT(FPX3D_GLTF_ENTITY_BUFFER_VIEW, desc->images[index].bufferView,
+            bufferViews);
+    break;
+
+  case FPX3D_GLTF_ENTITY_TEXTURE:
+    COLLECT(FPX3D_GLTF_ENTITY_IMAGE, desc->textures[index].sourceImage,
+            images);
+    break;
+
+  case FPX3D_GLTF_ENTITY_MATERIAL: {
+    const Fpx3d_Model_GltfMaterial *mat = &desc->materials[index];
+
+    COLLECT(FPX3D_GLTF_ENTITY_TEXTURE,
+            mat->pbrMetallicRoughness.baseColorTexture.texture, textures);
+    COLLECT(FPX3D_GLTF_ENTITY_TEXTURE,
+            mat->pbrMetallicRoughness.metallicRoughnessTexture.texture,
+            textures);
+    COLLECT(FPX3D_GLTF_ENTITY_TEXTURE, mat->normalTexture.textureInfo.texture,
+            textures);
+    COLLECT(FPX3D_GLTF_ENTITY_TEXTURE,
+            mat->occlusionTexture.textureInfo.texture, textures);
+    COLLECT(FPX3D_GLTF_ENTITY_TEXTURE, mat->emissiveTexture.texture,
+            textures);
+  } break;
+
+  case FPX3D_GLTF_ENTITY_SKIN:
+    COLLECT(FPX3D_GLTF_ENTITY_ACCESSOR, desc->skins[index].inverseBindMatrices,
+            accessors);
+    break;
+
+  case FPX3D_GLTF_ENTITY_ANIMATION: {
+    const Fpx3d_Model_GltfAnimation *anim = &desc->animations[index];
+
+    for (size_t i = 0; i < anim->samplerCount; ++i) {
+      COLLECT(FPX3D_GLTF_ENTITY_ACCESSOR, anim->samplers[i].keyframes,
+              accessors);
+      COLLECT(FPX3D_GLTF_ENTITY_ACCESSOR, anim->samplers[i].outputValues,
+              accessors);
+    }
+  } break;
+
+  default:
+    // cameras, buffers and samplers hold no buffer data
+    break;
+  }
+
+#undef COLLECT
+}
+
+static Fpx3d_E_Result _views_of(Fpx3d_Model_GlbFile *glb,
+                                Fpx3d_Model_E_GltfEntityType type,
+                                size_t index, bool **output) {
+  const Fpx3d_Model_GltfAssetDescription *desc = &glb->asset.gltf;
+
+  // only validates the type and index; requiring is a no-op if
+  // the entity is parsed already
+  Fpx3d_E_Result retval = fpx3d_model_gltf_require(&glb->asset, type, index);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  bool *views = calloc(desc->bufferViewCount + 1, sizeof(bool));
+  bool *nodes_seen = calloc(desc->nodeCount + 1, sizeof(bool));
+
+  if (NULL == views || NULL == nodes_seen) {
+    FREE_SAFE(views);
+    FREE_SAFE(nodes_seen);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  _collect_views(desc, type, index, views, nodes_seen);
+
+  FREE_SAFE(nodes_seen);
+
+  *output = views;
+
+  return FPX3D_SUCCESS;
+}
+
+static int _compare_ranges(const void *a, const void *b) {
+  const struct _pending_range *ra = a, *rb = b;
+
+  if (ra->offset != rb->offset)
+    return (ra->offset < rb->offset) ? -1 : 1;
+
+  return (ra->length < rb->length) ? -1 : (ra->length > rb->length);
+}
+
+// reads the sorted, coalescable `ranges` with one scattered read. Only the
+// bytes of the ranges themselves end up in the block
+static Fpx3d_E_Result _read_block(Fpx3d_Model_GlbFile *glb,
+                                  const struct _pending_range *ranges,
+                                  size_t count, void *scratch) {
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  // at most one extent and one gap per range
+  void **buffers = calloc(count * 2, sizeof(void *));
+  size_t *lengths = calloc(count * 2, sizeof(size_t));
+
+  // per range: where its extent starts in the file and in the block
+  size_t *extent_file = calloc(count, sizeof(size_t));
+  size_t *extent_block = calloc(count, sizeof(size_t));
+
+  struct fpx3d_model_glb_block *block = NULL;
+
+#define BLOCK_FAIL(code)                                                       \
+  {                                                                            \
+    retval = code;                                                             \
+    goto read_block_cleanup;                                                   \
+  }
+
+  if (NULL == buffers || NULL == lengths || NULL == extent_file ||
+      NULL == extent_block)
+    BLOCK_FAIL(FPX3D_MEMORY_ERROR);
+
+  // first pass: merge overlapping ranges into extents, and lay them out
+  size_t block_size = 0;
+  size_t start = ALIGN_EXTENT_DOWN(ranges[0].offset);
+  size_t extent_start = start, extent_end = start;
+
+  for (size_t i = 0; i < count; ++i) {
+    size_t range_start = ALIGN_EXTENT_DOWN(ranges[i].offset);
+    size_t range_end = ranges[i].offset + ranges[i].length;
+
+    if (range_start > extent_end) {
+      block_size += ALIGN_EXTENT_UP(extent_end - extent_start);
+      extent_start = range_start;
+      extent_end = range_start;
+    }
+
+    extent_file[i] = extent_start;
+    extent_block[i] = block_size;
+    extent_end = MAX(extent_end, range_end);
+  }
+
+  block_size += ALIGN_EXTENT_UP(extent_end - extent_start);
+
+  block = malloc(sizeof(*block) + MAX(block_size, (size_t)1));
+  if (NULL == block)
+    BLOCK_FAIL(FPX3D_MEMORY_ERROR);
+
+  block->refs = 0;
+  block->size = block_size;
+
+  // second pass: one buffer per extent, and scratch for the gaps
+  size_t buffer_count = 0;
+  size_t position = start;
+
+  for (size_t i = 0; i < count; ++i) {
+    if (0 < i && extent_file[i] == extent_file[i - 1])
+      continue;
+
+    // where this extent ends
+    size_t end = 0;
+    for (size_t j = i; j < count && extent_file[j] == extent_file[i]; ++j)
+      end = MAX(end, ranges[j].offset + ranges[j].length);
+
+    if (extent_file[i] > position) {
+      buffers[buffer_count] = scratch;
+      lengths[buffer_count] = extent_file[i] - position;
+      ++buffer_count;
+    }
+
+    buffers[buffer_count] = &block->data[extent_block[i]];
+    lengths[buffer_count] = end - extent_file[i];
+    ++buffer_count;
+
+    position = end;
+  }
+
+  retval = __fpx3d_read_file_scatter(glb->file, glb->binOffset + start,
+                                     buffers, lengths, buffer_count);
+  if (FPX3D_SUCCESS != retval)
+    BLOCK_FAIL(retval);
+
+  glb->residentBytes += block_size;
+
+  for (size_t i = 0; i < count; ++i) {
+    Fpx3d_Model_GltfBufferView *view =
+        &glb->asset.gltf.bufferViews[ranges[i].view];
+
+    view->residentData =
+        &block->data[extent_block[i] + (ranges[i].offset - extent_file[i])];
+
+    glb->viewBlocks[ranges[i].view] = block;
+    ++block->refs;
+
+    if (view->meshopt.isCompressed) {
+      retval = __fpx3d_model_gltf_decode_view_data(view, view->residentData);
+      if (FPX3D_SUCCESS != retval)
+        BLOCK_FAIL(retval);
+    }
+  }
+
+  FPX3D_DEBUG("Read %" LONG_FORMAT "u views (%" LONG_FORMAT
+              "u bytes) from GLB at offset %" LONG_FORMAT "u",
+              count, block_size, start);
+
+#undef BLOCK_FAIL
+
+read_block_cleanup:
+  // once a view holds the block, the caller's rollback frees it
+  if (FPX3D_SUCCESS != retval && NULL != block && 0 == block->refs)
+    FREE_SAFE(block);
+
+  FREE_SAFE(buffers);
+  FREE_SAFE(lengths);
+  FREE_SAFE(extent_file);
+  FREE_SAFE(extent_block);
+
+  return retval;
+}
+
+static void _drop_view(Fpx3d_Model_GlbFile *glb, size_t view_index) {
+  Fpx3d_Model_GltfBufferView *view = &glb->asset.gltf.bufferViews[view_index];
+  struct fpx3d_model_glb_block *block = glb->viewBlocks[view_index];
+
+  glb->viewRefs[view_index] = 0;
+  glb->viewBlocks[view_index] = NULL;
+
+  if (NULL == block)
+    return;
+
+  view->residentData = NULL;
+
+  if (view->meshopt.isCompressed)
+    FREE_SAFE(view->decodedData);
+
+  if (0 == --block->refs) {
+    glb->residentBytes -= block->size;
+    free(block);
+  }
+}
+
+// END OF STATIC FUNCTIONS ----
@@ -3,6 +3,7 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "debug.h"
@@ -31,10 +32,70 @@ extern Fpx3d_E_Result __fpx3d_realloc_array(void **arr, size_t obj_size,
                                             size_t amount,
                                             size_t *old_capacity);
 
+extern Fpx3d_E_Result __fpx3d_model_meshopt_decode_vertices(
+    void *output, size_t vertex_count, size_t vertex_size,
+    const uint8_t *input, size_t input_length);
+extern Fpx3d_E_Result __fpx3d_model_meshopt_decode_triangles(
+    void *output, size_t index_count, size_t index_size, const uint8_t *input,
+    size_t input_length);
+extern Fpx3d_E_Result __fpx3d_model_meshopt_decode_indices(
+    void *output, size_t index_count, size_t index_size, const uint8_t *input,
+    size_t input_length);
+extern Fpx3d_E_Result
+__fpx3d_model_meshopt_filter_octahedral(void *data, size_t count,
+                                        size_t stride);
+extern Fpx3d_E_Result
+__fpx3d_model_meshopt_filter_quaternion(void *data, size_t count,
+                                        size_t stride);
+extern Fpx3d_E_Result
+__fpx3d_model_meshopt_filter_exponential(void *data, size_t count,
+                                         size_t stride);
+
+struct _lazy_span {
+  size_t offset;
+  size_t length;
+};
+
+struct fpx3d_model_gltf_lazy_state {
+  // copy of the JSON text; spans point into this
+  char *json;
+  size_t jsonLength;
+
+  struct {
+    struct _lazy_span *spans;
+    bool *parsed;
+  } entities[FPX3D_GLTF_ENTITY_TYPE_COUNT];
+};
+
+// top-level keys, indexed by Fpx3d_Model_E_GltfEntityType
+static const char *const entity_keys[FPX3D_GLTF_ENTITY_TYPE_COUNT] = {
+    "scenes",
+    "cameras",
+    "nodes",
+    "meshes",
+    "buffers",
+    "bufferViews",
+    "accessors",
+    "images",
+    "samplers",
+    "textures",
+    "materials",
+    "skins",
+    "animations",
+};
+
+static Fpx3d_E_Result _read_gltf(const uint8_t *data, size_t datalength,
+                                 Fpx3d_Model_GltfAsset *output, bool lazy);
+
 static Fpx3d_E_Result
 _json_to_asset_desc(const uint8_t *data, const uint8_t *limit,
                     Fpx3d_Model_GltfAssetDescription *output);
 
+// only records the byte span of every element of the top-level arrays
+static Fpx3d_E_Result
+_scan_json_to_asset_desc(const uint8_t *data, const uint8_t *limit,
+                         Fpx3d_Model_GltfAssetDescription *output);
+
 // expects bytes 0,1,2,3 to be chunk_length
 // expects bytes 4,5,6,7 to be "JSON"
 // returns FPX3D_MODEL_ERROR otherwise
@@ -50,13 +111,13 @@ static void _free_top_level(Fpx3d_Model_GltfAssetDescription *asset_desc);
 static Fpx_Json_Value *_get_value_by_key(Fpx_Json_Object *obj, const char *key,
                                          Fpx_Json_E_ValueType type);
 
-static Fpx3d_E_Result _parse_scenes(Fpx_Json_Array *scenes,
+static Fpx3d_E_Result _parse_scenes(Fpx_Json_Array *scenes, size_t first,
                                     Fpx3d_Model_GltfAssetDescription *output);
 
-static Fpx3d_E_Result _parse_cameras(Fpx_Json_Array *cameras,
+static Fpx3d_E_Result _parse_cameras(Fpx_Json_Array *cameras, size_t first,
                                      Fpx3d_Model_GltfAssetDescription *output);
 
-static Fpx3d_E_Result _parse_nodes(Fpx_Json_Array *nodes,
+static Fpx3d_E_Result _parse_nodes(Fpx_Json_Array *nodes, size_t first,
                                    Fpx3d_Model_GltfAssetDescription *output);
 
 static Fpx3d_E_Result _parse_primitive_attributes(
@@ -68,27 +129,39 @@ _parse_mesh_primitives(Fpx_Json_Array *primitives,
                        struct fpx3d_model_gltf_mesh_primitive *output,
                        Fpx3d_Model_GltfAssetDescription *parent_asset);
 
-static Fpx3d_E_Result _parse_meshes(Fpx_Json_Array *meshes,
+static Fpx3d_E_Result _parse_meshes(Fpx_Json_Array *meshes, size_t first,
                                     Fpx3d_Model_GltfAssetDescription *output);
 
-static Fpx3d_E_Result _parse_buffers(Fpx_Json_Array *buffers,
+static Fpx3d_E_Result _parse_buffers(Fpx_Json_Array *buffers, size_t first,
                                      Fpx3d_Model_GltfAssetDescription *output);
 
 static Fpx3d_E_Result
-_parse_buffer_views(Fpx_Json_Array *views,
+_parse_buffer_views(Fpx_Json_Array *views, size_t first,
                     Fpx3d_Model_GltfAssetDescription *output);
 
 static Fpx3d_E_Result
-_parse_accessors(Fpx_Json_Array *accessors,
+_parse_meshopt_extension(Fpx_Json_Object *extension,
+                         Fpx3d_Model_GltfBufferView *output,
+                         Fpx3d_Model_GltfAssetDescription *parent_asset);
+
+// decodes every compressed bufferView whose source buffer has data.
+// `glb_binary` may be NULL; if not, it is used as the source for the
+// GLB-embedded buffer (the one without a uri)
+static Fpx3d_E_Result
+_decode_compressed_views(Fpx3d_Model_GltfAssetDescription *asset_desc,
+                         const Fpx3d_Model_GltfBuffer *glb_binary);
+
+static Fpx3d_E_Result
+_parse_accessors(Fpx_Json_Array *accessors, size_t first,
                  Fpx3d_Model_GltfAssetDescription *output);
 
-static Fpx3d_E_Result _parse_images(Fpx_Json_Array *images,
+static Fpx3d_E_Result _parse_images(Fpx_Json_Array *images, size_t first,
                                     Fpx3d_Model_GltfAssetDescription *output);
 
-static Fpx3d_E_Result _parse_samplers(Fpx_Json_Array *samplers,
+static Fpx3d_E_Result _parse_samplers(Fpx_Json_Array *samplers, size_t first,
                                       Fpx3d_Model_GltfAssetDescription *output);
 
-static Fpx3d_E_Result _parse_textures(Fpx_Json_Array *textures,
+static Fpx3d_E_Result _parse_textures(Fpx_Json_Array *textures, size_t first,
                                       Fpx3d_Model_GltfAssetDescription *output);
 
 static Fpx3d_E_Result
@@ -97,22 +170,109 @@ _parse_tex_info(Fpx_Json_Object *texture_info,
                 Fpx3d_Model_GltfAssetDescription *asset);
 
 static Fpx3d_E_Result
-_parse_materials(Fpx_Json_Array *materials,
+_parse_materials(Fpx_Json_Array *materials, size_t first,
                  Fpx3d_Model_GltfAssetDescription *output);
 
-static Fpx3d_E_Result _parse_skins(Fpx_Json_Array *skins,
+static Fpx3d_E_Result _parse_skins(Fpx_Json_Array *skins, size_t first,
                                    Fpx3d_Model_GltfAssetDescription *output);
 
 static Fpx3d_E_Result
-_parse_animations(Fpx_Json_Array *animations,
+_parse_animations(Fpx_Json_Array *animations, size_t first,
                   Fpx3d_Model_GltfAssetDescription *output);
 
+static Fpx3d_E_Result _decode_view(Fpx3d_Model_GltfBufferView *view,
+                                   size_t view_index,
+                                   const Fpx3d_Model_GltfBuffer *glb_binary);
+
+Fpx3d_E_Result
+__fpx3d_model_gltf_decode_view_data(Fpx3d_Model_GltfBufferView *view,
+                                    const uint8_t *input);
+
+static size_t _entity_count(const Fpx3d_Model_GltfAssetDescription *desc,
+                            Fpx3d_Model_E_GltfEntityType type);
+
+static Fpx3d_E_Result
+_alloc_entities(Fpx3d_Model_GltfAssetDescription *desc,
+                Fpx3d_Model_E_GltfEntityType type, size_t count);
+
+static const uint8_t *_skip_json_string(const uint8_t *data,
+                                        const uint8_t *limit);
+static const uint8_t *_skip_json_value(const uint8_t *data,
+                                       const uint8_t *limit);
+
+static Fpx3d_E_Result
+_lazy_parse(Fpx3d_Model_GltfAssetDescription *desc,
+            Fpx3d_Model_E_GltfEntityType type, size_t index);
+
+static Fpx3d_E_Result
+_lazy_require(Fpx3d_Model_GltfAssetDescription *desc,
+              const Fpx3d_Model_GltfBuffer *glb_binary,
+              Fpx3d_Model_E_GltfEntityType type, size_t index);
+
+static void _free_lazy_state(struct fpx3d_model_gltf_lazy_state *state);
+
 static void _destroy_asset_desc(Fpx3d_Model_GltfAssetDescription *asset_desc);
 
 static void _destroy_chunk(struct fpx3d_model_glb_chunk *chunkptr);
 
 Fpx3d_E_Result fpx3d_model_read_gltf(const uint8_t *data, size_t datalength,
                                      Fpx3d_Model_GltfAsset *output) {
+  return _read_gltf(data, datalength, output, false);
+}
+
+Fpx3d_E_Result fpx3d_model_read_gltf_lazy(const uint8_t *data,
+                                          size_t datalength,
+                                          Fpx3d_Model_GltfAsset *output) {
+  return _read_gltf(data, datalength, output, true);
+}
+
+Fpx3d_E_Result fpx3d_model_gltf_require(Fpx3d_Model_GltfAsset *asset,
+                                        Fpx3d_Model_E_GltfEntityType type,
+                                        size_t index) {
+  NULL_CHECK(asset, FPX3D_ARGS_ERROR);
+
+  Fpx3d_Model_GltfAssetDescription *desc = fpx3d_model_gltf_description(asset);
+  NULL_CHECK(desc, FPX3D_ARGS_ERROR);
+
+  if (FPX3D_GLTF_ENTITY_TYPE_COUNT <= (size_t)type)
+    return FPX3D_ARGS_ERROR;
+
+  if (_entity_count(desc, type) <= index)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  if (NULL == desc->lazy)
+    return FPX3D_SUCCESS;
+
+  const Fpx3d_Model_GltfBuffer *glb_binary =
+      (FPX3D_GLTF_CONTAINER_GLB == asset->containerType &&
+       FPX3D_GLB_CHUNK_BINARY == asset->glb.chunks[1].type)
+          ? &asset->glb.chunks[1].binary
+          : NULL;
+
+  return _lazy_require(desc, glb_binary, type, index);
+}
+
+bool fpx3d_model_gltf_is_parsed(const Fpx3d_Model_GltfAsset *asset,
+                                Fpx3d_Model_E_GltfEntityType type,
+                                size_t index) {
+  NULL_CHECK(asset, false);
+
+  const Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(asset);
+  NULL_CHECK(desc, false);
+
+  if (FPX3D_GLTF_ENTITY_TYPE_COUNT <= (size_t)type ||
+      _entity_count(desc, type) <= index)
+    return false;
+
+  if (NULL == desc->lazy)
+    return true;
+
+  return desc->lazy->entities[type].parsed[index];
+}
+
+static Fpx3d_E_Result _read_gltf(const uint8_t *data, size_t datalength,
+                                 Fpx3d_Model_GltfAsset *output, bool lazy) {
   NULL_CHECK(data, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
@@ -151,11 +311,21 @@ Fpx3d_E_Result fpx3d_model_read_gltf(const uint8_t *data, size_t datalength,
 
   if (new_asset.containerType == FPX3D_GLTF_CONTAINER_GLTF) {
     Fpx3d_E_Result json_result =
-        _json_to_asset_desc(data, limit, &new_asset.gltf);
+        lazy ? _scan_json_to_asset_desc(data, limit, &new_asset.gltf)
+             : _json_to_asset_desc(data, limit, &new_asset.gltf);
 
     if (FPX3D_SUCCESS > json_result)
       return json_result;
 
+    // lazily read views are decoded when they are required
+    Fpx3d_E_Result decode_result =
+        lazy ? FPX3D_SUCCESS : _decode_compressed_views(&new_asset.gltf, NULL);
+
+    if (FPX3D_SUCCESS > decode_result) {
+      _destroy_asset_desc(&new_asset.gltf);
+      return decode_result;
+    }
+
   } else if (new_asset.containerType == FPX3D_GLTF_CONTAINER_GLB) {
 
     // now we parse chunks
@@ -185,8 +355,12 @@ Fpx3d_E_Result fpx3d_model_read_gltf(const uint8_t *data, size_t datalength,
         FPX3D_DEBUG(" - Found JSON glb chunk");
         new_asset.glb.chunks[chunk_idx].type = FPX3D_GLB_CHUNK_JSON;
 
-        Fpx3d_E_Result json_result = _json_to_asset_desc(
-            data, data + chunk_len, &new_asset.glb.chunks[chunk_idx].json);
+        Fpx3d_E_Result json_result =
+            lazy ? _scan_json_to_asset_desc(
+                       data, data + chunk_len,
+                       &new_asset.glb.chunks[chunk_idx].json)
+                 : _json_to_asset_desc(data, data + chunk_len,
+                                       &new_asset.glb.chunks[chunk_idx].json);
 
         if (FPX3D_SUCCESS > json_result) {
           UNWIND_ASSET(json_result);
@@ -211,6 +385,25 @@ Fpx3d_E_Result fpx3d_model_read_gltf(const uint8_t *data, size_t datalength,
 
 #undef UNWIND_ASSET
     }
+
+    // the JSON chunk always comes first, so the BIN chunk is only known
+    // once all chunks have been read
+    if (!lazy && FPX3D_GLB_CHUNK_JSON == new_asset.glb.chunks[0].type) {
+      const Fpx3d_Model_GltfBuffer *bin =
+          (FPX3D_GLB_CHUNK_BINARY == new_asset.glb.chunks[1].type)
+              ? &new_asset.glb.chunks[1].binary
+              : NULL;
+
+      Fpx3d_E_Result decode_result =
+          _decode_compressed_views(&new_asset.glb.chunks[0].json, bin);
+
+      if (FPX3D_SUCCESS > decode_result) {
+        for (size_t i = 0; i < ARRAY_SIZE(new_asset.glb.chunks); ++i)
+          _destroy_chunk(&new_asset.glb.chunks[i]);
+
+        return decode_result;
+      }
+    }
   }
 
   *output = new_asset;
@@ -218,6 +411,220 @@ Fpx3d_E_Result fpx3d_model_read_gltf(const uint8_t *data, size_t datalength,
   return FPX3D_SUCCESS;
 }
 
+void fpx3d_model_destroy_gltf(Fpx3d_Model_GltfAsset *asset) {
+  NULL_CHECK(asset, );
+
+  switch (asset->containerType) {
+  case FPX3D_GLTF_CONTAINER_GLTF:
+    _destroy_asset_desc(&asset->gltf);
+    break;
+
+  case FPX3D_GLTF_CONTAINER_GLB:
+    for (size_t i = 0; i < ARRAY_SIZE(asset->glb.chunks); ++i)
+      _destroy_chunk(&asset->glb.chunks[i]);
+    break;
+
+  default:
+    break;
+  }
+
+  memset(asset, 0, sizeof(*asset));
+
+  return;
+}
+
+Fpx3d_Model_GltfAssetDescription *
+fpx3d_model_gltf_description(const Fpx3d_Model_GltfAsset *asset) {
+  NULL_CHECK(asset, NULL);
+
+  switch (asset->containerType) {
+  case FPX3D_GLTF_CONTAINER_GLTF:
+    return (Fpx3d_Model_GltfAssetDescription *)&asset->gltf;
+
+  case FPX3D_GLTF_CONTAINER_GLB:
+    if (FPX3D_GLB_CHUNK_JSON == asset->glb.chunks[0].type)
+      return (Fpx3d_Model_GltfAssetDescription *)&asset->glb.chunks[0].json;
+    break;
+
+  default:
+    break;
+  }
+
+  return NULL;
+}
+
+const uint8_t *
+__fpx3d_model_gltf_view_data(const Fpx3d_Model_GltfAsset *asset,
+                             const Fpx3d_Model_GltfBufferView *view) {
+  NULL_CHECK(view, NULL);
+
+  if (NULL != view->decodedData)
+    return view->decodedData;
+
+  // compressed but not decoded; the fallback buffer holds no usable data
+  if (view->meshopt.isCompressed)
+    return NULL;
+
+  if (NULL != view->residentData)
+    return view->residentData;
+
+  NULL_CHECK(view->buffer, NULL);
+
+  const Fpx3d_Model_GltfBuffer *source = view->buffer;
+
+  if (NULL == source->data && NULL == source->uri && NULL != asset &&
+      FPX3D_GLTF_CONTAINER_GLB == asset->containerType &&
+      FPX3D_GLB_CHUNK_BINARY == asset->glb.chunks[1].type)
+    source = &asset->glb.chunks[1].binary;
+
+  NULL_CHECK(source->data, NULL);
+
+  if (view->byteOffset + view->byteLength > source->dataLength)
+    return NULL;
+
+  return (const uint8_t *)source->data + view->byteOffset;
+}
+
+// false if the description was read lazily and not every entity in it
+// has been required yet
+bool
+__fpx3d_model_gltf_fully_parsed(const Fpx3d_Model_GltfAssetDescription *desc) {
+  NULL_CHECK(desc, false);
+
+  if (NULL == desc->lazy)
+    return true;
+
+  for (size_t type = 0; type < FPX3D_GLTF_ENTITY_TYPE_COUNT; ++type) {
+    for (size_t i = 0; i < _entity_count(desc, type); ++i) {
+      if (!desc->lazy->entities[type].parsed[i])
+        return false;
+    }
+  }
+
+  return true;
+}
+
+size_t __fpx3d_model_gltf_component_size(Fpx3d_Model_E_GltfComponentType type) {
+  switch (type) {
+  case FPX3D_GLTF_COMPONENT_TYPE_BYTE:
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+    return 1;
+
+  case FPX3D_GLTF_COMPONENT_TYPE_SHORT:
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+    return 2;
+
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_INT:
+  case FPX3D_GLTF_COMPONENT_TYPE_FLOAT:
+    return 4;
+
+  default:
+    return 0;
+  }
+}
+
+size_t
+__fpx3d_model_gltf_accessor_element_size(const Fpx3d_Model_GltfAccessor *acc) {
+  NULL_CHECK(acc, 0);
+
+  static const size_t component_counts[] = {0, 1, 2, 3, 4, 4, 9, 16};
+
+  if ((size_t)acc->elementType >= ARRAY_SIZE(component_counts))
+    return 0;
+
+  return __fpx3d_model_gltf_component_size(acc->componentType) *
+         component_counts[acc->elementType];
+}
+
+// copies the (raw, unconverted) elements of an accessor into `output`,
+// placing them `output_stride` bytes apart. Applies sparse substitution
+Fpx3d_E_Result
+__fpx3d_model_gltf_read_accessor(const Fpx3d_Model_GltfAsset *asset,
+                                 const Fpx3d_Model_GltfAccessor *acc,
+                                 void *output, size_t output_stride) {
+  NULL_CHECK(acc, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  size_t element_size = __fpx3d_model_gltf_accessor_element_size(acc);
+  if (0 == element_size || output_stride < element_size)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  uint8_t *out = output;
+
+  if (NULL == acc->view) {
+    // no bufferView means all zeroes (possibly with sparse values on top)
+    for (size_t i = 0; i < acc->elementCount; ++i)
+      memset(out + i * output_stride, 0, element_size);
+  } else {
+    const uint8_t *src = __fpx3d_model_gltf_view_data(asset, acc->view);
+    NULL_CHECK(src, FPX3D_NULLPTR_ERROR);
+
+    size_t stride = acc->view->byteStride;
+    if (0 == stride)
+      stride = element_size;
+
+    if (0 < acc->elementCount &&
+        acc->byteOffset + (acc->elementCount - 1) * stride + element_size >
+            acc->view->byteLength)
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+    src += acc->byteOffset;
+
+    if (stride == element_size && output_stride == element_size) {
+      memcpy(out, src, acc->elementCount * element_size);
+    } else {
+      for (size_t i = 0; i < acc->elementCount; ++i)
+        memcpy(out + i * output_stride, src + i * stride, element_size);
+    }
+  }
+
+  if (0 == acc->sparse.count)
+    return FPX3D_SUCCESS;
+
+  const uint8_t *sparse_idx =
+      __fpx3d_model_gltf_view_data(asset, acc->sparse.indices.view);
+  const uint8_t *sparse_val =
+      __fpx3d_model_gltf_view_data(asset, acc->sparse.values.view);
+
+  NULL_CHECK(sparse_idx, FPX3D_NULLPTR_ERROR);
+  NULL_CHECK(sparse_val, FPX3D_NULLPTR_ERROR);
+
+  sparse_idx += acc->sparse.indices.byteOffset;
+  sparse_val += acc->sparse.values.byteOffset;
+
+  for (size_t i = 0; i < acc->sparse.count; ++i) {
+    size_t target = 0;
+
+    switch (acc->sparse.indices.componentType) {
+    case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      target = sparse_idx[i];
+      break;
+    case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+      uint16_t v;
+      memcpy(&v, sparse_idx + i * sizeof(v), sizeof(v));
+      target = v;
+      break;
+    }
+    case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+      uint32_t v;
+      memcpy(&v, sparse_idx + i * sizeof(v), sizeof(v));
+      target = v;
+      break;
+    }
+    default:
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+    }
+
+    if (target >= acc->elementCount)
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+    memcpy(out + target * output_stride, sparse_val + i * element_size,
+           element_size);
+  }
+
+  return FPX3D_SUCCESS;
+}
+
 static Fpx3d_E_Result
 _json_to_asset_desc(const uint8_t *data, const uint8_t *limit,
                     Fpx3d_Model_GltfAssetDescription *output) {
@@ -247,7 +654,8 @@ _json_to_asset_desc(const uint8_t *data, const uint8_t *limit,
         &json.root.object, #component, FPX_JSON_VALUE_ARRAY);                  \
                                                                                \
     if (NULL != component) {                                                   \
-      Fpx3d_E_Result parse_res = parsing_function(&component->array, output);  \
+      Fpx3d_E_Result parse_res =                                               \
+          parsing_function(&component->array, 0, output);                      \
                                                                                \
       if (FPX3D_SUCCESS > parse_res) {                                         \
         fpx_json_destroy(&json);                                               \
@@ -270,6 +678,13 @@ _json_to_asset_desc(const uint8_t *data, const uint8_t *limit,
   PARSE_COMPONENT(skins, _parse_skins);
   PARSE_COMPONENT(animations, _parse_animations);
 
+  Fpx_Json_Value *default_scene =
+      _get_value_by_key(&json.root.object, "scene", FPX_JSON_VALUE_NUMBER);
+
+  if (NULL != default_scene && 0 <= default_scene->number &&
+      default_scene->number < output->sceneCount)
+    output->scene = &output->scenes[(size_t)default_scene->number];
+
 #undef PARSE_COMPONENT
 
   fpx_json_destroy(&json);
@@ -488,14 +903,14 @@ static Fpx_Json_Value *_get_value_by_key(Fpx_Json_Object *obj, const char *key,
   return NULL;
 }
 
-static Fpx3d_E_Result _parse_scenes(Fpx_Json_Array *scenes,
+static Fpx3d_E_Result _parse_scenes(Fpx_Json_Array *scenes, size_t first,
                                     Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(scenes, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->scenes, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfScene *output_s = output->scenes;
+  Fpx3d_Model_GltfScene *output_s = output->scenes + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -517,9 +932,6 @@ static Fpx3d_E_Result _parse_scenes(Fpx_Json_Array *scenes,
     Fpx_Json_Value *json_node_array = _get_value_by_key(
         &scenes->values[i].object, "nodes", FPX_JSON_VALUE_ARRAY);
 
-    if (NULL == json_scene_name || NULL == json_node_array)
-      PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
-
     if (NULL != json_scene_name) {
       size_t temp_cap = 0;
 
@@ -538,11 +950,9 @@ static Fpx3d_E_Result _parse_scenes(Fpx_Json_Array *scenes,
       if (NULL == output->nodes)
         PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
 
-      size_t temp_cap = 0;
-
       Fpx3d_E_Result node_alloc = __fpx3d_realloc_array(
           (void **)&output_s[i].nodes, sizeof(Fpx3d_Model_GltfNode *),
-          json_node_array->array.count, &temp_cap);
+          json_node_array->array.count, &output_s[i].nodeCount);
 
       if (FPX3D_SUCCESS > node_alloc)
         PARSE_FAIL(node_alloc);
@@ -570,14 +980,14 @@ static Fpx3d_E_Result _parse_scenes(Fpx_Json_Array *scenes,
   return FPX3D_SUCCESS;
 }
 
-static Fpx3d_E_Result _parse_cameras(Fpx_Json_Array *cameras,
+static Fpx3d_E_Result _parse_cameras(Fpx_Json_Array *cameras, size_t first,
                                      Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(cameras, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->cameras, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfCamera *output_c = output->cameras;
+  Fpx3d_Model_GltfCamera *output_c = output->cameras + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -635,13 +1045,13 @@ static Fpx3d_E_Result _parse_cameras(Fpx_Json_Array *cameras,
 
     if (FPX3D_MODEL_GLTF_PROJECTION_TYPE_PERSPECTIVE == output_c[i].type) {
       Fpx_Json_Value *ratio = _get_value_by_key(
-          &cameras->values[i].object, "aspectRatio", FPX_JSON_VALUE_NUMBER);
-      Fpx_Json_Value *fov = _get_value_by_key(&cameras->values[i].object,
+          &json_cam_props->object, "aspectRatio", FPX_JSON_VALUE_NUMBER);
+      Fpx_Json_Value *fov = _get_value_by_key(&json_cam_props->object,
                                               "yfov", FPX_JSON_VALUE_NUMBER);
       Fpx_Json_Value *near_plane = _get_value_by_key(
-          &cameras->values[i].object, "znear", FPX_JSON_VALUE_NUMBER);
+          &json_cam_props->object, "znear", FPX_JSON_VALUE_NUMBER);
       Fpx_Json_Value *far_plane = _get_value_by_key(
-          &cameras->values[i].object, "zfar", FPX_JSON_VALUE_NUMBER);
+          &json_cam_props->object, "zfar", FPX_JSON_VALUE_NUMBER);
 
       if (NULL == fov || NULL == near_plane)
         PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
@@ -658,14 +1068,14 @@ static Fpx3d_E_Result _parse_cameras(Fpx_Json_Array *cameras,
       output_c[i].perspective.fov = fov->number;
     } else if (FPX3D_MODEL_GLTF_PROJECTION_TYPE_ORTHOGRAPHIC ==
                output_c[i].type) {
-      Fpx_Json_Value *xmag = _get_value_by_key(&cameras->values[i].object,
+      Fpx_Json_Value *xmag = _get_value_by_key(&json_cam_props->object,
                                                "xmag", FPX_JSON_VALUE_NUMBER);
-      Fpx_Json_Value *ymag = _get_value_by_key(&cameras->values[i].object,
+      Fpx_Json_Value *ymag = _get_value_by_key(&json_cam_props->object,
                                                "ymag", FPX_JSON_VALUE_NUMBER);
       Fpx_Json_Value *near_plane = _get_value_by_key(
-          &cameras->values[i].object, "znear", FPX_JSON_VALUE_NUMBER);
+          &json_cam_props->object, "znear", FPX_JSON_VALUE_NUMBER);
       Fpx_Json_Value *far_plane = _get_value_by_key(
-          &cameras->values[i].object, "zfar", FPX_JSON_VALUE_NUMBER);
+          &json_cam_props->object, "zfar", FPX_JSON_VALUE_NUMBER);
 
       if (NULL == xmag || NULL == ymag || NULL == near_plane ||
           NULL == far_plane)
@@ -683,14 +1093,14 @@ static Fpx3d_E_Result _parse_cameras(Fpx_Json_Array *cameras,
   return FPX3D_SUCCESS;
 }
 
-static Fpx3d_E_Result _parse_nodes(Fpx_Json_Array *nodes,
+static Fpx3d_E_Result _parse_nodes(Fpx_Json_Array *nodes, size_t first,
                                    Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(nodes, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->nodes, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfNode *output_n = output->nodes;
+  Fpx3d_Model_GltfNode *output_n = output->nodes + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -743,10 +1153,9 @@ static Fpx3d_E_Result _parse_nodes(Fpx_Json_Array *nodes,
     if (NULL != node_children) {
       // handle children array
       {
-        size_t temp = 0;
         Fpx3d_E_Result alloc_res = __fpx3d_realloc_array(
             (void **)&output_n[i].children, sizeof(Fpx3d_Model_GltfNode *),
-            node_children->array.count, &temp);
+            node_children->array.count, &output_n[i].childCount);
 
         if (FPX3D_SUCCESS > alloc_res)
           PARSE_FAIL(alloc_res);
@@ -756,7 +1165,7 @@ static Fpx3d_E_Result _parse_nodes(Fpx_Json_Array *nodes,
 
       for (size_t iter = 0; iter < node_children->array.count; ++iter) {
         if (FPX_JSON_VALUE_NUMBER != child_idxs[iter].valueType ||
-            (size_t)child_idxs[iter].number > output->nodeCount)
+            (size_t)child_idxs[iter].number >= output->nodeCount)
           PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
 
         output_n[i].children[iter] =
@@ -840,7 +1249,7 @@ static Fpx3d_E_Result _parse_nodes(Fpx_Json_Array *nodes,
       }
 
       for (size_t iter = 0; iter < node_weights->array.count; ++iter) {
-        if (FPX_JSON_VALUE_NUMBER != node_weights->array.values[i].valueType)
+        if (FPX_JSON_VALUE_NUMBER != node_weights->array.values[iter].valueType)
           PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
 
         output_n[i].meshMorphTargetWeights[iter] =
@@ -1003,7 +1412,8 @@ _parse_mesh_primitives(Fpx_Json_Array *primitives,
 
       if (NULL != mode_value) {
         outputs[i].renderMode = (size_t)mode_value->number;
-      }
+      } else
+        outputs[i].renderMode = FPX3D_GLTF_RENDER_MODE_TRIANGLES;
     }
 
     {
@@ -1050,14 +1460,14 @@ _parse_mesh_primitives(Fpx_Json_Array *primitives,
   return FPX3D_SUCCESS;
 }
 
-static Fpx3d_E_Result _parse_meshes(Fpx_Json_Array *meshes,
+static Fpx3d_E_Result _parse_meshes(Fpx_Json_Array *meshes, size_t first,
                                     Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(meshes, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->meshes, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfMesh *output_m = output->meshes;
+  Fpx3d_Model_GltfMesh *output_m = output->meshes + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -1082,10 +1492,9 @@ static Fpx3d_E_Result _parse_meshes(Fpx_Json_Array *meshes,
     }
 
     {
-      size_t temp = 0;
       Fpx3d_E_Result prim_alloc = __fpx3d_realloc_array(
           (void **)&output_m[i].primitives, sizeof(output_m[i].primitives[0]),
-          mesh_prims->array.count, &temp);
+          mesh_prims->array.count, &output_m[i].primitiveCount);
 
       if (FPX3D_SUCCESS > prim_alloc)
         PARSE_FAIL(prim_alloc);
@@ -1127,7 +1536,7 @@ static Fpx3d_E_Result _parse_meshes(Fpx_Json_Array *meshes,
       }
 
       for (size_t iter = 0; iter < mesh_weights->array.count; ++iter) {
-        if (FPX_JSON_VALUE_NUMBER != mesh_weights->array.values[i].valueType)
+        if (FPX_JSON_VALUE_NUMBER != mesh_weights->array.values[iter].valueType)
           PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
 
         output_m[i].morphTargetWeights[iter] =
@@ -1141,14 +1550,14 @@ static Fpx3d_E_Result _parse_meshes(Fpx_Json_Array *meshes,
   return FPX3D_SUCCESS;
 }
 
-static Fpx3d_E_Result _parse_buffers(Fpx_Json_Array *buffers,
+static Fpx3d_E_Result _parse_buffers(Fpx_Json_Array *buffers, size_t first,
                                      Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(buffers, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->buffers, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfBuffer *output_b = output->buffers;
+  Fpx3d_Model_GltfBuffer *output_b = output->buffers + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -1208,7 +1617,7 @@ static Fpx3d_E_Result _parse_buffers(Fpx_Json_Array *buffers,
 }
 
 static Fpx3d_E_Result
-_parse_buffer_views(Fpx_Json_Array *views,
+_parse_buffer_views(Fpx_Json_Array *views, size_t first,
                     Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(views, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
@@ -1216,7 +1625,7 @@ _parse_buffer_views(Fpx_Json_Array *views,
   NULL_CHECK(output->bufferViews, FPX3D_SUCCESS);
   NULL_CHECK(output->buffers, FPX3D_NULLPTR_ERROR);
 
-  Fpx3d_Model_GltfBufferView *output_v = output->bufferViews;
+  Fpx3d_Model_GltfBufferView *output_v = output->bufferViews + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -1253,6 +1662,22 @@ _parse_buffer_views(Fpx_Json_Array *views,
                                                "target", FPX_JSON_VALUE_NUMBER);
     Fpx_Json_Value *name = _get_value_by_key(&views->values[i].object, "name",
                                              FPX_JSON_VALUE_STRING);
+    Fpx_Json_Value *extensions = _get_value_by_key(
+        &views->values[i].object, "extensions", FPX_JSON_VALUE_OBJECT);
+
+    if (NULL != extensions) {
+      Fpx_Json_Value *meshopt =
+          _get_value_by_key(&extensions->object, "EXT_meshopt_compression",
+                            FPX_JSON_VALUE_OBJECT);
+
+      if (NULL != meshopt) {
+        Fpx3d_E_Result meshopt_res =
+            _parse_meshopt_extension(&meshopt->object, &output_v[i], output);
+
+        if (FPX3D_SUCCESS > meshopt_res)
+          PARSE_FAIL(meshopt_res);
+      }
+    }
 
     if (NULL != offset) {
       output_v[i].byteOffset = (size_t)offset->number;
@@ -1281,14 +1706,211 @@ _parse_buffer_views(Fpx_Json_Array *views,
 }
 
 static Fpx3d_E_Result
-_parse_accessors(Fpx_Json_Array *accessors,
+_parse_meshopt_extension(Fpx_Json_Object *extension,
+                         Fpx3d_Model_GltfBufferView *output,
+                         Fpx3d_Model_GltfAssetDescription *parent_asset) {
+  NULL_CHECK(extension, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+  NULL_CHECK(parent_asset, FPX3D_ARGS_ERROR);
+
+  Fpx_Json_Value *buf_idx =
+      _get_value_by_key(extension, "buffer", FPX_JSON_VALUE_NUMBER);
+  Fpx_Json_Value *length =
+      _get_value_by_key(extension, "byteLength", FPX_JSON_VALUE_NUMBER);
+  Fpx_Json_Value *stride =
+      _get_value_by_key(extension, "byteStride", FPX_JSON_VALUE_NUMBER);
+  Fpx_Json_Value *count =
+      _get_value_by_key(extension, "count", FPX_JSON_VALUE_NUMBER);
+  Fpx_Json_Value *mode =
+      _get_value_by_key(extension, "mode", FPX_JSON_VALUE_STRING);
+
+  if (NULL == buf_idx || NULL == length || NULL == stride || NULL == count ||
+      NULL == mode)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  if ((size_t)buf_idx->number >= parent_asset->bufferCount)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  output->meshopt.buffer = parent_asset->buffers + (size_t)buf_idx->number;
+  output->meshopt.byteLength = (size_t)length->number;
+  output->meshopt.byteStride = (size_t)stride->number;
+  output->meshopt.count = (size_t)count->number;
+
+  if (0 == strcmp("ATTRIBUTES", mode->string.data))
+    output->meshopt.mode = FPX3D_GLTF_MESHOPT_MODE_ATTRIBUTES;
+  else if (0 == strcmp("TRIANGLES", mode->string.data))
+    output->meshopt.mode = FPX3D_GLTF_MESHOPT_MODE_TRIANGLES;
+  else if (0 == strcmp("INDICES", mode->string.data))
+    output->meshopt.mode = FPX3D_GLTF_MESHOPT_MODE_INDICES;
+  else
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  Fpx_Json_Value *offset =
+      _get_value_by_key(extension, "byteOffset", FPX_JSON_VALUE_NUMBER);
+  Fpx_Json_Value *filter =
+      _get_value_by_key(extension, "filter", FPX_JSON_VALUE_STRING);
+
+  if (NULL != offset) {
+    output->meshopt.byteOffset = (size_t)offset->number;
+  }
+
+  output->meshopt.filter = FPX3D_GLTF_MESHOPT_FILTER_NONE;
+
+  if (NULL != filter) {
+    if (0 == strcmp("NONE", filter->string.data))
+      output->meshopt.filter = FPX3D_GLTF_MESHOPT_FILTER_NONE;
+    else if (0 == strcmp("OCTAHEDRAL", filter->string.data))
+      output->meshopt.filter = FPX3D_GLTF_MESHOPT_FILTER_OCTAHEDRAL;
+    else if (0 == strcmp("QUATERNION", filter->string.data))
+      output->meshopt.filter = FPX3D_GLTF_MESHOPT_FILTER_QUATERNION;
+    else if (0 == strcmp("EXPONENTIAL", filter->string.data))
+      output->meshopt.filter = FPX3D_GLTF_MESHOPT_FILTER_EXPONENTIAL;
+    else
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+  }
+
+  // filters are only defined for vertex attributes
+  if (FPX3D_GLTF_MESHOPT_FILTER_NONE != output->meshopt.filter &&
+      FPX3D_GLTF_MESHOPT_MODE_ATTRIBUTES != output->meshopt.mode)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  output->meshopt.isCompressed = true;
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result
+_decode_compressed_views(Fpx3d_Model_GltfAssetDescription *asset_desc,
+                         const Fpx3d_Model_GltfBuffer *glb_binary) {
+  NULL_CHECK(asset_desc, FPX3D_ARGS_ERROR);
+
+  for (size_t i = 0; i < asset_desc->bufferViewCount; ++i) {
+    Fpx3d_E_Result decode_res =
+        _decode_view(&asset_desc->bufferViews[i], i, glb_binary);
+
+    if (FPX3D_SUCCESS > decode_res)
+      return decode_res;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _decode_view(Fpx3d_Model_GltfBufferView *view,
+                                   size_t view_index,
+                                   const Fpx3d_Model_GltfBuffer *glb_binary) {
+  NULL_CHECK(view, FPX3D_ARGS_ERROR);
+
+  // only used for diagnostics
+  UNUSED(view_index);
+
+  if (false == view->meshopt.isCompressed || NULL != view->decodedData)
+    return FPX3D_SUCCESS;
+
+  const Fpx3d_Model_GltfBuffer *source = view->meshopt.buffer;
+
+  if (NULL == source->data && NULL == source->uri && NULL != glb_binary)
+    source = glb_binary;
+
+  if (NULL == source->data) {
+    FPX3D_WARN("Compressed bufferView %" LONG_FORMAT
+               "u has no source data loaded, skipping decode",
+               view_index);
+    return FPX3D_SUCCESS;
+  }
+
+  if (view->meshopt.byteOffset + view->meshopt.byteLength > source->dataLength)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  return __fpx3d_model_gltf_decode_view_data(
+      view, (const uint8_t *)source->data + view->meshopt.byteOffset);
+}
+
+// decodes the `meshopt.byteLength` compressed bytes at `input`
+// into `view->decodedData`
+Fpx3d_E_Result
+__fpx3d_model_gltf_decode_view_data(Fpx3d_Model_GltfBufferView *view,
+                                    const uint8_t *input) {
+  NULL_CHECK(view, FPX3D_ARGS_ERROR);
+  NULL_CHECK(input, FPX3D_ARGS_ERROR);
+
+  size_t decoded_size = view->meshopt.count * view->meshopt.byteStride;
+
+  if (decoded_size > view->byteLength)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  {
+    size_t temp = 0;
+    Fpx3d_E_Result alloc_res = __fpx3d_realloc_array(
+        &view->decodedData, 1, MAX(view->byteLength, (size_t)1), &temp);
+
+    if (FPX3D_SUCCESS > alloc_res)
+      return alloc_res;
+  }
+
+  Fpx3d_E_Result decode_res = FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  switch (view->meshopt.mode) {
+  case FPX3D_GLTF_MESHOPT_MODE_ATTRIBUTES:
+    decode_res = __fpx3d_model_meshopt_decode_vertices(
+        view->decodedData, view->meshopt.count, view->meshopt.byteStride,
+        input, view->meshopt.byteLength);
+    break;
+
+  case FPX3D_GLTF_MESHOPT_MODE_TRIANGLES:
+    decode_res = __fpx3d_model_meshopt_decode_triangles(
+        view->decodedData, view->meshopt.count, view->meshopt.byteStride,
+        input, view->meshopt.byteLength);
+    break;
+
+  case FPX3D_GLTF_MESHOPT_MODE_INDICES:
+    decode_res = __fpx3d_model_meshopt_decode_indices(
+        view->decodedData, view->meshopt.count, view->meshopt.byteStride,
+        input, view->meshopt.byteLength);
+    break;
+
+  default:
+    break;
+  }
+
+  if (FPX3D_SUCCESS == decode_res) {
+    switch (view->meshopt.filter) {
+    case FPX3D_GLTF_MESHOPT_FILTER_OCTAHEDRAL:
+      decode_res = __fpx3d_model_meshopt_filter_octahedral(
+          view->decodedData, view->meshopt.count, view->meshopt.byteStride);
+      break;
+
+    case FPX3D_GLTF_MESHOPT_FILTER_QUATERNION:
+      decode_res = __fpx3d_model_meshopt_filter_quaternion(
+          view->decodedData, view->meshopt.count, view->meshopt.byteStride);
+      break;
+
+    case FPX3D_GLTF_MESHOPT_FILTER_EXPONENTIAL:
+      decode_res = __fpx3d_model_meshopt_filter_exponential(
+          view->decodedData, view->meshopt.count, view->meshopt.byteStride);
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  if (FPX3D_SUCCESS > decode_res) {
+    FREE_SAFE(view->decodedData);
+    return decode_res;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result
+_parse_accessors(Fpx_Json_Array *accessors, size_t first,
                  Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(accessors, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->accessors, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfAccessor *output_a = output->accessors;
+  Fpx3d_Model_GltfAccessor *output_a = output->accessors + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -1387,6 +2009,7 @@ _parse_accessors(Fpx_Json_Array *accessors,
             min_vals->array.values[iter].number;
       }
     }
+    output_a[i].hasBounds = (NULL != max_vals && NULL != min_vals);
     if (NULL != sparse) {
       Fpx_Json_Object *sparse_obj = &sparse->object;
 
@@ -1480,12 +2103,12 @@ _parse_accessors(Fpx_Json_Array *accessors,
             bv->target != FPX3D_GLTF_BUFFER_VIEW_TARGET_INVALID)
           PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
 
-        output_a[i].sparse.indices.view = bv;
+        output_a[i].sparse.values.view = bv;
 
         Fpx_Json_Value *offset = _get_value_by_key(
             &sparse_values->object, "byteOffset", FPX_JSON_VALUE_NUMBER);
         if (NULL != offset) {
-          output_a[i].sparse.indices.byteOffset = (size_t)offset->number;
+          output_a[i].sparse.values.byteOffset = (size_t)offset->number;
         }
       }
     }
@@ -1506,14 +2129,14 @@ _parse_accessors(Fpx_Json_Array *accessors,
   return FPX3D_SUCCESS;
 }
 
-static Fpx3d_E_Result _parse_images(Fpx_Json_Array *images,
+static Fpx3d_E_Result _parse_images(Fpx_Json_Array *images, size_t first,
                                     Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(images, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->images, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfImage *output_i = output->images;
+  Fpx3d_Model_GltfImage *output_i = output->images + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -1591,14 +2214,14 @@ static Fpx3d_E_Result _parse_images(Fpx_Json_Array *images,
 }
 
 static Fpx3d_E_Result
-_parse_samplers(Fpx_Json_Array *samplers,
+_parse_samplers(Fpx_Json_Array *samplers, size_t first,
                 Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(samplers, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->samplers, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfSampler *output_s = output->samplers;
+  Fpx3d_Model_GltfSampler *output_s = output->samplers + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -1658,14 +2281,14 @@ _parse_samplers(Fpx_Json_Array *samplers,
 }
 
 static Fpx3d_E_Result
-_parse_textures(Fpx_Json_Array *textures,
+_parse_textures(Fpx_Json_Array *textures, size_t first,
                 Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(textures, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->textures, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfTexture *output_t = output->textures;
+  Fpx3d_Model_GltfTexture *output_t = output->textures + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -1764,14 +2387,14 @@ _parse_tex_info(Fpx_Json_Object *texture_info,
 }
 
 static Fpx3d_E_Result
-_parse_materials(Fpx_Json_Array *materials,
+_parse_materials(Fpx_Json_Array *materials, size_t first,
                  Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(materials, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
   NULL_CHECK(output->materials, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfMaterial *output_m = output->materials;
+  Fpx3d_Model_GltfMaterial *output_m = output->materials + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -1820,6 +2443,12 @@ _parse_materials(Fpx_Json_Array *materials,
     }
 
     // .pbrMetallicRoughness
+    // (spec defaults, in case the object or some of its members are absent)
+    for (size_t factor = 0; factor < 4; ++factor)
+      output_m[i].pbrMetallicRoughness.baseColorFactor[factor] = 1.0f;
+    output_m[i].pbrMetallicRoughness.metallicFactor = 1.0f;
+    output_m[i].pbrMetallicRoughness.roughnessFactor = 1.0f;
+
     if (NULL != pbr) {
       Fpx_Json_Object *pbr_obj = &pbr->object;
       Fpx_Json_Value *base_factors =
@@ -1972,7 +2601,7 @@ _parse_materials(Fpx_Json_Array *materials,
   return FPX3D_SUCCESS;
 }
 
-static Fpx3d_E_Result _parse_skins(Fpx_Json_Array *skins,
+static Fpx3d_E_Result _parse_skins(Fpx_Json_Array *skins, size_t first,
                                    Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(skins, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
@@ -1980,7 +2609,7 @@ static Fpx3d_E_Result _parse_skins(Fpx_Json_Array *skins,
   NULL_CHECK(output->skins, FPX3D_SUCCESS);
   NULL_CHECK(output->nodes, FPX3D_SUCCESS);
 
-  Fpx3d_Model_GltfSkin *output_s = output->skins;
+  Fpx3d_Model_GltfSkin *output_s = output->skins + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -2062,7 +2691,7 @@ static Fpx3d_E_Result _parse_skins(Fpx_Json_Array *skins,
 }
 
 static Fpx3d_E_Result
-_parse_animations(Fpx_Json_Array *animations,
+_parse_animations(Fpx_Json_Array *animations, size_t first,
                   Fpx3d_Model_GltfAssetDescription *output) {
   NULL_CHECK(animations, FPX3D_ARGS_ERROR);
   NULL_CHECK(output, FPX3D_ARGS_ERROR);
@@ -2071,8 +2700,7 @@ _parse_animations(Fpx_Json_Array *animations,
   NULL_CHECK(output->accessors, FPX3D_NULLPTR_ERROR);
   NULL_CHECK(output->nodes, FPX3D_NULLPTR_ERROR);
 
-  Fpx3d_Model_GltfAnimation *output_a = output->animations;
-  UNUSED(output_a);
+  Fpx3d_Model_GltfAnimation *output_a = output->animations + first;
 
 #define PARSE_FAIL(retval)                                                     \
   {                                                                            \
@@ -2085,7 +2713,130 @@ _parse_animations(Fpx_Json_Array *animations,
     return retval;                                                             \
   }
 
-  FPX3D_TODO("Implement glTF animation parsing ( _parse_animations() )");
+  for (size_t i = 0; i < animations->count; ++i) {
+    if (FPX_JSON_VALUE_OBJECT != animations->values[i].valueType)
+      PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+    Fpx_Json_Object *anim = &animations->values[i].object;
+
+    Fpx_Json_Value *channels =
+        _get_value_by_key(anim, "channels", FPX_JSON_VALUE_ARRAY);
+    Fpx_Json_Value *samplers =
+        _get_value_by_key(anim, "samplers", FPX_JSON_VALUE_ARRAY);
+    Fpx_Json_Value *name =
+        _get_value_by_key(anim, "name", FPX_JSON_VALUE_STRING);
+
+    if (NULL == channels || NULL == samplers || 0 == channels->array.count ||
+        0 == samplers->array.count)
+      PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+    {
+      Fpx3d_E_Result alloc_res = __fpx3d_realloc_array(
+          (void **)&output_a[i].samplers, sizeof(output_a[i].samplers[0]),
+          samplers->array.count, &output_a[i].samplerCount);
+
+      if (FPX3D_SUCCESS > alloc_res)
+        PARSE_FAIL(alloc_res);
+
+      alloc_res = __fpx3d_realloc_array(
+          (void **)&output_a[i].channels, sizeof(output_a[i].channels[0]),
+          channels->array.count, &output_a[i].channelCount);
+
+      if (FPX3D_SUCCESS > alloc_res)
+        PARSE_FAIL(alloc_res);
+    }
+
+    for (size_t s = 0; s < output_a[i].samplerCount; ++s) {
+      if (FPX_JSON_VALUE_OBJECT != samplers->array.values[s].valueType)
+        PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+      Fpx_Json_Object *sampler = &samplers->array.values[s].object;
+      struct fpx3d_model_gltf_anim_sampler *output_s = &output_a[i].samplers[s];
+
+      Fpx_Json_Value *input =
+          _get_value_by_key(sampler, "input", FPX_JSON_VALUE_NUMBER);
+      Fpx_Json_Value *output_values =
+          _get_value_by_key(sampler, "output", FPX_JSON_VALUE_NUMBER);
+      Fpx_Json_Value *interpolation =
+          _get_value_by_key(sampler, "interpolation", FPX_JSON_VALUE_STRING);
+
+      if (NULL == input || NULL == output_values ||
+          (size_t)input->number >= output->accessorCount ||
+          (size_t)output_values->number >= output->accessorCount)
+        PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+      output_s->keyframes = output->accessors + (size_t)input->number;
+      output_s->outputValues =
+          output->accessors + (size_t)output_values->number;
+
+      // .interpolation
+      if (NULL != interpolation) {
+        if (0 == strcmp("LINEAR", interpolation->string.data))
+          output_s->interpolation = FPX3D_GLTF_ANIM_INTERPOLATION_LINEAR;
+        else if (0 == strcmp("STEP", interpolation->string.data))
+          output_s->interpolation = FPX3D_GLTF_ANIM_INTERPOLATION_STEP;
+        else if (0 == strcmp("CUBICSPLINE", interpolation->string.data))
+          output_s->interpolation = FPX3D_GLTF_ANIM_INTERPOLATION_CUBICSPLINE;
+      } else
+        output_s->interpolation = FPX3D_GLTF_ANIM_INTERPOLATION_LINEAR;
+    }
+
+    for (size_t c = 0; c < output_a[i].channelCount; ++c) {
+      if (FPX_JSON_VALUE_OBJECT != channels->array.values[c].valueType)
+        PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+      Fpx_Json_Object *channel = &channels->array.values[c].object;
+      struct fpx3d_model_gltf_anim_channel *output_c = &output_a[i].channels[c];
+
+      Fpx_Json_Value *sampler =
+          _get_value_by_key(channel, "sampler", FPX_JSON_VALUE_NUMBER);
+      Fpx_Json_Value *target =
+          _get_value_by_key(channel, "target", FPX_JSON_VALUE_OBJECT);
+
+      if (NULL == sampler || NULL == target ||
+          (size_t)sampler->number >= output_a[i].samplerCount)
+        PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+      output_c->sampler = output_a[i].samplers + (size_t)sampler->number;
+
+      Fpx_Json_Value *node =
+          _get_value_by_key(&target->object, "node", FPX_JSON_VALUE_NUMBER);
+      Fpx_Json_Value *path =
+          _get_value_by_key(&target->object, "path", FPX_JSON_VALUE_STRING);
+
+      if (NULL == path)
+        PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+      // a target without a node is left for extensions to fill in
+      if (NULL != node) {
+        if ((size_t)node->number >= output->nodeCount)
+          PARSE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+        output_c->target.node = output->nodes + (size_t)node->number;
+      }
+
+      // .path
+      if (0 == strcmp("translation", path->string.data))
+        output_c->target.path = FPX3D_GLTF_ANIM_PATH_TRANSLATION;
+      else if (0 == strcmp("rotation", path->string.data))
+        output_c->target.path = FPX3D_GLTF_ANIM_PATH_ROTATION;
+      else if (0 == strcmp("scale", path->string.data))
+        output_c->target.path = FPX3D_GLTF_ANIM_PATH_SCALE;
+      else if (0 == strcmp("weights", path->string.data))
+        output_c->target.path = FPX3D_GLTF_ANIM_PATH_WEIGHTS;
+    }
+
+    if (NULL != name) {
+      size_t temp = 0;
+      Fpx3d_E_Result name_alloc = __fpx3d_realloc_array(
+          (void **)&output_a[i].name, 1, name->string.size + 1, &temp);
+
+      if (FPX3D_SUCCESS > name_alloc)
+        PARSE_FAIL(name_alloc);
+
+      memcpy(output_a[i].name, name->string.data, temp);
+    }
+  }
 
 #undef PARSE_FAIL
 
@@ -2150,6 +2901,7 @@ static void _destroy_asset_desc(Fpx3d_Model_GltfAssetDescription *asset_desc) {
   // destroy bufferViews
   for (size_t i = 0; i < asset_desc->bufferViewCount; ++i) {
     FREE_SAFE(asset_desc->bufferViews[i].name);
+    FREE_SAFE(asset_desc->bufferViews[i].decodedData);
     memset(&asset_desc->bufferViews[i], 0, sizeof(asset_desc->bufferViews[i]));
   }
 
@@ -2200,6 +2952,7 @@ static void _destroy_asset_desc(Fpx3d_Model_GltfAssetDescription *asset_desc) {
     memset(&asset_desc->animations[i], 0, sizeof(asset_desc->animations[i]));
   }
 
+  _free_lazy_state(asset_desc->lazy);
   _free_top_level(asset_desc);
   return;
 }
@@ -2214,6 +2967,8 @@ static void _destroy_chunk(struct fpx3d_model_glb_chunk *chunkptr) {
     break;
 
   case FPX3D_GLB_CHUNK_BINARY:
+    FREE_SAFE(chunkptr->binary.data);
+    memset(chunkptr, 0, sizeof(*chunkptr));
     break;
 
   default:
@@ -2222,3 +2977,502 @@ static void _destroy_chunk(struct fpx3d_model_glb_chunk *chunkptr) {
 
   return;
 }
+
+static size_t _entity_count(const Fpx3d_Model_GltfAssetDescription *desc,
+                            Fpx3d_Model_E_GltfEntityType type) {
+  switch (type) {
+  case FPX3D_GLTF_ENTITY_SCENE:
+    return desc->sceneCount;
+  case FPX3D_GLTF_ENTITY_CAMERA:
+    return desc->cameraCount;
+  case FPX3D_GLTF_ENTITY_NODE:
+    return desc->nodeCount;
+  case FPX3D_GLTF_ENTITY_MESH:
+    return desc->meshCount;
+  case FPX3D_GLTF_ENTITY_BUFFER:
+    return desc->bufferCount;
+  case FPX3D_GLTF_ENTITY_BUFFER_VIEW:
+    return desc->bufferViewCount;
+  case FPX3D_GLTF_ENTITY_ACCESSOR:
+    return desc->accessorCount;
+  case FPX3D_GLTF_ENTITY_IMAGE:
+    return desc->imageCount;
+  case FPX3D_GLTF_ENTITY_SAMPLER:
+    return desc->samplerCount;
+  case FPX3D_GLTF_ENTITY_TEXTURE:
+    return desc->textureCount;
+  case FPX3D_GLTF_ENTITY_MATERIAL:
+    return desc->materialCount;
+  case FPX3D_GLTF_ENTITY_SKIN:
+    return desc->skinCount;
+  case FPX3D_GLTF_ENTITY_ANIMATION:
+    return desc->animationCount;
+  default:
+    return 0;
+  }
+}
+
+static Fpx3d_E_Result
+_alloc_entities(Fpx3d_Model_GltfAssetDescription *desc,
+                Fpx3d_Model_E_GltfEntityType type, size_t count) {
+#define ALLOC_ENTITIES(array, counter)                                         \
+  return __fpx3d_realloc_array((void **)&desc->array, sizeof(desc->array[0]),  \
+                               count, &desc->counter)
+
+  switch (type) {
+  case FPX3D_GLTF_ENTITY_SCENE:
+    ALLOC_ENTITIES(scenes, sceneCount);
+  case FPX3D_GLTF_ENTITY_CAMERA:
+    ALLOC_ENTITIES(cameras, cameraCount);
+  case FPX3D_GLTF_ENTITY_NODE:
+    ALLOC_ENTITIES(nodes, nodeCount);
+  case FPX3D_GLTF_ENTITY_MESH:
+    ALLOC_ENTITIES(meshes, meshCount);
+  case FPX3D_GLTF_ENTITY_BUFFER:
+    ALLOC_ENTITIES(buffers, bufferCount);
+  case FPX3D_GLTF_ENTITY_BUFFER_VIEW:
+    ALLOC_ENTITIES(bufferViews, bufferViewCount);
+  case FPX3D_GLTF_ENTITY_ACCESSOR:
+    ALLOC_ENTITIES(accessors, accessorCount);
+  case FPX3D_GLTF_ENTITY_IMAGE:
+    ALLOC_ENTITIES(images, imageCount);
+  case FPX3D_GLTF_ENTITY_SAMPLER:
+    ALLOC_ENTITIES(samplers, samplerCount);
+  case FPX3D_GLTF_ENTITY_TEXTURE:
+    ALLOC_ENTITIES(textures, textureCount);
+  case FPX3D_GLTF_ENTITY_MATERIAL:
+    ALLOC_ENTITIES(materials, materialCount);
+  case FPX3D_GLTF_ENTITY_SKIN:
+    ALLOC_ENTITIES(skins, skinCount);
+  case FPX3D_GLTF_ENTITY_ANIMATION:
+    ALLOC_ENTITIES(animations, animationCount);
+  default:
+    return FPX3D_ARGS_ERROR;
+  }
+
+#undef ALLOC_ENTITIES
+}
+
+// `data` points at the opening quote.
+// Returns a pointer past the closing quote, or NULL if there is none
+static const uint8_t *_skip_json_string(const uint8_t *data,
+                                        const uint8_t *limit) {
+  for (++data; data < limit; ++data) {
+    if ('\\' == *data)
+      ++data;
+    else if ('"' == *data)
+      return data + 1;
+  }
+
+  return NULL;
+}
+
+// returns a pointer past the value starting at `data`, NULL if it is cut off.
+// Only the structure is checked; the contents are validated by the actual
+// parser once the value is required
+static const uint8_t *_skip_json_value(const uint8_t *data,
+                                       const uint8_t *limit) {
+  if (data >= limit)
+    return NULL;
+
+  if ('"' == *data)
+    return _skip_json_string(data, limit);
+
+  if ('{' != *data && '[' != *data) {
+    // number, bool or null
+    while (data < limit && ',' != *data && '}' != *data && ']' != *data &&
+           !IS_WHITESPACE(*data))
+      ++data;
+
+    return data;
+  }
+
+  size_t depth = 0;
+
+  while (data < limit) {
+    switch (*data) {
+    case '"':
+      data = _skip_json_string(data, limit);
+      if (NULL == data)
+        return NULL;
+      continue;
+
+    case '{':
+    case '[':
+      ++depth;
+      break;
+
+    case '}':
+    case ']':
+      if (0 == --depth)
+        return data + 1;
+      break;
+
+    default:
+      break;
+    }
+
+    ++data;
+  }
+
+  return NULL;
+}
+
+static Fpx3d_E_Result
+_scan_json_to_asset_desc(const uint8_t *data, const uint8_t *limit,
+                         Fpx3d_Model_GltfAssetDescription *output) {
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+  NULL_CHECK(limit, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  struct fpx3d_model_gltf_lazy_state *state = calloc(1, sizeof(*state));
+  NULL_CHECK(state, FPX3D_MEMORY_ERROR);
+
+  output->lazy = state;
+
+#define SCAN_FAIL(code)                                                        \
+  {                                                                            \
+    retval = code;                                                             \
+    goto scan_fail;                                                            \
+  }
+
+  state->jsonLength = limit - data;
+  state->json = malloc(state->jsonLength + 1);
+  if (NULL == state->json)
+    SCAN_FAIL(FPX3D_MEMORY_ERROR);
+
+  memcpy(state->json, data, state->jsonLength);
+  state->json[state->jsonLength] = '\0';
+
+  const uint8_t *base = (const uint8_t *)state->json;
+  const uint8_t *cursor = base;
+  limit = base + state->jsonLength;
+
+  // index + 1 of the default scene, as "scenes" may come after it
+  size_t default_scene = 0;
+
+  TRIM_WHITESPACE(cursor, limit);
+  if (cursor >= limit || '{' != *cursor)
+    SCAN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+  ++cursor;
+
+  while (true) {
+    TRIM_WHITESPACE(cursor, limit);
+    if (cursor >= limit)
+      SCAN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+    if ('}' == *cursor)
+      break;
+
+    if ('"' != *cursor)
+      SCAN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+    const uint8_t *key = cursor + 1;
+    cursor = _skip_json_string(cursor, limit);
+    if (NULL == cursor)
+      SCAN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+    size_t key_length = (cursor - 1) - key;
+
+    TRIM_WHITESPACE(cursor, limit);
+    if (cursor >= limit || ':' != *cursor)
+      SCAN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+    ++cursor;
+    TRIM_WHITESPACE(cursor, limit);
+
+    if (5 == key_length && 0 == memcmp("scene", key, key_length) &&
+        cursor < limit && '0' <= *cursor && '9' >= *cursor)
+      default_scene = strtoull((const char *)cursor, NULL, 10) + 1;
+
+    size_t type = FPX3D_GLTF_ENTITY_TYPE_COUNT;
+    for (size_t i = 0; i < ARRAY_SIZE(entity_keys); ++i) {
+      if (strlen(entity_keys[i]) == key_length &&
+          0 == memcmp(entity_keys[i], key, key_length))
+        type = i;
+    }
+
+    if (FPX3D_GLTF_ENTITY_TYPE_COUNT == type || cursor >= limit ||
+        '[' != *cursor || NULL != state->entities[type].spans) {
+      cursor = _skip_json_value(cursor, limit);
+      if (NULL == cursor)
+        SCAN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+    } else {
+      struct _lazy_span *spans = NULL;
+      size_t span_count = 0, span_capacity = 0;
+
+      ++cursor;
+
+      while (true) {
+        TRIM_WHITESPACE(cursor, limit);
+        if (cursor >= limit) {
+          FREE_SAFE(spans);
+          SCAN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+        }
+
+        if (']' == *cursor)
+          break;
+
+        const uint8_t *element_end = _skip_json_value(cursor, limit);
+        if (NULL == element_end) {
+          FREE_SAFE(spans);
+          SCAN_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+        }
+
+        if (span_count == span_capacity) {
+          size_t new_capacity = MAX(span_capacity * 2, (size_t)16);
+
+          Fpx3d_E_Result alloc_res = __fpx3d_realloc_array(
+              (void **)&spans, sizeof(spans[0]), new_capacity, &span_capacity);
+
+          if (FPX3D_SUCCESS > alloc_res) {
+            FREE_SAFE(spans);
+            SCAN_FAIL(alloc_res);
+          }
+        }
+
+        spans[span_count].offset = cursor - base;
+        spans[span_count].length = element_end - cursor;
+        ++span_count;
+
+        cursor = element_end;
+        TRIM_WHITESPACE(cursor, limit);
+
+        if (cursor < limit && ',' == *cursor)
+          ++cursor;
+      }
+
+      ++cursor;
+
+      if (0 < span_count) {
+        state->entities[type].spans = spans;
+        state->entities[type].parsed = calloc(span_count, sizeof(bool));
+
+        if (NULL == state->entities[type].parsed)
+          SCAN_FAIL(FPX3D_MEMORY_ERROR);
+
+        Fpx3d_E_Result alloc_res = _alloc_entities(output, type, span_count);
+        if (FPX3D_SUCCESS > alloc_res)
+          SCAN_FAIL(alloc_res);
+      }
+    }
+
+    TRIM_WHITESPACE(cursor, limit);
+    if (cursor < limit && ',' == *cursor)
+      ++cursor;
+  }
+
+#undef SCAN_FAIL
+
+  if (0 < default_scene && default_scene <= output->sceneCount)
+    output->scene = &output->scenes[default_scene - 1];
+
+  FPX3D_DEBUG(" - Scanned %" LONG_FORMAT "u nodes, %" LONG_FORMAT
+              "u meshes, %" LONG_FORMAT "u accessors",
+              output->nodeCount, output->meshCount, output->accessorCount);
+
+  return FPX3D_SUCCESS;
+
+scan_fail:
+  _free_lazy_state(state);
+  _free_top_level(output);
+
+  return retval;
+}
+
+static Fpx3d_E_Result
+_lazy_parse(Fpx3d_Model_GltfAssetDescription *desc,
+            Fpx3d_Model_E_GltfEntityType type, size_t index) {
+  static Fpx3d_E_Result (*const parsers[FPX3D_GLTF_ENTITY_TYPE_COUNT])(
+      Fpx_Json_Array *, size_t, Fpx3d_Model_GltfAssetDescription *) = {
+      _parse_scenes,    _parse_cameras,   _parse_nodes,
+      _parse_meshes,    _parse_buffers,   _parse_buffer_views,
+      _parse_accessors, _parse_images,    _parse_samplers,
+      _parse_textures,  _parse_materials, _parse_skins,
+      _parse_animations,
+  };
+
+  struct fpx3d_model_gltf_lazy_state *state = desc->lazy;
+  const struct _lazy_span *span = &state->entities[type].spans[index];
+
+  Fpx_Json_Entity json =
+      fpx_json_read(state->json + span->offset, span->length);
+
+  if (!json.isValid || FPX_JSON_VALUE_OBJECT != json.root.valueType) {
+    fpx_json_destroy(&json);
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+  }
+
+  // the parsers take an array and write it to consecutive entities
+  // starting at `index`, so hand it a single-element one
+  Fpx_Json_Array single = {.values = &json.root, .count = 1};
+
+  Fpx3d_E_Result parse_res = parsers[type](&single, index, desc);
+  fpx_json_destroy(&json);
+
+  if (FPX3D_SUCCESS > parse_res)
+    return parse_res;
+
+  state->entities[type].parsed[index] = true;
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result
+_lazy_require(Fpx3d_Model_GltfAssetDescription *desc,
+              const Fpx3d_Model_GltfBuffer *glb_binary,
+              Fpx3d_Model_E_GltfEntityType type, size_t index) {
+  if (desc->lazy->entities[type].parsed[index])
+    return FPX3D_SUCCESS;
+
+  // marks the entity as parsed before going into its references,
+  // so cycles (which are invalid anyway) can't recurse forever
+  Fpx3d_E_Result retval = _lazy_parse(desc, type, index);
+  if (FPX3D_SUCCESS > retval)
+    return retval;
+
+#define REQUIRE(entity_type, pointer, array)                                   \
+  {                                                                            \
+    if (NULL != (pointer)) {                                                   \
+      Fpx3d_E_Result require_res = _lazy_require(                              \
+          desc, glb_binary, entity_type, (pointer) - desc->array);             \
+      if (FPX3D_SUCCESS > require_res)                                         \
+        return require_res;                                                    \
+    }                                                                          \
+  }
+
+  switch (type) {
+  case FPX3D_GLTF_ENTITY_SCENE: {
+    Fpx3d_Model_GltfScene *scene = &desc->scenes[index];
+
+    for (size_t i = 0; i < scene->nodeCount; ++i)
+      REQUIRE(FPX3D_GLTF_ENTITY_NODE, scene->nodes[i], nodes);
+  } break;
+
+  case FPX3D_GLTF_ENTITY_NODE: {
+    Fpx3d_Model_GltfNode *node = &desc->nodes[index];
+
+    REQUIRE(FPX3D_GLTF_ENTITY_CAMERA, node->camera, cameras);
+    REQUIRE(FPX3D_GLTF_ENTITY_SKIN, node->skin, skins);
+    REQUIRE(FPX3D_GLTF_ENTITY_MESH, node->mesh, meshes);
+
+    for (size_t i = 0; i < node->childCount; ++i)
+      REQUIRE(FPX3D_GLTF_ENTITY_NODE, node->children[i], nodes);
+  } break;
+
+  case FPX3D_GLTF_ENTITY_MESH: {
+    Fpx3d_Model_GltfMesh *mesh = &desc->meshes[index];
+
+    for (size_t p = 0; p < mesh->primitiveCount; ++p) {
+      struct fpx3d_model_gltf_mesh_primitive *prim = &mesh->primitives[p];
+
+      for (size_t a = 0; a < prim->attributeCount; ++a)
+        REQUIRE(FPX3D_GLTF_ENTITY_ACCESSOR, prim->attributes[a].accessor,
+                accessors);
+
+      for (size_t t = 0; t < prim->morphTargetCount; ++t) {
+        for (size_t a = 0; a < prim->morphTargets[t].attributeCount; ++a)
+          REQUIRE(FPX3D_GLTF_ENTITY_ACCESSOR,
+                  prim->morphTargets[t].attributes[a].accessor, accessors);
+      }
+
+      REQUIRE(FPX3D_GLTF_ENTITY_ACCESSOR, prim->indices, accessors);
+      REQUIRE(FPX3D_GLTF_ENTITY_MATERIAL, prim->material, materials);
+    }
+  } break;
+
+  case FPX3D_GLTF_ENTITY_BUFFER_VIEW: {
+    Fpx3d_Model_GltfBufferView *view = &desc->bufferViews[index];
+
+    REQUIRE(FPX3D_GLTF_ENTITY_BUFFER, view->buffer, buffers);
+    REQUIRE(FPX3D_GLTF_ENTITY_BUFFER, view->meshopt.buffer, buffers);
+
+    retval = _decode_view(view, index, glb_binary);
+  } break;
+
+  case FPX3D_GLTF_ENTITY_ACCESSOR: {
+    Fpx3d_Model_GltfAccessor *acc = &desc->accessors[index];
+
+    REQUIRE(FPX3D_GLTF_ENTITY_BUFFER_VIEW, acc->view, bufferViews);
+    REQUIRE(FPX3D_GLTF_ENTITY_BUFFER_VIEW, acc->sparse.indices.view,
+            bufferViews);
+    REQUIRE(FPX3D_GLTF_ENTITY_BUFFER_VIEW, acc->sparse.values.view,
+            bufferViews);
+  } break;
+
+  case FPX3D_GLTF_ENTITY_IMAGE:
+    REQUIRE(FPX3D_GLTF_ENTITY_BUFFER_VIEW, desc->images[index].bufferView,
+            bufferViews);
+    break;
+
+  case FPX3D_GLTF_ENTITY_TEXTURE:
+    REQUIRE(FPX3D_GLTF_ENTITY_SAMPLER, desc->textures[index].sampler,
+            samplers);
+    REQUIRE(FPX3D_GLTF_ENTITY_IMAGE, desc->textures[index].sourceImage,
+            images);
+    break;
+
+  case FPX3D_GLTF_ENTITY_MATERIAL: {
+    Fpx3d_Model_GltfMaterial *mat = &desc->materials[index];
+
+    REQUIRE(FPX3D_GLTF_ENTITY_TEXTURE,
+            mat->pbrMetallicRoughness.baseColorTexture.texture, textures);
+    REQUIRE(FPX3D_GLTF_ENTITY_TEXTURE,
+            mat->pbrMetallicRoughness.metallicRoughnessTexture.texture,
+            textures);
+    REQUIRE(FPX3D_GLTF_ENTITY_TEXTURE, mat->normalTexture.textureInfo.texture,
+            textures);
+    REQUIRE(FPX3D_GLTF_ENTITY_TEXTURE,
+            mat->occlusionTexture.textureInfo.texture, textures);
+    REQUIRE(FPX3D_GLTF_ENTITY_TEXTURE, mat->emissiveTexture.texture,
+            textures);
+  } break;
+
+  case FPX3D_GLTF_ENTITY_SKIN: {
+    Fpx3d_Model_GltfSkin *skin = &desc->skins[index];
+
+    REQUIRE(FPX3D_GLTF_ENTITY_ACCESSOR, skin->inverseBindMatrices, accessors);
+    REQUIRE(FPX3D_GLTF_ENTITY_NODE, skin->skeletonRoot, nodes);
+
+    for (size_t i = 0; i < skin->jointCount; ++i)
+      REQUIRE(FPX3D_GLTF_ENTITY_NODE, skin->joints[i], nodes);
+  } break;
+
+  case FPX3D_GLTF_ENTITY_ANIMATION: {
+    Fpx3d_Model_GltfAnimation *anim = &desc->animations[index];
+
+    for (size_t i = 0; i < anim->channelCount; ++i)
+      REQUIRE(FPX3D_GLTF_ENTITY_NODE, anim->channels[i].target.node, nodes);
+
+    for (size_t i = 0; i < anim->samplerCount; ++i) {
+      REQUIRE(FPX3D_GLTF_ENTITY_ACCESSOR, anim->samplers[i].keyframes,
+              accessors);
+      REQUIRE(FPX3D_GLTF_ENTITY_ACCESSOR, anim->samplers[i].outputValues,
+              accessors);
+    }
+  } break;
+
+  default:
+    // cameras, buffers and samplers refer to nothing else
+    break;
+  }
+
+#undef REQUIRE
+
+  return retval;
+}
+
+static void _free_lazy_state(struct fpx3d_model_gltf_lazy_state *state) {
+  NULL_CHECK(state, );
+
+  for (size_t i = 0; i < ARRAY_SIZE(state->entities); ++i) {
+    FREE_SAFE(state->entities[i].spans);
+    FREE_SAFE(state->entities[i].parsed);
+  }
+
+  FREE_SAFE(state->json);
+  free(state);
+
+  return;
+}
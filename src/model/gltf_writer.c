@@ -0,0 +1,1572 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+#include "model/gltf.h"
+#include "model/typedefs.h"
+
+#define GLB_MAGIC 0x46546C67
+#define GLB_VERSION 2
+#define GLB_CHUNK_JSON 0x4E4F534A
+#define GLB_CHUNK_BIN 0x004E4942
+
+#define GLB_HEADER_SIZE 12
+#define GLB_CHUNK_HEADER_SIZE 8
+
+#define GLB_ALIGNMENT 4
+#define ALIGN_GLB(size)                                                        \
+  (((size) + GLB_ALIGNMENT - 1) & ~(size_t)(GLB_ALIGNMENT - 1))
+
+// everything smaller than this is gathered before being handed to the
+// write callback. Bigger blocks (view contents) go through directly
+#define WRITE_BUFFER_SIZE (64 * 1024)
+
+#define NO_INDEX SIZE_MAX
+
+extern const uint8_t *
+__fpx3d_model_gltf_view_data(const Fpx3d_Model_GltfAsset *asset,
+                             const Fpx3d_Model_GltfBufferView *view);
+
+extern bool
+__fpx3d_model_gltf_fully_parsed(const Fpx3d_Model_GltfAssetDescription *desc);
+
+extern size_t
+__fpx3d_model_gltf_accessor_element_size(const Fpx3d_Model_GltfAccessor *acc);
+
+extern size_t
+__fpx3d_model_gltf_component_size(Fpx3d_Model_E_GltfComponentType type);
+
+extern Fpx3d_E_Result
+__fpx3d_model_gltf_read_accessor(const Fpx3d_Model_GltfAsset *asset,
+                                 const Fpx3d_Model_GltfAccessor *acc,
+                                 void *output, size_t output_stride);
+
+extern uint64_t __fpx3d_hash64(const void *data, size_t length,
+                               uint64_t seed);
+
+struct _glb_output {
+  Fpx3d_Model_GlbWriteCallback write;
+  void *userData;
+
+  uint8_t buffer[WRITE_BUFFER_SIZE];
+  size_t used;
+
+  bool failed;
+};
+
+struct _json_builder {
+  char *data;
+  size_t length;
+  size_t capacity;
+
+  // set after every value, so the next key or array element
+  // knows to put a comma in front of itself
+  bool needComma;
+
+  bool failed;
+};
+
+struct _accessor_bounds {
+  float min[16];
+  float max[16];
+  bool present;
+};
+
+struct _glb_layout {
+  const Fpx3d_Model_GltfAsset *asset;
+  const Fpx3d_Model_GltfAssetDescription *desc;
+
+  // indexed by source buffer view
+  size_t *viewRemap;
+
+  // indexed by output buffer view
+  size_t *viewSources;
+  size_t *viewOffsets;
+  size_t viewCount;
+
+  size_t binLength;
+
+  // indexed by source accessor
+  size_t *accessorRemap;
+
+  // indexed by output accessor
+  size_t *accessorSources;
+  struct _accessor_bounds *accessorBounds;
+  size_t accessorCount;
+
+  bool needsQuantization;
+};
+
+// static declarations ----
+
+static bool _file_write(void *user_data, const void *data, size_t length);
+
+static void _output_flush(struct _glb_output *out);
+static void _output_write(struct _glb_output *out, const void *data,
+                          size_t length);
+static void _output_u32(struct _glb_output *out, uint32_t value);
+static void _output_pad(struct _glb_output *out, uint8_t byte, size_t count);
+
+static void _json_append(struct _json_builder *json, const char *str,
+                         size_t length);
+static void _json_printf(struct _json_builder *json, const char *fmt, ...);
+static void _json_separate(struct _json_builder *json);
+static void _json_begin(struct _json_builder *json, char bracket);
+static void _json_end(struct _json_builder *json, char bracket);
+static void _json_key(struct _json_builder *json, const char *key);
+static void _json_uint(struct _json_builder *json, size_t value);
+static void _json_float(struct _json_builder *json, float value);
+static void _json_string(struct _json_builder *json, const char *str);
+static void _json_key_uint(struct _json_builder *json, const char *key,
+                           size_t value);
+static void _json_key_float(struct _json_builder *json, const char *key,
+                            float value);
+static void _json_key_string(struct _json_builder *json, const char *key,
+                             const char *str);
+static void _json_float_array(struct _json_builder *json, const float *values,
+                              size_t count);
+
+static Fpx3d_E_Result _build_layout(const Fpx3d_Model_GltfAsset *asset,
+                                    struct _glb_layout *layout);
+static void _free_layout(struct _glb_layout *layout);
+
+static void _mark_view(const struct _glb_layout *layout, bool *referenced,
+                       const Fpx3d_Model_GltfBufferView *view);
+static size_t _remap_view(const struct _glb_layout *layout,
+                          const Fpx3d_Model_GltfBufferView *view);
+static size_t _component_count(const Fpx3d_Model_GltfAccessor *acc);
+static size_t _table_size(size_t count);
+static uint64_t _hash_view(const Fpx3d_Model_GltfBufferView *view,
+                           const uint8_t *data);
+static uint64_t _hash_accessor(const struct _glb_layout *layout,
+                               const Fpx3d_Model_GltfAccessor *acc);
+static bool _accessors_equal(const struct _glb_layout *layout,
+                             const Fpx3d_Model_GltfAccessor *a,
+                             const Fpx3d_Model_GltfAccessor *b);
+static float _component_value(const uint8_t *data,
+                              Fpx3d_Model_E_GltfComponentType type);
+static Fpx3d_E_Result _fill_bounds(const struct _glb_layout *layout,
+                                   const Fpx3d_Model_GltfAccessor *acc,
+                                   bool required,
+                                   struct _accessor_bounds *output);
+
+static bool _is_zero(const float *values, size_t count);
+static const char *_attribute_name(
+    const struct fpx3d_model_gltf_primitive_attribute *attribute, char *buffer,
+    size_t buffer_size);
+
+static void _write_json(const struct _glb_layout *layout,
+                        struct _json_builder *json);
+static void _write_accessor_ref(const struct _glb_layout *layout,
+                                struct _json_builder *json, const char *key,
+                                const Fpx3d_Model_GltfAccessor *acc);
+static void _write_attributes(const struct _glb_layout *layout,
+                              struct _json_builder *json,
+                              const struct fpx3d_model_gltf_primitive_attribute
+                                  *attributes,
+                              size_t count);
+static void
+_write_texture_info(const struct _glb_layout *layout,
+                    struct _json_builder *json, const char *key,
+                    const struct fpx3d_model_gltf_texture_info *info,
+                    const char *factor_key, float factor);
+
+// end of static declarations ----
+
+Fpx3d_E_Result fpx3d_model_write_glb(const Fpx3d_Model_GltfAsset *asset,
+                                     Fpx3d_Model_GlbWriteCallback write,
+                                     void *user_data) {
+  NULL_CHECK(asset, FPX3D_ARGS_ERROR);
+  NULL_CHECK(write, FPX3D_ARGS_ERROR);
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  struct _glb_layout layout = {0};
+  struct _json_builder json = {0};
+  struct _glb_output *out = NULL;
+
+#define WRITE_FAIL(code)                                                       \
+  {                                                                            \
+    retval = code;                                                             \
+    goto write_glb_cleanup;                                                    \
+  }
+
+  retval = _build_layout(asset, &layout);
+  if (FPX3D_SUCCESS != retval)
+    WRITE_FAIL(retval);
+
+  _write_json(&layout, &json);
+  if (json.failed)
+    WRITE_FAIL(FPX3D_MEMORY_ERROR);
+
+  size_t json_chunk_length = ALIGN_GLB(json.length);
+  size_t bin_chunk_length = ALIGN_GLB(layout.binLength);
+
+  size_t total_length =
+      GLB_HEADER_SIZE + GLB_CHUNK_HEADER_SIZE + json_chunk_length;
+  if (0 < layout.binLength)
+    total_length += GLB_CHUNK_HEADER_SIZE + bin_chunk_length;
+
+  if (UINT32_MAX < total_length) {
+    FPX3D_WARN("Asset does not fit in a GLB container (%" LONG_FORMAT
+               "u bytes)",
+               total_length);
+    WRITE_FAIL(FPX3D_NO_CAPACITY_ERROR);
+  }
+
+  out = malloc(sizeof(*out));
+  if (NULL == out)
+    WRITE_FAIL(FPX3D_MEMORY_ERROR);
+
+  out->write = write;
+  out->userData = user_data;
+  out->used = 0;
+  out->failed = false;
+
+  _output_u32(out, GLB_MAGIC);
+  _output_u32(out, GLB_VERSION);
+  _output_u32(out, (uint32_t)total_length);
+
+  _output_u32(out, (uint32_t)json_chunk_length);
+  _output_u32(out, GLB_CHUNK_JSON);
+  _output_write(out, json.data, json.length);
+  _output_pad(out, ' ', json_chunk_length - json.length);
+
+  if (0 < layout.binLength) {
+    _output_u32(out, (uint32_t)bin_chunk_length);
+    _output_u32(out, GLB_CHUNK_BIN);
+
+    size_t position = 0;
+    for (size_t i = 0; i < layout.viewCount && !out->failed; ++i) {
+      const Fpx3d_Model_GltfBufferView *view =
+          &layout.desc->bufferViews[layout.viewSources[i]];
+
+      _output_pad(out, 0, layout.viewOffsets[i] - position);
+      _output_write(out, __fpx3d_model_gltf_view_data(asset, view),
+                    view->byteLength);
+
+      position = layout.viewOffsets[i] + view->byteLength;
+    }
+
+    _output_pad(out, 0, bin_chunk_length - position);
+  }
+
+  _output_flush(out);
+
+  if (out->failed)
+    WRITE_FAIL(FPX3D_GENERIC_ERROR);
+
+#undef WRITE_FAIL
+
+write_glb_cleanup:
+  FREE_SAFE(out);
+  FREE_SAFE(json.data);
+  _free_layout(&layout);
+
+  return retval;
+}
+
+Fpx3d_E_Result fpx3d_model_save_glb(const Fpx3d_Model_GltfAsset *asset,
+                                    const char *path) {
+  NULL_CHECK(asset, FPX3D_ARGS_ERROR);
+  NULL_CHECK(path, FPX3D_ARGS_ERROR);
+
+  FILE *file = fopen(path, "wb");
+  if (NULL == file) {
+    FPX3D_WARN("Could not open \"%s\" for writing", path);
+    return FPX3D_ARGS_ERROR;
+  }
+
+  Fpx3d_E_Result retval = fpx3d_model_write_glb(asset, _file_write, file);
+
+  if (0 != fclose(file) && FPX3D_SUCCESS == retval)
+    retval = FPX3D_GENERIC_ERROR;
+
+  return retval;
+}
+
+// STATIC FUNCTIONS ----
+
+static bool _file_write(void *user_data, const void *data, size_t length) {
+  return fwrite(data, 1, length, (FILE *)user_data) == length;
+}
+
+static void _output_flush(struct _glb_output *out) {
+  if (0 < out->used && !out->failed)
+    out->failed = !out->write(out->userData, out->buffer, out->used);
+
+  out->used = 0;
+}
+
+static void _output_write(struct _glb_output *out, const void *data,
+                          size_t length) {
+  if (out->failed || 0 == length)
+    return;
+
+  if (WRITE_BUFFER_SIZE - out->used >= length) {
+    memcpy(&out->buffer[out->used], data, length);
+    out->used += length;
+    return;
+  }
+
+  _output_flush(out);
+
+  if (WRITE_BUFFER_SIZE <= length) {
+    // no point in copying this through the buffer
+    if (!out->failed)
+      out->failed = !out->write(out->userData, data, length);
+    return;
+  }
+
+  memcpy(out->buffer, data, length);
+  out->used = length;
+}
+
+static void _output_u32(struct _glb_output *out, uint32_t value) {
+  // GLB is little-endian regardless of the host
+  uint8_t bytes[4] = {
+      value & 0xFF,
+      (value >> 8) & 0xFF,
+      (value >> 16) & 0xFF,
+      (value >> 24) & 0xFF,
+  };
+
+  _output_write(out, bytes, sizeof(bytes));
+}
+
+static void _output_pad(struct _glb_output *out, uint8_t byte, size_t count) {
+  uint8_t padding[GLB_ALIGNMENT];
+  memset(padding, byte, sizeof(padding));
+
+  // never more than alignment - 1 bytes, but don't rely on it
+  while (0 < count) {
+    size_t amount = MIN(count, sizeof(padding));
+    _output_write(out, padding, amount);
+    count -= amount;
+  }
+}
+
+static void _json_append(struct _json_builder *json, const char *str,
+                         size_t length) {
+  if (json->failed)
+    return;
+
+  if (json->length + length + 1 > json->capacity) {
+    size_t new_capacity = MAX(json->capacity * 2, 4096);
+    while (json->length + length + 1 > new_capacity)
+      new_capacity *= 2;
+
+    char *new_data = realloc(json->data, new_capacity);
+    if (NULL == new_data) {
+      json->failed = true;
+      return;
+    }
+
+    json->data = new_data;
+    json->capacity = new_capacity;
+  }
+
+  memcpy(&json->data[json->length], str, length);
+  json->length += length;
+  json->data[json->length] = '\0';
+}
+
+static void _json_printf(struct _json_builder *json, const char *fmt, ...) {
+  char text[64];
+
+  va_list args;
+  va_start(args, fmt);
+  int length = vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+
+  if (0 > length || sizeof(text) <= (size_t)length) {
+    json->failed = true;
+    return;
+  }
+
+  _json_append(json, text, length);
+}
+
+static void _json_separate(struct _json_builder *json) {
+  if (json->needComma)
+    _json_append(json, ",", 1);
+
+  json->needComma = false;
+}
+
+static void _json_begin(struct _json_builder *json, char bracket) {
+  _json_separate(json);
+  _json_append(json, &bracket, 1);
+}
+
+static void _json_end(struct _json_builder *json, char bracket) {
+  _json_append(json, &bracket, 1);
+  json->needComma = true;
+}
+
+static void _json_key(struct _json_builder *json, const char *key) {
+  _json_separate(json);
+  _json_append(json, "\"", 1);
+  _json_append(json, key, strlen(key));
+  _json_append(json, "\":", 2);
+}
+
+static void _json_uint(struct _json_builder *json, size_t value) {
+  _json_separate(json);
+  _json_printf(json, "%" LONG_FORMAT "u", value);
+  json->needComma = true;
+}
+
+static void _json_float(struct _json_builder *json, float value) {
+  _json_separate(json);
+
+  // JSON has no representation for these
+  if (!isfinite(value))
+    value = 0.0f;
+
+  // 9 significant digits survive a float round trip
+  _json_printf(json, "%.9g", (double)value);
+  json->needComma = true;
+}
+
+static void _json_string(struct _json_builder *json, const char *str) {
+  _json_separate(json);
+  _json_append(json, "\"", 1);
+
+  const char *run = str;
+  for (; '\0' != *str; ++str) {
+    unsigned char c = *str;
+    if ('"' != c && '\\' != c && 0x20 <= c)
+      continue;
+
+    _json_append(json, run, str - run);
+    run = str + 1;
+
+    switch (c) {
+    case '"':
+      _json_append(json, "\\\"", 2);
+      break;
+    case '\\':
+      _json_append(json, "\\\\", 2);
+      break;
+    case '\n':
+      _json_append(json, "\\n", 2);
+      break;
+    case '\r':
+      _json_append(json, "\\r", 2);
+      break;
+    case '\t':
+      _json_append(json, "\\t", 2);
+      break;
+    default:
+      _json_printf(json, "\\u%04x", c);
+      break;
+    }
+  }
+
+  _json_append(json, run, str - run);
+  _json_append(json, "\"", 1);
+  json->needComma = true;
+}
+
+static void _json_key_uint(struct _json_builder *json, const char *key,
+                           size_t value) {
+  _json_key(json, key);
+  _json_uint(json, value);
+}
+
+static void _json_key_float(struct _json_builder *json, const char *key,
+                            float value) {
+  _json_key(json, key);
+  _json_float(json, value);
+}
+
+static void _json_key_string(struct _json_builder *json, const char *key,
+                             const char *str) {
+  if (NULL == str)
+    return;
+
+  _json_key(json, key);
+  _json_string(json, str);
+}
+
+static void _json_float_array(struct _json_builder *json, const float *values,
+                              size_t count) {
+  _json_begin(json, '[');
+  for (size_t i = 0; i < count; ++i)
+    _json_float(json, values[i]);
+  _json_end(json, ']');
+}
+
+static Fpx3d_E_Result _build_layout(const Fpx3d_Model_GltfAsset *asset,
+                                    struct _glb_layout *layout) {
+  const Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(asset);
+  NULL_CHECK(desc, FPX3D_ARGS_ERROR);
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  // unparsed entities are all zeroes, and would be written as such
+  if (!__fpx3d_model_gltf_fully_parsed(desc)) {
+    FPX3D_WARN("Lazily read asset has entities that were never required, "
+               "cannot write GLB");
+    return FPX3D_ARGS_ERROR;
+  }
+
+  layout->asset = asset;
+  layout->desc = desc;
+
+  size_t view_count = desc->bufferViewCount;
+  size_t accessor_count = desc->accessorCount;
+
+  bool *referenced = calloc(view_count + 1, sizeof(bool));
+  bool *needs_bounds = calloc(accessor_count + 1, sizeof(bool));
+
+  // open-addressing tables of output indices, to find identical views and
+  // accessors by hash; `hashes` is indexed by output view, then accessor
+  size_t view_table_size = _table_size(view_count);
+  size_t accessor_table_size = _table_size(accessor_count);
+
+  uint64_t *hashes = calloc(view_count + accessor_count + 1, sizeof(uint64_t));
+  size_t *view_table = malloc(view_table_size * sizeof(size_t));
+  size_t *accessor_table = malloc(accessor_table_size * sizeof(size_t));
+
+  layout->viewRemap = calloc(view_count + 1, sizeof(size_t));
+  layout->viewSources = calloc(view_count + 1, sizeof(size_t));
+  layout->viewOffsets = calloc(view_count + 1, sizeof(size_t));
+  layout->accessorRemap = calloc(accessor_count + 1, sizeof(size_t));
+  layout->accessorSources = calloc(accessor_count + 1, sizeof(size_t));
+  layout->accessorBounds =
+      calloc(accessor_count + 1, sizeof(struct _accessor_bounds));
+
+#define LAYOUT_FAIL(code)                                                      \
+  {                                                                            \
+    retval = code;                                                             \
+    goto build_layout_cleanup;                                                 \
+  }
+
+  if (NULL == referenced || NULL == needs_bounds || NULL == hashes ||
+      NULL == view_table || NULL == accessor_table ||
+      NULL == layout->viewRemap || NULL == layout->viewSources ||
+      NULL == layout->viewOffsets || NULL == layout->accessorRemap ||
+      NULL == layout->accessorSources || NULL == layout->accessorBounds)
+    LAYOUT_FAIL(FPX3D_MEMORY_ERROR);
+
+  for (size_t i = 0; i < view_table_size; ++i)
+    view_table[i] = NO_INDEX;
+
+  for (size_t i = 0; i < accessor_table_size; ++i)
+    accessor_table[i] = NO_INDEX;
+
+  // only views that something points at end up in the BIN chunk
+  for (size_t i = 0; i < accessor_count; ++i) {
+    const Fpx3d_Model_GltfAccessor *acc = &desc->accessors[i];
+
+    _mark_view(layout, referenced, acc->view);
+
+    if (0 < acc->sparse.count) {
+      _mark_view(layout, referenced, acc->sparse.indices.view);
+      _mark_view(layout, referenced, acc->sparse.values.view);
+    }
+  }
+
+  for (size_t i = 0; i < desc->imageCount; ++i)
+    _mark_view(layout, referenced, desc->images[i].bufferView);
+
+  // POSITION and animation inputs need min/max, and anything other than
+  // float needs KHR_mesh_quantization for the vertex attributes below
+  for (size_t i = 0; i < desc->animationCount; ++i) {
+    const Fpx3d_Model_GltfAnimation *anim = &desc->animations[i];
+
+    for (size_t s = 0; s < anim->samplerCount; ++s) {
+      if (NULL != anim->samplers[s].keyframes)
+        needs_bounds[anim->samplers[s].keyframes - desc->accessors] = true;
+    }
+  }
+
+  for (size_t m = 0; m < desc->meshCount; ++m) {
+    const Fpx3d_Model_GltfMesh *mesh = &desc->meshes[m];
+
+    for (size_t p = 0; p < mesh->primitiveCount; ++p) {
+      const struct fpx3d_model_gltf_mesh_primitive *prim =
+          &mesh->primitives[p];
+
+      for (size_t t = 0; t <= prim->morphTargetCount; ++t) {
+        const struct fpx3d_model_gltf_primitive_attribute *attributes =
+            (0 == t) ? prim->attributes : prim->morphTargets[t - 1].attributes;
+        size_t count = (0 == t) ? prim->attributeCount
+                                : prim->morphTargets[t - 1].attributeCount;
+
+        for (size_t a = 0; a < count; ++a) {
+          const Fpx3d_Model_GltfAccessor *acc = attributes[a].accessor;
+          if (NULL == acc)
+            continue;
+
+          if (FPX3D_GLTF_MESH_ATTRIBUTE_POSITION == attributes[a].attribute)
+            needs_bounds[acc - desc->accessors] = true;
+
+          if ((FPX3D_GLTF_MESH_ATTRIBUTE_POSITION == attributes[a].attribute ||
+               FPX3D_GLTF_MESH_ATTRIBUTE_NORMAL == attributes[a].attribute ||
+               FPX3D_GLTF_MESH_ATTRIBUTE_TANGENT == attributes[a].attribute) &&
+              FPX3D_GLTF_COMPONENT_TYPE_FLOAT != acc->componentType)
+            layout->needsQuantization = true;
+        }
+      }
+    }
+  }
+
+  // merge byte-identical views, and pack the rest back to back
+  for (size_t i = 0; i < view_count; ++i) {
+    layout->viewRemap[i] = NO_INDEX;
+
+    if (!referenced[i])
+      continue;
+
+    const Fpx3d_Model_GltfBufferView *view = &desc->bufferViews[i];
+    const uint8_t *data = __fpx3d_model_gltf_view_data(asset, view);
+
+    if (NULL == data) {
+      FPX3D_WARN("Contents of buffer view %" LONG_FORMAT
+                 "u are not available, cannot write GLB",
+                 i);
+      LAYOUT_FAIL(FPX3D_MODEL_ERROR);
+    }
+
+    uint64_t hash = _hash_view(view, data);
+
+    size_t mask = view_table_size - 1;
+    size_t slot = hash & mask;
+    size_t match = NO_INDEX;
+
+    for (; NO_INDEX != view_table[slot]; slot = (slot + 1) & mask) {
+      size_t o = view_table[slot];
+      const Fpx3d_Model_GltfBufferView *other =
+          &desc->bufferViews[layout->viewSources[o]];
+
+      if (hashes[o] == hash && other->byteLength == view->byteLength &&
+          other->byteStride == view->byteStride &&
+          other->target == view->target &&
+          0 == memcmp(__fpx3d_model_gltf_view_data(asset, other), data,
+                      view->byteLength)) {
+        match = o;
+        break;
+      }
+    }
+
+    if (NO_INDEX != match) {
+      layout->viewRemap[i] = match;
+      continue;
+    }
+
+    size_t o = layout->viewCount++;
+
+    view_table[slot] = o;
+    hashes[o] = hash;
+    layout->viewSources[o] = i;
+    layout->viewOffsets[o] = ALIGN_GLB(layout->binLength);
+    layout->viewRemap[i] = o;
+
+    layout->binLength = layout->viewOffsets[o] + view->byteLength;
+  }
+
+  // merge accessors that would serialize to the same JSON
+  for (size_t i = 0; i < accessor_count; ++i) {
+    const Fpx3d_Model_GltfAccessor *acc = &desc->accessors[i];
+    uint64_t *accessor_hashes = hashes + view_count;
+
+    uint64_t hash = _hash_accessor(layout, acc);
+
+    size_t mask = accessor_table_size - 1;
+    size_t slot = hash & mask;
+    size_t match = NO_INDEX;
+
+    for (; NO_INDEX != accessor_table[slot]; slot = (slot + 1) & mask) {
+      size_t o = accessor_table[slot];
+
+      if (accessor_hashes[o] == hash &&
+          _accessors_equal(layout,
+                           &desc->accessors[layout->accessorSources[o]], acc)) {
+        match = o;
+        break;
+      }
+    }
+
+    if (NO_INDEX != match) {
+      layout->accessorRemap[i] = match;
+
+      if (needs_bounds[i] && !layout->accessorBounds[match].present) {
+        retval = _fill_bounds(layout, acc, true,
+                              &layout->accessorBounds[match]);
+        if (FPX3D_SUCCESS != retval)
+          LAYOUT_FAIL(retval);
+      }
+
+      continue;
+    }
+
+    size_t o = layout->accessorCount++;
+
+    accessor_table[slot] = o;
+    accessor_hashes[o] = hash;
+    layout->accessorSources[o] = i;
+    layout->accessorRemap[i] = o;
+
+    retval =
+        _fill_bounds(layout, acc, needs_bounds[i], &layout->accessorBounds[o]);
+    if (FPX3D_SUCCESS != retval)
+      LAYOUT_FAIL(retval);
+  }
+
+#undef LAYOUT_FAIL
+
+build_layout_cleanup:
+  FREE_SAFE(referenced);
+  FREE_SAFE(needs_bounds);
+  FREE_SAFE(hashes);
+  FREE_SAFE(view_table);
+  FREE_SAFE(accessor_table);
+
+  return retval;
+}
+
+static void _free_layout(struct _glb_layout *layout) {
+  FREE_SAFE(layout->viewRemap);
+  FREE_SAFE(layout->viewSources);
+  FREE_SAFE(layout->viewOffsets);
+  FREE_SAFE(layout->accessorRemap);
+  FREE_SAFE(layout->accessorSources);
+  FREE_SAFE(layout->accessorBounds);
+}
+
+static void _mark_view(const struct _glb_layout *layout, bool *referenced,
+                       const Fpx3d_Model_GltfBufferView *view) {
+  if (NULL != view)
+    referenced[view - layout->desc->bufferViews] = true;
+}
+
+static size_t _remap_view(const struct _glb_layout *layout,
+                          const Fpx3d_Model_GltfBufferView *view) {
+  if (NULL == view)
+    return NO_INDEX;
+
+  return layout->viewRemap[view - layout->desc->bufferViews];
+}
+
+// a power of two at least twice `count`, so probe runs stay short
+static size_t _table_size(size_t count) {
+  size_t size = 8;
+  while (size < count * 2)
+    size *= 2;
+
+  return size;
+}
+
+static uint64_t _hash_view(const Fpx3d_Model_GltfBufferView *view,
+                           const uint8_t *data) {
+  uint64_t hash = __fpx3d_hash64(&view->byteStride, sizeof(view->byteStride),
+                                 view->byteLength);
+  hash = __fpx3d_hash64(&view->target, sizeof(view->target), hash);
+
+  return __fpx3d_hash64(data, view->byteLength, hash);
+}
+
+// covers what _accessors_equal() compares, field by field, so padding
+// between them doesn't end up in the hash
+static uint64_t _hash_accessor(const struct _glb_layout *layout,
+                               const Fpx3d_Model_GltfAccessor *acc) {
+  size_t fields[] = {
+      _remap_view(layout, acc->view),
+      acc->byteOffset,
+      (size_t)acc->componentType,
+      (size_t)acc->componentsNormalized,
+      acc->elementCount,
+      (size_t)acc->elementType,
+      (size_t)acc->hasBounds,
+      acc->sparse.count,
+  };
+
+  uint64_t hash = __fpx3d_hash64(fields, sizeof(fields), 0);
+
+  if (acc->hasBounds) {
+    hash = __fpx3d_hash64(&acc->minValues, sizeof(acc->minValues), hash);
+    hash = __fpx3d_hash64(&acc->maxValues, sizeof(acc->maxValues), hash);
+  }
+
+  if (0 == acc->sparse.count)
+    return hash;
+
+  size_t sparse_fields[] = {
+      _remap_view(layout, acc->sparse.indices.view),
+      acc->sparse.indices.byteOffset,
+      (size_t)acc->sparse.indices.componentType,
+      _remap_view(layout, acc->sparse.values.view),
+      acc->sparse.values.byteOffset,
+  };
+
+  return __fpx3d_hash64(sparse_fields, sizeof(sparse_fields), hash);
+}
+
+static bool _accessors_equal(const struct _glb_layout *layout,
+                             const Fpx3d_Model_GltfAccessor *a,
+                             const Fpx3d_Model_GltfAccessor *b) {
+  if (_remap_view(layout, a->view) != _remap_view(layout, b->view) ||
+      a->byteOffset != b->byteOffset || a->componentType != b->componentType ||
+      a->componentsNormalized != b->componentsNormalized ||
+      a->elementCount != b->elementCount || a->elementType != b->elementType ||
+      a->hasBounds != b->hasBounds || a->sparse.count != b->sparse.count)
+    return false;
+
+  if (a->hasBounds &&
+      (0 != memcmp(&a->minValues, &b->minValues, sizeof(a->minValues)) ||
+       0 != memcmp(&a->maxValues, &b->maxValues, sizeof(a->maxValues))))
+    return false;
+
+  if (0 == a->sparse.count)
+    return true;
+
+  return _remap_view(layout, a->sparse.indices.view) ==
+             _remap_view(layout, b->sparse.indices.view) &&
+         a->sparse.indices.byteOffset == b->sparse.indices.byteOffset &&
+         a->sparse.indices.componentType == b->sparse.indices.componentType &&
+         _remap_view(layout, a->sparse.values.view) ==
+             _remap_view(layout, b->sparse.values.view) &&
+         a->sparse.values.byteOffset == b->sparse.values.byteOffset;
+}
+
+static size_t _component_count(const Fpx3d_Model_GltfAccessor *acc) {
+  static const size_t component_counts[] = {0, 1, 2, 3, 4, 4, 9, 16};
+
+  if ((size_t)acc->elementType >= ARRAY_SIZE(component_counts))
+    return 0;
+
+  return component_counts[acc->elementType];
+}
+
+// one raw component, as it would appear in min/max: unnormalized
+static float _component_value(const uint8_t *data,
+                              Fpx3d_Model_E_GltfComponentType type) {
+  switch (type) {
+  case FPX3D_GLTF_COMPONENT_TYPE_BYTE:
+    return (float)*(const int8_t *)data;
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+    return (float)*data;
+  case FPX3D_GLTF_COMPONENT_TYPE_SHORT: {
+    int16_t value = 0;
+    memcpy(&value, data, sizeof(value));
+    return (float)value;
+  }
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+    uint16_t value = 0;
+    memcpy(&value, data, sizeof(value));
+    return (float)value;
+  }
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_INT: {
+    uint32_t value = 0;
+    memcpy(&value, data, sizeof(value));
+    return (float)value;
+  }
+  case FPX3D_GLTF_COMPONENT_TYPE_FLOAT: {
+    float value = 0.0f;
+    memcpy(&value, data, sizeof(value));
+    return value;
+  }
+  default:
+    return 0.0f;
+  }
+}
+
+static Fpx3d_E_Result _fill_bounds(const struct _glb_layout *layout,
+                                   const Fpx3d_Model_GltfAccessor *acc,
+                                   bool required,
+                                   struct _accessor_bounds *output) {
+  size_t components = _component_count(acc);
+
+  if (acc->hasBounds) {
+    memcpy(output->min, &acc->minValues, components * sizeof(float));
+    memcpy(output->max, &acc->maxValues, components * sizeof(float));
+    output->present = true;
+    return FPX3D_SUCCESS;
+  }
+
+  // glTF requires them on POSITION and animation inputs, so recompute
+  // those. Both are never matrices
+  size_t component_size =
+      __fpx3d_model_gltf_component_size(acc->componentType);
+
+  if (!required || 0 == acc->elementCount || 0 == component_size ||
+      0 == components ||
+      FPX3D_GLTF_ACCESSOR_ELEMENT_TYPE_VEC4 < acc->elementType)
+    return FPX3D_SUCCESS;
+
+  size_t element_size = components * component_size;
+
+  uint8_t *elements = malloc(acc->elementCount * element_size);
+  NULL_CHECK(elements, FPX3D_MEMORY_ERROR);
+
+  Fpx3d_E_Result retval = __fpx3d_model_gltf_read_accessor(
+      layout->asset, acc, elements, element_size);
+
+  for (size_t i = 0; FPX3D_SUCCESS == retval && i < acc->elementCount; ++i) {
+    for (size_t c = 0; c < components; ++c) {
+      float value = _component_value(
+          &elements[i * element_size + c * component_size],
+          acc->componentType);
+
+      output->min[c] = (0 == i) ? value : MIN(output->min[c], value);
+      output->max[c] = (0 == i) ? value : MAX(output->max[c], value);
+    }
+  }
+
+  if (FPX3D_SUCCESS == retval)
+    output->present = true;
+
+  free(elements);
+
+  return retval;
+}
+
+static const char *_attribute_name(
+    const struct fpx3d_model_gltf_primitive_attribute *attribute, char *buffer,
+    size_t buffer_size) {
+  switch (attribute->attribute) {
+  case FPX3D_GLTF_MESH_ATTRIBUTE_POSITION:
+    return "POSITION";
+  case FPX3D_GLTF_MESH_ATTRIBUTE_NORMAL:
+    return "NORMAL";
+  case FPX3D_GLTF_MESH_ATTRIBUTE_TANGENT:
+    return "TANGENT";
+  case FPX3D_GLTF_MESH_ATTRIBUTE_TEXCOORD:
+    snprintf(buffer, buffer_size, "TEXCOORD_%u", attribute->n);
+    return buffer;
+  case FPX3D_GLTF_MESH_ATTRIBUTE_COLOR:
+    snprintf(buffer, buffer_size, "COLOR_%u", attribute->n);
+    return buffer;
+  case FPX3D_GLTF_MESH_ATTRIBUTE_JOINTS:
+    snprintf(buffer, buffer_size, "JOINTS_%u", attribute->n);
+    return buffer;
+  case FPX3D_GLTF_MESH_ATTRIBUTE_WEIGHTS:
+    snprintf(buffer, buffer_size, "WEIGHTS_%u", attribute->n);
+    return buffer;
+  default:
+    return NULL;
+  }
+}
+
+static void _write_accessor_ref(const struct _glb_layout *layout,
+                                struct _json_builder *json, const char *key,
+                                const Fpx3d_Model_GltfAccessor *acc) {
+  if (NULL == acc)
+    return;
+
+  _json_key_uint(json, key,
+                 layout->accessorRemap[acc - layout->desc->accessors]);
+}
+
+static void _write_attributes(const struct _glb_layout *layout,
+                              struct _json_builder *json,
+                              const struct fpx3d_model_gltf_primitive_attribute
+                                  *attributes,
+                              size_t count) {
+  char name_buffer[32];
+
+  _json_begin(json, '{');
+  for (size_t i = 0; i < count; ++i) {
+    const char *name =
+        _attribute_name(&attributes[i], name_buffer, sizeof(name_buffer));
+
+    if (NULL != name)
+      _write_accessor_ref(layout, json, name, attributes[i].accessor);
+  }
+  _json_end(json, '}');
+}
+
+static void
+_write_texture_info(const struct _glb_layout *layout,
+                    struct _json_builder *json, const char *key,
+                    const struct fpx3d_model_gltf_texture_info *info,
+                    const char *factor_key, float factor) {
+  if (NULL == info->texture)
+    return;
+
+  _json_key(json, key);
+  _json_begin(json, '{');
+
+  _json_key_uint(json, "index", info->texture - layout->desc->textures);
+
+  if (0 != info->texCoordIndex)
+    _json_key_uint(json, "texCoord", info->texCoordIndex);
+
+  if (NULL != factor_key && 1.0f != factor)
+    _json_key_float(json, factor_key, factor);
+
+  _json_end(json, '}');
+}
+
+static bool _is_zero(const float *values, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    if (0.0f != values[i])
+      return false;
+  }
+
+  return true;
+}
+
+static void _write_json(const struct _glb_layout *layout,
+                        struct _json_builder *json) {
+  const Fpx3d_Model_GltfAssetDescription *desc = layout->desc;
+
+  _json_begin(json, '{');
+
+  _json_key(json, "asset");
+  _json_begin(json, '{');
+  _json_key_string(json, "version", "2.0");
+  _json_key_string(json, "generator", "fpxlib3d");
+  _json_end(json, '}');
+
+  if (layout->needsQuantization) {
+    _json_key(json, "extensionsUsed");
+    _json_begin(json, '[');
+    _json_string(json, "KHR_mesh_quantization");
+    _json_end(json, ']');
+
+    _json_key(json, "extensionsRequired");
+    _json_begin(json, '[');
+    _json_string(json, "KHR_mesh_quantization");
+    _json_end(json, ']');
+  }
+
+  if (NULL != desc->scene)
+    _json_key_uint(json, "scene", desc->scene - desc->scenes);
+
+  if (0 < desc->sceneCount) {
+    _json_key(json, "scenes");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->sceneCount; ++i) {
+      const Fpx3d_Model_GltfScene *scene = &desc->scenes[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", scene->name);
+
+      if (0 < scene->nodeCount) {
+        _json_key(json, "nodes");
+        _json_begin(json, '[');
+        for (size_t n = 0; n < scene->nodeCount; ++n)
+          _json_uint(json, scene->nodes[n] - desc->nodes);
+        _json_end(json, ']');
+      }
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < desc->nodeCount) {
+    static const float identity[16] = {
+        1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+        0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f,
+    };
+
+    _json_key(json, "nodes");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->nodeCount; ++i) {
+      const Fpx3d_Model_GltfNode *node = &desc->nodes[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", node->name);
+
+      if (NULL != node->camera)
+        _json_key_uint(json, "camera", node->camera - desc->cameras);
+
+      if (NULL != node->skin)
+        _json_key_uint(json, "skin", node->skin - desc->skins);
+
+      if (NULL != node->mesh)
+        _json_key_uint(json, "mesh", node->mesh - desc->meshes);
+
+      if (0 < node->childCount) {
+        _json_key(json, "children");
+        _json_begin(json, '[');
+        for (size_t c = 0; c < node->childCount; ++c)
+          _json_uint(json, node->children[c] - desc->nodes);
+        _json_end(json, ']');
+      }
+
+      // absent transforms are parsed as all zeroes
+      if (!_is_zero(node->matrix[0], 16) &&
+          0 != memcmp(node->matrix, identity, sizeof(identity))) {
+        _json_key(json, "matrix");
+        _json_float_array(json, node->matrix[0], 16);
+      }
+
+      if (!_is_zero(node->translation, 3)) {
+        _json_key(json, "translation");
+        _json_float_array(json, node->translation, 3);
+      }
+
+      if (!_is_zero(node->rotationQuat, 4) &&
+          !(0.0f == node->rotationQuat[0] && 0.0f == node->rotationQuat[1] &&
+            0.0f == node->rotationQuat[2] && 1.0f == node->rotationQuat[3])) {
+        _json_key(json, "rotation");
+        _json_float_array(json, node->rotationQuat, 4);
+      }
+
+      if (!_is_zero(node->scale, 3) &&
+          !(1.0f == node->scale[0] && 1.0f == node->scale[1] &&
+            1.0f == node->scale[2])) {
+        _json_key(json, "scale");
+        _json_float_array(json, node->scale, 3);
+      }
+
+      if (0 < node->weightCount) {
+        _json_key(json, "weights");
+        _json_float_array(json, node->meshMorphTargetWeights,
+                          node->weightCount);
+      }
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < desc->cameraCount) {
+    _json_key(json, "cameras");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->cameraCount; ++i) {
+      const Fpx3d_Model_GltfCamera *camera = &desc->cameras[i];
+      bool perspective =
+          FPX3D_MODEL_GLTF_PROJECTION_TYPE_PERSPECTIVE == camera->type;
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", camera->name);
+      _json_key_string(json, "type",
+                       perspective ? "perspective" : "orthographic");
+
+      _json_key(json, perspective ? "perspective" : "orthographic");
+      _json_begin(json, '{');
+      if (perspective) {
+        _json_key_float(json, "yfov", camera->perspective.fov);
+
+        if (0.0f != camera->perspective.aspectRatio)
+          _json_key_float(json, "aspectRatio",
+                          camera->perspective.aspectRatio);
+      } else {
+        _json_key_float(json, "xmag", camera->orthographic.xmag);
+        _json_key_float(json, "ymag", camera->orthographic.ymag);
+      }
+
+      _json_key_float(json, "znear", camera->nearPlane);
+
+      // a perspective camera without zfar uses an infinite projection
+      if (!perspective || 0.0f != camera->farPlane)
+        _json_key_float(json, "zfar", camera->farPlane);
+
+      _json_end(json, '}');
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < desc->meshCount) {
+    _json_key(json, "meshes");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->meshCount; ++i) {
+      const Fpx3d_Model_GltfMesh *mesh = &desc->meshes[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", mesh->name);
+
+      _json_key(json, "primitives");
+      _json_begin(json, '[');
+      for (size_t p = 0; p < mesh->primitiveCount; ++p) {
+        const struct fpx3d_model_gltf_mesh_primitive *prim =
+            &mesh->primitives[p];
+
+        _json_begin(json, '{');
+
+        _json_key(json, "attributes");
+        _write_attributes(layout, json, prim->attributes,
+                          prim->attributeCount);
+
+        _write_accessor_ref(layout, json, "indices", prim->indices);
+
+        if (NULL != prim->material)
+          _json_key_uint(json, "material", prim->material - desc->materials);
+
+        if (FPX3D_GLTF_RENDER_MODE_TRIANGLES != prim->renderMode)
+          _json_key_uint(json, "mode", prim->renderMode);
+
+        if (0 < prim->morphTargetCount) {
+          _json_key(json, "targets");
+          _json_begin(json, '[');
+          for (size_t t = 0; t < prim->morphTargetCount; ++t)
+            _write_attributes(layout, json, prim->morphTargets[t].attributes,
+                              prim->morphTargets[t].attributeCount);
+          _json_end(json, ']');
+        }
+
+        _json_end(json, '}');
+      }
+      _json_end(json, ']');
+
+      if (0 < mesh->weightCount) {
+        _json_key(json, "weights");
+        _json_float_array(json, mesh->morphTargetWeights, mesh->weightCount);
+      }
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < layout->accessorCount) {
+    static const char *type_names[] = {
+        "", "SCALAR", "VEC2", "VEC3", "VEC4", "MAT2", "MAT3", "MAT4",
+    };
+
+    _json_key(json, "accessors");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < layout->accessorCount; ++i) {
+      const Fpx3d_Model_GltfAccessor *acc =
+          &desc->accessors[layout->accessorSources[i]];
+      const struct _accessor_bounds *bounds = &layout->accessorBounds[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", acc->name);
+
+      if (NULL != acc->view)
+        _json_key_uint(json, "bufferView", _remap_view(layout, acc->view));
+
+      if (0 != acc->byteOffset)
+        _json_key_uint(json, "byteOffset", acc->byteOffset);
+
+      _json_key_uint(json, "componentType", acc->componentType);
+
+      if (acc->componentsNormalized) {
+        _json_key(json, "normalized");
+        _json_append(json, "true", 4);
+        json->needComma = true;
+      }
+
+      _json_key_uint(json, "count", acc->elementCount);
+
+      if ((size_t)acc->elementType < ARRAY_SIZE(type_names))
+        _json_key_string(json, "type", type_names[acc->elementType]);
+
+      if (bounds->present) {
+        _json_key(json, "min");
+        _json_float_array(json, bounds->min, _component_count(acc));
+        _json_key(json, "max");
+        _json_float_array(json, bounds->max, _component_count(acc));
+      }
+
+      if (0 < acc->sparse.count) {
+        _json_key(json, "sparse");
+        _json_begin(json, '{');
+        _json_key_uint(json, "count", acc->sparse.count);
+
+        _json_key(json, "indices");
+        _json_begin(json, '{');
+        _json_key_uint(json, "bufferView",
+                       _remap_view(layout, acc->sparse.indices.view));
+        if (0 != acc->sparse.indices.byteOffset)
+          _json_key_uint(json, "byteOffset", acc->sparse.indices.byteOffset);
+        _json_key_uint(json, "componentType",
+                       acc->sparse.indices.componentType);
+        _json_end(json, '}');
+
+        _json_key(json, "values");
+        _json_begin(json, '{');
+        _json_key_uint(json, "bufferView",
+                       _remap_view(layout, acc->sparse.values.view));
+        if (0 != acc->sparse.values.byteOffset)
+          _json_key_uint(json, "byteOffset", acc->sparse.values.byteOffset);
+        _json_end(json, '}');
+
+        _json_end(json, '}');
+      }
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < layout->viewCount) {
+    _json_key(json, "bufferViews");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < layout->viewCount; ++i) {
+      const Fpx3d_Model_GltfBufferView *view =
+          &desc->bufferViews[layout->viewSources[i]];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", view->name);
+      _json_key_uint(json, "buffer", 0);
+
+      if (0 != layout->viewOffsets[i])
+        _json_key_uint(json, "byteOffset", layout->viewOffsets[i]);
+
+      _json_key_uint(json, "byteLength", view->byteLength);
+
+      if (0 != view->byteStride)
+        _json_key_uint(json, "byteStride", view->byteStride);
+
+      if (FPX3D_GLTF_BUFFER_VIEW_TARGET_INVALID != view->target)
+        _json_key_uint(json, "target", view->target);
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+
+    _json_key(json, "buffers");
+    _json_begin(json, '[');
+    _json_begin(json, '{');
+    _json_key_uint(json, "byteLength", layout->binLength);
+    _json_end(json, '}');
+    _json_end(json, ']');
+  }
+
+  if (0 < desc->imageCount) {
+    _json_key(json, "images");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->imageCount; ++i) {
+      const Fpx3d_Model_GltfImage *image = &desc->images[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", image->name);
+
+      if (NULL != image->bufferView) {
+        _json_key_uint(json, "bufferView",
+                       _remap_view(layout, image->bufferView));
+        _json_key_string(json, "mimeType", image->mimeType);
+      } else {
+        _json_key_string(json, "uri", image->uri);
+      }
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < desc->samplerCount) {
+    _json_key(json, "samplers");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->samplerCount; ++i) {
+      const Fpx3d_Model_GltfSampler *sampler = &desc->samplers[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", sampler->name);
+
+      if (FPX3D_GLTF_SAMPLER_FILTER_INVALID != sampler->magFilter)
+        _json_key_uint(json, "magFilter", sampler->magFilter);
+
+      if (FPX3D_GLTF_SAMPLER_FILTER_INVALID != sampler->minFilter)
+        _json_key_uint(json, "minFilter", sampler->minFilter);
+
+      if (FPX3D_GLTF_SAMPLER_WRAP_INVALID != sampler->wrapU &&
+          FPX3D_GLTF_SAMPLER_WRAP_REPEAT != sampler->wrapU)
+        _json_key_uint(json, "wrapS", sampler->wrapU);
+
+      if (FPX3D_GLTF_SAMPLER_WRAP_INVALID != sampler->wrapV &&
+          FPX3D_GLTF_SAMPLER_WRAP_REPEAT != sampler->wrapV)
+        _json_key_uint(json, "wrapT", sampler->wrapV);
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < desc->textureCount) {
+    _json_key(json, "textures");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->textureCount; ++i) {
+      const Fpx3d_Model_GltfTexture *texture = &desc->textures[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", texture->name);
+
+      if (NULL != texture->sampler)
+        _json_key_uint(json, "sampler", texture->sampler - desc->samplers);
+
+      if (NULL != texture->sourceImage)
+        _json_key_uint(json, "source", texture->sourceImage - desc->images);
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < desc->materialCount) {
+    static const float one[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+
+    _json_key(json, "materials");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->materialCount; ++i) {
+      const Fpx3d_Model_GltfMaterial *mat = &desc->materials[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", mat->name);
+
+      _json_key(json, "pbrMetallicRoughness");
+      _json_begin(json, '{');
+
+      if (0 != memcmp(mat->pbrMetallicRoughness.baseColorFactor, one,
+                      sizeof(one))) {
+        _json_key(json, "baseColorFactor");
+        _json_float_array(json, mat->pbrMetallicRoughness.baseColorFactor, 4);
+      }
+
+      _write_texture_info(layout, json, "baseColorTexture",
+                          &mat->pbrMetallicRoughness.baseColorTexture, NULL,
+                          1.0f);
+
+      if (1.0f != mat->pbrMetallicRoughness.metallicFactor)
+        _json_key_float(json, "metallicFactor",
+                        mat->pbrMetallicRoughness.metallicFactor);
+
+      if (1.0f != mat->pbrMetallicRoughness.roughnessFactor)
+        _json_key_float(json, "roughnessFactor",
+                        mat->pbrMetallicRoughness.roughnessFactor);
+
+      _write_texture_info(layout, json, "metallicRoughnessTexture",
+                          &mat->pbrMetallicRoughness.metallicRoughnessTexture,
+                          NULL, 1.0f);
+
+      _json_end(json, '}');
+
+      _write_texture_info(layout, json, "normalTexture",
+                          &mat->normalTexture.textureInfo, "scale",
+                          mat->normalTexture.scale);
+
+      _write_texture_info(layout, json, "occlusionTexture",
+                          &mat->occlusionTexture.textureInfo, "strength",
+                          mat->occlusionTexture.strength);
+
+      _write_texture_info(layout, json, "emissiveTexture",
+                          &mat->emissiveTexture, NULL, 1.0f);
+
+      if (!_is_zero(mat->emissiveFactor, 3)) {
+        _json_key(json, "emissiveFactor");
+        _json_float_array(json, mat->emissiveFactor, 3);
+      }
+
+      if (FPX3D_GLTF_ALPHA_MODE_MASK == mat->alphaMode) {
+        _json_key_string(json, "alphaMode", "MASK");
+
+        if (0.5f != mat->alphaCutoff)
+          _json_key_float(json, "alphaCutoff", mat->alphaCutoff);
+      } else if (FPX3D_GLTF_ALPHA_MODE_BLEND == mat->alphaMode) {
+        _json_key_string(json, "alphaMode", "BLEND");
+      }
+
+      if (mat->doubleSided) {
+        _json_key(json, "doubleSided");
+        _json_append(json, "true", 4);
+        json->needComma = true;
+      }
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < desc->skinCount) {
+    _json_key(json, "skins");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->skinCount; ++i) {
+      const Fpx3d_Model_GltfSkin *skin = &desc->skins[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", skin->name);
+
+      _write_accessor_ref(layout, json, "inverseBindMatrices",
+                          skin->inverseBindMatrices);
+
+      if (NULL != skin->skeletonRoot)
+        _json_key_uint(json, "skeleton", skin->skeletonRoot - desc->nodes);
+
+      _json_key(json, "joints");
+      _json_begin(json, '[');
+      for (size_t j = 0; j < skin->jointCount; ++j)
+        _json_uint(json, skin->joints[j] - desc->nodes);
+      _json_end(json, ']');
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  if (0 < desc->animationCount) {
+    static const char *path_names[] = {
+        "", "translation", "rotation", "scale", "weights",
+    };
+    static const char *interpolation_names[] = {
+        "", "LINEAR", "STEP", "CUBICSPLINE",
+    };
+
+    _json_key(json, "animations");
+    _json_begin(json, '[');
+    for (size_t i = 0; i < desc->animationCount; ++i) {
+      const Fpx3d_Model_GltfAnimation *anim = &desc->animations[i];
+
+      _json_begin(json, '{');
+      _json_key_string(json, "name", anim->name);
+
+      _json_key(json, "channels");
+      _json_begin(json, '[');
+      for (size_t c = 0; c < anim->channelCount; ++c) {
+        const struct fpx3d_model_gltf_anim_channel *channel =
+            &anim->channels[c];
+
+        _json_begin(json, '{');
+        _json_key_uint(json, "sampler", channel->sampler - anim->samplers);
+
+        _json_key(json, "target");
+        _json_begin(json, '{');
+        if (NULL != channel->target.node)
+          _json_key_uint(json, "node", channel->target.node - desc->nodes);
+        if ((size_t)channel->target.path < ARRAY_SIZE(path_names))
+          _json_key_string(json, "path", path_names[channel->target.path]);
+        _json_end(json, '}');
+
+        _json_end(json, '}');
+      }
+      _json_end(json, ']');
+
+      _json_key(json, "samplers");
+      _json_begin(json, '[');
+      for (size_t s = 0; s < anim->samplerCount; ++s) {
+        const struct fpx3d_model_gltf_anim_sampler *sampler =
+            &anim->samplers[s];
+
+        _json_begin(json, '{');
+        _write_accessor_ref(layout, json, "input", sampler->keyframes);
+        _write_accessor_ref(layout, json, "output", sampler->outputValues);
+
+        if (FPX3D_GLTF_ANIM_INTERPOLATION_LINEAR < sampler->interpolation &&
+            (size_t)sampler->interpolation < ARRAY_SIZE(interpolation_names))
+          _json_key_string(json, "interpolation",
+                           interpolation_names[sampler->interpolation]);
+
+        _json_end(json, '}');
+      }
+      _json_end(json, ']');
+
+      _json_end(json, '}');
+    }
+    _json_end(json, ']');
+  }
+
+  _json_end(json, '}');
+}
+
+// END OF STATIC FUNCTIONS ----
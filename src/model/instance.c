@@ -0,0 +1,930 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#include "model/gltf.h"
+#include "model/instance.h"
+#include "model/typedefs.h"
+
+#define NO_PARENT SIZE_MAX
+
+// per node of the asset
+struct fpx3d_model_instance_node {
+  size_t parent;
+
+  // nodes with a matrix can't be animated, so their local transform is
+  // the same for every instance
+  bool hasMatrix;
+  mat4 matrix;
+
+  vec3 translation;
+  vec4 rotation;
+  vec3 scale;
+
+  // rest weights, `weightCounts[node]` of them
+  float *weights;
+};
+
+// one animation channel, ready to be sampled
+struct fpx3d_model_instance_track {
+  size_t node;
+  int path;
+  int interpolation;
+
+  float *times;
+  size_t keyframeCount;
+
+  // `components` floats per keyframe (three times that for cubic
+  // splines: in-tangent, value, out-tangent)
+  float *values;
+  size_t components;
+};
+
+extern Fpx3d_E_Result __fpx3d_realloc_array(void **arr, size_t obj_size,
+                                            size_t amount,
+                                            size_t *old_capacity);
+
+extern Fpx3d_E_Result
+__fpx3d_model_gltf_read_accessor(const Fpx3d_Model_GltfAsset *asset,
+                                 const Fpx3d_Model_GltfAccessor *acc,
+                                 void *output, size_t output_stride);
+extern size_t
+__fpx3d_model_gltf_accessor_element_size(const Fpx3d_Model_GltfAccessor *acc);
+
+// static declarations ----
+
+static bool _is_zero(const float *values, size_t count);
+
+static Fpx3d_E_Result _setup_nodes(Fpx3d_Model_GltfInstances *,
+                                   const Fpx3d_Model_GltfAssetDescription *);
+static Fpx3d_E_Result _setup_tracks(Fpx3d_Model_GltfInstances *,
+                                    const Fpx3d_Model_GltfAssetDescription *);
+
+static Fpx3d_E_Result _read_floats(const Fpx3d_Model_GltfAsset *,
+                                   const Fpx3d_Model_GltfAccessor *,
+                                   float **output, size_t *count_output);
+
+static Fpx3d_E_Result _resize(Fpx3d_Model_GltfInstances *, size_t capacity);
+static Fpx3d_E_Result _relayout(void **array, size_t element_size,
+                                size_t rows, size_t count,
+                                size_t old_capacity, size_t new_capacity);
+
+static void _sample(const struct fpx3d_model_instance_track *, float time,
+                    float *output, size_t components);
+
+static void _compose(const float *translation, const float *rotation,
+                     const float *scale, mat4 output);
+static void _multiply(mat4 a, mat4 b, mat4 output);
+
+static void _free_internals(Fpx3d_Model_GltfInstances *);
+
+// end of static declarations ----
+
+Fpx3d_E_Result
+fpx3d_model_create_gltf_instances(const Fpx3d_Model_GltfAsset *asset,
+                                  size_t capacity,
+                                  Fpx3d_Model_GltfInstances *output) {
+  NULL_CHECK(asset, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  const Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(asset);
+  NULL_CHECK(desc, FPX3D_ARGS_ERROR);
+
+  if (NULL != desc->lazy) {
+    for (size_t i = 0; i < desc->nodeCount; ++i)
+      if (!fpx3d_model_gltf_is_parsed(asset, FPX3D_GLTF_ENTITY_NODE, i))
+        return FPX3D_ARGS_ERROR;
+
+    for (size_t i = 0; i < desc->animationCount; ++i)
+      if (!fpx3d_model_gltf_is_parsed(asset, FPX3D_GLTF_ENTITY_ANIMATION, i))
+        return FPX3D_ARGS_ERROR;
+  }
+
+  memset(output, 0, sizeof(*output));
+  output->asset = asset;
+  output->nodeCount = desc->nodeCount;
+
+#define CREATE_FAIL(retval)                                                    \
+  {                                                                            \
+    _free_internals(output);                                                   \
+    memset(output, 0, sizeof(*output));                                       \
+    return retval;                                                             \
+  }
+
+  Fpx3d_E_Result res = _setup_nodes(output, desc);
+  if (FPX3D_SUCCESS != res)
+    CREATE_FAIL(res);
+
+  res = _setup_tracks(output, desc);
+  if (FPX3D_SUCCESS != res)
+    CREATE_FAIL(res);
+
+  res = _resize(output, MAX(capacity, (size_t)1));
+  if (FPX3D_SUCCESS != res)
+    CREATE_FAIL(res);
+
+#undef CREATE_FAIL
+
+  return FPX3D_SUCCESS;
+}
+
+void fpx3d_model_destroy_gltf_instances(Fpx3d_Model_GltfInstances *set) {
+  if (NULL == set)
+    return;
+
+  _free_internals(set);
+  memset(set, 0, sizeof(*set));
+}
+
+Fpx3d_E_Result fpx3d_model_gltf_instance_add(Fpx3d_Model_GltfInstances *set,
+                                             size_t *index_output) {
+  NULL_CHECK(set, FPX3D_ARGS_ERROR);
+  NULL_CHECK(set->nodes, FPX3D_ARGS_ERROR);
+
+  if (set->count == set->capacity) {
+    Fpx3d_E_Result res = _resize(set, set->capacity * 2);
+    if (FPX3D_SUCCESS != res)
+      return res;
+  }
+
+  size_t idx = set->count++;
+  size_t cap = set->capacity;
+
+  for (size_t n = 0; n < set->nodeCount; ++n) {
+    struct fpx3d_model_instance_node *node = &set->nodes[n];
+
+    memcpy(set->translations[n * cap + idx], node->translation,
+           sizeof(vec3));
+    memcpy(set->rotations[n * cap + idx], node->rotation, sizeof(vec4));
+    memcpy(set->scales[n * cap + idx], node->scale, sizeof(vec3));
+
+    for (size_t w = 0; w < set->weightCounts[n]; ++w)
+      set->weights[(set->weightOffsets[n] + w) * cap + idx] = node->weights[w];
+  }
+
+  set->animations[idx] = FPX3D_MODEL_NO_ANIMATION;
+  set->times[idx] = 0.0f;
+
+  if (NULL != index_output)
+    *index_output = idx;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_model_gltf_instance_remove(Fpx3d_Model_GltfInstances *set,
+                                                size_t index) {
+  NULL_CHECK(set, FPX3D_ARGS_ERROR);
+
+  if (index >= set->count)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  size_t last = --set->count;
+  if (index == last)
+    return FPX3D_SUCCESS;
+
+  size_t cap = set->capacity;
+
+  for (size_t n = 0; n < set->nodeCount; ++n) {
+    memcpy(set->translations[n * cap + index],
+           set->translations[n * cap + last], sizeof(vec3));
+    memcpy(set->rotations[n * cap + index], set->rotations[n * cap + last],
+           sizeof(vec4));
+    memcpy(set->scales[n * cap + index], set->scales[n * cap + last],
+           sizeof(vec3));
+    memcpy(set->worldMatrices[n * cap + index],
+           set->worldMatrices[n * cap + last], sizeof(mat4));
+  }
+
+  for (size_t w = 0; w < set->weightCount; ++w)
+    set->weights[w * cap + index] = set->weights[w * cap + last];
+
+  set->animations[index] = set->animations[last];
+  set->times[index] = set->times[last];
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_model_gltf_instance_play(Fpx3d_Model_GltfInstances *set,
+                                              size_t index, size_t animation,
+                                              float start_time) {
+  NULL_CHECK(set, FPX3D_ARGS_ERROR);
+
+  if (index >= set->count)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  const Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(set->asset);
+  NULL_CHECK(desc, FPX3D_ARGS_ERROR);
+
+  if (FPX3D_MODEL_NO_ANIMATION != animation &&
+      animation >= desc->animationCount)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  set->animations[index] = animation;
+  set->times[index] = start_time;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result
+fpx3d_model_gltf_instances_advance(Fpx3d_Model_GltfInstances *set,
+                                   float seconds) {
+  NULL_CHECK(set, FPX3D_ARGS_ERROR);
+
+  for (size_t i = 0; i < set->count; ++i) {
+    size_t anim = set->animations[i];
+    if (FPX3D_MODEL_NO_ANIMATION == anim)
+      continue;
+
+    float duration = set->durations[anim];
+    float t = set->times[i] + seconds;
+
+    if (0.0f < duration) {
+      t = fmodf(t, duration);
+      if (0.0f > t)
+        t += duration;
+    } else {
+      t = 0.0f;
+    }
+
+    set->times[i] = t;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result
+fpx3d_model_gltf_instances_animate(Fpx3d_Model_GltfInstances *set) {
+  NULL_CHECK(set, FPX3D_ARGS_ERROR);
+
+  const Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(set->asset);
+  NULL_CHECK(desc, FPX3D_ARGS_ERROR);
+
+  size_t cap = set->capacity;
+
+  for (size_t a = 0; a < desc->animationCount; ++a) {
+    for (size_t t = set->trackOffsets[a]; t < set->trackOffsets[a + 1]; ++t) {
+      const struct fpx3d_model_instance_track *track = &set->tracks[t];
+      size_t n = track->node;
+
+      for (size_t i = 0; i < set->count; ++i) {
+        if (a != set->animations[i])
+          continue;
+
+        float *out = NULL;
+        size_t components = track->components;
+
+        switch (track->path) {
+        case FPX3D_GLTF_ANIM_PATH_TRANSLATION:
+          out = set->translations[n * cap + i];
+          break;
+        case FPX3D_GLTF_ANIM_PATH_ROTATION:
+          out = set->rotations[n * cap + i];
+          break;
+        case FPX3D_GLTF_ANIM_PATH_SCALE:
+          out = set->scales[n * cap + i];
+          break;
+        default:
+          break;
+        }
+
+        if (NULL != out) {
+          _sample(track, set->times[i], out, components);
+          continue;
+        }
+
+        // weights are spread out over the weight rows, so sample into a
+        // scratch buffer first
+        float scratch[64];
+        components = MIN(components, set->weightCounts[n]);
+        components = MIN(components, ARRAY_SIZE(scratch));
+
+        _sample(track, set->times[i], scratch, components);
+
+        for (size_t w = 0; w < components; ++w)
+          set->weights[(set->weightOffsets[n] + w) * cap + i] = scratch[w];
+      }
+    }
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result
+fpx3d_model_gltf_instances_update(Fpx3d_Model_GltfInstances *set) {
+  NULL_CHECK(set, FPX3D_ARGS_ERROR);
+
+  size_t cap = set->capacity;
+
+  for (size_t o = 0; o < set->nodeCount; ++o) {
+    size_t n = set->nodeOrder[o];
+    struct fpx3d_model_instance_node *node = &set->nodes[n];
+
+    mat4 *world = &set->worldMatrices[n * cap];
+    mat4 *parent_world = NULL;
+    if (NO_PARENT != node->parent)
+      parent_world = &set->worldMatrices[node->parent * cap];
+
+    for (size_t i = 0; i < set->count; ++i) {
+      mat4 local;
+
+      if (node->hasMatrix) {
+        memcpy(local, node->matrix, sizeof(mat4));
+      } else {
+        _compose(set->translations[n * cap + i], set->rotations[n * cap + i],
+                 set->scales[n * cap + i], local);
+      }
+
+      if (NULL == parent_world)
+        memcpy(world[i], local, sizeof(mat4));
+      else
+        _multiply(parent_world[i], local, world[i]);
+    }
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+const mat4 *
+fpx3d_model_gltf_instance_world(const Fpx3d_Model_GltfInstances *set,
+                                size_t index, size_t node) {
+  NULL_CHECK(set, NULL);
+
+  if (index >= set->count || node >= set->nodeCount)
+    return NULL;
+
+  return (const mat4 *)&set->worldMatrices[node * set->capacity + index];
+}
+
+// STATIC FUNCTIONS ----
+
+static bool _is_zero(const float *values, size_t count) {
+  for (size_t i = 0; i < count; ++i)
+    if (0.0f != values[i])
+      return false;
+
+  return true;
+}
+
+static Fpx3d_E_Result
+_setup_nodes(Fpx3d_Model_GltfInstances *set,
+             const Fpx3d_Model_GltfAssetDescription *desc) {
+  size_t count = desc->nodeCount;
+
+  // calloc(0) may hand out NULL, which would read as "not created"
+  set->nodes = calloc(MAX(count, (size_t)1), sizeof(*set->nodes));
+  set->nodeOrder = calloc(MAX(count, (size_t)1), sizeof(size_t));
+  set->weightOffsets = calloc(MAX(count, (size_t)1), sizeof(size_t));
+  set->weightCounts = calloc(MAX(count, (size_t)1), sizeof(size_t));
+
+  if (NULL == set->nodes || NULL == set->nodeOrder ||
+      NULL == set->weightOffsets || NULL == set->weightCounts) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  for (size_t n = 0; n < count; ++n)
+    set->nodes[n].parent = NO_PARENT;
+
+  for (size_t n = 0; n < count; ++n) {
+    const Fpx3d_Model_GltfNode *src = &desc->nodes[n];
+    struct fpx3d_model_instance_node *node = &set->nodes[n];
+
+    for (size_t c = 0; c < src->childCount; ++c) {
+      size_t child = (size_t)(src->children[c] - desc->nodes);
+
+      if (child >= count || NO_PARENT != set->nodes[child].parent)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      set->nodes[child].parent = n;
+    }
+
+    // the parser leaves absent properties zeroed (same as the writer
+    // expects), so all zeroes means "default"
+    node->hasMatrix = !_is_zero(src->matrix[0], 16);
+    if (node->hasMatrix)
+      memcpy(node->matrix, src->matrix, sizeof(mat4));
+
+    memcpy(node->translation, src->translation, sizeof(vec3));
+
+    if (_is_zero(src->rotationQuat, 4)) {
+      node->rotation[3] = 1.0f;
+    } else {
+      memcpy(node->rotation, src->rotationQuat, sizeof(vec4));
+    }
+
+    if (_is_zero(src->scale, 3)) {
+      node->scale[0] = node->scale[1] = node->scale[2] = 1.0f;
+    } else {
+      memcpy(node->scale, src->scale, sizeof(vec3));
+    }
+
+    // node weights override the mesh's, which default to zero
+    const float *rest = NULL;
+    size_t weight_count = 0;
+
+    if (0 < src->weightCount) {
+      rest = src->meshMorphTargetWeights;
+      weight_count = src->weightCount;
+    } else if (NULL != src->mesh) {
+      if (0 < src->mesh->weightCount) {
+        rest = src->mesh->morphTargetWeights;
+        weight_count = src->mesh->weightCount;
+      } else if (0 < src->mesh->primitiveCount) {
+        weight_count = src->mesh->primitives[0].morphTargetCount;
+      }
+    }
+
+    set->weightOffsets[n] = set->weightCount;
+    set->weightCounts[n] = weight_count;
+    set->weightCount += weight_count;
+
+    if (0 < weight_count) {
+      node->weights = calloc(weight_count, sizeof(float));
+      if (NULL == node->weights) {
+        perror("calloc()");
+        return FPX3D_MEMORY_ERROR;
+      }
+
+      if (NULL != rest)
+        memcpy(node->weights, rest, weight_count * sizeof(float));
+    }
+  }
+
+  // breadth-first from the roots, so every parent comes before its
+  // children
+  size_t ordered = 0;
+  for (size_t n = 0; n < count; ++n)
+    if (NO_PARENT == set->nodes[n].parent)
+      set->nodeOrder[ordered++] = n;
+
+  for (size_t o = 0; o < ordered; ++o) {
+    const Fpx3d_Model_GltfNode *src = &desc->nodes[set->nodeOrder[o]];
+
+    for (size_t c = 0; c < src->childCount; ++c)
+      set->nodeOrder[ordered++] = (size_t)(src->children[c] - desc->nodes);
+  }
+
+  // anything left over is part of a cycle
+  if (ordered != count)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result
+_setup_tracks(Fpx3d_Model_GltfInstances *set,
+              const Fpx3d_Model_GltfAssetDescription *desc) {
+  size_t anim_count = desc->animationCount;
+  size_t track_count = 0;
+
+  for (size_t a = 0; a < anim_count; ++a)
+    track_count += desc->animations[a].channelCount;
+
+  set->trackOffsets = calloc(anim_count + 1, sizeof(size_t));
+  set->durations = calloc(MAX(anim_count, (size_t)1), sizeof(float));
+  set->tracks = calloc(MAX(track_count, (size_t)1), sizeof(*set->tracks));
+
+  if (NULL == set->trackOffsets || NULL == set->durations ||
+      NULL == set->tracks) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  size_t t = 0;
+
+  for (size_t a = 0; a < anim_count; ++a) {
+    const Fpx3d_Model_GltfAnimation *anim = &desc->animations[a];
+    set->trackOffsets[a] = t;
+
+    for (size_t c = 0; c < anim->channelCount; ++c) {
+      const struct fpx3d_model_gltf_anim_channel *chan = &anim->channels[c];
+
+      // channels without a target node are allowed (extensions may
+      // target other things); there is nothing to sample for those
+      if (NULL == chan->target.node || NULL == chan->sampler ||
+          NULL == chan->sampler->keyframes ||
+          NULL == chan->sampler->outputValues)
+        continue;
+
+      struct fpx3d_model_instance_track *track = &set->tracks[t];
+
+      track->node = (size_t)(chan->target.node - desc->nodes);
+      track->path = chan->target.path;
+      track->interpolation = chan->sampler->interpolation;
+
+      if (track->node >= desc->nodeCount)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      if (FPX3D_GLTF_ANIM_PATH_INVALID == track->path ||
+          FPX3D_GLTF_ANIM_INTERPOLATION_INVALID == track->interpolation)
+        continue;
+
+      // counted from here on, so _free_internals() frees what was read
+      ++t;
+
+      if (FPX3D_GLTF_ACCESSOR_ELEMENT_TYPE_SCALAR !=
+          chan->sampler->keyframes->elementType)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      size_t time_count = 0, value_count = 0;
+
+      Fpx3d_E_Result res = _read_floats(set->asset, chan->sampler->keyframes,
+                                        &track->times, &time_count);
+      if (FPX3D_SUCCESS != res)
+        return res;
+
+      res = _read_floats(set->asset, chan->sampler->outputValues,
+                         &track->values, &value_count);
+      if (FPX3D_SUCCESS != res)
+        return res;
+
+      size_t per_key = time_count;
+      if (FPX3D_GLTF_ANIM_INTERPOLATION_CUBICSPLINE == track->interpolation)
+        per_key *= 3;
+
+      if (0 != value_count % per_key)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      track->keyframeCount = time_count;
+      track->components = value_count / per_key;
+
+      size_t expected = 0;
+      switch (track->path) {
+      case FPX3D_GLTF_ANIM_PATH_TRANSLATION:
+      case FPX3D_GLTF_ANIM_PATH_SCALE:
+        expected = 3;
+        break;
+      case FPX3D_GLTF_ANIM_PATH_ROTATION:
+        expected = 4;
+        break;
+      default:
+        expected = track->components;
+        break;
+      }
+
+      if (expected != track->components)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      set->durations[a] = MAX(set->durations[a], track->times[time_count - 1]);
+    }
+  }
+
+  set->trackOffsets[anim_count] = t;
+
+  return FPX3D_SUCCESS;
+}
+
+// every component of the accessor, converted to float (normalized
+// integers are mapped to [0, 1] or [-1, 1])
+static Fpx3d_E_Result _read_floats(const Fpx3d_Model_GltfAsset *asset,
+                                   const Fpx3d_Model_GltfAccessor *acc,
+                                   float **output, size_t *count_output) {
+  size_t element_size = __fpx3d_model_gltf_accessor_element_size(acc);
+  if (0 == element_size || 0 == acc->elementCount)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  if (FPX3D_GLTF_COMPONENT_TYPE_FLOAT != acc->componentType &&
+      !acc->componentsNormalized)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  uint8_t *raw = calloc(acc->elementCount, element_size);
+  if (NULL == raw) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  Fpx3d_E_Result res =
+      __fpx3d_model_gltf_read_accessor(asset, acc, raw, element_size);
+  if (FPX3D_SUCCESS != res) {
+    FREE_SAFE(raw);
+    return res;
+  }
+
+  size_t component_size = 0;
+  switch (acc->componentType) {
+  case FPX3D_GLTF_COMPONENT_TYPE_BYTE:
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+    component_size = 1;
+    break;
+  case FPX3D_GLTF_COMPONENT_TYPE_SHORT:
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+    component_size = 2;
+    break;
+  case FPX3D_GLTF_COMPONENT_TYPE_FLOAT:
+    component_size = 4;
+    break;
+  default:
+    FREE_SAFE(raw);
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+  }
+
+  size_t count = acc->elementCount * (element_size / component_size);
+
+  float *values = calloc(count, sizeof(float));
+  if (NULL == values) {
+    perror("calloc()");
+    FREE_SAFE(raw);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  for (size_t i = 0; i < count; ++i) {
+    const uint8_t *src = raw + i * component_size;
+
+    switch (acc->componentType) {
+    case FPX3D_GLTF_COMPONENT_TYPE_BYTE:
+      values[i] = MAX((float)*(const int8_t *)src / 127.0f, -1.0f);
+      break;
+    case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+      values[i] = (float)*src / 255.0f;
+      break;
+    case FPX3D_GLTF_COMPONENT_TYPE_SHORT: {
+      int16_t v;
+      memcpy(&v, src, sizeof(v));
+      values[i] = MAX((float)v / 32767.0f, -1.0f);
+      break;
+    }
+    case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+      uint16_t v;
+      memcpy(&v, src, sizeof(v));
+      values[i] = (float)v / 65535.0f;
+      break;
+    }
+    default:
+      memcpy(&values[i], src, sizeof(float));
+      break;
+    }
+  }
+
+  FREE_SAFE(raw);
+
+  *output = values;
+  *count_output = count;
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _resize(Fpx3d_Model_GltfInstances *set,
+                              size_t capacity) {
+  size_t old = set->capacity;
+  size_t rows = MAX(set->nodeCount, (size_t)1);
+  size_t count = set->count;
+
+  // the node-major arrays keep their rows `capacity` apart, so growing
+  // means moving every row to its new place
+  Fpx3d_E_Result res = FPX3D_SUCCESS;
+
+  if (FPX3D_SUCCESS > (res = _relayout((void **)&set->translations,
+                                       sizeof(vec3), rows, count, old,
+                                       capacity)) ||
+      FPX3D_SUCCESS > (res = _relayout((void **)&set->rotations,
+                                       sizeof(vec4), rows, count, old,
+                                       capacity)) ||
+      FPX3D_SUCCESS > (res = _relayout((void **)&set->scales, sizeof(vec3),
+                                       rows, count, old, capacity)) ||
+      FPX3D_SUCCESS > (res = _relayout((void **)&set->worldMatrices,
+                                       sizeof(mat4), rows, count, old,
+                                       capacity)) ||
+      FPX3D_SUCCESS > (res = _relayout((void **)&set->weights, sizeof(float),
+                                       MAX(set->weightCount, (size_t)1),
+                                       count, old, capacity)))
+    return res;
+
+  size_t temp_cap = old;
+  res = __fpx3d_realloc_array((void **)&set->animations, sizeof(size_t),
+                              capacity, &temp_cap);
+  if (FPX3D_SUCCESS > res)
+    return res;
+
+  temp_cap = old;
+  res = __fpx3d_realloc_array((void **)&set->times, sizeof(float), capacity,
+                              &temp_cap);
+  if (FPX3D_SUCCESS > res)
+    return res;
+
+  set->capacity = capacity;
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _relayout(void **array, size_t element_size,
+                                size_t rows, size_t count,
+                                size_t old_capacity, size_t new_capacity) {
+  uint8_t *fresh = calloc(rows * new_capacity, element_size);
+  if (NULL == fresh) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  const uint8_t *current = *array;
+
+  if (NULL != current) {
+    for (size_t r = 0; r < rows; ++r)
+      memcpy(fresh + r * new_capacity * element_size,
+             current + r * old_capacity * element_size, count * element_size);
+  }
+
+  FREE_SAFE(*array);
+  *array = fresh;
+
+  return FPX3D_SUCCESS;
+}
+
+static void _sample(const struct fpx3d_model_instance_track *track,
+                    float time, float *output, size_t components) {
+  const float *times = track->times;
+  size_t keys = track->keyframeCount;
+  size_t stride = track->components;
+  bool cubic =
+      (FPX3D_GLTF_ANIM_INTERPOLATION_CUBICSPLINE == track->interpolation);
+
+  // the value itself sits between both tangents for cubic splines
+  const float *values = track->values;
+  size_t key_stride = stride;
+  if (cubic) {
+    values += stride;
+    key_stride *= 3;
+  }
+
+  if (1 == keys || time <= times[0]) {
+    memcpy(output, values, components * sizeof(float));
+    return;
+  }
+
+  if (time >= times[keys - 1]) {
+    memcpy(output, values + (keys - 1) * key_stride,
+           components * sizeof(float));
+    return;
+  }
+
+  // last keyframe at or before `time`
+  size_t lo = 0, hi = keys - 1;
+  while (hi - lo > 1) {
+    size_t mid = lo + (hi - lo) / 2;
+    if (times[mid] <= time)
+      lo = mid;
+    else
+      hi = mid;
+  }
+
+  const float *a = values + lo * key_stride;
+  const float *b = values + hi * key_stride;
+
+  float delta = times[hi] - times[lo];
+  float t = (0.0f < delta) ? (time - times[lo]) / delta : 0.0f;
+
+  bool rotation = (FPX3D_GLTF_ANIM_PATH_ROTATION == track->path);
+
+  switch (track->interpolation) {
+  case FPX3D_GLTF_ANIM_INTERPOLATION_STEP:
+    memcpy(output, a, components * sizeof(float));
+    return;
+
+  case FPX3D_GLTF_ANIM_INTERPOLATION_CUBICSPLINE: {
+    // Hermite spline with the out-tangent of `a` and in-tangent of `b`,
+    // both scaled by the keyframe distance
+    const float *a_out = a + stride;
+    const float *b_in = b - stride;
+
+    float t2 = t * t, t3 = t2 * t;
+    float h00 = 2.0f * t3 - 3.0f * t2 + 1.0f;
+    float h10 = (t3 - 2.0f * t2 + t) * delta;
+    float h01 = -2.0f * t3 + 3.0f * t2;
+    float h11 = (t3 - t2) * delta;
+
+    for (size_t i = 0; i < components; ++i)
+      output[i] = h00 * a[i] + h10 * a_out[i] + h01 * b[i] + h11 * b_in[i];
+
+    break;
+  }
+
+  default:
+    if (rotation && 4 == components) {
+      // spherical interpolation along the shortest arc
+      float dot = a[0] * b[0] + a[1] * b[1] + a[2] * b[2] + a[3] * b[3];
+      float sign = (0.0f > dot) ? -1.0f : 1.0f;
+      dot *= sign;
+
+      float wa = 1.0f - t, wb = t;
+
+      // nearly parallel; plain lerp is both accurate and stable there
+      if (0.9995f > dot) {
+        float theta = acosf(dot);
+        float inv_sin = 1.0f / sinf(theta);
+        wa = sinf((1.0f - t) * theta) * inv_sin;
+        wb = sinf(t * theta) * inv_sin;
+      }
+
+      for (size_t i = 0; i < 4; ++i)
+        output[i] = wa * a[i] + wb * sign * b[i];
+    } else {
+      for (size_t i = 0; i < components; ++i)
+        output[i] = a[i] + (b[i] - a[i]) * t;
+    }
+    break;
+  }
+
+  if (rotation && 4 == components) {
+    float len = sqrtf(output[0] * output[0] + output[1] * output[1] +
+                      output[2] * output[2] + output[3] * output[3]);
+
+    if (0.0f < len)
+      for (size_t i = 0; i < 4; ++i)
+        output[i] /= len;
+  }
+}
+
+// T * R * S, column-major like glTF (and cglm)
+static void _compose(const float *translation, const float *rotation,
+                     const float *scale, mat4 output) {
+  float x = rotation[0], y = rotation[1], z = rotation[2], w = rotation[3];
+
+  float xx = x * x, yy = y * y, zz = z * z;
+  float xy = x * y, xz = x * z, yz = y * z;
+  float wx = w * x, wy = w * y, wz = w * z;
+
+  output[0][0] = (1.0f - 2.0f * (yy + zz)) * scale[0];
+  output[0][1] = 2.0f * (xy + wz) * scale[0];
+  output[0][2] = 2.0f * (xz - wy) * scale[0];
+  output[0][3] = 0.0f;
+
+  output[1][0] = 2.0f * (xy - wz) * scale[1];
+  output[1][1] = (1.0f - 2.0f * (xx + zz)) * scale[1];
+  output[1][2] = 2.0f * (yz + wx) * scale[1];
+  output[1][3] = 0.0f;
+
+  output[2][0] = 2.0f * (xz + wy) * scale[2];
+  output[2][1] = 2.0f * (yz - wx) * scale[2];
+  output[2][2] = (1.0f - 2.0f * (xx + yy)) * scale[2];
+  output[2][3] = 0.0f;
+
+  output[3][0] = translation[0];
+  output[3][1] = translation[1];
+  output[3][2] = translation[2];
+  output[3][3] = 1.0f;
+}
+
+// `output` may not alias `a` or `b`
+static void _multiply(mat4 a, mat4 b, mat4 output) {
+  for (int c = 0; c < 4; ++c)
+    for (int r = 0; r < 4; ++r)
+      output[c][r] = a[0][r] * b[c][0] + a[1][r] * b[c][1] +
+                     a[2][r] * b[c][2] + a[3][r] * b[c][3];
+}
+
+static void _free_internals(Fpx3d_Model_GltfInstances *set) {
+  if (NULL != set->nodes)
+    for (size_t n = 0; n < set->nodeCount; ++n)
+      FREE_SAFE(set->nodes[n].weights);
+
+  if (NULL != set->tracks && NULL != set->trackOffsets) {
+    const Fpx3d_Model_GltfAssetDescription *desc =
+        fpx3d_model_gltf_description(set->asset);
+    size_t anim_count = (NULL != desc) ? desc->animationCount : 0;
+
+    // trackOffsets[] is only complete once every track is set up, so go
+    // over every slot that could have been used
+    size_t track_count = 0;
+    for (size_t a = 0; a < anim_count; ++a)
+      track_count += desc->animations[a].channelCount;
+
+    for (size_t t = 0; t < track_count; ++t) {
+      FREE_SAFE(set->tracks[t].times);
+      FREE_SAFE(set->tracks[t].values);
+    }
+  }
+
+  FREE_SAFE(set->nodes);
+  FREE_SAFE(set->nodeOrder);
+  FREE_SAFE(set->weightOffsets);
+  FREE_SAFE(set->weightCounts);
+
+  FREE_SAFE(set->tracks);
+  FREE_SAFE(set->trackOffsets);
+  FREE_SAFE(set->durations);
+
+  FREE_SAFE(set->translations);
+  FREE_SAFE(set->rotations);
+  FREE_SAFE(set->scales);
+  FREE_SAFE(set->worldMatrices);
+  FREE_SAFE(set->weights);
+
+  FREE_SAFE(set->animations);
+  FREE_SAFE(set->times);
+}
+
+// END OF STATIC FUNCTIONS ----
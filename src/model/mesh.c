@@ -0,0 +1,1050 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+#include "model/gltf.h"
+#include "model/typedefs.h"
+
+#include "model/mesh.h"
+
+// every element is padded to 4 bytes, which is what both glTF and most
+// vertex input implementations want
+#define ELEMENT_ALIGNMENT 4
+#define ALIGN_ELEMENT(size)                                                    \
+  (((size) + ELEMENT_ALIGNMENT - 1) & ~(size_t)(ELEMENT_ALIGNMENT - 1))
+
+extern Fpx3d_E_Result __fpx3d_realloc_array(void **arr, size_t obj_size,
+                                            size_t amount,
+                                            size_t *old_capacity);
+
+extern const uint8_t *
+__fpx3d_model_gltf_view_data(const Fpx3d_Model_GltfAsset *asset,
+                             const Fpx3d_Model_GltfBufferView *view);
+extern size_t
+__fpx3d_model_gltf_component_size(Fpx3d_Model_E_GltfComponentType type);
+extern Fpx3d_E_Result
+__fpx3d_model_gltf_read_accessor(const Fpx3d_Model_GltfAsset *asset,
+                                 const Fpx3d_Model_GltfAccessor *acc,
+                                 void *output, size_t output_stride);
+
+// static declarations ----
+
+static Fpx3d_E_Result
+_layout_streams(Fpx3d_Model_Mesh *mesh,
+                const struct fpx3d_model_mesh_stream_info *streams,
+                size_t stream_count);
+
+static void _stream_info(const struct fpx3d_model_mesh_stream *stream,
+                         struct fpx3d_model_mesh_stream_info *output);
+
+static Fpx3d_Model_E_ComponentFormat
+_format_from_gltf(Fpx3d_Model_E_GltfComponentType type);
+
+static Fpx3d_Model_E_GltfComponentType
+_format_to_gltf(Fpx3d_Model_E_ComponentFormat format);
+
+static const struct fpx3d_model_gltf_primitive_attribute *
+_find_gltf_attribute(const struct fpx3d_model_gltf_mesh_primitive *prim,
+                     Fpx3d_Model_E_AttributeSemantic semantic, uint8_t n);
+
+static bool
+_shares_vertices(const struct fpx3d_model_gltf_mesh_primitive *a,
+                 const struct fpx3d_model_gltf_mesh_primitive *b);
+
+static void _submesh_bounds(Fpx3d_Model_Mesh *mesh,
+                            struct fpx3d_model_submesh *submesh);
+
+// end of static declarations ----
+
+size_t fpx3d_model_component_size(Fpx3d_Model_E_ComponentFormat format) {
+  switch (format) {
+  case FPX3D_MODEL_FORMAT_SINT8:
+  case FPX3D_MODEL_FORMAT_UINT8:
+    return 1;
+
+  case FPX3D_MODEL_FORMAT_FLOAT16:
+  case FPX3D_MODEL_FORMAT_SINT16:
+  case FPX3D_MODEL_FORMAT_UINT16:
+    return 2;
+
+  case FPX3D_MODEL_FORMAT_FLOAT32:
+  case FPX3D_MODEL_FORMAT_UINT32:
+    return 4;
+
+  default:
+    return 0;
+  }
+}
+
+Fpx3d_E_Result
+fpx3d_model_create_mesh(Fpx3d_Model_Mesh *output, Fpx3d_Model_E_MeshLayout layout,
+                        size_t vertex_count,
+                        const struct fpx3d_model_mesh_stream_info *streams,
+                        size_t stream_count) {
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+  NULL_CHECK(streams, FPX3D_ARGS_ERROR);
+
+  if (1 > stream_count || 1 > vertex_count)
+    return FPX3D_ARGS_ERROR;
+
+  Fpx3d_Model_Mesh new_mesh = {0};
+  new_mesh.layout = layout;
+  new_mesh.vertexCount = vertex_count;
+
+  Fpx3d_E_Result layout_res = _layout_streams(&new_mesh, streams, stream_count);
+  if (FPX3D_SUCCESS != layout_res) {
+    fpx3d_model_destroy_mesh(&new_mesh);
+    return layout_res;
+  }
+
+  size_t temp = 0;
+  Fpx3d_E_Result alloc_res = __fpx3d_realloc_array(
+      &new_mesh.vertexData, 1, new_mesh.vertexDataSize, &temp);
+
+  if (FPX3D_SUCCESS != alloc_res) {
+    fpx3d_model_destroy_mesh(&new_mesh);
+    return alloc_res;
+  }
+
+  *output = new_mesh;
+
+  return FPX3D_SUCCESS;
+}
+
+void fpx3d_model_destroy_mesh(Fpx3d_Model_Mesh *mesh) {
+  NULL_CHECK(mesh, );
+
+  for (size_t i = 0; i < mesh->streamCount; ++i) {
+    FREE_SAFE(mesh->streams[i].name);
+  }
+
+  FREE_SAFE(mesh->streams);
+  FREE_SAFE(mesh->vertexData);
+  FREE_SAFE(mesh->indices);
+  FREE_SAFE(mesh->submeshes);
+
+  memset(mesh, 0, sizeof(*mesh));
+
+  return;
+}
+
+struct fpx3d_model_mesh_stream *
+fpx3d_model_mesh_get_stream(Fpx3d_Model_Mesh *mesh,
+                            Fpx3d_Model_E_AttributeSemantic semantic,
+                            uint8_t semantic_index) {
+  NULL_CHECK(mesh, NULL);
+
+  for (size_t i = 0; i < mesh->streamCount; ++i) {
+    if (mesh->streams[i].semantic == semantic &&
+        mesh->streams[i].semanticIndex == semantic_index)
+      return &mesh->streams[i];
+  }
+
+  return NULL;
+}
+
+void *fpx3d_model_mesh_stream_element(
+    Fpx3d_Model_Mesh *mesh, const struct fpx3d_model_mesh_stream *stream,
+    size_t vertex_index) {
+  NULL_CHECK(mesh, NULL);
+  NULL_CHECK(stream, NULL);
+  NULL_CHECK(mesh->vertexData, NULL);
+
+  if (vertex_index >= mesh->vertexCount)
+    return NULL;
+
+  return (uint8_t *)mesh->vertexData + stream->offset +
+         vertex_index * stream->stride;
+}
+
+Fpx3d_E_Result
+fpx3d_model_mesh_write_stream(Fpx3d_Model_Mesh *mesh,
+                              struct fpx3d_model_mesh_stream *stream,
+                              size_t first_vertex, const void *elements,
+                              size_t count) {
+  NULL_CHECK(mesh, FPX3D_ARGS_ERROR);
+  NULL_CHECK(stream, FPX3D_ARGS_ERROR);
+  NULL_CHECK(elements, FPX3D_ARGS_ERROR);
+
+  if (first_vertex + count > mesh->vertexCount)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  const uint8_t *src = elements;
+  uint8_t *dst = fpx3d_model_mesh_stream_element(mesh, stream, first_vertex);
+  NULL_CHECK(dst, FPX3D_NULLPTR_ERROR);
+
+  for (size_t i = 0; i < count; ++i) {
+    memcpy(dst + i * stream->stride, src + i * stream->elementSize,
+           stream->elementSize);
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_model_mesh_set_indices(Fpx3d_Model_Mesh *mesh,
+                                            const uint32_t *indices,
+                                            size_t count) {
+  NULL_CHECK(mesh, FPX3D_ARGS_ERROR);
+
+  if (1 > count) {
+    FREE_SAFE(mesh->indices);
+    mesh->indexCount = 0;
+    mesh->indexSize = 0;
+    return FPX3D_SUCCESS;
+  }
+
+  NULL_CHECK(indices, FPX3D_ARGS_ERROR);
+
+  uint32_t max_index = 0;
+  for (size_t i = 0; i < count; ++i) {
+    max_index = MAX(max_index, indices[i]);
+  }
+
+  if (max_index >= mesh->vertexCount)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  size_t index_size = (max_index <= UINT16_MAX) ? 2 : 4;
+
+  void *new_indices = calloc(count, index_size);
+  if (NULL == new_indices) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  if (2 == index_size) {
+    uint16_t *out = new_indices;
+    for (size_t i = 0; i < count; ++i)
+      out[i] = (uint16_t)indices[i];
+  } else {
+    memcpy(new_indices, indices, count * index_size);
+  }
+
+  FREE_SAFE(mesh->indices);
+  mesh->indices = new_indices;
+  mesh->indexCount = count;
+  mesh->indexSize = index_size;
+
+  return FPX3D_SUCCESS;
+}
+
+uint32_t fpx3d_model_mesh_get_index(const Fpx3d_Model_Mesh *mesh, size_t i) {
+  NULL_CHECK(mesh, 0);
+
+  // non-indexed meshes behave as if indices were 0, 1, 2...
+  if (NULL == mesh->indices)
+    return (uint32_t)i;
+
+  if (i >= mesh->indexCount)
+    return 0;
+
+  if (2 == mesh->indexSize)
+    return ((const uint16_t *)mesh->indices)[i];
+
+  return ((const uint32_t *)mesh->indices)[i];
+}
+
+Fpx3d_E_Result fpx3d_model_mesh_add_submesh(Fpx3d_Model_Mesh *mesh,
+                                            size_t first_index,
+                                            size_t index_count,
+                                            int32_t material) {
+  NULL_CHECK(mesh, FPX3D_ARGS_ERROR);
+
+  size_t limit = (NULL == mesh->indices) ? mesh->vertexCount : mesh->indexCount;
+
+  if (1 > index_count || first_index + index_count > limit)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  size_t capacity = mesh->submeshCount;
+  Fpx3d_E_Result alloc_res =
+      __fpx3d_realloc_array((void **)&mesh->submeshes, sizeof(*mesh->submeshes),
+                            mesh->submeshCount + 1, &capacity);
+
+  if (FPX3D_SUCCESS != alloc_res)
+    return alloc_res;
+
+  struct fpx3d_model_submesh *sub = &mesh->submeshes[mesh->submeshCount];
+
+  sub->firstIndex = first_index;
+  sub->indexCount = index_count;
+  sub->material = material;
+
+  uint32_t lowest = UINT32_MAX, highest = 0;
+  for (size_t i = first_index; i < first_index + index_count; ++i) {
+    uint32_t idx = fpx3d_model_mesh_get_index(mesh, i);
+    lowest = MIN(lowest, idx);
+    highest = MAX(highest, idx);
+  }
+
+  sub->firstVertex = lowest;
+  sub->vertexCount = (size_t)(highest - lowest) + 1;
+
+  _submesh_bounds(mesh, sub);
+
+  ++mesh->submeshCount;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_model_mesh_compute_bounds(Fpx3d_Model_Mesh *mesh) {
+  NULL_CHECK(mesh, FPX3D_ARGS_ERROR);
+
+  for (size_t i = 0; i < 3; ++i) {
+    mesh->bounds.min[i] = FLT_MAX;
+    mesh->bounds.max[i] = -FLT_MAX;
+  }
+
+  for (size_t s = 0; s < mesh->submeshCount; ++s) {
+    struct fpx3d_model_submesh *sub = &mesh->submeshes[s];
+
+    _submesh_bounds(mesh, sub);
+
+    for (size_t i = 0; i < 3; ++i) {
+      mesh->bounds.min[i] = MIN(mesh->bounds.min[i], sub->bounds.min[i]);
+      mesh->bounds.max[i] = MAX(mesh->bounds.max[i], sub->bounds.max[i]);
+    }
+  }
+
+  if (0 < mesh->submeshCount)
+    return FPX3D_SUCCESS;
+
+  // no submeshes, so just take every vertex into account
+  struct fpx3d_model_submesh everything = {.firstVertex = 0,
+                                           .vertexCount = mesh->vertexCount};
+  _submesh_bounds(mesh, &everything);
+
+  memcpy(&mesh->bounds, &everything.bounds, sizeof(mesh->bounds));
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_model_mesh_convert_layout(Fpx3d_Model_Mesh *mesh,
+                                               Fpx3d_Model_E_MeshLayout layout) {
+  NULL_CHECK(mesh, FPX3D_ARGS_ERROR);
+
+  if (mesh->layout == layout)
+    return FPX3D_SUCCESS;
+
+  struct fpx3d_model_mesh_stream_info *infos =
+      calloc(mesh->streamCount, sizeof(*infos));
+  if (NULL == infos) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  for (size_t i = 0; i < mesh->streamCount; ++i) {
+    _stream_info(&mesh->streams[i], &infos[i]);
+  }
+
+  Fpx3d_Model_Mesh converted = {0};
+  Fpx3d_E_Result create_res = fpx3d_model_create_mesh(
+      &converted, layout, mesh->vertexCount, infos, mesh->streamCount);
+
+  FREE_SAFE(infos);
+
+  if (FPX3D_SUCCESS != create_res)
+    return create_res;
+
+  for (size_t s = 0; s < mesh->streamCount; ++s) {
+    const struct fpx3d_model_mesh_stream *src = &mesh->streams[s];
+    const struct fpx3d_model_mesh_stream *dst = &converted.streams[s];
+
+    for (size_t v = 0; v < mesh->vertexCount; ++v) {
+      memcpy((uint8_t *)converted.vertexData + dst->offset + v * dst->stride,
+             (uint8_t *)mesh->vertexData + src->offset + v * src->stride,
+             src->elementSize);
+    }
+  }
+
+  // hand the vertex storage over, keep everything else
+  for (size_t i = 0; i < mesh->streamCount; ++i) {
+    FREE_SAFE(mesh->streams[i].name);
+  }
+  FREE_SAFE(mesh->streams);
+  FREE_SAFE(mesh->vertexData);
+
+  mesh->layout = converted.layout;
+  mesh->vertexData = converted.vertexData;
+  mesh->vertexDataSize = converted.vertexDataSize;
+  mesh->streams = converted.streams;
+  mesh->streamCount = converted.streamCount;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_model_mesh_from_gltf(const Fpx3d_Model_GltfAsset *asset,
+                                          const Fpx3d_Model_GltfMesh *gltf_mesh,
+                                          Fpx3d_Model_E_MeshLayout layout,
+                                          Fpx3d_Model_Mesh *output) {
+  NULL_CHECK(asset, FPX3D_ARGS_ERROR);
+  NULL_CHECK(gltf_mesh, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  if (1 > gltf_mesh->primitiveCount)
+    return FPX3D_ARGS_ERROR;
+
+  const Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(asset);
+  NULL_CHECK(desc, FPX3D_ARGS_ERROR);
+
+  const struct fpx3d_model_gltf_mesh_primitive *first =
+      &gltf_mesh->primitives[0];
+
+  if (1 > first->attributeCount)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  // the first primitive dictates the stream layout
+  struct fpx3d_model_mesh_stream_info *infos =
+      calloc(first->attributeCount, sizeof(*infos));
+  if (NULL == infos) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  size_t stream_count = 0;
+
+  for (size_t a = 0; a < first->attributeCount; ++a) {
+    const struct fpx3d_model_gltf_primitive_attribute *attr =
+        &first->attributes[a];
+
+    if (FPX3D_GLTF_MESH_ATTRIBUTE_INVALID == attr->attribute ||
+        NULL == attr->accessor)
+      continue;
+
+    if (attr->accessor->elementType > FPX3D_GLTF_ACCESSOR_ELEMENT_TYPE_VEC4) {
+      FREE_SAFE(infos);
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+    }
+
+    struct fpx3d_model_mesh_stream_info *info = &infos[stream_count++];
+
+    info->semantic = (Fpx3d_Model_E_AttributeSemantic)attr->attribute;
+    info->semanticIndex = attr->n;
+    info->format = _format_from_gltf(attr->accessor->componentType);
+    info->componentCount = (uint8_t)attr->accessor->elementType;
+    info->normalized = attr->accessor->componentsNormalized;
+  }
+
+  // primitives that use the exact same attribute accessors (the usual
+  // way exporters split a mesh by material) share one vertex range
+  size_t *vertex_bases = calloc(gltf_mesh->primitiveCount, sizeof(size_t));
+  if (NULL == vertex_bases) {
+    perror("calloc()");
+    FREE_SAFE(infos);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  size_t vertex_count = 0, index_count = 0;
+
+  for (size_t p = 0; p < gltf_mesh->primitiveCount; ++p) {
+    const struct fpx3d_model_gltf_mesh_primitive *prim =
+        &gltf_mesh->primitives[p];
+
+    const struct fpx3d_model_gltf_primitive_attribute *pos =
+        _find_gltf_attribute(prim, FPX3D_MODEL_SEMANTIC_POSITION, 0);
+
+    if (FPX3D_GLTF_RENDER_MODE_TRIANGLES != prim->renderMode || NULL == pos) {
+      FREE_SAFE(vertex_bases);
+      FREE_SAFE(infos);
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+    }
+
+    index_count += (NULL != prim->indices) ? prim->indices->elementCount
+                                           : pos->accessor->elementCount;
+
+    vertex_bases[p] = vertex_count;
+
+    for (size_t q = 0; q < p; ++q) {
+      if (_shares_vertices(prim, &gltf_mesh->primitives[q])) {
+        vertex_bases[p] = vertex_bases[q];
+        break;
+      }
+    }
+
+    if (vertex_bases[p] == vertex_count)
+      vertex_count += pos->accessor->elementCount;
+  }
+
+  Fpx3d_Model_Mesh new_mesh = {0};
+  Fpx3d_E_Result create_res = fpx3d_model_create_mesh(
+      &new_mesh, layout, vertex_count, infos, stream_count);
+
+  FREE_SAFE(infos);
+
+  if (FPX3D_SUCCESS != create_res) {
+    FREE_SAFE(vertex_bases);
+    return create_res;
+  }
+
+  uint32_t *indices = calloc(MAX(index_count, (size_t)1), sizeof(uint32_t));
+  if (NULL == indices) {
+    perror("calloc()");
+    FREE_SAFE(vertex_bases);
+    fpx3d_model_destroy_mesh(&new_mesh);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+#define CONVERT_FAIL(retval)                                                   \
+  {                                                                            \
+    FREE_SAFE(indices);                                                        \
+    FREE_SAFE(vertex_bases);                                                   \
+    fpx3d_model_destroy_mesh(&new_mesh);                                       \
+    return retval;                                                             \
+  }
+
+  size_t index_offset = 0, next_base = 0;
+
+  for (size_t p = 0; p < gltf_mesh->primitiveCount; ++p) {
+    const struct fpx3d_model_gltf_mesh_primitive *prim =
+        &gltf_mesh->primitives[p];
+
+    size_t prim_vertices =
+        _find_gltf_attribute(prim, FPX3D_MODEL_SEMANTIC_POSITION, 0)
+            ->accessor->elementCount;
+    size_t vertex_offset = vertex_bases[p];
+
+    // only the first primitive of a shared range has to read the vertices
+    bool owns_range = (vertex_offset == next_base);
+    if (owns_range)
+      next_base += prim_vertices;
+
+    for (size_t s = 0; owns_range && s < new_mesh.streamCount; ++s) {
+      struct fpx3d_model_mesh_stream *stream = &new_mesh.streams[s];
+
+      const struct fpx3d_model_gltf_primitive_attribute *attr =
+          _find_gltf_attribute(prim, stream->semantic, stream->semanticIndex);
+
+      if (NULL == attr || attr->accessor->elementCount != prim_vertices ||
+          _format_from_gltf(attr->accessor->componentType) != stream->format ||
+          (uint8_t)attr->accessor->elementType != stream->componentCount)
+        CONVERT_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+      Fpx3d_E_Result read_res = __fpx3d_model_gltf_read_accessor(
+          asset, attr->accessor,
+          fpx3d_model_mesh_stream_element(&new_mesh, stream, vertex_offset),
+          stream->stride);
+
+      if (FPX3D_SUCCESS != read_res)
+        CONVERT_FAIL(read_res);
+    }
+
+    size_t prim_indices = prim_vertices;
+
+    if (NULL != prim->indices) {
+      const Fpx3d_Model_GltfAccessor *acc = prim->indices;
+      size_t comp_size = __fpx3d_model_gltf_component_size(acc->componentType);
+
+      if (FPX3D_GLTF_ACCESSOR_ELEMENT_TYPE_SCALAR != acc->elementType ||
+          FPX3D_GLTF_COMPONENT_TYPE_FLOAT == acc->componentType ||
+          0 == comp_size)
+        CONVERT_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+      prim_indices = acc->elementCount;
+
+      // read the packed indices into the start of the 32-bit slots, then
+      // widen them back to front so nothing is overwritten before it's read
+      uint32_t *slot = indices + index_offset;
+      uint8_t *raw = (uint8_t *)slot;
+
+      Fpx3d_E_Result read_res =
+          __fpx3d_model_gltf_read_accessor(asset, acc, raw, comp_size);
+      if (FPX3D_SUCCESS != read_res)
+        CONVERT_FAIL(read_res);
+
+      for (size_t i = prim_indices; i > 0; --i) {
+        uint32_t value = 0;
+
+        switch (comp_size) {
+        case 1:
+          value = raw[i - 1];
+          break;
+        case 2: {
+          uint16_t v;
+          memcpy(&v, raw + (i - 1) * 2, sizeof(v));
+          value = v;
+          break;
+        }
+        default:
+          memcpy(&value, raw + (i - 1) * 4, sizeof(value));
+          break;
+        }
+
+        if (value >= prim_vertices)
+          CONVERT_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+        slot[i - 1] = value + (uint32_t)vertex_offset;
+      }
+    } else {
+      for (size_t i = 0; i < prim_indices; ++i)
+        indices[index_offset + i] = (uint32_t)(vertex_offset + i);
+    }
+
+    index_offset += prim_indices;
+  }
+
+  Fpx3d_E_Result idx_res =
+      fpx3d_model_mesh_set_indices(&new_mesh, indices, index_count);
+  FREE_SAFE(indices);
+  FREE_SAFE(vertex_bases);
+
+  if (FPX3D_SUCCESS != idx_res) {
+    fpx3d_model_destroy_mesh(&new_mesh);
+    return idx_res;
+  }
+
+#undef CONVERT_FAIL
+
+  index_offset = 0;
+
+  for (size_t p = 0; p < gltf_mesh->primitiveCount; ++p) {
+    const struct fpx3d_model_gltf_mesh_primitive *prim =
+        &gltf_mesh->primitives[p];
+
+    size_t prim_indices =
+        (NULL != prim->indices)
+            ? prim->indices->elementCount
+            : _find_gltf_attribute(prim, FPX3D_MODEL_SEMANTIC_POSITION, 0)
+                  ->accessor->elementCount;
+
+    int32_t material = -1;
+    if (NULL != prim->material && NULL != desc->materials)
+      material = (int32_t)(prim->material - desc->materials);
+
+    if (0 < prim_indices) {
+      Fpx3d_E_Result sub_res = fpx3d_model_mesh_add_submesh(
+          &new_mesh, index_offset, prim_indices, material);
+
+      if (FPX3D_SUCCESS != sub_res) {
+        fpx3d_model_destroy_mesh(&new_mesh);
+        return sub_res;
+      }
+    }
+
+    index_offset += prim_indices;
+  }
+
+  fpx3d_model_mesh_compute_bounds(&new_mesh);
+
+  *output = new_mesh;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_model_mesh_to_gltf(const Fpx3d_Model_Mesh *mesh,
+                                        Fpx3d_Model_GltfAsset *output) {
+  NULL_CHECK(mesh, FPX3D_ARGS_ERROR);
+  NULL_CHECK(mesh->vertexData, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  size_t exported = 0;
+  for (size_t s = 0; s < mesh->streamCount; ++s) {
+    if (FPX3D_MODEL_SEMANTIC_CUSTOM == mesh->streams[s].semantic) {
+      FPX3D_WARN("Custom stream #%" LONG_FORMAT "u has no glTF equivalent, "
+                 "it will not be exported",
+                 s);
+      continue;
+    }
+
+    if (FPX3D_GLTF_COMPONENT_TYPE_INVALID ==
+        _format_to_gltf(mesh->streams[s].format))
+      return FPX3D_ARGS_ERROR;
+
+    ++exported;
+  }
+
+  if (1 > exported)
+    return FPX3D_ARGS_ERROR;
+
+  bool indexed = (NULL != mesh->indices && 0 < mesh->indexCount);
+
+  // a mesh without submeshes is exported as a single primitive
+  struct fpx3d_model_submesh whole = {
+      .firstIndex = 0,
+      .indexCount = indexed ? mesh->indexCount : mesh->vertexCount,
+      .firstVertex = 0,
+      .vertexCount = mesh->vertexCount,
+      .material = -1,
+  };
+  // mesh->bounds are only as recent as the last call to
+  // fpx3d_model_mesh_compute_bounds(); _submesh_bounds() only reads the mesh
+  _submesh_bounds((Fpx3d_Model_Mesh *)mesh, &whole);
+
+  const struct fpx3d_model_submesh *subs =
+      (0 < mesh->submeshCount) ? mesh->submeshes : &whole;
+  size_t prim_count = MAX(mesh->submeshCount, (size_t)1);
+
+  size_t vertex_bytes = ALIGN_ELEMENT(mesh->vertexDataSize);
+  size_t index_bytes = indexed ? mesh->indexCount * mesh->indexSize : 0;
+
+  size_t view_count =
+      ((FPX3D_MODEL_LAYOUT_SOA == mesh->layout) ? exported : 1) +
+      (indexed ? 1 : 0);
+
+  // indexed primitives share the attribute accessors, non-indexed ones
+  // need their own vertex ranges
+  size_t accessor_count =
+      indexed ? exported + prim_count : exported * prim_count;
+
+  Fpx3d_Model_GltfAsset new_asset = {0};
+  new_asset.containerType = FPX3D_GLTF_CONTAINER_GLTF;
+
+  Fpx3d_Model_GltfAssetDescription *desc = &new_asset.gltf;
+  desc->version.major = 2;
+  desc->version.minor = 0;
+
+#define EXPORT_FAIL(retval)                                                    \
+  {                                                                            \
+    fpx3d_model_destroy_gltf(&new_asset);                                      \
+    return retval;                                                             \
+  }
+
+  FPX3D_ONFAIL(__fpx3d_realloc_array((void **)&desc->buffers,
+                                     sizeof(*desc->buffers), 1,
+                                     &desc->bufferCount),
+               alloc_res, EXPORT_FAIL(alloc_res));
+  FPX3D_ONFAIL(__fpx3d_realloc_array((void **)&desc->bufferViews,
+                                     sizeof(*desc->bufferViews), view_count,
+                                     &desc->bufferViewCount),
+               alloc_res, EXPORT_FAIL(alloc_res));
+  FPX3D_ONFAIL(__fpx3d_realloc_array((void **)&desc->accessors,
+                                     sizeof(*desc->accessors), accessor_count,
+                                     &desc->accessorCount),
+               alloc_res, EXPORT_FAIL(alloc_res));
+  FPX3D_ONFAIL(__fpx3d_realloc_array((void **)&desc->meshes,
+                                     sizeof(*desc->meshes), 1,
+                                     &desc->meshCount),
+               alloc_res, EXPORT_FAIL(alloc_res));
+
+  {
+    // .buffers
+    Fpx3d_Model_GltfBuffer *buf = &desc->buffers[0];
+
+    size_t temp = 0;
+    FPX3D_ONFAIL(__fpx3d_realloc_array(&buf->data, 1,
+                                       vertex_bytes + index_bytes, &temp),
+                 alloc_res, EXPORT_FAIL(alloc_res));
+
+    buf->dataLength = vertex_bytes + index_bytes;
+
+    memcpy(buf->data, mesh->vertexData, mesh->vertexDataSize);
+    if (indexed)
+      memcpy((uint8_t *)buf->data + vertex_bytes, mesh->indices, index_bytes);
+  }
+
+  {
+    // .bufferViews
+    size_t v = 0;
+
+    if (FPX3D_MODEL_LAYOUT_SOA == mesh->layout) {
+      for (size_t s = 0; s < mesh->streamCount; ++s) {
+        const struct fpx3d_model_mesh_stream *stream = &mesh->streams[s];
+        if (FPX3D_MODEL_SEMANTIC_CUSTOM == stream->semantic)
+          continue;
+
+        desc->bufferViews[v].buffer = &desc->buffers[0];
+        desc->bufferViews[v].byteOffset = stream->offset;
+        desc->bufferViews[v].byteLength = stream->stride * mesh->vertexCount;
+        desc->bufferViews[v].byteStride =
+            (stream->stride != stream->elementSize) ? stream->stride : 0;
+        desc->bufferViews[v].target =
+            FPX3D_GLTF_BUFFER_VIEW_TARGET_ARRAY_BUFFER;
+        ++v;
+      }
+    } else {
+      desc->bufferViews[v].buffer = &desc->buffers[0];
+      desc->bufferViews[v].byteOffset = 0;
+      desc->bufferViews[v].byteLength = mesh->vertexDataSize;
+      desc->bufferViews[v].byteStride = mesh->streams[0].stride;
+      desc->bufferViews[v].target = FPX3D_GLTF_BUFFER_VIEW_TARGET_ARRAY_BUFFER;
+      ++v;
+    }
+
+    if (indexed) {
+      desc->bufferViews[v].buffer = &desc->buffers[0];
+      desc->bufferViews[v].byteOffset = vertex_bytes;
+      desc->bufferViews[v].byteLength = index_bytes;
+      desc->bufferViews[v].target =
+          FPX3D_GLTF_BUFFER_VIEW_TARGET_ELEMENT_ARRAY_BUFFER;
+    }
+  }
+
+  Fpx3d_Model_GltfMesh *out_mesh = &desc->meshes[0];
+
+  FPX3D_ONFAIL(__fpx3d_realloc_array((void **)&out_mesh->primitives,
+                                     sizeof(*out_mesh->primitives), prim_count,
+                                     &out_mesh->primitiveCount),
+               alloc_res, EXPORT_FAIL(alloc_res));
+
+  size_t next_accessor = 0;
+
+  for (size_t p = 0; p < prim_count; ++p) {
+    struct fpx3d_model_gltf_mesh_primitive *prim = &out_mesh->primitives[p];
+    const struct fpx3d_model_submesh *sub = &subs[p];
+
+    prim->renderMode = FPX3D_GLTF_RENDER_MODE_TRIANGLES;
+
+    FPX3D_ONFAIL(__fpx3d_realloc_array((void **)&prim->attributes,
+                                       sizeof(*prim->attributes), exported,
+                                       &prim->attributeCount),
+                 alloc_res, EXPORT_FAIL(alloc_res));
+
+    size_t a = 0, view_idx = 0;
+
+    for (size_t s = 0; s < mesh->streamCount; ++s) {
+      const struct fpx3d_model_mesh_stream *stream = &mesh->streams[s];
+      if (FPX3D_MODEL_SEMANTIC_CUSTOM == stream->semantic)
+        continue;
+
+      Fpx3d_Model_GltfAccessor *acc = NULL;
+
+      if (indexed && 0 < p) {
+        // already created for the first primitive
+        acc = out_mesh->primitives[0].attributes[a].accessor;
+      } else {
+        acc = &desc->accessors[next_accessor++];
+
+        acc->view = &desc->bufferViews[(FPX3D_MODEL_LAYOUT_SOA == mesh->layout)
+                                           ? view_idx
+                                           : 0];
+        acc->byteOffset =
+            (FPX3D_MODEL_LAYOUT_SOA == mesh->layout) ? 0 : stream->offset;
+        acc->componentType = _format_to_gltf(stream->format);
+        acc->componentsNormalized = stream->normalized;
+        acc->elementType = stream->componentCount;
+        acc->elementCount = mesh->vertexCount;
+
+        if (false == indexed) {
+          acc->byteOffset += sub->firstVertex * stream->stride;
+          acc->elementCount = sub->indexCount;
+        }
+
+        // other POSITION formats get no bounds from _submesh_bounds(), so
+        // they are left for whoever writes the asset out to compute
+        if (FPX3D_MODEL_SEMANTIC_POSITION == stream->semantic &&
+            FPX3D_MODEL_FORMAT_FLOAT32 == stream->format &&
+            3 == stream->componentCount) {
+          const struct fpx3d_model_submesh *range = indexed ? &whole : sub;
+
+          memcpy(acc->minValues.vector3, range->bounds.min, sizeof(vec3));
+          memcpy(acc->maxValues.vector3, range->bounds.max, sizeof(vec3));
+          acc->hasBounds = true;
+        }
+      }
+
+      prim->attributes[a].attribute = (int)stream->semantic;
+      prim->attributes[a].n = stream->semanticIndex;
+      prim->attributes[a].accessor = acc;
+
+      ++a;
+      ++view_idx;
+    }
+
+    if (indexed) {
+      Fpx3d_Model_GltfAccessor *acc = &desc->accessors[next_accessor++];
+
+      acc->view = &desc->bufferViews[view_count - 1];
+      acc->byteOffset = sub->firstIndex * mesh->indexSize;
+      acc->componentType = (2 == mesh->indexSize)
+                               ? FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_SHORT
+                               : FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_INT;
+      acc->elementType = FPX3D_GLTF_ACCESSOR_ELEMENT_TYPE_SCALAR;
+      acc->elementCount = sub->indexCount;
+
+      prim->indices = acc;
+    }
+  }
+
+#undef EXPORT_FAIL
+
+  *output = new_asset;
+
+  return FPX3D_SUCCESS;
+}
+
+// STATIC FUNCTIONS ----
+
+static Fpx3d_E_Result
+_layout_streams(Fpx3d_Model_Mesh *mesh,
+                const struct fpx3d_model_mesh_stream_info *streams,
+                size_t stream_count) {
+  Fpx3d_E_Result alloc_res =
+      __fpx3d_realloc_array((void **)&mesh->streams, sizeof(*mesh->streams),
+                            stream_count, &mesh->streamCount);
+
+  if (FPX3D_SUCCESS != alloc_res)
+    return alloc_res;
+
+  size_t running_offset = 0;
+
+  for (size_t i = 0; i < stream_count; ++i) {
+    const struct fpx3d_model_mesh_stream_info *info = &streams[i];
+    struct fpx3d_model_mesh_stream *stream = &mesh->streams[i];
+
+    size_t comp_size = fpx3d_model_component_size(info->format);
+
+    if (0 == comp_size || 1 > info->componentCount || 4 < info->componentCount)
+      return FPX3D_ARGS_ERROR;
+
+    stream->semantic = info->semantic;
+    stream->semanticIndex = info->semanticIndex;
+    stream->format = info->format;
+    stream->componentCount = info->componentCount;
+    stream->normalized = info->normalized;
+    stream->elementSize = comp_size * info->componentCount;
+
+    if (NULL != info->name) {
+      size_t temp = 0;
+      alloc_res = __fpx3d_realloc_array((void **)&stream->name, 1,
+                                        strlen(info->name) + 1, &temp);
+
+      if (FPX3D_SUCCESS != alloc_res)
+        return alloc_res;
+
+      memcpy(stream->name, info->name, temp);
+    }
+
+    size_t padded = ALIGN_ELEMENT(stream->elementSize);
+
+    stream->offset = running_offset;
+
+    if (FPX3D_MODEL_LAYOUT_SOA == mesh->layout) {
+      stream->stride = padded;
+      running_offset += padded * mesh->vertexCount;
+    } else {
+      running_offset += padded;
+    }
+  }
+
+  if (FPX3D_MODEL_LAYOUT_INTERLEAVED == mesh->layout) {
+    // running_offset is now the size of one full vertex
+    for (size_t i = 0; i < stream_count; ++i)
+      mesh->streams[i].stride = running_offset;
+
+    mesh->vertexDataSize = running_offset * mesh->vertexCount;
+  } else {
+    mesh->vertexDataSize = running_offset;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+static void _stream_info(const struct fpx3d_model_mesh_stream *stream,
+                         struct fpx3d_model_mesh_stream_info *output) {
+  output->name = stream->name;
+  output->semantic = stream->semantic;
+  output->semanticIndex = stream->semanticIndex;
+  output->format = stream->format;
+  output->componentCount = stream->componentCount;
+  output->normalized = stream->normalized;
+}
+
+static Fpx3d_Model_E_ComponentFormat
+_format_from_gltf(Fpx3d_Model_E_GltfComponentType type) {
+  switch (type) {
+  case FPX3D_GLTF_COMPONENT_TYPE_BYTE:
+    return FPX3D_MODEL_FORMAT_SINT8;
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+    return FPX3D_MODEL_FORMAT_UINT8;
+  case FPX3D_GLTF_COMPONENT_TYPE_SHORT:
+    return FPX3D_MODEL_FORMAT_SINT16;
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+    return FPX3D_MODEL_FORMAT_UINT16;
+  case FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_INT:
+    return FPX3D_MODEL_FORMAT_UINT32;
+  case FPX3D_GLTF_COMPONENT_TYPE_FLOAT:
+    return FPX3D_MODEL_FORMAT_FLOAT32;
+  default:
+    return FPX3D_MODEL_FORMAT_INVALID;
+  }
+}
+
+static Fpx3d_Model_E_GltfComponentType
+_format_to_gltf(Fpx3d_Model_E_ComponentFormat format) {
+  switch (format) {
+  case FPX3D_MODEL_FORMAT_SINT8:
+    return FPX3D_GLTF_COMPONENT_TYPE_BYTE;
+  case FPX3D_MODEL_FORMAT_UINT8:
+    return FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+  case FPX3D_MODEL_FORMAT_SINT16:
+    return FPX3D_GLTF_COMPONENT_TYPE_SHORT;
+  case FPX3D_MODEL_FORMAT_UINT16:
+    return FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_SHORT;
+  case FPX3D_MODEL_FORMAT_UINT32:
+    return FPX3D_GLTF_COMPONENT_TYPE_UNSIGNED_INT;
+  case FPX3D_MODEL_FORMAT_FLOAT32:
+    return FPX3D_GLTF_COMPONENT_TYPE_FLOAT;
+
+  // no half floats in core glTF
+  default:
+    return FPX3D_GLTF_COMPONENT_TYPE_INVALID;
+  }
+}
+
+static const struct fpx3d_model_gltf_primitive_attribute *
+_find_gltf_attribute(const struct fpx3d_model_gltf_mesh_primitive *prim,
+                     Fpx3d_Model_E_AttributeSemantic semantic, uint8_t n) {
+  for (size_t i = 0; i < prim->attributeCount; ++i) {
+    if ((int)prim->attributes[i].attribute == (int)semantic &&
+        prim->attributes[i].n == n && NULL != prim->attributes[i].accessor)
+      return &prim->attributes[i];
+  }
+
+  return NULL;
+}
+
+static bool
+_shares_vertices(const struct fpx3d_model_gltf_mesh_primitive *a,
+                 const struct fpx3d_model_gltf_mesh_primitive *b) {
+  if (a->attributeCount != b->attributeCount)
+    return false;
+
+  for (size_t i = 0; i < a->attributeCount; ++i) {
+    const struct fpx3d_model_gltf_primitive_attribute *other =
+        _find_gltf_attribute(b, (int)a->attributes[i].attribute,
+                             a->attributes[i].n);
+
+    if (NULL == other || other->accessor != a->attributes[i].accessor)
+      return false;
+  }
+
+  return true;
+}
+
+static void _submesh_bounds(Fpx3d_Model_Mesh *mesh,
+                            struct fpx3d_model_submesh *submesh) {
+  struct fpx3d_model_mesh_stream *pos =
+      fpx3d_model_mesh_get_stream(mesh, FPX3D_MODEL_SEMANTIC_POSITION, 0);
+
+  memset(&submesh->bounds, 0, sizeof(submesh->bounds));
+
+  if (NULL == pos || FPX3D_MODEL_FORMAT_FLOAT32 != pos->format ||
+      3 > pos->componentCount || 1 > submesh->vertexCount)
+    return;
+
+  for (size_t i = 0; i < 3; ++i) {
+    submesh->bounds.min[i] = FLT_MAX;
+    submesh->bounds.max[i] = -FLT_MAX;
+  }
+
+  for (size_t v = submesh->firstVertex;
+       v < submesh->firstVertex + submesh->vertexCount; ++v) {
+    float p[3];
+    memcpy(p, fpx3d_model_mesh_stream_element(mesh, pos, v), sizeof(p));
+
+    for (size_t i = 0; i < 3; ++i) {
+      submesh->bounds.min[i] = MIN(submesh->bounds.min[i], p[i]);
+      submesh->bounds.max[i] = MAX(submesh->bounds.max[i], p[i]);
+    }
+  }
+
+  return;
+}
+
+// END OF STATIC FUNCTIONS ----
@@ -0,0 +1,741 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+// Decoders for the EXT_meshopt_compression glTF extension.
+// Bitstream layout follows the extension specification:
+// https://github.com/KhronosGroup/glTF/tree/main/extensions/2.0/Vendor/EXT_meshopt_compression
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#define MESHOPT_VERTEX_HEADER 0xA0
+#define MESHOPT_TRIANGLE_HEADER 0xE0
+#define MESHOPT_SEQUENCE_HEADER 0xD0
+
+#define VERTEX_BLOCK_SIZE_BYTES 8192
+#define VERTEX_BLOCK_MAX_SIZE 256
+#define BYTE_GROUP_SIZE 16
+#define BYTE_GROUP_DECODE_LIMIT 24
+#define TAIL_MAX_SIZE 32
+
+// static declarations ----
+
+static size_t _vertex_block_size(size_t vertex_size);
+
+static const uint8_t *_decode_byte_group(const uint8_t *data, uint8_t *output,
+                                         int bitslog2);
+
+static const uint8_t *_decode_bytes(const uint8_t *data, const uint8_t *limit,
+                                    uint8_t *output, size_t output_size);
+
+static const uint8_t *_decode_vertex_block(const uint8_t *data,
+                                           const uint8_t *limit,
+                                           uint8_t *output, size_t count,
+                                           size_t vertex_size,
+                                           uint8_t last_vertex[256]);
+
+static uint32_t _decode_vbyte(const uint8_t **dataptr);
+
+static uint32_t _decode_index(const uint8_t **dataptr, uint32_t last);
+
+static void _write_triangle(void *output, size_t offset, size_t index_size,
+                            uint32_t a, uint32_t b, uint32_t c);
+
+static void _filter_octahedral_8(int8_t *data, size_t count);
+static void _filter_octahedral_16(int16_t *data, size_t count);
+
+// end of static declarations ----
+
+Fpx3d_E_Result __fpx3d_model_meshopt_decode_vertices(void *output,
+                                                     size_t vertex_count,
+                                                     size_t vertex_size,
+                                                     const uint8_t *input,
+                                                     size_t input_length) {
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+  NULL_CHECK(input, FPX3D_ARGS_ERROR);
+
+  if (0 == vertex_size || vertex_size > 256 || vertex_size % 4 != 0)
+    return FPX3D_ARGS_ERROR;
+
+  const uint8_t *data = input;
+  const uint8_t *limit = input + input_length;
+
+  if (input_length < 1 + vertex_size)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  uint8_t header = *data++;
+
+  // only version 0 of the vertex codec is described by the extension
+  if (MESHOPT_VERTEX_HEADER != header)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  // the first vertex is stored in the tail and acts as the delta baseline
+  uint8_t last_vertex[256] = {0};
+  memcpy(last_vertex, limit - vertex_size, vertex_size);
+
+  size_t block_size = _vertex_block_size(vertex_size);
+  uint8_t *output_bytes = output;
+
+  for (size_t offset = 0; offset < vertex_count;) {
+    size_t count = MIN(block_size, vertex_count - offset);
+
+    data = _decode_vertex_block(data, limit, output_bytes + offset * vertex_size,
+                                count, vertex_size, last_vertex);
+    if (NULL == data)
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+    offset += count;
+  }
+
+  size_t tail_size = MAX(vertex_size, TAIL_MAX_SIZE);
+
+  if ((size_t)(limit - data) != tail_size)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result __fpx3d_model_meshopt_decode_triangles(void *output,
+                                                      size_t index_count,
+                                                      size_t index_size,
+                                                      const uint8_t *input,
+                                                      size_t input_length) {
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+  NULL_CHECK(input, FPX3D_ARGS_ERROR);
+
+  if (index_count % 3 != 0 || (2 != index_size && 4 != index_size))
+    return FPX3D_ARGS_ERROR;
+
+  // header, one code byte per triangle and the 16-byte codeaux table
+  if (input_length < 1 + index_count / 3 + 16)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  if (MESHOPT_TRIANGLE_HEADER != (input[0] & 0xF0))
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  int version = input[0] & 0x0F;
+  if (version > 1)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  uint32_t edge_fifo[16][2];
+  uint32_t vertex_fifo[16];
+
+  memset(edge_fifo, 0xFF, sizeof(edge_fifo));
+  memset(vertex_fifo, 0xFF, sizeof(vertex_fifo));
+
+  size_t edge_offset = 0;
+  size_t vertex_offset = 0;
+
+  uint32_t next = 0;
+  uint32_t last = 0;
+
+  int fec_max = (version >= 1) ? 13 : 15;
+
+  const uint8_t *code = input + 1;
+  const uint8_t *data = code + index_count / 3;
+  const uint8_t *data_safe_end = input + input_length - 16;
+
+  const uint8_t *codeaux_table = data_safe_end;
+
+#define PUSH_VERTEX(v, cond)                                                   \
+  {                                                                            \
+    vertex_fifo[vertex_offset] = (v);                                          \
+    vertex_offset = (vertex_offset + (cond)) & 15;                             \
+  }
+
+#define PUSH_EDGE(a, b)                                                        \
+  {                                                                            \
+    edge_fifo[edge_offset][0] = (a);                                           \
+    edge_fifo[edge_offset][1] = (b);                                           \
+    edge_offset = (edge_offset + 1) & 15;                                      \
+  }
+
+  for (size_t i = 0; i < index_count; i += 3) {
+    // a single triangle reads at most 16 bytes past `data`, which the codeaux
+    // table at the end of the stream covers
+    if (data > data_safe_end)
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+    uint8_t codetri = *code++;
+
+    if (codetri < 0xF0) {
+      int fe = codetri >> 4;
+
+      uint32_t a = edge_fifo[(edge_offset - 1 - fe) & 15][0];
+      uint32_t b = edge_fifo[(edge_offset - 1 - fe) & 15][1];
+
+      int fec = codetri & 15;
+
+      if (fec < fec_max) {
+        uint32_t cf = vertex_fifo[(vertex_offset - 1 - fec) & 15];
+        uint32_t c = (0 == fec) ? next : cf;
+
+        int fec0 = (0 == fec);
+        next += fec0;
+
+        _write_triangle(output, i, index_size, a, b, c);
+
+        PUSH_VERTEX(c, fec0);
+
+        PUSH_EDGE(c, b);
+        PUSH_EDGE(a, c);
+      } else {
+        // fec 13 and 14 encode last-1 and last+1 respectively (version 1)
+        uint32_t c = (15 != fec) ? last + (fec - (fec ^ 3))
+                                 : _decode_index(&data, last);
+        last = c;
+
+        _write_triangle(output, i, index_size, a, b, c);
+
+        PUSH_VERTEX(c, 1);
+
+        PUSH_EDGE(c, b);
+        PUSH_EDGE(a, c);
+      }
+    } else if (codetri < 0xFE) {
+      uint8_t codeaux = codeaux_table[codetri & 15];
+
+      int feb = codeaux >> 4;
+      int fec = codeaux & 15;
+
+      uint32_t a = next++;
+
+      uint32_t bf = vertex_fifo[(vertex_offset - feb) & 15];
+      uint32_t b = (0 == feb) ? next : bf;
+
+      int feb0 = (0 == feb);
+      next += feb0;
+
+      uint32_t cf = vertex_fifo[(vertex_offset - fec) & 15];
+      uint32_t c = (0 == fec) ? next : cf;
+
+      int fec0 = (0 == fec);
+      next += fec0;
+
+      _write_triangle(output, i, index_size, a, b, c);
+
+      PUSH_VERTEX(a, 1);
+      PUSH_VERTEX(b, feb0);
+      PUSH_VERTEX(c, fec0);
+
+      PUSH_EDGE(b, a);
+      PUSH_EDGE(c, b);
+      PUSH_EDGE(a, c);
+    } else {
+      uint8_t codeaux = *data++;
+
+      int fea = (0xFE == codetri) ? 0 : 15;
+      int feb = codeaux >> 4;
+      int fec = codeaux & 15;
+
+      // codeaux of 0 outside of the table means "reset"
+      if (0 == codeaux)
+        next = 0;
+
+      uint32_t a = (0 == fea) ? next++ : 0;
+      uint32_t b =
+          (0 == feb) ? next++ : vertex_fifo[(vertex_offset - feb) & 15];
+      uint32_t c =
+          (0 == fec) ? next++ : vertex_fifo[(vertex_offset - fec) & 15];
+
+      if (15 == fea)
+        last = a = _decode_index(&data, last);
+
+      if (15 == feb)
+        last = b = _decode_index(&data, last);
+
+      if (15 == fec)
+        last = c = _decode_index(&data, last);
+
+      _write_triangle(output, i, index_size, a, b, c);
+
+      PUSH_VERTEX(a, 1);
+      PUSH_VERTEX(b, (0 == feb) | (15 == feb));
+      PUSH_VERTEX(c, (0 == fec) | (15 == fec));
+
+      PUSH_EDGE(b, a);
+      PUSH_EDGE(c, b);
+      PUSH_EDGE(a, c);
+    }
+  }
+
+#undef PUSH_VERTEX
+#undef PUSH_EDGE
+
+  if (data != data_safe_end)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result __fpx3d_model_meshopt_decode_indices(void *output,
+                                                    size_t index_count,
+                                                    size_t index_size,
+                                                    const uint8_t *input,
+                                                    size_t input_length) {
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+  NULL_CHECK(input, FPX3D_ARGS_ERROR);
+
+  if (2 != index_size && 4 != index_size)
+    return FPX3D_ARGS_ERROR;
+
+  // header, at least one byte per index and a 4-byte tail
+  if (input_length < 1 + index_count + 4)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  if (MESHOPT_SEQUENCE_HEADER != (input[0] & 0xF0))
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  if ((input[0] & 0x0F) > 1)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  const uint8_t *data = input + 1;
+  const uint8_t *data_safe_end = input + input_length - 4;
+
+  uint32_t last[2] = {0};
+
+  for (size_t i = 0; i < index_count; ++i) {
+    // a single index reads at most 5 bytes; the tail covers the overshoot
+    if (data >= data_safe_end)
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+    uint32_t v = _decode_vbyte(&data);
+
+    // lowest bit selects which of the two baselines is used
+    uint32_t baseline = v & 1;
+    v >>= 1;
+
+    uint32_t delta = (v >> 1) ^ -(v & 1);
+    uint32_t index = last[baseline] + delta;
+
+    last[baseline] = index;
+
+    if (2 == index_size)
+      ((uint16_t *)output)[i] = (uint16_t)index;
+    else
+      ((uint32_t *)output)[i] = index;
+  }
+
+  if (data != data_safe_end)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result __fpx3d_model_meshopt_filter_octahedral(void *data,
+                                                       size_t count,
+                                                       size_t stride) {
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  switch (stride) {
+  case 4:
+    _filter_octahedral_8(data, count);
+    break;
+  case 8:
+    _filter_octahedral_16(data, count);
+    break;
+  default:
+    return FPX3D_ARGS_ERROR;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result __fpx3d_model_meshopt_filter_quaternion(void *data,
+                                                       size_t count,
+                                                       size_t stride) {
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  if (8 != stride)
+    return FPX3D_ARGS_ERROR;
+
+  int16_t *q = data;
+  const float scale = 1.0f / sqrtf(2.0f);
+
+  size_t i = 0;
+
+#ifdef __SSE2__
+  for (; i + 4 <= count; i += 4) {
+    int16_t *e = q + i * 4;
+
+    // the two low bits of w hold the index of the dropped component, the
+    // rest holds the quantization scale
+    __m128 ss = _mm_div_ps(
+        _mm_set1_ps(scale),
+        _mm_set_ps((float)(e[15] | 3), (float)(e[11] | 3), (float)(e[7] | 3),
+                   (float)(e[3] | 3)));
+
+    __m128 x = _mm_mul_ps(
+        _mm_set_ps((float)e[12], (float)e[8], (float)e[4], (float)e[0]), ss);
+    __m128 y = _mm_mul_ps(
+        _mm_set_ps((float)e[13], (float)e[9], (float)e[5], (float)e[1]), ss);
+    __m128 z = _mm_mul_ps(
+        _mm_set_ps((float)e[14], (float)e[10], (float)e[6], (float)e[2]), ss);
+
+    __m128 ww = _mm_sub_ps(
+        _mm_set1_ps(1.0f),
+        _mm_add_ps(_mm_mul_ps(x, x), _mm_add_ps(_mm_mul_ps(y, y),
+                                                _mm_mul_ps(z, z))));
+    __m128 w = _mm_sqrt_ps(_mm_max_ps(ww, _mm_setzero_ps()));
+
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 sign_mask = _mm_set1_ps(-0.0f);
+    __m128 s = _mm_set1_ps(32767.0f);
+
+#define ROUND_SIGNED(v)                                                        \
+  _mm_cvttps_epi32(_mm_add_ps(                                                 \
+      _mm_mul_ps(v, s), _mm_or_ps(half, _mm_and_ps(v, sign_mask))))
+
+    int32_t xf[4], yf[4], zf[4], wf[4];
+    _mm_storeu_si128((__m128i *)xf, ROUND_SIGNED(x));
+    _mm_storeu_si128((__m128i *)yf, ROUND_SIGNED(y));
+    _mm_storeu_si128((__m128i *)zf, ROUND_SIGNED(z));
+    _mm_storeu_si128((__m128i *)wf, ROUND_SIGNED(w));
+
+#undef ROUND_SIGNED
+
+    for (size_t k = 0; k < 4; ++k) {
+      int16_t *elem = e + k * 4;
+      int qc = elem[3] & 3;
+
+      elem[(qc + 1) & 3] = (int16_t)xf[k];
+      elem[(qc + 2) & 3] = (int16_t)yf[k];
+      elem[(qc + 3) & 3] = (int16_t)zf[k];
+      elem[(qc + 0) & 3] = (int16_t)wf[k];
+    }
+  }
+#endif // __SSE2__
+
+  for (; i < count; ++i) {
+    int16_t *elem = q + i * 4;
+
+    float ss = scale / (float)(elem[3] | 3);
+
+    float x = (float)elem[0] * ss;
+    float y = (float)elem[1] * ss;
+    float z = (float)elem[2] * ss;
+
+    float ww = 1.0f - x * x - y * y - z * z;
+    float w = sqrtf(ww >= 0.0f ? ww : 0.0f);
+
+    int xf = (int)(x * 32767.0f + (x >= 0.0f ? 0.5f : -0.5f));
+    int yf = (int)(y * 32767.0f + (y >= 0.0f ? 0.5f : -0.5f));
+    int zf = (int)(z * 32767.0f + (z >= 0.0f ? 0.5f : -0.5f));
+    int wf = (int)(w * 32767.0f + 0.5f);
+
+    int qc = elem[3] & 3;
+
+    elem[(qc + 1) & 3] = (int16_t)xf;
+    elem[(qc + 2) & 3] = (int16_t)yf;
+    elem[(qc + 3) & 3] = (int16_t)zf;
+    elem[(qc + 0) & 3] = (int16_t)wf;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result __fpx3d_model_meshopt_filter_exponential(void *data,
+                                                        size_t count,
+                                                        size_t stride) {
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  if (0 == stride || stride % 4 != 0)
+    return FPX3D_ARGS_ERROR;
+
+  // every 32-bit component is filtered independently
+  size_t values = count * (stride / 4);
+  uint32_t *v = data;
+
+  size_t i = 0;
+
+#ifdef __SSE2__
+  for (; i + 4 <= values; i += 4) {
+    __m128i raw = _mm_loadu_si128((const __m128i *)(v + i));
+
+    // 24-bit signed mantissa, 8-bit signed exponent
+    __m128i mantissa = _mm_srai_epi32(_mm_slli_epi32(raw, 8), 8);
+    __m128i exponent = _mm_srai_epi32(raw, 24);
+
+    __m128 pow2 = _mm_castsi128_ps(
+        _mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(127)), 23));
+
+    __m128 result = _mm_mul_ps(pow2, _mm_cvtepi32_ps(mantissa));
+
+    _mm_storeu_ps((float *)(v + i), result);
+  }
+#endif // __SSE2__
+
+  for (; i < values; ++i) {
+    int32_t mantissa = (int32_t)(v[i] << 8) >> 8;
+    int32_t exponent = (int32_t)v[i] >> 24;
+
+    union {
+      float f;
+      uint32_t u;
+    } pow2 = {.u = (uint32_t)(exponent + 127) << 23};
+
+    float result = pow2.f * (float)mantissa;
+    memcpy(&v[i], &result, sizeof(result));
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+// STATIC FUNCTIONS ----
+
+static size_t _vertex_block_size(size_t vertex_size) {
+  // a whole block has to fit in the transpose scratch buffer,
+  // and is truncated to a multiple of the byte group size
+  size_t result = VERTEX_BLOCK_SIZE_BYTES / vertex_size;
+  result &= ~(size_t)(BYTE_GROUP_SIZE - 1);
+
+  return MIN(result, (size_t)VERTEX_BLOCK_MAX_SIZE);
+}
+
+static const uint8_t *_decode_byte_group(const uint8_t *data, uint8_t *output,
+                                         int bitslog2) {
+  switch (bitslog2) {
+  case 0:
+    memset(output, 0, BYTE_GROUP_SIZE);
+    return data;
+
+  case 1:
+  case 2: {
+    // 2- or 4-bit codes, where an all-ones code means "read the next
+    // byte from the overflow area after the packed codes"
+    int bits = 1 << bitslog2;
+    uint8_t all_ones = (uint8_t)((1 << bits) - 1);
+
+    const uint8_t *overflow = data + bits * 2;
+
+    for (size_t k = 0; k < BYTE_GROUP_SIZE; ++k) {
+      uint8_t packed = data[(k * bits) / 8];
+      uint8_t enc = (packed >> (8 - bits - (k * bits) % 8)) & all_ones;
+
+      if (enc == all_ones) {
+        output[k] = *overflow++;
+      } else {
+        output[k] = enc;
+      }
+    }
+
+    return overflow;
+  }
+
+  case 3:
+    memcpy(output, data, BYTE_GROUP_SIZE);
+    return data + BYTE_GROUP_SIZE;
+
+  default:
+    return NULL;
+  }
+}
+
+static const uint8_t *_decode_bytes(const uint8_t *data, const uint8_t *limit,
+                                    uint8_t *output, size_t output_size) {
+  const uint8_t *header = data;
+
+  // 2 bits of header per byte group, rounded up to whole bytes
+  size_t header_size = (output_size / BYTE_GROUP_SIZE + 3) / 4;
+
+  if ((size_t)(limit - data) < header_size)
+    return NULL;
+
+  data += header_size;
+
+  for (size_t i = 0; i < output_size; i += BYTE_GROUP_SIZE) {
+    if ((size_t)(limit - data) < BYTE_GROUP_DECODE_LIMIT)
+      return NULL;
+
+    size_t group = i / BYTE_GROUP_SIZE;
+    int bitslog2 = (header[group / 4] >> ((group % 4) * 2)) & 3;
+
+    data = _decode_byte_group(data, output + i, bitslog2);
+  }
+
+  return data;
+}
+
+static const uint8_t *_decode_vertex_block(const uint8_t *data,
+                                           const uint8_t *limit,
+                                           uint8_t *output, size_t count,
+                                           size_t vertex_size,
+                                           uint8_t last_vertex[256]) {
+  uint8_t deltas[VERTEX_BLOCK_MAX_SIZE];
+  uint8_t transposed[VERTEX_BLOCK_SIZE_BYTES];
+
+  size_t count_aligned =
+      (count + BYTE_GROUP_SIZE - 1) & ~(size_t)(BYTE_GROUP_SIZE - 1);
+
+  // every byte of the vertex is stored as its own zigzag-delta stream
+  for (size_t k = 0; k < vertex_size; ++k) {
+    data = _decode_bytes(data, limit, deltas, count_aligned);
+    if (NULL == data)
+      return NULL;
+
+    size_t vertex_offset = k;
+    uint8_t p = last_vertex[k];
+
+    for (size_t i = 0; i < count; ++i) {
+      uint8_t d = deltas[i];
+      uint8_t v = (uint8_t)((-(d & 1)) ^ (d >> 1)) + p;
+
+      transposed[vertex_offset] = v;
+      p = v;
+
+      vertex_offset += vertex_size;
+    }
+  }
+
+  memcpy(output, transposed, count * vertex_size);
+  memcpy(last_vertex, &transposed[vertex_size * (count - 1)], vertex_size);
+
+  return data;
+}
+
+static uint32_t _decode_vbyte(const uint8_t **dataptr) {
+  const uint8_t *data = *dataptr;
+
+  uint8_t lead = *data++;
+
+  if (lead < 128) {
+    *dataptr = data;
+    return lead;
+  }
+
+  uint32_t result = lead & 127;
+  uint32_t shift = 7;
+
+  for (int i = 0; i < 4; ++i) {
+    uint8_t group = *data++;
+    result |= (uint32_t)(group & 127) << shift;
+    shift += 7;
+
+    if (group < 128)
+      break;
+  }
+
+  *dataptr = data;
+  return result;
+}
+
+static uint32_t _decode_index(const uint8_t **dataptr, uint32_t last) {
+  uint32_t v = _decode_vbyte(dataptr);
+  uint32_t delta = (v >> 1) ^ -(v & 1);
+
+  return last + delta;
+}
+
+static void _write_triangle(void *output, size_t offset, size_t index_size,
+                            uint32_t a, uint32_t b, uint32_t c) {
+  if (2 == index_size) {
+    uint16_t *out = (uint16_t *)output + offset;
+    out[0] = (uint16_t)a;
+    out[1] = (uint16_t)b;
+    out[2] = (uint16_t)c;
+  } else {
+    uint32_t *out = (uint32_t *)output + offset;
+    out[0] = a;
+    out[1] = b;
+    out[2] = c;
+  }
+}
+
+// the octahedral filter is identical for both widths except for the
+// component type, so it gets expanded twice
+#define OCTAHEDRAL_FILTER_BODY(type, max_value)                                \
+  {                                                                            \
+    const float max = (float)(max_value);                                      \
+    size_t i = 0;                                                              \
+                                                                               \
+    OCTAHEDRAL_FILTER_SIMD(type)                                               \
+                                                                               \
+    for (; i < count; ++i) {                                                   \
+      type *elem = data + i * 4;                                               \
+                                                                               \
+      float x = (float)elem[0];                                                \
+      float y = (float)elem[1];                                                \
+      float z = (float)elem[2] - fabsf(x) - fabsf(y);                          \
+                                                                               \
+      float t = (z < 0.0f) ? z : 0.0f;                                         \
+      x += (x >= 0.0f) ? t : -t;                                               \
+      y += (y >= 0.0f) ? t : -t;                                               \
+                                                                               \
+      float s = max / sqrtf(x * x + y * y + z * z);                            \
+                                                                               \
+      elem[0] = (type)(int)(x * s + (x >= 0.0f ? 0.5f : -0.5f));               \
+      elem[1] = (type)(int)(y * s + (y >= 0.0f ? 0.5f : -0.5f));               \
+      elem[2] = (type)(int)(z * s + (z >= 0.0f ? 0.5f : -0.5f));               \
+    }                                                                          \
+  }
+
+#ifdef __SSE2__
+#define OCTAHEDRAL_FILTER_SIMD(type)                                           \
+  for (; i + 4 <= count; i += 4) {                                             \
+    type *e = data + i * 4;                                                    \
+                                                                               \
+    __m128 sign_mask = _mm_set1_ps(-0.0f);                                     \
+    __m128 half = _mm_set1_ps(0.5f);                                           \
+                                                                               \
+    __m128 x =                                                                 \
+        _mm_set_ps((float)e[12], (float)e[8], (float)e[4], (float)e[0]);       \
+    __m128 y =                                                                 \
+        _mm_set_ps((float)e[13], (float)e[9], (float)e[5], (float)e[1]);       \
+    __m128 z = _mm_sub_ps(                                                     \
+        _mm_set_ps((float)e[14], (float)e[10], (float)e[6], (float)e[2]),      \
+        _mm_add_ps(_mm_andnot_ps(sign_mask, x), _mm_andnot_ps(sign_mask, y))); \
+                                                                               \
+    /* x += copysign(min(z, 0), x), same for y */                              \
+    __m128 t = _mm_min_ps(z, _mm_setzero_ps());                                \
+    x = _mm_add_ps(x, _mm_xor_ps(t, _mm_and_ps(x, sign_mask)));                \
+    y = _mm_add_ps(y, _mm_xor_ps(t, _mm_and_ps(y, sign_mask)));                \
+                                                                               \
+    __m128 len = _mm_sqrt_ps(_mm_add_ps(                                       \
+        _mm_mul_ps(x, x), _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z))));    \
+    __m128 s = _mm_div_ps(_mm_set1_ps(max), len);                              \
+                                                                               \
+    int32_t xf[4], yf[4], zf[4];                                               \
+    _mm_storeu_si128(                                                          \
+        (__m128i *)xf,                                                         \
+        _mm_cvttps_epi32(_mm_add_ps(                                           \
+            _mm_mul_ps(x, s), _mm_or_ps(half, _mm_and_ps(x, sign_mask)))));    \
+    _mm_storeu_si128(                                                          \
+        (__m128i *)yf,                                                         \
+        _mm_cvttps_epi32(_mm_add_ps(                                           \
+            _mm_mul_ps(y, s), _mm_or_ps(half, _mm_and_ps(y, sign_mask)))));    \
+    _mm_storeu_si128(                                                          \
+        (__m128i *)zf,                                                         \
+        _mm_cvttps_epi32(_mm_add_ps(                                           \
+            _mm_mul_ps(z, s), _mm_or_ps(half, _mm_and_ps(z, sign_mask)))));    \
+                                                                               \
+    for (size_t k = 0; k < 4; ++k) {                                           \
+      e[k * 4 + 0] = (type)xf[k];                                              \
+      e[k * 4 + 1] = (type)yf[k];                                              \
+      e[k * 4 + 2] = (type)zf[k];                                              \
+    }                                                                          \
+  }
+#else
+#define OCTAHEDRAL_FILTER_SIMD(type)
+#endif // __SSE2__
+
+static void _filter_octahedral_8(int8_t *data, size_t count)
+    OCTAHEDRAL_FILTER_BODY(int8_t, INT8_MAX)
+
+static void _filter_octahedral_16(int16_t *data, size_t count)
+    OCTAHEDRAL_FILTER_BODY(int16_t, INT16_MAX)
+
+#undef OCTAHEDRAL_FILTER_BODY
+#undef OCTAHEDRAL_FILTER_SIMD
+
+// END OF STATIC FUNCTIONS ----
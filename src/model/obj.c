@@ -0,0 +1,994 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#include "model/mesh.h"
+#include "model/obj.h"
+
+// files smaller than this are not worth splitting up
+#define CHUNK_MIN_SIZE (256 * 1024)
+#define CHUNKS_PER_THREAD 4
+
+// vertices are filled in blocks of this many per job
+#define VERTEX_JOB_SIZE 65536
+
+#define INDEX_MISSING INT32_MIN
+
+enum {
+  RELATIVE_POSITION = 1 << 0,
+  RELATIVE_TEXCOORD = 1 << 1,
+  RELATIVE_NORMAL = 1 << 2,
+};
+
+// one corner of a triangle, as v/vt/vn indices (0-based).
+// Negative OBJ indices are relative to the end of the current chunk's
+// arrays until the chunk bases are known, see `relative`
+struct _obj_corner {
+  int32_t v, t, n;
+  uint8_t relative;
+};
+
+struct _obj_group {
+  size_t firstCorner;
+
+  // points into the source data
+  const char *name;
+  size_t nameLength;
+};
+
+struct _obj_array {
+  void *data;
+  size_t count;
+  size_t capacity;
+};
+
+struct _obj_chunk {
+  const char *begin;
+  const char *end;
+
+  struct _obj_array positions; // 3 floats each
+  struct _obj_array texcoords; // 2 floats each
+  struct _obj_array normals;   // 3 floats each
+  struct _obj_array corners;   // 3 per triangle
+  struct _obj_array groups;
+
+  size_t positionBase;
+  size_t texcoordBase;
+  size_t normalBase;
+  size_t cornerBase;
+
+  Fpx3d_E_Result result;
+};
+
+struct _obj_context {
+  struct _obj_chunk *chunks;
+  size_t chunkCount;
+
+  size_t positionCount;
+  size_t texcoordCount;
+  size_t normalCount;
+  size_t cornerCount;
+
+  // concatenated from all chunks
+  float *positions;
+  float *texcoords;
+  float *normals;
+
+  // output of vertex deduplication
+  struct _obj_corner *vertices;
+  size_t vertexCount;
+
+  Fpx3d_Model_Mesh *mesh;
+};
+
+extern size_t __fpx3d_cpu_count(void);
+extern Fpx3d_E_Result __fpx3d_parallel_for(size_t count, size_t thread_count,
+                                           void (*function)(void *, size_t),
+                                           void *context);
+
+extern Fpx3d_E_Result __fpx3d_map_file(const char *path,
+                                       const uint8_t **output,
+                                       size_t *output_size);
+extern void __fpx3d_unmap_file(const uint8_t *data, size_t size);
+
+// static declarations ----
+
+static void *_array_push(struct _obj_array *, size_t element_size,
+                         size_t amount);
+
+static const char *_find_newline(const char *p, const char *end);
+static const char *_skip_blank(const char *p, const char *end);
+static const char *_keyword(const char *line, const char *end,
+                            const char *keyword);
+
+static bool _parse_float(const char **cursor, const char *end, float *output);
+static bool _parse_int(const char **cursor, const char *end, int64_t *output);
+
+static Fpx3d_E_Result _parse_chunk(struct _obj_chunk *);
+static Fpx3d_E_Result _parse_floats(struct _obj_array *, const char *p,
+                                    const char *end, size_t required,
+                                    size_t total);
+static Fpx3d_E_Result _parse_face(struct _obj_chunk *, const char *p,
+                                  const char *end);
+
+static void _parse_chunk_job(void *context, size_t index);
+static void _resolve_chunk_job(void *context, size_t index);
+static void _fill_vertices_job(void *context, size_t index);
+
+static size_t _hash_corner(const struct _obj_corner *);
+static Fpx3d_E_Result _deduplicate(struct _obj_context *, uint32_t *indices);
+
+static Fpx3d_E_Result _add_submeshes(struct _obj_context *);
+
+static void _destroy_context(struct _obj_context *);
+
+// end of static declarations ----
+
+Fpx3d_E_Result fpx3d_model_read_obj(const char *data, size_t length,
+                                    const struct fpx3d_model_obj_options *opts,
+                                    Fpx3d_Model_Mesh *output) {
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_model_obj_options options = {0};
+  if (NULL != opts)
+    options = *opts;
+
+  size_t threads =
+      (0 < options.threadCount) ? options.threadCount : __fpx3d_cpu_count();
+
+  struct _obj_context ctx = {0};
+
+  ctx.chunkCount = MIN(threads * CHUNKS_PER_THREAD, length / CHUNK_MIN_SIZE);
+  ctx.chunkCount = MAX(ctx.chunkCount, (size_t)1);
+
+  ctx.chunks = (struct _obj_chunk *)calloc(ctx.chunkCount, sizeof(*ctx.chunks));
+  if (NULL == ctx.chunks) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  // split on line boundaries
+  const char *end = data + length;
+  const char *begin = data;
+  for (size_t i = 0; i < ctx.chunkCount; ++i) {
+    const char *split = data + (length / ctx.chunkCount) * (i + 1);
+
+    if (i + 1 == ctx.chunkCount || split >= end) {
+      split = end;
+    } else if (split > begin) {
+      const char *newline = _find_newline(split - 1, end);
+      split = (newline < end) ? newline + 1 : end;
+    } else {
+      split = begin;
+    }
+
+    ctx.chunks[i].begin = begin;
+    ctx.chunks[i].end = split;
+
+    begin = split;
+  }
+
+#define READ_FAIL(retval)                                                      \
+  {                                                                            \
+    Fpx3d_E_Result fail_res = retval;                                          \
+    _destroy_context(&ctx);                                                    \
+    return fail_res;                                                           \
+  }
+
+  __fpx3d_parallel_for(ctx.chunkCount, threads, _parse_chunk_job, &ctx);
+
+  for (size_t i = 0; i < ctx.chunkCount; ++i) {
+    struct _obj_chunk *chunk = &ctx.chunks[i];
+
+    if (FPX3D_SUCCESS != chunk->result)
+      READ_FAIL(chunk->result);
+
+    chunk->positionBase = ctx.positionCount;
+    chunk->texcoordBase = ctx.texcoordCount;
+    chunk->normalBase = ctx.normalCount;
+    chunk->cornerBase = ctx.cornerCount;
+
+    ctx.positionCount += chunk->positions.count;
+    ctx.texcoordCount += chunk->texcoords.count;
+    ctx.normalCount += chunk->normals.count;
+    ctx.cornerCount += chunk->corners.count;
+  }
+
+  if (1 > ctx.positionCount || INT32_MAX < ctx.positionCount ||
+      INT32_MAX < ctx.texcoordCount || INT32_MAX < ctx.normalCount)
+    READ_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+  ctx.positions = (float *)malloc(ctx.positionCount * 3 * sizeof(float));
+  ctx.texcoords = (float *)malloc(MAX(ctx.texcoordCount * 2, (size_t)1) *
+                                  sizeof(float));
+  ctx.normals =
+      (float *)malloc(MAX(ctx.normalCount * 3, (size_t)1) * sizeof(float));
+
+  if (NULL == ctx.positions || NULL == ctx.texcoords || NULL == ctx.normals) {
+    perror("malloc()");
+    READ_FAIL(FPX3D_MEMORY_ERROR);
+  }
+
+  __fpx3d_parallel_for(ctx.chunkCount, threads, _resolve_chunk_job, &ctx);
+
+  for (size_t i = 0; i < ctx.chunkCount; ++i) {
+    if (FPX3D_SUCCESS != ctx.chunks[i].result)
+      READ_FAIL(ctx.chunks[i].result);
+  }
+
+  uint32_t *indices = NULL;
+
+  if (0 < ctx.cornerCount) {
+    indices = (uint32_t *)malloc(ctx.cornerCount * sizeof(uint32_t));
+    if (NULL == indices) {
+      perror("malloc()");
+      READ_FAIL(FPX3D_MEMORY_ERROR);
+    }
+  }
+
+  FPX3D_ONFAIL(_deduplicate(&ctx, indices), dedup_res, {
+    FREE_SAFE(indices);
+    READ_FAIL(dedup_res);
+  });
+
+  struct fpx3d_model_mesh_stream_info infos[3] = {
+      {
+          .semantic = FPX3D_MODEL_SEMANTIC_POSITION,
+          .format = FPX3D_MODEL_FORMAT_FLOAT32,
+          .componentCount = 3,
+      },
+  };
+  size_t info_count = 1;
+
+  if (0 < ctx.texcoordCount) {
+    infos[info_count++] = (struct fpx3d_model_mesh_stream_info){
+        .semantic = FPX3D_MODEL_SEMANTIC_TEXCOORD,
+        .format = FPX3D_MODEL_FORMAT_FLOAT32,
+        .componentCount = 2,
+    };
+  }
+
+  if (0 < ctx.normalCount) {
+    infos[info_count++] = (struct fpx3d_model_mesh_stream_info){
+        .semantic = FPX3D_MODEL_SEMANTIC_NORMAL,
+        .format = FPX3D_MODEL_FORMAT_FLOAT32,
+        .componentCount = 3,
+    };
+  }
+
+  Fpx3d_Model_Mesh new_mesh = {0};
+  ctx.mesh = &new_mesh;
+
+  FPX3D_ONFAIL(fpx3d_model_create_mesh(&new_mesh, options.layout,
+                                       ctx.vertexCount, infos, info_count),
+               create_res, {
+                 FREE_SAFE(indices);
+                 READ_FAIL(create_res);
+               });
+
+#undef READ_FAIL
+#define READ_FAIL(retval)                                                      \
+  {                                                                            \
+    Fpx3d_E_Result fail_res = retval;                                          \
+    FREE_SAFE(indices);                                                        \
+    fpx3d_model_destroy_mesh(&new_mesh);                                       \
+    _destroy_context(&ctx);                                                    \
+    return fail_res;                                                           \
+  }
+
+  __fpx3d_parallel_for((ctx.vertexCount + VERTEX_JOB_SIZE - 1) /
+                           VERTEX_JOB_SIZE,
+                       threads, _fill_vertices_job, &ctx);
+
+  FPX3D_ONFAIL(
+      fpx3d_model_mesh_set_indices(&new_mesh, indices, ctx.cornerCount),
+      idx_res, READ_FAIL(idx_res));
+
+  FREE_SAFE(indices);
+
+  if (0 < ctx.cornerCount)
+    FPX3D_ONFAIL(_add_submeshes(&ctx), sub_res, READ_FAIL(sub_res));
+
+  // without submeshes (point clouds) this takes every vertex into account
+  fpx3d_model_mesh_compute_bounds(&new_mesh);
+
+#undef READ_FAIL
+
+  FPX3D_DEBUG("Read OBJ: %" LONG_FORMAT "u vertices, %" LONG_FORMAT
+              "u triangles, %" LONG_FORMAT "u chunk(s)",
+              new_mesh.vertexCount, ctx.cornerCount / 3, ctx.chunkCount);
+
+  _destroy_context(&ctx);
+
+  *output = new_mesh;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_model_load_obj(const char *path,
+                                    const struct fpx3d_model_obj_options *opts,
+                                    Fpx3d_Model_Mesh *output) {
+  NULL_CHECK(path, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  const uint8_t *data = NULL;
+  size_t length = 0;
+
+  Fpx3d_E_Result map_res = __fpx3d_map_file(path, &data, &length);
+  if (FPX3D_SUCCESS != map_res)
+    return map_res;
+
+  Fpx3d_E_Result res =
+      fpx3d_model_read_obj((const char *)data, length, opts, output);
+
+  __fpx3d_unmap_file(data, length);
+
+  return res;
+}
+
+// STATIC FUNCTIONS ----
+
+static void *_array_push(struct _obj_array *arr, size_t element_size,
+                         size_t amount) {
+  if (arr->count + amount > arr->capacity) {
+    size_t new_capacity = MAX(arr->capacity * 2, (size_t)1024);
+    new_capacity = MAX(new_capacity, arr->count + amount);
+
+    void *new_data = realloc(arr->data, new_capacity * element_size);
+    if (NULL == new_data) {
+      perror("realloc()");
+      return NULL;
+    }
+
+    arr->data = new_data;
+    arr->capacity = new_capacity;
+  }
+
+  void *slot = (uint8_t *)arr->data + (arr->count * element_size);
+  arr->count += amount;
+
+  return slot;
+}
+
+static const char *_find_newline(const char *p, const char *end) {
+#ifdef __SSE2__
+  const __m128i newline = _mm_set1_epi8('\n');
+
+  while (end - p >= 16) {
+    __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, newline));
+
+    if (0 != mask)
+      return p + __builtin_ctz((unsigned int)mask);
+
+    p += 16;
+  }
+#endif
+
+  const char *found = (const char *)memchr(p, '\n', (size_t)(end - p));
+  return (NULL != found) ? found : end;
+}
+
+static const char *_skip_blank(const char *p, const char *end) {
+  while (p < end && (' ' == *p || '\t' == *p || '\r' == *p))
+    ++p;
+
+  return p;
+}
+
+// returns a pointer past `keyword` if the line starts with it
+static const char *_keyword(const char *line, const char *end,
+                            const char *keyword) {
+  size_t len = strlen(keyword);
+
+  if ((size_t)(end - line) < len || 0 != memcmp(line, keyword, len))
+    return NULL;
+
+  line += len;
+
+  if (line < end && ' ' != *line && '\t' != *line && '\r' != *line)
+    return NULL;
+
+  return line;
+}
+
+static bool _parse_float(const char **cursor, const char *end, float *output) {
+  static const double powers_of_ten[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+  };
+
+  const char *s = *cursor;
+
+  bool negative = false;
+  if (s < end && ('-' == *s || '+' == *s)) {
+    negative = ('-' == *s);
+    ++s;
+  }
+
+  // up to 19 significant digits fit a uint64_t, the rest only moves the
+  // exponent
+  uint64_t mantissa = 0;
+  int32_t exponent = 0;
+  size_t digits = 0;
+  bool any_digits = false;
+
+  while (s < end && '0' <= *s && *s <= '9') {
+    any_digits = true;
+
+    if (digits < 19) {
+      mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+      digits += (0 != mantissa);
+    } else {
+      ++exponent;
+    }
+
+    ++s;
+  }
+
+  if (s < end && '.' == *s) {
+    ++s;
+
+    while (s < end && '0' <= *s && *s <= '9') {
+      any_digits = true;
+
+      if (digits < 19) {
+        mantissa = mantissa * 10 + (uint64_t)(*s - '0');
+        digits += (0 != mantissa);
+        --exponent;
+      }
+
+      ++s;
+    }
+  }
+
+  if (false == any_digits) {
+    // nan, inf and friends. Rare enough to hand off to strtof()
+    char buffer[32] = {0};
+    size_t len = MIN((size_t)(end - *cursor), sizeof(buffer) - 1);
+    memcpy(buffer, *cursor, len);
+
+    char *parsed_end = NULL;
+    float value = strtof(buffer, &parsed_end);
+    if (parsed_end == buffer)
+      return false;
+
+    *output = value;
+    *cursor += parsed_end - buffer;
+    return true;
+  }
+
+  if (s < end && ('e' == *s || 'E' == *s)) {
+    const char *e = s + 1;
+
+    bool exp_negative = false;
+    if (e < end && ('-' == *e || '+' == *e)) {
+      exp_negative = ('-' == *e);
+      ++e;
+    }
+
+    if (e < end && '0' <= *e && *e <= '9') {
+      int32_t exp_value = 0;
+
+      while (e < end && '0' <= *e && *e <= '9') {
+        if (exp_value < 100000)
+          exp_value = exp_value * 10 + (*e - '0');
+        ++e;
+      }
+
+      exponent += exp_negative ? -exp_value : exp_value;
+      s = e;
+    }
+  }
+
+  double value = (double)mantissa;
+
+  if (0 != mantissa && 0 != exponent) {
+    if (-22 <= exponent && exponent < 0)
+      value /= powers_of_ten[-exponent];
+    else if (0 < exponent && exponent <= 22)
+      value *= powers_of_ten[exponent];
+    else
+      value *= pow(10.0, (double)exponent);
+  }
+
+  *output = (float)(negative ? -value : value);
+  *cursor = s;
+
+  return true;
+}
+
+static bool _parse_int(const char **cursor, const char *end, int64_t *output) {
+  const char *s = *cursor;
+
+  bool negative = false;
+  if (s < end && ('-' == *s || '+' == *s)) {
+    negative = ('-' == *s);
+    ++s;
+  }
+
+  if (s >= end || *s < '0' || '9' < *s)
+    return false;
+
+  int64_t value = 0;
+  while (s < end && '0' <= *s && *s <= '9') {
+    if (value <= INT32_MAX)
+      value = value * 10 + (*s - '0');
+    ++s;
+  }
+
+  *output = negative ? -value : value;
+  *cursor = s;
+
+  return true;
+}
+
+static Fpx3d_E_Result _parse_chunk(struct _obj_chunk *chunk) {
+  const char *p = chunk->begin;
+
+  while (p < chunk->end) {
+    const char *eol = _find_newline(p, chunk->end);
+    const char *line = _skip_blank(p, eol);
+    const char *rest = NULL;
+
+    Fpx3d_E_Result res = FPX3D_SUCCESS;
+
+    if (line >= eol || '#' == *line) {
+      // empty or comment
+    } else if (NULL != (rest = _keyword(line, eol, "v"))) {
+      res = _parse_floats(&chunk->positions, rest, eol, 3, 3);
+    } else if (NULL != (rest = _keyword(line, eol, "vt"))) {
+      res = _parse_floats(&chunk->texcoords, rest, eol, 1, 2);
+    } else if (NULL != (rest = _keyword(line, eol, "vn"))) {
+      res = _parse_floats(&chunk->normals, rest, eol, 3, 3);
+    } else if (NULL != (rest = _keyword(line, eol, "f"))) {
+      res = _parse_face(chunk, rest, eol);
+    } else if (NULL != (rest = _keyword(line, eol, "usemtl"))) {
+      struct _obj_group *group = (struct _obj_group *)_array_push(
+          &chunk->groups, sizeof(*group), 1);
+      if (NULL == group)
+        return FPX3D_MEMORY_ERROR;
+
+      const char *name = _skip_blank(rest, eol);
+      const char *name_end = eol;
+      while (name_end > name &&
+             (' ' == name_end[-1] || '\t' == name_end[-1] ||
+              '\r' == name_end[-1]))
+        --name_end;
+
+      group->firstCorner = chunk->corners.count;
+      group->name = name;
+      group->nameLength = (size_t)(name_end - name);
+    }
+    // anything else (o, g, s, l, mtllib, ...) doesn't affect the geometry
+
+    if (FPX3D_SUCCESS != res)
+      return res;
+
+    p = (eol < chunk->end) ? eol + 1 : eol;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+// reads `total` floats, of which the first `required` have to be present.
+// Missing optional values are 0
+static Fpx3d_E_Result _parse_floats(struct _obj_array *arr, const char *p,
+                                    const char *end, size_t required,
+                                    size_t total) {
+  float *out = (float *)_array_push(arr, total * sizeof(float), 1);
+  if (NULL == out)
+    return FPX3D_MEMORY_ERROR;
+
+  for (size_t i = 0; i < total; ++i) {
+    p = _skip_blank(p, end);
+
+    if (p >= end || '#' == *p) {
+      if (i < required)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      out[i] = 0.0f;
+      continue;
+    }
+
+    if (false == _parse_float(&p, end, &out[i]))
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _parse_face(struct _obj_chunk *chunk, const char *p,
+                                  const char *end) {
+  struct _obj_corner first = {0}, previous = {0};
+  size_t corner_count = 0;
+
+  for (;;) {
+    p = _skip_blank(p, end);
+    if (p >= end || '#' == *p)
+      break;
+
+    struct _obj_corner corner = {
+        .v = INDEX_MISSING,
+        .t = INDEX_MISSING,
+        .n = INDEX_MISSING,
+    };
+
+    // v, v/vt, v//vn or v/vt/vn
+    int32_t *targets[3] = {&corner.v, &corner.t, &corner.n};
+    size_t counts[3] = {chunk->positions.count, chunk->texcoords.count,
+                        chunk->normals.count};
+
+    for (size_t i = 0; i < 3; ++i) {
+      if (0 < i) {
+        if (p >= end || '/' != *p)
+          break;
+        ++p;
+
+        // empty slot, as in v//vn
+        if (p < end && '/' == *p)
+          continue;
+      }
+
+      int64_t value = 0;
+      if (false == _parse_int(&p, end, &value) || 0 == value)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      if (0 < value) {
+        value -= 1;
+      } else {
+        // relative to what this chunk has seen so far, the chunk's base
+        // gets added once all chunks are done
+        value += (int64_t)counts[i];
+        corner.relative |= (uint8_t)(1 << i);
+      }
+
+      if (INT32_MAX < value || -INT32_MAX > value)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      *targets[i] = (int32_t)value;
+    }
+
+    if (0 == corner_count)
+      first = corner;
+
+    if (2 <= corner_count) {
+      struct _obj_corner *tri = (struct _obj_corner *)_array_push(
+          &chunk->corners, sizeof(*tri), 3);
+      if (NULL == tri)
+        return FPX3D_MEMORY_ERROR;
+
+      tri[0] = first;
+      tri[1] = previous;
+      tri[2] = corner;
+    }
+
+    previous = corner;
+    ++corner_count;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+static void _parse_chunk_job(void *context, size_t index) {
+  struct _obj_context *ctx = (struct _obj_context *)context;
+
+  ctx->chunks[index].result = _parse_chunk(&ctx->chunks[index]);
+}
+
+// turns chunk-relative indices into absolute ones, validates them and
+// copies the chunk's attributes into the concatenated arrays
+static void _resolve_chunk_job(void *context, size_t index) {
+  struct _obj_context *ctx = (struct _obj_context *)context;
+  struct _obj_chunk *chunk = &ctx->chunks[index];
+
+  if (0 < chunk->positions.count)
+    memcpy(&ctx->positions[chunk->positionBase * 3], chunk->positions.data,
+           chunk->positions.count * 3 * sizeof(float));
+  if (0 < chunk->texcoords.count)
+    memcpy(&ctx->texcoords[chunk->texcoordBase * 2], chunk->texcoords.data,
+           chunk->texcoords.count * 2 * sizeof(float));
+  if (0 < chunk->normals.count)
+    memcpy(&ctx->normals[chunk->normalBase * 3], chunk->normals.data,
+           chunk->normals.count * 3 * sizeof(float));
+
+  struct _obj_corner *corners = (struct _obj_corner *)chunk->corners.data;
+
+  for (size_t i = 0; i < chunk->corners.count; ++i) {
+    struct _obj_corner *c = &corners[i];
+
+    if (c->relative & RELATIVE_POSITION)
+      c->v += (int32_t)chunk->positionBase;
+    if (c->relative & RELATIVE_TEXCOORD)
+      c->t += (int32_t)chunk->texcoordBase;
+    if (c->relative & RELATIVE_NORMAL)
+      c->n += (int32_t)chunk->normalBase;
+
+    c->relative = 0;
+
+    bool valid = (0 <= c->v && (size_t)c->v < ctx->positionCount);
+    valid = valid && (INDEX_MISSING == c->t ||
+                      (0 <= c->t && (size_t)c->t < ctx->texcoordCount));
+    valid = valid && (INDEX_MISSING == c->n ||
+                      (0 <= c->n && (size_t)c->n < ctx->normalCount));
+
+    if (false == valid) {
+      chunk->result = FPX3D_MODEL_INVALID_FILE_ERROR;
+      return;
+    }
+  }
+}
+
+static void _fill_vertices_job(void *context, size_t index) {
+  struct _obj_context *ctx = (struct _obj_context *)context;
+  Fpx3d_Model_Mesh *mesh = ctx->mesh;
+
+  size_t first = index * VERTEX_JOB_SIZE;
+  size_t last = MIN(first + VERTEX_JOB_SIZE, ctx->vertexCount);
+
+  struct fpx3d_model_mesh_stream *pos_stream =
+      fpx3d_model_mesh_get_stream(mesh, FPX3D_MODEL_SEMANTIC_POSITION, 0);
+  struct fpx3d_model_mesh_stream *uv_stream =
+      fpx3d_model_mesh_get_stream(mesh, FPX3D_MODEL_SEMANTIC_TEXCOORD, 0);
+  struct fpx3d_model_mesh_stream *normal_stream =
+      fpx3d_model_mesh_get_stream(mesh, FPX3D_MODEL_SEMANTIC_NORMAL, 0);
+
+  for (size_t i = first; i < last; ++i) {
+    // without deduplication, vertex i simply is position i
+    struct _obj_corner c = {.v = (int32_t)i,
+                            .t = INDEX_MISSING,
+                            .n = INDEX_MISSING};
+    if (NULL != ctx->vertices)
+      c = ctx->vertices[i];
+
+    memcpy(fpx3d_model_mesh_stream_element(mesh, pos_stream, i),
+           &ctx->positions[(size_t)c.v * 3], 3 * sizeof(float));
+
+    if (NULL != uv_stream) {
+      float *uv = (float *)fpx3d_model_mesh_stream_element(mesh, uv_stream, i);
+
+      if (INDEX_MISSING != c.t) {
+        uv[0] = ctx->texcoords[(size_t)c.t * 2];
+        uv[1] = 1.0f - ctx->texcoords[(size_t)c.t * 2 + 1];
+      }
+    }
+
+    if (NULL != normal_stream && INDEX_MISSING != c.n)
+      memcpy(fpx3d_model_mesh_stream_element(mesh, normal_stream, i),
+             &ctx->normals[(size_t)c.n * 3], 3 * sizeof(float));
+  }
+}
+
+static size_t _hash_corner(const struct _obj_corner *c) {
+  uint64_t h = (uint64_t)(uint32_t)c->v * 0x9E3779B97F4A7C15ull;
+  h ^= (((uint64_t)(uint32_t)c->t << 32) | (uint32_t)c->n) *
+       0xC2B2AE3D27D4EB4Full;
+  h ^= h >> 29;
+
+  return (size_t)h;
+}
+
+// assigns every unique corner a vertex and writes the vertex of every corner
+// to `indices`. Without texture coordinates and normals there is nothing to
+// deduplicate, so positions map onto vertices 1:1
+static Fpx3d_E_Result _deduplicate(struct _obj_context *ctx,
+                                   uint32_t *indices) {
+  if (0 == ctx->texcoordCount && 0 == ctx->normalCount) {
+    ctx->vertexCount = ctx->positionCount;
+
+    for (size_t i = 0; i < ctx->chunkCount; ++i) {
+      struct _obj_chunk *chunk = &ctx->chunks[i];
+      struct _obj_corner *corners = (struct _obj_corner *)chunk->corners.data;
+
+      for (size_t c = 0; c < chunk->corners.count; ++c)
+        indices[chunk->cornerBase + c] = (uint32_t)corners[c].v;
+    }
+
+    return FPX3D_SUCCESS;
+  }
+
+  if (0 == ctx->cornerCount) {
+    // texcoords and normals are meaningless without faces
+    ctx->vertexCount = ctx->positionCount;
+    ctx->texcoordCount = 0;
+    ctx->normalCount = 0;
+    return FPX3D_SUCCESS;
+  }
+
+  // keep the load factor at or below 0.5
+  size_t table_size = 1024;
+  while (table_size < ctx->positionCount * 2)
+    table_size *= 2;
+
+  uint32_t *table = (uint32_t *)malloc(table_size * sizeof(uint32_t));
+  struct _obj_array vertices = {0};
+
+  if (NULL == table) {
+    perror("malloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  memset(table, 0xFF, table_size * sizeof(uint32_t));
+
+  for (size_t i = 0; i < ctx->chunkCount; ++i) {
+    struct _obj_chunk *chunk = &ctx->chunks[i];
+    struct _obj_corner *corners = (struct _obj_corner *)chunk->corners.data;
+
+    for (size_t c = 0; c < chunk->corners.count; ++c) {
+      const struct _obj_corner *corner = &corners[c];
+      struct _obj_corner *known = (struct _obj_corner *)vertices.data;
+
+      size_t mask = table_size - 1;
+      size_t slot = _hash_corner(corner) & mask;
+
+      while (UINT32_MAX != table[slot]) {
+        const struct _obj_corner *k = &known[table[slot]];
+        if (k->v == corner->v && k->t == corner->t && k->n == corner->n)
+          break;
+
+        slot = (slot + 1) & mask;
+      }
+
+      if (UINT32_MAX == table[slot]) {
+        if (UINT32_MAX - 1 <= vertices.count) {
+          FREE_SAFE(table);
+          FREE_SAFE(vertices.data);
+          return FPX3D_MODEL_INVALID_FILE_ERROR;
+        }
+
+        struct _obj_corner *new_vertex = (struct _obj_corner *)_array_push(
+            &vertices, sizeof(*new_vertex), 1);
+        if (NULL == new_vertex) {
+          FREE_SAFE(table);
+          FREE_SAFE(vertices.data);
+          return FPX3D_MEMORY_ERROR;
+        }
+
+        *new_vertex = *corner;
+        table[slot] = (uint32_t)(vertices.count - 1);
+
+        if (vertices.count * 2 > table_size) {
+          size_t new_size = table_size * 2;
+          uint32_t *new_table =
+              (uint32_t *)malloc(new_size * sizeof(uint32_t));
+          if (NULL == new_table) {
+            perror("malloc()");
+            FREE_SAFE(table);
+            FREE_SAFE(vertices.data);
+            return FPX3D_MEMORY_ERROR;
+          }
+
+          memset(new_table, 0xFF, new_size * sizeof(uint32_t));
+
+          known = (struct _obj_corner *)vertices.data;
+          for (size_t v = 0; v < vertices.count; ++v) {
+            size_t s = _hash_corner(&known[v]) & (new_size - 1);
+            while (UINT32_MAX != new_table[s])
+              s = (s + 1) & (new_size - 1);
+
+            new_table[s] = (uint32_t)v;
+          }
+
+          FREE_SAFE(table);
+          table = new_table;
+          table_size = new_size;
+
+          indices[chunk->cornerBase + c] = (uint32_t)(vertices.count - 1);
+          continue;
+        }
+      }
+
+      indices[chunk->cornerBase + c] = table[slot];
+    }
+  }
+
+  FREE_SAFE(table);
+
+  ctx->vertices = (struct _obj_corner *)vertices.data;
+  ctx->vertexCount = vertices.count;
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _add_submeshes(struct _obj_context *ctx) {
+  struct {
+    const char *name;
+    size_t length;
+  } *names = NULL;
+  size_t name_count = 0, name_capacity = 0;
+
+  int32_t material = -1;
+  size_t first_corner = 0;
+
+  Fpx3d_E_Result res = FPX3D_SUCCESS;
+
+  for (size_t i = 0; i < ctx->chunkCount && FPX3D_SUCCESS == res; ++i) {
+    struct _obj_chunk *chunk = &ctx->chunks[i];
+    struct _obj_group *groups = (struct _obj_group *)chunk->groups.data;
+
+    for (size_t g = 0; g < chunk->groups.count; ++g) {
+      size_t corner = chunk->cornerBase + groups[g].firstCorner;
+
+      if (corner > first_corner) {
+        res = fpx3d_model_mesh_add_submesh(ctx->mesh, first_corner,
+                                           corner - first_corner, material);
+        if (FPX3D_SUCCESS != res)
+          break;
+      }
+
+      first_corner = corner;
+
+      size_t n = 0;
+      for (; n < name_count; ++n) {
+        if (names[n].length == groups[g].nameLength &&
+            0 == memcmp(names[n].name, groups[g].name, names[n].length))
+          break;
+      }
+
+      if (n == name_count) {
+        if (name_count == name_capacity) {
+          name_capacity = MAX(name_capacity * 2, (size_t)16);
+          void *new_names = realloc(names, name_capacity * sizeof(*names));
+          if (NULL == new_names) {
+            perror("realloc()");
+            res = FPX3D_MEMORY_ERROR;
+            break;
+          }
+
+          names = new_names;
+        }
+
+        names[name_count].name = groups[g].name;
+        names[name_count].length = groups[g].nameLength;
+        ++name_count;
+      }
+
+      material = (int32_t)n;
+    }
+  }
+
+  if (FPX3D_SUCCESS == res && ctx->cornerCount > first_corner)
+    res = fpx3d_model_mesh_add_submesh(ctx->mesh, first_corner,
+                                       ctx->cornerCount - first_corner,
+                                       material);
+
+  FREE_SAFE(names);
+
+  return res;
+}
+
+static void _destroy_context(struct _obj_context *ctx) {
+  for (size_t i = 0; i < ctx->chunkCount; ++i) {
+    FREE_SAFE(ctx->chunks[i].positions.data);
+    FREE_SAFE(ctx->chunks[i].texcoords.data);
+    FREE_SAFE(ctx->chunks[i].normals.data);
+    FREE_SAFE(ctx->chunks[i].corners.data);
+    FREE_SAFE(ctx->chunks[i].groups.data);
+  }
+
+  FREE_SAFE(ctx->chunks);
+  FREE_SAFE(ctx->positions);
+  FREE_SAFE(ctx->texcoords);
+  FREE_SAFE(ctx->normals);
+  FREE_SAFE(ctx->vertices);
+
+  memset(ctx, 0, sizeof(*ctx));
+}
+
+// END OF STATIC FUNCTIONS ----
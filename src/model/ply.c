@@ -0,0 +1,824 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#include "model/mesh.h"
+#include "model/ply.h"
+
+#define MAX_PLY_ELEMENTS 16
+#define MAX_PLY_PROPERTIES 32
+#define MAX_PLY_NAME_LENGTH 32
+
+// vertices are converted in blocks of this many per job
+#define VERTEX_JOB_SIZE 65536
+
+typedef enum {
+  PLY_TYPE_INVALID = 0,
+  PLY_TYPE_INT8,
+  PLY_TYPE_UINT8,
+  PLY_TYPE_INT16,
+  PLY_TYPE_UINT16,
+  PLY_TYPE_INT32,
+  PLY_TYPE_UINT32,
+  PLY_TYPE_FLOAT32,
+  PLY_TYPE_FLOAT64,
+} _ply_type;
+
+struct _ply_property {
+  char name[MAX_PLY_NAME_LENGTH];
+
+  _ply_type type;
+
+  bool isList;
+  _ply_type countType;
+
+  // inside a record, only valid for elements without list properties
+  size_t offset;
+};
+
+struct _ply_element {
+  char name[MAX_PLY_NAME_LENGTH];
+  size_t count;
+
+  struct _ply_property properties[MAX_PLY_PROPERTIES];
+  size_t propertyCount;
+
+  // 0 if any of the properties is a list
+  size_t recordSize;
+};
+
+struct _ply_header {
+  bool swapBytes;
+
+  struct _ply_element elements[MAX_PLY_ELEMENTS];
+  size_t elementCount;
+
+  size_t length;
+};
+
+// which property feeds which vertex component, -1 if absent
+struct _ply_vertex_map {
+  int position[3];
+  int normal[3];
+  int texcoord[2];
+  int color[4];
+};
+
+struct _ply_vertex_job {
+  const struct _ply_header *header;
+  const struct _ply_element *element;
+  const struct _ply_vertex_map *map;
+
+  const uint8_t *records;
+
+  Fpx3d_Model_Mesh *mesh;
+};
+
+extern Fpx3d_E_Result __fpx3d_parallel_for(size_t count, size_t thread_count,
+                                           void (*function)(void *, size_t),
+                                           void *context);
+
+extern Fpx3d_E_Result __fpx3d_map_file(const char *path,
+                                       const uint8_t **output,
+                                       size_t *output_size);
+extern void __fpx3d_unmap_file(const uint8_t *data, size_t size);
+
+// static declarations ----
+
+static size_t _type_size(_ply_type);
+static _ply_type _type_from_name(const char *name, size_t length);
+static double _read_value(const uint8_t *data, _ply_type, bool swap);
+
+static Fpx3d_E_Result _parse_header(const uint8_t *data, size_t length,
+                                    struct _ply_header *output);
+
+static int _find_property(const struct _ply_element *, const char *name);
+static void _map_vertex_properties(const struct _ply_element *,
+                                   struct _ply_vertex_map *output);
+
+static Fpx3d_E_Result _skip_element(const struct _ply_header *,
+                                    const struct _ply_element *,
+                                    const uint8_t **cursor,
+                                    const uint8_t *limit);
+
+static Fpx3d_E_Result _read_faces(const struct _ply_header *,
+                                  const struct _ply_element *,
+                                  size_t vertex_count, const uint8_t **cursor,
+                                  const uint8_t *limit, uint32_t **indices,
+                                  size_t *index_count);
+
+static void _convert_vertices_job(void *context, size_t index);
+
+// end of static declarations ----
+
+Fpx3d_E_Result fpx3d_model_read_ply(const uint8_t *data, size_t length,
+                                    Fpx3d_Model_E_MeshLayout layout,
+                                    Fpx3d_Model_Mesh *output) {
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  struct _ply_header header = {0};
+
+  Fpx3d_E_Result header_res = _parse_header(data, length, &header);
+  if (FPX3D_SUCCESS != header_res)
+    return header_res;
+
+  const struct _ply_element *vertex_element = NULL;
+  const struct _ply_element *face_element = NULL;
+
+  for (size_t i = 0; i < header.elementCount; ++i) {
+    const char *name = header.elements[i].name;
+
+    if (NULL == vertex_element && 0 == strcmp("vertex", name))
+      vertex_element = &header.elements[i];
+    else if (NULL == face_element && 0 == strcmp("face", name))
+      face_element = &header.elements[i];
+  }
+
+  if (NULL == vertex_element || 1 > vertex_element->count ||
+      0 == vertex_element->recordSize || UINT32_MAX < vertex_element->count)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  struct _ply_vertex_map map;
+  _map_vertex_properties(vertex_element, &map);
+
+  if (0 > map.position[0] || 0 > map.position[1] || 0 > map.position[2])
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  struct fpx3d_model_mesh_stream_info infos[4] = {
+      {
+          .semantic = FPX3D_MODEL_SEMANTIC_POSITION,
+          .format = FPX3D_MODEL_FORMAT_FLOAT32,
+          .componentCount = 3,
+      },
+  };
+  size_t info_count = 1;
+
+  if (0 <= map.normal[0] && 0 <= map.normal[1] && 0 <= map.normal[2]) {
+    infos[info_count++] = (struct fpx3d_model_mesh_stream_info){
+        .semantic = FPX3D_MODEL_SEMANTIC_NORMAL,
+        .format = FPX3D_MODEL_FORMAT_FLOAT32,
+        .componentCount = 3,
+    };
+  }
+
+  if (0 <= map.texcoord[0] && 0 <= map.texcoord[1]) {
+    infos[info_count++] = (struct fpx3d_model_mesh_stream_info){
+        .semantic = FPX3D_MODEL_SEMANTIC_TEXCOORD,
+        .format = FPX3D_MODEL_FORMAT_FLOAT32,
+        .componentCount = 2,
+    };
+  }
+
+  if (0 <= map.color[0] && 0 <= map.color[1] && 0 <= map.color[2]) {
+    infos[info_count++] = (struct fpx3d_model_mesh_stream_info){
+        .semantic = FPX3D_MODEL_SEMANTIC_COLOR,
+        .format = FPX3D_MODEL_FORMAT_UINT8,
+        .componentCount = 4,
+        .normalized = true,
+    };
+  }
+
+  Fpx3d_Model_Mesh new_mesh = {0};
+  uint32_t *indices = NULL;
+  size_t index_count = 0;
+
+#define READ_FAIL(retval)                                                      \
+  {                                                                            \
+    Fpx3d_E_Result fail_res = retval;                                          \
+    FREE_SAFE(indices);                                                        \
+    fpx3d_model_destroy_mesh(&new_mesh);                                       \
+    return fail_res;                                                           \
+  }
+
+  FPX3D_ONFAIL(fpx3d_model_create_mesh(&new_mesh, layout,
+                                       vertex_element->count, infos,
+                                       info_count),
+               create_res, READ_FAIL(create_res));
+
+  const uint8_t *cursor = data + header.length;
+  const uint8_t *limit = data + length;
+
+  for (size_t i = 0; i < header.elementCount; ++i) {
+    const struct _ply_element *element = &header.elements[i];
+
+    if (element == vertex_element) {
+      size_t bytes = element->count * element->recordSize;
+      if (bytes / element->recordSize != element->count ||
+          bytes > (size_t)(limit - cursor))
+        READ_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+      // records are fixed-size, so blocks can be converted independently
+      struct _ply_vertex_job job = {
+          .header = &header,
+          .element = element,
+          .map = &map,
+          .records = cursor,
+          .mesh = &new_mesh,
+      };
+
+      __fpx3d_parallel_for((element->count + VERTEX_JOB_SIZE - 1) /
+                               VERTEX_JOB_SIZE,
+                           0, _convert_vertices_job, &job);
+
+      cursor += bytes;
+    } else if (element == face_element) {
+      FPX3D_ONFAIL(_read_faces(&header, element, vertex_element->count,
+                               &cursor, limit, &indices, &index_count),
+                   face_res, READ_FAIL(face_res));
+    } else {
+      FPX3D_ONFAIL(_skip_element(&header, element, &cursor, limit), skip_res,
+                   READ_FAIL(skip_res));
+    }
+  }
+
+  if (0 < index_count) {
+    FPX3D_ONFAIL(fpx3d_model_mesh_set_indices(&new_mesh, indices, index_count),
+                 idx_res, READ_FAIL(idx_res));
+
+    FPX3D_ONFAIL(fpx3d_model_mesh_add_submesh(&new_mesh, 0, index_count, -1),
+                 sub_res, READ_FAIL(sub_res));
+  }
+
+  FREE_SAFE(indices);
+
+#undef READ_FAIL
+
+  // without submeshes (point clouds) this takes every vertex into account
+  fpx3d_model_mesh_compute_bounds(&new_mesh);
+
+  FPX3D_DEBUG("Read PLY: %" LONG_FORMAT "u vertices, %" LONG_FORMAT
+              "u triangles",
+              new_mesh.vertexCount, index_count / 3);
+
+  *output = new_mesh;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_model_load_ply(const char *path,
+                                    Fpx3d_Model_E_MeshLayout layout,
+                                    Fpx3d_Model_Mesh *output) {
+  NULL_CHECK(path, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  const uint8_t *data = NULL;
+  size_t length = 0;
+
+  Fpx3d_E_Result map_res = __fpx3d_map_file(path, &data, &length);
+  if (FPX3D_SUCCESS != map_res)
+    return map_res;
+
+  Fpx3d_E_Result res = fpx3d_model_read_ply(data, length, layout, output);
+
+  __fpx3d_unmap_file(data, length);
+
+  return res;
+}
+
+// STATIC FUNCTIONS ----
+
+static size_t _type_size(_ply_type type) {
+  switch (type) {
+  case PLY_TYPE_INT8:
+  case PLY_TYPE_UINT8:
+    return 1;
+  case PLY_TYPE_INT16:
+  case PLY_TYPE_UINT16:
+    return 2;
+  case PLY_TYPE_INT32:
+  case PLY_TYPE_UINT32:
+  case PLY_TYPE_FLOAT32:
+    return 4;
+  case PLY_TYPE_FLOAT64:
+    return 8;
+  default:
+    return 0;
+  }
+}
+
+static _ply_type _type_from_name(const char *name, size_t length) {
+  static const struct {
+    const char *name;
+    _ply_type type;
+  } names[] = {
+      {"char", PLY_TYPE_INT8},      {"int8", PLY_TYPE_INT8},
+      {"uchar", PLY_TYPE_UINT8},    {"uint8", PLY_TYPE_UINT8},
+      {"short", PLY_TYPE_INT16},    {"int16", PLY_TYPE_INT16},
+      {"ushort", PLY_TYPE_UINT16},  {"uint16", PLY_TYPE_UINT16},
+      {"int", PLY_TYPE_INT32},      {"int32", PLY_TYPE_INT32},
+      {"uint", PLY_TYPE_UINT32},    {"uint32", PLY_TYPE_UINT32},
+      {"float", PLY_TYPE_FLOAT32},  {"float32", PLY_TYPE_FLOAT32},
+      {"double", PLY_TYPE_FLOAT64}, {"float64", PLY_TYPE_FLOAT64},
+  };
+
+  for (size_t i = 0; i < ARRAY_SIZE(names); ++i) {
+    if (strlen(names[i].name) == length &&
+        0 == memcmp(names[i].name, name, length))
+      return names[i].type;
+  }
+
+  return PLY_TYPE_INVALID;
+}
+
+// reads straight from the (possibly unaligned) file data
+static double _read_value(const uint8_t *data, _ply_type type, bool swap) {
+  uint8_t bytes[8];
+  size_t size = _type_size(type);
+
+  if (swap) {
+    for (size_t i = 0; i < size; ++i)
+      bytes[i] = data[size - 1 - i];
+  } else {
+    memcpy(bytes, data, size);
+  }
+
+  switch (type) {
+  case PLY_TYPE_INT8:
+    return (double)(int8_t)bytes[0];
+  case PLY_TYPE_UINT8:
+    return (double)bytes[0];
+  case PLY_TYPE_INT16: {
+    int16_t v;
+    memcpy(&v, bytes, sizeof(v));
+    return (double)v;
+  }
+  case PLY_TYPE_UINT16: {
+    uint16_t v;
+    memcpy(&v, bytes, sizeof(v));
+    return (double)v;
+  }
+  case PLY_TYPE_INT32: {
+    int32_t v;
+    memcpy(&v, bytes, sizeof(v));
+    return (double)v;
+  }
+  case PLY_TYPE_UINT32: {
+    uint32_t v;
+    memcpy(&v, bytes, sizeof(v));
+    return (double)v;
+  }
+  case PLY_TYPE_FLOAT32: {
+    float v;
+    memcpy(&v, bytes, sizeof(v));
+    return (double)v;
+  }
+  case PLY_TYPE_FLOAT64: {
+    double v;
+    memcpy(&v, bytes, sizeof(v));
+    return v;
+  }
+  default:
+    return 0.0;
+  }
+}
+
+static Fpx3d_E_Result _parse_header(const uint8_t *data, size_t length,
+                                    struct _ply_header *output) {
+  const char *p = (const char *)data;
+  const char *end = p + length;
+
+  if (length < 4 || 0 != memcmp(p, "ply", 3) ||
+      ('\n' != p[3] && '\r' != p[3]))
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  const uint16_t endian_probe = 1;
+  bool host_little_endian = (1 == *(const uint8_t *)&endian_probe);
+
+  bool has_format = false;
+  struct _ply_element *element = NULL;
+
+  while (p < end) {
+    const char *eol = (const char *)memchr(p, '\n', (size_t)(end - p));
+    if (NULL == eol)
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+    // split the line into at most 5 words
+    const char *words[5] = {0};
+    size_t lengths[5] = {0};
+    size_t word_count = 0;
+
+    for (const char *w = p; w < eol && word_count < ARRAY_SIZE(words);) {
+      while (w < eol && (' ' == *w || '\t' == *w || '\r' == *w))
+        ++w;
+
+      const char *w_end = w;
+      while (w_end < eol && ' ' != *w_end && '\t' != *w_end &&
+             '\r' != *w_end)
+        ++w_end;
+
+      if (w_end > w) {
+        words[word_count] = w;
+        lengths[word_count] = (size_t)(w_end - w);
+        ++word_count;
+      }
+
+      w = w_end;
+    }
+
+    p = eol + 1;
+
+#define WORD_IS(i, str)                                                        \
+  (lengths[i] == sizeof(str) - 1 && 0 == memcmp(words[i], str, lengths[i]))
+
+    if (0 == word_count)
+      continue;
+
+    if (WORD_IS(0, "end_header")) {
+      if (false == has_format)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      // records of elements without lists all have the same layout
+      for (size_t i = 0; i < output->elementCount; ++i) {
+        struct _ply_element *e = &output->elements[i];
+
+        size_t offset = 0;
+        for (size_t j = 0; j < e->propertyCount; ++j) {
+          if (e->properties[j].isList) {
+            offset = 0;
+            break;
+          }
+
+          e->properties[j].offset = offset;
+          offset += _type_size(e->properties[j].type);
+        }
+
+        e->recordSize = offset;
+      }
+
+      output->length = (size_t)(p - (const char *)data);
+      return FPX3D_SUCCESS;
+    }
+
+    if (WORD_IS(0, "format") && 2 <= word_count) {
+      if (WORD_IS(1, "binary_little_endian")) {
+        output->swapBytes = !host_little_endian;
+      } else if (WORD_IS(1, "binary_big_endian")) {
+        output->swapBytes = host_little_endian;
+      } else {
+        FPX3D_WARN("Only binary PLY files are supported");
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+      }
+
+      has_format = true;
+    } else if (WORD_IS(0, "element") && 3 <= word_count) {
+      if (MAX_PLY_ELEMENTS <= output->elementCount ||
+          MAX_PLY_NAME_LENGTH <= lengths[1])
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      element = &output->elements[output->elementCount++];
+      memcpy(element->name, words[1], lengths[1]);
+
+      char *count_end = NULL;
+      char count_str[24] = {0};
+      memcpy(count_str, words[2], MIN(lengths[2], sizeof(count_str) - 1));
+      element->count = (size_t)strtoull(count_str, &count_end, 10);
+
+      if (count_end != count_str + lengths[2])
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+    } else if (WORD_IS(0, "property") && 3 <= word_count) {
+      if (NULL == element || MAX_PLY_PROPERTIES <= element->propertyCount)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      struct _ply_property *prop =
+          &element->properties[element->propertyCount++];
+
+      const char *name = words[2];
+      size_t name_length = lengths[2];
+
+      if (WORD_IS(1, "list")) {
+        if (5 > word_count)
+          return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+        prop->isList = true;
+        prop->countType = _type_from_name(words[2], lengths[2]);
+        prop->type = _type_from_name(words[3], lengths[3]);
+
+        if (PLY_TYPE_INVALID == prop->countType ||
+            PLY_TYPE_FLOAT32 == prop->countType ||
+            PLY_TYPE_FLOAT64 == prop->countType)
+          return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+        name = words[4];
+        name_length = lengths[4];
+      } else {
+        prop->type = _type_from_name(words[1], lengths[1]);
+      }
+
+      if (PLY_TYPE_INVALID == prop->type || MAX_PLY_NAME_LENGTH <= name_length)
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      memcpy(prop->name, name, name_length);
+    }
+    // comment, obj_info and unknown keywords are ignored
+
+#undef WORD_IS
+  }
+
+  // never found end_header
+  return FPX3D_MODEL_INVALID_FILE_ERROR;
+}
+
+static int _find_property(const struct _ply_element *element,
+                          const char *name) {
+  for (size_t i = 0; i < element->propertyCount; ++i) {
+    if (false == element->properties[i].isList &&
+        0 == strcmp(name, element->properties[i].name))
+      return (int)i;
+  }
+
+  return -1;
+}
+
+static void _map_vertex_properties(const struct _ply_element *element,
+                                   struct _ply_vertex_map *output) {
+  static const char *texcoord_names[][2] = {
+      {"u", "v"},
+      {"s", "t"},
+      {"texture_u", "texture_v"},
+      {"texture_s", "texture_t"},
+  };
+
+  output->position[0] = _find_property(element, "x");
+  output->position[1] = _find_property(element, "y");
+  output->position[2] = _find_property(element, "z");
+
+  output->normal[0] = _find_property(element, "nx");
+  output->normal[1] = _find_property(element, "ny");
+  output->normal[2] = _find_property(element, "nz");
+
+  output->texcoord[0] = output->texcoord[1] = -1;
+  for (size_t i = 0; i < ARRAY_SIZE(texcoord_names); ++i) {
+    int u = _find_property(element, texcoord_names[i][0]);
+    int v = _find_property(element, texcoord_names[i][1]);
+
+    if (0 <= u && 0 <= v) {
+      output->texcoord[0] = u;
+      output->texcoord[1] = v;
+      break;
+    }
+  }
+
+  output->color[0] = _find_property(element, "red");
+  output->color[1] = _find_property(element, "green");
+  output->color[2] = _find_property(element, "blue");
+  output->color[3] = _find_property(element, "alpha");
+
+  if (0 > output->color[0])
+    output->color[0] = _find_property(element, "diffuse_red");
+  if (0 > output->color[1])
+    output->color[1] = _find_property(element, "diffuse_green");
+  if (0 > output->color[2])
+    output->color[2] = _find_property(element, "diffuse_blue");
+}
+
+static Fpx3d_E_Result _skip_element(const struct _ply_header *header,
+                                    const struct _ply_element *element,
+                                    const uint8_t **cursor,
+                                    const uint8_t *limit) {
+  const uint8_t *p = *cursor;
+
+  if (0 < element->recordSize) {
+    size_t bytes = element->count * element->recordSize;
+    if (bytes / element->recordSize != element->count ||
+        bytes > (size_t)(limit - p))
+      return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+    *cursor = p + bytes;
+    return FPX3D_SUCCESS;
+  }
+
+  for (size_t i = 0; i < element->count; ++i) {
+    for (size_t j = 0; j < element->propertyCount; ++j) {
+      const struct _ply_property *prop = &element->properties[j];
+
+      size_t bytes = _type_size(prop->type);
+
+      if (prop->isList) {
+        size_t count_size = _type_size(prop->countType);
+        if (count_size > (size_t)(limit - p))
+          return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+        bytes *= (size_t)_read_value(p, prop->countType, header->swapBytes);
+        p += count_size;
+      }
+
+      if (bytes > (size_t)(limit - p))
+        return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+      p += bytes;
+    }
+  }
+
+  *cursor = p;
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _read_faces(const struct _ply_header *header,
+                                  const struct _ply_element *element,
+                                  size_t vertex_count, const uint8_t **cursor,
+                                  const uint8_t *limit, uint32_t **indices,
+                                  size_t *index_count) {
+  int list_index = -1;
+  for (size_t i = 0; i < element->propertyCount; ++i) {
+    const struct _ply_property *prop = &element->properties[i];
+
+    if (prop->isList && (0 == strcmp("vertex_indices", prop->name) ||
+                         0 == strcmp("vertex_index", prop->name))) {
+      list_index = (int)i;
+      break;
+    }
+  }
+
+  if (0 > list_index || 1 > element->count)
+    return _skip_element(header, element, cursor, limit);
+
+  // the count comes from the header; every face takes at least its list
+  // counts and its other properties, so the file has to have room for them
+  size_t face_min_size = 0;
+  for (size_t i = 0; i < element->propertyCount; ++i) {
+    const struct _ply_property *prop = &element->properties[i];
+
+    face_min_size += _type_size(prop->isList ? prop->countType : prop->type);
+  }
+
+  if (0 == face_min_size ||
+      element->count > (size_t)(limit - *cursor) / face_min_size ||
+      element->count > SIZE_MAX / (3 * sizeof(uint32_t)))
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  // most files only have triangles, grow if they don't
+  size_t capacity = element->count * 3;
+  size_t count = 0;
+
+  uint32_t *out = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+  if (NULL == out) {
+    perror("malloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  const uint8_t *p = *cursor;
+  bool swap = header->swapBytes;
+
+#define FACE_FAIL(retval)                                                      \
+  {                                                                            \
+    FREE_SAFE(out);                                                            \
+    return retval;                                                             \
+  }
+
+  for (size_t f = 0; f < element->count; ++f) {
+    for (size_t j = 0; j < element->propertyCount; ++j) {
+      const struct _ply_property *prop = &element->properties[j];
+
+      size_t value_size = _type_size(prop->type);
+      size_t values = 1;
+
+      if (prop->isList) {
+        size_t count_size = _type_size(prop->countType);
+        if (count_size > (size_t)(limit - p))
+          FACE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+        values = (size_t)_read_value(p, prop->countType, swap);
+        p += count_size;
+      }
+
+      if (values * value_size > (size_t)(limit - p))
+        FACE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+      if ((int)j == list_index && 3 <= values) {
+        size_t needed = count + (values - 2) * 3;
+
+        if (needed > capacity) {
+          capacity = MAX(capacity * 2, needed);
+          uint32_t *new_out =
+              (uint32_t *)realloc(out, capacity * sizeof(uint32_t));
+          if (NULL == new_out) {
+            perror("realloc()");
+            FACE_FAIL(FPX3D_MEMORY_ERROR);
+          }
+
+          out = new_out;
+        }
+
+        double first = _read_value(p, prop->type, swap);
+        double previous = _read_value(p + value_size, prop->type, swap);
+
+        for (size_t v = 2; v < values; ++v) {
+          double current = _read_value(p + v * value_size, prop->type, swap);
+
+          if (0.0 > first || 0.0 > previous || 0.0 > current ||
+              (double)vertex_count <= first ||
+              (double)vertex_count <= previous ||
+              (double)vertex_count <= current)
+            FACE_FAIL(FPX3D_MODEL_INVALID_FILE_ERROR);
+
+          out[count++] = (uint32_t)first;
+          out[count++] = (uint32_t)previous;
+          out[count++] = (uint32_t)current;
+
+          previous = current;
+        }
+      }
+
+      p += values * value_size;
+    }
+  }
+
+#undef FACE_FAIL
+
+  *cursor = p;
+
+  if (0 == count) {
+    FREE_SAFE(out);
+    return FPX3D_SUCCESS;
+  }
+
+  *indices = out;
+  *index_count = count;
+
+  return FPX3D_SUCCESS;
+}
+
+static void _convert_vertices_job(void *context, size_t index) {
+  struct _ply_vertex_job *job = (struct _ply_vertex_job *)context;
+
+  const struct _ply_element *element = job->element;
+  const struct _ply_property *props = element->properties;
+  const struct _ply_vertex_map *map = job->map;
+  Fpx3d_Model_Mesh *mesh = job->mesh;
+  bool swap = job->header->swapBytes;
+
+  struct fpx3d_model_mesh_stream *pos_stream =
+      fpx3d_model_mesh_get_stream(mesh, FPX3D_MODEL_SEMANTIC_POSITION, 0);
+  struct fpx3d_model_mesh_stream *normal_stream =
+      fpx3d_model_mesh_get_stream(mesh, FPX3D_MODEL_SEMANTIC_NORMAL, 0);
+  struct fpx3d_model_mesh_stream *uv_stream =
+      fpx3d_model_mesh_get_stream(mesh, FPX3D_MODEL_SEMANTIC_TEXCOORD, 0);
+  struct fpx3d_model_mesh_stream *color_stream =
+      fpx3d_model_mesh_get_stream(mesh, FPX3D_MODEL_SEMANTIC_COLOR, 0);
+
+#define READ_PROPERTY(record, prop_index)                                      \
+  _read_value(record + props[prop_index].offset, props[prop_index].type, swap)
+
+  size_t first = index * VERTEX_JOB_SIZE;
+  size_t last = MIN(first + VERTEX_JOB_SIZE, element->count);
+
+  for (size_t v = first; v < last; ++v) {
+    const uint8_t *record = job->records + v * element->recordSize;
+
+    float *pos = (float *)fpx3d_model_mesh_stream_element(mesh, pos_stream, v);
+    for (size_t i = 0; i < 3; ++i)
+      pos[i] = (float)READ_PROPERTY(record, map->position[i]);
+
+    if (NULL != normal_stream) {
+      float *normal =
+          (float *)fpx3d_model_mesh_stream_element(mesh, normal_stream, v);
+      for (size_t i = 0; i < 3; ++i)
+        normal[i] = (float)READ_PROPERTY(record, map->normal[i]);
+    }
+
+    if (NULL != uv_stream) {
+      float *uv = (float *)fpx3d_model_mesh_stream_element(mesh, uv_stream, v);
+
+      // v = 0 is the bottom of the image in PLY, the top in glTF
+      uv[0] = (float)READ_PROPERTY(record, map->texcoord[0]);
+      uv[1] = 1.0f - (float)READ_PROPERTY(record, map->texcoord[1]);
+    }
+
+    if (NULL != color_stream) {
+      uint8_t *color =
+          (uint8_t *)fpx3d_model_mesh_stream_element(mesh, color_stream, v);
+
+      for (size_t i = 0; i < 4; ++i) {
+        if (0 > map->color[i]) {
+          color[i] = UINT8_MAX;
+          continue;
+        }
+
+        double value = READ_PROPERTY(record, map->color[i]);
+
+        // float colors are 0..1, integer ones are taken as 0..255
+        _ply_type type = props[map->color[i]].type;
+        if (PLY_TYPE_FLOAT32 == type || PLY_TYPE_FLOAT64 == type)
+          value *= 255.0;
+
+        color[i] = (uint8_t)CLAMP(value + 0.5, 0.0, 255.0);
+      }
+    }
+  }
+
+#undef READ_PROPERTY
+}
+
+// END OF STATIC FUNCTIONS ----
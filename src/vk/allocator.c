@@ -0,0 +1,854 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+// Device memory sub-allocation. Every memory type gets large VkDeviceMemory
+// blocks, which are carved up with a two-level segregated fit (TLSF)
+// allocator: free ranges are binned by size class, so finding a range and
+// merging it with its neighbours on release both take constant time.
+// The ranges are bookkept on the host; device memory is never touched
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+#include "volk/volk.h"
+
+#include "vk/allocator.h"
+#include "vk/capabilities.h"
+#include "vk/logical_gpu.h"
+#include "vk/typedefs.h"
+#include "vk/utility.h"
+
+// every power of two is split into SL_COUNT size classes. Ranges below
+// SMALL_SIZE all share the first power of two
+#define SL_COUNT_LOG2 4
+#define SL_COUNT (1 << SL_COUNT_LOG2)
+#define MIN_ALIGNMENT_LOG2 4
+#define MIN_ALIGNMENT ((VkDeviceSize)1 << MIN_ALIGNMENT_LOG2)
+#define FL_SHIFT (SL_COUNT_LOG2 + MIN_ALIGNMENT_LOG2)
+#define SMALL_SIZE ((VkDeviceSize)1 << FL_SHIFT)
+#define FL_MAX_LOG2 31
+#define FL_COUNT (FL_MAX_LOG2 - FL_SHIFT + 2)
+
+// preferred size of new blocks, unless a heap is small enough for that to
+// be more than 1/BLOCK_HEAP_FRACTION of it. Resources bigger than half a
+// block get memory of their own
+#define BLOCK_SIZE ((VkDeviceSize)64 * 1024 * 1024)
+#define MIN_BLOCK_SIZE ((VkDeviceSize)1024 * 1024)
+#define BLOCK_HEAP_FRACTION 8
+
+#define ALIGN_TO(value, alignment)                                             \
+  (((value) + (alignment) - 1) & ~((VkDeviceSize)(alignment) - 1))
+
+// with a bufferImageGranularity above 1, linear resources (buffers and
+// linear images) and optimal images get separate blocks, so they can
+// never end up on the same granularity page
+enum { LINEAR_RESOURCES = 0, OPTIMAL_RESOURCES = 1, RESOURCE_KINDS = 2 };
+
+struct fpx3d_vk_memory_node {
+  VkDeviceSize offset;
+  VkDeviceSize size;
+  bool isFree;
+
+  // neighbouring ranges of the block
+  struct fpx3d_vk_memory_node *prevPhysical;
+  struct fpx3d_vk_memory_node *nextPhysical;
+
+  // other free ranges of the same size class
+  struct fpx3d_vk_memory_node *prevFree;
+  struct fpx3d_vk_memory_node *nextFree;
+};
+
+struct fpx3d_vk_memory_block {
+  VkDeviceMemory memory;
+  VkDeviceSize size;
+  void *mapped;
+
+  uint32_t memoryType;
+  VkMemoryPropertyFlags propertyFlags;
+  size_t kind;
+
+  size_t allocationCount;
+
+  // the range at offset 0, which is never merged away
+  struct fpx3d_vk_memory_node *first;
+
+  // bit `fl` is set if any of slBitmaps[fl] is; bit `sl` of slBitmaps[fl]
+  // is set if freeLists[fl][sl] has a range in it
+  uint32_t flBitmap;
+  uint32_t slBitmaps[FL_COUNT];
+  struct fpx3d_vk_memory_node *freeLists[FL_COUNT][SL_COUNT];
+
+  struct fpx3d_vk_memory_block *next;
+};
+
+struct fpx3d_vk_allocator {
+  pthread_mutex_t lock;
+
+  VkPhysicalDeviceMemoryProperties memoryProperties;
+  VkMemoryPropertyFlags unsupportedFlags;
+  VkDeviceSize granularity;
+  VkDeviceSize nonCoherentAtomSize;
+
+  VkDeviceSize blockSizes[VK_MAX_MEMORY_HEAPS];
+  struct fpx3d_vk_memory_block *blocks[VK_MAX_MEMORY_TYPES][RESOURCE_KINDS];
+
+  Fpx3d_Vk_AllocatorStats stats;
+};
+
+// static declarations ----
+
+static VkMemoryPropertyFlags _unsupported_flags(VkPhysicalDevice);
+static int _memory_type(const VkPhysicalDeviceMemoryProperties *,
+                        VkMemoryPropertyFlags unsupported,
+                        VkMemoryPropertyFlags wanted,
+                        VkMemoryPropertyFlags preferred, uint32_t type_bits);
+
+static Fpx3d_E_Result _allocate(struct fpx3d_vk_allocator *,
+                                Fpx3d_Vk_LogicalGpu *, uint32_t type,
+                                VkMemoryRequirements, bool linear,
+                                Fpx3d_Vk_Allocation *output);
+static Fpx3d_E_Result
+_allocate_dedicated(Fpx3d_Vk_LogicalGpu *,
+                    const VkPhysicalDeviceMemoryProperties *, uint32_t type,
+                    VkDeviceSize size, Fpx3d_Vk_Allocation *output);
+static void _release(struct fpx3d_vk_allocator *, Fpx3d_Vk_LogicalGpu *,
+                     Fpx3d_Vk_Allocation *);
+
+static struct fpx3d_vk_memory_block *
+_new_block(struct fpx3d_vk_allocator *, Fpx3d_Vk_LogicalGpu *, uint32_t type,
+           size_t kind, VkDeviceSize size);
+static void _destroy_block(struct fpx3d_vk_allocator *, Fpx3d_Vk_LogicalGpu *,
+                           struct fpx3d_vk_memory_block *);
+
+static bool _block_allocate(struct fpx3d_vk_memory_block *, VkDeviceSize size,
+                            VkDeviceSize alignment,
+                            Fpx3d_Vk_Allocation *output);
+
+static void _size_class(VkDeviceSize size, uint32_t *fl, uint32_t *sl);
+static struct fpx3d_vk_memory_node *
+_find_free(struct fpx3d_vk_memory_block *, VkDeviceSize size);
+static void _insert_free(struct fpx3d_vk_memory_block *,
+                         struct fpx3d_vk_memory_node *);
+static void _remove_free(struct fpx3d_vk_memory_block *,
+                         struct fpx3d_vk_memory_node *);
+static struct fpx3d_vk_memory_node *_split(struct fpx3d_vk_memory_node *,
+                                           VkDeviceSize first_size);
+static void _absorb_next(struct fpx3d_vk_memory_node *);
+
+// end of static declarations ----
+
+// called once the VkDevice of `lgpu` exists. Memory properties and limits
+// come from the capability snapshot, rather than from the driver for
+// every allocation
+Fpx3d_E_Result
+__fpx3d_vk_create_allocator(const Fpx3d_Vk_Capabilities *caps,
+                            Fpx3d_Vk_LogicalGpu *lgpu) {
+  NULL_CHECK(caps, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  struct fpx3d_vk_allocator *allocator = calloc(1, sizeof(*allocator));
+  if (NULL == allocator) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  if (0 != pthread_mutex_init(&allocator->lock, NULL)) {
+    FREE_SAFE(allocator);
+    return FPX3D_GENERIC_ERROR;
+  }
+
+  allocator->memoryProperties = caps->memoryProperties;
+  allocator->granularity = caps->properties.limits.bufferImageGranularity;
+  allocator->nonCoherentAtomSize =
+      MAX(caps->properties.limits.nonCoherentAtomSize, (VkDeviceSize)1);
+
+  {
+    const char *extension = {VK_AMD_DEVICE_COHERENT_MEMORY_EXTENSION_NAME};
+
+    if (false == fpx3d_vk_capabilities_have_extensions(caps, &extension, 1))
+      allocator->unsupportedFlags |= VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD;
+  }
+
+  for (uint32_t i = 0; i < allocator->memoryProperties.memoryHeapCount; ++i) {
+    VkDeviceSize heap_size = allocator->memoryProperties.memoryHeaps[i].size;
+    VkDeviceSize size = BLOCK_SIZE;
+
+    while (MIN_BLOCK_SIZE < size && size > heap_size / BLOCK_HEAP_FRACTION)
+      size /= 2;
+
+    allocator->blockSizes[i] = size;
+  }
+
+  lgpu->allocator = allocator;
+
+  return FPX3D_SUCCESS;
+}
+
+// every allocation should have been released by now; blocks are freed
+// either way
+void __fpx3d_vk_destroy_allocator(Fpx3d_Vk_LogicalGpu *lgpu) {
+  NULL_CHECK(lgpu, );
+  NULL_CHECK(lgpu->allocator, );
+
+  struct fpx3d_vk_allocator *allocator = lgpu->allocator;
+
+  if (0 < allocator->stats.allocationCount) {
+    FPX3D_WARN("Destroying memory allocator with %" LONG_FORMAT
+               "u allocations left",
+               allocator->stats.allocationCount);
+  }
+
+  for (size_t t = 0; t < VK_MAX_MEMORY_TYPES; ++t) {
+    for (size_t k = 0; k < RESOURCE_KINDS; ++k) {
+      struct fpx3d_vk_memory_block *block = allocator->blocks[t][k];
+
+      while (NULL != block) {
+        struct fpx3d_vk_memory_block *next = block->next;
+        _destroy_block(allocator, lgpu, block);
+        block = next;
+      }
+    }
+  }
+
+  pthread_mutex_destroy(&allocator->lock);
+
+  FREE_SAFE(lgpu->allocator);
+}
+
+// finds a memory type that has every flag of `mem_flags`, and as many of
+// `preferred_flags` as there are, and suballocates a range of it. If that
+// type's heap is full, any type with just `mem_flags` will do. `linear` is
+// false for images with optimal tiling. Without an allocator on `lgpu`
+// (logical GPUs that weren't made by fpx3d_vk_create_logicalgpu_at()),
+// every range is memory of its own
+Fpx3d_E_Result __fpx3d_vk_allocate(VkPhysicalDevice dev,
+                                   Fpx3d_Vk_LogicalGpu *lgpu,
+                                   VkMemoryPropertyFlags mem_flags,
+                                   VkMemoryPropertyFlags preferred_flags,
+                                   VkMemoryRequirements mem_reqs, bool linear,
+                                   Fpx3d_Vk_Allocation *output) {
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  if (1 > mem_reqs.size)
+    return FPX3D_ARGS_ERROR;
+
+  struct fpx3d_vk_allocator *allocator = lgpu->allocator;
+
+  if (NULL == allocator) {
+    NULL_CHECK(dev, FPX3D_ARGS_ERROR);
+
+    VkPhysicalDeviceMemoryProperties mem_props = {0};
+    vkGetPhysicalDeviceMemoryProperties(dev, &mem_props);
+
+    int type = _memory_type(&mem_props, _unsupported_flags(dev), mem_flags,
+                            preferred_flags, mem_reqs.memoryTypeBits);
+    if (0 > type) {
+      FPX3D_WARN("Could not find valid memory type");
+      return FPX3D_VK_ERROR;
+    }
+
+    return _allocate_dedicated(lgpu, &mem_props, (uint32_t)type,
+                               mem_reqs.size, output);
+  }
+
+  const VkPhysicalDeviceMemoryProperties *mem_props =
+      &allocator->memoryProperties;
+
+  int type = _memory_type(mem_props, allocator->unsupportedFlags, mem_flags,
+                          preferred_flags, mem_reqs.memoryTypeBits);
+  if (0 > type) {
+    FPX3D_WARN("Could not find valid memory type");
+    return FPX3D_VK_ERROR;
+  }
+
+  pthread_mutex_lock(&allocator->lock);
+
+  Fpx3d_E_Result retval =
+      _allocate(allocator, lgpu, (uint32_t)type, mem_reqs, linear, output);
+
+  if (FPX3D_SUCCESS != retval && 0 != preferred_flags) {
+    int fallback = _memory_type(mem_props, allocator->unsupportedFlags,
+                                mem_flags, 0, mem_reqs.memoryTypeBits);
+
+    if (fallback != type)
+      retval = _allocate(allocator, lgpu, (uint32_t)fallback, mem_reqs,
+                         linear, output);
+  }
+
+  pthread_mutex_unlock(&allocator->lock);
+
+  return retval;
+}
+
+// true if any memory type has every one of `mem_flags`. Always false
+// without an allocator on `lgpu`
+bool __fpx3d_vk_have_memory_flags(Fpx3d_Vk_LogicalGpu *lgpu,
+                                  VkMemoryPropertyFlags mem_flags) {
+  NULL_CHECK(lgpu, false);
+  NULL_CHECK(lgpu->allocator, false);
+
+  struct fpx3d_vk_allocator *allocator = lgpu->allocator;
+
+  return 0 <= _memory_type(&allocator->memoryProperties,
+                           allocator->unsupportedFlags, mem_flags, 0, ~0u);
+}
+
+// makes host writes to `size` bytes at `offset` in the allocation
+// available to the device. Only memory that isn't HOST_COHERENT needs
+// this; the range is widened to whole nonCoherentAtomSize units, which
+// never reach into another allocation
+Fpx3d_E_Result __fpx3d_vk_flush_allocation(Fpx3d_Vk_LogicalGpu *lgpu,
+                                           const Fpx3d_Vk_Allocation *alloc,
+                                           VkDeviceSize offset,
+                                           VkDeviceSize size) {
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+  NULL_CHECK(alloc, FPX3D_ARGS_ERROR);
+
+  if (NULL == alloc->mapped || 0 == size ||
+      (alloc->propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT))
+    return FPX3D_SUCCESS;
+
+  if (offset >= alloc->size)
+    return FPX3D_ARGS_ERROR;
+
+  VkMappedMemoryRange range = {0};
+  range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+  range.memory = alloc->memory;
+  range.offset = 0;
+  range.size = VK_WHOLE_SIZE;
+
+  // without an allocator, the memory is the allocation's own
+  if (NULL != lgpu->allocator) {
+    struct fpx3d_vk_allocator *allocator = lgpu->allocator;
+    VkDeviceSize atom = allocator->nonCoherentAtomSize;
+
+    VkDeviceSize memory_size =
+        (NULL != alloc->block) ? alloc->block->size : alloc->size;
+
+    VkDeviceSize start = alloc->offset + offset;
+    VkDeviceSize end = start + MIN(size, (alloc->size - offset));
+
+    range.offset = start - start % atom;
+
+    if (ALIGN_TO(end, atom) < memory_size)
+      range.size = ALIGN_TO(end, atom) - range.offset;
+  }
+
+  if (VK_SUCCESS != vkFlushMappedMemoryRanges(lgpu->handle, 1, &range)) {
+    FPX3D_WARN("Could not flush mapped memory");
+    return FPX3D_VK_ERROR;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+void __fpx3d_vk_free(Fpx3d_Vk_LogicalGpu *lgpu,
+                     Fpx3d_Vk_Allocation *allocation) {
+  NULL_CHECK(lgpu, );
+  NULL_CHECK(allocation, );
+
+  if (VK_NULL_HANDLE == allocation->memory)
+    return;
+
+  struct fpx3d_vk_allocator *allocator = lgpu->allocator;
+
+  if (NULL == allocator) {
+    // always dedicated
+    vkFreeMemory(lgpu->handle, allocation->memory, NULL);
+  } else {
+    pthread_mutex_lock(&allocator->lock);
+    _release(allocator, lgpu, allocation);
+    pthread_mutex_unlock(&allocator->lock);
+  }
+
+  memset(allocation, 0, sizeof(*allocation));
+}
+
+Fpx3d_E_Result fpx3d_vk_get_allocator_stats(Fpx3d_Vk_LogicalGpu *lgpu,
+                                            Fpx3d_Vk_AllocatorStats *output) {
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu->allocator, FPX3D_NULLPTR_ERROR);
+
+  struct fpx3d_vk_allocator *allocator = lgpu->allocator;
+
+  pthread_mutex_lock(&allocator->lock);
+  *output = allocator->stats;
+  pthread_mutex_unlock(&allocator->lock);
+
+  return FPX3D_SUCCESS;
+}
+
+// STATIC FUNCTIONS ----
+
+static VkMemoryPropertyFlags _unsupported_flags(VkPhysicalDevice dev) {
+  VkMemoryPropertyFlags unsupported = 0;
+
+  const char *extension = {VK_AMD_DEVICE_COHERENT_MEMORY_EXTENSION_NAME};
+
+  if (false == fpx3d_vk_device_extensions_supported(dev, &extension, 1))
+    unsupported |= VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD;
+
+  return unsupported;
+}
+
+// of the types with every `wanted` flag, the one with the most `preferred`
+// flags. The driver lists the better of two otherwise equal types first
+static int _memory_type(const VkPhysicalDeviceMemoryProperties *mem_props,
+                        VkMemoryPropertyFlags unsupported,
+                        VkMemoryPropertyFlags wanted,
+                        VkMemoryPropertyFlags preferred, uint32_t type_bits) {
+  int best = -1;
+  int best_score = -1;
+
+  for (uint32_t i = 0; i < mem_props->memoryTypeCount; ++i) {
+    VkMemoryPropertyFlags flags = mem_props->memoryTypes[i].propertyFlags;
+
+    if (0 == (type_bits & (1u << i)) || (flags & wanted) != wanted ||
+        (flags & unsupported) != 0)
+      continue;
+
+    int score = __builtin_popcount(flags & preferred);
+
+    if (score > best_score) {
+      best = (int)i;
+      best_score = score;
+    }
+  }
+
+  return best;
+}
+
+static Fpx3d_E_Result _allocate(struct fpx3d_vk_allocator *allocator,
+                                Fpx3d_Vk_LogicalGpu *lgpu, uint32_t type,
+                                VkMemoryRequirements mem_reqs, bool linear,
+                                Fpx3d_Vk_Allocation *output) {
+  const VkPhysicalDeviceMemoryProperties *mem_props =
+      &allocator->memoryProperties;
+
+  VkDeviceSize block_size =
+      allocator->blockSizes[mem_props->memoryTypes[type].heapIndex];
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  if (mem_reqs.size > block_size / 2) {
+    retval = _allocate_dedicated(lgpu, mem_props, (uint32_t)type,
+                                 mem_reqs.size, output);
+    if (FPX3D_SUCCESS != retval)
+      return retval;
+
+    ++allocator->stats.dedicatedCount;
+    allocator->stats.dedicatedBytes += output->size;
+    ++allocator->stats.allocationCount;
+    allocator->stats.allocatedBytes += output->size;
+
+    return FPX3D_SUCCESS;
+  }
+
+  size_t kind = LINEAR_RESOURCES;
+  if (1 < allocator->granularity && false == linear)
+    kind = OPTIMAL_RESOURCES;
+
+  VkDeviceSize alignment = MAX(mem_reqs.alignment, MIN_ALIGNMENT);
+
+  // flushes of non-coherent memory cover whole atoms, so no two ranges
+  // may share one
+  VkMemoryPropertyFlags flags = mem_props->memoryTypes[type].propertyFlags;
+  bool non_coherent = (flags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) &&
+                      0 == (flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+  if (non_coherent)
+    alignment = MAX(alignment, allocator->nonCoherentAtomSize);
+
+  VkDeviceSize size = ALIGN_TO(mem_reqs.size, MIN_ALIGNMENT);
+
+  if (non_coherent)
+    size = ALIGN_TO(size, allocator->nonCoherentAtomSize);
+
+  struct fpx3d_vk_memory_block **list = &allocator->blocks[type][kind];
+
+  bool found = false;
+
+  for (struct fpx3d_vk_memory_block *block = *list;
+       false == found && NULL != block; block = block->next)
+    found = _block_allocate(block, size, alignment, output);
+
+  // a new block, smaller ones if the heap is running out
+  for (VkDeviceSize try_size = block_size;
+       false == found && try_size >= MIN_BLOCK_SIZE &&
+       try_size >= size + alignment;
+       try_size /= 2) {
+    struct fpx3d_vk_memory_block *block =
+        _new_block(allocator, lgpu, (uint32_t)type, kind, try_size);
+    if (NULL == block)
+      continue;
+
+    block->next = *list;
+    *list = block;
+
+    found = _block_allocate(block, size, alignment, output);
+  }
+
+  if (false == found) {
+    retval = _allocate_dedicated(lgpu, mem_props, (uint32_t)type,
+                                 mem_reqs.size, output);
+    if (FPX3D_SUCCESS != retval)
+      return retval;
+
+    ++allocator->stats.dedicatedCount;
+    allocator->stats.dedicatedBytes += output->size;
+  }
+
+  ++allocator->stats.allocationCount;
+  allocator->stats.allocatedBytes += output->size;
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result
+_allocate_dedicated(Fpx3d_Vk_LogicalGpu *lgpu,
+                    const VkPhysicalDeviceMemoryProperties *mem_props,
+                    uint32_t type, VkDeviceSize size,
+                    Fpx3d_Vk_Allocation *output) {
+  VkMemoryAllocateInfo m_info = {0};
+  m_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  m_info.allocationSize = size;
+  m_info.memoryTypeIndex = type;
+
+  VkDeviceMemory new_mem = VK_NULL_HANDLE;
+
+  if (VK_SUCCESS != vkAllocateMemory(lgpu->handle, &m_info, NULL, &new_mem)) {
+    FPX3D_WARN("Could not allocate device memory");
+    return FPX3D_VK_ERROR;
+  }
+
+  void *mapped = NULL;
+
+  if (mem_props->memoryTypes[type].propertyFlags &
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    if (VK_SUCCESS !=
+        vkMapMemory(lgpu->handle, new_mem, 0, VK_WHOLE_SIZE, 0, &mapped)) {
+      vkFreeMemory(lgpu->handle, new_mem, NULL);
+      return FPX3D_VK_ERROR;
+    }
+  }
+
+  memset(output, 0, sizeof(*output));
+
+  output->memory = new_mem;
+  output->offset = 0;
+  output->size = size;
+  output->mapped = mapped;
+  output->propertyFlags = mem_props->memoryTypes[type].propertyFlags;
+
+  return FPX3D_SUCCESS;
+}
+
+static void _release(struct fpx3d_vk_allocator *allocator,
+                     Fpx3d_Vk_LogicalGpu *lgpu,
+                     Fpx3d_Vk_Allocation *allocation) {
+  --allocator->stats.allocationCount;
+  allocator->stats.allocatedBytes -= allocation->size;
+
+  struct fpx3d_vk_memory_block *block = allocation->block;
+
+  if (NULL == block) {
+    --allocator->stats.dedicatedCount;
+    allocator->stats.dedicatedBytes -= allocation->size;
+
+    vkFreeMemory(lgpu->handle, allocation->memory, NULL);
+    return;
+  }
+
+  struct fpx3d_vk_memory_node *node = allocation->node;
+
+  node->isFree = true;
+  --block->allocationCount;
+
+  if (NULL != node->nextPhysical && node->nextPhysical->isFree) {
+    _remove_free(block, node->nextPhysical);
+    _absorb_next(node);
+  }
+
+  if (NULL != node->prevPhysical && node->prevPhysical->isFree) {
+    node = node->prevPhysical;
+
+    _remove_free(block, node);
+    _absorb_next(node);
+  }
+
+  _insert_free(block, node);
+
+  if (0 < block->allocationCount)
+    return;
+
+  // keep one empty block around, so a single resource being created and
+  // destroyed over and over doesn't allocate device memory every time
+  struct fpx3d_vk_memory_block **list =
+      &allocator->blocks[block->memoryType][block->kind];
+
+  if (*list == block && NULL == block->next)
+    return;
+
+  while (*list != block)
+    list = &(*list)->next;
+
+  *list = block->next;
+
+  _destroy_block(allocator, lgpu, block);
+}
+
+static struct fpx3d_vk_memory_block *
+_new_block(struct fpx3d_vk_allocator *allocator, Fpx3d_Vk_LogicalGpu *lgpu,
+           uint32_t type, size_t kind, VkDeviceSize size) {
+  struct fpx3d_vk_memory_block *block = calloc(1, sizeof(*block));
+  struct fpx3d_vk_memory_node *node = calloc(1, sizeof(*node));
+
+  if (NULL == block || NULL == node) {
+    perror("calloc()");
+    FREE_SAFE(block);
+    FREE_SAFE(node);
+    return NULL;
+  }
+
+  Fpx3d_Vk_Allocation memory = {0};
+
+  if (FPX3D_SUCCESS != _allocate_dedicated(lgpu, &allocator->memoryProperties,
+                                           type, size, &memory)) {
+    FREE_SAFE(block);
+    FREE_SAFE(node);
+    return NULL;
+  }
+
+  block->memory = memory.memory;
+  block->size = size;
+  block->mapped = memory.mapped;
+  block->memoryType = type;
+  block->propertyFlags = memory.propertyFlags;
+  block->kind = kind;
+
+  node->offset = 0;
+  node->size = size;
+
+  block->first = node;
+  _insert_free(block, node);
+
+  ++allocator->stats.blockCount;
+  allocator->stats.blockBytes += size;
+
+  FPX3D_DEBUG("New %" LONG_FORMAT "u byte memory block of type %u",
+              (size_t)size, type);
+
+  return block;
+}
+
+static void _destroy_block(struct fpx3d_vk_allocator *allocator,
+                           Fpx3d_Vk_LogicalGpu *lgpu,
+                           struct fpx3d_vk_memory_block *block) {
+  --allocator->stats.blockCount;
+  allocator->stats.blockBytes -= block->size;
+
+  for (struct fpx3d_vk_memory_node *node = block->first; NULL != node;) {
+    struct fpx3d_vk_memory_node *next = node->nextPhysical;
+    FREE_SAFE(node);
+    node = next;
+  }
+
+  vkFreeMemory(lgpu->handle, block->memory, NULL);
+
+  FREE_SAFE(block);
+}
+
+static bool _block_allocate(struct fpx3d_vk_memory_block *block,
+                            VkDeviceSize size, VkDeviceSize alignment,
+                            Fpx3d_Vk_Allocation *output) {
+  // room to move the start of the range up to the alignment
+  struct fpx3d_vk_memory_node *node =
+      _find_free(block, size + alignment - MIN_ALIGNMENT);
+  if (NULL == node)
+    return false;
+
+  _remove_free(block, node);
+
+  VkDeviceSize aligned = ALIGN_TO(node->offset, alignment);
+
+  if (aligned > node->offset) {
+    // the part in front stays free
+    struct fpx3d_vk_memory_node *rest =
+        _split(node, aligned - node->offset);
+    if (NULL == rest) {
+      _insert_free(block, node);
+      return false;
+    }
+
+    _insert_free(block, node);
+    node = rest;
+  }
+
+  if (node->size > size) {
+    struct fpx3d_vk_memory_node *rest = _split(node, size);
+
+    // if there's no memory for the bookkeeping, the range stays bigger
+    if (NULL != rest)
+      _insert_free(block, rest);
+  }
+
+  node->isFree = false;
+  ++block->allocationCount;
+
+  memset(output, 0, sizeof(*output));
+
+  output->memory = block->memory;
+  output->offset = node->offset;
+  output->size = node->size;
+  output->propertyFlags = block->propertyFlags;
+  output->block = block;
+  output->node = node;
+
+  if (NULL != block->mapped)
+    output->mapped = (uint8_t *)block->mapped + node->offset;
+
+  return true;
+}
+
+static void _size_class(VkDeviceSize size, uint32_t *fl, uint32_t *sl) {
+  if (size < SMALL_SIZE) {
+    *fl = 0;
+    *sl = (uint32_t)(size / (SMALL_SIZE / SL_COUNT));
+    return;
+  }
+
+  uint32_t log2 = 63 - (uint32_t)__builtin_clzll((unsigned long long)size);
+
+  *sl = (uint32_t)(size >> (log2 - SL_COUNT_LOG2)) ^ SL_COUNT;
+  *fl = log2 - FL_SHIFT + 1;
+}
+
+// any range of the returned size class (or above) is at least `size`
+// bytes, so the head of the first non-empty list will do
+static struct fpx3d_vk_memory_node *
+_find_free(struct fpx3d_vk_memory_block *block, VkDeviceSize size) {
+  if (SMALL_SIZE <= size) {
+    uint32_t log2 = 63 - (uint32_t)__builtin_clzll((unsigned long long)size);
+    size += ((VkDeviceSize)1 << (log2 - SL_COUNT_LOG2)) - 1;
+  }
+
+  uint32_t fl = 0, sl = 0;
+  _size_class(size, &fl, &sl);
+
+  if (FL_COUNT <= fl)
+    return NULL;
+
+  uint32_t sl_map = block->slBitmaps[fl] & (~0u << sl);
+
+  if (0 == sl_map) {
+    uint32_t fl_map = block->flBitmap & (~0u << (fl + 1));
+    if (0 == fl_map)
+      return NULL;
+
+    fl = (uint32_t)__builtin_ctz(fl_map);
+    sl_map = block->slBitmaps[fl];
+  }
+
+  sl = (uint32_t)__builtin_ctz(sl_map);
+
+  return block->freeLists[fl][sl];
+}
+
+static void _insert_free(struct fpx3d_vk_memory_block *block,
+                         struct fpx3d_vk_memory_node *node) {
+  uint32_t fl = 0, sl = 0;
+  _size_class(node->size, &fl, &sl);
+
+  node->isFree = true;
+  node->prevFree = NULL;
+  node->nextFree = block->freeLists[fl][sl];
+
+  if (NULL != node->nextFree)
+    node->nextFree->prevFree = node;
+
+  block->freeLists[fl][sl] = node;
+
+  block->slBitmaps[fl] |= 1u << sl;
+  block->flBitmap |= 1u << fl;
+}
+
+static void _remove_free(struct fpx3d_vk_memory_block *block,
+                         struct fpx3d_vk_memory_node *node) {
+  uint32_t fl = 0, sl = 0;
+  _size_class(node->size, &fl, &sl);
+
+  if (NULL != node->prevFree)
+    node->prevFree->nextFree = node->nextFree;
+  else
+    block->freeLists[fl][sl] = node->nextFree;
+
+  if (NULL != node->nextFree)
+    node->nextFree->prevFree = node->prevFree;
+
+  node->prevFree = NULL;
+  node->nextFree = NULL;
+
+  if (NULL == block->freeLists[fl][sl]) {
+    block->slBitmaps[fl] &= ~(1u << sl);
+
+    if (0 == block->slBitmaps[fl])
+      block->flBitmap &= ~(1u << fl);
+  }
+}
+
+// cuts `node` down to `first_size` bytes; the rest becomes a new node
+// right after it, which the caller has to put somewhere
+static struct fpx3d_vk_memory_node *
+_split(struct fpx3d_vk_memory_node *node, VkDeviceSize first_size) {
+  struct fpx3d_vk_memory_node *rest = calloc(1, sizeof(*rest));
+  if (NULL == rest) {
+    perror("calloc()");
+    return NULL;
+  }
+
+  rest->offset = node->offset + first_size;
+  rest->size = node->size - first_size;
+
+  rest->prevPhysical = node;
+  rest->nextPhysical = node->nextPhysical;
+
+  if (NULL != rest->nextPhysical)
+    rest->nextPhysical->prevPhysical = rest;
+
+  node->nextPhysical = rest;
+  node->size = first_size;
+
+  return rest;
+}
+
+// merges the next node (taken out of its free list already) into `node`
+static void _absorb_next(struct fpx3d_vk_memory_node *node) {
+  struct fpx3d_vk_memory_node *next = node->nextPhysical;
+
+  node->size += next->size;
+  node->nextPhysical = next->nextPhysical;
+
+  if (NULL != node->nextPhysical)
+    node->nextPhysical->prevPhysical = node;
+
+  FREE_SAFE(next);
+}
+
+// END OF STATIC FUNCTIONS ----
@@ -10,6 +10,7 @@
 #include "macros.h"
 #include "vk/command.h"
 #include "vk/logical_gpu.h"
+#include "vk/upload.h"
 #include "vk/utility.h"
 #include "volk/volk.h"
 
@@ -25,10 +26,46 @@ extern Fpx3d_E_Result
 __fpx3d_vk_end_temp_command_buffer(VkCommandBuffer, VkCommandPool graphics_pool,
                                    VkQueue graphics_queue, VkDevice lgpu);
 
-Fpx3d_E_Result __fpx3d_vk_new_memory(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
-                                     VkMemoryPropertyFlags mem_flags,
-                                     VkMemoryRequirements mem_reqs,
-                                     VkDeviceMemory *output);
+extern Fpx3d_E_Result __fpx3d_open_file(const char *path, void **output,
+                                        size_t *output_size);
+extern void __fpx3d_close_file(void *file);
+extern Fpx3d_E_Result __fpx3d_read_file_scatter(void *file, size_t offset,
+                                                void *const *buffers,
+                                                const size_t *lengths,
+                                                size_t count);
+
+extern Fpx3d_E_Result __fpx3d_vk_allocate(
+    VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *, VkMemoryPropertyFlags,
+    VkMemoryPropertyFlags preferred, VkMemoryRequirements, bool linear,
+    Fpx3d_Vk_Allocation *output);
+extern void __fpx3d_vk_free(Fpx3d_Vk_LogicalGpu *, Fpx3d_Vk_Allocation *);
+extern bool __fpx3d_vk_have_memory_flags(Fpx3d_Vk_LogicalGpu *,
+                                         VkMemoryPropertyFlags);
+extern Fpx3d_E_Result __fpx3d_vk_flush_allocation(Fpx3d_Vk_LogicalGpu *,
+                                                  const Fpx3d_Vk_Allocation *,
+                                                  VkDeviceSize offset,
+                                                  VkDeviceSize size);
+
+extern Fpx3d_E_Result __fpx3d_vk_begin_upload_batch(VkPhysicalDevice,
+                                                    Fpx3d_Vk_LogicalGpu *,
+                                                    Fpx3d_Vk_UploadBatch *);
+extern Fpx3d_E_Result __fpx3d_vk_batch_fill_new_buffer(Fpx3d_Vk_UploadBatch *,
+                                                       Fpx3d_Vk_Buffer *dst,
+                                                       const void *data,
+                                                       VkDeviceSize size);
+
+// staging memory used by __fpx3d_vk_new_buffer_from_file() by default
+#define STREAM_WINDOW_SIZE (8 * 1024 * 1024)
+
+// new buffers up to this size are written by the host directly, if there
+// is device-local memory that it can write to (resizable BAR)
+#define DIRECT_WRITE_MAX_SIZE (64 * 1024)
+
+// for buffers that the host writes to every frame: device-local if the
+// host can write to that (resizable BAR), coherent if possible
+#define DYNAMIC_MEMORY_FLAGS VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT
+#define DYNAMIC_PREFERRED_FLAGS                                                \
+  (VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT)
 
 Fpx3d_E_Result __fpx3d_vk_new_buffer(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
                                      VkDeviceSize size,
@@ -37,87 +74,349 @@ Fpx3d_E_Result __fpx3d_vk_new_buffer(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
                                      VkSharingMode,
                                      Fpx3d_Vk_Buffer *output_buffer);
 
+Fpx3d_E_Result __fpx3d_vk_new_dynamic_buffer(VkPhysicalDevice,
+                                             Fpx3d_Vk_LogicalGpu *,
+                                             VkDeviceSize size,
+                                             VkBufferUsageFlags usage,
+                                             Fpx3d_Vk_Buffer *output_buffer);
+
+Fpx3d_E_Result __fpx3d_vk_write_buffer(Fpx3d_Vk_LogicalGpu *,
+                                       const Fpx3d_Vk_Buffer *,
+                                       VkDeviceSize offset, const void *data,
+                                       VkDeviceSize size);
+
 Fpx3d_E_Result __fpx3d_vk_data_to_buffer(Fpx3d_Vk_LogicalGpu *,
                                          Fpx3d_Vk_Buffer *, void *data,
                                          VkDeviceSize size);
 
-Fpx3d_E_Result __fpx3d_vk_bufcopy(VkDevice, VkQueue transfer_queue,
-                                  Fpx3d_Vk_Buffer *src, Fpx3d_Vk_Buffer *dst,
-                                  VkDeviceSize size,
-                                  VkCommandPool transfer_cmd_pool);
+Fpx3d_E_Result __fpx3d_vk_batch_new_buffer(Fpx3d_Vk_UploadBatch *,
+                                           const void *data, VkDeviceSize size,
+                                           VkBufferUsageFlags usage_flags,
+                                           Fpx3d_Vk_Buffer *output);
 
 Fpx3d_Vk_Buffer __fpx3d_vk_new_buffer_with_data(VkPhysicalDevice,
                                                 Fpx3d_Vk_LogicalGpu *,
                                                 void *data, VkDeviceSize size,
                                                 VkBufferUsageFlags usage_flags);
 
+Fpx3d_E_Result __fpx3d_vk_new_buffer_from_file(
+    VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *, const char *path,
+    size_t file_offset, VkDeviceSize size, VkBufferUsageFlags usage_flags,
+    size_t window_size, Fpx3d_Vk_Buffer *output);
+
 void __fpx3d_vk_destroy_buffer_object(Fpx3d_Vk_LogicalGpu *lgpu,
                                       Fpx3d_Vk_Buffer *buffer);
 
-Fpx3d_E_Result __fpx3d_vk_new_memory(VkPhysicalDevice dev,
-                                     Fpx3d_Vk_LogicalGpu *lgpu,
-                                     VkMemoryPropertyFlags mem_flags,
-                                     VkMemoryRequirements mem_reqs,
-                                     VkDeviceMemory *output) {
-  VkDeviceMemory new_mem = {0};
+// static declarations ----
+
+static Fpx3d_E_Result _new_buffer(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
+                                  VkDeviceSize size, VkBufferUsageFlags usage,
+                                  VkMemoryPropertyFlags mem_flags,
+                                  VkMemoryPropertyFlags preferred_flags,
+                                  VkSharingMode,
+                                  Fpx3d_Vk_Buffer *output_buffer);
+
+static Fpx3d_E_Result _stream_chunks(Fpx3d_Vk_LogicalGpu *, void *file,
+                                     size_t file_offset, VkDeviceSize size,
+                                     Fpx3d_Vk_Buffer *staging,
+                                     VkDeviceSize half_size,
+                                     Fpx3d_Vk_Buffer *dst, VkQueue,
+                                     VkCommandPool);
+
+// end of static declarations ----
+
+Fpx3d_E_Result __fpx3d_vk_new_buffer(
+    VkPhysicalDevice dev, Fpx3d_Vk_LogicalGpu *lgpu, VkDeviceSize size,
+    VkBufferUsageFlags usage, VkMemoryPropertyFlags mem_flags,
+    VkSharingMode sharing_mode, Fpx3d_Vk_Buffer *output_buffer) {
+  return _new_buffer(dev, lgpu, size, usage, mem_flags, 0, sharing_mode,
+                     output_buffer);
+}
+
+// a mapped buffer for data that the host rewrites often (every frame,
+// say), which the device reads straight from there. Write to it with
+// __fpx3d_vk_write_buffer(), which flushes if the memory isn't coherent
+Fpx3d_E_Result __fpx3d_vk_new_dynamic_buffer(VkPhysicalDevice dev,
+                                             Fpx3d_Vk_LogicalGpu *lgpu,
+                                             VkDeviceSize size,
+                                             VkBufferUsageFlags usage,
+                                             Fpx3d_Vk_Buffer *output_buffer) {
+  return _new_buffer(dev, lgpu, size, usage, DYNAMIC_MEMORY_FLAGS,
+                     DYNAMIC_PREFERRED_FLAGS, VK_SHARING_MODE_EXCLUSIVE,
+                     output_buffer);
+}
+
+// copies `data` into the mapped memory of `buf` and flushes just that
+// range, if it needs flushing
+Fpx3d_E_Result __fpx3d_vk_write_buffer(Fpx3d_Vk_LogicalGpu *lgpu,
+                                       const Fpx3d_Vk_Buffer *buf,
+                                       VkDeviceSize offset, const void *data,
+                                       VkDeviceSize size) {
+  NULL_CHECK(buf, FPX3D_ARGS_ERROR);
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
 
-  VkPhysicalDeviceMemoryProperties mem_props = {0};
-  vkGetPhysicalDeviceMemoryProperties(dev, &mem_props);
+  // not host-visible
+  NULL_CHECK(buf->mapped_memory, FPX3D_VK_BAD_MEMORY_HANDLE_ERROR);
 
-  /*
-   *  Unsupported extensions
-   */
-  uint32_t unsupported = 0;
+  if (offset > buf->allocation.size || size > buf->allocation.size - offset)
+    return FPX3D_ARGS_ERROR;
 
-  {
-    const char *extension = {VK_AMD_DEVICE_COHERENT_MEMORY_EXTENSION_NAME};
+  memcpy((uint8_t *)buf->mapped_memory + offset, data, size);
 
-    if (false == fpx3d_vk_device_extensions_supported(dev, &extension, 1))
-      unsupported |= VK_MEMORY_PROPERTY_DEVICE_COHERENT_BIT_AMD;
+  return __fpx3d_vk_flush_allocation(lgpu, &buf->allocation, offset, size);
+}
+
+Fpx3d_E_Result __fpx3d_vk_data_to_buffer(Fpx3d_Vk_LogicalGpu *lgpu,
+                                         Fpx3d_Vk_Buffer *buf, void *data,
+                                         VkDeviceSize size) {
+  return __fpx3d_vk_write_buffer(lgpu, buf, 0, data, size);
+}
+
+// creates a device-local buffer and records the upload of `data` into it.
+// The buffer can't be used before the batch is done. Small buffers are
+// written right away instead, if the host can write to device-local memory
+Fpx3d_E_Result __fpx3d_vk_batch_new_buffer(Fpx3d_Vk_UploadBatch *batch,
+                                           const void *data, VkDeviceSize size,
+                                           VkBufferUsageFlags usage_flags,
+                                           Fpx3d_Vk_Buffer *output) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid)
+    return FPX3D_ARGS_ERROR;
+
+  // exclusive: if it's filled on the transfer queue, the batch hands it
+  // over to the graphics queue family
+  Fpx3d_Vk_Buffer new_buf = {0};
+
+  VkMemoryPropertyFlags direct_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+
+  if (DIRECT_WRITE_MAX_SIZE >= size &&
+      __fpx3d_vk_have_memory_flags(batch->logicalGpu, direct_flags) &&
+      FPX3D_SUCCESS ==
+          __fpx3d_vk_new_buffer(batch->physicalGpu, batch->logicalGpu, size,
+                                usage_flags | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                direct_flags, VK_SHARING_MODE_EXCLUSIVE,
+                                &new_buf)) {
+    // no copy to record; the write is visible to anything submitted later
+    FPX3D_ONFAIL(__fpx3d_vk_write_buffer(batch->logicalGpu, &new_buf, 0, data,
+                                         size),
+                 success,
+                 __fpx3d_vk_destroy_buffer_object(batch->logicalGpu, &new_buf);
+                 return success;);
+
+    *output = new_buf;
+
+    return FPX3D_SUCCESS;
   }
 
-  /*
-   *  End of Unsupported extensions
-   */
+  FPX3D_ONFAIL(__fpx3d_vk_new_buffer(batch->physicalGpu, batch->logicalGpu,
+                                     size,
+                                     usage_flags |
+                                         VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                     VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                                     VK_SHARING_MODE_EXCLUSIVE, &new_buf),
+               success, return success;);
 
-  int idx = -1;
-  for (uint32_t i = 0; i < mem_props.memoryTypeCount; ++i) {
-    if ((mem_reqs.memoryTypeBits & (1 << i)) &&
-        (mem_props.memoryTypes[i].propertyFlags & mem_flags) == mem_flags &&
-        (mem_props.memoryTypes[i].propertyFlags & unsupported) == 0) {
-      idx = i;
-      break;
+  FPX3D_ONFAIL(__fpx3d_vk_batch_fill_new_buffer(batch, &new_buf, data, size),
+               success,
+               __fpx3d_vk_destroy_buffer_object(batch->logicalGpu, &new_buf);
+               return success;);
+
+  *output = new_buf;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_Vk_Buffer
+__fpx3d_vk_new_buffer_with_data(VkPhysicalDevice dev, Fpx3d_Vk_LogicalGpu *lgpu,
+                                void *data, VkDeviceSize size,
+                                VkBufferUsageFlags usage_flags) {
+  Fpx3d_Vk_Buffer return_buf = {0};
+
+  NULL_CHECK(dev, return_buf);
+  NULL_CHECK(lgpu->handle, return_buf);
+
+  Fpx3d_Vk_UploadBatch batch = {0};
+
+  if (FPX3D_SUCCESS == __fpx3d_vk_begin_upload_batch(dev, lgpu, &batch)) {
+    if (FPX3D_SUCCESS != __fpx3d_vk_batch_new_buffer(&batch, data, size,
+                                                     usage_flags,
+                                                     &return_buf)) {
+      fpx3d_vk_discard_upload_batch(&batch);
+      return return_buf;
+    }
+
+    Fpx3d_Vk_UploadTicket ticket = 0;
+    if (FPX3D_SUCCESS != fpx3d_vk_submit_upload_batch(&batch, &ticket) ||
+        FPX3D_SUCCESS != fpx3d_vk_wait_upload(lgpu, ticket)) {
+      __fpx3d_vk_destroy_buffer_object(lgpu, &return_buf);
+      memset(&return_buf, 0, sizeof(return_buf));
     }
+
+    return return_buf;
   }
 
-  if (0 > idx) {
-    // error
-    FPX3D_WARN("Could not find valid memory type");
-    return FPX3D_VK_ERROR;
+  // nothing to upload with; the buffer is host-visible instead
+  __fpx3d_vk_new_dynamic_buffer(dev, lgpu, size, usage_flags, &return_buf);
+
+  if (return_buf.isValid)
+    __fpx3d_vk_data_to_buffer(lgpu, &return_buf, data, size);
+
+  return return_buf;
+}
+
+// creates a device-local buffer holding `size` bytes of the file at `path`,
+// starting at `file_offset`. The file is read straight into a staging
+// buffer of `window_size` bytes (0 means STREAM_WINDOW_SIZE) in two
+// halves: while one half is copied into the buffer by the GPU, the next
+// part of the file is read into the other. Host memory use is bounded by
+// the window, however large the buffer is
+Fpx3d_E_Result __fpx3d_vk_new_buffer_from_file(
+    VkPhysicalDevice dev, Fpx3d_Vk_LogicalGpu *lgpu, const char *path,
+    size_t file_offset, VkDeviceSize size, VkBufferUsageFlags usage_flags,
+    size_t window_size, Fpx3d_Vk_Buffer *output) {
+  NULL_CHECK(dev, FPX3D_ARGS_ERROR);
+  NULL_CHECK(path, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  if (1 > size)
+    return FPX3D_ARGS_ERROR;
+
+  if (1 > window_size)
+    window_size = STREAM_WINDOW_SIZE;
+
+  void *file = NULL;
+  size_t file_size = 0;
+
+  Fpx3d_E_Result retval = __fpx3d_open_file(path, &file, &file_size);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  if (file_offset > file_size || size > file_size - file_offset) {
+    FPX3D_WARN("\"%s\" is too small for a %" LONG_FORMAT
+               "u byte buffer at offset %" LONG_FORMAT "u",
+               path, (size_t)size, file_offset);
+    __fpx3d_close_file(file);
+    return FPX3D_ARGS_ERROR;
   }
 
-  VkMemoryAllocateInfo m_info = {0};
-  m_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  m_info.allocationSize = mem_reqs.size;
-  m_info.memoryTypeIndex = idx;
+  VkCommandPool *graphics_pool = NULL;
+  VkQueue graphics_queue = VK_NULL_HANDLE;
 
-  if (VK_SUCCESS != vkAllocateMemory(lgpu->handle, &m_info, NULL, &new_mem)) {
-    FPX3D_WARN("Could not allocate buffer memory");
+  if (NULL != lgpu->commandPools)
+    graphics_pool = __fpx3d_vk_select_pool_of_type(GRAPHICS_POOL, lgpu);
 
-    return FPX3D_VK_ERROR;
+  if (NULL != graphics_pool && NULL != lgpu->graphicsQueues.queues &&
+      0 < lgpu->graphicsQueues.count) {
+    // the same queue upload batches use, so that frames submitted to it
+    // afterwards come after the copies, as they do after uploads
+    graphics_queue = lgpu->graphicsQueues.queues[0];
   }
 
-  *output = new_mem;
+  Fpx3d_Vk_Buffer staging = {0};
+  Fpx3d_Vk_Buffer new_buf = {0};
 
-  return FPX3D_SUCCESS;
+#define FROM_FILE_FAIL(code)                                                   \
+  {                                                                            \
+    retval = code;                                                             \
+    goto from_file_cleanup;                                                    \
+  }
+
+  // without a way to copy, the file goes straight into host-visible memory
+  if (VK_NULL_HANDLE == graphics_queue) {
+    retval = __fpx3d_vk_new_buffer(dev, lgpu, size, usage_flags,
+                                   VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                       VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                   VK_SHARING_MODE_EXCLUSIVE, &new_buf);
+    if (FPX3D_SUCCESS != retval)
+      FROM_FILE_FAIL(retval);
+
+    if (NULL == new_buf.mapped_memory)
+      FROM_FILE_FAIL(FPX3D_VK_ERROR);
+
+    void *buffers[] = {new_buf.mapped_memory};
+    size_t lengths[] = {(size_t)size};
+
+    retval = __fpx3d_read_file_scatter(file, file_offset, buffers, lengths, 1);
+
+    if (FPX3D_SUCCESS != retval)
+      FROM_FILE_FAIL(retval);
+
+    *output = new_buf;
+    new_buf = (Fpx3d_Vk_Buffer){0};
+
+    goto from_file_cleanup;
+  }
+
+  // small buffers don't need a window bigger than themselves
+  VkDeviceSize half_size = MIN((VkDeviceSize)window_size / 2, size);
+  half_size = MAX(half_size, (VkDeviceSize)1);
+
+  VkDeviceSize staging_size = (size > half_size) ? half_size * 2 : half_size;
+
+  retval = __fpx3d_vk_new_buffer(dev, lgpu, staging_size,
+                                 VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                     VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                 VK_SHARING_MODE_EXCLUSIVE, &staging);
+  if (FPX3D_SUCCESS != retval)
+    FROM_FILE_FAIL(retval);
+
+  if (NULL == staging.mapped_memory)
+    FROM_FILE_FAIL(FPX3D_VK_ERROR);
+
+  retval = __fpx3d_vk_new_buffer(
+      dev, lgpu, size, usage_flags | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, VK_SHARING_MODE_EXCLUSIVE,
+      &new_buf);
+  if (FPX3D_SUCCESS != retval)
+    FROM_FILE_FAIL(retval);
+
+  retval = _stream_chunks(lgpu, file, file_offset, size, &staging, half_size,
+                          &new_buf, graphics_queue, *graphics_pool);
+  if (FPX3D_SUCCESS != retval)
+    FROM_FILE_FAIL(retval);
+
+  *output = new_buf;
+  new_buf = (Fpx3d_Vk_Buffer){0};
+
+#undef FROM_FILE_FAIL
+
+from_file_cleanup:
+  __fpx3d_vk_destroy_buffer_object(lgpu, &new_buf);
+  __fpx3d_vk_destroy_buffer_object(lgpu, &staging);
+
+  __fpx3d_close_file(file);
+
+  return retval;
 }
 
-Fpx3d_E_Result __fpx3d_vk_new_buffer(
-    VkPhysicalDevice dev, Fpx3d_Vk_LogicalGpu *lgpu, VkDeviceSize size,
-    VkBufferUsageFlags usage, VkMemoryPropertyFlags mem_flags,
-    VkSharingMode sharing_mode, Fpx3d_Vk_Buffer *output_buffer) {
+void __fpx3d_vk_destroy_buffer_object(Fpx3d_Vk_LogicalGpu *lgpu,
+                                      Fpx3d_Vk_Buffer *buffer) {
+  if (VK_NULL_HANDLE != buffer->buffer)
+    vkDestroyBuffer(lgpu->handle, buffer->buffer, NULL);
+
+  __fpx3d_vk_free(lgpu, &buffer->allocation);
+
+  memset(buffer, 0, sizeof(*buffer));
+}
+
+// STATIC FUNCTIONS ----
+
+static Fpx3d_E_Result _new_buffer(VkPhysicalDevice dev,
+                                  Fpx3d_Vk_LogicalGpu *lgpu, VkDeviceSize size,
+                                  VkBufferUsageFlags usage,
+                                  VkMemoryPropertyFlags mem_flags,
+                                  VkMemoryPropertyFlags preferred_flags,
+                                  VkSharingMode sharing_mode,
+                                  Fpx3d_Vk_Buffer *output_buffer) {
   VkBuffer new_buf = {0};
-  VkDeviceMemory new_mem = {0};
+  Fpx3d_Vk_Allocation new_mem = {0};
 
   VkBufferCreateInfo b_info = {0};
 
@@ -132,7 +431,6 @@ Fpx3d_E_Result __fpx3d_vk_new_buffer(
       (0 <= lgpu->transferQueues.queueFamilyIndex &&
        lgpu->transferQueues.queueFamilyIndex !=
            lgpu->graphicsQueues.queueFamilyIndex)) {
-    sharing_mode = VK_SHARING_MODE_CONCURRENT;
     b_info.queueFamilyIndexCount = 2;
     b_info.pQueueFamilyIndices = indices;
   } else {
@@ -150,16 +448,18 @@ Fpx3d_E_Result __fpx3d_vk_new_buffer(
   vkGetBufferMemoryRequirements(lgpu->handle, new_buf, &mem_reqs);
 
   Fpx3d_E_Result mem_success =
-      __fpx3d_vk_new_memory(dev, lgpu, mem_flags, mem_reqs, &new_mem);
+      __fpx3d_vk_allocate(dev, lgpu, mem_flags, preferred_flags, mem_reqs,
+                          true, &new_mem);
   if (FPX3D_SUCCESS != mem_success) {
     vkDestroyBuffer(lgpu->handle, new_buf, NULL);
 
     return mem_success;
   }
 
-  if (VK_SUCCESS != vkBindBufferMemory(lgpu->handle, new_buf, new_mem, 0)) {
+  if (VK_SUCCESS != vkBindBufferMemory(lgpu->handle, new_buf, new_mem.memory,
+                                       new_mem.offset)) {
     // error
-    vkFreeMemory(lgpu->handle, new_mem, NULL);
+    __fpx3d_vk_free(lgpu, &new_mem);
     vkDestroyBuffer(lgpu->handle, new_buf, NULL);
 
     FPX3D_WARN("Could not bind buffer memory");
@@ -172,128 +472,124 @@ Fpx3d_E_Result __fpx3d_vk_new_buffer(
 
   output_buffer->buffer = new_buf;
 
-  output_buffer->memory = new_mem;
-
-  return FPX3D_SUCCESS;
-}
-
-Fpx3d_E_Result __fpx3d_vk_data_to_buffer(Fpx3d_Vk_LogicalGpu *lgpu,
-                                         Fpx3d_Vk_Buffer *buf, void *data,
-                                         VkDeviceSize size) {
-  void *mapped = NULL;
-  if (VK_SUCCESS != vkMapMemory(lgpu->handle, buf->memory, 0, size, 0, &mapped))
-    return FPX3D_VK_ERROR;
-
-  memcpy(mapped, data, size);
-
-  vkUnmapMemory(lgpu->handle, buf->memory);
-
-  return FPX3D_SUCCESS;
-}
-
-Fpx3d_E_Result __fpx3d_vk_bufcopy(VkDevice lgpu, VkQueue transfer_queue,
-                                  Fpx3d_Vk_Buffer *src, Fpx3d_Vk_Buffer *dst,
-                                  VkDeviceSize size,
-                                  VkCommandPool transfer_cmd_pool) {
-  VkCommandBuffer cbuffer =
-      __fpx3d_vk_begin_temp_command_buffer(transfer_cmd_pool, lgpu);
-
-  VkBufferCopy region = {0};
-  region.srcOffset = 0;
-  region.dstOffset = 0;
-  region.size = size;
-
-  vkCmdCopyBuffer(cbuffer, src->buffer, dst->buffer, 1, &region);
-
-  __fpx3d_vk_end_temp_command_buffer(cbuffer, transfer_cmd_pool, transfer_queue,
-                                     lgpu);
+  output_buffer->allocation = new_mem;
+  output_buffer->memory = new_mem.memory;
+  output_buffer->mapped_memory = new_mem.mapped;
 
   return FPX3D_SUCCESS;
 }
 
-Fpx3d_Vk_Buffer
-__fpx3d_vk_new_buffer_with_data(VkPhysicalDevice dev, Fpx3d_Vk_LogicalGpu *lgpu,
-                                void *data, VkDeviceSize size,
-                                VkBufferUsageFlags usage_flags) {
-  // TODO: Currently when using a staging buffer, both of the buffers will be
-  // VK_SHARING_MODE_CONCURRENT. This can be changed by using
-  // VkBufferMemoryBarriers
+// one command buffer and fence per half of the staging buffer. A half is
+// only refilled once the copy out of it has finished
+static Fpx3d_E_Result _stream_chunks(Fpx3d_Vk_LogicalGpu *lgpu, void *file,
+                                     size_t file_offset, VkDeviceSize size,
+                                     Fpx3d_Vk_Buffer *staging,
+                                     VkDeviceSize half_size,
+                                     Fpx3d_Vk_Buffer *dst, VkQueue queue,
+                                     VkCommandPool pool) {
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  VkCommandBuffer cbuffers[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+  VkFence fences[2] = {VK_NULL_HANDLE, VK_NULL_HANDLE};
+  bool submitted[2] = {false, false};
+
+  VkCommandBufferAllocateInfo b_info = {0};
+  b_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  b_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  b_info.commandPool = pool;
+  b_info.commandBufferCount = 2;
+
+  if (VK_SUCCESS != vkAllocateCommandBuffers(lgpu->handle, &b_info, cbuffers))
+    return FPX3D_VK_COMMAND_BUFFER_FAULT;
+
+  VkFenceCreateInfo f_info = {.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+
+  for (size_t i = 0; i < ARRAY_SIZE(fences); ++i) {
+    if (VK_SUCCESS != vkCreateFence(lgpu->handle, &f_info, NULL, &fences[i]))
+      retval = FPX3D_VK_ERROR;
+  }
 
-  FPX3D_TODO("Change VK_SHARING_MODE_CONCURRENT to VK_SHARING_MODE_EXCLUSIVE "
-             "for _new_buffer_with_data()")
+  VkDeviceSize done = 0;
 
-  Fpx3d_Vk_Buffer s_buf = {0};
-  Fpx3d_Vk_Buffer return_buf = {0};
+  for (size_t chunk = 0; FPX3D_SUCCESS == retval && done < size; ++chunk) {
+    size_t half = chunk % 2;
+    VkDeviceSize length = MIN(half_size, size - done);
 
-  NULL_CHECK(dev, return_buf);
-  NULL_CHECK(lgpu->handle, return_buf);
-
-  bool use_staging = true;
+    if (submitted[half]) {
+      vkWaitForFences(lgpu->handle, 1, &fences[half], VK_TRUE, UINT64_MAX);
+      vkResetFences(lgpu->handle, 1, &fences[half]);
+      submitted[half] = false;
+    }
 
-  VkQueue *graphics_queue = VK_NULL_HANDLE;
-  VkCommandPool *graphics_pool = VK_NULL_HANDLE;
-  if (NULL != lgpu->commandPools) {
-    graphics_pool = __fpx3d_vk_select_pool_of_type(GRAPHICS_POOL, lgpu);
-  }
+    // the other half is being copied in the meantime
+    void *buffers[] = {(uint8_t *)staging->mapped_memory + half * half_size};
+    size_t lengths[] = {(size_t)length};
 
-  use_staging = (NULL != graphics_pool);
+    retval = __fpx3d_read_file_scatter(file, file_offset + (size_t)done,
+                                       buffers, lengths, 1);
+    if (FPX3D_SUCCESS != retval)
+      break;
 
-  if (use_staging) {
-    if (NULL != lgpu->graphicsQueues.queues && lgpu->graphicsQueues.count > 0) {
-      graphics_queue =
-          &lgpu->graphicsQueues.queues[lgpu->graphicsQueues.nextToUse++];
-    } else {
-      use_staging = false;
+    VkCommandBufferBeginInfo begin = {0};
+    begin.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    vkBeginCommandBuffer(cbuffers[half], &begin);
+
+    VkBufferCopy region = {0};
+    region.srcOffset = half * half_size;
+    region.dstOffset = done;
+    region.size = length;
+
+    vkCmdCopyBuffer(cbuffers[half], staging->buffer, dst->buffer, 1, &region);
+
+    // a barrier also waits for what was submitted to the queue before it,
+    // so one after the last copy makes every chunk visible to vertex input
+    if (done + length == size) {
+      VkBufferMemoryBarrier barrier = {0};
+      barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+      barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+      barrier.dstAccessMask =
+          VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+      barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+      barrier.buffer = dst->buffer;
+      barrier.offset = 0;
+      barrier.size = VK_WHOLE_SIZE;
+
+      vkCmdPipelineBarrier(cbuffers[half], VK_PIPELINE_STAGE_TRANSFER_BIT,
+                           VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, NULL, 1,
+                           &barrier, 0, NULL);
     }
-  }
 
-  lgpu->graphicsQueues.nextToUse %= lgpu->graphicsQueues.count;
+    vkEndCommandBuffer(cbuffers[half]);
 
-  VkBufferUsageFlags u_flags = usage_flags;
-  VkSharingMode s_mode = VK_SHARING_MODE_EXCLUSIVE;
-  VkMemoryPropertyFlags m_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                  VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    VkSubmitInfo s_info = {0};
+    s_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    s_info.commandBufferCount = 1;
+    s_info.pCommandBuffers = &cbuffers[half];
 
-  if (use_staging) {
-    __fpx3d_vk_new_buffer(dev, lgpu, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                              VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          VK_SHARING_MODE_CONCURRENT, &s_buf);
-
-    if (false == s_buf.isValid)
-      use_staging = false;
-    else {
-      u_flags |= VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-      s_mode = VK_SHARING_MODE_CONCURRENT;
-      m_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-
-      __fpx3d_vk_data_to_buffer(lgpu, &s_buf, data, size);
+    if (VK_SUCCESS != vkQueueSubmit(queue, 1, &s_info, fences[half])) {
+      FPX3D_ERROR("Command buffer submission failed");
+      retval = FPX3D_VK_ERROR;
+      break;
     }
-  }
-
-  __fpx3d_vk_new_buffer(dev, lgpu, size, u_flags, m_flags, s_mode, &return_buf);
 
-  if (use_staging) {
-    __fpx3d_vk_bufcopy(lgpu->handle, *graphics_queue, &s_buf, &return_buf, size,
-                       *graphics_pool);
-    __fpx3d_vk_destroy_buffer_object(lgpu, &s_buf);
-  } else {
-    __fpx3d_vk_data_to_buffer(lgpu, &return_buf, data, size);
+    submitted[half] = true;
+    done += length;
   }
 
-  return return_buf;
-}
+  for (size_t i = 0; i < ARRAY_SIZE(fences); ++i) {
+    if (submitted[i])
+      vkWaitForFences(lgpu->handle, 1, &fences[i], VK_TRUE, UINT64_MAX);
 
-void __fpx3d_vk_destroy_buffer_object(Fpx3d_Vk_LogicalGpu *lgpu,
-                                      Fpx3d_Vk_Buffer *buffer) {
-  if (VK_NULL_HANDLE != buffer->buffer)
-    vkDestroyBuffer(lgpu->handle, buffer->buffer, NULL);
-
-  if (NULL != buffer->mapped_memory)
-    vkUnmapMemory(lgpu->handle, buffer->memory);
+    if (VK_NULL_HANDLE != fences[i])
+      vkDestroyFence(lgpu->handle, fences[i], NULL);
+  }
 
-  if (VK_NULL_HANDLE != buffer->memory)
-    vkFreeMemory(lgpu->handle, buffer->memory, NULL);
+  vkFreeCommandBuffers(lgpu->handle, pool, 2, cbuffers);
 
-  memset(buffer, 0, sizeof(*buffer));
+  return retval;
 }
+
+// END OF STATIC FUNCTIONS ----
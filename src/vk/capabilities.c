@@ -0,0 +1,409 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+#include "volk/volk.h"
+
+#include "vk/context.h"
+#include "vk/typedefs.h"
+
+#include "vk/capabilities.h"
+
+#define CACHE_MAGIC 0x53504143u // "CAPS"
+#define CACHE_VERSION 1
+
+// sanity limits for counts read from a cache file
+#define MAX_QUEUE_FAMILIES 64
+#define MAX_EXTENSIONS 4096
+
+extern uint64_t __fpx3d_hash64(const void *data, size_t length,
+                               uint64_t seed);
+
+// cache files are this, followed by the features, memory properties,
+// queue families, extensions and formats
+struct _cache_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t queueFamilyCount;
+  uint32_t extensionCount;
+  uint32_t formatCount;
+  uint32_t reserved;
+  uint64_t key;
+};
+
+// static declarations ----
+
+static Fpx3d_E_Result _query(VkPhysicalDevice, Fpx3d_Vk_Capabilities *);
+static Fpx3d_E_Result _build_extension_set(Fpx3d_Vk_Capabilities *);
+static int64_t _find_extension(const Fpx3d_Vk_Capabilities *,
+                               const char *name);
+
+static uint64_t _device_key(const VkPhysicalDeviceProperties *);
+static char *_cache_path(const char *directory, uint64_t key);
+static bool _cache_load(const char *path, uint64_t key,
+                        Fpx3d_Vk_Capabilities *);
+static void _cache_store(const char *path, uint64_t key,
+                         const Fpx3d_Vk_Capabilities *);
+
+// end of static declarations ----
+
+Fpx3d_E_Result __fpx3d_vk_snapshot_capabilities(VkPhysicalDevice dev,
+                                                const char *cache_directory,
+                                                Fpx3d_Vk_Capabilities *output) {
+  NULL_CHECK(dev, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  Fpx3d_Vk_Capabilities caps = {0};
+  caps.device = dev;
+
+  vkGetPhysicalDeviceProperties(dev, &caps.properties);
+
+  uint64_t key = _device_key(&caps.properties);
+  char *path = NULL;
+
+  if (NULL != cache_directory)
+    path = _cache_path(cache_directory, key);
+
+  if (NULL != path && _cache_load(path, key, &caps)) {
+    caps.fromCache = true;
+  } else {
+    Fpx3d_E_Result success = _query(dev, &caps);
+
+    if (FPX3D_SUCCESS != success) {
+      FREE_SAFE(path);
+      FREE_SAFE(caps.queueFamilies);
+      FREE_SAFE(caps.extensions);
+
+      return success;
+    }
+
+    if (NULL != path)
+      _cache_store(path, key, &caps);
+  }
+
+  FREE_SAFE(path);
+
+  {
+    Fpx3d_E_Result success = _build_extension_set(&caps);
+
+    if (FPX3D_SUCCESS != success) {
+      FREE_SAFE(caps.queueFamilies);
+      FREE_SAFE(caps.extensions);
+
+      return success;
+    }
+  }
+
+  FPX3D_DEBUG("Capabilities of \"%s\" %s", caps.properties.deviceName,
+              CONDITIONAL(caps.fromCache, "read from cache", "queried"));
+
+  caps.isValid = true;
+  *output = caps;
+
+  return FPX3D_SUCCESS;
+}
+
+void __fpx3d_vk_destroy_capabilities(Fpx3d_Vk_Capabilities *caps) {
+  NULL_CHECK(caps, );
+
+  FREE_SAFE(caps->queueFamilies);
+  FREE_SAFE(caps->extensions);
+  FREE_SAFE(caps->extensionSet);
+
+  memset(caps, 0, sizeof(*caps));
+}
+
+const Fpx3d_Vk_Capabilities *fpx3d_vk_get_capabilities(Fpx3d_Vk_Context *ctx) {
+  NULL_CHECK(ctx, NULL);
+  NULL_CHECK(ctx->physicalGpu, NULL);
+
+  if (ctx->capabilities.isValid &&
+      ctx->capabilities.device == ctx->physicalGpu)
+    return &ctx->capabilities;
+
+  __fpx3d_vk_destroy_capabilities(&ctx->capabilities);
+
+  if (FPX3D_SUCCESS !=
+      __fpx3d_vk_snapshot_capabilities(ctx->physicalGpu,
+                                       ctx->capabilityCacheDirectory,
+                                       &ctx->capabilities))
+    return NULL;
+
+  return &ctx->capabilities;
+}
+
+bool fpx3d_vk_capabilities_have_extensions(const Fpx3d_Vk_Capabilities *caps,
+                                           const char **extensions,
+                                           size_t extension_count) {
+  NULL_CHECK(caps, false);
+  NULL_CHECK(extensions, true);
+
+  for (size_t i = 0; i < extension_count; ++i) {
+    if (0 > _find_extension(caps, extensions[i]))
+      return false;
+  }
+
+  return true;
+}
+
+VkFormatProperties
+fpx3d_vk_capabilities_format(const Fpx3d_Vk_Capabilities *caps,
+                             VkFormat format) {
+  VkFormatProperties props = {0};
+
+  NULL_CHECK(caps, props);
+
+  if (FPX3D_VK_CORE_FORMAT_COUNT > (uint32_t)format)
+    return caps->formats[format];
+
+  vkGetPhysicalDeviceFormatProperties(caps->device, format, &props);
+
+  return props;
+}
+
+// STATIC FUNCTIONS ----
+
+static Fpx3d_E_Result _query(VkPhysicalDevice dev,
+                             Fpx3d_Vk_Capabilities *caps) {
+  vkGetPhysicalDeviceFeatures(dev, &caps->features);
+  vkGetPhysicalDeviceMemoryProperties(dev, &caps->memoryProperties);
+
+  vkGetPhysicalDeviceQueueFamilyProperties(dev, &caps->queueFamilyCount,
+                                           NULL);
+
+  if (0 < caps->queueFamilyCount) {
+    caps->queueFamilies = (VkQueueFamilyProperties *)calloc(
+        caps->queueFamilyCount, sizeof(VkQueueFamilyProperties));
+
+    if (NULL == caps->queueFamilies) {
+      perror("calloc()");
+      return FPX3D_MEMORY_ERROR;
+    }
+
+    vkGetPhysicalDeviceQueueFamilyProperties(dev, &caps->queueFamilyCount,
+                                             caps->queueFamilies);
+  }
+
+  vkEnumerateDeviceExtensionProperties(dev, NULL, &caps->extensionCount,
+                                       NULL);
+
+  if (0 < caps->extensionCount) {
+    caps->extensions = (VkExtensionProperties *)calloc(
+        caps->extensionCount, sizeof(VkExtensionProperties));
+
+    if (NULL == caps->extensions) {
+      perror("calloc()");
+      return FPX3D_MEMORY_ERROR;
+    }
+
+    vkEnumerateDeviceExtensionProperties(dev, NULL, &caps->extensionCount,
+                                         caps->extensions);
+  }
+
+  for (size_t i = 0; i < FPX3D_VK_CORE_FORMAT_COUNT; ++i)
+    vkGetPhysicalDeviceFormatProperties(dev, (VkFormat)i, &caps->formats[i]);
+
+  return FPX3D_SUCCESS;
+}
+
+// open addressing at a load factor of at most one half
+static Fpx3d_E_Result _build_extension_set(Fpx3d_Vk_Capabilities *caps) {
+  size_t capacity = 16;
+  while (capacity < (size_t)caps->extensionCount * 2)
+    capacity *= 2;
+
+  caps->extensionSet = (uint32_t *)calloc(capacity, sizeof(uint32_t));
+  if (NULL == caps->extensionSet) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  caps->extensionSetCapacity = capacity;
+
+  for (uint32_t i = 0; i < caps->extensionCount; ++i) {
+    const char *name = caps->extensions[i].extensionName;
+    size_t slot = __fpx3d_hash64(name, strlen(name), 0) & (capacity - 1);
+
+    while (0 != caps->extensionSet[slot])
+      slot = (slot + 1) & (capacity - 1);
+
+    caps->extensionSet[slot] = i + 1;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+static int64_t _find_extension(const Fpx3d_Vk_Capabilities *caps,
+                               const char *name) {
+  NULL_CHECK(caps->extensionSet, -1);
+  NULL_CHECK(name, -1);
+
+  size_t mask = caps->extensionSetCapacity - 1;
+  size_t slot = __fpx3d_hash64(name, strlen(name), 0) & mask;
+
+  for (; 0 != caps->extensionSet[slot]; slot = (slot + 1) & mask) {
+    uint32_t index = caps->extensionSet[slot] - 1;
+
+    if (0 == strcmp(name, caps->extensions[index].extensionName))
+      return index;
+  }
+
+  return -1;
+}
+
+// a driver update or another GPU gets another key, and so another file
+static uint64_t _device_key(const VkPhysicalDeviceProperties *props) {
+  uint32_t ids[] = {props->vendorID, props->deviceID, props->driverVersion,
+                    props->apiVersion, VK_HEADER_VERSION};
+
+  uint64_t key = __fpx3d_hash64(ids, sizeof(ids), 0);
+
+  return __fpx3d_hash64(props->pipelineCacheUUID,
+                        sizeof(props->pipelineCacheUUID), key);
+}
+
+static char *_cache_path(const char *directory, uint64_t key) {
+  // separator, 16 hex digits, ".caps" and the terminator
+  size_t length = strlen(directory) + 1 + 16 + 5 + 1;
+
+  char *path = (char *)malloc(length);
+  if (NULL == path) {
+    perror("malloc()");
+    return NULL;
+  }
+
+  snprintf(path, length, "%s/%016llx.caps", directory,
+           (unsigned long long)key);
+
+  return path;
+}
+
+// a file that is missing, cut short or made for another device is a miss
+static bool _cache_load(const char *path, uint64_t key,
+                        Fpx3d_Vk_Capabilities *caps) {
+  FILE *fp = fopen(path, "rb");
+  if (NULL == fp)
+    return false;
+
+  struct _cache_header header = {0};
+
+  if (1 != fread(&header, sizeof(header), 1, fp) ||
+      CACHE_MAGIC != header.magic || CACHE_VERSION != header.version ||
+      key != header.key || FPX3D_VK_CORE_FORMAT_COUNT != header.formatCount ||
+      MAX_QUEUE_FAMILIES < header.queueFamilyCount ||
+      MAX_EXTENSIONS < header.extensionCount) {
+    fclose(fp);
+    return false;
+  }
+
+  VkQueueFamilyProperties *families = (VkQueueFamilyProperties *)calloc(
+      MAX(header.queueFamilyCount, 1), sizeof(VkQueueFamilyProperties));
+  VkExtensionProperties *extensions = (VkExtensionProperties *)calloc(
+      MAX(header.extensionCount, 1), sizeof(VkExtensionProperties));
+
+  if (NULL == families || NULL == extensions) {
+    perror("calloc()");
+    FREE_SAFE(families);
+    FREE_SAFE(extensions);
+    fclose(fp);
+    return false;
+  }
+
+  bool read =
+      (1 == fread(&caps->features, sizeof(caps->features), 1, fp)) &&
+      (1 == fread(&caps->memoryProperties, sizeof(caps->memoryProperties), 1,
+                  fp)) &&
+      (header.queueFamilyCount == fread(families, sizeof(*families),
+                                        header.queueFamilyCount, fp)) &&
+      (header.extensionCount == fread(extensions, sizeof(*extensions),
+                                      header.extensionCount, fp)) &&
+      (FPX3D_VK_CORE_FORMAT_COUNT ==
+       fread(caps->formats, sizeof(*caps->formats), FPX3D_VK_CORE_FORMAT_COUNT,
+             fp));
+
+  fclose(fp);
+
+  if (false == read) {
+    FREE_SAFE(families);
+    FREE_SAFE(extensions);
+    return false;
+  }
+
+  // names written by someone else might not be terminated
+  for (uint32_t i = 0; i < header.extensionCount; ++i)
+    extensions[i].extensionName[VK_MAX_EXTENSION_NAME_SIZE - 1] = '\0';
+
+  caps->queueFamilies = families;
+  caps->queueFamilyCount = header.queueFamilyCount;
+  caps->extensions = extensions;
+  caps->extensionCount = header.extensionCount;
+
+  return true;
+}
+
+// written next to the final name first, so other processes never read
+// half a file
+static void _cache_store(const char *path, uint64_t key,
+                         const Fpx3d_Vk_Capabilities *caps) {
+  // room for ".tmp"
+  size_t length = strlen(path) + 4 + 1;
+
+  char *temp_path = (char *)malloc(length);
+  if (NULL == temp_path) {
+    perror("malloc()");
+    return;
+  }
+
+  snprintf(temp_path, length, "%s.tmp", path);
+
+  FILE *fp = fopen(temp_path, "wb");
+  if (NULL == fp) {
+    FPX3D_WARN("Could not write capability cache file %s", temp_path);
+    FREE_SAFE(temp_path);
+    return;
+  }
+
+  struct _cache_header header = {
+      .magic = CACHE_MAGIC,
+      .version = CACHE_VERSION,
+      .queueFamilyCount = caps->queueFamilyCount,
+      .extensionCount = caps->extensionCount,
+      .formatCount = FPX3D_VK_CORE_FORMAT_COUNT,
+      .key = key,
+  };
+
+  bool written =
+      (1 == fwrite(&header, sizeof(header), 1, fp)) &&
+      (1 == fwrite(&caps->features, sizeof(caps->features), 1, fp)) &&
+      (1 == fwrite(&caps->memoryProperties, sizeof(caps->memoryProperties), 1,
+                   fp)) &&
+      (caps->queueFamilyCount == fwrite(caps->queueFamilies,
+                                        sizeof(*caps->queueFamilies),
+                                        caps->queueFamilyCount, fp)) &&
+      (caps->extensionCount == fwrite(caps->extensions,
+                                      sizeof(*caps->extensions),
+                                      caps->extensionCount, fp)) &&
+      (FPX3D_VK_CORE_FORMAT_COUNT ==
+       fwrite(caps->formats, sizeof(*caps->formats),
+              FPX3D_VK_CORE_FORMAT_COUNT, fp));
+
+  if (0 != fclose(fp))
+    written = false;
+
+  if (false == written || 0 != rename(temp_path, path))
+    remove(temp_path);
+
+  FREE_SAFE(temp_path);
+}
+
+// END OF STATIC FUNCTIONS ----
@@ -27,6 +27,20 @@ extern Fpx3d_E_Result __fpx3d_realloc_array(void **arr_ptr, size_t obj_size,
                                             size_t amount,
                                             size_t *old_capacity);
 
+extern void __fpx3d_vk_residency_touch(struct fpx3d_vk_residency_entry *,
+                                       uint64_t frame_index);
+
+extern Fpx3d_E_Result __fpx3d_vk_write_descriptor_data(Fpx3d_Vk_LogicalGpu *,
+                                                       Fpx3d_Vk_DescriptorSet *,
+                                                       const void *raw_data);
+
+extern void __fpx3d_vk_dynamic_draw_range(Fpx3d_Vk_LogicalGpu *,
+                                          const Fpx3d_Vk_ShapeBuffer *,
+                                          int32_t *vertex_offset,
+                                          uint32_t *vertex_count,
+                                          uint32_t *first_index,
+                                          uint32_t *index_count);
+
 VkCommandPool *__fpx3d_vk_select_pool_of_type(Fpx3d_Vk_E_CommandPoolType,
                                               Fpx3d_Vk_LogicalGpu *);
 
@@ -332,17 +346,35 @@ Fpx3d_E_Result fpx3d_vk_record_drawing_commandbuffer(
 
   Fpx3d_Vk_DescriptorSet *pipeline_ds =
       &pipeline->bindings.inFlightDescriptorSets[lgpu->frameCounter];
-  memcpy(pipeline_ds->buffer.mapped_memory, pipeline->bindings.rawBufferData,
-         pipeline_ds->buffer.objectCount * pipeline_ds->buffer.stride);
+  __fpx3d_vk_write_descriptor_data(lgpu, pipeline_ds,
+                                   pipeline->bindings.rawBufferData);
+
+  // shapes of the same mesh arena share these, so they're only bound when
+  // they change
+  VkBuffer bound_vertices = VK_NULL_HANDLE;
+  VkBuffer bound_indices = VK_NULL_HANDLE;
 
   for (size_t i = 0; i < pipeline->graphics.shapeCount; ++i) {
-    // TODO: fix hardcoded stuff like instanceCount, firstVertex and other args
+    // TODO: fix hardcoded stuff like instanceCount and firstInstance
 
     Fpx3d_Vk_Shape *shape = pipeline->graphics.shapes[i];
 
     if (false == shape->isValid)
       continue;
 
+    if (NULL != shape->shapeBuffer->residency)
+      __fpx3d_vk_residency_touch(shape->shapeBuffer->residency,
+                                 lgpu->frameIndex);
+
+    // evicted; fpx3d_vk_residency_update() brings it back for a later frame
+    if (false == shape->shapeBuffer->vertexBuffer.isValid)
+      continue;
+
+    // shapes only read from their shape buffer, but uploads into it need
+    // to know which frames still might
+    ((Fpx3d_Vk_ShapeBuffer *)shape->shapeBuffer)->lastDrawnFrame =
+        lgpu->frameIndex + 1;
+
     if (NULL != shape->bindings.inFlightDescriptorSets &&
         NULL != shape->bindings.rawBufferData) {
       Fpx3d_Vk_DescriptorSet *shape_ds =
@@ -354,26 +386,43 @@ Fpx3d_E_Result fpx3d_vk_record_drawing_commandbuffer(
           *buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->layout.handle,
           DESCRIPTOR_SET_INDEX_PIPELINE, 2, bind_sets, 0, NULL);
 
-      memcpy(shape_ds->buffer.mapped_memory, shape->bindings.rawBufferData,
-             shape_ds->buffer.objectCount * shape_ds->buffer.stride);
+      __fpx3d_vk_write_descriptor_data(lgpu, shape_ds,
+                                       shape->bindings.rawBufferData);
     }
 
-    VkDeviceSize offset = 0;
+    const Fpx3d_Vk_ShapeBuffer *sb = shape->shapeBuffer;
+
+    int32_t vertex_offset = sb->vertexOffset;
+    uint32_t vertex_count = (uint32_t)sb->vertexBuffer.objectCount;
+    uint32_t first_index = sb->firstIndex;
+    uint32_t index_count = (uint32_t)sb->indexBuffer.objectCount;
+
+    if (NULL != sb->dynamic)
+      __fpx3d_vk_dynamic_draw_range(lgpu, sb, &vertex_offset, &vertex_count,
+                                    &first_index, &index_count);
 
-    vkCmdBindVertexBuffers(*buffer, 0, 1,
-                           &shape->shapeBuffer->vertexBuffer.buffer, &offset);
+    if (bound_vertices != sb->vertexBuffer.buffer) {
+      VkDeviceSize offset = 0;
 
-    if (VK_NULL_HANDLE == shape->shapeBuffer->indexBuffer.buffer ||
-        VK_NULL_HANDLE == shape->shapeBuffer->indexBuffer.memory) {
+      vkCmdBindVertexBuffers(*buffer, 0, 1, &sb->vertexBuffer.buffer, &offset);
+      bound_vertices = sb->vertexBuffer.buffer;
+    }
+
+    if (VK_NULL_HANDLE == sb->indexBuffer.buffer ||
+        VK_NULL_HANDLE == sb->indexBuffer.memory || 0 == index_count) {
       // normal draw, using the given vertices
       // because there's no index buffer
-      vkCmdDraw(*buffer, shape->shapeBuffer->vertexBuffer.objectCount, 1, 0, 0);
+      vkCmdDraw(*buffer, vertex_count, 1, (uint32_t)vertex_offset, 0);
     } else {
       // we have an index buffer
-      vkCmdBindIndexBuffer(*buffer, shape->shapeBuffer->indexBuffer.buffer, 0,
-                           VK_INDEX_TYPE_UINT32);
-      vkCmdDrawIndexed(*buffer, shape->shapeBuffer->indexBuffer.objectCount, 1,
-                       0, 0, 0);
+      if (bound_indices != sb->indexBuffer.buffer) {
+        vkCmdBindIndexBuffer(*buffer, sb->indexBuffer.buffer, 0,
+                             VK_INDEX_TYPE_UINT32);
+        bound_indices = sb->indexBuffer.buffer;
+      }
+
+      vkCmdDrawIndexed(*buffer, index_count, 1, first_index, vertex_offset,
+                       0);
     }
   }
 
@@ -423,8 +472,11 @@ Fpx3d_E_Result fpx3d_vk_submit_commandbuffer(VkCommandBuffer *buffer,
                                   lgpu->inFlightFences[lgpu->frameCounter]))
     return FPX3D_VK_ERROR;
 
+  lgpu->inFlightFrames[lgpu->frameCounter] = lgpu->frameIndex + 1;
+
   lgpu->frameCounter =
       (lgpu->frameCounter + 1) % ctx->constants.maxFramesInFlight;
+  ++lgpu->frameIndex;
 
   return FPX3D_SUCCESS;
 }
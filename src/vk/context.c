@@ -25,6 +25,11 @@
 
 extern void __fpx3d_vk_destroy_lgpu(Fpx3d_Vk_Context *, Fpx3d_Vk_LogicalGpu *);
 
+extern Fpx3d_E_Result
+__fpx3d_vk_snapshot_capabilities(VkPhysicalDevice, const char *cache_directory,
+                                 Fpx3d_Vk_Capabilities *output);
+extern void __fpx3d_vk_destroy_capabilities(Fpx3d_Vk_Capabilities *);
+
 Fpx3d_E_Result fpx3d_vk_init_context(Fpx3d_Vk_Context *ctx,
                                      Fpx3d_Wnd_Context *wnd) {
   NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
@@ -152,6 +157,8 @@ Fpx3d_E_Result fpx3d_vk_destroy_instance(Fpx3d_Vk_Context *ctx,
 
   ctx->logicalGpuCapacity = 0;
 
+  __fpx3d_vk_destroy_capabilities(&ctx->capabilities);
+
   if (VK_NULL_HANDLE != ctx->vkInstance)
     vkDestroySurfaceKHR(ctx->vkInstance, ctx->vkSurface, NULL);
 
@@ -272,8 +279,17 @@ Fpx3d_E_Result fpx3d_vk_select_gpu(
   FREE_SAFE(gpus);
   FREE_SAFE(scored_gpus);
 
-  VkPhysicalDeviceProperties dev_props = {0};
-  vkGetPhysicalDeviceProperties(ctx->physicalGpu, &dev_props);
+  __fpx3d_vk_destroy_capabilities(&ctx->capabilities);
+
+  if (0 == retval) {
+    Fpx3d_E_Result success = __fpx3d_vk_snapshot_capabilities(
+        ctx->physicalGpu, ctx->capabilityCacheDirectory, &ctx->capabilities);
+
+    if (FPX3D_SUCCESS != success)
+      return success;
+  }
+
+  VkPhysicalDeviceProperties dev_props = ctx->capabilities.properties;
 
   ctx->constants.bufferAlignment =
       MAX(dev_props.limits.minUniformBufferOffsetAlignment,
@@ -23,14 +23,29 @@ extern Fpx3d_E_Result __fpx3d_realloc_array(void **arr_ptr, size_t obj_size,
                                             size_t *old_capacity);
 
 extern Fpx3d_E_Result
-__fpx3d_vk_new_buffer(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
-                      VkDeviceSize size, VkBufferUsageFlags usage,
-                      VkMemoryPropertyFlags mem_flags, VkSharingMode,
-                      Fpx3d_Vk_Buffer *output_buffer);
+__fpx3d_vk_new_dynamic_buffer(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
+                              VkDeviceSize size, VkBufferUsageFlags usage,
+                              Fpx3d_Vk_Buffer *output_buffer);
+extern Fpx3d_E_Result __fpx3d_vk_write_buffer(Fpx3d_Vk_LogicalGpu *,
+                                              const Fpx3d_Vk_Buffer *,
+                                              VkDeviceSize offset,
+                                              const void *data,
+                                              VkDeviceSize size);
+extern Fpx3d_E_Result __fpx3d_vk_flush_allocation(Fpx3d_Vk_LogicalGpu *,
+                                                  const Fpx3d_Vk_Allocation *,
+                                                  VkDeviceSize offset,
+                                                  VkDeviceSize size);
 
 extern void __fpx3d_vk_destroy_buffer_object(Fpx3d_Vk_LogicalGpu *lgpu,
                                              Fpx3d_Vk_Buffer *buffer);
 
+void __fpx3d_vk_mark_descriptors_dirty(Fpx3d_Vk_DescriptorSet *sets,
+                                       size_t set_count, size_t offset,
+                                       size_t size);
+Fpx3d_E_Result __fpx3d_vk_write_descriptor_data(Fpx3d_Vk_LogicalGpu *,
+                                                Fpx3d_Vk_DescriptorSet *,
+                                                const void *raw_data);
+
 // static declarations --------------------------------------------
 static Fpx3d_E_Result _bind_descriptors(Fpx3d_Vk_DescriptorSet *,
                                         Fpx3d_Vk_Context *,
@@ -222,20 +237,23 @@ Fpx3d_Vk_DescriptorSet fpx3d_vk_create_descriptor_set(
     return retval;
   }
 
-  __fpx3d_vk_new_buffer(
+  // rewritten every frame that its bindings change, so the GPU reads it
+  // from host-visible memory (device-local, if there is any like that)
+  __fpx3d_vk_new_dynamic_buffer(
       ctx->physicalGpu, lgpu, total_mem_size,
       VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT /* TODO: make not hard-coded */,
-      VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
-          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
-      VK_SHARING_MODE_EXCLUSIVE, &retval.buffer);
+      &retval.buffer);
 
   if (retval.buffer.isValid) {
-    if (VK_SUCCESS != vkMapMemory(lgpu->handle, retval.buffer.memory, 0,
-                                  VK_WHOLE_SIZE, 0,
-                                  &retval.buffer.mapped_memory)) {
+    // host-visible buffers come out of __fpx3d_vk_new_dynamic_buffer()
+    // mapped
+    if (NULL == retval.buffer.mapped_memory) {
       __fpx3d_vk_destroy_buffer_object(lgpu, &retval.buffer);
     } else {
       memset(retval.buffer.mapped_memory, 0, total_mem_size);
+      __fpx3d_vk_flush_allocation(lgpu, &retval.buffer.allocation, 0,
+                                  total_mem_size);
+
       retval.buffer.objectCount = 1;
       retval.buffer.stride = total_mem_size;
     }
@@ -277,6 +295,53 @@ Fpx3d_E_Result fpx3d_vk_destroy_descriptor_set(Fpx3d_Vk_DescriptorSet *set,
   return FPX3D_SUCCESS;
 }
 
+// the range stays dirty in each of the sets until that set's buffer is
+// written by __fpx3d_vk_write_descriptor_data()
+void __fpx3d_vk_mark_descriptors_dirty(Fpx3d_Vk_DescriptorSet *sets,
+                                       size_t set_count, size_t offset,
+                                       size_t size) {
+  NULL_CHECK(sets, );
+
+  if (0 == size)
+    return;
+
+  for (size_t i = 0; i < set_count; ++i) {
+    Fpx3d_Vk_DescriptorSet *set = &sets[i];
+
+    if (set->dirtyStart == set->dirtyEnd) {
+      set->dirtyStart = offset;
+      set->dirtyEnd = offset + size;
+    } else {
+      set->dirtyStart = MIN(set->dirtyStart, offset);
+      set->dirtyEnd = MAX(set->dirtyEnd, (offset + size));
+    }
+  }
+}
+
+// copies the dirty part of `raw_data` into the set's buffer. Only that
+// range is flushed, if the memory isn't coherent
+Fpx3d_E_Result __fpx3d_vk_write_descriptor_data(Fpx3d_Vk_LogicalGpu *lgpu,
+                                                Fpx3d_Vk_DescriptorSet *set,
+                                                const void *raw_data) {
+  NULL_CHECK(set, FPX3D_ARGS_ERROR);
+  NULL_CHECK(raw_data, FPX3D_ARGS_ERROR);
+
+  if (set->dirtyStart == set->dirtyEnd)
+    return FPX3D_SUCCESS;
+
+  Fpx3d_E_Result retval = __fpx3d_vk_write_buffer(
+      lgpu, &set->buffer, set->dirtyStart,
+      (const uint8_t *)raw_data + set->dirtyStart,
+      set->dirtyEnd - set->dirtyStart);
+
+  if (FPX3D_SUCCESS == retval) {
+    set->dirtyStart = 0;
+    set->dirtyEnd = 0;
+  }
+
+  return retval;
+}
+
 Fpx3d_E_Result fpx3d_vk_create_pipeline_descriptors(
     Fpx3d_Vk_Pipeline *pipeline, Fpx3d_Vk_DescriptorSetBinding *bindings,
     Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu) {
@@ -360,6 +425,11 @@ Fpx3d_E_Result fpx3d_vk_update_pipeline_descriptor(Fpx3d_Vk_Pipeline *pipeline,
   memcpy(destination, value,
          set_data->bindings[binding].bindingProperties.elementSize);
 
+  __fpx3d_vk_mark_descriptors_dirty(
+      set_data, ctx->constants.maxFramesInFlight,
+      destination - (uint8_t *)pipeline->bindings.rawBufferData,
+      set_data->bindings[binding].bindingProperties.elementSize);
+
   return FPX3D_SUCCESS;
 }
 
@@ -453,6 +523,11 @@ Fpx3d_E_Result fpx3d_vk_update_shape_descriptor(Fpx3d_Vk_Shape *shape,
 
     memcpy(buf_data_destination, value,
            set_data->bindings[binding].bindingProperties.elementSize);
+
+    __fpx3d_vk_mark_descriptors_dirty(
+        set_data, ctx->constants.maxFramesInFlight,
+        buf_data_destination - (uint8_t *)shape->bindings.rawBufferData,
+        set_data->bindings[binding].bindingProperties.elementSize);
     break;
 
   case DESC_IMAGE_SAMPLER:
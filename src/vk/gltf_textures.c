@@ -0,0 +1,786 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#include "model/gltf.h"
+#include "vk/gltf_textures.h"
+#include "vk/image.h"
+#include "vk/logical_gpu.h"
+#include "vk/texture_compression.h"
+#include "vk/typedefs.h"
+#include "vk/upload.h"
+
+// the library owns the stb_image implementation, so applications
+// linking against it only include the header
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb/stb_image.h"
+
+// every texture is uploaded as RGBA8; three-channel formats are rarely
+// supported with optimal tiling
+#define TEXTURE_CHANNELS 4
+
+extern Fpx3d_E_Result __fpx3d_parallel_for(size_t count, size_t thread_count,
+                                           void (*function)(void *, size_t),
+                                           void *context);
+
+extern Fpx3d_E_Result __fpx3d_read_files(const char *const *paths,
+                                         size_t count, bool direct,
+                                         uint8_t **outputs,
+                                         size_t *output_sizes,
+                                         Fpx3d_E_Result *results);
+
+extern const uint8_t *
+__fpx3d_model_gltf_view_data(const Fpx3d_Model_GltfAsset *asset,
+                             const Fpx3d_Model_GltfBufferView *view);
+
+extern Fpx3d_E_Result __fpx3d_vk_new_image_sampler(
+    Fpx3d_Vk_Context *, Fpx3d_Vk_LogicalGpu *, VkFilter mag_filter,
+    VkFilter min_filter, VkSamplerAddressMode addr_mode_u,
+    VkSamplerAddressMode addr_mode_v, bool anisotropy,
+    Fpx3d_Vk_ImageSampler *output);
+
+// the import steps, which the streamer (streaming.c) also goes through
+size_t
+__fpx3d_vk_gltf_used_images(const Fpx3d_Model_GltfAssetDescription *desc,
+                            size_t *output);
+Fpx3d_E_Result __fpx3d_vk_read_gltf_image_files(
+    const Fpx3d_Model_GltfAsset *asset, const char *base_directory,
+    const size_t *images, size_t count, uint8_t **files, size_t *file_sizes);
+Fpx3d_E_Result
+__fpx3d_vk_decode_gltf_image(const Fpx3d_Model_GltfAsset *asset,
+                             size_t image_index, const uint8_t *file,
+                             size_t file_size, uint8_t **pixels,
+                             uint32_t *width, uint32_t *height);
+Fpx3d_E_Result __fpx3d_vk_decode_image(const uint8_t *data, size_t length,
+                                       uint8_t **pixels, uint32_t *width,
+                                       uint32_t *height);
+void __fpx3d_vk_free_gltf_image(uint8_t *pixels);
+Fpx3d_E_Result __fpx3d_vk_upload_gltf_image(Fpx3d_Vk_Context *ctx,
+                                            Fpx3d_Vk_LogicalGpu *lgpu,
+                                            uint8_t *pixels, uint32_t width,
+                                            uint32_t height,
+                                            Fpx3d_Vk_Image *output);
+Fpx3d_E_Result __fpx3d_vk_batch_upload_gltf_image(Fpx3d_Vk_UploadBatch *batch,
+                                                  Fpx3d_Vk_Context *ctx,
+                                                  const uint8_t *pixels,
+                                                  uint32_t width,
+                                                  uint32_t height,
+                                                  Fpx3d_Vk_Image *output);
+Fpx3d_E_Result
+__fpx3d_vk_link_gltf_textures(const Fpx3d_Model_GltfAsset *asset,
+                              Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
+                              Fpx3d_Vk_GltfTextures *textures);
+
+// what a Fpx3d_Vk_ImageSampler is made of; glTF samplers that map to
+// the same key share one sampler
+struct _sampler_key {
+  VkFilter magFilter;
+  VkFilter minFilter;
+  VkSamplerAddressMode addressModeU;
+  VkSamplerAddressMode addressModeV;
+};
+
+struct _decoded_image {
+  uint8_t *pixels;
+  uint32_t width;
+  uint32_t height;
+
+  // replaces the pixels once they were compressed
+  Fpx3d_Vk_CompressedImage compressed;
+};
+
+struct _decode_job {
+  const Fpx3d_Model_GltfAsset *asset;
+
+  // indices into the asset's images, and the contents of the ones that
+  // live in files of their own
+  const size_t *images;
+  uint8_t **files;
+  const size_t *fileSizes;
+
+  // NULL to upload the pixels as they are. Normal maps go to BC5
+  const Fpx3d_Vk_CompressionConfig *compression;
+  const bool *normalMaps;
+  size_t compressionThreads;
+
+  struct _decoded_image *output;
+};
+
+// static declarations ----
+
+static Fpx3d_E_Result
+_import_textures(Fpx3d_Model_GltfAsset *asset, const char *base_directory,
+                 size_t thread_count, const Fpx3d_Vk_CompressionConfig *,
+                 Fpx3d_Vk_Context *, Fpx3d_Vk_LogicalGpu *,
+                 Fpx3d_Vk_GltfTextures *output);
+
+static bool *_normal_maps(const Fpx3d_Model_GltfAssetDescription *desc,
+                          const size_t *images, size_t count);
+
+static void _decode_image(void *job_ptr, size_t index);
+
+static Fpx3d_E_Result _upload_compressed(Fpx3d_Vk_Context *,
+                                         Fpx3d_Vk_LogicalGpu *,
+                                         const Fpx3d_Vk_CompressedImage *,
+                                         Fpx3d_Vk_Image *output);
+
+static char *_resolve_uri(const char *base_directory, const char *uri);
+
+static struct _sampler_key _sampler_key(const Fpx3d_Model_GltfSampler *);
+
+// end of static declarations ----
+
+Fpx3d_E_Result fpx3d_vk_import_gltf_textures(Fpx3d_Model_GltfAsset *asset,
+                                             const char *base_directory,
+                                             size_t thread_count,
+                                             Fpx3d_Vk_Context *ctx,
+                                             Fpx3d_Vk_LogicalGpu *lgpu,
+                                             Fpx3d_Vk_GltfTextures *output) {
+  return _import_textures(asset, base_directory, thread_count, NULL, ctx,
+                          lgpu, output);
+}
+
+Fpx3d_E_Result fpx3d_vk_import_gltf_textures_compressed(
+    Fpx3d_Model_GltfAsset *asset, const char *base_directory,
+    size_t thread_count, const Fpx3d_Vk_CompressionConfig *config,
+    Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
+    Fpx3d_Vk_GltfTextures *output) {
+  NULL_CHECK(config, FPX3D_ARGS_ERROR);
+
+  return _import_textures(asset, base_directory, thread_count, config, ctx,
+                          lgpu, output);
+}
+
+Fpx3d_E_Result fpx3d_vk_destroy_gltf_textures(Fpx3d_Vk_GltfTextures *textures,
+                                              Fpx3d_Vk_LogicalGpu *lgpu) {
+  NULL_CHECK(textures, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  for (size_t i = 0; NULL != textures->images && i < textures->imageCount;
+       ++i) {
+    if (textures->images[i].isValid)
+      fpx3d_vk_destroy_image(&textures->images[i], lgpu);
+  }
+
+  for (size_t i = 0; NULL != textures->samplers && i < textures->samplerCount;
+       ++i)
+    fpx3d_vk_destroy_image_sampler(&textures->samplers[i], lgpu);
+
+  FREE_SAFE(textures->images);
+  FREE_SAFE(textures->samplers);
+  FREE_SAFE(textures->textures);
+
+  memset(textures, 0, sizeof(*textures));
+
+  return FPX3D_SUCCESS;
+}
+
+// fills `output` (room for every image of the asset) with the indices
+// of the images that some texture samples, which are the only ones
+// worth decoding. Returns how many there are
+size_t
+__fpx3d_vk_gltf_used_images(const Fpx3d_Model_GltfAssetDescription *desc,
+                            size_t *output) {
+  size_t used_count = 0;
+
+  for (size_t i = 0; i < desc->imageCount; ++i) {
+    for (size_t t = 0; t < desc->textureCount; ++t) {
+      if (&desc->images[i] == desc->textures[t].sourceImage) {
+        output[used_count++] = i;
+        break;
+      }
+    }
+  }
+
+  return used_count;
+}
+
+// reads the files of every image in `images` that lives in a file of its
+// own in one batch. `files` and `file_sizes` get the contents of image
+// `images[u]` at index `u` (NULL for embedded images and unreadable
+// files); free() them
+Fpx3d_E_Result __fpx3d_vk_read_gltf_image_files(
+    const Fpx3d_Model_GltfAsset *asset, const char *base_directory,
+    const size_t *images, size_t count, uint8_t **files, size_t *file_sizes) {
+  const Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(asset);
+
+  memset(files, 0, count * sizeof(uint8_t *));
+  memset(file_sizes, 0, count * sizeof(size_t));
+
+  char **paths = calloc(count + 1, sizeof(char *));
+  if (NULL == paths) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  for (size_t u = 0; u < count; ++u) {
+    const Fpx3d_Model_GltfImage *image = &desc->images[images[u]];
+
+    if (NULL != image->bufferView || NULL == image->uri ||
+        0 == strncmp(image->uri, "data:", 5))
+      continue;
+
+    paths[u] = _resolve_uri(base_directory, image->uri);
+    if (NULL == paths[u]) {
+      retval = FPX3D_MEMORY_ERROR;
+      break;
+    }
+  }
+
+  // missing files only cost their image, which is skipped when decoding
+  if (FPX3D_SUCCESS == retval)
+    __fpx3d_read_files((const char *const *)paths, count, false, files,
+                       file_sizes, NULL);
+
+  for (size_t u = 0; u < count; ++u)
+    FREE_SAFE(paths[u]);
+
+  FREE_SAFE(paths);
+
+  return retval;
+}
+
+// decodes one image of the asset to tightly packed RGBA8 pixels. `file`
+// holds the contents of the image's file, for images that aren't
+// embedded (see __fpx3d_vk_read_gltf_image_files()).
+// Safe to call from any thread; free the pixels using
+// __fpx3d_vk_free_gltf_image()
+Fpx3d_E_Result
+__fpx3d_vk_decode_gltf_image(const Fpx3d_Model_GltfAsset *asset,
+                             size_t image_index, const uint8_t *file,
+                             size_t file_size, uint8_t **pixels,
+                             uint32_t *width, uint32_t *height) {
+  const Fpx3d_Model_GltfImage *image =
+      &fpx3d_model_gltf_description(asset)->images[image_index];
+
+  const uint8_t *data = file;
+  size_t length = file_size;
+
+  if (NULL != image->bufferView) {
+    data = __fpx3d_model_gltf_view_data(asset, image->bufferView);
+    length = image->bufferView->byteLength;
+  }
+
+  if (NULL == data) {
+    FPX3D_WARN("No data available for glTF image %" LONG_FORMAT "u",
+               image_index);
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+  }
+
+  Fpx3d_E_Result retval =
+      __fpx3d_vk_decode_image(data, length, pixels, width, height);
+
+  if (FPX3D_SUCCESS != retval) {
+    FPX3D_WARN("Failed to decode glTF image %" LONG_FORMAT "u (%s)",
+               image_index, stbi_failure_reason());
+  }
+
+  return retval;
+}
+
+// decodes an encoded (PNG, JPEG, ...) image file's contents the same way.
+// Also safe to call from any thread
+Fpx3d_E_Result __fpx3d_vk_decode_image(const uint8_t *data, size_t length,
+                                       uint8_t **pixels, uint32_t *width,
+                                       uint32_t *height) {
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  stbi_uc *decoded = NULL;
+  int w = 0, h = 0;
+
+  if ((size_t)INT32_MAX >= length) {
+    int channels = 0;
+
+    decoded = stbi_load_from_memory(data, (int)length, &w, &h, &channels,
+                                    TEXTURE_CHANNELS);
+  }
+
+  if (NULL == decoded)
+    return FPX3D_MODEL_INVALID_FILE_ERROR;
+
+  *pixels = decoded;
+  *width = (uint32_t)w;
+  *height = (uint32_t)h;
+
+  return FPX3D_SUCCESS;
+}
+
+void __fpx3d_vk_free_gltf_image(uint8_t *pixels) { stbi_image_free(pixels); }
+
+// uploads decoded pixels as a sampled, shader-readonly texture image
+Fpx3d_E_Result __fpx3d_vk_upload_gltf_image(Fpx3d_Vk_Context *ctx,
+                                            Fpx3d_Vk_LogicalGpu *lgpu,
+                                            uint8_t *pixels, uint32_t width,
+                                            uint32_t height,
+                                            Fpx3d_Vk_Image *output) {
+  Fpx3d_Vk_ImageDimensions dims = {.width = width,
+                                   .height = height,
+                                   .channels = TEXTURE_CHANNELS,
+                                   .channelWidth = 1};
+
+  Fpx3d_Vk_Image image = fpx3d_vk_create_texture_image(ctx, lgpu, dims);
+  if (false == image.isValid)
+    return FPX3D_VK_ERROR;
+
+  Fpx3d_E_Result retval = fpx3d_vk_fill_image(&image, ctx, lgpu, pixels);
+
+  if (FPX3D_SUCCESS == retval)
+    retval = fpx3d_vk_image_readonly(&image, lgpu);
+
+  if (FPX3D_SUCCESS != retval) {
+    fpx3d_vk_destroy_image(&image, lgpu);
+    return retval;
+  }
+
+  *output = image;
+
+  return FPX3D_SUCCESS;
+}
+
+// records the upload into `batch` instead; the pixels are copied into
+// staging memory right away, so they can be freed afterwards
+Fpx3d_E_Result __fpx3d_vk_batch_upload_gltf_image(Fpx3d_Vk_UploadBatch *batch,
+                                                  Fpx3d_Vk_Context *ctx,
+                                                  const uint8_t *pixels,
+                                                  uint32_t width,
+                                                  uint32_t height,
+                                                  Fpx3d_Vk_Image *output) {
+  Fpx3d_Vk_ImageDimensions dims = {.width = width,
+                                   .height = height,
+                                   .channels = TEXTURE_CHANNELS,
+                                   .channelWidth = 1};
+
+  Fpx3d_Vk_Image image =
+      fpx3d_vk_create_texture_image(ctx, batch->logicalGpu, dims);
+  if (false == image.isValid)
+    return FPX3D_VK_ERROR;
+
+  Fpx3d_E_Result retval = fpx3d_vk_batch_upload_image(
+      batch, &image, pixels, fpx3d_vk_get_image_size_bytes(&image), true);
+
+  if (FPX3D_SUCCESS != retval) {
+    fpx3d_vk_destroy_image(&image, batch->logicalGpu);
+    return retval;
+  }
+
+  *output = image;
+
+  return FPX3D_SUCCESS;
+}
+
+// creates the samplers and textures of `textures`, whose images (one per
+// image of the asset) have to be uploaded already
+Fpx3d_E_Result
+__fpx3d_vk_link_gltf_textures(const Fpx3d_Model_GltfAsset *asset,
+                              Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
+                              Fpx3d_Vk_GltfTextures *textures) {
+  const Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(asset);
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  textures->textureCount = desc->textureCount;
+  textures->textures =
+      calloc(desc->textureCount + 1, sizeof(Fpx3d_Vk_Texture));
+
+  // worst case: every texture has its own sampler, plus the default one
+  textures->samplers =
+      calloc(desc->textureCount + 1, sizeof(Fpx3d_Vk_ImageSampler));
+  textures->samplerCount = 0;
+
+  struct _sampler_key *keys = calloc(desc->textureCount + 1, sizeof(*keys));
+  size_t *texture_samplers = calloc(desc->textureCount + 1, sizeof(size_t));
+
+#define LINK_FAIL(code)                                                        \
+  {                                                                            \
+    retval = code;                                                             \
+    goto link_cleanup;                                                         \
+  }
+
+  if (NULL == textures->textures || NULL == textures->samplers ||
+      NULL == keys || NULL == texture_samplers)
+    LINK_FAIL(FPX3D_MEMORY_ERROR);
+
+  for (size_t t = 0; t < desc->textureCount; ++t) {
+    struct _sampler_key key = _sampler_key(desc->textures[t].sampler);
+
+    size_t s = 0;
+    while (s < textures->samplerCount &&
+           0 != memcmp(&keys[s], &key, sizeof(key)))
+      ++s;
+
+    if (s == textures->samplerCount) {
+      // anisotropy only makes sense when minifying with a linear filter
+      retval = __fpx3d_vk_new_image_sampler(
+          ctx, lgpu, key.magFilter, key.minFilter, key.addressModeU,
+          key.addressModeV, VK_FILTER_LINEAR == key.minFilter,
+          &textures->samplers[s]);
+      if (FPX3D_SUCCESS != retval)
+        LINK_FAIL(retval);
+
+      keys[s] = key;
+      ++textures->samplerCount;
+    }
+
+    texture_samplers[t] = s;
+  }
+
+  for (size_t t = 0; t < desc->textureCount; ++t) {
+    Fpx3d_Model_GltfImage *source = desc->textures[t].sourceImage;
+
+    if (NULL == source || !textures->images[source - desc->images].isValid)
+      continue;
+
+    textures->textures[t] =
+        fpx3d_vk_create_texture(&textures->images[source - desc->images],
+                                &textures->samplers[texture_samplers[t]]);
+  }
+
+#undef LINK_FAIL
+
+link_cleanup:
+  FREE_SAFE(keys);
+  FREE_SAFE(texture_samplers);
+
+  return retval;
+}
+
+// STATIC FUNCTIONS ----
+
+static Fpx3d_E_Result
+_import_textures(Fpx3d_Model_GltfAsset *asset, const char *base_directory,
+                 size_t thread_count,
+                 const Fpx3d_Vk_CompressionConfig *compression,
+                 Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
+                 Fpx3d_Vk_GltfTextures *output) {
+  NULL_CHECK(asset, FPX3D_ARGS_ERROR);
+  NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  Fpx3d_Model_GltfAssetDescription *desc = fpx3d_model_gltf_description(asset);
+  NULL_CHECK(desc, FPX3D_ARGS_ERROR);
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  for (size_t i = 0; i < desc->textureCount; ++i) {
+    retval = fpx3d_model_gltf_require(asset, FPX3D_GLTF_ENTITY_TEXTURE, i);
+    if (FPX3D_SUCCESS != retval)
+      return retval;
+  }
+
+  // to tell the normal maps apart
+  for (size_t i = 0; NULL != compression && i < desc->materialCount; ++i) {
+    retval = fpx3d_model_gltf_require(asset, FPX3D_GLTF_ENTITY_MATERIAL, i);
+    if (FPX3D_SUCCESS != retval)
+      return retval;
+  }
+
+  Fpx3d_Vk_GltfTextures result = {0};
+
+  size_t *used_images = NULL;
+  size_t used_count = 0;
+  struct _decoded_image *decoded = NULL;
+  bool *normal_maps = NULL;
+
+  uint8_t **files = NULL;
+  size_t *file_sizes = NULL;
+
+#define IMPORT_FAIL(code)                                                      \
+  {                                                                            \
+    retval = code;                                                             \
+    goto import_cleanup;                                                       \
+  }
+
+  result.imageCount = desc->imageCount;
+  result.images = calloc(desc->imageCount + 1, sizeof(Fpx3d_Vk_Image));
+
+  used_images = calloc(desc->imageCount + 1, sizeof(size_t));
+  decoded = calloc(desc->imageCount + 1, sizeof(*decoded));
+
+  files = calloc(desc->imageCount + 1, sizeof(uint8_t *));
+  file_sizes = calloc(desc->imageCount + 1, sizeof(size_t));
+
+  if (NULL == result.images || NULL == used_images || NULL == decoded ||
+      NULL == files || NULL == file_sizes)
+    IMPORT_FAIL(FPX3D_MEMORY_ERROR);
+
+  used_count = __fpx3d_vk_gltf_used_images(desc, used_images);
+
+  if (NULL != compression) {
+    normal_maps = _normal_maps(desc, used_images, used_count);
+    if (NULL == normal_maps)
+      IMPORT_FAIL(FPX3D_MEMORY_ERROR);
+  }
+
+  retval = __fpx3d_vk_read_gltf_image_files(
+      asset, base_directory, used_images, used_count, files, file_sizes);
+  if (FPX3D_SUCCESS != retval)
+    IMPORT_FAIL(retval);
+
+  {
+    // with several images, the workers already keep every CPU busy
+    struct _decode_job job = {
+        .asset = asset,
+        .images = used_images,
+        .files = files,
+        .fileSizes = file_sizes,
+        .compression = compression,
+        .normalMaps = normal_maps,
+        .compressionThreads =
+            CONDITIONAL(1 < used_count, 1,
+                        (NULL == compression) ? 0 : compression->threadCount),
+        .output = decoded,
+    };
+
+    retval = __fpx3d_parallel_for(used_count, thread_count, _decode_image,
+                                  &job);
+    if (FPX3D_SUCCESS != retval)
+      IMPORT_FAIL(retval);
+  }
+
+  // Vulkan work stays on the calling thread, since uploads go through
+  // the (externally synchronized) graphics queue
+  for (size_t u = 0; u < used_count; ++u) {
+    struct _decoded_image *img = &decoded[u];
+
+    if (NULL != img->compressed.blocks) {
+      retval = _upload_compressed(ctx, lgpu, &img->compressed,
+                                  &result.images[used_images[u]]);
+      if (FPX3D_SUCCESS != retval)
+        IMPORT_FAIL(retval);
+
+      fpx3d_vk_destroy_compressed_image(&img->compressed);
+      continue;
+    }
+
+    if (NULL == img->pixels)
+      continue;
+
+    retval = __fpx3d_vk_upload_gltf_image(ctx, lgpu, img->pixels, img->width,
+                                          img->height,
+                                          &result.images[used_images[u]]);
+    if (FPX3D_SUCCESS != retval)
+      IMPORT_FAIL(retval);
+
+    __fpx3d_vk_free_gltf_image(img->pixels);
+    img->pixels = NULL;
+  }
+
+  retval = __fpx3d_vk_link_gltf_textures(asset, ctx, lgpu, &result);
+  if (FPX3D_SUCCESS != retval)
+    IMPORT_FAIL(retval);
+
+#undef IMPORT_FAIL
+
+  FPX3D_DEBUG("Imported %" LONG_FORMAT "u glTF images with %" LONG_FORMAT
+              "u distinct samplers for %" LONG_FORMAT "u textures",
+              used_count, result.samplerCount, result.textureCount);
+
+  *output = result;
+
+import_cleanup:
+  if (FPX3D_SUCCESS != retval)
+    fpx3d_vk_destroy_gltf_textures(&result, lgpu);
+
+  for (size_t u = 0; NULL != decoded && u < used_count; ++u) {
+    __fpx3d_vk_free_gltf_image(decoded[u].pixels);
+    fpx3d_vk_destroy_compressed_image(&decoded[u].compressed);
+  }
+
+  for (size_t u = 0; NULL != files && u < used_count; ++u)
+    FREE_SAFE(files[u]);
+
+  FREE_SAFE(decoded);
+  FREE_SAFE(normal_maps);
+  FREE_SAFE(files);
+  FREE_SAFE(file_sizes);
+  FREE_SAFE(used_images);
+
+  return retval;
+}
+
+static void _decode_image(void *job_ptr, size_t index) {
+  struct _decode_job *job = (struct _decode_job *)job_ptr;
+  struct _decoded_image *out = &job->output[index];
+
+  // failures leave the pixels NULL, so the image is skipped
+  __fpx3d_vk_decode_gltf_image(job->asset, job->images[index],
+                               job->files[index], job->fileSizes[index],
+                               &out->pixels, &out->width, &out->height);
+
+  // the encoded file isn't needed anymore
+  FREE_SAFE(job->files[index]);
+
+  if (NULL == job->compression || NULL == out->pixels)
+    return;
+
+  Fpx3d_Vk_CompressionConfig config = *job->compression;
+  config.threadCount = job->compressionThreads;
+
+  if (job->normalMaps[index])
+    config.format = FPX3D_VK_BLOCK_BC5;
+
+  // if this fails, the pixels are uploaded as they are
+  if (FPX3D_SUCCESS == fpx3d_vk_compress_image(out->pixels, out->width,
+                                               out->height, &config,
+                                               &out->compressed)) {
+    __fpx3d_vk_free_gltf_image(out->pixels);
+    out->pixels = NULL;
+  }
+}
+
+// which of `images` some material samples as its normal map
+static bool *_normal_maps(const Fpx3d_Model_GltfAssetDescription *desc,
+                          const size_t *images, size_t count) {
+  bool *normal_maps = calloc(count + 1, sizeof(bool));
+  if (NULL == normal_maps) {
+    perror("calloc()");
+    return NULL;
+  }
+
+  for (size_t m = 0; m < desc->materialCount; ++m) {
+    const Fpx3d_Model_GltfTexture *texture =
+        desc->materials[m].normalTexture.textureInfo.texture;
+
+    if (NULL == texture || NULL == texture->sourceImage)
+      continue;
+
+    for (size_t u = 0; u < count; ++u) {
+      if (&desc->images[images[u]] == texture->sourceImage)
+        normal_maps[u] = true;
+    }
+  }
+
+  return normal_maps;
+}
+
+// like __fpx3d_vk_upload_gltf_image(), sRGB like the uncompressed images
+static Fpx3d_E_Result _upload_compressed(Fpx3d_Vk_Context *ctx,
+                                         Fpx3d_Vk_LogicalGpu *lgpu,
+                                         const Fpx3d_Vk_CompressedImage *src,
+                                         Fpx3d_Vk_Image *output) {
+  Fpx3d_Vk_Image image = fpx3d_vk_create_compressed_texture_image(
+      ctx, lgpu, src->width, src->height, src->format, true);
+  if (false == image.isValid)
+    return FPX3D_VK_ERROR;
+
+  Fpx3d_E_Result retval = fpx3d_vk_fill_image(&image, ctx, lgpu, src->blocks);
+
+  if (FPX3D_SUCCESS == retval)
+    retval = fpx3d_vk_image_readonly(&image, lgpu);
+
+  if (FPX3D_SUCCESS != retval) {
+    fpx3d_vk_destroy_image(&image, lgpu);
+    return retval;
+  }
+
+  *output = image;
+
+  return FPX3D_SUCCESS;
+}
+
+// joins the directory and the percent-decoded URI into a new string
+static char *_resolve_uri(const char *base_directory, const char *uri) {
+  size_t base_length = (NULL == base_directory) ? 0 : strlen(base_directory);
+  size_t uri_length = strlen(uri);
+
+  char *path = malloc(base_length + 1 + uri_length + 1);
+  if (NULL == path)
+    return NULL;
+
+  size_t pos = 0;
+
+  if (0 < base_length) {
+    memcpy(path, base_directory, base_length);
+    pos = base_length;
+
+    if ('/' != path[pos - 1] && '\\' != path[pos - 1])
+      path[pos++] = '/';
+  }
+
+  for (size_t i = 0; i < uri_length; ++i) {
+    if ('%' == uri[i] && i + 2 < uri_length && isxdigit(uri[i + 1]) &&
+        isxdigit(uri[i + 2])) {
+      char hex[3] = {uri[i + 1], uri[i + 2], '\0'};
+
+      path[pos++] = (char)strtol(hex, NULL, 16);
+      i += 2;
+      continue;
+    }
+
+    path[pos++] = uri[i];
+  }
+
+  path[pos] = '\0';
+
+  return path;
+}
+
+// glTF leaves undefined filters up to the implementation; linear it is.
+// Mipmapped minification filters fall back to their base filter, as
+// imported textures carry no mip chain
+static struct _sampler_key _sampler_key(const Fpx3d_Model_GltfSampler *s) {
+  struct _sampler_key key = {
+      .magFilter = VK_FILTER_LINEAR,
+      .minFilter = VK_FILTER_LINEAR,
+      .addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+      .addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT,
+  };
+
+  if (NULL == s)
+    return key;
+
+  if (FPX3D_GLTF_SAMPLER_FILTER_NEAREST == s->magFilter)
+    key.magFilter = VK_FILTER_NEAREST;
+
+  switch (s->minFilter) {
+  case FPX3D_GLTF_SAMPLER_FILTER_NEAREST:
+  case FPX3D_GLTF_SAMPLER_FILTER_NEAREST_MIPMAP_NEAREST:
+  case FPX3D_GLTF_SAMPLER_FILTER_NEAREST_MIPMAP_LINEAR:
+    key.minFilter = VK_FILTER_NEAREST;
+    break;
+
+  default:
+    break;
+  }
+
+  VkSamplerAddressMode *modes[] = {&key.addressModeU, &key.addressModeV};
+  int wraps[] = {s->wrapU, s->wrapV};
+
+  for (size_t i = 0; i < ARRAY_SIZE(modes); ++i) {
+    switch (wraps[i]) {
+    case FPX3D_GLTF_SAMPLER_WRAP_CLAMP_TO_EDGE:
+      *modes[i] = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+      break;
+
+    case FPX3D_GLTF_SAMPLER_WRAP_MIRRORED_REPEAT:
+      *modes[i] = VK_SAMPLER_ADDRESS_MODE_MIRRORED_REPEAT;
+      break;
+
+    default:
+      break;
+    }
+  }
+
+  return key;
+}
+
+// END OF STATIC FUNCTIONS ----
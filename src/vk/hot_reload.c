@@ -0,0 +1,879 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#include "vk/context.h"
+#include "vk/hot_reload.h"
+#include "vk/image.h"
+#include "vk/logical_gpu.h"
+#include "vk/resource_cache.h"
+#include "vk/shaders.h"
+#include "vk/streaming.h"
+#include "vk/typedefs.h"
+#include "volk/volk.h"
+
+// how often files are checked where there is no inotify
+#define POLL_INTERVAL_MS 250
+
+#define SPIRV_MAGIC 0x07230203
+
+extern Fpx3d_E_Result __fpx3d_map_file(const char *path,
+                                       const uint8_t **output,
+                                       size_t *output_size);
+extern void __fpx3d_unmap_file(const uint8_t *data, size_t size);
+
+extern uint64_t __fpx3d_hash64(const void *data, size_t length,
+                               uint64_t seed);
+
+extern Fpx3d_E_Result __fpx3d_vk_decode_image(const uint8_t *data,
+                                              size_t length, uint8_t **pixels,
+                                              uint32_t *width,
+                                              uint32_t *height);
+extern void __fpx3d_vk_free_gltf_image(uint8_t *pixels);
+extern Fpx3d_E_Result __fpx3d_vk_upload_gltf_image(Fpx3d_Vk_Context *ctx,
+                                                   Fpx3d_Vk_LogicalGpu *lgpu,
+                                                   uint8_t *pixels,
+                                                   uint32_t width,
+                                                   uint32_t height,
+                                                   Fpx3d_Vk_Image *output);
+
+struct fpx3d_vk_hot_reload_shared {
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  bool stop;
+
+  // only relinked by the thread calling fpx3d_vk_hot_reload_update()
+  Fpx3d_Vk_HotAsset *assets;
+
+  // -1 when polling
+  int inotifyFd;
+  int wakePipe[2];
+
+  pthread_t thread;
+};
+
+// content that was swapped out, waiting for the frames in flight
+struct fpx3d_vk_hot_retired {
+  Fpx3d_Vk_E_HotAssetType type;
+
+  union {
+    Fpx3d_Vk_StreamHandle *gltf;
+    Fpx3d_Vk_Image image;
+  };
+
+  uint64_t frame;
+
+  struct fpx3d_vk_hot_retired *next;
+};
+
+// static declarations ----
+
+static Fpx3d_E_Result _add(Fpx3d_Vk_HotReloader *, const char *path,
+                           Fpx3d_Vk_E_HotAssetType type,
+                           Fpx3d_Vk_E_ShaderStage stage,
+                           Fpx3d_Vk_HotReloadCallback callback,
+                           void *user_data, Fpx3d_Vk_HotAsset **output);
+
+static void *_watcher_loop(void *shared_ptr);
+static void _wait_for_changes(struct fpx3d_vk_hot_reload_shared *);
+static void _poll_files(struct fpx3d_vk_hot_reload_shared *);
+static void _load_dirty(struct fpx3d_vk_hot_reload_shared *);
+static void _load(Fpx3d_Vk_HotAsset *, struct fpx3d_vk_hot_reload_shared *);
+static void _wake(struct fpx3d_vk_hot_reload_shared *);
+
+static void _swap_gltf(Fpx3d_Vk_HotReloader *, Fpx3d_Vk_HotAsset *);
+
+static Fpx3d_E_Result _retire(Fpx3d_Vk_HotReloader *,
+                              Fpx3d_Vk_E_HotAssetType type, void *content);
+static void _release_retired(Fpx3d_Vk_HotReloader *, bool everything);
+
+static void _free_pending(Fpx3d_Vk_HotAsset *);
+
+// end of static declarations ----
+
+Fpx3d_E_Result
+fpx3d_vk_create_hot_reloader(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
+                             const Fpx3d_Vk_StreamerConfig *config,
+                             Fpx3d_Vk_HotReloader *output) {
+  NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  Fpx3d_Vk_HotReloader reloader = {0};
+  reloader.context = ctx;
+  reloader.logicalGpu = lgpu;
+
+  Fpx3d_Vk_StreamerConfig stream_config = {0};
+  if (NULL != config)
+    stream_config = *config;
+
+#define CREATE_FAIL(retval)                                                    \
+  {                                                                            \
+    if (NULL != reloader.streamer.shared)                                      \
+      fpx3d_vk_destroy_streamer(&reloader.streamer);                           \
+    if (NULL != reloader.ownCache)                                             \
+      fpx3d_vk_destroy_resource_cache(reloader.ownCache);                      \
+    FREE_SAFE(reloader.ownCache);                                              \
+    FREE_SAFE(shared);                                                         \
+    return retval;                                                             \
+  }
+
+  struct fpx3d_vk_hot_reload_shared *shared = NULL;
+
+  // unchanged meshes and images of a reloaded glTF are found in the cache
+  // by their content hash, instead of being uploaded again
+  if (NULL == stream_config.cache) {
+    reloader.ownCache = calloc(1, sizeof(*reloader.ownCache));
+    if (NULL == reloader.ownCache) {
+      perror("calloc()");
+      CREATE_FAIL(FPX3D_MEMORY_ERROR);
+    }
+
+    Fpx3d_E_Result res =
+        fpx3d_vk_create_resource_cache(ctx, lgpu, reloader.ownCache);
+    if (FPX3D_SUCCESS != res) {
+      FREE_SAFE(reloader.ownCache);
+      CREATE_FAIL(res);
+    }
+
+    stream_config.cache = reloader.ownCache;
+  }
+
+  Fpx3d_E_Result res = fpx3d_vk_create_streamer(ctx, lgpu, &stream_config,
+                                                &reloader.streamer);
+  if (FPX3D_SUCCESS != res)
+    CREATE_FAIL(res);
+
+  shared = calloc(1, sizeof(*shared));
+  if (NULL == shared) {
+    perror("calloc()");
+    CREATE_FAIL(FPX3D_MEMORY_ERROR);
+  }
+
+  shared->inotifyFd = -1;
+  shared->wakePipe[0] = shared->wakePipe[1] = -1;
+
+#if defined(__linux__)
+  shared->inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if (0 > shared->inotifyFd) {
+    perror("inotify_init1()");
+  } else if (0 != pipe(shared->wakePipe)) {
+    perror("pipe()");
+    close(shared->inotifyFd);
+    shared->inotifyFd = -1;
+  } else {
+    fcntl(shared->wakePipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(shared->wakePipe[1], F_SETFL, O_NONBLOCK);
+  }
+
+  if (0 > shared->inotifyFd) {
+    FPX3D_WARN("No inotify; checking files every %d ms instead",
+               POLL_INTERVAL_MS);
+  }
+#endif
+
+  pthread_mutex_init(&shared->lock, NULL);
+  pthread_cond_init(&shared->wake, NULL);
+
+  if (0 != pthread_create(&shared->thread, NULL, _watcher_loop, shared)) {
+    FPX3D_ERROR("Could not spawn the hot reload watcher thread");
+
+#if defined(__linux__)
+    if (0 <= shared->inotifyFd) {
+      close(shared->inotifyFd);
+      close(shared->wakePipe[0]);
+      close(shared->wakePipe[1]);
+    }
+#endif
+
+    pthread_cond_destroy(&shared->wake);
+    pthread_mutex_destroy(&shared->lock);
+
+    CREATE_FAIL(FPX3D_GENERIC_ERROR);
+  }
+
+#undef CREATE_FAIL
+
+  reloader.shared = shared;
+  *output = reloader;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_destroy_hot_reloader(Fpx3d_Vk_HotReloader *reloader) {
+  NULL_CHECK(reloader, FPX3D_ARGS_ERROR);
+  NULL_CHECK(reloader->shared, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_vk_hot_reload_shared *shared = reloader->shared;
+
+  pthread_mutex_lock(&shared->lock);
+  shared->stop = true;
+  _wake(shared);
+  pthread_mutex_unlock(&shared->lock);
+
+  pthread_join(shared->thread, NULL);
+
+  while (NULL != shared->assets)
+    fpx3d_vk_hot_reload_remove(reloader, shared->assets);
+
+  _release_retired(reloader, true);
+
+  fpx3d_vk_destroy_streamer(&reloader->streamer);
+
+  if (NULL != reloader->ownCache)
+    fpx3d_vk_destroy_resource_cache(reloader->ownCache);
+  FREE_SAFE(reloader->ownCache);
+
+#if defined(__linux__)
+  if (0 <= shared->inotifyFd) {
+    close(shared->inotifyFd);
+    close(shared->wakePipe[0]);
+    close(shared->wakePipe[1]);
+  }
+#endif
+
+  pthread_cond_destroy(&shared->wake);
+  pthread_mutex_destroy(&shared->lock);
+  FREE_SAFE(reloader->shared);
+
+  memset(reloader, 0, sizeof(*reloader));
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_hot_reload_gltf(Fpx3d_Vk_HotReloader *reloader,
+                                        const char *path,
+                                        Fpx3d_Vk_HotReloadCallback callback,
+                                        void *user_data,
+                                        Fpx3d_Vk_HotAsset **output) {
+  return _add(reloader, path, FPX3D_VK_HOT_GLTF, SHADER_STAGE_INVALID,
+              callback, user_data, output);
+}
+
+Fpx3d_E_Result fpx3d_vk_hot_reload_image(Fpx3d_Vk_HotReloader *reloader,
+                                         const char *path,
+                                         Fpx3d_Vk_HotReloadCallback callback,
+                                         void *user_data,
+                                         Fpx3d_Vk_HotAsset **output) {
+  return _add(reloader, path, FPX3D_VK_HOT_IMAGE, SHADER_STAGE_INVALID,
+              callback, user_data, output);
+}
+
+Fpx3d_E_Result fpx3d_vk_hot_reload_spirv(Fpx3d_Vk_HotReloader *reloader,
+                                         const char *path,
+                                         Fpx3d_Vk_E_ShaderStage stage,
+                                         Fpx3d_Vk_HotReloadCallback callback,
+                                         void *user_data,
+                                         Fpx3d_Vk_HotAsset **output) {
+  if (SHADER_STAGE_INVALID == stage)
+    return FPX3D_ARGS_ERROR;
+
+  return _add(reloader, path, FPX3D_VK_HOT_SPIRV, stage, callback,
+              user_data, output);
+}
+
+Fpx3d_E_Result fpx3d_vk_hot_reload_remove(Fpx3d_Vk_HotReloader *reloader,
+                                          Fpx3d_Vk_HotAsset *asset) {
+  NULL_CHECK(reloader, FPX3D_ARGS_ERROR);
+  NULL_CHECK(reloader->shared, FPX3D_ARGS_ERROR);
+  NULL_CHECK(asset, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_vk_hot_reload_shared *shared = reloader->shared;
+
+  pthread_mutex_lock(&shared->lock);
+
+  Fpx3d_Vk_HotAsset **link = &shared->assets;
+  while (NULL != *link && asset != *link)
+    link = &(*link)->next;
+
+  if (NULL == *link) {
+    pthread_mutex_unlock(&shared->lock);
+    return FPX3D_ARGS_ERROR;
+  }
+
+  *link = asset->next;
+
+  // the content is taken out while the lock is held: once it is released,
+  // the watcher thread may free a busy asset at any moment
+  Fpx3d_Vk_E_HotAssetType type = asset->type;
+  Fpx3d_Vk_StreamHandle *pending_gltf = asset->pendingGltf;
+  Fpx3d_Vk_StreamHandle *gltf = NULL;
+  Fpx3d_Vk_Image image = {0};
+  Fpx3d_Vk_SpirvFile spirv = {0};
+
+  switch (type) {
+  case FPX3D_VK_HOT_GLTF:
+    gltf = asset->gltf;
+    asset->gltf = NULL;
+    break;
+
+  case FPX3D_VK_HOT_IMAGE:
+    image = asset->image;
+    memset(&asset->image, 0, sizeof(asset->image));
+    break;
+
+  case FPX3D_VK_HOT_SPIRV:
+    spirv = asset->spirv;
+    memset(&asset->spirv, 0, sizeof(asset->spirv));
+    break;
+  }
+
+  asset->pendingGltf = NULL;
+
+  // the watcher thread frees it once it is done loading
+  bool busy = asset->busy;
+  asset->orphaned = busy;
+
+  pthread_mutex_unlock(&shared->lock);
+
+  // the watch itself stays, other assets may live in the same directory.
+  // Events for it just don't match anything anymore
+
+  if (NULL != pending_gltf)
+    fpx3d_vk_stream_release(&reloader->streamer, pending_gltf);
+
+  if (NULL != gltf)
+    _retire(reloader, FPX3D_VK_HOT_GLTF, gltf);
+
+  if (image.isValid)
+    _retire(reloader, FPX3D_VK_HOT_IMAGE, &image);
+
+  fpx3d_vk_destroy_spirv_file(&spirv);
+
+  if (!busy) {
+    _free_pending(asset);
+    FREE_SAFE(asset->path);
+    FREE_SAFE(asset);
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_hot_reload_update(Fpx3d_Vk_HotReloader *reloader) {
+  NULL_CHECK(reloader, FPX3D_ARGS_ERROR);
+  NULL_CHECK(reloader->shared, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_vk_hot_reload_shared *shared = reloader->shared;
+
+  // only this thread relinks the list, so it can be walked without the
+  // lock; the fields the watcher thread writes are taken under it
+  for (Fpx3d_Vk_HotAsset *asset = shared->assets; NULL != asset;
+       asset = asset->next) {
+    pthread_mutex_lock(&shared->lock);
+
+    bool changed = asset->changed;
+    asset->changed = false;
+
+    uint8_t *pixels = asset->pixels;
+    uint32_t width = asset->width, height = asset->height;
+    asset->pixels = NULL;
+
+    Fpx3d_Vk_SpirvFile spirv = asset->pendingSpirv;
+    memset(&asset->pendingSpirv, 0, sizeof(asset->pendingSpirv));
+
+    pthread_mutex_unlock(&shared->lock);
+
+    if (changed) {
+      // newer content makes a reload that is still going pointless
+      if (NULL != asset->pendingGltf)
+        fpx3d_vk_stream_release(&reloader->streamer, asset->pendingGltf);
+      asset->pendingGltf = NULL;
+
+      Fpx3d_E_Result res =
+          fpx3d_vk_stream_gltf(&reloader->streamer, asset->path, NULL, NULL,
+                               &asset->pendingGltf);
+      if (FPX3D_SUCCESS != res) {
+        FPX3D_WARN("Could not reload \"%s\" (%d)", asset->path, res);
+      }
+    }
+
+    if (NULL != pixels) {
+      Fpx3d_Vk_Image image = {0};
+
+      Fpx3d_E_Result res = __fpx3d_vk_upload_gltf_image(
+          reloader->context, reloader->logicalGpu, pixels, width, height,
+          &image);
+      __fpx3d_vk_free_gltf_image(pixels);
+
+      if (FPX3D_SUCCESS == res) {
+        if (asset->image.isValid) {
+          _retire(reloader, FPX3D_VK_HOT_IMAGE, &asset->image);
+          ++reloader->reloadCount;
+        }
+
+        asset->image = image;
+        ++asset->generation;
+
+        if (NULL != asset->callback)
+          asset->callback(asset, asset->userData);
+      } else {
+        FPX3D_WARN("Could not upload \"%s\" (%d)", asset->path, res);
+      }
+    }
+
+    if (NULL != spirv.buffer) {
+      // only CPU-side data; whatever was built from it is up to the
+      // callback to replace
+      Fpx3d_Vk_SpirvFile old = asset->spirv;
+
+      asset->spirv = spirv;
+      ++asset->generation;
+
+      if (NULL != asset->callback)
+        asset->callback(asset, asset->userData);
+
+      if (NULL != old.buffer) {
+        fpx3d_vk_destroy_spirv_file(&old);
+        ++reloader->reloadCount;
+      }
+    }
+  }
+
+  Fpx3d_E_Result res = fpx3d_vk_streamer_update(&reloader->streamer);
+
+  for (Fpx3d_Vk_HotAsset *asset = shared->assets; NULL != asset;
+       asset = asset->next)
+    if (NULL != asset->pendingGltf)
+      _swap_gltf(reloader, asset);
+
+  _release_retired(reloader, false);
+
+  return res;
+}
+
+// STATIC FUNCTIONS ----
+
+static Fpx3d_E_Result _add(Fpx3d_Vk_HotReloader *reloader, const char *path,
+                           Fpx3d_Vk_E_HotAssetType type,
+                           Fpx3d_Vk_E_ShaderStage stage,
+                           Fpx3d_Vk_HotReloadCallback callback,
+                           void *user_data, Fpx3d_Vk_HotAsset **output) {
+  NULL_CHECK(reloader, FPX3D_ARGS_ERROR);
+  NULL_CHECK(reloader->shared, FPX3D_ARGS_ERROR);
+  NULL_CHECK(path, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_vk_hot_reload_shared *shared = reloader->shared;
+
+  Fpx3d_Vk_HotAsset *asset = calloc(1, sizeof(*asset));
+  if (NULL == asset) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  asset->path = strdup(path);
+  if (NULL == asset->path) {
+    perror("strdup()");
+    FREE_SAFE(asset);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  asset->type = type;
+  asset->stage = stage;
+  asset->callback = callback;
+  asset->userData = user_data;
+  asset->watch = -1;
+
+  const char *slash = strrchr(asset->path, '/');
+  asset->fileName = (NULL != slash) ? slash + 1 : asset->path;
+
+#if defined(__linux__)
+  if (0 <= shared->inotifyFd) {
+    // editors tend to save by writing a new file and renaming it over the
+    // old one, which only the directory gets to see
+    size_t dir_length = (size_t)(asset->fileName - asset->path);
+    char *dir = calloc(dir_length + 2, 1);
+    if (NULL == dir) {
+      perror("calloc()");
+      FREE_SAFE(asset->path);
+      FREE_SAFE(asset);
+      return FPX3D_MEMORY_ERROR;
+    }
+
+    if (0 < dir_length)
+      memcpy(dir, asset->path, dir_length);
+    else
+      dir[0] = '.';
+
+    asset->watch = inotify_add_watch(shared->inotifyFd, dir,
+                                     IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (0 > asset->watch) {
+      perror("inotify_add_watch()");
+      FPX3D_WARN("Can't watch \"%s\" for changes", asset->path);
+    }
+
+    FREE_SAFE(dir);
+  }
+#endif
+
+  // the watcher thread does the first load like any other
+  asset->dirty = true;
+
+  pthread_mutex_lock(&shared->lock);
+  asset->next = shared->assets;
+  shared->assets = asset;
+  _wake(shared);
+  pthread_mutex_unlock(&shared->lock);
+
+  *output = asset;
+
+  return FPX3D_SUCCESS;
+}
+
+static void *_watcher_loop(void *shared_ptr) {
+  struct fpx3d_vk_hot_reload_shared *shared = shared_ptr;
+
+  while (true) {
+    pthread_mutex_lock(&shared->lock);
+    bool stop = shared->stop;
+    pthread_mutex_unlock(&shared->lock);
+
+    if (stop)
+      break;
+
+    _load_dirty(shared);
+    _wait_for_changes(shared);
+  }
+
+  return NULL;
+}
+
+// blocks until something changed (or might have), marking changed
+// assets dirty
+static void _wait_for_changes(struct fpx3d_vk_hot_reload_shared *shared) {
+#if defined(__linux__)
+  if (0 <= shared->inotifyFd) {
+    struct pollfd fds[2] = {
+        {.fd = shared->inotifyFd, .events = POLLIN},
+        {.fd = shared->wakePipe[0], .events = POLLIN},
+    };
+
+    if (0 > poll(fds, ARRAY_SIZE(fds), -1))
+      return;
+
+    uint8_t drain[64];
+    while (0 < read(shared->wakePipe[0], drain, sizeof(drain)))
+      ;
+
+    uint8_t buffer[4096]
+        __attribute__((aligned(__alignof__(struct inotify_event))));
+
+    ssize_t length = 0;
+    while (0 < (length = read(shared->inotifyFd, buffer, sizeof(buffer)))) {
+      pthread_mutex_lock(&shared->lock);
+
+      for (ssize_t offset = 0; offset < length;) {
+        const struct inotify_event *event =
+            (const struct inotify_event *)(buffer + offset);
+        offset += sizeof(*event) + event->len;
+
+        for (Fpx3d_Vk_HotAsset *a = shared->assets; NULL != a; a = a->next) {
+          // on overflow, every asset might have changed
+          if (event->mask & IN_Q_OVERFLOW) {
+            a->dirty = true;
+            continue;
+          }
+
+          if (a->watch == event->wd && 0 < event->len &&
+              0 == strcmp(a->fileName, event->name))
+            a->dirty = true;
+        }
+      }
+
+      pthread_mutex_unlock(&shared->lock);
+    }
+
+    return;
+  }
+#endif
+
+  struct timespec until = {0};
+  clock_gettime(CLOCK_REALTIME, &until);
+
+  until.tv_nsec += (long)POLL_INTERVAL_MS * 1000000L;
+  until.tv_sec += until.tv_nsec / 1000000000L;
+  until.tv_nsec %= 1000000000L;
+
+  pthread_mutex_lock(&shared->lock);
+  if (!shared->stop)
+    pthread_cond_timedwait(&shared->wake, &shared->lock, &until);
+  pthread_mutex_unlock(&shared->lock);
+
+  _poll_files(shared);
+}
+
+// marks assets whose modification time or size changed as dirty.
+// Timestamps may only have a resolution of seconds, so files modified
+// within the last couple of them are checked again every time (their
+// content hash tells if they really changed)
+static void _poll_files(struct fpx3d_vk_hot_reload_shared *shared) {
+  int64_t now = (int64_t)time(NULL);
+
+  pthread_mutex_lock(&shared->lock);
+
+  for (Fpx3d_Vk_HotAsset *a = shared->assets; NULL != a; a = a->next) {
+    struct stat st;
+    if (0 != stat(a->path, &st))
+      continue;
+
+    if ((int64_t)st.st_mtime != a->modifiedTime ||
+        (int64_t)st.st_size != a->fileSize ||
+        2 >= now - (int64_t)st.st_mtime) {
+      a->modifiedTime = (int64_t)st.st_mtime;
+      a->fileSize = (int64_t)st.st_size;
+      a->dirty = true;
+    }
+  }
+
+  pthread_mutex_unlock(&shared->lock);
+}
+
+static void _load_dirty(struct fpx3d_vk_hot_reload_shared *shared) {
+  while (true) {
+    pthread_mutex_lock(&shared->lock);
+
+    Fpx3d_Vk_HotAsset *asset = shared->assets;
+    while (NULL != asset && (!asset->dirty || asset->busy))
+      asset = asset->next;
+
+    if (NULL == asset || shared->stop) {
+      pthread_mutex_unlock(&shared->lock);
+      return;
+    }
+
+    asset->dirty = false;
+    asset->busy = true;
+
+    pthread_mutex_unlock(&shared->lock);
+
+    _load(asset, shared);
+  }
+}
+
+// reads the file, and decodes it if its content hash changed
+static void _load(Fpx3d_Vk_HotAsset *asset,
+                  struct fpx3d_vk_hot_reload_shared *shared) {
+  const uint8_t *data = NULL;
+  size_t size = 0;
+
+  uint8_t *pixels = NULL;
+  uint32_t width = 0, height = 0;
+  Fpx3d_Vk_SpirvFile spirv = {0};
+  bool changed = false;
+
+  // a file that is gone (or being replaced) comes back with another event
+  if (FPX3D_SUCCESS == __fpx3d_map_file(asset->path, &data, &size)) {
+    uint64_t hash = __fpx3d_hash64(data, size, 0);
+
+    if (hash != asset->contentHash) {
+      switch (asset->type) {
+      case FPX3D_VK_HOT_GLTF:
+        // parsed by the streamer's workers, as soon as
+        // fpx3d_vk_hot_reload_update() picks it up
+        changed = true;
+        break;
+
+      case FPX3D_VK_HOT_IMAGE:
+        changed = (FPX3D_SUCCESS ==
+                   __fpx3d_vk_decode_image(data, size, &pixels, &width,
+                                           &height));
+        break;
+
+      case FPX3D_VK_HOT_SPIRV: {
+        uint32_t magic = 0;
+        if (sizeof(magic) <= size)
+          memcpy(&magic, data, sizeof(magic));
+
+        // half-written files don't make it into a shader module
+        if (SPIRV_MAGIC == magic && 0 == size % 4) {
+          spirv = fpx3d_vk_read_spirv_data(data, size, asset->stage);
+          changed = (NULL != spirv.buffer);
+        }
+      } break;
+      }
+
+      if (changed) {
+        asset->contentHash = hash;
+      } else {
+        FPX3D_WARN("Could not load \"%s\"; keeping what was there",
+                   asset->path);
+      }
+    }
+
+    __fpx3d_unmap_file(data, size);
+  }
+
+  pthread_mutex_lock(&shared->lock);
+
+  asset->busy = false;
+  bool orphaned = asset->orphaned;
+
+  if (changed && !orphaned) {
+    asset->changed = asset->changed || (FPX3D_VK_HOT_GLTF == asset->type);
+
+    if (NULL != pixels) {
+      if (NULL != asset->pixels)
+        __fpx3d_vk_free_gltf_image(asset->pixels);
+
+      asset->pixels = pixels;
+      asset->width = width;
+      asset->height = height;
+      pixels = NULL;
+    }
+
+    if (NULL != spirv.buffer) {
+      fpx3d_vk_destroy_spirv_file(&asset->pendingSpirv);
+      asset->pendingSpirv = spirv;
+      memset(&spirv, 0, sizeof(spirv));
+    }
+  }
+
+  pthread_mutex_unlock(&shared->lock);
+
+  if (NULL != pixels)
+    __fpx3d_vk_free_gltf_image(pixels);
+  if (NULL != spirv.buffer)
+    fpx3d_vk_destroy_spirv_file(&spirv);
+
+  if (orphaned) {
+    _free_pending(asset);
+    FREE_SAFE(asset->path);
+    FREE_SAFE(asset);
+  }
+}
+
+static void _wake(struct fpx3d_vk_hot_reload_shared *shared) {
+  pthread_cond_signal(&shared->wake);
+
+#if defined(__linux__)
+  if (0 <= shared->wakePipe[1]) {
+    uint8_t byte = 1;
+    if (0 > write(shared->wakePipe[1], &byte, 1)) {
+      // the pipe is full, so the watcher wakes up anyway
+    }
+  }
+#endif
+}
+
+// swaps in a finished reload; failed ones keep the old content around
+static void _swap_gltf(Fpx3d_Vk_HotReloader *reloader,
+                       Fpx3d_Vk_HotAsset *asset) {
+  Fpx3d_Vk_E_StreamState state = fpx3d_vk_stream_state(asset->pendingGltf);
+
+  if (FPX3D_VK_STREAM_FAILED == state) {
+    FPX3D_WARN("Reloading \"%s\" failed (%d); keeping what was there",
+               asset->path, asset->pendingGltf->result);
+
+    fpx3d_vk_stream_release(&reloader->streamer, asset->pendingGltf);
+    asset->pendingGltf = NULL;
+    return;
+  }
+
+  if (FPX3D_VK_STREAM_READY != state)
+    return;
+
+  if (NULL != asset->gltf) {
+    _retire(reloader, FPX3D_VK_HOT_GLTF, asset->gltf);
+    ++reloader->reloadCount;
+  }
+
+  asset->gltf = asset->pendingGltf;
+  asset->pendingGltf = NULL;
+  ++asset->generation;
+
+  if (NULL != asset->callback)
+    asset->callback(asset, asset->userData);
+}
+
+static Fpx3d_E_Result _retire(Fpx3d_Vk_HotReloader *reloader,
+                              Fpx3d_Vk_E_HotAssetType type, void *content) {
+  struct fpx3d_vk_hot_retired *retired = calloc(1, sizeof(*retired));
+  if (NULL == retired) {
+    perror("calloc()");
+
+    // better to stall once than to leak or pull it out from under the GPU
+    vkDeviceWaitIdle(reloader->logicalGpu->handle);
+
+    if (FPX3D_VK_HOT_GLTF == type)
+      fpx3d_vk_stream_release(&reloader->streamer, content);
+    else
+      fpx3d_vk_destroy_image(content, reloader->logicalGpu);
+
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  retired->type = type;
+  retired->frame = reloader->logicalGpu->frameIndex;
+
+  if (FPX3D_VK_HOT_GLTF == type) {
+    retired->gltf = content;
+  } else {
+    retired->image = *(Fpx3d_Vk_Image *)content;
+    memset(content, 0, sizeof(Fpx3d_Vk_Image));
+  }
+
+  struct fpx3d_vk_hot_retired **tail = &reloader->retired;
+  while (NULL != *tail)
+    tail = &(*tail)->next;
+
+  *tail = retired;
+
+  return FPX3D_SUCCESS;
+}
+
+// every submission since retiring may still have used it, and those are
+// done once maxFramesInFlight more have gone by
+static void _release_retired(Fpx3d_Vk_HotReloader *reloader,
+                             bool everything) {
+  uint64_t in_flight = reloader->context->constants.maxFramesInFlight;
+
+  while (NULL != reloader->retired) {
+    struct fpx3d_vk_hot_retired *retired = reloader->retired;
+
+    if (!everything &&
+        retired->frame + in_flight >= reloader->logicalGpu->frameIndex)
+      break;
+
+    if (FPX3D_VK_HOT_GLTF == retired->type)
+      fpx3d_vk_stream_release(&reloader->streamer, retired->gltf);
+    else
+      fpx3d_vk_destroy_image(&retired->image, reloader->logicalGpu);
+
+    reloader->retired = retired->next;
+    FREE_SAFE(retired);
+  }
+}
+
+static void _free_pending(Fpx3d_Vk_HotAsset *asset) {
+  if (NULL != asset->pixels)
+    __fpx3d_vk_free_gltf_image(asset->pixels);
+  asset->pixels = NULL;
+
+  fpx3d_vk_destroy_spirv_file(&asset->pendingSpirv);
+}
+
+// END OF STATIC FUNCTIONS ----
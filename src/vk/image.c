@@ -17,37 +17,22 @@
 #include "vk/logical_gpu.h"
 
 #include "vk/image.h"
+#include "vk/texture_compression.h"
+#include "vk/upload.h"
 
 #define CHECK_DIMENSIONS(d, ret)                                               \
   if (1 > d.channels || 1 > d.height || 1 > d.width || 1 > d.channelWidth)     \
     return ret;
 
-extern Fpx3d_E_Result __fpx3d_vk_new_memory(VkPhysicalDevice,
-                                            Fpx3d_Vk_LogicalGpu *,
-                                            VkMemoryPropertyFlags,
-                                            VkMemoryRequirements,
-                                            VkDeviceMemory *);
-
-extern VkCommandPool *__fpx3d_vk_select_pool_of_type(Fpx3d_Vk_E_CommandPoolType,
-                                                     Fpx3d_Vk_LogicalGpu *);
-
-extern VkCommandBuffer __fpx3d_vk_begin_temp_command_buffer(VkCommandPool,
-                                                            VkDevice);
-extern Fpx3d_E_Result __fpx3d_vk_end_temp_command_buffer(VkCommandBuffer,
-                                                         VkCommandPool, VkQueue,
-                                                         VkDevice);
-
-extern void __fpx3d_vk_destroy_buffer_object(Fpx3d_Vk_LogicalGpu *,
-                                             Fpx3d_Vk_Buffer *);
-
-extern Fpx3d_E_Result
-__fpx3d_vk_new_buffer(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
-                      VkDeviceSize size, VkBufferUsageFlags usage,
-                      VkMemoryPropertyFlags mem_flags, VkSharingMode,
-                      Fpx3d_Vk_Buffer *output);
-extern Fpx3d_E_Result __fpx3d_vk_data_to_buffer(Fpx3d_Vk_LogicalGpu *,
-                                                Fpx3d_Vk_Buffer *, void *data,
-                                                VkDeviceSize size);
+extern Fpx3d_E_Result __fpx3d_vk_allocate(
+    VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *, VkMemoryPropertyFlags,
+    VkMemoryPropertyFlags preferred, VkMemoryRequirements, bool linear,
+    Fpx3d_Vk_Allocation *output);
+extern void __fpx3d_vk_free(Fpx3d_Vk_LogicalGpu *, Fpx3d_Vk_Allocation *);
+
+extern Fpx3d_E_Result __fpx3d_vk_begin_upload_batch(VkPhysicalDevice,
+                                                    Fpx3d_Vk_LogicalGpu *,
+                                                    Fpx3d_Vk_UploadBatch *);
 
 // static declarations -----------------------------------
 static VkFormat _fpx3d_vk_texture_formats_table[][5] = {
@@ -58,35 +43,22 @@ static VkFormat _fpx3d_vk_texture_formats_table[][5] = {
   ((ARRAY_SIZE(_fpx3d_vk_texture_formats_table) *                              \
     ARRAY_SIZE(_fpx3d_vk_texture_formats_table[0])) < (idx))
 
-static Fpx3d_E_Result _new_image_sampler(Fpx3d_Vk_Context *,
-                                         Fpx3d_Vk_LogicalGpu *,
-                                         VkSamplerAddressMode addr_mode,
-                                         bool bilinear, bool anisotropy,
-                                         Fpx3d_Vk_ImageSampler *output);
-
-static Fpx3d_E_Result _fill_image_data(Fpx3d_Vk_Image *, void *data,
-                                       size_t data_length,
-                                       Fpx3d_Vk_LogicalGpu *, VkPhysicalDevice);
-
-static struct fpx3d_vulkan_pool_queue_pair
-_graphics_pool_and_queue(Fpx3d_Vk_LogicalGpu *lgpu);
-
-static Fpx3d_E_Result
-_transition_image_layout(VkImage, VkFormat, VkImageLayout *old,
-                         VkImageLayout new, VkImageSubresourceRange,
-                         VkCommandPool graphics_pool, VkQueue graphics_queue,
-                         VkDevice lgpu);
-
-static Fpx3d_E_Result _vk_buf_to_image(VkBuffer, Fpx3d_Vk_Image *,
-                                       VkImageLayout,
-                                       VkImageSubresourceRange s_range,
-                                       VkCommandPool graphics_pool,
-                                       VkQueue graphics_queue, VkDevice lgpu);
+// indexed by Fpx3d_Vk_E_BlockFormat; UNORM, then SRGB
+static VkFormat _fpx3d_vk_block_formats_table[][2] = {
+    {VK_FORMAT_UNDEFINED, VK_FORMAT_UNDEFINED},
+    {VK_FORMAT_BC1_RGB_UNORM_BLOCK, VK_FORMAT_BC1_RGB_SRGB_BLOCK},
+    {VK_FORMAT_BC3_UNORM_BLOCK, VK_FORMAT_BC3_SRGB_BLOCK},
+    {VK_FORMAT_BC5_UNORM_BLOCK, VK_FORMAT_BC5_UNORM_BLOCK},
+    {VK_FORMAT_BC7_UNORM_BLOCK, VK_FORMAT_BC7_SRGB_BLOCK}};
+
+static Fpx3d_E_Result _upload_and_wait(Fpx3d_Vk_UploadBatch *);
+static bool _host_transfer_usable(VkPhysicalDevice, VkFormat, VkImageTiling,
+                                  VkImageUsageFlags);
 // end of static declarations ----------------------------
 
 VkFormat __fpx3d_vk_supported_format(VkFormat *fmts, size_t count,
                                      VkImageTiling, VkFormatFeatureFlags,
-                                     VkPhysicalDevice);
+                                     const Fpx3d_Vk_Capabilities *);
 
 Fpx3d_E_Result __fpx3d_vk_new_image(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
                                     Fpx3d_Vk_ImageDimensions dimensions,
@@ -99,13 +71,27 @@ Fpx3d_E_Result __fpx3d_vk_new_image_view(Fpx3d_Vk_Image *,
                                          Fpx3d_Vk_LogicalGpu *,
                                          VkImageView *output);
 
+Fpx3d_E_Result __fpx3d_vk_new_image_sampler(
+    Fpx3d_Vk_Context *, Fpx3d_Vk_LogicalGpu *, VkFilter mag_filter,
+    VkFilter min_filter, VkSamplerAddressMode addr_mode_u,
+    VkSamplerAddressMode addr_mode_v, bool anisotropy,
+    Fpx3d_Vk_ImageSampler *output);
+
+Fpx3d_E_Result __fpx3d_vk_host_copy_image(Fpx3d_Vk_LogicalGpu *,
+                                          Fpx3d_Vk_Image *, const void *data);
+
+Fpx3d_E_Result __fpx3d_vk_record_image_transition(VkCommandBuffer,
+                                                  Fpx3d_Vk_Image *,
+                                                  VkImageLayout new);
+
 VkFormat __fpx3d_vk_supported_format(VkFormat *fmts, size_t count,
                                      VkImageTiling tiling,
                                      VkFormatFeatureFlags features,
-                                     VkPhysicalDevice dev) {
+                                     const Fpx3d_Vk_Capabilities *caps) {
+  NULL_CHECK(caps, VK_FORMAT_UNDEFINED);
+
   for (size_t i = 0; i < count; ++i) {
-    VkFormatProperties props = {0};
-    vkGetPhysicalDeviceFormatProperties(dev, fmts[i], &props);
+    VkFormatProperties props = fpx3d_vk_capabilities_format(caps, fmts[i]);
 
     VkFormatFeatureFlags supported_features = {0};
 
@@ -138,15 +124,6 @@ __fpx3d_vk_new_image(VkPhysicalDevice dev, Fpx3d_Vk_LogicalGpu *lgpu,
   FPX3D_TODO(
       "_new_image() and its subsidiaries have a lot of hard-coded stuff. fix");
 
-  struct fpx3d_vulkan_pool_queue_pair pair = _graphics_pool_and_queue(lgpu);
-  if (NULL == pair.pool || NULL == pair.queue) {
-    FPX3D_ERROR("No graphics-enabled queues or command pools available on LGPU "
-                "%p to create image",
-                (void *)lgpu->handle);
-
-    return FPX3D_GENERIC_ERROR;
-  }
-
   VkImageUsageFlags u_flags = usage;
   VkSharingMode s_mode = VK_SHARING_MODE_EXCLUSIVE;
   VkMemoryPropertyFlags m_flags = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
@@ -159,8 +136,17 @@ __fpx3d_vk_new_image(VkPhysicalDevice dev, Fpx3d_Vk_LogicalGpu *lgpu,
   // m_flags |= VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
   m_flags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
 
+  // textures can be filled from host memory without staging
+  bool host_transfer =
+      lgpu->hostImageCopy && (usage & VK_IMAGE_USAGE_SAMPLED_BIT) &&
+      _host_transfer_usable(dev, fmt, tiling,
+                            u_flags | VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT);
+
+  if (host_transfer)
+    u_flags |= VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT;
+
   VkImage new_img = {0};
-  VkDeviceMemory new_mem = {0};
+  Fpx3d_Vk_Allocation new_mem = {0};
 
   VkImageCreateInfo i_info = {.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
                               .imageType = VK_IMAGE_TYPE_2D,
@@ -184,30 +170,25 @@ __fpx3d_vk_new_image(VkPhysicalDevice dev, Fpx3d_Vk_LogicalGpu *lgpu,
   VkMemoryRequirements mem_reqs = {0};
   vkGetImageMemoryRequirements(lgpu->handle, new_img, &mem_reqs);
 
-  FPX3D_ONFAIL(__fpx3d_vk_new_memory(dev, lgpu, m_flags, mem_reqs, &new_mem),
+  FPX3D_ONFAIL(__fpx3d_vk_allocate(dev, lgpu, m_flags, 0, mem_reqs,
+                                   VK_IMAGE_TILING_LINEAR == tiling, &new_mem),
                mem_success, vkDestroyImage(lgpu->handle, new_img, NULL);
                FPX3D_ERROR("Failed to allocate image memory");
                return mem_success;);
 
-  if (VK_SUCCESS != vkBindImageMemory(lgpu->handle, new_img, new_mem, 0)) {
+  if (VK_SUCCESS != vkBindImageMemory(lgpu->handle, new_img, new_mem.memory,
+                                      new_mem.offset)) {
     FPX3D_ERROR("Failed to bind image memory");
 
-    return FPX3D_VK_ERROR;
-  }
+    __fpx3d_vk_free(lgpu, &new_mem);
+    vkDestroyImage(lgpu->handle, new_img, NULL);
 
-  {
-    VkImageLayout temp_layout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-    FPX3D_ONFAIL(_transition_image_layout(new_img, fmt, &temp_layout,
-                                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                          s_range, *pair.pool, *pair.queue,
-                                          lgpu->handle),
-                 success, FPX3D_ERROR("Failed to prepare image layout");
-                 return success;);
+    return FPX3D_VK_ERROR;
   }
 
   output->image = new_img;
-  output->memory = new_mem;
+  output->allocation = new_mem;
+  output->memory = new_mem.memory;
 
   output->imageFormat = fmt;
 
@@ -215,6 +196,11 @@ __fpx3d_vk_new_image(VkPhysicalDevice dev, Fpx3d_Vk_LogicalGpu *lgpu,
 
   output->subresourceRange = s_range;
 
+  // moved out of this layout by whatever first uses the image
+  output->imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  output->isReadOnly = false;
+  output->hostTransfer = host_transfer;
+
   output->isValid = true;
 
   return FPX3D_SUCCESS;
@@ -248,6 +234,59 @@ Fpx3d_E_Result __fpx3d_vk_new_image_view(Fpx3d_Vk_Image *image,
   return FPX3D_SUCCESS;
 }
 
+Fpx3d_E_Result __fpx3d_vk_new_image_sampler(
+    Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu, VkFilter mag_filter,
+    VkFilter min_filter, VkSamplerAddressMode addr_mode_u,
+    VkSamplerAddressMode addr_mode_v, bool anisotropy,
+    Fpx3d_Vk_ImageSampler *output) {
+  NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(ctx->physicalGpu, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  VkSampler new_sampler = {0};
+
+  if (VK_SAMPLER_ADDRESS_MODE_MAX_ENUM == addr_mode_u ||
+      VK_SAMPLER_ADDRESS_MODE_MAX_ENUM == addr_mode_v)
+    return FPX3D_ARGS_ERROR;
+
+  VkSamplerCreateInfo s_info = {0};
+  s_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+  s_info.magFilter = mag_filter;
+  s_info.minFilter = min_filter;
+
+  s_info.addressModeU = addr_mode_u;
+  s_info.addressModeV = addr_mode_v;
+  s_info.addressModeW = addr_mode_u;
+
+  const Fpx3d_Vk_Capabilities *caps = fpx3d_vk_get_capabilities(ctx);
+  NULL_CHECK(caps, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+
+  s_info.anisotropyEnable = CONDITIONAL(
+      anisotropy && caps->features.samplerAnisotropy, VK_TRUE, VK_FALSE);
+  s_info.maxAnisotropy = caps->properties.limits.maxSamplerAnisotropy;
+
+  s_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+  s_info.unnormalizedCoordinates = VK_FALSE;
+
+  s_info.compareEnable = VK_FALSE;
+  s_info.compareOp = VK_COMPARE_OP_ALWAYS;
+
+  s_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+  s_info.mipLodBias = 0.0f;
+  s_info.minLod = 0.0f;
+  s_info.maxLod = 0.0f;
+
+  if (VK_SUCCESS != vkCreateSampler(lgpu->handle, &s_info, NULL, &new_sampler))
+    return FPX3D_VK_ERROR;
+
+  output->handle = new_sampler;
+  output->isValid = true;
+
+  return FPX3D_SUCCESS;
+}
+
 Fpx3d_Vk_Image
 fpx3d_vk_create_depth_image(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
                             Fpx3d_Vk_ImageDimensions dimensions) {
@@ -270,7 +309,8 @@ fpx3d_vk_create_depth_image(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
                         VK_FORMAT_D24_UNORM_S8_UINT};
   VkFormat depth_format = __fpx3d_vk_supported_format(
       choices, ARRAY_SIZE(choices), VK_IMAGE_TILING_OPTIMAL,
-      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT, ctx->physicalGpu);
+      VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT,
+      fpx3d_vk_get_capabilities(ctx));
 
   // if no valid depth formats found
   if (VK_FORMAT_UNDEFINED == depth_format)
@@ -287,10 +327,16 @@ fpx3d_vk_create_depth_image(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
                    VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, &retval),
                success, return retval;);
 
-  struct fpx3d_vulkan_pool_queue_pair pair = _graphics_pool_and_queue(lgpu);
-  _transition_image_layout(retval.image, depth_format, &retval.imageLayout,
-                           VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
-                           s_range, *pair.pool, *pair.queue, lgpu->handle);
+  {
+    Fpx3d_Vk_UploadBatch batch = {0};
+
+    if (FPX3D_SUCCESS == __fpx3d_vk_begin_upload_batch(ctx->physicalGpu,
+                                                       lgpu, &batch)) {
+      fpx3d_vk_batch_transition_image(
+          &batch, &retval, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+      _upload_and_wait(&batch);
+    }
+  }
 
   VkImageView new_view = {0};
   FPX3D_ONFAIL(__fpx3d_vk_new_image_view(&retval, lgpu, &new_view), success,
@@ -344,6 +390,60 @@ fpx3d_vk_create_texture_image(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
 
 #undef CHECK_DIMENSIONS
 
+Fpx3d_Vk_Image fpx3d_vk_create_compressed_texture_image(
+    Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu, uint32_t width,
+    uint32_t height, Fpx3d_Vk_E_BlockFormat format, bool srgb) {
+  Fpx3d_Vk_Image retval = {0};
+  NULL_CHECK(ctx, retval);
+  NULL_CHECK(lgpu, retval);
+  NULL_CHECK(lgpu->handle, retval);
+
+  if (1 > width || 1 > height || FPX3D_VK_BLOCK_NONE == format ||
+      ARRAY_SIZE(_fpx3d_vk_block_formats_table) <= (size_t)format)
+    return retval;
+
+  VkFormat fmt = _fpx3d_vk_block_formats_table[format][srgb ? 1 : 0];
+
+  if (VK_FORMAT_UNDEFINED ==
+      __fpx3d_vk_supported_format(&fmt, 1, VK_IMAGE_TILING_OPTIMAL,
+                                  VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT,
+                                  fpx3d_vk_get_capabilities(ctx))) {
+    FPX3D_WARN("Block compressed format %u can't be sampled on this GPU",
+               fmt);
+    return retval;
+  }
+
+  // the channels are only informational; the size comes from the format
+  Fpx3d_Vk_ImageDimensions dimensions = {
+      .width = width,
+      .height = height,
+      .channels = CONDITIONAL(FPX3D_VK_BLOCK_BC5 == format, 2, 4),
+      .channelWidth = 1};
+
+  VkImageSubresourceRange s_range = {.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                     .baseMipLevel = 0,
+                                     .levelCount = 1,
+                                     .baseArrayLayer = 0,
+                                     .layerCount = 1};
+
+  FPX3D_ONFAIL(__fpx3d_vk_new_image(ctx->physicalGpu, lgpu, dimensions, fmt,
+                                    VK_IMAGE_TILING_OPTIMAL, s_range,
+                                    VK_IMAGE_USAGE_SAMPLED_BIT, &retval),
+               success, return retval;);
+
+  retval.blockFormat = format;
+
+  VkImageView new_view = {0};
+  FPX3D_ONFAIL(__fpx3d_vk_new_image_view(&retval, lgpu, &new_view), success,
+               fpx3d_vk_destroy_image(&retval, lgpu);
+               return retval;);
+
+  retval.imageView = new_view;
+  retval.sizeInBytes = fpx3d_vk_get_image_size_bytes;
+
+  return retval;
+}
+
 Fpx3d_E_Result fpx3d_vk_fill_image(Fpx3d_Vk_Image *img, Fpx3d_Vk_Context *ctx,
                                    Fpx3d_Vk_LogicalGpu *lgpu, void *data) {
   NULL_CHECK(img, FPX3D_ARGS_ERROR);
@@ -353,12 +453,22 @@ Fpx3d_E_Result fpx3d_vk_fill_image(Fpx3d_Vk_Image *img, Fpx3d_Vk_Context *ctx,
   NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
   NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
 
-  size_t data_length = img->dimensions.width * img->dimensions.height *
-                       img->dimensions.channels * img->dimensions.channelWidth;
+  // nothing can be using an image that was never filled
+  if (img->hostTransfer && VK_IMAGE_LAYOUT_UNDEFINED == img->imageLayout)
+    return __fpx3d_vk_host_copy_image(lgpu, img, data);
+
+  Fpx3d_Vk_UploadBatch batch = {0};
+  FPX3D_ONFAIL(
+      __fpx3d_vk_begin_upload_batch(ctx->physicalGpu, lgpu, &batch), success,
+      return success;);
 
-  _fill_image_data(img, data, data_length, lgpu, ctx->physicalGpu);
+  FPX3D_ONFAIL(fpx3d_vk_batch_upload_image(
+                   &batch, img, data, fpx3d_vk_get_image_size_bytes(img),
+                   false),
+               success, FPX3D_ERROR("Failed to copy image data");
+               fpx3d_vk_discard_upload_batch(&batch); return success;);
 
-  return FPX3D_SUCCESS;
+  return _upload_and_wait(&batch);
 }
 
 Fpx3d_E_Result fpx3d_vk_image_readonly(Fpx3d_Vk_Image *image,
@@ -371,20 +481,17 @@ Fpx3d_E_Result fpx3d_vk_image_readonly(Fpx3d_Vk_Image *image,
   NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
   NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
 
-  struct fpx3d_vulkan_pool_queue_pair pair = _graphics_pool_and_queue(lgpu);
+  // a layout transition needs no staging memory, or the physical GPU
+  Fpx3d_Vk_UploadBatch batch = {0};
+  FPX3D_ONFAIL(__fpx3d_vk_begin_upload_batch(VK_NULL_HANDLE, lgpu, &batch),
+               success, return success;);
 
-  if (NULL == pair.pool || NULL == pair.queue) {
-    return FPX3D_VK_ERROR;
-  }
-
-  _transition_image_layout(
-      image->image, image->imageFormat, &image->imageLayout,
-      VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, image->subresourceRange,
-      *pair.pool, *pair.queue, lgpu->handle);
-
-  image->isReadOnly = true;
+  FPX3D_ONFAIL(fpx3d_vk_batch_transition_image(
+                   &batch, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL),
+               success, fpx3d_vk_discard_upload_batch(&batch);
+               return success;);
 
-  return FPX3D_SUCCESS;
+  return _upload_and_wait(&batch);
 }
 
 Fpx3d_E_Result fpx3d_vk_destroy_image(Fpx3d_Vk_Image *image,
@@ -399,8 +506,7 @@ Fpx3d_E_Result fpx3d_vk_destroy_image(Fpx3d_Vk_Image *image,
   if (VK_NULL_HANDLE != image->image)
     vkDestroyImage(lgpu->handle, image->image, NULL);
 
-  if (VK_NULL_HANDLE != image->memory)
-    vkFreeMemory(lgpu->handle, image->memory, NULL);
+  __fpx3d_vk_free(lgpu, &image->allocation);
 
   memset(image, 0, sizeof(*image));
 
@@ -418,8 +524,15 @@ Fpx3d_Vk_ImageSampler fpx3d_vk_create_image_sampler(Fpx3d_Vk_Context *ctx,
   NULL_CHECK(lgpu, retval);
   NULL_CHECK(lgpu->handle, retval);
 
-  _new_image_sampler(ctx, lgpu, VK_SAMPLER_ADDRESS_MODE_REPEAT, bilinear_filter,
-                     anisotropic_filter, &retval);
+  VkFilter mag_filter =
+      CONDITIONAL(bilinear_filter, VK_FILTER_LINEAR, VK_FILTER_NEAREST);
+  VkFilter min_filter =
+      CONDITIONAL(anisotropic_filter, VK_FILTER_LINEAR, VK_FILTER_NEAREST);
+
+  __fpx3d_vk_new_image_sampler(ctx, lgpu, mag_filter, min_filter,
+                               VK_SAMPLER_ADDRESS_MODE_REPEAT,
+                               VK_SAMPLER_ADDRESS_MODE_REPEAT,
+                               anisotropic_filter, &retval);
 
   return retval;
 }
@@ -457,173 +570,101 @@ Fpx3d_Vk_Texture fpx3d_vk_create_texture(Fpx3d_Vk_Image *image,
 size_t fpx3d_vk_get_image_size_bytes(Fpx3d_Vk_Image *image) {
   NULL_CHECK(image, 0);
 
+  if (FPX3D_VK_BLOCK_NONE != image->blockFormat)
+    return fpx3d_vk_compressed_size(image->blockFormat,
+                                    image->dimensions.width,
+                                    image->dimensions.height);
+
   return (size_t)(image->dimensions.width * image->dimensions.height *
                   image->dimensions.channels * image->dimensions.channelWidth);
 }
 
-// STATIC FUNCTIONS -------------------------------------------
-static Fpx3d_E_Result _new_image_sampler(Fpx3d_Vk_Context *ctx,
-                                         Fpx3d_Vk_LogicalGpu *lgpu,
-                                         VkSamplerAddressMode addr_mode,
-                                         bool bilinear, bool anisotropy,
-                                         Fpx3d_Vk_ImageSampler *output) {
-  NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
-  NULL_CHECK(ctx->physicalGpu, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
-
+// fills `image` from `data` on the host, leaving it in
+// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. The GPU can't be using it
+Fpx3d_E_Result __fpx3d_vk_host_copy_image(Fpx3d_Vk_LogicalGpu *lgpu,
+                                          Fpx3d_Vk_Image *image,
+                                          const void *data) {
   NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
   NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+  NULL_CHECK(image, FPX3D_ARGS_ERROR);
+  NULL_CHECK(image->image, FPX3D_VK_BAD_IMAGE_HANDLE_ERROR);
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
 
-  VkSampler new_sampler = {0};
-
-  if (VK_SAMPLER_ADDRESS_MODE_MAX_ENUM == addr_mode)
+  if (false == image->hostTransfer)
     return FPX3D_ARGS_ERROR;
 
-  VkSamplerCreateInfo s_info = {0};
-  s_info.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-  s_info.magFilter = CONDITIONAL(bilinear, VK_FILTER_LINEAR, VK_FILTER_NEAREST);
-  s_info.minFilter =
-      CONDITIONAL(anisotropy, VK_FILTER_LINEAR, VK_FILTER_NEAREST);
-
-  s_info.addressModeU = addr_mode;
-  s_info.addressModeV = addr_mode;
-  s_info.addressModeW = addr_mode;
+  VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
 
-  VkPhysicalDeviceProperties dev_props = {0};
-  VkPhysicalDeviceFeatures dev_features = {0};
-  vkGetPhysicalDeviceProperties(ctx->physicalGpu, &dev_props);
-  vkGetPhysicalDeviceFeatures(ctx->physicalGpu, &dev_features);
+  if (layout != image->imageLayout) {
+    VkHostImageLayoutTransitionInfoEXT t_info = {0};
+    t_info.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_LAYOUT_TRANSITION_INFO_EXT;
+    t_info.image = image->image;
+    t_info.oldLayout = image->imageLayout;
+    t_info.newLayout = layout;
+    t_info.subresourceRange = image->subresourceRange;
 
-  s_info.anisotropyEnable = CONDITIONAL(
-      anisotropy && dev_features.samplerAnisotropy, VK_TRUE, VK_FALSE);
-  s_info.maxAnisotropy = dev_props.limits.maxSamplerAnisotropy;
-
-  s_info.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-  s_info.unnormalizedCoordinates = VK_FALSE;
-
-  s_info.compareEnable = VK_FALSE;
-  s_info.compareOp = VK_COMPARE_OP_ALWAYS;
+    if (VK_SUCCESS != vkTransitionImageLayoutEXT(lgpu->handle, 1, &t_info)) {
+      FPX3D_WARN("Host image layout transition failed");
+      return FPX3D_VK_ERROR;
+    }
 
-  s_info.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-  s_info.mipLodBias = 0.0f;
-  s_info.minLod = 0.0f;
-  s_info.maxLod = 0.0f;
+    image->imageLayout = layout;
+  }
 
-  if (VK_SUCCESS != vkCreateSampler(lgpu->handle, &s_info, NULL, &new_sampler))
+  VkImageSubresourceRange s_range = image->subresourceRange;
+
+  // rows and layers are packed tightly, as with a buffer copy
+  VkMemoryToImageCopyEXT region = {0};
+  region.sType = VK_STRUCTURE_TYPE_MEMORY_TO_IMAGE_COPY_EXT;
+  region.pHostPointer = data;
+  region.imageSubresource.aspectMask = s_range.aspectMask;
+  region.imageSubresource.mipLevel = s_range.baseMipLevel;
+  region.imageSubresource.baseArrayLayer = s_range.baseArrayLayer;
+  region.imageSubresource.layerCount = s_range.layerCount;
+  region.imageExtent.width = image->dimensions.width;
+  region.imageExtent.height = image->dimensions.height;
+  region.imageExtent.depth = 1;
+
+  VkCopyMemoryToImageInfoEXT c_info = {0};
+  c_info.sType = VK_STRUCTURE_TYPE_COPY_MEMORY_TO_IMAGE_INFO_EXT;
+  c_info.dstImage = image->image;
+  c_info.dstImageLayout = layout;
+  c_info.regionCount = 1;
+  c_info.pRegions = &region;
+
+  if (VK_SUCCESS != vkCopyMemoryToImageEXT(lgpu->handle, &c_info)) {
+    FPX3D_WARN("Host image copy failed");
     return FPX3D_VK_ERROR;
+  }
 
-  output->handle = new_sampler;
-  output->isValid = true;
+  image->isReadOnly = true;
 
   return FPX3D_SUCCESS;
 }
 
-static Fpx3d_E_Result _fill_image_data(Fpx3d_Vk_Image *image, void *data,
-                                       size_t data_length,
-                                       Fpx3d_Vk_LogicalGpu *lgpu,
-                                       VkPhysicalDevice dev) {
+// records a barrier moving `image` from the layout it's in to `new`
+Fpx3d_E_Result __fpx3d_vk_record_image_transition(VkCommandBuffer cbuf,
+                                                  Fpx3d_Vk_Image *image,
+                                                  VkImageLayout new) {
+  NULL_CHECK(cbuf, FPX3D_ARGS_ERROR);
   NULL_CHECK(image, FPX3D_ARGS_ERROR);
-  NULL_CHECK(data, FPX3D_ARGS_ERROR);
-
   NULL_CHECK(image->image, FPX3D_VK_BAD_IMAGE_HANDLE_ERROR);
-  NULL_CHECK(image->memory, FPX3D_VK_BAD_MEMORY_HANDLE_ERROR);
-
-  struct fpx3d_vulkan_pool_queue_pair pair = _graphics_pool_and_queue(lgpu);
-
-  if (NULL == pair.pool || NULL == pair.queue) {
-    return FPX3D_GENERIC_ERROR;
-  }
-
-  data_length =
-      MIN(data_length, image->dimensions.width * image->dimensions.height *
-                           image->dimensions.channels *
-                           image->dimensions.channelWidth);
-  size_t size = data_length;
-
-  Fpx3d_Vk_Buffer staging_buf = {0};
-  FPX3D_ONFAIL(
-      __fpx3d_vk_new_buffer(dev, lgpu, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
-                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                            VK_SHARING_MODE_CONCURRENT, &staging_buf),
-      success,
-      FPX3D_ERROR("Failed to create staging buffer for image transfer");
-      return success;);
-
-  FPX3D_ONFAIL(__fpx3d_vk_data_to_buffer(lgpu, &staging_buf, data, size),
-               success,
-               FPX3D_ERROR("Failed to fill staging buffer with image data");
-               return success;);
-
-  FPX3D_ONFAIL(_vk_buf_to_image(staging_buf.buffer, image,
-                                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                image->subresourceRange, *pair.pool,
-                                *pair.queue, lgpu->handle),
-               success, FPX3D_ERROR("Failed to copy staging memory into image");
-               return success;);
-
-  __fpx3d_vk_destroy_buffer_object(lgpu, &staging_buf);
-
-  return FPX3D_SUCCESS;
-}
-
-static struct fpx3d_vulkan_pool_queue_pair
-_graphics_pool_and_queue(Fpx3d_Vk_LogicalGpu *lgpu) {
-  struct fpx3d_vulkan_pool_queue_pair pair = {0};
-
-  NULL_CHECK(lgpu, pair);
-  NULL_CHECK(lgpu->handle, pair);
-
-  VkQueue *graphics_queue = NULL;
-  VkCommandPool *graphics_pool = NULL;
-  if (NULL != lgpu->commandPools) {
-    graphics_pool = __fpx3d_vk_select_pool_of_type(GRAPHICS_POOL, lgpu);
-  }
-
-  if (NULL == graphics_pool) {
-    return pair;
-  }
-
-  if (NULL != lgpu->graphicsQueues.queues && lgpu->graphicsQueues.count > 0) {
-    graphics_queue =
-        &lgpu->graphicsQueues.queues[lgpu->graphicsQueues.nextToUse++];
-    pair.type = GRAPHICS_QUEUE;
-  } else {
-    return pair;
-  }
-
-  lgpu->graphicsQueues.nextToUse %= lgpu->graphicsQueues.count;
-
-  pair.pool = graphics_pool;
-  pair.queue = graphics_queue;
-
-  return pair;
-}
-
-static Fpx3d_E_Result
-_transition_image_layout(VkImage img, VkFormat fmt, VkImageLayout *old,
-                         VkImageLayout new, VkImageSubresourceRange s_range,
-                         VkCommandPool graphics_pool, VkQueue graphics_queue,
-                         VkDevice lgpu) {
-  UNUSED(fmt);
-
-  VkCommandBuffer cbuf =
-      __fpx3d_vk_begin_temp_command_buffer(graphics_pool, lgpu);
 
   VkImageMemoryBarrier barrier = {
       .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-      .oldLayout = *old,
+      .oldLayout = image->imageLayout,
       .newLayout = new,
       .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
       .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-      .image = img,
-      .subresourceRange = s_range,
+      .image = image->image,
+      .subresourceRange = image->subresourceRange,
       .srcAccessMask = 0,
       .dstAccessMask = 0};
 
   VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_FLAG_BITS_MAX_ENUM,
                        dstStage = VK_PIPELINE_STAGE_FLAG_BITS_MAX_ENUM;
 
-  switch (*old) {
+  switch (image->imageLayout) {
   case VK_IMAGE_LAYOUT_UNDEFINED:
     srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
     barrier.srcAccessMask = 0;
@@ -634,8 +675,15 @@ _transition_image_layout(VkImage img, VkFormat fmt, VkImageLayout *old,
     barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
     break;
 
+  case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+    // filling it again; only the reads have to be done first
+    srcStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    barrier.srcAccessMask = 0;
+    break;
+
   default:
-    FPX3D_ERROR("Image layout transition from %u not implemented", *old);
+    FPX3D_ERROR("Image layout transition from %u not implemented",
+                image->imageLayout);
     return FPX3D_GENERIC_ERROR;
     break;
   }
@@ -667,40 +715,50 @@ _transition_image_layout(VkImage img, VkFormat fmt, VkImageLayout *old,
   vkCmdPipelineBarrier(cbuf, srcStage, dstStage, 0, 0, NULL, 0, NULL, 1,
                        &barrier);
 
-  Fpx3d_E_Result success = __fpx3d_vk_end_temp_command_buffer(
-      cbuf, graphics_pool, graphics_queue, lgpu);
-  if (FPX3D_SUCCESS != success)
-    return success;
-
-  *old = new;
+  image->imageLayout = new;
 
   return FPX3D_SUCCESS;
 }
 
-static Fpx3d_E_Result _vk_buf_to_image(VkBuffer buf, Fpx3d_Vk_Image *img,
-                                       VkImageLayout layout,
-                                       VkImageSubresourceRange s_range,
-                                       VkCommandPool graphics_pool,
-                                       VkQueue graphics_queue, VkDevice lgpu) {
-  VkCommandBuffer cbuf =
-      __fpx3d_vk_begin_temp_command_buffer(graphics_pool, lgpu);
-
-  VkBufferImageCopy region = {
-      .bufferOffset = 0,
-      .bufferRowLength = 0,
-      .bufferImageHeight = 0,
-      .imageSubresource = {.aspectMask = s_range.aspectMask,
-                           .mipLevel = s_range.baseMipLevel,
-                           .baseArrayLayer = s_range.baseArrayLayer,
-                           .layerCount = s_range.layerCount},
-      .imageOffset = {0, 0, 0},
-      .imageExtent = {.width = img->dimensions.width,
-                      .height = img->dimensions.height,
-                      .depth = 1}};
-
-  vkCmdCopyBufferToImage(cbuf, buf, img->image, layout, 1, &region);
-
-  return __fpx3d_vk_end_temp_command_buffer(cbuf, graphics_pool, graphics_queue,
-                                            lgpu);
+// STATIC FUNCTIONS -------------------------------------------
+static Fpx3d_E_Result _upload_and_wait(Fpx3d_Vk_UploadBatch *batch) {
+  Fpx3d_Vk_LogicalGpu *lgpu = batch->logicalGpu;
+  Fpx3d_Vk_UploadTicket ticket = 0;
+
+  FPX3D_ONFAIL(fpx3d_vk_submit_upload_batch(batch, &ticket), success,
+               return success;);
+
+  return fpx3d_vk_wait_upload(lgpu, ticket);
 }
+
+// whether images of `fmt` can be made with `usage` (which includes
+// VK_IMAGE_USAGE_HOST_TRANSFER_BIT_EXT) without the GPU reading them any
+// slower for it
+static bool _host_transfer_usable(VkPhysicalDevice dev, VkFormat fmt,
+                                  VkImageTiling tiling,
+                                  VkImageUsageFlags usage) {
+  if (NULL == vkGetPhysicalDeviceImageFormatProperties2KHR)
+    return false;
+
+  VkPhysicalDeviceImageFormatInfo2 f_info = {0};
+  f_info.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2;
+  f_info.format = fmt;
+  f_info.type = VK_IMAGE_TYPE_2D;
+  f_info.tiling = tiling;
+  f_info.usage = usage;
+
+  VkHostImageCopyDevicePerformanceQueryEXT perf = {0};
+  perf.sType = VK_STRUCTURE_TYPE_HOST_IMAGE_COPY_DEVICE_PERFORMANCE_QUERY_EXT;
+
+  VkImageFormatProperties2 props = {0};
+  props.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2;
+  props.pNext = &perf;
+
+  if (VK_SUCCESS !=
+      vkGetPhysicalDeviceImageFormatProperties2KHR(dev, &f_info, &props))
+    return false;
+
+  return VK_TRUE == perf.optimalDeviceAccess;
+}
+
 // END OF STATIC FUNCTIONS -------------------------------------
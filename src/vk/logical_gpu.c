@@ -7,9 +7,11 @@
 #include "macros.h"
 #include "volk/volk.h"
 
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "vk/capabilities.h"
 #include "vk/context.h"
 #include "vk/pipeline.h"
 #include "vk/renderpass.h"
@@ -28,6 +30,13 @@ extern Fpx3d_E_Result __fpx3d_realloc_array(void **, size_t obj_size,
                                             size_t amount,
                                             size_t *old_capacity);
 
+extern Fpx3d_E_Result
+__fpx3d_vk_create_allocator(const Fpx3d_Vk_Capabilities *,
+                            Fpx3d_Vk_LogicalGpu *);
+extern void __fpx3d_vk_destroy_allocator(Fpx3d_Vk_LogicalGpu *);
+
+extern void __fpx3d_vk_destroy_staging_ring(Fpx3d_Vk_LogicalGpu *);
+
 // static declarations -----------------------------------------------
 static Fpx3d_E_Result _find_queue_families(Fpx3d_Vk_Context *ctx,
                                            size_t g_queues, size_t p_queues,
@@ -44,6 +53,7 @@ static Fpx3d_E_Result _create_queues(Fpx3d_Vk_LogicalGpu *,
 static bool _qf_meets_requirements(VkQueueFamilyProperties,
                                    Fpx3d_Vk_QueueFamilyRequirements *,
                                    size_t qf_index);
+static bool _host_image_copy_usable(Fpx3d_Vk_Context *);
 // end of static declarations ----------------------------------------
 
 struct fpx3d_vulkan_queues *
@@ -76,6 +86,9 @@ void __fpx3d_vk_destroy_lgpu(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu) {
 
   FPX3D_DEBUG("Starting destruction of a logical device");
 
+  // its command buffers come from the command pools
+  __fpx3d_vk_destroy_staging_ring(lgpu);
+
   if (NULL != lgpu->commandPools) {
     for (size_t i = 0; i < lgpu->commandPoolCapacity; ++i) {
       fpx3d_vk_destroy_commandpool_at(lgpu, i);
@@ -122,9 +135,14 @@ void __fpx3d_vk_destroy_lgpu(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu) {
     vkDestroyFence(lgpu->handle, lgpu->inFlightFences[i], NULL);
   }
   FREE_SAFE(lgpu->inFlightFences);
+  FREE_SAFE(lgpu->inFlightFrames);
 
   FPX3D_DEBUG(" - remaining sync objects destroyed");
 
+  __fpx3d_vk_destroy_allocator(lgpu);
+
+  FPX3D_DEBUG(" - device memory freed");
+
   if (VK_NULL_HANDLE != lgpu->handle) {
     vkDestroyDevice(lgpu->handle, NULL);
   }
@@ -158,12 +176,12 @@ Fpx3d_E_Result fpx3d_vk_create_logicalgpu_at(Fpx3d_Vk_Context *ctx,
   if (ctx->logicalGpuCapacity <= index)
     return FPX3D_NO_CAPACITY_ERROR;
 
+  const Fpx3d_Vk_Capabilities *caps = fpx3d_vk_get_capabilities(ctx);
+  NULL_CHECK(caps, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+
   Fpx3d_Vk_LogicalGpu new_lgpu = {0};
-  uint32_t available_qf_count = 0;
-  vkGetPhysicalDeviceQueueFamilyProperties(ctx->physicalGpu,
-                                           &available_qf_count, NULL);
 
-  if (1 > available_qf_count)
+  if (1 > caps->queueFamilyCount)
     return FPX3D_VK_ERROR; // TODO: make more specific errors
 
   struct fpx3d_vk_qf_holder qfs = {0};
@@ -314,6 +332,18 @@ Fpx3d_E_Result fpx3d_vk_create_logicalgpu_at(Fpx3d_Vk_Context *ctx,
   d_info.enabledExtensionCount = ctx->lgpuExtensionCount;
   d_info.ppEnabledExtensionNames = ctx->lgpuExtensions;
 
+  VkPhysicalDeviceHostImageCopyFeaturesEXT host_copy_features = {0};
+  if (_host_image_copy_usable(ctx)) {
+    host_copy_features.sType =
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+    host_copy_features.hostImageCopy = VK_TRUE;
+
+    d_info.pNext = &host_copy_features;
+    new_lgpu.hostImageCopy = true;
+
+    FPX3D_DEBUG(" - Textures are filled with host image copies");
+  }
+
   // // no longer required, but used for
   // // compatibility with older impl. of Vulkan
   // d_info.enabledLayerCount = ctx->instanceLayerCount;
@@ -335,6 +365,16 @@ Fpx3d_E_Result fpx3d_vk_create_logicalgpu_at(Fpx3d_Vk_Context *ctx,
     return FPX3D_VK_LGPU_CREATE_ERROR;
   }
 
+  {
+    Fpx3d_E_Result alloc_res =
+        __fpx3d_vk_create_allocator(caps, &new_lgpu);
+
+    if (FPX3D_SUCCESS != alloc_res) {
+      __fpx3d_vk_destroy_lgpu(ctx, &new_lgpu);
+      return alloc_res;
+    }
+  }
+
   new_lgpu.inFlightFences =
       (VkFence *)malloc(ctx->constants.maxFramesInFlight * sizeof(VkFence));
 
@@ -344,6 +384,16 @@ Fpx3d_E_Result fpx3d_vk_create_logicalgpu_at(Fpx3d_Vk_Context *ctx,
     return FPX3D_MEMORY_ERROR;
   }
 
+  new_lgpu.inFlightFrames = (uint64_t *)calloc(
+      ctx->constants.maxFramesInFlight, sizeof(*new_lgpu.inFlightFrames));
+
+  if (NULL == new_lgpu.inFlightFrames) {
+    perror("calloc()");
+
+    __fpx3d_vk_destroy_lgpu(ctx, &new_lgpu);
+    return FPX3D_MEMORY_ERROR;
+  }
+
   VkFenceCreateInfo f_info = {
       .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
       .flags = VK_FENCE_CREATE_SIGNALED_BIT,
@@ -580,32 +630,22 @@ static Fpx3d_Vk_QueueFamily
 _choose_queue_family(Fpx3d_Vk_Context *ctx,
                      Fpx3d_Vk_QueueFamilyRequirements *reqs) {
   Fpx3d_Vk_QueueFamily info = {0};
-  VkQueueFamilyProperties *props = NULL;
 
-  uint32_t available_qf_count = 0;
-  vkGetPhysicalDeviceQueueFamilyProperties(ctx->physicalGpu,
-                                           &available_qf_count, NULL);
-
-  if (0 == available_qf_count)
-    return info;
+  const Fpx3d_Vk_Capabilities *caps = fpx3d_vk_get_capabilities(ctx);
+  NULL_CHECK(caps, info);
 
-  props = (VkQueueFamilyProperties *)calloc(available_qf_count,
-                                            sizeof(VkQueueFamilyProperties));
+  const VkQueueFamilyProperties *props = caps->queueFamilies;
+  uint32_t available_qf_count = caps->queueFamilyCount;
 
-  if (NULL == props) {
-    perror("calloc()");
+  if (0 == available_qf_count)
     return info;
-  }
-
-  vkGetPhysicalDeviceQueueFamilyProperties(ctx->physicalGpu,
-                                           &available_qf_count, props);
 
   int64_t best_index = -1;
   for (int64_t i = 0; i < available_qf_count; ++i) {
     if (reqs->indexBlacklistBits & (1 << i))
       continue;
 
-    VkQueueFamilyProperties *prop = &props[i];
+    const VkQueueFamilyProperties *prop = &props[i];
 
     if (_qf_meets_requirements(*prop, reqs, i)) {
       if (best_index < 0) {
@@ -625,8 +665,6 @@ _choose_queue_family(Fpx3d_Vk_Context *ctx,
     info.isValid = true;
   }
 
-  FREE_SAFE(props);
-
   return info;
 }
 
@@ -692,4 +730,70 @@ static bool _qf_meets_requirements(VkQueueFamilyProperties fam,
 
   return false;
 }
+
+// VK_EXT_host_image_copy has to be among the lgpuExtensions (which takes
+// VK_KHR_get_physical_device_properties2 among the instance extensions),
+// and the device has to be able to copy into images that are in
+// VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+static bool _host_image_copy_usable(Fpx3d_Vk_Context *ctx) {
+  bool requested = false;
+  for (size_t i = 0; i < ctx->lgpuExtensionCount; ++i) {
+    if (0 == strcmp(ctx->lgpuExtensions[i],
+                    VK_EXT_HOST_IMAGE_COPY_EXTENSION_NAME))
+      requested = true;
+  }
+
+  if (false == requested || NULL == vkGetPhysicalDeviceFeatures2KHR ||
+      NULL == vkGetPhysicalDeviceProperties2KHR)
+    return false;
+
+  VkPhysicalDeviceHostImageCopyFeaturesEXT features = {0};
+  features.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_FEATURES_EXT;
+
+  VkPhysicalDeviceFeatures2 features2 = {0};
+  features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+  features2.pNext = &features;
+
+  vkGetPhysicalDeviceFeatures2KHR(ctx->physicalGpu, &features2);
+
+  if (VK_FALSE == features.hostImageCopy)
+    return false;
+
+  VkPhysicalDeviceHostImageCopyPropertiesEXT props = {0};
+  props.sType =
+      VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_HOST_IMAGE_COPY_PROPERTIES_EXT;
+
+  VkPhysicalDeviceProperties2 props2 = {0};
+  props2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+  props2.pNext = &props;
+
+  // first for the amount of layouts, then for the layouts themselves
+  vkGetPhysicalDeviceProperties2KHR(ctx->physicalGpu, &props2);
+
+  if (0 == props.copyDstLayoutCount)
+    return false;
+
+  VkImageLayout *layouts =
+      (VkImageLayout *)calloc(props.copyDstLayoutCount, sizeof(VkImageLayout));
+  if (NULL == layouts) {
+    perror("calloc()");
+    return false;
+  }
+
+  props.copySrcLayoutCount = 0;
+  props.pCopyDstLayouts = layouts;
+  vkGetPhysicalDeviceProperties2KHR(ctx->physicalGpu, &props2);
+
+  bool usable = false;
+  for (uint32_t i = 0; i < props.copyDstLayoutCount; ++i) {
+    if (VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL == layouts[i])
+      usable = true;
+  }
+
+  FREE_SAFE(layouts);
+
+  return usable;
+}
+
 // END OF STATIC FUNCTIONS ----------------------------------
@@ -0,0 +1,554 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+// Every chunk of a mesh arena is one device-local buffer. The ranges of it
+// that no shape buffer holds are kept in a list sorted by offset, which is
+// searched first-fit; a range that is given back is merged with the free
+// ranges next to it. Ranges of destroyed shape buffers are retired first,
+// and only given back once the frames that may still draw them are done
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+#include "volk/volk.h"
+
+#include "vk/buffer.h"
+#include "vk/context.h"
+#include "vk/logical_gpu.h"
+#include "vk/mesh_arena.h"
+#include "vk/shape.h"
+#include "vk/typedefs.h"
+#include "vk/upload.h"
+#include "vk/vertex.h"
+
+#define DEFAULT_CHUNK_SIZE ((VkDeviceSize)16 * 1024 * 1024)
+
+#define INITIAL_FREE_CAPACITY 16
+
+extern Fpx3d_E_Result __fpx3d_realloc_array(void **arr_ptr, size_t obj_size,
+                                            size_t amount,
+                                            size_t *old_capacity);
+
+extern Fpx3d_E_Result
+__fpx3d_vk_new_buffer(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
+                      VkDeviceSize size, VkBufferUsageFlags usage,
+                      VkMemoryPropertyFlags mem_flags, VkSharingMode,
+                      Fpx3d_Vk_Buffer *output_buffer);
+extern void __fpx3d_vk_destroy_buffer_object(Fpx3d_Vk_LogicalGpu *,
+                                             Fpx3d_Vk_Buffer *);
+
+extern Fpx3d_E_Result __fpx3d_vk_begin_upload_batch(VkPhysicalDevice,
+                                                    Fpx3d_Vk_LogicalGpu *,
+                                                    Fpx3d_Vk_UploadBatch *);
+extern Fpx3d_E_Result
+__fpx3d_vk_batch_fill_buffer_range(Fpx3d_Vk_UploadBatch *, Fpx3d_Vk_Buffer *,
+                                   VkDeviceSize dst_offset, const void *data,
+                                   VkDeviceSize size);
+
+struct fpx3d_vk_arena_range {
+  VkDeviceSize offset;
+  VkDeviceSize size;
+};
+
+struct fpx3d_vk_retired_range {
+  VkDeviceSize offset;
+  VkDeviceSize size;
+
+  // Fpx3d_Vk_LogicalGpu::frameIndex when it was retired
+  uint64_t frame;
+};
+
+struct fpx3d_vk_mesh_arena_chunk {
+  Fpx3d_Vk_Buffer buffer;
+  VkDeviceSize size;
+
+  // sorted by offset; no two of them touch
+  struct fpx3d_vk_arena_range *freeRanges;
+  size_t freeCount;
+  size_t freeCapacity;
+
+  // oldest first
+  struct fpx3d_vk_retired_range *retiredRanges;
+  size_t retiredCount;
+  size_t retiredCapacity;
+};
+
+void __fpx3d_vk_arena_release_shapebuffer(Fpx3d_Vk_ShapeBuffer *);
+
+// static declarations ----
+
+static Fpx3d_E_Result _reserve(Fpx3d_Vk_MeshArena *, bool indices,
+                               VkDeviceSize size, VkDeviceSize alignment,
+                               struct fpx3d_vk_mesh_arena_chunk **chunk_out,
+                               VkDeviceSize *offset_out);
+static void _give_back(struct fpx3d_vk_mesh_arena_chunk *, VkDeviceSize offset,
+                       VkDeviceSize size);
+static void _retire(Fpx3d_Vk_MeshArena *, struct fpx3d_vk_mesh_arena_chunk *,
+                    VkDeviceSize offset, VkDeviceSize size);
+static void _reclaim(Fpx3d_Vk_MeshArena *, struct fpx3d_vk_mesh_arena_chunk *);
+
+static bool _chunk_take(struct fpx3d_vk_mesh_arena_chunk *, VkDeviceSize size,
+                        VkDeviceSize alignment, VkDeviceSize *offset_out);
+static Fpx3d_E_Result _insert_free(struct fpx3d_vk_mesh_arena_chunk *,
+                                   size_t index,
+                                   struct fpx3d_vk_arena_range);
+static void _remove_free(struct fpx3d_vk_mesh_arena_chunk *, size_t index);
+
+static struct fpx3d_vk_mesh_arena_chunk *
+_new_chunk(Fpx3d_Vk_MeshArena *, VkDeviceSize size, VkBufferUsageFlags);
+static void _destroy_chunk(Fpx3d_Vk_LogicalGpu *,
+                           struct fpx3d_vk_mesh_arena_chunk *);
+
+// end of static declarations ----
+
+Fpx3d_E_Result fpx3d_vk_create_mesh_arena(Fpx3d_Vk_Context *ctx,
+                                          Fpx3d_Vk_LogicalGpu *lgpu,
+                                          VkDeviceSize chunk_size,
+                                          Fpx3d_Vk_MeshArena *output) {
+  NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  NULL_CHECK(ctx->physicalGpu, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+
+  Fpx3d_Vk_MeshArena arena = {
+      .logicalGpu = lgpu,
+      .physicalGpu = ctx->physicalGpu,
+      .chunkSize = CONDITIONAL(0 < chunk_size, chunk_size, DEFAULT_CHUNK_SIZE),
+      .framesInFlight = ctx->constants.maxFramesInFlight,
+      .isValid = true,
+  };
+
+  *output = arena;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_destroy_mesh_arena(Fpx3d_Vk_MeshArena *arena) {
+  NULL_CHECK(arena, FPX3D_ARGS_ERROR);
+
+  if (0 < arena->shapeBufferCount) {
+    FPX3D_WARN("Destroying mesh arena with %" LONG_FORMAT
+               "u shape buffers left",
+               arena->shapeBufferCount);
+  }
+
+  for (size_t i = 0; i < arena->vertexChunkCount; ++i)
+    _destroy_chunk(arena->logicalGpu, arena->vertexChunks[i]);
+
+  for (size_t i = 0; i < arena->indexChunkCount; ++i)
+    _destroy_chunk(arena->logicalGpu, arena->indexChunks[i]);
+
+  FREE_SAFE(arena->vertexChunks);
+  FREE_SAFE(arena->indexChunks);
+
+  memset(arena, 0, sizeof(*arena));
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_create_arena_shapebuffer(
+    Fpx3d_Vk_MeshArena *arena, Fpx3d_Vk_VertexBundle *vertex_input,
+    Fpx3d_Vk_ShapeBuffer *shape_output) {
+  NULL_CHECK(arena, FPX3D_ARGS_ERROR);
+  NULL_CHECK(vertex_input, FPX3D_ARGS_ERROR);
+  NULL_CHECK(shape_output, FPX3D_ARGS_ERROR);
+
+  if (false == arena->isValid)
+    return FPX3D_ARGS_ERROR;
+
+  Fpx3d_Vk_UploadBatch batch = {0};
+
+  FPX3D_ONFAIL(__fpx3d_vk_begin_upload_batch(arena->physicalGpu,
+                                             arena->logicalGpu, &batch),
+               success, return success;);
+
+  Fpx3d_Vk_ShapeBuffer new_shape = {0};
+
+  FPX3D_ONFAIL(fpx3d_vk_batch_create_arena_shapebuffer(&batch, arena,
+                                                       vertex_input,
+                                                       &new_shape),
+               success, fpx3d_vk_discard_upload_batch(&batch);
+               return success;);
+
+  Fpx3d_Vk_UploadTicket ticket = 0;
+
+  Fpx3d_E_Result retval = fpx3d_vk_submit_upload_batch(&batch, &ticket);
+
+  if (FPX3D_SUCCESS == retval)
+    retval = fpx3d_vk_wait_upload(arena->logicalGpu, ticket);
+
+  if (FPX3D_SUCCESS != retval) {
+    __fpx3d_vk_arena_release_shapebuffer(&new_shape);
+    return retval;
+  }
+
+  *shape_output = new_shape;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result
+fpx3d_vk_batch_create_arena_shapebuffer(Fpx3d_Vk_UploadBatch *batch,
+                                        Fpx3d_Vk_MeshArena *arena,
+                                        Fpx3d_Vk_VertexBundle *vertex_input,
+                                        Fpx3d_Vk_ShapeBuffer *shape_output) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(arena, FPX3D_ARGS_ERROR);
+  NULL_CHECK(vertex_input, FPX3D_ARGS_ERROR);
+  NULL_CHECK(shape_output, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid || false == arena->isValid ||
+      batch->logicalGpu != arena->logicalGpu)
+    return FPX3D_ARGS_ERROR;
+
+  if (1 > vertex_input->vertexCount || 1 > vertex_input->vertexDataSize ||
+      NULL == vertex_input->vertices)
+    return FPX3D_ARGS_ERROR;
+
+  if (0 < vertex_input->indexCount && NULL == vertex_input->indices)
+    return FPX3D_ARGS_ERROR;
+
+  Fpx3d_Vk_ShapeBuffer new_shape = {0};
+  new_shape.arena = arena;
+
+  VkDeviceSize stride = vertex_input->vertexDataSize;
+  VkDeviceSize vertex_size = vertex_input->vertexCount * stride;
+
+  // vertex ranges start at a whole vertex, so draws can count from there
+  VkDeviceSize vertex_offset = 0;
+
+  FPX3D_ONFAIL(_reserve(arena, false, vertex_size, stride,
+                        &new_shape.vertexChunk, &vertex_offset),
+               success, return success;);
+
+  new_shape.vertexBuffer = new_shape.vertexChunk->buffer;
+  new_shape.vertexBuffer.objectCount = vertex_input->vertexCount;
+  new_shape.vertexBuffer.stride = stride;
+  new_shape.vertexOffset = (int32_t)(vertex_offset / stride);
+
+  ++arena->shapeBufferCount;
+
+  // reserved ranges were never drawn from, or retired long enough ago
+  Fpx3d_E_Result retval = __fpx3d_vk_batch_fill_buffer_range(
+      batch, &new_shape.vertexChunk->buffer, vertex_offset,
+      vertex_input->vertices, vertex_size);
+
+  if (FPX3D_SUCCESS == retval && 0 < vertex_input->indexCount) {
+    VkDeviceSize index_stride = sizeof(vertex_input->indices[0]);
+    VkDeviceSize index_size = vertex_input->indexCount * index_stride;
+    VkDeviceSize index_offset = 0;
+
+    retval = _reserve(arena, true, index_size, index_stride,
+                      &new_shape.indexChunk, &index_offset);
+
+    if (FPX3D_SUCCESS == retval) {
+      new_shape.indexBuffer = new_shape.indexChunk->buffer;
+      new_shape.indexBuffer.objectCount = vertex_input->indexCount;
+      new_shape.indexBuffer.stride = index_stride;
+      new_shape.firstIndex = (uint32_t)(index_offset / index_stride);
+
+      retval = __fpx3d_vk_batch_fill_buffer_range(
+          batch, &new_shape.indexChunk->buffer, index_offset,
+          vertex_input->indices, index_size);
+    }
+  }
+
+  if (FPX3D_SUCCESS != retval) {
+    __fpx3d_vk_arena_release_shapebuffer(&new_shape);
+    return retval;
+  }
+
+  *shape_output = new_shape;
+
+  return FPX3D_SUCCESS;
+}
+
+// called by fpx3d_vk_destroy_shapebuffer() for shape buffers that were
+// made in an arena; their ranges can be handed out again
+void __fpx3d_vk_arena_release_shapebuffer(Fpx3d_Vk_ShapeBuffer *shape) {
+  NULL_CHECK(shape, );
+  NULL_CHECK(shape->arena, );
+
+  if (NULL != shape->vertexChunk) {
+    VkDeviceSize stride = shape->vertexBuffer.stride;
+
+    _retire(shape->arena, shape->vertexChunk,
+            (VkDeviceSize)shape->vertexOffset * stride,
+            shape->vertexBuffer.objectCount * stride);
+  }
+
+  if (NULL != shape->indexChunk) {
+    VkDeviceSize stride = shape->indexBuffer.stride;
+
+    _retire(shape->arena, shape->indexChunk,
+            (VkDeviceSize)shape->firstIndex * stride,
+            shape->indexBuffer.objectCount * stride);
+  }
+
+  --shape->arena->shapeBufferCount;
+
+  memset(shape, 0, sizeof(*shape));
+}
+
+// STATIC FUNCTIONS ----
+
+// the first chunk with room for it, or a new one
+static Fpx3d_E_Result _reserve(Fpx3d_Vk_MeshArena *arena, bool indices,
+                               VkDeviceSize size, VkDeviceSize alignment,
+                               struct fpx3d_vk_mesh_arena_chunk **chunk_out,
+                               VkDeviceSize *offset_out) {
+  struct fpx3d_vk_mesh_arena_chunk ***chunks =
+      CONDITIONAL(indices, &arena->indexChunks, &arena->vertexChunks);
+  size_t *count =
+      CONDITIONAL(indices, &arena->indexChunkCount, &arena->vertexChunkCount);
+
+  for (size_t i = 0; i < *count; ++i) {
+    _reclaim(arena, (*chunks)[i]);
+
+    if (_chunk_take((*chunks)[i], size, alignment, offset_out)) {
+      *chunk_out = (*chunks)[i];
+      return FPX3D_SUCCESS;
+    }
+  }
+
+  size_t capacity = *count;
+
+  FPX3D_ONFAIL(__fpx3d_realloc_array((void **)chunks, sizeof(**chunks),
+                                     *count + 1, &capacity),
+               success, return success;);
+
+  VkBufferUsageFlags usage =
+      VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+      CONDITIONAL(indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                  VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+  struct fpx3d_vk_mesh_arena_chunk *chunk =
+      _new_chunk(arena, MAX(arena->chunkSize, size), usage);
+  if (NULL == chunk)
+    return FPX3D_VK_ERROR;
+
+  (*chunks)[(*count)++] = chunk;
+
+  // a fresh chunk starts at offset 0, which suits any alignment
+  _chunk_take(chunk, size, alignment, offset_out);
+  *chunk_out = chunk;
+
+  return FPX3D_SUCCESS;
+}
+
+static void _give_back(struct fpx3d_vk_mesh_arena_chunk *chunk,
+                       VkDeviceSize offset, VkDeviceSize size) {
+  if (0 == size)
+    return;
+
+  // first free range past `offset`
+  size_t low = 0, high = chunk->freeCount;
+
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+
+    if (chunk->freeRanges[mid].offset < offset)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+
+  struct fpx3d_vk_arena_range *prev =
+      CONDITIONAL(0 < low, &chunk->freeRanges[low - 1], NULL);
+  struct fpx3d_vk_arena_range *next =
+      CONDITIONAL(low < chunk->freeCount, &chunk->freeRanges[low], NULL);
+
+  bool join_prev = NULL != prev && prev->offset + prev->size == offset;
+  bool join_next = NULL != next && offset + size == next->offset;
+
+  if (join_prev && join_next) {
+    prev->size += size + next->size;
+    _remove_free(chunk, low);
+  } else if (join_prev) {
+    prev->size += size;
+  } else if (join_next) {
+    next->offset = offset;
+    next->size += size;
+  } else {
+    struct fpx3d_vk_arena_range range = {.offset = offset, .size = size};
+
+    // without memory for the bookkeeping, the range is lost until the
+    // arena is destroyed
+    if (FPX3D_SUCCESS != _insert_free(chunk, low, range)) {
+      FPX3D_WARN("Lost %" LONG_FORMAT "u bytes of a mesh arena",
+                 (size_t)size);
+    }
+  }
+}
+
+// frames submitted so far may still draw from the range; those are done
+// once maxFramesInFlight more have gone by
+static void _retire(Fpx3d_Vk_MeshArena *arena,
+                    struct fpx3d_vk_mesh_arena_chunk *chunk,
+                    VkDeviceSize offset, VkDeviceSize size) {
+  if (0 == size)
+    return;
+
+  if (chunk->retiredCount == chunk->retiredCapacity &&
+      FPX3D_SUCCESS != __fpx3d_realloc_array(
+                           (void **)&chunk->retiredRanges,
+                           sizeof(*chunk->retiredRanges),
+                           MAX(chunk->retiredCapacity * 2,
+                               INITIAL_FREE_CAPACITY),
+                           &chunk->retiredCapacity)) {
+    FPX3D_WARN("Lost %" LONG_FORMAT "u bytes of a mesh arena", (size_t)size);
+    return;
+  }
+
+  struct fpx3d_vk_retired_range range = {
+      .offset = offset,
+      .size = size,
+      .frame = arena->logicalGpu->frameIndex,
+  };
+
+  chunk->retiredRanges[chunk->retiredCount++] = range;
+}
+
+static void _reclaim(Fpx3d_Vk_MeshArena *arena,
+                     struct fpx3d_vk_mesh_arena_chunk *chunk) {
+  uint64_t in_flight = arena->framesInFlight;
+  size_t done = 0;
+
+  while (done < chunk->retiredCount &&
+         chunk->retiredRanges[done].frame + in_flight <
+             arena->logicalGpu->frameIndex) {
+    _give_back(chunk, chunk->retiredRanges[done].offset,
+               chunk->retiredRanges[done].size);
+    ++done;
+  }
+
+  if (0 == done)
+    return;
+
+  chunk->retiredCount -= done;
+
+  memmove(chunk->retiredRanges, &chunk->retiredRanges[done],
+          chunk->retiredCount * sizeof(*chunk->retiredRanges));
+}
+
+static bool _chunk_take(struct fpx3d_vk_mesh_arena_chunk *chunk,
+                        VkDeviceSize size, VkDeviceSize alignment,
+                        VkDeviceSize *offset_out) {
+  for (size_t i = 0; i < chunk->freeCount; ++i) {
+    struct fpx3d_vk_arena_range range = chunk->freeRanges[i];
+
+    // alignments are vertex sizes, which need not be powers of two
+    VkDeviceSize start =
+        (range.offset + alignment - 1) / alignment * alignment;
+
+    if (start + size > range.offset + range.size)
+      continue;
+
+    VkDeviceSize front = start - range.offset;
+    VkDeviceSize back = range.offset + range.size - (start + size);
+
+    if (0 < front && 0 < back) {
+      struct fpx3d_vk_arena_range rest = {.offset = start + size,
+                                          .size = back};
+
+      if (FPX3D_SUCCESS != _insert_free(chunk, i + 1, rest))
+        continue;
+
+      chunk->freeRanges[i].size = front;
+    } else if (0 < front) {
+      chunk->freeRanges[i].size = front;
+    } else if (0 < back) {
+      chunk->freeRanges[i].offset = start + size;
+      chunk->freeRanges[i].size = back;
+    } else {
+      _remove_free(chunk, i);
+    }
+
+    *offset_out = start;
+
+    return true;
+  }
+
+  return false;
+}
+
+static Fpx3d_E_Result _insert_free(struct fpx3d_vk_mesh_arena_chunk *chunk,
+                                   size_t index,
+                                   struct fpx3d_vk_arena_range range) {
+  if (chunk->freeCount == chunk->freeCapacity) {
+    FPX3D_ONFAIL(__fpx3d_realloc_array(
+                     (void **)&chunk->freeRanges, sizeof(*chunk->freeRanges),
+                     MAX(chunk->freeCapacity * 2, INITIAL_FREE_CAPACITY),
+                     &chunk->freeCapacity),
+                 success, return success;);
+  }
+
+  memmove(&chunk->freeRanges[index + 1], &chunk->freeRanges[index],
+          (chunk->freeCount - index) * sizeof(*chunk->freeRanges));
+
+  chunk->freeRanges[index] = range;
+  ++chunk->freeCount;
+
+  return FPX3D_SUCCESS;
+}
+
+static void _remove_free(struct fpx3d_vk_mesh_arena_chunk *chunk,
+                         size_t index) {
+  memmove(&chunk->freeRanges[index], &chunk->freeRanges[index + 1],
+          (chunk->freeCount - index - 1) * sizeof(*chunk->freeRanges));
+
+  --chunk->freeCount;
+}
+
+static struct fpx3d_vk_mesh_arena_chunk *
+_new_chunk(Fpx3d_Vk_MeshArena *arena, VkDeviceSize size,
+           VkBufferUsageFlags usage) {
+  struct fpx3d_vk_mesh_arena_chunk *chunk = calloc(1, sizeof(*chunk));
+  if (NULL == chunk) {
+    perror("calloc()");
+    return NULL;
+  }
+
+  struct fpx3d_vk_arena_range whole = {.offset = 0, .size = size};
+
+  if (FPX3D_SUCCESS != _insert_free(chunk, 0, whole)) {
+    FREE_SAFE(chunk);
+    return NULL;
+  }
+
+  if (FPX3D_SUCCESS !=
+      __fpx3d_vk_new_buffer(arena->physicalGpu, arena->logicalGpu, size,
+                            usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                            VK_SHARING_MODE_EXCLUSIVE, &chunk->buffer)) {
+    FREE_SAFE(chunk->freeRanges);
+    FREE_SAFE(chunk);
+    return NULL;
+  }
+
+  chunk->size = size;
+
+  FPX3D_DEBUG("New %" LONG_FORMAT "u byte mesh arena buffer", (size_t)size);
+
+  return chunk;
+}
+
+static void _destroy_chunk(Fpx3d_Vk_LogicalGpu *lgpu,
+                           struct fpx3d_vk_mesh_arena_chunk *chunk) {
+  __fpx3d_vk_destroy_buffer_object(lgpu, &chunk->buffer);
+
+  FREE_SAFE(chunk->freeRanges);
+  FREE_SAFE(chunk->retiredRanges);
+  FREE_SAFE(chunk);
+}
+
+// END OF STATIC FUNCTIONS ----
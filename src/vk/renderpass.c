@@ -18,7 +18,7 @@
 
 extern VkFormat __fpx3d_vk_supported_format(VkFormat *fmts, size_t count,
                                             VkImageTiling, VkFormatFeatureFlags,
-                                            VkPhysicalDevice);
+                                            const Fpx3d_Vk_Capabilities *);
 
 extern Fpx3d_E_Result __fpx3d_realloc_array(void **array_ptr, size_t obj_size,
                                             size_t amount,
@@ -89,7 +89,8 @@ Fpx3d_E_Result fpx3d_vk_create_renderpass_at(Fpx3d_Vk_LogicalGpu *lgpu,
 
     depth_attachment->format = __fpx3d_vk_supported_format(
         fmt_choices, ARRAY_SIZE(fmt_choices), VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT, ctx->physicalGpu);
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT,
+        fpx3d_vk_get_capabilities(ctx));
 
     if (VK_FORMAT_UNDEFINED == depth_attachment->format) {
       // error
@@ -0,0 +1,528 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#include "vk/context.h"
+#include "vk/image.h"
+#include "vk/logical_gpu.h"
+#include "vk/residency.h"
+#include "vk/shape.h"
+#include "vk/typedefs.h"
+#include "vk/vertex.h"
+
+#include "vulkan/vulkan_core.h"
+
+#include "volk/volk.h"
+
+extern Fpx3d_E_Result __fpx3d_realloc_array(void **arr_ptr, size_t obj_size,
+                                            size_t amount,
+                                            size_t *old_capacity);
+
+struct fpx3d_vk_residency_entry {
+  enum {
+    RESIDENT_MESH = 0,
+    RESIDENT_IMAGE = 1,
+  } type;
+
+  // the CPU copy, which uploads are made from
+  Fpx3d_Vk_VertexBundle vertices;
+  Fpx3d_Vk_ImageDimensions dimensions;
+  void *pixels;
+
+  Fpx3d_Vk_ShapeBuffer shapeBuffer;
+  Fpx3d_Vk_Image image;
+
+  bool resident;
+
+  // drawn while evicted
+  bool wanted;
+
+  // device memory taken while resident. Before the first upload, the
+  // size of the CPU copy stands in for it
+  size_t bytes;
+
+  uint64_t lastUsedFrame;
+
+  // into the residency's entries
+  size_t index;
+};
+
+// static declarations ----
+
+static Fpx3d_E_Result _add_entry(Fpx3d_Vk_Residency *,
+                                 Fpx3d_Vk_Resident *entry);
+
+static Fpx3d_E_Result _make_resident(Fpx3d_Vk_Residency *,
+                                     Fpx3d_Vk_Resident *);
+static Fpx3d_E_Result _upload(Fpx3d_Vk_Residency *, Fpx3d_Vk_Resident *);
+static void _evict(Fpx3d_Vk_Residency *, Fpx3d_Vk_Resident *);
+static void _destroy_gpu_copy(Fpx3d_Vk_Residency *, Fpx3d_Vk_Resident *);
+static bool _evict_until_fits(Fpx3d_Vk_Residency *, size_t needed,
+                              const Fpx3d_Vk_Resident *keep);
+
+static bool _is_idle(const Fpx3d_Vk_Residency *, const Fpx3d_Vk_Resident *);
+static int _compare_last_used(const void *a, const void *b);
+
+static void _free_entry(Fpx3d_Vk_Residency *, Fpx3d_Vk_Resident *);
+
+// end of static declarations ----
+
+Fpx3d_E_Result fpx3d_vk_create_residency(Fpx3d_Vk_Context *ctx,
+                                         Fpx3d_Vk_LogicalGpu *lgpu,
+                                         size_t budget_bytes,
+                                         Fpx3d_Vk_Residency *output) {
+  NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(ctx->physicalGpu, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  if (0 == budget_bytes) {
+    const Fpx3d_Vk_Capabilities *caps = fpx3d_vk_get_capabilities(ctx);
+    NULL_CHECK(caps, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+
+    const VkPhysicalDeviceMemoryProperties *mem_props =
+        &caps->memoryProperties;
+
+    VkDeviceSize largest = 0;
+    for (uint32_t i = 0; i < mem_props->memoryHeapCount; ++i) {
+      if (mem_props->memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+        largest = MAX(largest, mem_props->memoryHeaps[i].size);
+    }
+
+    // leave room for swapchain images, pipelines and everything else
+    budget_bytes = (size_t)(largest / 4 * 3);
+  }
+
+  FPX3D_DEBUG("Residency budget: %" LONG_FORMAT "u bytes", budget_bytes);
+
+  Fpx3d_Vk_Residency residency = {
+      .context = ctx,
+      .logicalGpu = lgpu,
+      .budgetBytes = budget_bytes,
+  };
+
+  *output = residency;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_destroy_residency(Fpx3d_Vk_Residency *residency) {
+  NULL_CHECK(residency, FPX3D_ARGS_ERROR);
+
+  for (size_t i = 0; NULL != residency->entries && i < residency->entryCount;
+       ++i)
+    _free_entry(residency, residency->entries[i]);
+
+  FPX3D_DEBUG("Residency made %" LONG_FORMAT "u uploads and %" LONG_FORMAT
+              "u evictions",
+              residency->uploads, residency->evictions);
+
+  FREE_SAFE(residency->entries);
+
+  memset(residency, 0, sizeof(*residency));
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result
+fpx3d_vk_residency_add_vertices(Fpx3d_Vk_Residency *residency,
+                                const Fpx3d_Vk_VertexBundle *bundle,
+                                Fpx3d_Vk_Resident **output) {
+  NULL_CHECK(residency, FPX3D_ARGS_ERROR);
+  NULL_CHECK(bundle, FPX3D_ARGS_ERROR);
+  NULL_CHECK(bundle->vertices, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  if (1 > bundle->vertexCount || 1 > bundle->vertexDataSize)
+    return FPX3D_ARGS_ERROR;
+
+  Fpx3d_Vk_Resident *entry = calloc(1, sizeof(*entry));
+  if (NULL == entry) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  entry->type = RESIDENT_MESH;
+
+  Fpx3d_E_Result retval =
+      fpx3d_vk_allocate_vertices(&entry->vertices, bundle->vertexCount,
+                                 bundle->vertexDataSize);
+  if (FPX3D_SUCCESS != retval) {
+    FREE_SAFE(entry);
+    return retval;
+  }
+
+  memcpy(entry->vertices.vertices, bundle->vertices,
+         bundle->vertexCount * bundle->vertexDataSize);
+  entry->vertices.vertexCount = bundle->vertexCount;
+
+  if (0 < bundle->indexCount && NULL != bundle->indices) {
+    retval = fpx3d_vk_set_indices(&entry->vertices, bundle->indices,
+                                  bundle->indexCount);
+    if (FPX3D_SUCCESS != retval) {
+      fpx3d_vk_free_vertices(&entry->vertices);
+      FREE_SAFE(entry);
+      return retval;
+    }
+  }
+
+  entry->shapeBuffer.residency = entry;
+  entry->bytes = bundle->vertexCount * bundle->vertexDataSize +
+                 bundle->indexCount * sizeof(uint32_t);
+
+  retval = _add_entry(residency, entry);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  *output = entry;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_residency_add_image(Fpx3d_Vk_Residency *residency,
+                                            Fpx3d_Vk_ImageDimensions dims,
+                                            const void *pixels,
+                                            Fpx3d_Vk_Resident **output) {
+  NULL_CHECK(residency, FPX3D_ARGS_ERROR);
+  NULL_CHECK(pixels, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  size_t size = (size_t)dims.width * dims.height * dims.channels *
+                dims.channelWidth;
+  if (1 > size)
+    return FPX3D_ARGS_ERROR;
+
+  Fpx3d_Vk_Resident *entry = calloc(1, sizeof(*entry));
+  if (NULL == entry) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  entry->pixels = malloc(size);
+  if (NULL == entry->pixels) {
+    perror("malloc()");
+    FREE_SAFE(entry);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  memcpy(entry->pixels, pixels, size);
+
+  entry->type = RESIDENT_IMAGE;
+  entry->dimensions = dims;
+  entry->bytes = size;
+
+  Fpx3d_E_Result retval = _add_entry(residency, entry);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  *output = entry;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_residency_remove(Fpx3d_Vk_Residency *residency,
+                                         Fpx3d_Vk_Resident *entry) {
+  NULL_CHECK(residency, FPX3D_ARGS_ERROR);
+  NULL_CHECK(entry, FPX3D_ARGS_ERROR);
+
+  if (residency->entryCount <= entry->index ||
+      entry != residency->entries[entry->index])
+    return FPX3D_ARGS_ERROR;
+
+  // the last entry takes its place
+  size_t index = entry->index;
+
+  residency->entries[index] = residency->entries[--residency->entryCount];
+  residency->entries[index]->index = index;
+
+  _free_entry(residency, entry);
+
+  return FPX3D_SUCCESS;
+}
+
+const Fpx3d_Vk_ShapeBuffer *
+fpx3d_vk_resident_shapebuffer(const Fpx3d_Vk_Resident *entry) {
+  NULL_CHECK(entry, NULL);
+
+  if (RESIDENT_MESH != entry->type)
+    return NULL;
+
+  return &entry->shapeBuffer;
+}
+
+Fpx3d_E_Result fpx3d_vk_residency_use_image(Fpx3d_Vk_Residency *residency,
+                                            Fpx3d_Vk_Resident *entry,
+                                            Fpx3d_Vk_Image **output,
+                                            bool *reuploaded) {
+  NULL_CHECK(residency, FPX3D_ARGS_ERROR);
+  NULL_CHECK(residency->logicalGpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(entry, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  if (RESIDENT_IMAGE != entry->type)
+    return FPX3D_ARGS_ERROR;
+
+  bool uploaded = false;
+
+  if (false == entry->resident) {
+    Fpx3d_E_Result retval = _make_resident(residency, entry);
+    if (FPX3D_SUCCESS != retval)
+      return retval;
+
+    uploaded = true;
+  }
+
+  entry->lastUsedFrame = residency->logicalGpu->frameIndex;
+
+  if (NULL != reuploaded)
+    *reuploaded = uploaded;
+
+  *output = &entry->image;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_residency_update(Fpx3d_Vk_Residency *residency) {
+  NULL_CHECK(residency, FPX3D_ARGS_ERROR);
+
+  // the budget may have shrunk since the last frame
+  _evict_until_fits(residency, 0, NULL);
+
+  for (size_t i = 0; i < residency->entryCount; ++i) {
+    Fpx3d_Vk_Resident *entry = residency->entries[i];
+
+    if (entry->resident || false == entry->wanted)
+      continue;
+
+    // not drawn anymore since it was turned away
+    uint64_t in_flight = residency->context->constants.maxFramesInFlight;
+    if (entry->lastUsedFrame + in_flight < residency->logicalGpu->frameIndex) {
+      entry->wanted = false;
+      continue;
+    }
+
+    // what doesn't fit yet stays wanted, and gets another try next frame
+    if (FPX3D_SUCCESS == _make_resident(residency, entry))
+      entry->wanted = false;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+// called while recording a draw of the shape buffer
+void __fpx3d_vk_residency_touch(Fpx3d_Vk_Resident *entry,
+                                uint64_t frame_index) {
+  entry->lastUsedFrame = frame_index;
+
+  if (false == entry->resident)
+    entry->wanted = true;
+}
+
+// STATIC FUNCTIONS ----
+
+// takes ownership of `entry` (freeing it on failure), and uploads it if
+// there is room
+static Fpx3d_E_Result _add_entry(Fpx3d_Vk_Residency *residency,
+                                 Fpx3d_Vk_Resident *entry) {
+  if (residency->entryCount >= residency->entryCapacity) {
+    Fpx3d_E_Result retval = __fpx3d_realloc_array(
+        (void **)&residency->entries, sizeof(*residency->entries),
+        MAX(residency->entryCapacity * 2, (size_t)16),
+        &residency->entryCapacity);
+
+    if (FPX3D_SUCCESS != retval) {
+      _free_entry(residency, entry);
+      return retval;
+    }
+  }
+
+  entry->index = residency->entryCount;
+  residency->entries[residency->entryCount++] = entry;
+
+  entry->lastUsedFrame = residency->logicalGpu->frameIndex;
+
+  // no room is fine; it gets uploaded once it is used
+  _make_resident(residency, entry);
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _make_resident(Fpx3d_Vk_Residency *residency,
+                                     Fpx3d_Vk_Resident *entry) {
+  if (entry->resident)
+    return FPX3D_SUCCESS;
+
+  if (!_evict_until_fits(residency, entry->bytes, entry))
+    return FPX3D_MEMORY_ERROR;
+
+  Fpx3d_E_Result retval = _upload(residency, entry);
+  if (FPX3D_SUCCESS == retval)
+    return retval;
+
+  // the budget is only an estimate of what the device can take, so try
+  // once more after making as much room as possible
+  size_t evictions = residency->evictions;
+  _evict_until_fits(residency, SIZE_MAX - residency->residentBytes, entry);
+
+  if (evictions != residency->evictions)
+    retval = _upload(residency, entry);
+
+  return retval;
+}
+
+static Fpx3d_E_Result _upload(Fpx3d_Vk_Residency *residency,
+                              Fpx3d_Vk_Resident *entry) {
+  Fpx3d_Vk_LogicalGpu *lgpu = residency->logicalGpu;
+  VkMemoryRequirements reqs = {0};
+
+  size_t bytes = 0;
+
+  if (RESIDENT_MESH == entry->type) {
+    Fpx3d_E_Result retval =
+        fpx3d_vk_create_shapebuffer(residency->context, lgpu, &entry->vertices,
+                                    &entry->shapeBuffer);
+    if (FPX3D_SUCCESS != retval)
+      return retval;
+
+    vkGetBufferMemoryRequirements(
+        lgpu->handle, entry->shapeBuffer.vertexBuffer.buffer, &reqs);
+    bytes += reqs.size;
+
+    if (entry->shapeBuffer.indexBuffer.isValid) {
+      vkGetBufferMemoryRequirements(
+          lgpu->handle, entry->shapeBuffer.indexBuffer.buffer, &reqs);
+      bytes += reqs.size;
+    }
+  } else {
+    Fpx3d_Vk_Image image = fpx3d_vk_create_texture_image(
+        residency->context, lgpu, entry->dimensions);
+    if (false == image.isValid)
+      return FPX3D_VK_ERROR;
+
+    Fpx3d_E_Result retval =
+        fpx3d_vk_fill_image(&image, residency->context, lgpu, entry->pixels);
+
+    if (FPX3D_SUCCESS == retval)
+      retval = fpx3d_vk_image_readonly(&image, lgpu);
+
+    if (FPX3D_SUCCESS != retval) {
+      fpx3d_vk_destroy_image(&image, lgpu);
+      return retval;
+    }
+
+    entry->image = image;
+
+    vkGetImageMemoryRequirements(lgpu->handle, image.image, &reqs);
+    bytes = reqs.size;
+  }
+
+  entry->bytes = bytes;
+  entry->resident = true;
+
+  residency->residentBytes += bytes;
+  ++residency->uploads;
+
+  return FPX3D_SUCCESS;
+}
+
+static void _evict(Fpx3d_Vk_Residency *residency, Fpx3d_Vk_Resident *entry) {
+  _destroy_gpu_copy(residency, entry);
+  ++residency->evictions;
+}
+
+static void _destroy_gpu_copy(Fpx3d_Vk_Residency *residency,
+                              Fpx3d_Vk_Resident *entry) {
+  if (RESIDENT_MESH == entry->type) {
+    fpx3d_vk_destroy_shapebuffer(residency->logicalGpu, &entry->shapeBuffer);
+
+    // destroying zeroes it, but draws still have to find their way back
+    entry->shapeBuffer.residency = entry;
+  } else {
+    fpx3d_vk_destroy_image(&entry->image, residency->logicalGpu);
+  }
+
+  entry->resident = false;
+
+  residency->residentBytes -= MIN(residency->residentBytes, entry->bytes);
+}
+
+// evicts idle resources, least recently used first, until `needed` more
+// bytes fit in the budget. Returns whether they do
+static bool _evict_until_fits(Fpx3d_Vk_Residency *residency, size_t needed,
+                              const Fpx3d_Vk_Resident *keep) {
+  if (residency->residentBytes + needed <= residency->budgetBytes)
+    return true;
+
+  Fpx3d_Vk_Resident **candidates =
+      calloc(residency->entryCount + 1, sizeof(*candidates));
+  if (NULL == candidates) {
+    perror("calloc()");
+    return false;
+  }
+
+  size_t candidate_count = 0;
+
+  for (size_t i = 0; i < residency->entryCount; ++i) {
+    Fpx3d_Vk_Resident *entry = residency->entries[i];
+
+    if (keep != entry && _is_idle(residency, entry))
+      candidates[candidate_count++] = entry;
+  }
+
+  qsort(candidates, candidate_count, sizeof(*candidates), _compare_last_used);
+
+  for (size_t i = 0; i < candidate_count &&
+                     residency->residentBytes + needed > residency->budgetBytes;
+       ++i)
+    _evict(residency, candidates[i]);
+
+  FREE_SAFE(candidates);
+
+  return residency->residentBytes + needed <= residency->budgetBytes;
+}
+
+// resident, and not used by any frame the GPU might still be working on.
+// The fence of a frame is waited on before its slot gets recorded again,
+// so anything older than maxFramesInFlight submissions is done with
+static bool _is_idle(const Fpx3d_Vk_Residency *residency,
+                     const Fpx3d_Vk_Resident *entry) {
+  if (false == entry->resident)
+    return false;
+
+  uint64_t in_flight = residency->context->constants.maxFramesInFlight;
+
+  return entry->lastUsedFrame + in_flight < residency->logicalGpu->frameIndex;
+}
+
+static int _compare_last_used(const void *a, const void *b) {
+  const Fpx3d_Vk_Resident *ea = *(const Fpx3d_Vk_Resident *const *)a;
+  const Fpx3d_Vk_Resident *eb = *(const Fpx3d_Vk_Resident *const *)b;
+
+  return (ea->lastUsedFrame > eb->lastUsedFrame) -
+         (ea->lastUsedFrame < eb->lastUsedFrame);
+}
+
+static void _free_entry(Fpx3d_Vk_Residency *residency,
+                        Fpx3d_Vk_Resident *entry) {
+  if (entry->resident)
+    _destroy_gpu_copy(residency, entry);
+
+  fpx3d_vk_free_vertices(&entry->vertices);
+  FREE_SAFE(entry->pixels);
+  FREE_SAFE(entry);
+}
+
+// END OF STATIC FUNCTIONS ----
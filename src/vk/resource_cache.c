@@ -0,0 +1,479 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#include "vk/image.h"
+#include "vk/logical_gpu.h"
+#include "vk/resource_cache.h"
+#include "vk/shape.h"
+#include "vk/typedefs.h"
+#include "vk/upload.h"
+#include "vk/vertex.h"
+
+// power of two, so probing can mask instead of divide
+#define INITIAL_CAPACITY 64
+
+extern uint64_t __fpx3d_hash64(const void *data, size_t length,
+                               uint64_t seed);
+
+struct fpx3d_vk_cache_entry {
+  Fpx3d_Vk_CacheKey key;
+
+  enum {
+    ENTRY_EMPTY = 0,
+    ENTRY_SHAPEBUFFER = 1,
+    ENTRY_IMAGE = 2,
+  } type;
+
+  size_t refs;
+
+  union {
+    Fpx3d_Vk_ShapeBuffer shapeBuffer;
+    Fpx3d_Vk_Image image;
+  };
+};
+
+// static declarations ----
+
+static Fpx3d_E_Result _cache_shapebuffer(Fpx3d_Vk_ResourceCache *,
+                                         Fpx3d_Vk_UploadBatch *,
+                                         Fpx3d_Vk_CacheKey key,
+                                         Fpx3d_Vk_VertexBundle *,
+                                         Fpx3d_Vk_ShapeBuffer *output);
+static Fpx3d_E_Result _cache_texture_image(Fpx3d_Vk_ResourceCache *,
+                                           Fpx3d_Vk_UploadBatch *,
+                                           Fpx3d_Vk_CacheKey key,
+                                           Fpx3d_Vk_ImageDimensions,
+                                           const void *pixels,
+                                           Fpx3d_Vk_Image *output);
+
+static struct fpx3d_vk_cache_entry *_find(Fpx3d_Vk_ResourceCache *, int type,
+                                          Fpx3d_Vk_CacheKey key);
+static Fpx3d_E_Result _reserve(Fpx3d_Vk_ResourceCache *);
+static struct fpx3d_vk_cache_entry *_insert(Fpx3d_Vk_ResourceCache *,
+                                            int type, Fpx3d_Vk_CacheKey key);
+static Fpx3d_E_Result _grow(Fpx3d_Vk_ResourceCache *);
+static void _remove(Fpx3d_Vk_ResourceCache *, struct fpx3d_vk_cache_entry *);
+
+static void _destroy_entry(Fpx3d_Vk_ResourceCache *,
+                           struct fpx3d_vk_cache_entry *);
+
+// end of static declarations ----
+
+Fpx3d_E_Result fpx3d_vk_create_resource_cache(Fpx3d_Vk_Context *ctx,
+                                              Fpx3d_Vk_LogicalGpu *lgpu,
+                                              Fpx3d_Vk_ResourceCache *output) {
+  NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  Fpx3d_Vk_ResourceCache cache = {
+      .context = ctx,
+      .logicalGpu = lgpu,
+      .capacity = INITIAL_CAPACITY,
+  };
+
+  cache.entries = calloc(cache.capacity, sizeof(*cache.entries));
+  if (NULL == cache.entries) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  *output = cache;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_destroy_resource_cache(Fpx3d_Vk_ResourceCache *cache) {
+  NULL_CHECK(cache, FPX3D_ARGS_ERROR);
+
+  for (size_t i = 0; NULL != cache->entries && i < cache->capacity; ++i) {
+    struct fpx3d_vk_cache_entry *entry = &cache->entries[i];
+
+    if (ENTRY_EMPTY == entry->type)
+      continue;
+
+    if (0 < entry->refs) {
+      FPX3D_WARN("Destroying cached resource with %" LONG_FORMAT
+                 "u references left",
+                 entry->refs);
+    }
+
+    _destroy_entry(cache, entry);
+  }
+
+  FPX3D_DEBUG("Resource cache served %" LONG_FORMAT "u of %" LONG_FORMAT
+              "u requests without uploading",
+              cache->hits, cache->hits + cache->misses);
+
+  FREE_SAFE(cache->entries);
+
+  memset(cache, 0, sizeof(*cache));
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_Vk_CacheKey
+fpx3d_vk_cache_key_vertices(const Fpx3d_Vk_VertexBundle *bundle) {
+  Fpx3d_Vk_CacheKey key = {0};
+  NULL_CHECK(bundle, key);
+
+  // the layout goes in first, so the same bytes split up differently
+  // don't collide
+  uint64_t header[] = {bundle->vertexDataSize, bundle->vertexCount,
+                       bundle->indexCount};
+
+  size_t vertex_bytes = bundle->vertexCount * bundle->vertexDataSize;
+  size_t index_bytes = bundle->indexCount * sizeof(uint32_t);
+
+  key.hash = __fpx3d_hash64(header, sizeof(header), 0);
+  key.hash = __fpx3d_hash64(bundle->vertices, vertex_bytes, key.hash);
+  key.hash = __fpx3d_hash64(bundle->indices, index_bytes, key.hash);
+  key.size = vertex_bytes + index_bytes;
+
+  return key;
+}
+
+Fpx3d_Vk_CacheKey fpx3d_vk_cache_key_image(Fpx3d_Vk_ImageDimensions dims,
+                                           const void *pixels) {
+  Fpx3d_Vk_CacheKey key = {0};
+  NULL_CHECK(pixels, key);
+
+  uint64_t header[] = {dims.width, dims.height, dims.channels,
+                       dims.channelWidth};
+
+  size_t bytes = (size_t)dims.width * dims.height * dims.channels *
+                 dims.channelWidth;
+
+  key.hash = __fpx3d_hash64(header, sizeof(header), 0);
+  key.hash = __fpx3d_hash64(pixels, bytes, key.hash);
+  key.size = bytes;
+
+  return key;
+}
+
+Fpx3d_E_Result fpx3d_vk_cache_shapebuffer(Fpx3d_Vk_ResourceCache *cache,
+                                          Fpx3d_Vk_CacheKey key,
+                                          Fpx3d_Vk_VertexBundle *bundle,
+                                          Fpx3d_Vk_ShapeBuffer *output) {
+  return _cache_shapebuffer(cache, NULL, key, bundle, output);
+}
+
+Fpx3d_E_Result fpx3d_vk_cache_texture_image(Fpx3d_Vk_ResourceCache *cache,
+                                            Fpx3d_Vk_CacheKey key,
+                                            Fpx3d_Vk_ImageDimensions dims,
+                                            const void *pixels,
+                                            Fpx3d_Vk_Image *output) {
+  return _cache_texture_image(cache, NULL, key, dims, pixels, output);
+}
+
+Fpx3d_E_Result
+fpx3d_vk_cache_batch_shapebuffer(Fpx3d_Vk_ResourceCache *cache,
+                                 Fpx3d_Vk_UploadBatch *batch,
+                                 Fpx3d_Vk_CacheKey key,
+                                 Fpx3d_Vk_VertexBundle *bundle,
+                                 Fpx3d_Vk_ShapeBuffer *output) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+
+  return _cache_shapebuffer(cache, batch, key, bundle, output);
+}
+
+Fpx3d_E_Result fpx3d_vk_cache_batch_texture_image(
+    Fpx3d_Vk_ResourceCache *cache, Fpx3d_Vk_UploadBatch *batch,
+    Fpx3d_Vk_CacheKey key, Fpx3d_Vk_ImageDimensions dims, const void *pixels,
+    Fpx3d_Vk_Image *output) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+
+  return _cache_texture_image(cache, batch, key, dims, pixels, output);
+}
+
+Fpx3d_E_Result
+fpx3d_vk_cache_release_shapebuffer(Fpx3d_Vk_ResourceCache *cache,
+                                   Fpx3d_Vk_ShapeBuffer *shapebuffer) {
+  NULL_CHECK(cache, FPX3D_ARGS_ERROR);
+  NULL_CHECK(shapebuffer, FPX3D_ARGS_ERROR);
+
+  // copies are only recognizable by their Vulkan handles
+  for (size_t i = 0; NULL != cache->entries && i < cache->capacity; ++i) {
+    struct fpx3d_vk_cache_entry *entry = &cache->entries[i];
+
+    if (ENTRY_SHAPEBUFFER != entry->type ||
+        entry->shapeBuffer.vertexBuffer.buffer !=
+            shapebuffer->vertexBuffer.buffer)
+      continue;
+
+    if (0 == --entry->refs)
+      _remove(cache, entry);
+
+    memset(shapebuffer, 0, sizeof(*shapebuffer));
+
+    return FPX3D_SUCCESS;
+  }
+
+  return FPX3D_ARGS_ERROR;
+}
+
+Fpx3d_E_Result fpx3d_vk_cache_release_image(Fpx3d_Vk_ResourceCache *cache,
+                                            Fpx3d_Vk_Image *image) {
+  NULL_CHECK(cache, FPX3D_ARGS_ERROR);
+  NULL_CHECK(image, FPX3D_ARGS_ERROR);
+
+  for (size_t i = 0; NULL != cache->entries && i < cache->capacity; ++i) {
+    struct fpx3d_vk_cache_entry *entry = &cache->entries[i];
+
+    if (ENTRY_IMAGE != entry->type || entry->image.image != image->image)
+      continue;
+
+    if (0 == --entry->refs)
+      _remove(cache, entry);
+
+    memset(image, 0, sizeof(*image));
+
+    return FPX3D_SUCCESS;
+  }
+
+  return FPX3D_ARGS_ERROR;
+}
+
+// STATIC FUNCTIONS ----
+
+// without a batch, the upload is waited for
+static Fpx3d_E_Result _cache_shapebuffer(Fpx3d_Vk_ResourceCache *cache,
+                                         Fpx3d_Vk_UploadBatch *batch,
+                                         Fpx3d_Vk_CacheKey key,
+                                         Fpx3d_Vk_VertexBundle *bundle,
+                                         Fpx3d_Vk_ShapeBuffer *output) {
+  NULL_CHECK(cache, FPX3D_ARGS_ERROR);
+  NULL_CHECK(cache->entries, FPX3D_ARGS_ERROR);
+  NULL_CHECK(bundle, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_vk_cache_entry *entry = _find(cache, ENTRY_SHAPEBUFFER, key);
+
+  if (NULL != entry) {
+    ++cache->hits;
+    ++entry->refs;
+    *output = entry->shapeBuffer;
+    return FPX3D_SUCCESS;
+  }
+
+  // once the upload is recorded, there's no taking it back
+  FPX3D_ONFAIL(_reserve(cache), success, return success;);
+
+  Fpx3d_Vk_ShapeBuffer shapebuffer = {0};
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  if (NULL == batch)
+    retval = fpx3d_vk_create_shapebuffer(cache->context, cache->logicalGpu,
+                                         bundle, &shapebuffer);
+  else
+    retval = fpx3d_vk_batch_create_shapebuffer(batch, bundle, &shapebuffer);
+
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  entry = _insert(cache, ENTRY_SHAPEBUFFER, key);
+
+  ++cache->misses;
+
+  entry->shapeBuffer = shapebuffer;
+  entry->refs = 1;
+
+  *output = shapebuffer;
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _cache_texture_image(Fpx3d_Vk_ResourceCache *cache,
+                                           Fpx3d_Vk_UploadBatch *batch,
+                                           Fpx3d_Vk_CacheKey key,
+                                           Fpx3d_Vk_ImageDimensions dims,
+                                           const void *pixels,
+                                           Fpx3d_Vk_Image *output) {
+  NULL_CHECK(cache, FPX3D_ARGS_ERROR);
+  NULL_CHECK(cache->entries, FPX3D_ARGS_ERROR);
+  NULL_CHECK(pixels, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_vk_cache_entry *entry = _find(cache, ENTRY_IMAGE, key);
+
+  if (NULL != entry) {
+    ++cache->hits;
+    ++entry->refs;
+    *output = entry->image;
+    return FPX3D_SUCCESS;
+  }
+
+  FPX3D_ONFAIL(_reserve(cache), success, return success;);
+
+  Fpx3d_Vk_Image image =
+      fpx3d_vk_create_texture_image(cache->context, cache->logicalGpu, dims);
+  if (false == image.isValid)
+    return FPX3D_VK_ERROR;
+
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  if (NULL == batch) {
+    // only read from, despite the signature
+    retval = fpx3d_vk_fill_image(&image, cache->context, cache->logicalGpu,
+                                 (void *)pixels);
+
+    if (FPX3D_SUCCESS == retval)
+      retval = fpx3d_vk_image_readonly(&image, cache->logicalGpu);
+  } else {
+    retval = fpx3d_vk_batch_upload_image(
+        batch, &image, pixels, fpx3d_vk_get_image_size_bytes(&image), true);
+  }
+
+  if (FPX3D_SUCCESS != retval) {
+    fpx3d_vk_destroy_image(&image, cache->logicalGpu);
+    return retval;
+  }
+
+  entry = _insert(cache, ENTRY_IMAGE, key);
+
+  ++cache->misses;
+
+  entry->image = image;
+  entry->refs = 1;
+
+  *output = image;
+
+  return FPX3D_SUCCESS;
+}
+
+static struct fpx3d_vk_cache_entry *_find(Fpx3d_Vk_ResourceCache *cache,
+                                          int type, Fpx3d_Vk_CacheKey key) {
+  size_t mask = cache->capacity - 1;
+
+  for (size_t i = key.hash & mask; ENTRY_EMPTY != cache->entries[i].type;
+       i = (i + 1) & mask) {
+    struct fpx3d_vk_cache_entry *entry = &cache->entries[i];
+
+    if ((int)entry->type == type && entry->key.hash == key.hash &&
+        entry->key.size == key.size)
+      return entry;
+  }
+
+  return NULL;
+}
+
+// the returned slot has its key and type set, the rest is up to the caller.
+// Only NULL if there was no _reserve() for it
+static struct fpx3d_vk_cache_entry *_insert(Fpx3d_Vk_ResourceCache *cache,
+                                            int type, Fpx3d_Vk_CacheKey key) {
+  if (FPX3D_SUCCESS != _reserve(cache))
+    return NULL;
+
+  size_t mask = cache->capacity - 1;
+  size_t i = key.hash & mask;
+
+  while (ENTRY_EMPTY != cache->entries[i].type)
+    i = (i + 1) & mask;
+
+  struct fpx3d_vk_cache_entry *entry = &cache->entries[i];
+
+  memset(entry, 0, sizeof(*entry));
+  entry->key = key;
+  entry->type = type;
+
+  ++cache->count;
+
+  return entry;
+}
+
+// makes sure the next _insert() doesn't have to grow the table
+static Fpx3d_E_Result _reserve(Fpx3d_Vk_ResourceCache *cache) {
+  // keep the load factor under 3/4, or probe sequences get long
+  if ((cache->count + 1) * 4 > cache->capacity * 3)
+    return _grow(cache);
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _grow(Fpx3d_Vk_ResourceCache *cache) {
+  size_t new_capacity = cache->capacity * 2;
+
+  struct fpx3d_vk_cache_entry *entries =
+      calloc(new_capacity, sizeof(*entries));
+  if (NULL == entries) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  size_t mask = new_capacity - 1;
+
+  for (size_t i = 0; i < cache->capacity; ++i) {
+    if (ENTRY_EMPTY == cache->entries[i].type)
+      continue;
+
+    size_t j = cache->entries[i].key.hash & mask;
+    while (ENTRY_EMPTY != entries[j].type)
+      j = (j + 1) & mask;
+
+    entries[j] = cache->entries[i];
+  }
+
+  FREE_SAFE(cache->entries);
+
+  cache->entries = entries;
+  cache->capacity = new_capacity;
+
+  return FPX3D_SUCCESS;
+}
+
+// destroys the resource and closes the gap in the probe sequence by
+// shifting back later entries that would no longer be found
+static void _remove(Fpx3d_Vk_ResourceCache *cache,
+                    struct fpx3d_vk_cache_entry *entry) {
+  _destroy_entry(cache, entry);
+  --cache->count;
+
+  size_t mask = cache->capacity - 1;
+  size_t hole = (size_t)(entry - cache->entries);
+
+  for (size_t i = (hole + 1) & mask; ENTRY_EMPTY != cache->entries[i].type;
+       i = (i + 1) & mask) {
+    size_t home = cache->entries[i].key.hash & mask;
+
+    // distance from its home slot, versus the hole's distance from it
+    if (((i - home) & mask) < ((i - hole) & mask))
+      continue;
+
+    cache->entries[hole] = cache->entries[i];
+    memset(&cache->entries[i], 0, sizeof(cache->entries[i]));
+    hole = i;
+  }
+}
+
+static void _destroy_entry(Fpx3d_Vk_ResourceCache *cache,
+                           struct fpx3d_vk_cache_entry *entry) {
+  switch (entry->type) {
+  case ENTRY_SHAPEBUFFER:
+    fpx3d_vk_destroy_shapebuffer(cache->logicalGpu, &entry->shapeBuffer);
+    break;
+
+  case ENTRY_IMAGE:
+    fpx3d_vk_destroy_image(&entry->image, cache->logicalGpu);
+    break;
+
+  default:
+    break;
+  }
+
+  memset(entry, 0, sizeof(*entry));
+}
+
+// END OF STATIC FUNCTIONS ----
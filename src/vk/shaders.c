@@ -16,6 +16,14 @@
 
 #include "vk/shaders.h"
 
+#define SPIRV_MAGIC 0x07230203
+
+extern Fpx3d_E_Result __fpx3d_read_files(const char *const *paths,
+                                         size_t count, bool direct,
+                                         uint8_t **outputs,
+                                         size_t *output_sizes,
+                                         Fpx3d_E_Result *results);
+
 // static declarations --------------------------------------------
 static VkShaderModule _new_shader_module(Fpx3d_Vk_LogicalGpu *lgpu,
                                          Fpx3d_Vk_SpirvFile *spirv);
@@ -40,75 +48,72 @@ Fpx3d_Vk_SpirvFile fpx3d_vk_read_spirv_file(const char *filename,
                                             Fpx3d_Vk_E_ShaderStage stage) {
   Fpx3d_Vk_SpirvFile retval = {0};
 
-  FILE *fp = fopen(filename, "rb");
-  if (NULL == fp) {
-    perror("fopen()");
-    FPX3D_ERROR("Could not open file \"%s\". Does it exist in this location?",
-                filename);
-    return retval;
-  }
+  fpx3d_vk_read_spirv_files(&filename, &stage, 1, &retval);
 
-  if (0 > fseek(fp, 0, SEEK_END)) {
-    perror("fseek()");
-    fclose(fp);
-    return retval;
-  }
+  return retval;
+}
 
-  int size = ftell(fp);
-  if (0 > size) {
-    perror("ftell()");
-    fclose(fp);
-    return retval;
-  }
+Fpx3d_E_Result fpx3d_vk_read_spirv_files(const char *const *filenames,
+                                         const Fpx3d_Vk_E_ShaderStage *stages,
+                                         size_t count,
+                                         Fpx3d_Vk_SpirvFile *output) {
+  NULL_CHECK(filenames, FPX3D_ARGS_ERROR);
+  NULL_CHECK(stages, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
 
-  if (4 > size)
-    return retval;
+  if (1 > count)
+    return FPX3D_SUCCESS;
 
-  rewind(fp);
+  uint8_t **buffers = calloc(count, sizeof(uint8_t *));
+  size_t *sizes = calloc(count, sizeof(size_t));
+  Fpx3d_E_Result *results = calloc(count, sizeof(Fpx3d_E_Result));
 
-  uint32_t magic = 0;
-  fread(&magic, sizeof(uint32_t), 1, fp);
-  if (0x07230203 != magic) {
-    // bad file format (probably)
-    // also add more checking, bcs this isn't good enough lol
-    return retval;
+  if (NULL == buffers || NULL == sizes || NULL == results) {
+    perror("calloc()");
+    FREE_SAFE(buffers);
+    FREE_SAFE(sizes);
+    FREE_SAFE(results);
+    return FPX3D_MEMORY_ERROR;
   }
 
-  rewind(fp);
+  Fpx3d_E_Result retval = __fpx3d_read_files(filenames, count, false, buffers,
+                                             sizes, results);
 
-  // FPX3D_DEBUG("Found file \"%s\" (%d bytes)", filename, size);
+  for (size_t i = 0; i < count; ++i) {
+    memset(&output[i], 0, sizeof(output[i]));
 
-  // align to 4 bytes because the shader module reads it
-  // using a uint32_t pointer for some reason
-  uint8_t *temp_buffer = (uint8_t *)malloc(size + (4 - (size % 4)));
-  if (NULL == temp_buffer) {
-    perror("malloc()");
-    fclose(fp);
-    return retval;
-  }
+    if (FPX3D_SUCCESS != results[i]) {
+      FPX3D_ERROR("Could not open file \"%s\". Does it exist in this "
+                  "location?",
+                  filenames[i]);
+      continue;
+    }
 
-  size_t readcount = fread(temp_buffer, 1, size, fp);
-  if (size > (int)readcount) {
-    FPX3D_WARN(
-        "Read too little from SPIR-V file (expected %d; got %" LONG_FORMAT "u)",
-        size, readcount);
+    uint32_t magic = 0;
+    if (sizeof(magic) <= sizes[i])
+      memcpy(&magic, buffers[i], sizeof(magic));
 
-    int has_eof = feof(fp);
-    int has_err = ferror(fp);
+    if (SPIRV_MAGIC != magic) {
+      // bad file format (probably)
+      FPX3D_WARN("\"%s\" is not a SPIR-V file", filenames[i]);
+      FREE_SAFE(buffers[i]);
 
-    if (has_eof || has_err) {
-      FPX3D_WARN("File EOF? -> %d | File ERR? -> %d", has_eof, has_err);
+      if (FPX3D_SUCCESS == retval)
+        retval = FPX3D_ARGS_ERROR;
+
+      continue;
     }
 
-    FREE_SAFE(temp_buffer);
-    fclose(fp);
-    return retval;
+    // the read buffers are zero-padded past the end, so the shader module
+    // can read them through a uint32_t pointer as they are
+    output[i].buffer = buffers[i];
+    output[i].filesize = sizes[i];
+    output[i].stage = stages[i];
   }
 
-  fclose(fp);
-
-  retval = fpx3d_vk_read_spirv_data(temp_buffer, size, stage);
-  FREE_SAFE(temp_buffer);
+  FREE_SAFE(buffers);
+  FREE_SAFE(sizes);
+  FREE_SAFE(results);
 
   return retval;
 }
@@ -3,25 +3,85 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "debug.h"
 #include "fpx3d.h"
 #include "macros.h"
 #include "vk/buffer.h"
 #include "vk/context.h"
 #include "vk/descriptors.h"
 #include "vk/logical_gpu.h"
+#include "vk/upload.h"
 #include "vk/vertex.h"
 
 #include "vk/shape.h"
 
+#include "volk/volk.h"
+
 extern Fpx3d_Vk_Buffer
 __fpx3d_vk_new_buffer_with_data(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
                                 void *data, VkDeviceSize size,
                                 VkBufferUsageFlags usage_flags);
 extern void __fpx3d_vk_destroy_buffer_object(Fpx3d_Vk_LogicalGpu *,
                                              Fpx3d_Vk_Buffer *buffer);
+extern Fpx3d_E_Result __fpx3d_vk_new_buffer_from_file(
+    VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *, const char *path,
+    size_t file_offset, VkDeviceSize size, VkBufferUsageFlags usage_flags,
+    size_t window_size, Fpx3d_Vk_Buffer *output);
+extern Fpx3d_E_Result __fpx3d_vk_batch_new_buffer(Fpx3d_Vk_UploadBatch *,
+                                                  const void *data,
+                                                  VkDeviceSize size,
+                                                  VkBufferUsageFlags,
+                                                  Fpx3d_Vk_Buffer *output);
+extern Fpx3d_E_Result __fpx3d_vk_batch_overwrite_buffer(
+    Fpx3d_Vk_UploadBatch *, Fpx3d_Vk_Buffer *, VkDeviceSize dst_offset,
+    const void *data, VkDeviceSize size, uint64_t used_frame);
+extern void __fpx3d_vk_arena_release_shapebuffer(Fpx3d_Vk_ShapeBuffer *);
+extern Fpx3d_E_Result __fpx3d_vk_new_dynamic_buffer(VkPhysicalDevice,
+                                                    Fpx3d_Vk_LogicalGpu *,
+                                                    VkDeviceSize size,
+                                                    VkBufferUsageFlags usage,
+                                                    Fpx3d_Vk_Buffer *output);
+extern Fpx3d_E_Result __fpx3d_vk_write_buffer(Fpx3d_Vk_LogicalGpu *,
+                                              const Fpx3d_Vk_Buffer *,
+                                              VkDeviceSize offset,
+                                              const void *data,
+                                              VkDeviceSize size);
+
+// what has to be written into the slice of one frame in flight before it
+// is drawn again, in vertices and indices. `vertexCount` and `indexCount`
+// are what the slice held when it was last written
+struct fpx3d_vk_dynamic_slice {
+  size_t vertexCount;
+  size_t indexCount;
+
+  size_t dirtyStart, dirtyEnd;
+  size_t indexDirtyStart, indexDirtyEnd;
+};
+
+struct fpx3d_vk_dynamic_geometry {
+  const Fpx3d_Vk_VertexBundle *source;
+
+  size_t vertexCapacity;
+  size_t indexCapacity;
+
+  size_t sliceCount;
+  struct fpx3d_vk_dynamic_slice slices[];
+};
+
+void __fpx3d_vk_dynamic_draw_range(Fpx3d_Vk_LogicalGpu *,
+                                   const Fpx3d_Vk_ShapeBuffer *,
+                                   int32_t *vertex_offset,
+                                   uint32_t *vertex_count,
+                                   uint32_t *first_index,
+                                   uint32_t *index_count);
+extern void __fpx3d_vk_mark_descriptors_dirty(Fpx3d_Vk_DescriptorSet *sets,
+                                              size_t set_count, size_t offset,
+                                              size_t size);
 
 // static declarations ---------------------------------------
 static Fpx3d_Vk_Buffer _new_vertex_buffer(VkPhysicalDevice,
@@ -30,6 +90,12 @@ static Fpx3d_Vk_Buffer _new_vertex_buffer(VkPhysicalDevice,
 static Fpx3d_Vk_Buffer _new_index_buffer(VkPhysicalDevice,
                                          Fpx3d_Vk_LogicalGpu *,
                                          Fpx3d_Vk_VertexBundle *);
+
+static void _own_buffers(Fpx3d_Vk_ShapeBuffer *, Fpx3d_Vk_Buffer vertices,
+                         Fpx3d_Vk_Buffer indices);
+
+static Fpx3d_E_Result _write_slice(Fpx3d_Vk_LogicalGpu *,
+                                   const Fpx3d_Vk_ShapeBuffer *, size_t slice);
 // end of static declarations --------------------------------
 
 Fpx3d_E_Result fpx3d_vk_create_shapebuffer(Fpx3d_Vk_Context *vk_ctx,
@@ -65,23 +131,317 @@ Fpx3d_E_Result fpx3d_vk_create_shapebuffer(Fpx3d_Vk_Context *vk_ctx,
       __fpx3d_vk_destroy_buffer_object(lgpu, &ib);
       return -2;
     }
+  }
+
+  _own_buffers(shape_output, vb, ib);
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result
+fpx3d_vk_batch_create_shapebuffer(Fpx3d_Vk_UploadBatch *batch,
+                                  Fpx3d_Vk_VertexBundle *vertex_input,
+                                  Fpx3d_Vk_ShapeBuffer *shape_output) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(vertex_input, FPX3D_ARGS_ERROR);
+  NULL_CHECK(shape_output, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid)
+    return FPX3D_ARGS_ERROR;
+
+  if (1 > vertex_input->vertexCount || NULL == vertex_input->vertices)
+    return FPX3D_ARGS_ERROR;
+
+  Fpx3d_Vk_Buffer vb = {0};
+  Fpx3d_Vk_Buffer ib = {0};
+
+  FPX3D_ONFAIL(__fpx3d_vk_batch_new_buffer(
+                   batch, vertex_input->vertices,
+                   vertex_input->vertexCount * vertex_input->vertexDataSize,
+                   VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &vb),
+               success, return success;);
+
+  vb.objectCount = vertex_input->vertexCount;
+  vb.stride = vertex_input->vertexDataSize;
+
+  if (0 < vertex_input->indexCount) {
+    FPX3D_ONFAIL(__fpx3d_vk_batch_new_buffer(
+                     batch, vertex_input->indices,
+                     vertex_input->indexCount *
+                         sizeof(vertex_input->indices[0]),
+                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &ib),
+                 success,
+                 __fpx3d_vk_destroy_buffer_object(batch->logicalGpu, &vb);
+                 return success;);
+
+    ib.objectCount = vertex_input->indexCount;
+    ib.stride = sizeof(vertex_input->indices[0]);
+  }
+
+  _own_buffers(shape_output, vb, ib);
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result
+fpx3d_vk_create_shapebuffer_from_file(Fpx3d_Vk_Context *vk_ctx,
+                                      Fpx3d_Vk_LogicalGpu *lgpu,
+                                      const Fpx3d_Vk_ShapeFileLayout *layout,
+                                      Fpx3d_Vk_ShapeBuffer *shape_output) {
+  NULL_CHECK(vk_ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(layout, FPX3D_ARGS_ERROR);
+  NULL_CHECK(layout->path, FPX3D_ARGS_ERROR);
+  NULL_CHECK(shape_output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(vk_ctx->physicalGpu, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  if (1 > layout->vertexCount || 1 > layout->vertexDataSize)
+    return FPX3D_ARGS_ERROR;
+
+  Fpx3d_Vk_Buffer vb = {0};
+  Fpx3d_Vk_Buffer ib = {0};
+
+  Fpx3d_E_Result retval = __fpx3d_vk_new_buffer_from_file(
+      vk_ctx->physicalGpu, lgpu, layout->path, layout->vertexOffset,
+      layout->vertexCount * layout->vertexDataSize,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, layout->windowSize, &vb);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  vb.objectCount = layout->vertexCount;
+  vb.stride = layout->vertexDataSize;
+
+  if (0 < layout->indexCount) {
+    retval = __fpx3d_vk_new_buffer_from_file(
+        vk_ctx->physicalGpu, lgpu, layout->path, layout->indexOffset,
+        layout->indexCount * sizeof(uint32_t),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT, layout->windowSize, &ib);
+    if (FPX3D_SUCCESS != retval) {
+      __fpx3d_vk_destroy_buffer_object(lgpu, &vb);
+      return retval;
+    }
 
-    shape_output->indexBuffer = ib;
+    ib.objectCount = layout->indexCount;
+    ib.stride = sizeof(uint32_t);
   }
 
-  shape_output->vertexBuffer = vb;
+  _own_buffers(shape_output, vb, ib);
 
   return FPX3D_SUCCESS;
 }
 
+Fpx3d_E_Result fpx3d_vk_create_dynamic_shapebuffer(
+    Fpx3d_Vk_Context *vk_ctx, Fpx3d_Vk_LogicalGpu *lgpu,
+    const Fpx3d_Vk_VertexBundle *source, size_t max_vertices,
+    size_t max_indices, Fpx3d_Vk_ShapeBuffer *shape_output) {
+  NULL_CHECK(vk_ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(source, FPX3D_ARGS_ERROR);
+  NULL_CHECK(shape_output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(vk_ctx->physicalGpu, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  if (1 > max_vertices || 1 > source->vertexDataSize)
+    return FPX3D_ARGS_ERROR;
+
+  size_t frames = MAX(vk_ctx->constants.maxFramesInFlight, 1);
+
+  struct fpx3d_vk_dynamic_geometry *dynamic =
+      calloc(1, sizeof(*dynamic) + frames * sizeof(dynamic->slices[0]));
+  if (NULL == dynamic) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  dynamic->source = source;
+  dynamic->vertexCapacity = max_vertices;
+  dynamic->indexCapacity = max_indices;
+  dynamic->sliceCount = frames;
+
+  Fpx3d_Vk_ShapeBuffer new_shape = {0};
+  new_shape.dynamic = dynamic;
+
+  Fpx3d_E_Result retval = __fpx3d_vk_new_dynamic_buffer(
+      vk_ctx->physicalGpu, lgpu, frames * max_vertices * source->vertexDataSize,
+      VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, &new_shape.vertexBuffer);
+
+  if (FPX3D_SUCCESS == retval && 0 < max_indices)
+    retval = __fpx3d_vk_new_dynamic_buffer(
+        vk_ctx->physicalGpu, lgpu,
+        frames * max_indices * sizeof(source->indices[0]),
+        VK_BUFFER_USAGE_INDEX_BUFFER_BIT, &new_shape.indexBuffer);
+
+  if (FPX3D_SUCCESS != retval) {
+    fpx3d_vk_destroy_shapebuffer(lgpu, &new_shape);
+    return retval;
+  }
+
+  new_shape.vertexBuffer.objectCount = max_vertices;
+  new_shape.vertexBuffer.stride = source->vertexDataSize;
+
+  new_shape.indexBuffer.objectCount = max_indices;
+  new_shape.indexBuffer.stride = sizeof(source->indices[0]);
+
+  // every slice gets whatever the source holds by the time it's drawn
+  retval =
+      fpx3d_vk_update_shapebuffer(lgpu, &new_shape, 0, SIZE_MAX, 0, SIZE_MAX);
+
+  if (FPX3D_SUCCESS != retval) {
+    fpx3d_vk_destroy_shapebuffer(lgpu, &new_shape);
+    return retval;
+  }
+
+  *shape_output = new_shape;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_update_shapebuffer(Fpx3d_Vk_LogicalGpu *lgpu,
+                                           Fpx3d_Vk_ShapeBuffer *shape,
+                                           size_t first_vertex,
+                                           size_t vertex_count,
+                                           size_t first_index,
+                                           size_t index_count) {
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(shape, FPX3D_ARGS_ERROR);
+  NULL_CHECK(shape->dynamic, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_vk_dynamic_geometry *dynamic = shape->dynamic;
+
+  if (dynamic->source->vertexCount > dynamic->vertexCapacity ||
+      dynamic->source->indexCount > dynamic->indexCapacity)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  // a count of SIZE_MAX reaches to the end
+  size_t vertex_end =
+      first_vertex + MIN(vertex_count, (SIZE_MAX - first_vertex));
+  size_t index_end = first_index + MIN(index_count, (SIZE_MAX - first_index));
+
+  for (size_t i = 0; i < dynamic->sliceCount; ++i) {
+    struct fpx3d_vk_dynamic_slice *slice = &dynamic->slices[i];
+
+    if (first_vertex < vertex_end) {
+      if (slice->dirtyStart >= slice->dirtyEnd) {
+        slice->dirtyStart = first_vertex;
+        slice->dirtyEnd = vertex_end;
+      } else {
+        slice->dirtyStart = MIN(slice->dirtyStart, first_vertex);
+        slice->dirtyEnd = MAX(slice->dirtyEnd, vertex_end);
+      }
+    }
+
+    if (first_index < index_end) {
+      if (slice->indexDirtyStart >= slice->indexDirtyEnd) {
+        slice->indexDirtyStart = first_index;
+        slice->indexDirtyEnd = index_end;
+      } else {
+        slice->indexDirtyStart = MIN(slice->indexDirtyStart, first_index);
+        slice->indexDirtyEnd = MAX(slice->indexDirtyEnd, index_end);
+      }
+    }
+  }
+
+  size_t current = lgpu->frameCounter % dynamic->sliceCount;
+
+  // the frame that drew from this slice last has to be done with it. It's
+  // the same wait fpx3d_vk_draw_frame() starts with, so it costs nothing
+  if (NULL != lgpu->inFlightFences)
+    vkWaitForFences(lgpu->handle, 1, &lgpu->inFlightFences[current], VK_TRUE,
+                    UINT64_MAX);
+
+  return _write_slice(lgpu, shape, current);
+}
+
+Fpx3d_E_Result fpx3d_vk_batch_update_shapebuffer(
+    Fpx3d_Vk_UploadBatch *batch, Fpx3d_Vk_ShapeBuffer *shape,
+    size_t first_vertex, const void *vertices, size_t vertex_count,
+    size_t first_index, const uint32_t *indices, size_t index_count) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(shape, FPX3D_ARGS_ERROR);
+
+  if (NULL != shape->dynamic || false == shape->vertexBuffer.isValid)
+    return FPX3D_ARGS_ERROR;
+
+  if ((0 < vertex_count && NULL == vertices) ||
+      (0 < index_count && NULL == indices))
+    return FPX3D_ARGS_ERROR;
+
+  Fpx3d_Vk_Buffer *vb = &shape->vertexBuffer;
+  Fpx3d_Vk_Buffer *ib = &shape->indexBuffer;
+
+  if (first_vertex > vb->objectCount ||
+      vertex_count > vb->objectCount - first_vertex)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  if (0 < index_count && (false == ib->isValid ||
+                          first_index > ib->objectCount ||
+                          index_count > ib->objectCount - first_index))
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  // arena shape buffers start somewhere inside the arena's buffers. Only
+  // the frames that drew this shape buffer have to be done before the
+  // writes, not all of them
+  if (0 < vertex_count) {
+    FPX3D_ONFAIL(__fpx3d_vk_batch_overwrite_buffer(
+                     batch, vb,
+                     ((size_t)shape->vertexOffset + first_vertex) * vb->stride,
+                     vertices, vertex_count * vb->stride,
+                     shape->lastDrawnFrame),
+                 success, return success;);
+  }
+
+  if (0 < index_count) {
+    FPX3D_ONFAIL(__fpx3d_vk_batch_overwrite_buffer(
+                     batch, ib,
+                     ((size_t)shape->firstIndex + first_index) * ib->stride,
+                     indices, index_count * ib->stride, shape->lastDrawnFrame),
+                 success, return success;);
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+// called while recording; brings the slice of the current frame up to date
+// and gives the arguments to draw it with
+void __fpx3d_vk_dynamic_draw_range(Fpx3d_Vk_LogicalGpu *lgpu,
+                                   const Fpx3d_Vk_ShapeBuffer *shape,
+                                   int32_t *vertex_offset,
+                                   uint32_t *vertex_count,
+                                   uint32_t *first_index,
+                                   uint32_t *index_count) {
+  struct fpx3d_vk_dynamic_geometry *dynamic = shape->dynamic;
+
+  size_t current = lgpu->frameCounter % dynamic->sliceCount;
+
+  if (FPX3D_SUCCESS != _write_slice(lgpu, shape, current)) {
+    FPX3D_WARN("Could not write dynamic shape buffer");
+  }
+
+  *vertex_offset = (int32_t)(current * dynamic->vertexCapacity);
+  *vertex_count = (uint32_t)dynamic->slices[current].vertexCount;
+  *first_index = (uint32_t)(current * dynamic->indexCapacity);
+  *index_count = (uint32_t)dynamic->slices[current].indexCount;
+}
+
 Fpx3d_E_Result fpx3d_vk_destroy_shapebuffer(Fpx3d_Vk_LogicalGpu *lgpu,
                                             Fpx3d_Vk_ShapeBuffer *shape) {
   NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
   NULL_CHECK(shape, FPX3D_ARGS_ERROR);
 
+  // the buffers of an arena shape buffer belong to the arena
+  if (NULL != shape->arena) {
+    __fpx3d_vk_arena_release_shapebuffer(shape);
+    return FPX3D_SUCCESS;
+  }
+
   __fpx3d_vk_destroy_buffer_object(lgpu, &shape->vertexBuffer);
   __fpx3d_vk_destroy_buffer_object(lgpu, &shape->indexBuffer);
 
+  FREE_SAFE(shape->dynamic);
+
   memset(shape, 0, sizeof(*shape));
 
   return FPX3D_SUCCESS;
@@ -185,6 +545,12 @@ Fpx3d_Vk_Shape fpx3d_vk_duplicate_shape(Fpx3d_Vk_Shape *subject,
            subject->bindings.inFlightDescriptorSets->buffer.objectCount *
                subject->bindings.inFlightDescriptorSets->buffer.stride);
 
+    __fpx3d_vk_mark_descriptors_dirty(
+        retval.bindings.inFlightDescriptorSets,
+        ctx->constants.maxFramesInFlight, 0,
+        subject->bindings.inFlightDescriptorSets->buffer.objectCount *
+            subject->bindings.inFlightDescriptorSets->buffer.stride);
+
     FREE_SAFE(bindings);
   }
 
@@ -227,4 +593,71 @@ static Fpx3d_Vk_Buffer _new_index_buffer(VkPhysicalDevice dev,
 
   return new_buf;
 }
+
+// the shape buffer gets buffers of its own; `residency` is left alone, as
+// a Fpx3d_Vk_Residency sets it before making the buffers again
+static void _own_buffers(Fpx3d_Vk_ShapeBuffer *shape, Fpx3d_Vk_Buffer vertices,
+                         Fpx3d_Vk_Buffer indices) {
+  shape->vertexBuffer = vertices;
+  shape->indexBuffer = indices;
+
+  shape->arena = NULL;
+  shape->vertexChunk = NULL;
+  shape->indexChunk = NULL;
+  shape->vertexOffset = 0;
+  shape->firstIndex = 0;
+
+  shape->dynamic = NULL;
+
+  // nothing has drawn the new buffers yet
+  shape->lastDrawnFrame = 0;
+}
+
+// writes the dirty ranges of one slice from the source, as far as the
+// source goes
+static Fpx3d_E_Result _write_slice(Fpx3d_Vk_LogicalGpu *lgpu,
+                                   const Fpx3d_Vk_ShapeBuffer *shape,
+                                   size_t index) {
+  struct fpx3d_vk_dynamic_geometry *dynamic = shape->dynamic;
+  struct fpx3d_vk_dynamic_slice *slice = &dynamic->slices[index];
+  const Fpx3d_Vk_VertexBundle *source = dynamic->source;
+
+  size_t vertex_count = MIN(source->vertexCount, dynamic->vertexCapacity);
+  size_t index_count = MIN(source->indexCount, dynamic->indexCapacity);
+
+  size_t start = slice->dirtyStart;
+  size_t end = MIN(slice->dirtyEnd, vertex_count);
+
+  if (start < end) {
+    size_t stride = shape->vertexBuffer.stride;
+
+    FPX3D_ONFAIL(__fpx3d_vk_write_buffer(
+                     lgpu, &shape->vertexBuffer,
+                     (index * dynamic->vertexCapacity + start) * stride,
+                     (uint8_t *)source->vertices + start * stride,
+                     (end - start) * stride),
+                 success, return success;);
+  }
+
+  start = slice->indexDirtyStart;
+  end = MIN(slice->indexDirtyEnd, index_count);
+
+  if (start < end) {
+    size_t stride = shape->indexBuffer.stride;
+
+    FPX3D_ONFAIL(__fpx3d_vk_write_buffer(
+                     lgpu, &shape->indexBuffer,
+                     (index * dynamic->indexCapacity + start) * stride,
+                     &source->indices[start], (end - start) * stride),
+                 success, return success;);
+  }
+
+  slice->dirtyStart = slice->dirtyEnd = 0;
+  slice->indexDirtyStart = slice->indexDirtyEnd = 0;
+
+  slice->vertexCount = vertex_count;
+  slice->indexCount = index_count;
+
+  return FPX3D_SUCCESS;
+}
 // END OF STATIC FUNCTIONS ------------------------------------
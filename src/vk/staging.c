@@ -0,0 +1,557 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+// Staging memory for host-to-device uploads. Every logical GPU gets one
+// host-visible buffer, mapped for as long as it lives, which is handed out
+// front to back and wraps around at the end. One upload batch at a time
+// can reserve from it. Every upload submission gets a fence and a ticket;
+// once the fence signals, the staging memory the submission read from is
+// free again, and the ticket counts as done. A submission that has a part
+// for the transfer queue gets a semaphore as well, which the graphics
+// queue part waits on; the fence is only on the latter
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+#include "volk/volk.h"
+
+#include "vk/buffer.h"
+#include "vk/logical_gpu.h"
+#include "vk/typedefs.h"
+#include "vk/upload.h"
+
+// uploads bigger than the ring get a staging buffer of their own
+#define STAGING_RING_SIZE ((VkDeviceSize)16 * 1024 * 1024)
+
+// enough for bufferOffset of any copy into an image, compressed or not
+#define STAGING_ALIGNMENT ((VkDeviceSize)16)
+
+#define STAGING_MAX_IN_FLIGHT 32
+
+struct fpx3d_vk_staging_submission {
+  VkFence fence;
+  Fpx3d_Vk_UploadTicket ticket;
+
+  VkCommandBuffer commandBuffer;
+  VkCommandPool commandPool;
+
+  // the part that ran on the transfer queue, if any
+  VkCommandBuffer transferCommandBuffer;
+  VkCommandPool transferCommandPool;
+  VkSemaphore semaphore;
+
+  // staging buffers of its own, destroyed along with the command buffer
+  Fpx3d_Vk_Buffer *buffers;
+  size_t bufferCount;
+
+  // whether it read from the ring; if so, `end` is where the head of the
+  // ring was when it was submitted
+  bool usedRing;
+  VkDeviceSize end;
+};
+
+struct fpx3d_vk_staging_ring {
+  // not valid if the ring couldn't be made (yet); every upload gets a
+  // staging buffer of its own then. Making it is only tried once
+  Fpx3d_Vk_Buffer buffer;
+  VkDeviceSize size;
+  bool bufferTried;
+
+  // space is reserved at `head`; `tail` is where the oldest range the GPU
+  // may still read from begins
+  VkDeviceSize head;
+  VkDeviceSize tail;
+
+  // an upload batch has the ring; `claimHead` is the head it started at
+  bool claimed;
+  VkDeviceSize claimHead;
+
+  // something was reserved since the last submission
+  bool pending;
+
+  // oldest first, from `first` onward (wrapping)
+  struct fpx3d_vk_staging_submission inFlight[STAGING_MAX_IN_FLIGHT];
+  size_t first;
+  size_t inFlightCount;
+
+  // how many of the submissions in flight read from the ring
+  size_t ringInFlightCount;
+
+  VkFence spareFences[STAGING_MAX_IN_FLIGHT];
+  size_t spareFenceCount;
+
+  VkSemaphore spareSemaphores[STAGING_MAX_IN_FLIGHT];
+  size_t spareSemaphoreCount;
+
+  Fpx3d_Vk_UploadTicket lastSubmitted;
+  Fpx3d_Vk_UploadTicket lastCompleted;
+};
+
+extern Fpx3d_E_Result __fpx3d_vk_new_buffer(VkPhysicalDevice,
+                                            Fpx3d_Vk_LogicalGpu *,
+                                            VkDeviceSize size,
+                                            VkBufferUsageFlags usage,
+                                            VkMemoryPropertyFlags mem_flags,
+                                            VkSharingMode,
+                                            Fpx3d_Vk_Buffer *output_buffer);
+extern void __fpx3d_vk_destroy_buffer_object(Fpx3d_Vk_LogicalGpu *,
+                                             Fpx3d_Vk_Buffer *);
+
+// static declarations ----
+static struct fpx3d_vk_staging_ring *_get_ring(Fpx3d_Vk_LogicalGpu *);
+static void _create_ring_buffer(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *,
+                                struct fpx3d_vk_staging_ring *);
+static bool _ring_fit(struct fpx3d_vk_staging_ring *, VkDeviceSize size,
+                      VkDeviceSize alignment, VkDeviceSize *offset);
+static Fpx3d_E_Result _reclaim(Fpx3d_Vk_LogicalGpu *,
+                               struct fpx3d_vk_staging_ring *, bool wait);
+static void _release_submission(Fpx3d_Vk_LogicalGpu *,
+                                struct fpx3d_vk_staging_submission *);
+// end of static declarations ----
+
+// gives the staging ring of `lgpu` to the calling upload batch, making it
+// on first use. False if another batch has it, or it couldn't be made
+bool __fpx3d_vk_staging_claim(VkPhysicalDevice dev,
+                              Fpx3d_Vk_LogicalGpu *lgpu) {
+  NULL_CHECK(dev, false);
+  NULL_CHECK(lgpu, false);
+  NULL_CHECK(lgpu->handle, false);
+
+  struct fpx3d_vk_staging_ring *ring = _get_ring(lgpu);
+  NULL_CHECK(ring, false);
+
+  if (false == ring->bufferTried)
+    _create_ring_buffer(dev, lgpu, ring);
+
+  if (ring->claimed || false == ring->buffer.isValid)
+    return false;
+
+  ring->claimed = true;
+  ring->claimHead = ring->head;
+
+  return true;
+}
+
+// takes the staging ring back from a batch that won't be submitted,
+// along with everything it reserved
+void __fpx3d_vk_staging_unclaim(Fpx3d_Vk_LogicalGpu *lgpu) {
+  NULL_CHECK(lgpu, );
+  NULL_CHECK(lgpu->stagingRing, );
+
+  struct fpx3d_vk_staging_ring *ring = lgpu->stagingRing;
+
+  if (false == ring->claimed)
+    return;
+
+  ring->head = ring->claimHead;
+  ring->pending = false;
+  ring->claimed = false;
+}
+
+// reserves `size` bytes of the staging ring, which the caller has to have
+// claimed. If all of it is still being read by the GPU, this waits for
+// the oldest submission. FPX3D_NO_CAPACITY_ERROR means the upload is
+// bigger than the ring, or the ring is full of the caller's own ranges;
+// use a staging buffer of its own then
+Fpx3d_E_Result
+__fpx3d_vk_staging_reserve(Fpx3d_Vk_LogicalGpu *lgpu, VkDeviceSize size,
+                           VkDeviceSize alignment,
+                           struct fpx3d_vk_staging_region *output) {
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+  NULL_CHECK(lgpu->stagingRing, FPX3D_NULLPTR_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  if (0 == size)
+    return FPX3D_ARGS_ERROR;
+
+  struct fpx3d_vk_staging_ring *ring = lgpu->stagingRing;
+
+  if (false == ring->claimed)
+    return FPX3D_RESOURCE_BUSY_ERROR;
+
+  if (ring->size < size)
+    return FPX3D_NO_CAPACITY_ERROR;
+
+  // the least common multiple with STAGING_ALIGNMENT, a power of two
+  alignment = MAX(alignment, 1);
+  while (0 != alignment % STAGING_ALIGNMENT)
+    alignment *= 2;
+
+  for (;;) {
+    FPX3D_ONFAIL(_reclaim(lgpu, ring, false), success, return success;);
+
+    VkDeviceSize offset = 0;
+    if (_ring_fit(ring, size, alignment, &offset)) {
+      ring->head = offset + size;
+      ring->pending = true;
+
+      output->buffer = ring->buffer.buffer;
+      output->offset = offset;
+      output->mapped = (uint8_t *)ring->buffer.mapped_memory + offset;
+
+      return FPX3D_SUCCESS;
+    }
+
+    if (0 == ring->ringInFlightCount)
+      return FPX3D_NO_CAPACITY_ERROR;
+
+    FPX3D_ONFAIL(_reclaim(lgpu, ring, true), success, return success;);
+  }
+}
+
+// ends and submits the command buffers of `batch`: the transfer queue
+// part first, if there is one, then the graphics queue part, which waits
+// for it. If the batch had the staging ring, the claim ends, and its ring
+// ranges are freed once the GPU is done; so are the command buffers and the
+// staging buffers of its own. `output` gets the ticket of the submission.
+// If submitting fails, nothing is taken over
+Fpx3d_E_Result __fpx3d_vk_staging_submit(Fpx3d_Vk_UploadBatch *batch,
+                                         Fpx3d_Vk_UploadTicket *output) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(batch->commandBuffer, FPX3D_ARGS_ERROR);
+
+  Fpx3d_Vk_LogicalGpu *lgpu = batch->logicalGpu;
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  struct fpx3d_vk_staging_ring *ring = _get_ring(lgpu);
+  NULL_CHECK(ring, FPX3D_MEMORY_ERROR);
+
+  if (STAGING_MAX_IN_FLIGHT == ring->inFlightCount) {
+    FPX3D_ONFAIL(_reclaim(lgpu, ring, true), success, return success;);
+  }
+
+  bool has_transfer = (VK_NULL_HANDLE != batch->transferCommandBuffer);
+
+  VkFence fence = VK_NULL_HANDLE;
+  VkSemaphore semaphore = VK_NULL_HANDLE;
+
+  if (0 < ring->spareFenceCount) {
+    fence = ring->spareFences[--ring->spareFenceCount];
+  } else {
+    VkFenceCreateInfo f_info = {0};
+    f_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+    if (VK_SUCCESS != vkCreateFence(lgpu->handle, &f_info, NULL, &fence)) {
+      FPX3D_WARN("Could not create a fence for an upload submission");
+      return FPX3D_VK_ERROR;
+    }
+  }
+
+  if (has_transfer && 0 < ring->spareSemaphoreCount) {
+    semaphore = ring->spareSemaphores[--ring->spareSemaphoreCount];
+  } else if (has_transfer) {
+    VkSemaphoreCreateInfo s_info = {0};
+    s_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+    if (VK_SUCCESS !=
+        vkCreateSemaphore(lgpu->handle, &s_info, NULL, &semaphore)) {
+      FPX3D_WARN("Could not create a semaphore for an upload submission");
+      ring->spareFences[ring->spareFenceCount++] = fence;
+      return FPX3D_VK_ERROR;
+    }
+  }
+
+  if (has_transfer) {
+    vkEndCommandBuffer(batch->transferCommandBuffer);
+
+    VkSubmitInfo t_info = {0};
+    t_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    t_info.commandBufferCount = 1;
+    t_info.pCommandBuffers = &batch->transferCommandBuffer;
+    t_info.signalSemaphoreCount = 1;
+    t_info.pSignalSemaphores = &semaphore;
+
+    if (VK_SUCCESS !=
+        vkQueueSubmit(batch->transferQueue, 1, &t_info, VK_NULL_HANDLE)) {
+      FPX3D_ERROR("Transfer command buffer submission failed");
+
+      ring->spareFences[ring->spareFenceCount++] = fence;
+      ring->spareSemaphores[ring->spareSemaphoreCount++] = semaphore;
+
+      return FPX3D_VK_ERROR;
+    }
+  }
+
+  vkEndCommandBuffer(batch->commandBuffer);
+
+  // the ownership acquires at the start of the command buffer are what
+  // waits; they name every stage
+  VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+  VkSubmitInfo s_info = {0};
+  s_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  s_info.commandBufferCount = 1;
+  s_info.pCommandBuffers = &batch->commandBuffer;
+
+  if (has_transfer) {
+    s_info.waitSemaphoreCount = 1;
+    s_info.pWaitSemaphores = &semaphore;
+    s_info.pWaitDstStageMask = &wait_stage;
+  }
+
+  if (VK_SUCCESS != vkQueueSubmit(batch->queue, 1, &s_info, fence)) {
+    FPX3D_ERROR("Command buffer submission failed");
+
+    ring->spareFences[ring->spareFenceCount++] = fence;
+
+    if (has_transfer) {
+      // the semaphore gets signaled with nothing waiting on it, so it
+      // can't be used again
+      vkQueueWaitIdle(batch->transferQueue);
+      vkDestroySemaphore(lgpu->handle, semaphore, NULL);
+    }
+
+    return FPX3D_VK_ERROR;
+  }
+
+  size_t last = (ring->first + ring->inFlightCount) % STAGING_MAX_IN_FLIGHT;
+  struct fpx3d_vk_staging_submission *sub = &ring->inFlight[last];
+
+  sub->fence = fence;
+  sub->ticket = ++ring->lastSubmitted;
+  sub->commandBuffer = batch->commandBuffer;
+  sub->commandPool = batch->commandPool;
+  sub->transferCommandBuffer = batch->transferCommandBuffer;
+  sub->transferCommandPool = batch->transferCommandPool;
+  sub->semaphore = semaphore;
+  sub->buffers = batch->stagingBuffers;
+  sub->bufferCount = batch->stagingBufferCount;
+  sub->usedRing = batch->ownsStagingRing;
+  sub->end = ring->head;
+
+  ++ring->inFlightCount;
+
+  if (batch->ownsStagingRing) {
+    ++ring->ringInFlightCount;
+
+    ring->pending = false;
+    ring->claimed = false;
+  }
+
+  if (NULL != output)
+    *output = sub->ticket;
+
+  return FPX3D_SUCCESS;
+}
+
+// whether the submission of `ticket`, and every one before it, is done
+bool __fpx3d_vk_staging_done(Fpx3d_Vk_LogicalGpu *lgpu,
+                             Fpx3d_Vk_UploadTicket ticket) {
+  NULL_CHECK(lgpu, true);
+  NULL_CHECK(lgpu->stagingRing, true);
+
+  struct fpx3d_vk_staging_ring *ring = lgpu->stagingRing;
+
+  _reclaim(lgpu, ring, false);
+
+  return ring->lastCompleted >= ticket;
+}
+
+Fpx3d_E_Result __fpx3d_vk_staging_wait(Fpx3d_Vk_LogicalGpu *lgpu,
+                                       Fpx3d_Vk_UploadTicket ticket) {
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->stagingRing, FPX3D_SUCCESS);
+
+  struct fpx3d_vk_staging_ring *ring = lgpu->stagingRing;
+
+  if (ring->lastSubmitted < ticket)
+    return FPX3D_ARGS_ERROR;
+
+  while (ring->lastCompleted < ticket) {
+    FPX3D_ONFAIL(_reclaim(lgpu, ring, true), success, return success;);
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+// waits for every upload submission of `lgpu` and destroys the staging
+// ring
+void __fpx3d_vk_destroy_staging_ring(Fpx3d_Vk_LogicalGpu *lgpu) {
+  NULL_CHECK(lgpu, );
+  NULL_CHECK(lgpu->stagingRing, );
+
+  struct fpx3d_vk_staging_ring *ring = lgpu->stagingRing;
+
+  while (0 < ring->inFlightCount) {
+    if (FPX3D_SUCCESS != _reclaim(lgpu, ring, true))
+      break;
+  }
+
+  for (size_t i = 0; i < ring->inFlightCount; ++i) {
+    struct fpx3d_vk_staging_submission *sub =
+        &ring->inFlight[(ring->first + i) % STAGING_MAX_IN_FLIGHT];
+
+    _release_submission(lgpu, sub);
+    vkDestroyFence(lgpu->handle, sub->fence, NULL);
+
+    if (VK_NULL_HANDLE != sub->semaphore)
+      vkDestroySemaphore(lgpu->handle, sub->semaphore, NULL);
+  }
+
+  for (size_t i = 0; i < ring->spareFenceCount; ++i)
+    vkDestroyFence(lgpu->handle, ring->spareFences[i], NULL);
+
+  for (size_t i = 0; i < ring->spareSemaphoreCount; ++i)
+    vkDestroySemaphore(lgpu->handle, ring->spareSemaphores[i], NULL);
+
+  if (ring->buffer.isValid)
+    __fpx3d_vk_destroy_buffer_object(lgpu, &ring->buffer);
+
+  FREE_SAFE(lgpu->stagingRing);
+}
+
+// STATIC FUNCTIONS ----
+
+// the submission tracking of `lgpu`, made on first use without the ring
+// buffer itself
+static struct fpx3d_vk_staging_ring *_get_ring(Fpx3d_Vk_LogicalGpu *lgpu) {
+  if (NULL != lgpu->stagingRing)
+    return lgpu->stagingRing;
+
+  struct fpx3d_vk_staging_ring *ring = calloc(1, sizeof(*ring));
+  if (NULL == ring) {
+    perror("calloc()");
+    return NULL;
+  }
+
+  lgpu->stagingRing = ring;
+
+  return ring;
+}
+
+static void _create_ring_buffer(VkPhysicalDevice dev,
+                                Fpx3d_Vk_LogicalGpu *lgpu,
+                                struct fpx3d_vk_staging_ring *ring) {
+  ring->bufferTried = true;
+
+  // concurrent, so transfer queues of another family can read it too
+  Fpx3d_E_Result success = __fpx3d_vk_new_buffer(
+      dev, lgpu, STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+          VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+      VK_SHARING_MODE_CONCURRENT, &ring->buffer);
+
+  if (FPX3D_SUCCESS == success && NULL == ring->buffer.mapped_memory) {
+    __fpx3d_vk_destroy_buffer_object(lgpu, &ring->buffer);
+    success = FPX3D_VK_BAD_MEMORY_HANDLE_ERROR;
+  }
+
+  if (FPX3D_SUCCESS != success) {
+    // submissions are still tracked without the ring itself
+    FPX3D_WARN("Could not create the staging ring");
+    memset(&ring->buffer, 0, sizeof(ring->buffer));
+    return;
+  }
+
+  ring->size = STAGING_RING_SIZE;
+}
+
+// finds room for `size` bytes. When the free space is split in two by the
+// end of the ring, a range that doesn't fit before the end starts over at
+// offset 0, and the bytes it skipped are free again along with the rest
+static bool _ring_fit(struct fpx3d_vk_staging_ring *ring, VkDeviceSize size,
+                      VkDeviceSize alignment, VkDeviceSize *offset) {
+  bool empty = (0 == ring->ringInFlightCount && false == ring->pending);
+
+  if (empty) {
+    ring->head = 0;
+    ring->tail = 0;
+  }
+
+  VkDeviceSize start = (ring->head + alignment - 1) / alignment * alignment;
+
+  if (empty || ring->tail < ring->head) {
+    // free: from the head to the end, and from 0 to the tail
+    if (start <= ring->size && size <= ring->size - start) {
+      *offset = start;
+      return true;
+    }
+
+    if (size <= ring->tail) {
+      *offset = 0;
+      return true;
+    }
+
+    return false;
+  }
+
+  // free: from the head to the tail. Nothing at all if they're equal
+  if (ring->head < ring->tail && start <= ring->tail &&
+      size <= ring->tail - start) {
+    *offset = start;
+    return true;
+  }
+
+  return false;
+}
+
+// retires every submission the GPU is done with, oldest first. With
+// `wait`, the oldest one is waited for if it isn't done yet
+static Fpx3d_E_Result _reclaim(Fpx3d_Vk_LogicalGpu *lgpu,
+                               struct fpx3d_vk_staging_ring *ring,
+                               bool wait) {
+  while (0 < ring->inFlightCount) {
+    struct fpx3d_vk_staging_submission *sub = &ring->inFlight[ring->first];
+
+    if (wait) {
+      if (VK_SUCCESS != vkWaitForFences(lgpu->handle, 1, &sub->fence,
+                                        VK_TRUE, UINT64_MAX)) {
+        FPX3D_ERROR("Waiting for an upload submission failed");
+        return FPX3D_VK_ERROR;
+      }
+
+      wait = false;
+    } else if (VK_SUCCESS != vkGetFenceStatus(lgpu->handle, sub->fence)) {
+      break;
+    }
+
+    _release_submission(lgpu, sub);
+
+    vkResetFences(lgpu->handle, 1, &sub->fence);
+    ring->spareFences[ring->spareFenceCount++] = sub->fence;
+
+    // waited on by the graphics queue part, so unsignaled again
+    if (VK_NULL_HANDLE != sub->semaphore)
+      ring->spareSemaphores[ring->spareSemaphoreCount++] = sub->semaphore;
+
+    if (sub->usedRing) {
+      ring->tail = sub->end;
+      --ring->ringInFlightCount;
+    }
+
+    ring->lastCompleted = sub->ticket;
+
+    ring->first = (ring->first + 1) % STAGING_MAX_IN_FLIGHT;
+    --ring->inFlightCount;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+static void _release_submission(Fpx3d_Vk_LogicalGpu *lgpu,
+                                struct fpx3d_vk_staging_submission *sub) {
+  vkFreeCommandBuffers(lgpu->handle, sub->commandPool, 1,
+                       &sub->commandBuffer);
+
+  if (VK_NULL_HANDLE != sub->transferCommandBuffer)
+    vkFreeCommandBuffers(lgpu->handle, sub->transferCommandPool, 1,
+                         &sub->transferCommandBuffer);
+
+  for (size_t i = 0; i < sub->bufferCount; ++i)
+    __fpx3d_vk_destroy_buffer_object(lgpu, &sub->buffers[i]);
+
+  FREE_SAFE(sub->buffers);
+  sub->bufferCount = 0;
+}
+
+// END OF STATIC FUNCTIONS ----
@@ -0,0 +1,903 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#include "model/gltf.h"
+#include "model/mesh.h"
+#include "vk/gltf_textures.h"
+#include "vk/image.h"
+#include "vk/logical_gpu.h"
+#include "vk/resource_cache.h"
+#include "vk/shape.h"
+#include "vk/streaming.h"
+#include "vk/typedefs.h"
+#include "vk/upload.h"
+#include "vk/vertex.h"
+
+// same cap as __fpx3d_parallel_for() uses
+#define MAX_STREAM_WORKERS 64
+
+extern size_t __fpx3d_cpu_count(void);
+
+extern Fpx3d_E_Result __fpx3d_read_files(const char *const *paths,
+                                         size_t count, bool direct,
+                                         uint8_t **outputs,
+                                         size_t *output_sizes,
+                                         Fpx3d_E_Result *results);
+
+extern size_t
+__fpx3d_vk_gltf_used_images(const Fpx3d_Model_GltfAssetDescription *desc,
+                            size_t *output);
+extern Fpx3d_E_Result __fpx3d_vk_read_gltf_image_files(
+    const Fpx3d_Model_GltfAsset *asset, const char *base_directory,
+    const size_t *images, size_t count, uint8_t **files, size_t *file_sizes);
+extern Fpx3d_E_Result
+__fpx3d_vk_decode_gltf_image(const Fpx3d_Model_GltfAsset *asset,
+                             size_t image_index, const uint8_t *file,
+                             size_t file_size, uint8_t **pixels,
+                             uint32_t *width, uint32_t *height);
+extern void __fpx3d_vk_free_gltf_image(uint8_t *pixels);
+extern Fpx3d_E_Result __fpx3d_vk_batch_upload_gltf_image(
+    Fpx3d_Vk_UploadBatch *batch, Fpx3d_Vk_Context *ctx, const uint8_t *pixels,
+    uint32_t width, uint32_t height, Fpx3d_Vk_Image *output);
+extern Fpx3d_E_Result
+__fpx3d_vk_link_gltf_textures(const Fpx3d_Model_GltfAsset *asset,
+                              Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
+                              Fpx3d_Vk_GltfTextures *textures);
+
+// who may touch a handle (and which list it is in)
+enum {
+  OWNER_JOBS = 0,    // waiting for a worker
+  OWNER_WORKER = 1,  // being read, parsed and decoded
+  OWNER_UPLOADS = 2, // waiting for the upload stage
+  OWNER_USER = 3,    // finished
+};
+
+struct fpx3d_vk_stream_upload {
+  enum {
+    UPLOAD_MESH = 0,
+    UPLOAD_IMAGE = 1,
+  } type;
+
+  // into the asset's meshes or images
+  size_t index;
+  size_t bytes;
+
+  Fpx3d_Vk_VertexBundle vertices;
+
+  uint8_t *pixels;
+  uint32_t width;
+  uint32_t height;
+
+  // only computed when the streamer has a cache
+  Fpx3d_Vk_CacheKey key;
+};
+
+struct fpx3d_vk_stream_shared {
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  bool stop;
+
+  // both lists are FIFO, linked through the handles
+  Fpx3d_Vk_StreamHandle *jobs;
+  Fpx3d_Vk_StreamHandle *jobsTail;
+
+  Fpx3d_Vk_StreamHandle *uploads;
+  Fpx3d_Vk_StreamHandle *uploadsTail;
+
+  Fpx3d_Vk_LogicalGpu *logicalGpu;
+  Fpx3d_Vk_ResourceCache *cache;
+
+  pthread_t threads[MAX_STREAM_WORKERS];
+  size_t threadCount;
+};
+
+// static declarations ----
+
+static void *_worker_loop(void *shared_ptr);
+
+static Fpx3d_E_Result _read_and_decode(Fpx3d_Vk_StreamHandle *,
+                                       const struct fpx3d_vk_stream_shared *);
+static Fpx3d_E_Result _decode_meshes(Fpx3d_Vk_StreamHandle *);
+static Fpx3d_E_Result _decode_images(Fpx3d_Vk_StreamHandle *,
+                                     const char *base_directory);
+
+static void _record_uploads(Fpx3d_Vk_Streamer *);
+static void _finish_uploaded(Fpx3d_Vk_Streamer *);
+static Fpx3d_E_Result _upload(Fpx3d_Vk_Streamer *, Fpx3d_Vk_UploadBatch *,
+                              Fpx3d_Vk_StreamHandle *,
+                              struct fpx3d_vk_stream_upload *);
+static bool _budget_left(const Fpx3d_Vk_Streamer *, size_t bytes,
+                         uint64_t start_us);
+static uint64_t _now_us(void);
+
+static void _push(Fpx3d_Vk_StreamHandle **head, Fpx3d_Vk_StreamHandle **tail,
+                  Fpx3d_Vk_StreamHandle *);
+static void _unlink(Fpx3d_Vk_StreamHandle **head,
+                    Fpx3d_Vk_StreamHandle **tail, Fpx3d_Vk_StreamHandle *);
+
+static void _destroy_handle(Fpx3d_Vk_StreamHandle *,
+                            struct fpx3d_vk_stream_shared *);
+
+// end of static declarations ----
+
+Fpx3d_E_Result fpx3d_vk_create_streamer(Fpx3d_Vk_Context *ctx,
+                                        Fpx3d_Vk_LogicalGpu *lgpu,
+                                        const Fpx3d_Vk_StreamerConfig *config,
+                                        Fpx3d_Vk_Streamer *output) {
+  NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(config, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  struct fpx3d_vk_stream_shared *shared = calloc(1, sizeof(*shared));
+  if (NULL == shared) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  pthread_mutex_init(&shared->lock, NULL);
+  pthread_cond_init(&shared->wake, NULL);
+  shared->logicalGpu = lgpu;
+  shared->cache = config->cache;
+
+  size_t worker_count = config->workerCount;
+  if (1 > worker_count)
+    worker_count = __fpx3d_cpu_count();
+
+  worker_count = MIN(worker_count, (size_t)MAX_STREAM_WORKERS);
+
+  for (size_t i = 0; i < worker_count; ++i) {
+    if (0 != pthread_create(&shared->threads[shared->threadCount], NULL,
+                            _worker_loop, shared))
+      break;
+
+    ++shared->threadCount;
+  }
+
+  if (1 > shared->threadCount) {
+    FPX3D_ERROR("Could not spawn any streaming worker threads");
+
+    pthread_cond_destroy(&shared->wake);
+    pthread_mutex_destroy(&shared->lock);
+    FREE_SAFE(shared);
+
+    return FPX3D_GENERIC_ERROR;
+  }
+
+  FPX3D_DEBUG("Started %" LONG_FORMAT "u streaming workers",
+              shared->threadCount);
+
+  output->config = *config;
+  output->context = ctx;
+  output->logicalGpu = lgpu;
+  output->shared = shared;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_destroy_streamer(Fpx3d_Vk_Streamer *streamer) {
+  NULL_CHECK(streamer, FPX3D_ARGS_ERROR);
+  NULL_CHECK(streamer->shared, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_vk_stream_shared *shared = streamer->shared;
+
+  pthread_mutex_lock(&shared->lock);
+  shared->stop = true;
+  pthread_cond_broadcast(&shared->wake);
+  pthread_mutex_unlock(&shared->lock);
+
+  // workers finish the asset they are on before they notice
+  for (size_t i = 0; i < shared->threadCount; ++i)
+    pthread_join(shared->threads[i], NULL);
+
+  Fpx3d_Vk_StreamHandle *lists[] = {shared->jobs, shared->uploads};
+
+  for (size_t i = 0; i < ARRAY_SIZE(lists); ++i) {
+    Fpx3d_Vk_StreamHandle *handle = lists[i];
+
+    while (NULL != handle) {
+      Fpx3d_Vk_StreamHandle *next = handle->next;
+      _destroy_handle(handle, shared);
+      handle = next;
+    }
+  }
+
+  pthread_cond_destroy(&shared->wake);
+  pthread_mutex_destroy(&shared->lock);
+  FREE_SAFE(streamer->shared);
+
+  memset(streamer, 0, sizeof(*streamer));
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_stream_gltf(Fpx3d_Vk_Streamer *streamer,
+                                    const char *path,
+                                    Fpx3d_Vk_StreamCallback callback,
+                                    void *user_data,
+                                    Fpx3d_Vk_StreamHandle **output) {
+  NULL_CHECK(streamer, FPX3D_ARGS_ERROR);
+  NULL_CHECK(streamer->shared, FPX3D_ARGS_ERROR);
+  NULL_CHECK(path, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  Fpx3d_Vk_StreamHandle *handle = calloc(1, sizeof(*handle));
+  if (NULL == handle) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  handle->path = strdup(path);
+  if (NULL == handle->path) {
+    perror("strdup()");
+    FREE_SAFE(handle);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  handle->callback = callback;
+  handle->userData = user_data;
+  handle->owner = OWNER_JOBS;
+
+  atomic_init(&handle->abandoned, false);
+  atomic_init(&handle->state, FPX3D_VK_STREAM_QUEUED);
+  atomic_init(&handle->stepsDone, 0);
+  atomic_init(&handle->stepsTotal, 0);
+
+  struct fpx3d_vk_stream_shared *shared = streamer->shared;
+
+  pthread_mutex_lock(&shared->lock);
+  _push(&shared->jobs, &shared->jobsTail, handle);
+  pthread_cond_signal(&shared->wake);
+  pthread_mutex_unlock(&shared->lock);
+
+  *output = handle;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_streamer_update(Fpx3d_Vk_Streamer *streamer) {
+  NULL_CHECK(streamer, FPX3D_ARGS_ERROR);
+  NULL_CHECK(streamer->shared, FPX3D_ARGS_ERROR);
+
+  _record_uploads(streamer);
+  _finish_uploaded(streamer);
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_Vk_E_StreamState fpx3d_vk_stream_state(const Fpx3d_Vk_StreamHandle *h) {
+  NULL_CHECK(h, FPX3D_VK_STREAM_FAILED);
+
+  return (Fpx3d_Vk_E_StreamState)atomic_load(&h->state);
+}
+
+float fpx3d_vk_stream_progress(const Fpx3d_Vk_StreamHandle *handle) {
+  NULL_CHECK(handle, 0.0f);
+
+  // where each state starts, roughly by how long it takes
+  static const float state_start[] = {
+      [FPX3D_VK_STREAM_QUEUED] = 0.0f,    [FPX3D_VK_STREAM_READING] = 0.0f,
+      [FPX3D_VK_STREAM_PARSING] = 0.1f,   [FPX3D_VK_STREAM_DECODING] = 0.2f,
+      [FPX3D_VK_STREAM_UPLOADING] = 0.6f, [FPX3D_VK_STREAM_READY] = 1.0f,
+  };
+
+  int state = atomic_load(&handle->state);
+
+  if (FPX3D_VK_STREAM_READY <= state)
+    return 1.0f;
+
+  float progress = state_start[state];
+
+  size_t total = atomic_load(&handle->stepsTotal);
+  size_t done = atomic_load(&handle->stepsDone);
+
+  if (0 < total && done <= total)
+    progress += (state_start[state + 1] - state_start[state]) * (float)done /
+                (float)total;
+
+  return progress;
+}
+
+Fpx3d_E_Result fpx3d_vk_stream_release(Fpx3d_Vk_Streamer *streamer,
+                                       Fpx3d_Vk_StreamHandle *handle) {
+  NULL_CHECK(streamer, FPX3D_ARGS_ERROR);
+  NULL_CHECK(streamer->shared, FPX3D_ARGS_ERROR);
+  NULL_CHECK(handle, FPX3D_ARGS_ERROR);
+
+  struct fpx3d_vk_stream_shared *shared = streamer->shared;
+
+  pthread_mutex_lock(&shared->lock);
+
+  switch (handle->owner) {
+  case OWNER_JOBS:
+    _unlink(&shared->jobs, &shared->jobsTail, handle);
+    break;
+
+  case OWNER_WORKER:
+    // the worker drops it once it is done with it
+    atomic_store(&handle->abandoned, true);
+    pthread_mutex_unlock(&shared->lock);
+    return FPX3D_SUCCESS;
+
+  case OWNER_UPLOADS:
+    _unlink(&shared->uploads, &shared->uploadsTail, handle);
+    break;
+
+  default:
+    break;
+  }
+
+  pthread_mutex_unlock(&shared->lock);
+
+  _destroy_handle(handle, shared);
+
+  return FPX3D_SUCCESS;
+}
+
+// STATIC FUNCTIONS ----
+
+static void *_worker_loop(void *shared_ptr) {
+  struct fpx3d_vk_stream_shared *shared =
+      (struct fpx3d_vk_stream_shared *)shared_ptr;
+
+  pthread_mutex_lock(&shared->lock);
+
+  while (true) {
+    while (!shared->stop && NULL == shared->jobs)
+      pthread_cond_wait(&shared->wake, &shared->lock);
+
+    if (shared->stop)
+      break;
+
+    Fpx3d_Vk_StreamHandle *handle = shared->jobs;
+    _unlink(&shared->jobs, &shared->jobsTail, handle);
+    handle->owner = OWNER_WORKER;
+
+    pthread_mutex_unlock(&shared->lock);
+
+    // failures still go to the upload stage, which reports them
+    handle->result = _read_and_decode(handle, shared);
+
+    pthread_mutex_lock(&shared->lock);
+
+    if (atomic_load(&handle->abandoned)) {
+      // nothing of it lives on the GPU yet
+      pthread_mutex_unlock(&shared->lock);
+      _destroy_handle(handle, shared);
+      pthread_mutex_lock(&shared->lock);
+      continue;
+    }
+
+    if (FPX3D_SUCCESS == handle->result) {
+      atomic_store(&handle->stepsDone, 0);
+      atomic_store(&handle->stepsTotal, handle->uploadCount);
+      atomic_store(&handle->state, FPX3D_VK_STREAM_UPLOADING);
+    }
+
+    handle->owner = OWNER_UPLOADS;
+    _push(&shared->uploads, &shared->uploadsTail, handle);
+  }
+
+  pthread_mutex_unlock(&shared->lock);
+
+  return NULL;
+}
+
+static Fpx3d_E_Result
+_read_and_decode(Fpx3d_Vk_StreamHandle *handle,
+                 const struct fpx3d_vk_stream_shared *shared) {
+  atomic_store(&handle->state, FPX3D_VK_STREAM_READING);
+
+  uint8_t *data = NULL;
+  size_t length = 0;
+
+  // the file is only read once, straight into the parser, so it doesn't
+  // have to push anything else out of the page cache
+  Fpx3d_E_Result retval = __fpx3d_read_files(
+      (const char *const *)&handle->path, 1, true, &data, &length, NULL);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  atomic_store(&handle->state, FPX3D_VK_STREAM_PARSING);
+
+  // the asset keeps its own copy of the binary chunk
+  retval = fpx3d_model_read_gltf(data, length, &handle->asset);
+  FREE_SAFE(data);
+
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(&handle->asset);
+  NULL_CHECK(desc, FPX3D_MODEL_INVALID_FILE_ERROR);
+
+  handle->shapeBufferCount = desc->meshCount;
+  handle->shapeBuffers =
+      calloc(desc->meshCount + 1, sizeof(Fpx3d_Vk_ShapeBuffer));
+  handle->vertexBindings =
+      calloc(desc->meshCount + 1, sizeof(Fpx3d_Vk_VertexBinding));
+
+  handle->textures.imageCount = desc->imageCount;
+  handle->textures.images =
+      calloc(desc->imageCount + 1, sizeof(Fpx3d_Vk_Image));
+
+  handle->uploads = calloc(desc->meshCount + desc->imageCount + 1,
+                           sizeof(struct fpx3d_vk_stream_upload));
+
+  if (NULL == handle->shapeBuffers || NULL == handle->vertexBindings ||
+      NULL == handle->textures.images || NULL == handle->uploads)
+    return FPX3D_MEMORY_ERROR;
+
+  atomic_store(&handle->stepsTotal, desc->meshCount + desc->imageCount);
+  atomic_store(&handle->state, FPX3D_VK_STREAM_DECODING);
+
+  retval = _decode_meshes(handle);
+  if (FPX3D_SUCCESS != retval)
+    return retval;
+
+  // image URIs are relative to the file they come from
+  const char *slash = strrchr(handle->path, '/');
+#if defined(_WIN32) || defined(_WIN64)
+  const char *backslash = strrchr(handle->path, '\\');
+  if (NULL == slash || (NULL != backslash && backslash > slash))
+    slash = backslash;
+#endif
+
+  char *base_directory = NULL;
+
+  if (NULL != slash) {
+    size_t base_length = (size_t)(slash - handle->path);
+
+    base_directory = malloc(base_length + 1);
+    if (NULL == base_directory)
+      return FPX3D_MEMORY_ERROR;
+
+    memcpy(base_directory, handle->path, base_length);
+    base_directory[base_length] = '\0';
+  }
+
+  retval = _decode_images(handle, base_directory);
+  FREE_SAFE(base_directory);
+
+  if (FPX3D_SUCCESS != retval || NULL == shared->cache)
+    return retval;
+
+  // hashing here keeps it off the rendering thread
+  for (size_t i = 0; i < handle->uploadCount; ++i) {
+    struct fpx3d_vk_stream_upload *upload = &handle->uploads[i];
+
+    if (UPLOAD_MESH == upload->type) {
+      upload->key = fpx3d_vk_cache_key_vertices(&upload->vertices);
+    } else {
+      Fpx3d_Vk_ImageDimensions dims = {.width = upload->width,
+                                       .height = upload->height,
+                                       .channels = 4,
+                                       .channelWidth = 1};
+
+      upload->key = fpx3d_vk_cache_key_image(dims, upload->pixels);
+    }
+  }
+
+  return retval;
+}
+
+static Fpx3d_E_Result _decode_meshes(Fpx3d_Vk_StreamHandle *handle) {
+  Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(&handle->asset);
+
+  for (size_t i = 0; i < desc->meshCount; ++i) {
+    if (atomic_load(&handle->abandoned))
+      return FPX3D_GENERIC_ERROR;
+
+    atomic_fetch_add(&handle->stepsDone, 1);
+
+    Fpx3d_Model_Mesh mesh = {0};
+
+    Fpx3d_E_Result res =
+        fpx3d_model_mesh_from_gltf(&handle->asset, &desc->meshes[i],
+                                   FPX3D_MODEL_LAYOUT_INTERLEAVED, &mesh);
+    if (FPX3D_MEMORY_ERROR == res)
+      return res;
+
+    if (FPX3D_SUCCESS != res) {
+      FPX3D_WARN("Skipping glTF mesh %" LONG_FORMAT "u of \"%s\"", i,
+                 handle->path);
+      continue;
+    }
+
+    struct fpx3d_vk_stream_upload *upload =
+        &handle->uploads[handle->uploadCount];
+
+    res = fpx3d_vk_vertices_from_mesh(&upload->vertices, &mesh,
+                                      &handle->vertexBindings[i]);
+
+    // the vertices are still usable, just not describable
+    if (FPX3D_ARGS_ERROR == res)
+      res = fpx3d_vk_vertices_from_mesh(&upload->vertices, &mesh, NULL);
+
+    fpx3d_model_destroy_mesh(&mesh);
+
+    if (FPX3D_SUCCESS != res)
+      return res;
+
+    upload->type = UPLOAD_MESH;
+    upload->index = i;
+    upload->bytes = upload->vertices.vertexCount *
+                        upload->vertices.vertexDataSize +
+                    upload->vertices.indexCount * sizeof(uint32_t);
+
+    ++handle->uploadCount;
+  }
+
+  return FPX3D_SUCCESS;
+}
+
+static Fpx3d_E_Result _decode_images(Fpx3d_Vk_StreamHandle *handle,
+                                     const char *base_directory) {
+  Fpx3d_Model_GltfAssetDescription *desc =
+      fpx3d_model_gltf_description(&handle->asset);
+
+  size_t *used_images = calloc(desc->imageCount + 1, sizeof(size_t));
+  uint8_t **files = calloc(desc->imageCount + 1, sizeof(uint8_t *));
+  size_t *file_sizes = calloc(desc->imageCount + 1, sizeof(size_t));
+
+  Fpx3d_E_Result retval = FPX3D_MEMORY_ERROR;
+  size_t used_count = 0;
+
+  if (NULL == used_images || NULL == files || NULL == file_sizes)
+    goto decode_images_cleanup;
+
+  used_count = __fpx3d_vk_gltf_used_images(desc, used_images);
+
+  // unused images count as decoded straight away
+  atomic_fetch_add(&handle->stepsDone, desc->imageCount - used_count);
+
+  // images in files of their own are all read in one go
+  retval = __fpx3d_vk_read_gltf_image_files(
+      &handle->asset, base_directory, used_images, used_count, files,
+      file_sizes);
+  if (FPX3D_SUCCESS != retval)
+    goto decode_images_cleanup;
+
+  for (size_t u = 0; u < used_count; ++u) {
+    if (atomic_load(&handle->abandoned))
+      break;
+
+    atomic_fetch_add(&handle->stepsDone, 1);
+
+    struct fpx3d_vk_stream_upload *upload =
+        &handle->uploads[handle->uploadCount];
+
+    Fpx3d_E_Result res = __fpx3d_vk_decode_gltf_image(
+        &handle->asset, used_images[u], files[u], file_sizes[u],
+        &upload->pixels, &upload->width, &upload->height);
+
+    FREE_SAFE(files[u]);
+
+    // undecodable images are skipped, like fpx3d_vk_import_gltf_textures()
+    if (FPX3D_SUCCESS != res)
+      continue;
+
+    upload->type = UPLOAD_IMAGE;
+    upload->index = used_images[u];
+    upload->bytes = (size_t)upload->width * upload->height * 4;
+
+    ++handle->uploadCount;
+  }
+
+decode_images_cleanup:
+  for (size_t u = 0; NULL != files && u < used_count; ++u)
+    FREE_SAFE(files[u]);
+
+  FREE_SAFE(used_images);
+  FREE_SAFE(files);
+  FREE_SAFE(file_sizes);
+
+  return retval;
+}
+
+// records as much as the budget allows into one upload batch, oldest
+// handles first, and submits it. Nothing waits for it here
+static void _record_uploads(Fpx3d_Vk_Streamer *streamer) {
+  struct fpx3d_vk_stream_shared *shared = streamer->shared;
+
+  uint64_t start = _now_us();
+  size_t bytes = 0;
+  bool uploaded_any = false;
+  bool out_of_budget = false;
+
+  Fpx3d_Vk_UploadBatch batch = {0};
+  Fpx3d_E_Result batch_res = FPX3D_GENERIC_ERROR;
+
+  pthread_mutex_lock(&shared->lock);
+  Fpx3d_Vk_StreamHandle *handle = shared->uploads;
+  pthread_mutex_unlock(&shared->lock);
+
+  while (NULL != handle && false == out_of_budget) {
+    while (FPX3D_SUCCESS == handle->result &&
+           handle->uploadsDone < handle->uploadCount) {
+      if (uploaded_any && !_budget_left(streamer, bytes, start)) {
+        out_of_budget = true;
+        break;
+      }
+
+      if (false == uploaded_any) {
+        batch_res = fpx3d_vk_begin_upload_batch(
+            streamer->context, streamer->logicalGpu, &batch);
+
+        if (FPX3D_SUCCESS != batch_res) {
+          handle->result = batch_res;
+          break;
+        }
+      }
+
+      struct fpx3d_vk_stream_upload *upload =
+          &handle->uploads[handle->uploadsDone];
+
+      handle->result = _upload(streamer, &batch, handle, upload);
+      handle->inBatch = true;
+
+      bytes += upload->bytes;
+      uploaded_any = true;
+
+      ++handle->uploadsDone;
+      atomic_fetch_add(&handle->stepsDone, 1);
+    }
+
+    // workers only ever append, under the lock
+    pthread_mutex_lock(&shared->lock);
+    handle = handle->next;
+    pthread_mutex_unlock(&shared->lock);
+  }
+
+  if (false == uploaded_any)
+    return;
+
+  Fpx3d_Vk_UploadTicket ticket = 0;
+  batch_res = fpx3d_vk_submit_upload_batch(&batch, &ticket);
+
+  if (FPX3D_SUCCESS != batch_res) {
+    FPX3D_WARN("Could not submit streamed uploads (%d)", batch_res);
+  }
+
+  // only this thread takes handles off the list
+  pthread_mutex_lock(&shared->lock);
+  handle = shared->uploads;
+  pthread_mutex_unlock(&shared->lock);
+
+  while (NULL != handle) {
+    if (handle->inBatch) {
+      handle->inBatch = false;
+      handle->ticket = ticket;
+
+      if (FPX3D_SUCCESS == handle->result)
+        handle->result = batch_res;
+    }
+
+    pthread_mutex_lock(&shared->lock);
+    handle = handle->next;
+    pthread_mutex_unlock(&shared->lock);
+  }
+}
+
+// hands over the handles with nothing left to upload, once the GPU is done
+// with their uploads
+static void _finish_uploaded(Fpx3d_Vk_Streamer *streamer) {
+  struct fpx3d_vk_stream_shared *shared = streamer->shared;
+
+  pthread_mutex_lock(&shared->lock);
+  Fpx3d_Vk_StreamHandle *handle = shared->uploads;
+  pthread_mutex_unlock(&shared->lock);
+
+  while (NULL != handle) {
+    bool recorded = (FPX3D_SUCCESS != handle->result ||
+                     handle->uploadsDone >= handle->uploadCount);
+
+    if (false == recorded ||
+        false == fpx3d_vk_upload_done(streamer->logicalGpu, handle->ticket)) {
+      pthread_mutex_lock(&shared->lock);
+      handle = handle->next;
+      pthread_mutex_unlock(&shared->lock);
+      continue;
+    }
+
+    if (FPX3D_SUCCESS == handle->result)
+      handle->result = __fpx3d_vk_link_gltf_textures(
+          &handle->asset, streamer->context, streamer->logicalGpu,
+          &handle->textures);
+
+    pthread_mutex_lock(&shared->lock);
+    _unlink(&shared->uploads, &shared->uploadsTail, handle);
+    handle->owner = OWNER_USER;
+    pthread_mutex_unlock(&shared->lock);
+
+    if (FPX3D_SUCCESS == handle->result) {
+      atomic_store(&handle->state, FPX3D_VK_STREAM_READY);
+    } else {
+      FPX3D_WARN("Failed to stream \"%s\" (%d)", handle->path,
+                 handle->result);
+      atomic_store(&handle->state, FPX3D_VK_STREAM_FAILED);
+    }
+
+    if (NULL != handle->callback)
+      handle->callback(handle, handle->userData);
+
+    // the callback may have released any handle, so start over
+    pthread_mutex_lock(&shared->lock);
+    handle = shared->uploads;
+    pthread_mutex_unlock(&shared->lock);
+  }
+}
+
+// the CPU-side data is freed as soon as it is recorded, as the batch keeps
+// a copy of its own
+static Fpx3d_E_Result _upload(Fpx3d_Vk_Streamer *streamer,
+                              Fpx3d_Vk_UploadBatch *batch,
+                              Fpx3d_Vk_StreamHandle *handle,
+                              struct fpx3d_vk_stream_upload *upload) {
+  Fpx3d_Vk_ResourceCache *cache = streamer->shared->cache;
+  Fpx3d_E_Result retval = FPX3D_SUCCESS;
+
+  switch (upload->type) {
+  case UPLOAD_MESH:
+    if (NULL != cache)
+      retval = fpx3d_vk_cache_batch_shapebuffer(
+          cache, batch, upload->key, &upload->vertices,
+          &handle->shapeBuffers[upload->index]);
+    else
+      retval = fpx3d_vk_batch_create_shapebuffer(
+          batch, &upload->vertices, &handle->shapeBuffers[upload->index]);
+
+    fpx3d_vk_free_vertices(&upload->vertices);
+    break;
+
+  case UPLOAD_IMAGE:
+    if (NULL != cache) {
+      Fpx3d_Vk_ImageDimensions dims = {.width = upload->width,
+                                       .height = upload->height,
+                                       .channels = 4,
+                                       .channelWidth = 1};
+
+      retval = fpx3d_vk_cache_batch_texture_image(
+          cache, batch, upload->key, dims, upload->pixels,
+          &handle->textures.images[upload->index]);
+    } else {
+      retval = __fpx3d_vk_batch_upload_gltf_image(
+          batch, streamer->context, upload->pixels, upload->width,
+          upload->height, &handle->textures.images[upload->index]);
+    }
+
+    __fpx3d_vk_free_gltf_image(upload->pixels);
+    upload->pixels = NULL;
+    break;
+  }
+
+  return retval;
+}
+
+static bool _budget_left(const Fpx3d_Vk_Streamer *streamer, size_t bytes,
+                         uint64_t start_us) {
+  const Fpx3d_Vk_StreamerConfig *config = &streamer->config;
+
+  if (0 < config->uploadBytesPerFrame && config->uploadBytesPerFrame <= bytes)
+    return false;
+
+  if (0 < config->uploadMicrosecondsPerFrame &&
+      config->uploadMicrosecondsPerFrame <= _now_us() - start_us)
+    return false;
+
+  return true;
+}
+
+static uint64_t _now_us(void) {
+  struct timespec now = {0};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
+
+static void _push(Fpx3d_Vk_StreamHandle **head, Fpx3d_Vk_StreamHandle **tail,
+                  Fpx3d_Vk_StreamHandle *handle) {
+  handle->next = NULL;
+
+  if (NULL == *tail)
+    *head = handle;
+  else
+    (*tail)->next = handle;
+
+  *tail = handle;
+}
+
+static void _unlink(Fpx3d_Vk_StreamHandle **head,
+                    Fpx3d_Vk_StreamHandle **tail,
+                    Fpx3d_Vk_StreamHandle *handle) {
+  Fpx3d_Vk_StreamHandle *prev = NULL;
+  Fpx3d_Vk_StreamHandle *cur = *head;
+
+  while (NULL != cur && handle != cur) {
+    prev = cur;
+    cur = cur->next;
+  }
+
+  if (NULL == cur)
+    return;
+
+  if (NULL == prev)
+    *head = cur->next;
+  else
+    prev->next = cur->next;
+
+  if (*tail == cur)
+    *tail = prev;
+
+  cur->next = NULL;
+}
+
+static void _destroy_handle(Fpx3d_Vk_StreamHandle *handle,
+                            struct fpx3d_vk_stream_shared *shared) {
+  Fpx3d_Vk_LogicalGpu *lgpu = shared->logicalGpu;
+
+  // its uploads may still be writing into what's destroyed below. Handles
+  // dropped by a worker never got that far
+  if (0 < handle->ticket)
+    fpx3d_vk_wait_upload(lgpu, handle->ticket);
+
+  for (size_t i = handle->uploadsDone;
+       NULL != handle->uploads && i < handle->uploadCount; ++i) {
+    fpx3d_vk_free_vertices(&handle->uploads[i].vertices);
+    __fpx3d_vk_free_gltf_image(handle->uploads[i].pixels);
+  }
+
+  for (size_t i = 0; NULL != handle->shapeBuffers &&
+                     i < handle->shapeBufferCount;
+       ++i) {
+    Fpx3d_Vk_ShapeBuffer *shapebuffer = &handle->shapeBuffers[i];
+
+    if (shapebuffer->vertexBuffer.isValid) {
+      if (NULL != shared->cache)
+        fpx3d_vk_cache_release_shapebuffer(shared->cache, shapebuffer);
+      else
+        fpx3d_vk_destroy_shapebuffer(lgpu, shapebuffer);
+    }
+
+    if (NULL != handle->vertexBindings)
+      FREE_SAFE(handle->vertexBindings[i].attributes);
+  }
+
+  // cached images are zeroed on release, so only samplers remain
+  Fpx3d_Vk_Image *images = handle->textures.images;
+
+  for (size_t i = 0; NULL != shared->cache && NULL != images &&
+                     i < handle->textures.imageCount;
+       ++i) {
+    if (images[i].isValid)
+      fpx3d_vk_cache_release_image(shared->cache, &images[i]);
+  }
+
+  fpx3d_vk_destroy_gltf_textures(&handle->textures, lgpu);
+  fpx3d_model_destroy_gltf(&handle->asset);
+
+  FREE_SAFE(handle->uploads);
+  FREE_SAFE(handle->shapeBuffers);
+  FREE_SAFE(handle->vertexBindings);
+  FREE_SAFE(handle->path);
+  FREE_SAFE(handle);
+}
+
+// END OF STATIC FUNCTIONS ----
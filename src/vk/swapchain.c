@@ -84,7 +84,15 @@ fpx3d_vk_create_swapchain_properties(Fpx3d_Vk_Context *ctx,
   Fpx3d_Vk_SwapchainProperties props = {0};
 
   const char *ext = VK_KHR_SWAPCHAIN_EXTENSION_NAME;
-  bool are_supported = fpx3d_vk_device_extensions_supported(dev, &ext, 1);
+  bool are_supported = false;
+
+  // `dev` may be a GPU that is still being scored
+  const Fpx3d_Vk_Capabilities *caps = fpx3d_vk_get_capabilities(ctx);
+
+  if (NULL != caps && dev == caps->device)
+    are_supported = fpx3d_vk_capabilities_have_extensions(caps, &ext, 1);
+  else
+    are_supported = fpx3d_vk_device_extensions_supported(dev, &ext, 1);
 
   if (false == are_supported)
     return props;
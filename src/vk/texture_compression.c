@@ -0,0 +1,843 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+// CPU encoders for the BC1, BC3, BC5 and BC7 block formats.
+// Block layouts follow the "BC1, BC2 and BC3", "BC4 and BC5" and "BC7"
+// sections of the Khronos Data Format Specification. BC7 is always
+// encoded in mode 6 (one RGBA subset, 4-bit indices)
+
+#include <float.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+
+#include "vk/texture_compression.h"
+#include "vk/typedefs.h"
+
+#define BLOCK_DIMENSION 4
+#define BLOCK_PIXELS (BLOCK_DIMENSION * BLOCK_DIMENSION)
+
+#define CACHE_MAGIC 0x43425846 // "FXBC"
+// bump whenever an encoder starts producing different blocks
+#define CACHE_VERSION 1
+
+// rounds of power iteration when looking for the principal axis of a block
+#define AXIS_ITERATIONS 8
+
+extern Fpx3d_E_Result __fpx3d_parallel_for(size_t count, size_t thread_count,
+                                           void (*function)(void *, size_t),
+                                           void *context);
+
+extern uint64_t __fpx3d_hash64(const void *data, size_t length,
+                               uint64_t seed);
+
+// the pixels of one block, channel by channel, with values from 0 to 255
+struct _block {
+  float c[4][BLOCK_PIXELS];
+};
+
+// cache files are this, followed by the blocks. Everything but the hash
+// also goes into the hash, so the file name changes with the settings
+struct _cache_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t format;
+  uint32_t quality;
+  uint32_t width;
+  uint32_t height;
+  uint64_t hash;
+};
+
+struct _compress_job {
+  const uint8_t *rgba;
+  uint32_t width;
+  uint32_t height;
+
+  Fpx3d_Vk_E_BlockFormat format;
+  uint32_t quality;
+
+  size_t blocksPerRow;
+  size_t blockSize;
+
+  uint8_t *output;
+};
+
+// static declarations ----
+
+static size_t _block_size(Fpx3d_Vk_E_BlockFormat);
+
+static void _compress_row(void *job_ptr, size_t row);
+
+static void _load_block(const struct _compress_job *, size_t block_x,
+                        size_t block_y, struct _block *output);
+
+static float _fit_indices(const struct _block *, size_t first_channel,
+                          size_t channels, const float *palette,
+                          size_t palette_size, uint8_t *indices);
+
+static void _endpoints(const struct _block *, size_t channels, float *e0,
+                       float *e1);
+static bool _refit(const struct _block *, size_t channels,
+                   const uint8_t *indices, const float *weights, float *e0,
+                   float *e1);
+
+static uint16_t _pack_565(const float *color);
+static void _unpack_565(uint16_t packed, float *color);
+
+static void _quantize_bc7(const float *endpoint, uint8_t *output,
+                          uint8_t *p_bit);
+
+static void _encode_bc1(const struct _block *, uint8_t *output);
+static void _encode_bc4(const struct _block *, size_t channel,
+                        uint8_t *output);
+static void _encode_bc7(const struct _block *, uint32_t quality,
+                        uint8_t *output);
+
+static void _put_bits(uint8_t *output, size_t *position, uint32_t value,
+                      size_t count);
+
+static char *_cache_path(const char *directory, uint64_t hash);
+static bool _cache_load(const char *path, const struct _cache_header *,
+                        Fpx3d_Vk_CompressedImage *output);
+static void _cache_store(const char *path, const struct _cache_header *,
+                         const Fpx3d_Vk_CompressedImage *);
+
+// end of static declarations ----
+
+size_t fpx3d_vk_compressed_size(Fpx3d_Vk_E_BlockFormat format, uint32_t width,
+                                uint32_t height) {
+  size_t blocks_x = ((size_t)width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+  size_t blocks_y = ((size_t)height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+
+  return blocks_x * blocks_y * _block_size(format);
+}
+
+Fpx3d_E_Result fpx3d_vk_compress_image(const uint8_t *rgba, uint32_t width,
+                                       uint32_t height,
+                                       const Fpx3d_Vk_CompressionConfig *config,
+                                       Fpx3d_Vk_CompressedImage *output) {
+  NULL_CHECK(rgba, FPX3D_ARGS_ERROR);
+  NULL_CHECK(config, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  if (1 > width || 1 > height)
+    return FPX3D_ARGS_ERROR;
+
+  size_t size = fpx3d_vk_compressed_size(config->format, width, height);
+  if (1 > size)
+    return FPX3D_ARGS_ERROR;
+
+  // only BC7 has anything to tune, so the others don't get cached twice
+  uint32_t quality = 0;
+  if (FPX3D_VK_BLOCK_BC7 == config->format)
+    quality = MIN(config->quality, (uint32_t)FPX3D_VK_BC7_MAX_QUALITY);
+
+  Fpx3d_Vk_CompressedImage result = {.format = config->format,
+                                     .width = width,
+                                     .height = height,
+                                     .size = size};
+
+  char *path = NULL;
+  struct _cache_header header = {0};
+
+  if (NULL != config->cacheDirectory) {
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.format = (uint32_t)config->format;
+    header.quality = quality;
+    header.width = width;
+    header.height = height;
+
+    header.hash = __fpx3d_hash64(rgba, (size_t)width * height * 4,
+                                 __fpx3d_hash64(&header, sizeof(header), 0));
+
+    path = _cache_path(config->cacheDirectory, header.hash);
+    if (NULL == path)
+      return FPX3D_MEMORY_ERROR;
+
+    if (_cache_load(path, &header, &result)) {
+      FPX3D_DEBUG("Loaded compressed %ux%u image from %s", width, height,
+                  path);
+
+      FREE_SAFE(path);
+
+      *output = result;
+      return FPX3D_SUCCESS;
+    }
+  }
+
+  result.blocks = (uint8_t *)malloc(size);
+  if (NULL == result.blocks) {
+    perror("malloc()");
+    FREE_SAFE(path);
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  struct _compress_job job = {
+      .rgba = rgba,
+      .width = width,
+      .height = height,
+      .format = config->format,
+      .quality = quality,
+      .blocksPerRow = ((size_t)width + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION,
+      .blockSize = _block_size(config->format),
+      .output = result.blocks,
+  };
+
+  size_t rows = ((size_t)height + BLOCK_DIMENSION - 1) / BLOCK_DIMENSION;
+
+  Fpx3d_E_Result retval =
+      __fpx3d_parallel_for(rows, config->threadCount, _compress_row, &job);
+  if (FPX3D_SUCCESS != retval) {
+    FREE_SAFE(result.blocks);
+    FREE_SAFE(path);
+    return retval;
+  }
+
+  if (NULL != path)
+    _cache_store(path, &header, &result);
+
+  FREE_SAFE(path);
+
+  *output = result;
+
+  return FPX3D_SUCCESS;
+}
+
+void fpx3d_vk_destroy_compressed_image(Fpx3d_Vk_CompressedImage *image) {
+  if (NULL == image)
+    return;
+
+  FREE_SAFE(image->blocks);
+
+  memset(image, 0, sizeof(*image));
+}
+
+// STATIC FUNCTIONS ----
+
+static size_t _block_size(Fpx3d_Vk_E_BlockFormat format) {
+  switch (format) {
+  case FPX3D_VK_BLOCK_BC1:
+    return 8;
+
+  case FPX3D_VK_BLOCK_BC3:
+  case FPX3D_VK_BLOCK_BC5:
+  case FPX3D_VK_BLOCK_BC7:
+    return 16;
+
+  default:
+    return 0;
+  }
+}
+
+static void _compress_row(void *job_ptr, size_t row) {
+  struct _compress_job *job = (struct _compress_job *)job_ptr;
+
+  uint8_t *output = job->output + row * job->blocksPerRow * job->blockSize;
+
+  for (size_t x = 0; x < job->blocksPerRow; ++x) {
+    struct _block block;
+    _load_block(job, x, row, &block);
+
+    switch (job->format) {
+    case FPX3D_VK_BLOCK_BC1:
+      _encode_bc1(&block, output);
+      break;
+
+    case FPX3D_VK_BLOCK_BC3:
+      _encode_bc4(&block, 3, output);
+      _encode_bc1(&block, output + 8);
+      break;
+
+    case FPX3D_VK_BLOCK_BC5:
+      _encode_bc4(&block, 0, output);
+      _encode_bc4(&block, 1, output + 8);
+      break;
+
+    case FPX3D_VK_BLOCK_BC7:
+      _encode_bc7(&block, job->quality, output);
+      break;
+
+    default:
+      break;
+    }
+
+    output += job->blockSize;
+  }
+}
+
+static void _load_block(const struct _compress_job *job, size_t block_x,
+                        size_t block_y, struct _block *output) {
+  for (size_t y = 0; y < BLOCK_DIMENSION; ++y) {
+    size_t py = block_y * BLOCK_DIMENSION + y;
+    if (py >= job->height)
+      py = job->height - 1;
+
+    for (size_t x = 0; x < BLOCK_DIMENSION; ++x) {
+      size_t px = block_x * BLOCK_DIMENSION + x;
+      if (px >= job->width)
+        px = job->width - 1;
+
+      const uint8_t *pixel = job->rgba + (py * job->width + px) * 4;
+
+      for (size_t c = 0; c < 4; ++c)
+        output->c[c][y * BLOCK_DIMENSION + x] = (float)pixel[c];
+    }
+  }
+}
+
+// picks the closest of `palette_size` colors (4 floats each) for every pixel,
+// comparing `channels` channels from `first_channel` on. Returns the summed
+// squared error
+static float _fit_indices(const struct _block *block, size_t first_channel,
+                          size_t channels, const float *palette,
+                          size_t palette_size, uint8_t *indices) {
+  const float(*pixels)[BLOCK_PIXELS] = &block->c[first_channel];
+  float error = 0.0f;
+
+  size_t p = 0;
+
+#ifdef __SSE2__
+  for (; p + 4 <= BLOCK_PIXELS; p += 4) {
+    __m128 best = _mm_set1_ps(FLT_MAX);
+    __m128i best_index = _mm_setzero_si128();
+
+    for (size_t e = 0; e < palette_size; ++e) {
+      __m128 distance = _mm_setzero_ps();
+
+      for (size_t c = 0; c < channels; ++c) {
+        __m128 d = _mm_sub_ps(_mm_loadu_ps(&pixels[c][p]),
+                              _mm_set1_ps(palette[e * 4 + c]));
+        distance = _mm_add_ps(distance, _mm_mul_ps(d, d));
+      }
+
+      __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+
+      best = _mm_min_ps(distance, best);
+      best_index =
+          _mm_or_si128(_mm_and_si128(closer, _mm_set1_epi32((int32_t)e)),
+                       _mm_andnot_si128(closer, best_index));
+    }
+
+    int32_t closest[4];
+    float distances[4];
+    _mm_storeu_si128((__m128i *)closest, best_index);
+    _mm_storeu_ps(distances, best);
+
+    for (size_t k = 0; k < 4; ++k) {
+      indices[p + k] = (uint8_t)closest[k];
+      error += distances[k];
+    }
+  }
+#endif // __SSE2__
+
+  for (; p < BLOCK_PIXELS; ++p) {
+    float best = FLT_MAX;
+    uint8_t best_index = 0;
+
+    for (size_t e = 0; e < palette_size; ++e) {
+      float distance = 0.0f;
+
+      for (size_t c = 0; c < channels; ++c) {
+        float d = pixels[c][p] - palette[e * 4 + c];
+        distance += d * d;
+      }
+
+      if (distance < best) {
+        best = distance;
+        best_index = (uint8_t)e;
+      }
+    }
+
+    indices[p] = best_index;
+    error += best;
+  }
+
+  return error;
+}
+
+// the line along which the pixels spread out the most (in the first
+// `channels` channels), cut off where the outermost pixels project onto it
+static void _endpoints(const struct _block *block, size_t channels, float *e0,
+                       float *e1) {
+  float mean[4] = {0};
+  float covariance[4][4] = {0};
+
+  for (size_t c = 0; c < channels; ++c) {
+    for (size_t p = 0; p < BLOCK_PIXELS; ++p)
+      mean[c] += block->c[c][p];
+
+    mean[c] /= (float)BLOCK_PIXELS;
+  }
+
+  for (size_t p = 0; p < BLOCK_PIXELS; ++p) {
+    for (size_t i = 0; i < channels; ++i) {
+      for (size_t j = i; j < channels; ++j) {
+        covariance[i][j] +=
+            (block->c[i][p] - mean[i]) * (block->c[j][p] - mean[j]);
+      }
+    }
+  }
+
+  // power iteration, starting at the row of the channel with the largest
+  // variance, which can't be perpendicular to the axis we're after
+  float axis[4] = {0};
+  size_t widest = 0;
+
+  for (size_t i = 0; i < channels; ++i) {
+    for (size_t j = 0; j < i; ++j)
+      covariance[i][j] = covariance[j][i];
+
+    if (covariance[i][i] > covariance[widest][widest])
+      widest = i;
+  }
+
+  for (size_t c = 0; c < channels; ++c)
+    axis[c] = covariance[widest][c];
+
+  for (size_t iteration = 0; iteration < AXIS_ITERATIONS; ++iteration) {
+    float next[4] = {0};
+    float largest = 0.0f;
+
+    for (size_t i = 0; i < channels; ++i) {
+      for (size_t j = 0; j < channels; ++j)
+        next[i] += covariance[i][j] * axis[j];
+
+      if (fabsf(next[i]) > largest)
+        largest = fabsf(next[i]);
+    }
+
+    if (largest < FLT_EPSILON)
+      break;
+
+    for (size_t c = 0; c < channels; ++c)
+      axis[c] = next[c] / largest;
+  }
+
+  float length = 0.0f;
+  for (size_t c = 0; c < channels; ++c)
+    length += axis[c] * axis[c];
+
+  if (length < FLT_EPSILON) {
+    // every pixel is the same
+    memcpy(e0, mean, sizeof(mean));
+    memcpy(e1, mean, sizeof(mean));
+    return;
+  }
+
+  length = sqrtf(length);
+
+  float low = FLT_MAX, high = -FLT_MAX;
+
+  for (size_t p = 0; p < BLOCK_PIXELS; ++p) {
+    float t = 0.0f;
+
+    for (size_t c = 0; c < channels; ++c)
+      t += (block->c[c][p] - mean[c]) * axis[c];
+
+    t /= length;
+
+    low = MIN(t, low);
+    high = MAX(t, high);
+  }
+
+  for (size_t c = 0; c < channels; ++c) {
+    float a = mean[c] + axis[c] / length * low;
+    float b = mean[c] + axis[c] / length * high;
+
+    e0[c] = CLAMP(a, 0.0f, 255.0f);
+    e1[c] = CLAMP(b, 0.0f, 255.0f);
+  }
+}
+
+// least squares fit of the endpoints to the pixels, keeping the indices as
+// they are. `weights` holds how far along from e0 to e1 every index is
+static bool _refit(const struct _block *block, size_t channels,
+                   const uint8_t *indices, const float *weights, float *e0,
+                   float *e1) {
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[4] = {0}, bx[4] = {0};
+
+  for (size_t p = 0; p < BLOCK_PIXELS; ++p) {
+    float b = weights[indices[p]];
+    float a = 1.0f - b;
+
+    aa += a * a;
+    ab += a * b;
+    bb += b * b;
+
+    for (size_t c = 0; c < channels; ++c) {
+      ax[c] += a * block->c[c][p];
+      bx[c] += b * block->c[c][p];
+    }
+  }
+
+  float determinant = aa * bb - ab * ab;
+
+  // all pixels picked the same index (or two indices at the same weight)
+  if (fabsf(determinant) < FLT_EPSILON)
+    return false;
+
+  for (size_t c = 0; c < channels; ++c) {
+    float a = (ax[c] * bb - ab * bx[c]) / determinant;
+    float b = (aa * bx[c] - ab * ax[c]) / determinant;
+
+    e0[c] = CLAMP(a, 0.0f, 255.0f);
+    e1[c] = CLAMP(b, 0.0f, 255.0f);
+  }
+
+  return true;
+}
+
+static uint16_t _pack_565(const float *color) {
+  uint16_t r = (uint16_t)(color[0] * 31.0f / 255.0f + 0.5f);
+  uint16_t g = (uint16_t)(color[1] * 63.0f / 255.0f + 0.5f);
+  uint16_t b = (uint16_t)(color[2] * 31.0f / 255.0f + 0.5f);
+
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void _unpack_565(uint16_t packed, float *color) {
+  color[0] = (float)((packed >> 11) & 0x1F) * 255.0f / 31.0f;
+  color[1] = (float)((packed >> 5) & 0x3F) * 255.0f / 63.0f;
+  color[2] = (float)(packed & 0x1F) * 255.0f / 31.0f;
+  color[3] = 255.0f;
+}
+
+// BC7 mode 6 endpoints are 7 bits per channel plus one low bit shared by
+// all channels; pick whichever of the two low bits ends up closer
+static void _quantize_bc7(const float *endpoint, uint8_t *output,
+                          uint8_t *p_bit) {
+  float best = FLT_MAX;
+
+  for (uint8_t p = 0; p < 2; ++p) {
+    uint8_t candidate[4];
+    float error = 0.0f;
+
+    for (size_t c = 0; c < 4; ++c) {
+      float v = (endpoint[c] - (float)p) / 2.0f + 0.5f;
+      v = CLAMP(v, 0.0f, 127.0f);
+
+      candidate[c] = (uint8_t)v;
+
+      float d = (float)((candidate[c] << 1) | p) - endpoint[c];
+      error += d * d;
+    }
+
+    if (error < best) {
+      best = error;
+      memcpy(output, candidate, sizeof(candidate));
+      *p_bit = p;
+    }
+  }
+}
+
+// 4-color mode only: c0 is kept above c1, which BC3 color blocks assume
+// anyway. Alpha is ignored
+static void _encode_bc1(const struct _block *block, uint8_t *output) {
+  static const float weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+  float e0[4] = {0}, e1[4] = {0};
+  _endpoints(block, 3, e0, e1);
+
+  uint16_t best_c0 = 0, best_c1 = 0;
+  uint8_t best_indices[BLOCK_PIXELS] = {0};
+  float best_error = FLT_MAX;
+
+  // once with the endpoints of the principal axis, once refit to the
+  // indices that produced
+  for (size_t pass = 0; pass < 2; ++pass) {
+    uint16_t c0 = _pack_565(e1);
+    uint16_t c1 = _pack_565(e0);
+
+    if (c0 < c1) {
+      uint16_t temp = c0;
+      c0 = c1;
+      c1 = temp;
+    }
+
+    float palette[4][4];
+    _unpack_565(c0, palette[0]);
+    _unpack_565(c1, palette[1]);
+
+    for (size_t c = 0; c < 4; ++c) {
+      palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+      palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+    }
+
+    // equal endpoints would switch the block to 3-color mode, so every
+    // pixel has to pick the first one
+    uint8_t indices[BLOCK_PIXELS] = {0};
+    float error = _fit_indices(block, 0, 3, &palette[0][0],
+                               CONDITIONAL(c0 == c1, 1, 4), indices);
+
+    if (error < best_error) {
+      best_error = error;
+      best_c0 = c0;
+      best_c1 = c1;
+      memcpy(best_indices, indices, sizeof(indices));
+    }
+
+    if (0 != pass)
+      break;
+
+    memcpy(e1, palette[0], sizeof(palette[0]));
+    memcpy(e0, palette[1], sizeof(palette[1]));
+
+    if (false == _refit(block, 3, indices, weights, e1, e0))
+      break;
+  }
+
+  uint32_t packed = 0;
+  for (size_t p = 0; p < BLOCK_PIXELS; ++p)
+    packed |= (uint32_t)best_indices[p] << (p * 2);
+
+  output[0] = (uint8_t)(best_c0 & 0xFF);
+  output[1] = (uint8_t)(best_c0 >> 8);
+  output[2] = (uint8_t)(best_c1 & 0xFF);
+  output[3] = (uint8_t)(best_c1 >> 8);
+
+  for (size_t i = 0; i < 4; ++i)
+    output[4 + i] = (uint8_t)(packed >> (i * 8));
+}
+
+// one channel, as a BC4 block (the alpha half of BC3, or half of BC5).
+// Always the 8-value mode, between the lowest and highest pixel
+static void _encode_bc4(const struct _block *block, size_t channel,
+                        uint8_t *output) {
+  float low = 255.0f, high = 0.0f;
+
+  for (size_t p = 0; p < BLOCK_PIXELS; ++p) {
+    low = MIN(block->c[channel][p], low);
+    high = MAX(block->c[channel][p], high);
+  }
+
+  uint8_t a0 = (uint8_t)(high + 0.5f);
+  uint8_t a1 = (uint8_t)(low + 0.5f);
+
+  uint8_t indices[BLOCK_PIXELS] = {0};
+
+  // with a0 == a1 every index is 0 already
+  if (a0 > a1) {
+    float palette[8][4] = {{(float)a0}, {(float)a1}};
+
+    for (size_t i = 2; i < 8; ++i)
+      palette[i][0] = ((float)(8 - i) * a0 + (float)(i - 1) * a1) / 7.0f;
+
+    _fit_indices(block, channel, 1, &palette[0][0], 8, indices);
+  }
+
+  uint64_t packed = 0;
+  for (size_t p = 0; p < BLOCK_PIXELS; ++p)
+    packed |= (uint64_t)indices[p] << (p * 3);
+
+  output[0] = a0;
+  output[1] = a1;
+
+  for (size_t i = 0; i < 6; ++i)
+    output[2 + i] = (uint8_t)(packed >> (i * 8));
+}
+
+// mode 6: one subset, RGBA endpoints, 16 interpolated colors. Every
+// quality level is one more least squares refit of the endpoints
+static void _encode_bc7(const struct _block *block, uint32_t quality,
+                        uint8_t *output) {
+  static const uint8_t interpolation[16] = {0,  4,  9,  13, 17, 21, 26, 30,
+                                            34, 38, 43, 47, 51, 55, 60, 64};
+
+  float weights[16];
+  for (size_t i = 0; i < 16; ++i)
+    weights[i] = (float)interpolation[i] / 64.0f;
+
+  float e0[4] = {0}, e1[4] = {0};
+  _endpoints(block, 4, e0, e1);
+
+  uint8_t best_q0[4] = {0}, best_q1[4] = {0};
+  uint8_t best_p0 = 0, best_p1 = 0;
+  uint8_t best_indices[BLOCK_PIXELS] = {0};
+  float best_error = FLT_MAX;
+
+  for (uint32_t pass = 0; pass <= quality; ++pass) {
+    uint8_t q0[4], q1[4];
+    uint8_t p0 = 0, p1 = 0;
+
+    _quantize_bc7(e0, q0, &p0);
+    _quantize_bc7(e1, q1, &p1);
+
+    float palette[16][4];
+
+    for (size_t c = 0; c < 4; ++c) {
+      uint32_t v0 = (uint32_t)((q0[c] << 1) | p0);
+      uint32_t v1 = (uint32_t)((q1[c] << 1) | p1);
+
+      for (size_t i = 0; i < 16; ++i) {
+        palette[i][c] = (float)(((64 - interpolation[i]) * v0 +
+                                 interpolation[i] * v1 + 32) >>
+                                6);
+      }
+
+      e0[c] = (float)v0;
+      e1[c] = (float)v1;
+    }
+
+    uint8_t indices[BLOCK_PIXELS];
+    float error = _fit_indices(block, 0, 4, &palette[0][0], 16, indices);
+
+    if (error < best_error) {
+      best_error = error;
+
+      memcpy(best_q0, q0, sizeof(q0));
+      memcpy(best_q1, q1, sizeof(q1));
+      best_p0 = p0;
+      best_p1 = p1;
+      memcpy(best_indices, indices, sizeof(indices));
+    }
+
+    if (pass == quality ||
+        false == _refit(block, 4, indices, weights, e0, e1))
+      break;
+  }
+
+  // the top bit of the first index is implied to be 0, so swap the
+  // endpoints if it isn't
+  if (best_indices[0] & 8) {
+    for (size_t c = 0; c < 4; ++c) {
+      uint8_t temp = best_q0[c];
+      best_q0[c] = best_q1[c];
+      best_q1[c] = temp;
+    }
+
+    uint8_t temp = best_p0;
+    best_p0 = best_p1;
+    best_p1 = temp;
+
+    for (size_t p = 0; p < BLOCK_PIXELS; ++p)
+      best_indices[p] = (uint8_t)(15 - best_indices[p]);
+  }
+
+  memset(output, 0, 16);
+  size_t position = 0;
+
+  _put_bits(output, &position, 1 << 6, 7);
+
+  for (size_t c = 0; c < 4; ++c) {
+    _put_bits(output, &position, best_q0[c], 7);
+    _put_bits(output, &position, best_q1[c], 7);
+  }
+
+  _put_bits(output, &position, best_p0, 1);
+  _put_bits(output, &position, best_p1, 1);
+
+  _put_bits(output, &position, best_indices[0], 3);
+  for (size_t p = 1; p < BLOCK_PIXELS; ++p)
+    _put_bits(output, &position, best_indices[p], 4);
+}
+
+// least significant bit first, starting at bit 0 of byte 0
+static void _put_bits(uint8_t *output, size_t *position, uint32_t value,
+                      size_t count) {
+  for (size_t i = 0; i < count; ++i, ++*position) {
+    if (value & (1u << i))
+      output[*position / 8] |= (uint8_t)(1u << (*position % 8));
+  }
+}
+
+static char *_cache_path(const char *directory, uint64_t hash) {
+  // separator, 16 hex digits, ".bc" and the terminator
+  size_t length = strlen(directory) + 1 + 16 + 3 + 1;
+
+  char *path = (char *)malloc(length);
+  if (NULL == path) {
+    perror("malloc()");
+    return NULL;
+  }
+
+  snprintf(path, length, "%s/%016llx.bc", directory, (unsigned long long)hash);
+
+  return path;
+}
+
+// a file that is missing, or was written for other pixels or settings, is
+// just a miss
+static bool _cache_load(const char *path, const struct _cache_header *header,
+                        Fpx3d_Vk_CompressedImage *output) {
+  FILE *fp = fopen(path, "rb");
+  if (NULL == fp)
+    return false;
+
+  struct _cache_header stored = {0};
+  if (1 != fread(&stored, sizeof(stored), 1, fp) ||
+      0 != memcmp(&stored, header, sizeof(stored))) {
+    fclose(fp);
+    return false;
+  }
+
+  uint8_t *blocks = (uint8_t *)malloc(output->size);
+  if (NULL == blocks) {
+    perror("malloc()");
+    fclose(fp);
+    return false;
+  }
+
+  if (output->size != fread(blocks, 1, output->size, fp)) {
+    FREE_SAFE(blocks);
+    fclose(fp);
+    return false;
+  }
+
+  fclose(fp);
+
+  output->blocks = blocks;
+
+  return true;
+}
+
+// written next to the final name first, so other threads and processes
+// never read half a file
+static void _cache_store(const char *path, const struct _cache_header *header,
+                         const Fpx3d_Vk_CompressedImage *image) {
+  // room for ".<16 hex digits>.tmp"
+  size_t length = strlen(path) + 1 + 16 + 4 + 1;
+
+  char *temp_path = (char *)malloc(length);
+  if (NULL == temp_path) {
+    perror("malloc()");
+    return;
+  }
+
+  // the address of the image is unique among the threads writing right now
+  snprintf(temp_path, length, "%s.%016llx.tmp", path,
+           (unsigned long long)(uintptr_t)image);
+
+  FILE *fp = fopen(temp_path, "wb");
+  if (NULL == fp) {
+    FPX3D_WARN("Could not write compressed image cache file %s", temp_path);
+    FREE_SAFE(temp_path);
+    return;
+  }
+
+  bool written = (1 == fwrite(header, sizeof(*header), 1, fp)) &&
+                 (image->size == fwrite(image->blocks, 1, image->size, fp));
+
+  if (0 != fclose(fp))
+    written = false;
+
+  if (false == written || 0 != rename(temp_path, path))
+    remove(temp_path);
+
+  FREE_SAFE(temp_path);
+}
+// END OF STATIC FUNCTIONS ----
@@ -0,0 +1,785 @@
+/*
+ * Copyright (c) Erynn Scholtes
+ * SPDX-License-Identifier: MIT
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "debug.h"
+#include "fpx3d.h"
+#include "macros.h"
+#include "volk/volk.h"
+
+#include "vk/buffer.h"
+#include "vk/context.h"
+#include "vk/image.h"
+#include "vk/logical_gpu.h"
+#include "vk/texture_compression.h"
+#include "vk/typedefs.h"
+
+#include "vk/upload.h"
+
+// everything that may read or overwrite what was uploaded
+#define UPLOAD_DST_STAGES                                                      \
+  (VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |  \
+   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT)
+#define UPLOAD_DST_ACCESS                                                      \
+  (VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT |            \
+   VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT |                    \
+   VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT)
+
+// buffer writes up to this size are recorded with vkCmdUpdateBuffer(),
+// which keeps the data in the command buffer (the limit is 64 KiB, but
+// drivers copy it around for every submission)
+#define INLINE_UPDATE_MAX_SIZE 4096
+
+extern VkCommandBuffer __fpx3d_vk_begin_temp_command_buffer(VkCommandPool,
+                                                            VkDevice);
+extern VkCommandPool *__fpx3d_vk_select_pool_of_type(Fpx3d_Vk_E_CommandPoolType,
+                                                     Fpx3d_Vk_LogicalGpu *);
+
+extern Fpx3d_E_Result __fpx3d_realloc_array(void **, size_t obj_size,
+                                            size_t amount,
+                                            size_t *old_capacity);
+
+extern Fpx3d_E_Result __fpx3d_vk_new_buffer(VkPhysicalDevice,
+                                            Fpx3d_Vk_LogicalGpu *,
+                                            VkDeviceSize size,
+                                            VkBufferUsageFlags usage,
+                                            VkMemoryPropertyFlags mem_flags,
+                                            VkSharingMode,
+                                            Fpx3d_Vk_Buffer *output_buffer);
+extern void __fpx3d_vk_destroy_buffer_object(Fpx3d_Vk_LogicalGpu *,
+                                             Fpx3d_Vk_Buffer *);
+
+extern Fpx3d_E_Result __fpx3d_vk_record_image_transition(VkCommandBuffer,
+                                                         Fpx3d_Vk_Image *,
+                                                         VkImageLayout);
+extern Fpx3d_E_Result __fpx3d_vk_host_copy_image(Fpx3d_Vk_LogicalGpu *,
+                                                 Fpx3d_Vk_Image *,
+                                                 const void *data);
+
+extern bool __fpx3d_vk_staging_claim(VkPhysicalDevice, Fpx3d_Vk_LogicalGpu *);
+extern void __fpx3d_vk_staging_unclaim(Fpx3d_Vk_LogicalGpu *);
+extern Fpx3d_E_Result
+__fpx3d_vk_staging_reserve(Fpx3d_Vk_LogicalGpu *, VkDeviceSize size,
+                           VkDeviceSize alignment,
+                           struct fpx3d_vk_staging_region *output);
+extern Fpx3d_E_Result __fpx3d_vk_staging_submit(Fpx3d_Vk_UploadBatch *,
+                                                Fpx3d_Vk_UploadTicket *output);
+extern bool __fpx3d_vk_staging_done(Fpx3d_Vk_LogicalGpu *,
+                                    Fpx3d_Vk_UploadTicket);
+extern Fpx3d_E_Result __fpx3d_vk_staging_wait(Fpx3d_Vk_LogicalGpu *,
+                                              Fpx3d_Vk_UploadTicket);
+
+Fpx3d_E_Result __fpx3d_vk_begin_upload_batch(VkPhysicalDevice,
+                                             Fpx3d_Vk_LogicalGpu *,
+                                             Fpx3d_Vk_UploadBatch *output);
+Fpx3d_E_Result __fpx3d_vk_batch_fill_new_buffer(Fpx3d_Vk_UploadBatch *,
+                                                Fpx3d_Vk_Buffer *dst,
+                                                const void *data,
+                                                VkDeviceSize size);
+Fpx3d_E_Result __fpx3d_vk_batch_fill_buffer_range(Fpx3d_Vk_UploadBatch *,
+                                                  Fpx3d_Vk_Buffer *dst,
+                                                  VkDeviceSize dst_offset,
+                                                  const void *data,
+                                                  VkDeviceSize size);
+Fpx3d_E_Result __fpx3d_vk_batch_overwrite_buffer(Fpx3d_Vk_UploadBatch *,
+                                                 Fpx3d_Vk_Buffer *dst,
+                                                 VkDeviceSize dst_offset,
+                                                 const void *data,
+                                                 VkDeviceSize size,
+                                                 uint64_t used_frame);
+
+// static declarations ----
+static Fpx3d_E_Result _stage(Fpx3d_Vk_UploadBatch *, const void *data,
+                             VkDeviceSize size, VkDeviceSize alignment,
+                             struct fpx3d_vk_staging_region *output);
+static Fpx3d_E_Result _write_buffer(Fpx3d_Vk_UploadBatch *,
+                                    Fpx3d_Vk_Buffer *dst,
+                                    VkDeviceSize dst_offset,
+                                    const void *data, VkDeviceSize size);
+static void _wait_for_readers(Fpx3d_Vk_UploadBatch *);
+static void _add_frame_wait(Fpx3d_Vk_UploadBatch *, uint64_t frame);
+static void _wait_for_frames(Fpx3d_Vk_UploadBatch *);
+static VkCommandBuffer _transfer_command_buffer(Fpx3d_Vk_UploadBatch *);
+static void _hand_over_buffer(Fpx3d_Vk_UploadBatch *, Fpx3d_Vk_Buffer *);
+static void _hand_over_image(Fpx3d_Vk_UploadBatch *, Fpx3d_Vk_Image *,
+                             VkImageLayout);
+// end of static declarations ----
+
+Fpx3d_E_Result __fpx3d_vk_begin_upload_batch(VkPhysicalDevice dev,
+                                             Fpx3d_Vk_LogicalGpu *lgpu,
+                                             Fpx3d_Vk_UploadBatch *output) {
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+
+  NULL_CHECK(lgpu, FPX3D_ARGS_ERROR);
+  NULL_CHECK(lgpu->handle, FPX3D_VK_LGPU_INVALID_ERROR);
+
+  VkCommandPool *pool = NULL;
+  if (NULL != lgpu->commandPools)
+    pool = __fpx3d_vk_select_pool_of_type(GRAPHICS_POOL, lgpu);
+
+  // always the first queue, so that whatever is submitted to it later
+  // comes after the uploads
+  if (NULL == pool || NULL == lgpu->graphicsQueues.queues ||
+      1 > lgpu->graphicsQueues.count) {
+    FPX3D_WARN("No graphics command pool or queue to upload with");
+    return FPX3D_VK_QUEUE_RETRIEVE_ERROR;
+  }
+
+  memset(output, 0, sizeof(*output));
+
+  output->commandBuffer =
+      __fpx3d_vk_begin_temp_command_buffer(*pool, lgpu->handle);
+  NULL_CHECK(output->commandBuffer, FPX3D_VK_ERROR);
+
+  output->logicalGpu = lgpu;
+  output->physicalGpu = dev;
+  output->commandPool = *pool;
+  output->queue = lgpu->graphicsQueues.queues[0];
+
+  // a transfer queue of the same family as the graphics queue wouldn't run
+  // any more alongside it than the graphics queue itself
+  VkCommandPool *t_pool = __fpx3d_vk_select_pool_of_type(TRANSFER_POOL, lgpu);
+  if (NULL != t_pool && NULL != lgpu->transferQueues.queues &&
+      0 < lgpu->transferQueues.count &&
+      0 <= lgpu->transferQueues.queueFamilyIndex &&
+      lgpu->transferQueues.queueFamilyIndex !=
+          lgpu->graphicsQueues.queueFamilyIndex) {
+    output->transferCommandPool = *t_pool;
+    output->transferQueue = lgpu->transferQueues.queues[0];
+  }
+
+  // without a physical GPU, nothing can be staged
+  output->ownsStagingRing =
+      VK_NULL_HANDLE != dev && __fpx3d_vk_staging_claim(dev, lgpu);
+
+  output->isValid = true;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_begin_upload_batch(Fpx3d_Vk_Context *ctx,
+                                           Fpx3d_Vk_LogicalGpu *lgpu,
+                                           Fpx3d_Vk_UploadBatch *output) {
+  NULL_CHECK(ctx, FPX3D_ARGS_ERROR);
+  NULL_CHECK(ctx->physicalGpu, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+
+  return __fpx3d_vk_begin_upload_batch(ctx->physicalGpu, lgpu, output);
+}
+
+Fpx3d_E_Result fpx3d_vk_batch_upload_buffer(Fpx3d_Vk_UploadBatch *batch,
+                                            Fpx3d_Vk_Buffer *dst,
+                                            VkDeviceSize dst_offset,
+                                            const void *data,
+                                            VkDeviceSize size) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(dst, FPX3D_ARGS_ERROR);
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid || false == dst->isValid || 0 == size)
+    return FPX3D_ARGS_ERROR;
+
+  // frames in flight may still be drawing with the old contents; which
+  // ones isn't known, so it's all of them
+  _add_frame_wait(batch, UINT64_MAX);
+
+  return _write_buffer(batch, dst, dst_offset, data, size);
+}
+
+// writes part of `dst` that frames up to `used_frame` (frameIndex + 1 of the
+// last one that may read it, 0 if none does) may still be drawing with
+Fpx3d_E_Result __fpx3d_vk_batch_overwrite_buffer(Fpx3d_Vk_UploadBatch *batch,
+                                                 Fpx3d_Vk_Buffer *dst,
+                                                 VkDeviceSize dst_offset,
+                                                 const void *data,
+                                                 VkDeviceSize size,
+                                                 uint64_t used_frame) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(dst, FPX3D_ARGS_ERROR);
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid || false == dst->isValid || 0 == size)
+    return FPX3D_ARGS_ERROR;
+
+  _add_frame_wait(batch, used_frame);
+
+  return _write_buffer(batch, dst, dst_offset, data, size);
+}
+
+// writes part of `dst` that no frame in flight uses, such as a range a
+// Fpx3d_Vk_MeshArena retired long enough ago, without waiting for frames
+Fpx3d_E_Result __fpx3d_vk_batch_fill_buffer_range(Fpx3d_Vk_UploadBatch *batch,
+                                                  Fpx3d_Vk_Buffer *dst,
+                                                  VkDeviceSize dst_offset,
+                                                  const void *data,
+                                                  VkDeviceSize size) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(dst, FPX3D_ARGS_ERROR);
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid || false == dst->isValid || 0 == size)
+    return FPX3D_ARGS_ERROR;
+
+  return _write_buffer(batch, dst, dst_offset, data, size);
+}
+
+// fills all of `dst`, which nothing has used yet. That can be done on
+// the transfer queue
+Fpx3d_E_Result __fpx3d_vk_batch_fill_new_buffer(Fpx3d_Vk_UploadBatch *batch,
+                                                Fpx3d_Vk_Buffer *dst,
+                                                const void *data,
+                                                VkDeviceSize size) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(dst, FPX3D_ARGS_ERROR);
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid || false == dst->isValid || 0 == size)
+    return FPX3D_ARGS_ERROR;
+
+  VkCommandBuffer t_cbuf = _transfer_command_buffer(batch);
+
+  if (VK_NULL_HANDLE == t_cbuf)
+    return _write_buffer(batch, dst, 0, data, size);
+
+  struct fpx3d_vk_staging_region region = {0};
+  FPX3D_ONFAIL(_stage(batch, data, size, 1, &region), success,
+               return success;);
+
+  VkBufferCopy copy = {0};
+  copy.srcOffset = region.offset;
+  copy.dstOffset = 0;
+  copy.size = size;
+
+  vkCmdCopyBuffer(t_cbuf, region.buffer, dst->buffer, 1, &copy);
+
+  // the semaphore between the two queues is enough for concurrent buffers
+  if (VK_SHARING_MODE_EXCLUSIVE == dst->sharingMode)
+    _hand_over_buffer(batch, dst);
+
+  ++batch->transferCommandCount;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_batch_upload_image(Fpx3d_Vk_UploadBatch *batch,
+                                           Fpx3d_Vk_Image *image,
+                                           const void *data, size_t size,
+                                           bool readonly) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(image, FPX3D_ARGS_ERROR);
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid || false == image->isValid)
+    return FPX3D_ARGS_ERROR;
+
+  NULL_CHECK(image->image, FPX3D_VK_BAD_IMAGE_HANDLE_ERROR);
+
+  size = MIN(size, fpx3d_vk_get_image_size_bytes(image));
+  if (0 == size)
+    return FPX3D_ARGS_ERROR;
+
+  // nothing can be using an image that was never filled, so it can be
+  // filled on the host right away
+  if (readonly && image->hostTransfer &&
+      VK_IMAGE_LAYOUT_UNDEFINED == image->imageLayout &&
+      fpx3d_vk_get_image_size_bytes(image) == size)
+    return __fpx3d_vk_host_copy_image(batch->logicalGpu, image, data);
+
+  // bufferOffset has to be a multiple of the texel (or block) size
+  VkDeviceSize texel_size = 16;
+  if (FPX3D_VK_BLOCK_NONE == image->blockFormat)
+    texel_size = image->dimensions.channels * image->dimensions.channelWidth;
+
+  // an image that was never used can't be in use by the graphics queue,
+  // and has no contents to hand over to the transfer queue first
+  VkCommandBuffer cbuf = VK_NULL_HANDLE;
+  if (VK_IMAGE_LAYOUT_UNDEFINED == image->imageLayout)
+    cbuf = _transfer_command_buffer(batch);
+
+  bool on_transfer_queue = (VK_NULL_HANDLE != cbuf);
+  if (false == on_transfer_queue)
+    cbuf = batch->commandBuffer;
+
+  if (VK_IMAGE_LAYOUT_UNDEFINED != image->imageLayout)
+    _add_frame_wait(batch, UINT64_MAX);
+
+  struct fpx3d_vk_staging_region region = {0};
+  FPX3D_ONFAIL(_stage(batch, data, size, texel_size, &region), success,
+               return success;);
+
+  FPX3D_ONFAIL(__fpx3d_vk_record_image_transition(
+                   cbuf, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+               success, return success;);
+
+  VkImageSubresourceRange s_range = image->subresourceRange;
+
+  VkBufferImageCopy copy = {
+      .bufferOffset = region.offset,
+      .bufferRowLength = 0,
+      .bufferImageHeight = 0,
+      .imageSubresource = {.aspectMask = s_range.aspectMask,
+                           .mipLevel = s_range.baseMipLevel,
+                           .baseArrayLayer = s_range.baseArrayLayer,
+                           .layerCount = s_range.layerCount},
+      .imageOffset = {0, 0, 0},
+      .imageExtent = {.width = image->dimensions.width,
+                      .height = image->dimensions.height,
+                      .depth = 1}};
+
+  vkCmdCopyBufferToImage(cbuf, region.buffer, image->image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+  if (on_transfer_queue) {
+    // the handover does the transition to VK_IMAGE_LAYOUT_SHADER_READ_ONLY
+    _hand_over_image(batch, image,
+                     CONDITIONAL(readonly,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL));
+
+    ++batch->transferCommandCount;
+
+    image->isReadOnly = readonly;
+
+    return FPX3D_SUCCESS;
+  }
+
+  ++batch->commandCount;
+
+  image->isReadOnly = false;
+
+  if (readonly)
+    return fpx3d_vk_batch_transition_image(
+        batch, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_batch_update_image(Fpx3d_Vk_UploadBatch *batch,
+                                           Fpx3d_Vk_Image *image,
+                                           const Fpx3d_Vk_ImageRegion *region,
+                                           const void *data, bool readonly) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(image, FPX3D_ARGS_ERROR);
+  NULL_CHECK(region, FPX3D_ARGS_ERROR);
+  NULL_CHECK(data, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid || false == image->isValid)
+    return FPX3D_ARGS_ERROR;
+
+  NULL_CHECK(image->image, FPX3D_VK_BAD_IMAGE_HANDLE_ERROR);
+
+  VkImageSubresourceRange s_range = image->subresourceRange;
+
+  uint32_t image_width = image->dimensions.width;
+  uint32_t image_height = image->dimensions.height;
+
+  if (0 == region->width || 0 == region->height ||
+      region->x >= image_width || region->y >= image_height ||
+      region->width > image_width - region->x ||
+      region->height > image_height - region->y)
+    return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+
+  uint32_t row_length = region->rowLength;
+  if (0 == row_length)
+    row_length = region->width;
+
+  if (row_length < region->width)
+    return FPX3D_ARGS_ERROR;
+
+  // bytes between the starts of two rows in `data`, and the rows there are;
+  // for compressed images, a row is a row of blocks
+  size_t row_pitch = 0;
+  size_t row_bytes = 0;
+  uint32_t rows = region->height;
+
+  // bufferOffset has to be a multiple of the texel (or block) size
+  VkDeviceSize texel_size = 16;
+
+  if (FPX3D_VK_BLOCK_NONE == image->blockFormat) {
+    texel_size = image->dimensions.channels * image->dimensions.channelWidth;
+
+    row_pitch = row_length * texel_size;
+    row_bytes = region->width * texel_size;
+  } else {
+    bool whole_width = region->x + region->width == image_width;
+    bool whole_height = region->y + region->height == image_height;
+
+    if (0 != region->x % 4 || 0 != region->y % 4 ||
+        (0 != region->width % 4 && false == whole_width) ||
+        (0 != region->height % 4 && false == whole_height) ||
+        0 != row_length % 4)
+      return FPX3D_ARGS_ERROR;
+
+    row_pitch = fpx3d_vk_compressed_size(image->blockFormat, row_length, 1);
+    row_bytes = fpx3d_vk_compressed_size(image->blockFormat, region->width, 1);
+    rows = (region->height + 3) / 4;
+  }
+
+  // the last row only goes as far as the region does
+  size_t size = (rows - 1) * row_pitch + row_bytes;
+
+  struct fpx3d_vk_staging_region staging = {0};
+  FPX3D_ONFAIL(_stage(batch, data, size, texel_size, &staging), success,
+               return success;);
+
+  if (VK_IMAGE_LAYOUT_UNDEFINED != image->imageLayout)
+    _add_frame_wait(batch, UINT64_MAX);
+
+  // the rest of the image is kept, so it's never moved out of UNDEFINED
+  // on the transfer queue here
+  FPX3D_ONFAIL(__fpx3d_vk_record_image_transition(
+                   batch->commandBuffer, image,
+                   VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL),
+               success, return success;);
+
+  VkBufferImageCopy copy = {
+      .bufferOffset = staging.offset,
+      .bufferRowLength = CONDITIONAL(0 == region->rowLength, 0, row_length),
+      .bufferImageHeight = 0,
+      .imageSubresource = {.aspectMask = s_range.aspectMask,
+                           .mipLevel = s_range.baseMipLevel,
+                           .baseArrayLayer = s_range.baseArrayLayer,
+                           .layerCount = s_range.layerCount},
+      .imageOffset = {(int32_t)region->x, (int32_t)region->y, 0},
+      .imageExtent = {.width = region->width,
+                      .height = region->height,
+                      .depth = 1}};
+
+  vkCmdCopyBufferToImage(batch->commandBuffer, staging.buffer, image->image,
+                         VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+  ++batch->commandCount;
+
+  image->isReadOnly = false;
+
+  if (readonly)
+    return fpx3d_vk_batch_transition_image(
+        batch, image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_batch_transition_image(Fpx3d_Vk_UploadBatch *batch,
+                                               Fpx3d_Vk_Image *image,
+                                               VkImageLayout layout) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+  NULL_CHECK(image, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid || false == image->isValid)
+    return FPX3D_ARGS_ERROR;
+
+  FPX3D_ONFAIL(__fpx3d_vk_record_image_transition(batch->commandBuffer,
+                                                  image, layout),
+               success, return success;);
+
+  image->isReadOnly = (VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL == layout);
+
+  ++batch->commandCount;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result fpx3d_vk_submit_upload_batch(Fpx3d_Vk_UploadBatch *batch,
+                                            Fpx3d_Vk_UploadTicket *output) {
+  NULL_CHECK(batch, FPX3D_ARGS_ERROR);
+
+  if (false == batch->isValid)
+    return FPX3D_ARGS_ERROR;
+
+  if (NULL != output)
+    *output = 0;
+
+  if (0 == batch->commandCount && 0 == batch->transferCommandCount) {
+    fpx3d_vk_discard_upload_batch(batch);
+    return FPX3D_SUCCESS;
+  }
+
+  // one barrier for everything copied on the graphics queue: later reads
+  // and writes, in this submission or in any that come after it on the
+  // same queue, see the data
+  if (0 < batch->commandCount) {
+    VkMemoryBarrier barrier = {0};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = UPLOAD_DST_ACCESS;
+
+    vkCmdPipelineBarrier(batch->commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         UPLOAD_DST_STAGES, 0, 1, &barrier, 0, NULL, 0, NULL);
+  }
+
+  // the barriers only order the batch after what went to its own queue
+  // before; frames may have been submitted to any graphics queue
+  if (0 < batch->waitForFrame)
+    _wait_for_frames(batch);
+
+  Fpx3d_E_Result success = __fpx3d_vk_staging_submit(batch, output);
+
+  if (FPX3D_SUCCESS != success) {
+    fpx3d_vk_discard_upload_batch(batch);
+    return success;
+  }
+
+  memset(batch, 0, sizeof(*batch));
+
+  return FPX3D_SUCCESS;
+}
+
+// images that were to be transitioned by the batch are left with the
+// layout it would have put them in
+void fpx3d_vk_discard_upload_batch(Fpx3d_Vk_UploadBatch *batch) {
+  NULL_CHECK(batch, );
+
+  if (false == batch->isValid)
+    return;
+
+  Fpx3d_Vk_LogicalGpu *lgpu = batch->logicalGpu;
+
+  vkFreeCommandBuffers(lgpu->handle, batch->commandPool, 1,
+                       &batch->commandBuffer);
+
+  if (VK_NULL_HANDLE != batch->transferCommandBuffer)
+    vkFreeCommandBuffers(lgpu->handle, batch->transferCommandPool, 1,
+                         &batch->transferCommandBuffer);
+
+  for (size_t i = 0; i < batch->stagingBufferCount; ++i)
+    __fpx3d_vk_destroy_buffer_object(lgpu, &batch->stagingBuffers[i]);
+
+  FREE_SAFE(batch->stagingBuffers);
+
+  if (batch->ownsStagingRing)
+    __fpx3d_vk_staging_unclaim(lgpu);
+
+  memset(batch, 0, sizeof(*batch));
+}
+
+bool fpx3d_vk_upload_done(Fpx3d_Vk_LogicalGpu *lgpu,
+                          Fpx3d_Vk_UploadTicket ticket) {
+  return __fpx3d_vk_staging_done(lgpu, ticket);
+}
+
+Fpx3d_E_Result fpx3d_vk_wait_upload(Fpx3d_Vk_LogicalGpu *lgpu,
+                                    Fpx3d_Vk_UploadTicket ticket) {
+  return __fpx3d_vk_staging_wait(lgpu, ticket);
+}
+
+// STATIC FUNCTIONS ----
+
+// copies `data` into the staging ring, or into a staging buffer of its own
+// if the batch doesn't have the ring or it's full
+static Fpx3d_E_Result _stage(Fpx3d_Vk_UploadBatch *batch, const void *data,
+                             VkDeviceSize size, VkDeviceSize alignment,
+                             struct fpx3d_vk_staging_region *output) {
+  Fpx3d_Vk_LogicalGpu *lgpu = batch->logicalGpu;
+
+  if (batch->ownsStagingRing &&
+      FPX3D_SUCCESS ==
+          __fpx3d_vk_staging_reserve(lgpu, size, alignment, output)) {
+    memcpy(output->mapped, data, size);
+    return FPX3D_SUCCESS;
+  }
+
+  NULL_CHECK(batch->physicalGpu, FPX3D_VK_BAD_GPU_HANDLE_ERROR);
+
+  if (batch->stagingBufferCount == batch->stagingBufferCapacity) {
+    FPX3D_ONFAIL(__fpx3d_realloc_array(
+                     (void **)&batch->stagingBuffers,
+                     sizeof(batch->stagingBuffers[0]),
+                     MAX(4, batch->stagingBufferCapacity * 2),
+                     &batch->stagingBufferCapacity),
+                 success, return success;);
+  }
+
+  Fpx3d_Vk_Buffer *staging = &batch->stagingBuffers[batch->stagingBufferCount];
+
+  FPX3D_ONFAIL(
+      __fpx3d_vk_new_buffer(batch->physicalGpu, lgpu, size,
+                            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                            VK_SHARING_MODE_CONCURRENT, staging),
+      success, FPX3D_ERROR("Failed to create a staging buffer");
+      return success;);
+
+  if (NULL == staging->mapped_memory) {
+    __fpx3d_vk_destroy_buffer_object(lgpu, staging);
+    return FPX3D_VK_BAD_MEMORY_HANDLE_ERROR;
+  }
+
+  ++batch->stagingBufferCount;
+
+  memcpy(staging->mapped_memory, data, size);
+
+  output->buffer = staging->buffer;
+  output->offset = 0;
+  output->mapped = staging->mapped_memory;
+
+  return FPX3D_SUCCESS;
+}
+
+// records a write of `size` bytes at `dst_offset` into `commandBuffer`
+static Fpx3d_E_Result _write_buffer(Fpx3d_Vk_UploadBatch *batch,
+                                    Fpx3d_Vk_Buffer *dst,
+                                    VkDeviceSize dst_offset,
+                                    const void *data, VkDeviceSize size) {
+  _wait_for_readers(batch);
+
+  if (INLINE_UPDATE_MAX_SIZE >= size && 0 == dst_offset % 4 &&
+      0 == size % 4) {
+    vkCmdUpdateBuffer(batch->commandBuffer, dst->buffer, dst_offset, size,
+                      data);
+
+    ++batch->commandCount;
+
+    return FPX3D_SUCCESS;
+  }
+
+  struct fpx3d_vk_staging_region region = {0};
+  FPX3D_ONFAIL(_stage(batch, data, size, 1, &region), success,
+               return success;);
+
+  VkBufferCopy copy = {0};
+  copy.srcOffset = region.offset;
+  copy.dstOffset = dst_offset;
+  copy.size = size;
+
+  vkCmdCopyBuffer(batch->commandBuffer, region.buffer, dst->buffer, 1, &copy);
+
+  ++batch->commandCount;
+
+  return FPX3D_SUCCESS;
+}
+
+// makes what `commandBuffer` writes wait until everything submitted to its
+// queue before is done reading (or writing) it. Images get that from their
+// layout transitions
+static void _wait_for_readers(Fpx3d_Vk_UploadBatch *batch) {
+  if (batch->waitsForReaders)
+    return;
+
+  VkMemoryBarrier barrier = {0};
+  barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+  vkCmdPipelineBarrier(batch->commandBuffer, UPLOAD_DST_STAGES,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, NULL,
+                       0, NULL);
+
+  batch->waitsForReaders = true;
+}
+
+// keeps the last frame the batch has to wait for
+static void _add_frame_wait(Fpx3d_Vk_UploadBatch *batch, uint64_t frame) {
+  batch->waitForFrame = MAX(batch->waitForFrame, frame);
+}
+
+// blocks until the frames up to `waitForFrame` are done, whichever graphics
+// queue they went to. There's a fence for each in-flight command buffer;
+// the ones that were reset for a frame that isn't submitted yet are
+// skipped, as they won't signal before it is
+static void _wait_for_frames(Fpx3d_Vk_UploadBatch *batch) {
+  Fpx3d_Vk_LogicalGpu *lgpu = batch->logicalGpu;
+
+  if (NULL == lgpu->inFlightFences || NULL == lgpu->inFlightFrames)
+    return;
+
+  for (size_t i = 0; i < lgpu->inFlightCommandPool.bufferCount; ++i) {
+    if (0 == lgpu->inFlightFrames[i] ||
+        lgpu->inFlightFrames[i] > batch->waitForFrame)
+      continue;
+
+    vkWaitForFences(lgpu->handle, 1, &lgpu->inFlightFences[i], VK_TRUE,
+                    UINT64_MAX);
+  }
+}
+
+// the command buffer to fill unused resources in: the transfer queue one,
+// begun on first use, as long as nothing else was recorded for the graphics
+// queue. VK_NULL_HANDLE if they have to be filled on the graphics queue
+static VkCommandBuffer _transfer_command_buffer(Fpx3d_Vk_UploadBatch *batch) {
+  if (VK_NULL_HANDLE == batch->transferQueue || 0 < batch->commandCount)
+    return VK_NULL_HANDLE;
+
+  if (VK_NULL_HANDLE == batch->transferCommandBuffer)
+    batch->transferCommandBuffer = __fpx3d_vk_begin_temp_command_buffer(
+        batch->transferCommandPool, batch->logicalGpu->handle);
+
+  return batch->transferCommandBuffer;
+}
+
+// releases `buffer` from the transfer queue family, and has the graphics
+// queue family acquire it before anything else in the batch
+static void _hand_over_buffer(Fpx3d_Vk_UploadBatch *batch,
+                              Fpx3d_Vk_Buffer *buffer) {
+  Fpx3d_Vk_LogicalGpu *lgpu = batch->logicalGpu;
+
+  VkBufferMemoryBarrier barrier = {0};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcQueueFamilyIndex = lgpu->transferQueues.queueFamilyIndex;
+  barrier.dstQueueFamilyIndex = lgpu->graphicsQueues.queueFamilyIndex;
+  barrier.buffer = buffer->buffer;
+  barrier.offset = 0;
+  barrier.size = VK_WHOLE_SIZE;
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+
+  vkCmdPipelineBarrier(batch->transferCommandBuffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 1,
+                       &barrier, 0, NULL);
+
+  // the submission waits for the transfer queue at every stage
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = UPLOAD_DST_ACCESS;
+
+  vkCmdPipelineBarrier(batch->commandBuffer,
+                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, UPLOAD_DST_STAGES,
+                       0, 0, NULL, 1, &barrier, 0, NULL);
+}
+
+// same as _hand_over_buffer(), moving `image` to `layout` on the way
+static void _hand_over_image(Fpx3d_Vk_UploadBatch *batch,
+                             Fpx3d_Vk_Image *image, VkImageLayout layout) {
+  Fpx3d_Vk_LogicalGpu *lgpu = batch->logicalGpu;
+
+  VkImageMemoryBarrier barrier = {0};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.oldLayout = image->imageLayout;
+  barrier.newLayout = layout;
+  barrier.srcQueueFamilyIndex = lgpu->transferQueues.queueFamilyIndex;
+  barrier.dstQueueFamilyIndex = lgpu->graphicsQueues.queueFamilyIndex;
+  barrier.image = image->image;
+  barrier.subresourceRange = image->subresourceRange;
+
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.dstAccessMask = 0;
+
+  vkCmdPipelineBarrier(batch->transferCommandBuffer,
+                       VK_PIPELINE_STAGE_TRANSFER_BIT,
+                       VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, NULL, 0,
+                       NULL, 1, &barrier);
+
+  VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  barrier.srcAccessMask = 0;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+  if (VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL == layout) {
+    dst_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+  }
+
+  vkCmdPipelineBarrier(batch->commandBuffer,
+                       VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, dst_stage, 0, 0,
+                       NULL, 0, NULL, 1, &barrier);
+
+  image->imageLayout = layout;
+}
+
+// END OF STATIC FUNCTIONS ----
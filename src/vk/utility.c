@@ -3,6 +3,7 @@
  * SPDX-License-Identifier: MIT
  */
 
+#include <pthread.h>
 #include <stdio.h>
 #include <string.h>
 
@@ -19,30 +20,31 @@
 
 #include "vk/utility.h"
 
+// the installed layers don't change while the program runs, so they are
+// only enumerated the first time they're asked about
+static VkLayerProperties *instance_layers = NULL;
+static uint32_t instance_layer_count = 0;
+static pthread_once_t instance_layers_once = PTHREAD_ONCE_INIT;
+
+// static declarations ----
+
+static void _enumerate_instance_layers(void);
+
+// end of static declarations ----
+
 bool fpx3d_vk_instance_layers_supported(const char **layers,
                                         size_t layer_count) {
   if (1 > layer_count)
     return true;
 
-  uint32_t available = 0;
-  VkLayerProperties *available_layers = NULL;
+  pthread_once(&instance_layers_once, _enumerate_instance_layers);
 
-  vkEnumerateInstanceLayerProperties(&available, NULL);
+  uint32_t available = instance_layer_count;
+  const VkLayerProperties *available_layers = instance_layers;
 
   if (available < layer_count)
     return false;
 
-  available_layers =
-      (VkLayerProperties *)calloc(available, sizeof(VkLayerProperties));
-
-  if (NULL == available_layers) {
-    perror("calloc()");
-    FPX3D_ERROR("Error while checking for Vulkan validation layers");
-    return false;
-  }
-
-  vkEnumerateInstanceLayerProperties(&available, available_layers);
-
   for (size_t i = 0; i < layer_count; ++i) {
     uint8_t found = false;
 
@@ -140,6 +142,9 @@ fpx3d_vk_draw_frame(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
 
   vkResetFences(lgpu->handle, 1, &lgpu->inFlightFences[lgpu->frameCounter]);
 
+  // it won't signal again until this frame is submitted
+  lgpu->inFlightFrames[lgpu->frameCounter] = 0;
+
   if (UINT32_MAX == image_index) {
     // uhhhh
     FPX3D_WARN("Failed to retrieve swapchain image index");
@@ -194,3 +199,29 @@ fpx3d_vk_draw_frame(Fpx3d_Vk_Context *ctx, Fpx3d_Vk_LogicalGpu *lgpu,
 
   return FPX3D_SUCCESS;
 }
+
+// STATIC FUNCTIONS ----
+
+static void _enumerate_instance_layers(void) {
+  uint32_t available = 0;
+
+  vkEnumerateInstanceLayerProperties(&available, NULL);
+
+  if (1 > available)
+    return;
+
+  instance_layers =
+      (VkLayerProperties *)calloc(available, sizeof(VkLayerProperties));
+
+  if (NULL == instance_layers) {
+    perror("calloc()");
+    FPX3D_ERROR("Error while checking for Vulkan validation layers");
+    return;
+  }
+
+  vkEnumerateInstanceLayerProperties(&available, instance_layers);
+
+  instance_layer_count = available;
+}
+
+// END OF STATIC FUNCTIONS ----
@@ -4,17 +4,26 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#include "debug.h"
 #include "fpx3d.h"
 #include "macros.h"
 
+#include "model/mesh.h"
 #include "vk/vertex.h"
 
 extern Fpx3d_E_Result __fpx3d_realloc_array(void **arr_ptr, size_t obj_size,
                                             size_t amount,
                                             size_t *old_capacity);
 
+// static declarations ----
+static int _vk_format_from_stream(const struct fpx3d_model_mesh_stream *);
+static bool _stream_info_from_vk_format(int format,
+                                        struct fpx3d_model_mesh_stream_info *);
+// end of static declarations ----
+
 Fpx3d_E_Result fpx3d_vk_allocate_vertices(Fpx3d_Vk_VertexBundle *bundle,
                                           size_t amount,
                                           size_t single_vertex_size) {
@@ -87,3 +96,239 @@ Fpx3d_E_Result fpx3d_vk_free_vertices(Fpx3d_Vk_VertexBundle *bundle) {
 
   return FPX3D_SUCCESS;
 }
+
+Fpx3d_E_Result fpx3d_vk_vertices_from_mesh(Fpx3d_Vk_VertexBundle *output,
+                                           const Fpx3d_Model_Mesh *mesh,
+                                           Fpx3d_Vk_VertexBinding *binding) {
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+  NULL_CHECK(mesh, FPX3D_ARGS_ERROR);
+  NULL_CHECK(mesh->vertexData, FPX3D_ARGS_ERROR);
+
+  if (1 > mesh->vertexCount || 1 > mesh->streamCount)
+    return FPX3D_ARGS_ERROR;
+
+  size_t vertex_size = 0;
+  for (size_t i = 0; i < mesh->streamCount; ++i)
+    vertex_size += mesh->streams[i].elementSize;
+
+  Fpx3d_Vk_VertexAttribute *attributes = NULL;
+
+  if (NULL != binding) {
+    attributes = (Fpx3d_Vk_VertexAttribute *)calloc(mesh->streamCount,
+                                                    sizeof(*attributes));
+    if (NULL == attributes) {
+      perror("calloc()");
+      return FPX3D_MEMORY_ERROR;
+    }
+
+    size_t offset = 0;
+    for (size_t i = 0; i < mesh->streamCount; ++i) {
+      int format = _vk_format_from_stream(&mesh->streams[i]);
+      if (FPX3D_VK_FORMAT_INVALID == format) {
+        FPX3D_WARN("Mesh stream %" LONG_FORMAT
+                   "u has no matching vertex attribute format",
+                   i);
+        FREE_SAFE(attributes);
+        return FPX3D_ARGS_ERROR;
+      }
+
+      attributes[i].format = format;
+      attributes[i].dataOffsetBytes = offset;
+
+      offset += mesh->streams[i].elementSize;
+    }
+  }
+
+  Fpx3d_Vk_VertexBundle new_bundle = {0};
+
+  Fpx3d_E_Result res =
+      fpx3d_vk_allocate_vertices(&new_bundle, mesh->vertexCount, vertex_size);
+  if (FPX3D_SUCCESS != res) {
+    FREE_SAFE(attributes);
+    return res;
+  }
+
+  uint8_t *dst = (uint8_t *)new_bundle.vertices;
+
+  if (FPX3D_MODEL_LAYOUT_INTERLEAVED == mesh->layout &&
+      mesh->streams[0].stride == vertex_size) {
+    // already laid out the way we want it
+    memcpy(dst, mesh->vertexData, mesh->vertexCount * vertex_size);
+  } else {
+    const uint8_t *src = (const uint8_t *)mesh->vertexData;
+
+    size_t offset = 0;
+    for (size_t s = 0; s < mesh->streamCount; ++s) {
+      const struct fpx3d_model_mesh_stream *stream = &mesh->streams[s];
+
+      for (size_t v = 0; v < mesh->vertexCount; ++v)
+        memcpy(&dst[v * vertex_size + offset],
+               &src[stream->offset + v * stream->stride], stream->elementSize);
+
+      offset += stream->elementSize;
+    }
+  }
+
+  new_bundle.vertexCount = mesh->vertexCount;
+
+  if (0 < mesh->indexCount) {
+    uint32_t *indices = (uint32_t *)calloc(mesh->indexCount, sizeof(uint32_t));
+    if (NULL == indices) {
+      perror("calloc()");
+      fpx3d_vk_free_vertices(&new_bundle);
+      FREE_SAFE(attributes);
+      return FPX3D_MEMORY_ERROR;
+    }
+
+    for (size_t i = 0; i < mesh->indexCount; ++i)
+      indices[i] = fpx3d_model_mesh_get_index(mesh, i);
+
+    // bundle takes ownership, no need to go through fpx3d_vk_set_indices()
+    new_bundle.indices = indices;
+    new_bundle.indexCount = mesh->indexCount;
+  }
+
+  if (NULL != binding) {
+    binding->attributes = attributes;
+    binding->attributeCount = mesh->streamCount;
+    binding->sizePerVertex = vertex_size;
+  }
+
+  *output = new_bundle;
+
+  return FPX3D_SUCCESS;
+}
+
+Fpx3d_E_Result
+fpx3d_vk_vertices_to_mesh(const Fpx3d_Vk_VertexBundle *bundle,
+                          const Fpx3d_Vk_VertexBinding *binding,
+                          const Fpx3d_Model_E_AttributeSemantic *semantics,
+                          Fpx3d_Model_E_MeshLayout layout,
+                          Fpx3d_Model_Mesh *output) {
+  NULL_CHECK(bundle, FPX3D_ARGS_ERROR);
+  NULL_CHECK(binding, FPX3D_ARGS_ERROR);
+  NULL_CHECK(semantics, FPX3D_ARGS_ERROR);
+  NULL_CHECK(output, FPX3D_ARGS_ERROR);
+  NULL_CHECK(bundle->vertices, FPX3D_ARGS_ERROR);
+  NULL_CHECK(binding->attributes, FPX3D_ARGS_ERROR);
+
+  if (1 > binding->attributeCount || 1 > bundle->vertexCount)
+    return FPX3D_ARGS_ERROR;
+
+  struct fpx3d_model_mesh_stream_info *infos =
+      (struct fpx3d_model_mesh_stream_info *)calloc(binding->attributeCount,
+                                                    sizeof(*infos));
+  if (NULL == infos) {
+    perror("calloc()");
+    return FPX3D_MEMORY_ERROR;
+  }
+
+  for (size_t i = 0; i < binding->attributeCount; ++i) {
+    if (false == _stream_info_from_vk_format(binding->attributes[i].format,
+                                             &infos[i])) {
+      FREE_SAFE(infos);
+      return FPX3D_ARGS_ERROR;
+    }
+
+    infos[i].semantic = semantics[i];
+
+    // TEXCOORD_0, TEXCOORD_1, ... in the order they appear in the binding
+    for (size_t j = 0; j < i; ++j)
+      if (semantics[j] == semantics[i])
+        ++infos[i].semanticIndex;
+  }
+
+  Fpx3d_Model_Mesh new_mesh = {0};
+  Fpx3d_E_Result res =
+      fpx3d_model_create_mesh(&new_mesh, layout, bundle->vertexCount, infos,
+                              binding->attributeCount);
+
+  FREE_SAFE(infos);
+
+  if (FPX3D_SUCCESS != res)
+    return res;
+
+  const uint8_t *src = (const uint8_t *)bundle->vertices;
+  size_t src_stride = (0 < binding->sizePerVertex) ? binding->sizePerVertex
+                                                   : bundle->vertexDataSize;
+
+  for (size_t s = 0; s < new_mesh.streamCount; ++s) {
+    struct fpx3d_model_mesh_stream *stream = &new_mesh.streams[s];
+    size_t attr_offset = binding->attributes[s].dataOffsetBytes;
+
+    if (attr_offset + stream->elementSize > src_stride) {
+      fpx3d_model_destroy_mesh(&new_mesh);
+      return FPX3D_INDEX_OUT_OF_RANGE_ERROR;
+    }
+
+    for (size_t v = 0; v < bundle->vertexCount; ++v)
+      memcpy(fpx3d_model_mesh_stream_element(&new_mesh, stream, v),
+             &src[v * src_stride + attr_offset], stream->elementSize);
+  }
+
+  if (0 < bundle->indexCount && NULL != bundle->indices) {
+    res = fpx3d_model_mesh_set_indices(&new_mesh, bundle->indices,
+                                       bundle->indexCount);
+    if (FPX3D_SUCCESS != res) {
+      fpx3d_model_destroy_mesh(&new_mesh);
+      return res;
+    }
+  }
+
+  size_t draw_count =
+      (0 < new_mesh.indexCount) ? new_mesh.indexCount : new_mesh.vertexCount;
+
+  res = fpx3d_model_mesh_add_submesh(&new_mesh, 0, draw_count, -1);
+  if (FPX3D_SUCCESS != res) {
+    fpx3d_model_destroy_mesh(&new_mesh);
+    return res;
+  }
+
+  fpx3d_model_mesh_compute_bounds(&new_mesh);
+
+  *output = new_mesh;
+
+  return FPX3D_SUCCESS;
+}
+
+// STATIC FUNCTIONS ----
+
+static int _vk_format_from_stream(const struct fpx3d_model_mesh_stream *s) {
+  if (2 > s->componentCount || 4 < s->componentCount)
+    return FPX3D_VK_FORMAT_INVALID;
+
+  switch (s->format) {
+  case FPX3D_MODEL_FORMAT_FLOAT16:
+    return VEC2_16BIT_SFLOAT + (s->componentCount - 2);
+  case FPX3D_MODEL_FORMAT_FLOAT32:
+    return VEC2_32BIT_SFLOAT + (s->componentCount - 2);
+  default:
+    return FPX3D_VK_FORMAT_INVALID;
+  }
+}
+
+static bool
+_stream_info_from_vk_format(int format,
+                            struct fpx3d_model_mesh_stream_info *info) {
+  switch (format) {
+  case VEC2_16BIT_SFLOAT:
+  case VEC3_16BIT_SFLOAT:
+  case VEC4_16BIT_SFLOAT:
+    info->format = FPX3D_MODEL_FORMAT_FLOAT16;
+    info->componentCount = 2 + (format - VEC2_16BIT_SFLOAT);
+    return true;
+
+  case VEC2_32BIT_SFLOAT:
+  case VEC3_32BIT_SFLOAT:
+  case VEC4_32BIT_SFLOAT:
+    info->format = FPX3D_MODEL_FORMAT_FLOAT32;
+    info->componentCount = 2 + (format - VEC2_32BIT_SFLOAT);
+    return true;
+
+  default:
+    // the mesh container has no 64-bit float format
+    return false;
+  }
+}
+
+// END OF STATIC FUNCTIONS ----